@@ -0,0 +1,440 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "BaseConv.h"
+#include "Bits.h"
+#include "Simd.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+typedef CalcConvStatus (*DigitParser)(const char* digits, size_t count, unsigned long long* value, size_t* bad);
+typedef size_t (*DigitFormatter)(unsigned long long value, char* buf);
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+// Two decimal digits per entry, for format_dec() and format_udec()
+static const char decimal_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+const char* calc_conv_status_message(CalcConvStatus status) {
+    switch (status) {
+    case CALC_CONV_OK: return "No error";
+    case CALC_CONV_EMPTY: return "Missing digits";
+    case CALC_CONV_INVALID_DIGIT: return "Invalid digit";
+    case CALC_CONV_OVERFLOW: return "Number too large (max 64 bits)";
+    case CALC_CONV_NO_MEMORY: return "Out of memory";
+    }
+    return "Unknown error";
+}
+
+static int hex_digit_value(unsigned char c) {
+    if ((unsigned)(c - '0') < 10) return c - '0';
+    c |= 0x20; // Lower case
+    if ((unsigned)(c - 'a') < 6) return c - 'a' + 10;
+    return -1;
+}
+
+
+// --- Scalar kernels (count <= the maximum number of digits of the base) ---
+
+static CalcConvStatus parse_bin_digits_scalar(const char* digits, size_t count, unsigned long long* value, size_t* bad) {
+    unsigned long long result = 0;
+    for (size_t i = 0; i < count; i++) {
+        unsigned bit = (unsigned char)digits[i] - (unsigned)'0';
+        if (bit > 1) { *bad = i; return CALC_CONV_INVALID_DIGIT; }
+        result = (result << 1) | bit;
+    }
+    *value = result;
+    return CALC_CONV_OK;
+}
+
+static CalcConvStatus parse_hex_digits_scalar(const char* digits, size_t count, unsigned long long* value, size_t* bad) {
+    unsigned long long result = 0;
+    for (size_t i = 0; i < count; i++) {
+        int nibble = hex_digit_value((unsigned char)digits[i]);
+        if (nibble < 0) { *bad = i; return CALC_CONV_INVALID_DIGIT; }
+        result = (result << 4) | (unsigned)nibble;
+    }
+    *value = result;
+    return CALC_CONV_OK;
+}
+
+static size_t format_bin_scalar(unsigned long long value, char* buf) {
+    size_t count = value == 0 ? 1 : (size_t)(64 - leading_zeros(value));
+    for (size_t i = count; i-- > 0; value >>= 1) buf[i] = (char)('0' + (value & 1));
+    buf[count] = '\0';
+    return count;
+}
+
+static size_t format_hex_scalar(unsigned long long value, char* buf) {
+    size_t count = value == 0 ? 1 : (size_t)(16 - leading_zeros(value) / 4);
+    for (size_t i = count; i-- > 0; value >>= 4) buf[i] = hex_digits[value & 0xF];
+    buf[count] = '\0';
+    return count;
+}
+
+
+#ifdef CALC_X86_SIMD
+
+// --- AVX2 kernels: the digits are right-aligned in a zero-padded block and converted at once ---
+
+/**
+ * @brief Number of trailing zero bits of a non-zero value.
+ */
+static int trailing_zeros(unsigned long long value) {
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(value);
+#else
+    int count = 0;
+    while ((value & 1) == 0) { value >>= 1; count++; }
+    return count;
+#endif
+}
+
+/**
+ * @brief Byte-swaps a 64-bit value (the hexadecimal digits come out most significant byte first).
+ */
+static unsigned long long swap_bytes(unsigned long long value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return _byteswap_uint64(value);
+#else
+    return __builtin_bswap64(value);
+#endif
+}
+
+/**
+ * @brief Reverses the 32 bytes of a vector, so that movemask puts the last character in bit 0.
+ */
+CALC_TARGET_AVX2 static __m256i reverse_bytes_avx2(__m256i v) {
+    const __m256i reverse = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+                                             15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, reverse), 0x4E);
+}
+
+CALC_TARGET_AVX2 static CalcConvStatus parse_bin_digits_avx2(const char* digits, size_t count, unsigned long long* value, size_t* bad) {
+    char block[64];
+    const __m256i zero = _mm256_set1_epi8('0');
+    const __m256i one = _mm256_set1_epi8('1');
+    __m256i hi, lo;
+    unsigned long long valid;
+
+    memset(block, '0', 64 - count);
+    memcpy(block + 64 - count, digits, count);
+    hi = _mm256_loadu_si256((const __m256i*)block);
+    lo = _mm256_loadu_si256((const __m256i*)(block + 32));
+
+    valid = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(hi, zero), _mm256_cmpeq_epi8(hi, one)));
+    valid |= (unsigned long long)(unsigned)_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(lo, zero), _mm256_cmpeq_epi8(lo, one))) << 32;
+    if (~valid != 0) {
+        *bad = (size_t)trailing_zeros(~valid) - (64 - count);
+        return CALC_CONV_INVALID_DIGIT;
+    }
+
+    *value = (unsigned long long)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(reverse_bytes_avx2(hi), one)) << 32 |
+             (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(reverse_bytes_avx2(lo), one));
+    return CALC_CONV_OK;
+}
+
+CALC_TARGET_AVX2 static CalcConvStatus parse_hex_digits_avx2(const char* digits, size_t count, unsigned long long* value, size_t* bad) {
+    char block[16];
+    __m128i c, lower, digit, letter, nibbles, pairs;
+    unsigned invalid;
+
+    memset(block, '0', 16 - count);
+    memcpy(block + 16 - count, digits, count);
+    c = _mm_loadu_si128((const __m128i*)block);
+
+    // Signed compares also reject bytes >= 0x80
+    lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+    letter = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('f' + 1), lower));
+    invalid = ~(unsigned)_mm_movemask_epi8(_mm_or_si128(digit, letter)) & 0xFFFF;
+    if (invalid) {
+        *bad = (size_t)trailing_zeros(invalid) - (16 - count);
+        return CALC_CONV_INVALID_DIGIT;
+    }
+
+    // '0'-'9' -> 0-9 and 'A'-'F'/'a'-'f' -> 1-6 + 9, then pairs of nibbles -> bytes
+    nibbles = _mm_add_epi8(_mm_and_si128(c, _mm_set1_epi8(0x0F)), _mm_and_si128(letter, _mm_set1_epi8(9)));
+    pairs = _mm_maddubs_epi16(nibbles, _mm_set1_epi16(0x0110));
+    *value = swap_bytes((unsigned long long)_mm_cvtsi128_si64(_mm_packus_epi16(pairs, pairs)));
+    return CALC_CONV_OK;
+}
+
+CALC_TARGET_AVX2 static size_t format_bin_avx2(unsigned long long value, char* buf) {
+    // Each 128-bit lane spreads one byte of a 32-bit half over 8 characters, most significant first
+    const __m256i spread = _mm256_setr_epi8(3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2,
+                                            1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i bit = _mm256_set1_epi64x(0x0102040810204080LL);
+    char block[64];
+    size_t count = value == 0 ? 1 : (size_t)(64 - leading_zeros(value));
+
+    for (int half = 0; half < 2; half++) {
+        __m256i bytes = _mm256_shuffle_epi8(_mm256_set1_epi32((int)(unsigned)(value >> (32 - 32 * half))), spread);
+        __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, bit), bit);
+        _mm256_storeu_si256((__m256i*)(block + 32 * half), _mm256_sub_epi8(_mm256_set1_epi8('0'), set));
+    }
+    memcpy(buf, block + 64 - count, count);
+    buf[count] = '\0';
+    return count;
+}
+
+CALC_TARGET_AVX2 static size_t format_hex_avx2(unsigned long long value, char* buf) {
+    char block[16];
+    size_t count = value == 0 ? 1 : (size_t)(16 - leading_zeros(value) / 4);
+    __m128i bytes = _mm_cvtsi64_si128((long long)swap_bytes(value));
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F));
+    __m128i lo = _mm_and_si128(bytes, _mm_set1_epi8(0x0F));
+    __m128i table = _mm_loadu_si128((const __m128i*)hex_digits);
+
+    _mm_storeu_si128((__m128i*)block, _mm_shuffle_epi8(table, _mm_unpacklo_epi8(hi, lo)));
+    memcpy(buf, block + 16 - count, count);
+    buf[count] = '\0';
+    return count;
+}
+
+#endif // CALC_X86_SIMD
+
+
+// --- Dispatch ---
+
+static DigitParser bin_parser, hex_parser;
+static DigitFormatter bin_formatter, hex_formatter;
+static volatile int kernels_ready = 0;
+
+/**
+ * @brief Selects the kernels for the CPU once (repeating the selection in a race is harmless).
+ * The AVX-512 level uses the AVX2 kernels: a 64-bit value fits in one AVX2 register pass.
+ */
+static void select_kernels(void) {
+    bin_parser = parse_bin_digits_scalar;
+    hex_parser = parse_hex_digits_scalar;
+    bin_formatter = format_bin_scalar;
+    hex_formatter = format_hex_scalar;
+#ifdef CALC_X86_SIMD
+    if (calc_simd_level() >= CALC_SIMD_AVX2) {
+        bin_parser = parse_bin_digits_avx2;
+        hex_parser = parse_hex_digits_avx2;
+        bin_formatter = format_bin_avx2;
+        hex_formatter = format_hex_avx2;
+    }
+#endif
+    kernels_ready = 1;
+}
+
+/**
+ * @brief Shared front end of parse_bin() and parse_hex(): skips the prefix and the leading zeros
+ * that exceed max_digits, then hands at most max_digits characters to the kernel. A longer number
+ * is run through the kernel max_digits characters at a time to find any invalid character before
+ * it is reported as too large.
+ */
+static CalcConvStatus parse_digits(const char* str, size_t len, char prefix, size_t max_digits, DigitParser parser,
+    unsigned long long* value, size_t* error_offset) {
+    size_t start = 0, bad = 0;
+    CalcConvStatus status;
+
+    *value = 0;
+    if (len >= 2 && str[0] == '0' && (str[1] | 0x20) == prefix) start = 2;
+    if (start == len) {
+        status = CALC_CONV_EMPTY;
+        bad = start;
+    }
+    else {
+        while (len - start > max_digits && str[start] == '0') start++;
+        if (len - start > max_digits) {
+            // The first significant digit does not fit, unless a character is not a digit at all
+            unsigned long long digits;
+            status = CALC_CONV_OVERFLOW;
+            bad = start;
+            for (size_t at = start; at < len && status == CALC_CONV_OVERFLOW; at += max_digits) {
+                size_t offset = 0, count = len - at < max_digits ? len - at : max_digits;
+                if (parser(str + at, count, &digits, &offset) != CALC_CONV_OK) {
+                    status = CALC_CONV_INVALID_DIGIT;
+                    bad = at + offset;
+                }
+            }
+        }
+        else {
+            status = parser(str + start, len - start, value, &bad);
+            bad += start;
+        }
+    }
+    if (status != CALC_CONV_OK && error_offset != NULL) *error_offset = bad;
+    return status;
+}
+
+CalcConvStatus parse_bin(const char* str, size_t len, unsigned long long* value, size_t* error_offset) {
+    if (!kernels_ready) select_kernels();
+    return parse_digits(str, len, 'b', CALC_BIN_MAX_DIGITS, bin_parser, value, error_offset);
+}
+
+CalcConvStatus parse_hex(const char* str, size_t len, unsigned long long* value, size_t* error_offset) {
+    if (!kernels_ready) select_kernels();
+    return parse_digits(str, len, 'x', CALC_HEX_MAX_DIGITS, hex_parser, value, error_offset);
+}
+
+/**
+ * @brief Parses the decimal digits of str from index i to len into a value of at most limit.
+ */
+static CalcConvStatus parse_dec_digits(const char* str, size_t len, size_t i, unsigned long long limit,
+    unsigned long long* magnitude, size_t* error_offset) {
+    *magnitude = 0;
+    if (i == len) {
+        if (error_offset != NULL) *error_offset = i;
+        return CALC_CONV_EMPTY;
+    }
+    for (; i < len; i++) {
+        unsigned digit = (unsigned char)str[i] - (unsigned)'0';
+        if (digit > 9) {
+            if (error_offset != NULL) *error_offset = i;
+            return CALC_CONV_INVALID_DIGIT;
+        }
+        if (*magnitude > (limit - digit) / 10) {
+            if (error_offset != NULL) *error_offset = i;
+            return CALC_CONV_OVERFLOW;
+        }
+        *magnitude = *magnitude * 10 + digit;
+    }
+    return CALC_CONV_OK;
+}
+
+CalcConvStatus parse_dec(const char* str, size_t len, long long* value, size_t* error_offset) {
+    unsigned long long magnitude;
+    unsigned long long limit = (unsigned long long)LLONG_MAX;
+    size_t i = 0;
+    int negative = 0;
+    CalcConvStatus status;
+
+    *value = 0;
+    if (len > 0 && (str[0] == '+' || str[0] == '-')) {
+        negative = str[0] == '-';
+        limit += (unsigned long long)negative; // |LLONG_MIN| = LLONG_MAX + 1
+        i = 1;
+    }
+    status = parse_dec_digits(str, len, i, limit, &magnitude, error_offset);
+    if (status == CALC_CONV_OK) *value = negative ? (long long)(0 - magnitude) : (long long)magnitude;
+    return status;
+}
+
+CalcConvStatus parse_udec(const char* str, size_t len, unsigned long long* value, size_t* error_offset) {
+    CalcConvStatus status = parse_dec_digits(str, len, len > 0 && str[0] == '+', ULLONG_MAX, value, error_offset);
+    if (status != CALC_CONV_OK) *value = 0;
+    return status;
+}
+
+size_t format_bin(unsigned long long value, char* buf) {
+    if (!kernels_ready) select_kernels();
+    return bin_formatter(value, buf);
+}
+
+size_t format_hex(unsigned long long value, char* buf) {
+    if (!kernels_ready) select_kernels();
+    return hex_formatter(value, buf);
+}
+
+/**
+ * @brief Writes the digits of magnitude, after a '-' if negative, and a terminating '\0'.
+ */
+static size_t format_decimal(unsigned long long magnitude, int negative, char* buf) {
+    char digits[CALC_DEC_MAX_CHARS];
+    size_t i = sizeof(digits), count;
+
+    // Two digits per division, from the least significant end
+    while (magnitude >= 100) {
+        unsigned pair = (unsigned)(magnitude % 100) * 2;
+        magnitude /= 100;
+        digits[--i] = decimal_pairs[pair + 1];
+        digits[--i] = decimal_pairs[pair];
+    }
+    if (magnitude >= 10) {
+        digits[--i] = decimal_pairs[magnitude * 2 + 1];
+        digits[--i] = decimal_pairs[magnitude * 2];
+    }
+    else {
+        digits[--i] = (char)('0' + magnitude);
+    }
+    if (negative) digits[--i] = '-';
+
+    count = sizeof(digits) - i;
+    memcpy(buf, digits + i, count);
+    buf[count] = '\0';
+    return count;
+}
+
+size_t format_dec(long long value, char* buf) {
+    return format_decimal(value < 0 ? 0 - (unsigned long long)value : (unsigned long long)value, value < 0, buf);
+}
+
+size_t format_udec(unsigned long long value, char* buf) {
+    return format_decimal(value, 0, buf);
+}
+
+
+// --- Bulk forms ---
+
+size_t parse_bin_n(const char* const* strings, unsigned long long* values, size_t n, size_t* error_offsets) {
+    size_t failures = 0, offset = CALC_CONV_NO_ERROR;
+    for (size_t i = 0; i < n; i++) {
+        int failed = parse_bin(strings[i], strlen(strings[i]), &values[i], &offset) != CALC_CONV_OK;
+        if (error_offsets != NULL) error_offsets[i] = failed ? offset : CALC_CONV_NO_ERROR;
+        failures += (size_t)failed;
+    }
+    return failures;
+}
+
+size_t parse_hex_n(const char* const* strings, unsigned long long* values, size_t n, size_t* error_offsets) {
+    size_t failures = 0, offset = CALC_CONV_NO_ERROR;
+    for (size_t i = 0; i < n; i++) {
+        int failed = parse_hex(strings[i], strlen(strings[i]), &values[i], &offset) != CALC_CONV_OK;
+        if (error_offsets != NULL) error_offsets[i] = failed ? offset : CALC_CONV_NO_ERROR;
+        failures += (size_t)failed;
+    }
+    return failures;
+}
+
+size_t parse_dec_n(const char* const* strings, long long* values, size_t n, size_t* error_offsets) {
+    size_t failures = 0, offset = CALC_CONV_NO_ERROR;
+    for (size_t i = 0; i < n; i++) {
+        int failed = parse_dec(strings[i], strlen(strings[i]), &values[i], &offset) != CALC_CONV_OK;
+        if (error_offsets != NULL) error_offsets[i] = failed ? offset : CALC_CONV_NO_ERROR;
+        failures += (size_t)failed;
+    }
+    return failures;
+}
+
+size_t format_bin_n(const unsigned long long* values, size_t n, char* buf, char separator) {
+    char* p = buf;
+    if (!kernels_ready) select_kernels();
+    for (size_t i = 0; i < n; i++) {
+        p += bin_formatter(values[i], p); // The '\0' is overwritten by the separator
+        *p++ = separator;
+    }
+    return (size_t)(p - buf);
+}
+
+size_t format_hex_n(const unsigned long long* values, size_t n, char* buf, char separator) {
+    char* p = buf;
+    if (!kernels_ready) select_kernels();
+    for (size_t i = 0; i < n; i++) {
+        p += hex_formatter(values[i], p);
+        *p++ = separator;
+    }
+    return (size_t)(p - buf);
+}
+
+size_t format_dec_n(const long long* values, size_t n, char* buf, char separator) {
+    char* p = buf;
+    for (size_t i = 0; i < n; i++) {
+        p += format_dec(values[i], p);
+        *p++ = separator;
+    }
+    return (size_t)(p - buf);
+}
@@ -0,0 +1,119 @@
+#ifndef BASE_CONV_H
+#define BASE_CONV_H
+
+#include <stddef.h>
+
+/*
+ * Binary, hexadecimal and decimal conversions of 64-bit integers without any stdout involvement
+ * (the engine behind calc_dec_to_bin(), calc_dec_to_hex() and calc_convert_base()). Results are
+ * written into caller-provided buffers; parse errors are reported as a status plus the offset of
+ * the offending character.
+ * Binary and hexadecimal digits are parsed and formatted with AVX2 kernels when the CPU has them
+ * (compare + movemask for binary, nibble lookups with pshufb for hexadecimal), with a scalar fallback.
+ *
+ * Accepted input: an optional "0b"/"0B" (binary) or "0x"/"0X" (hexadecimal) prefix followed by
+ * at least one digit, both letter cases for hexadecimal, and an optional sign for decimal.
+ * Leading zeros are allowed in any number. Formatting writes upper-case hexadecimal without a prefix.
+ */
+
+#define CALC_BIN_MAX_DIGITS 64
+#define CALC_HEX_MAX_DIGITS 16
+#define CALC_DEC_MAX_CHARS 20 // "-9223372036854775808"
+
+// Error offset stored by the bulk parsers for the elements that converted successfully
+#define CALC_CONV_NO_ERROR ((size_t)-1)
+
+typedef enum {
+    CALC_CONV_OK,
+    CALC_CONV_EMPTY,         // No digits (the offset is where the first digit was expected)
+    CALC_CONV_INVALID_DIGIT, // The character at the offset is not a digit of the base
+    CALC_CONV_OVERFLOW,      // The digit at the offset does not fit in 64 bits
+    CALC_CONV_NO_MEMORY      // The arbitrary-length conversions could not allocate their result
+} CalcConvStatus;
+
+/**
+ * @brief Returns a printable description of a conversion status.
+ */
+const char* calc_conv_status_message(CalcConvStatus status);
+
+/**
+ * @brief Parses len characters of binary digits.
+ * @param value Receives the value (0 on failure).
+ * @param error_offset Optional; receives the offset of the offending character on failure.
+ */
+CalcConvStatus parse_bin(const char* str, size_t len, unsigned long long* value, size_t* error_offset);
+
+/**
+ * @brief Parses len characters of hexadecimal digits (see parse_bin()).
+ */
+CalcConvStatus parse_hex(const char* str, size_t len, unsigned long long* value, size_t* error_offset);
+
+/**
+ * @brief Parses len characters of a signed decimal number (see parse_bin()).
+ */
+CalcConvStatus parse_dec(const char* str, size_t len, long long* value, size_t* error_offset);
+
+/**
+ * @brief Parses len characters of an unsigned decimal number up to 2^64 - 1, with an optional '+'
+ * (see parse_bin()).
+ */
+CalcConvStatus parse_udec(const char* str, size_t len, unsigned long long* value, size_t* error_offset);
+
+/**
+ * @brief Writes the binary digits of value (no leading zeros, "0" for 0) and a terminating '\0'.
+ * @param buf Buffer of at least CALC_BIN_MAX_DIGITS + 1 characters.
+ * @return The number of digits written.
+ */
+size_t format_bin(unsigned long long value, char* buf);
+
+/**
+ * @brief Writes the hexadecimal digits of value (see format_bin()); buf needs CALC_HEX_MAX_DIGITS + 1 characters.
+ */
+size_t format_hex(unsigned long long value, char* buf);
+
+/**
+ * @brief Writes the decimal representation of value (see format_bin()); buf needs CALC_DEC_MAX_CHARS + 1 characters.
+ */
+size_t format_dec(long long value, char* buf);
+
+/**
+ * @brief Writes the decimal digits of an unsigned value (see format_bin()); buf needs CALC_DEC_MAX_CHARS + 1 characters.
+ */
+size_t format_udec(unsigned long long value, char* buf);
+
+/*
+ * Bulk forms: strings[i] are NUL-terminated. Failing elements get the value 0 and, when
+ * error_offsets is not NULL, the offset of their offending character (CALC_CONV_NO_ERROR otherwise).
+ * The return value is the number of failing elements.
+ */
+
+size_t parse_bin_n(const char* const* strings, unsigned long long* values, size_t n, size_t* error_offsets);
+size_t parse_hex_n(const char* const* strings, unsigned long long* values, size_t n, size_t* error_offsets);
+size_t parse_dec_n(const char* const* strings, long long* values, size_t n, size_t* error_offsets);
+
+/*
+ * Bulk formatting: every value is followed by the separator character (e.g. '\n'), and no '\0'
+ * is written. buf needs n * (CALC_BIN_MAX_DIGITS + 1), n * (CALC_HEX_MAX_DIGITS + 1) or
+ * n * (CALC_DEC_MAX_CHARS + 1) characters. The return value is the number of characters written.
+ */
+
+size_t format_bin_n(const unsigned long long* values, size_t n, char* buf, char separator);
+size_t format_hex_n(const unsigned long long* values, size_t n, char* buf, char separator);
+size_t format_dec_n(const long long* values, size_t n, char* buf, char separator);
+
+/*
+ * Arbitrary-length conversions of non-negative numbers (BigConv.c), accepting the same input as
+ * above without the 64-bit limit. The result is a newly allocated string without prefix or leading
+ * zeros ("0" for zero) that the caller releases with free(); *result_len (optional) receives its
+ * length. Conversions from and to decimal use divide-and-conquer radix conversion with cached
+ * powers of the base over Karatsuba multiplication, so they are subquadratic in the length.
+ */
+
+CalcConvStatus hex_to_bin_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset);
+CalcConvStatus bin_to_hex_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset);
+CalcConvStatus dec_to_bin_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset);
+CalcConvStatus bin_to_dec_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset);
+CalcConvStatus dec_to_hex_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset);
+CalcConvStatus hex_to_dec_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset);
+
+#endif // BASE_CONV_H
@@ -0,0 +1,1222 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "BaseConv.h"
+#include "Thread.h"
+#include "MappedFile.h"
+#include "Stats.h"
+#include "Sheet.h"
+#include "Format.h"
+#include "Parse.h"
+#include "Modular.h"
+#include <stdarg.h>
+#include <ctype.h>
+
+// Size of the stdio buffers used in batch mode (results are flushed in large blocks)
+#define BATCH_IO_BUFFER_SIZE (1 << 20)
+// Longest accepted operation line (including the newline)
+#define BATCH_LINE_MAX 4096
+// Longest accepted line of a base conversion, whose operand can have millions of digits
+#define BATCH_CONVERSION_LINE_MAX ((size_t)64 << 20)
+// An operation line is the operation name followed by at most three operands (modpow)
+#define BATCH_MAX_TOKENS 4
+// Number of compiled "= <expression>" lines kept for reuse (power of two), per thread
+#define BATCH_EXPR_CACHE_SIZE 64
+// Evaluations of a cached expression after which it is compiled to native code (expr_jit())
+#define BATCH_JIT_THRESHOLD 16
+// Input evaluated as one unit by a thread of the parallel evaluator (cut at the next line ending)
+#define BATCH_CHUNK_BYTES (64 * 1024)
+// Chunks read ahead per thread, so that work stealing can even out slow chunks
+#define BATCH_CHUNKS_PER_THREAD 4
+
+// A token of an operation line, pointing into the input (not '\0'-terminated)
+typedef struct {
+    const char* text;
+    size_t len;
+} BatchToken;
+
+// Operation codes understood by the batch interpreter
+typedef enum {
+    BATCH_ADD, BATCH_SUB, BATCH_MUL, BATCH_DIV, BATCH_MOD,
+    BATCH_EXP, BATCH_LOG, BATCH_ABS, BATCH_POW, BATCH_FACT, BATCH_BINOM,
+    BATCH_SIN, BATCH_COS, BATCH_TAN, BATCH_COT, BATCH_HYP,
+    BATCH_DEC2BIN, BATCH_BIN2DEC, BATCH_DEC2HEX, BATCH_HEX2DEC,
+    BATCH_HEX2BIN, BATCH_BIN2HEX, BATCH_MODMUL, BATCH_MODPOW, BATCH_MODINV, BATCH_ISPRIME, BATCH_CLEAR
+} BatchOpCode;
+
+typedef struct {
+    const char* name;
+    BatchOpCode code;
+    int arity;
+    CalcOp stats_op; // Operation recorded in the statistics (CALC_OP_COUNT for none)
+} BatchOp;
+
+// Every operation of the interactive menus, and the modular arithmetic of Modular.h, by batch name
+static const BatchOp batch_ops[] = {
+    { "add", BATCH_ADD, 2, CALC_OP_ADD },               { "sub", BATCH_SUB, 2, CALC_OP_SUBTRACT },
+    { "mul", BATCH_MUL, 2, CALC_OP_MULTIPLY },          { "div", BATCH_DIV, 2, CALC_OP_DIVIDE },
+    { "mod", BATCH_MOD, 2, CALC_OP_REMAINDER },         { "exp", BATCH_EXP, 1, CALC_OP_EXP },
+    { "log", BATCH_LOG, 1, CALC_OP_LOG },               { "abs", BATCH_ABS, 1, CALC_OP_ABS },
+    { "pow", BATCH_POW, 2, CALC_OP_POWER },             { "fact", BATCH_FACT, 1, CALC_OP_FACTORIAL },
+    { "binom", BATCH_BINOM, 2, CALC_OP_BINOMIAL },
+    { "sin", BATCH_SIN, 1, CALC_OP_SIN },               { "cos", BATCH_COS, 1, CALC_OP_COS },
+    { "tan", BATCH_TAN, 1, CALC_OP_TAN },               { "cot", BATCH_COT, 1, CALC_OP_COT },
+    { "hyp", BATCH_HYP, 2, CALC_OP_HYPOT },
+    { "dec2bin", BATCH_DEC2BIN, 1, CALC_OP_DEC_TO_BIN }, { "bin2dec", BATCH_BIN2DEC, 1, CALC_OP_BIN_TO_DEC },
+    { "dec2hex", BATCH_DEC2HEX, 1, CALC_OP_DEC_TO_HEX }, { "hex2dec", BATCH_HEX2DEC, 1, CALC_OP_HEX_TO_DEC },
+    { "hex2bin", BATCH_HEX2BIN, 1, CALC_OP_HEX_TO_BIN }, { "bin2hex", BATCH_BIN2HEX, 1, CALC_OP_BIN_TO_HEX },
+    { "modmul", BATCH_MODMUL, 3, CALC_OP_MOD_MULTIPLY }, { "modpow", BATCH_MODPOW, 3, CALC_OP_MOD_POWER },
+    { "modinv", BATCH_MODINV, 2, CALC_OP_MOD_INVERSE },  { "isprime", BATCH_ISPRIME, 1, CALC_OP_IS_PRIME },
+    { "clear", BATCH_CLEAR, 0, CALC_OP_COUNT }
+};
+
+static const BatchOp* find_batch_op(BatchToken name) {
+    for (size_t i = 0; i < sizeof(batch_ops) / sizeof(batch_ops[0]); i++) {
+        if (strncmp(batch_ops[i].name, name.text, name.len) == 0 && batch_ops[i].name[name.len] == '\0') return &batch_ops[i];
+    }
+    return NULL;
+}
+
+// What evaluating a line did, and so how it changes R and P (see apply_line())
+typedef enum {
+    LINE_SKIPPED,  // Blank line or comment
+    LINE_RESULT,   // Succeeded; the result (NAN for none) is pushed to R/P
+    LINE_FAILED,   // Failed; "nan" was written and R/P stay unchanged
+    LINE_CLEAR,    // "clear": R and P are reset
+    LINE_DEFERRED  // Reads an R or P that is not known yet, or variables that cannot be read in
+                   // this order; nothing was written
+} LineOutcome;
+
+/**
+ * @brief Growable output buffer. Results are collected per chunk of lines so that chunks evaluated
+ * by different threads can be written in input order.
+ */
+typedef struct {
+    char* data;
+    size_t len, capacity;
+    int failed; // An allocation failed and text was lost
+} BatchBuffer;
+
+/**
+ * @brief Makes room for extra more characters; returns 0 (and marks the buffer) if memory ran out.
+ */
+static int buffer_reserve(BatchBuffer* buf, size_t extra) {
+    if (buf->len + extra > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        char* data;
+        while (capacity < buf->len + extra) capacity *= 2;
+        data = (char*)realloc(buf->data, capacity);
+        if (data == NULL) { buf->failed = 1; return 0; }
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+    return 1;
+}
+
+static void buffer_append(BatchBuffer* buf, const char* text, size_t len) {
+    if (!buffer_reserve(buf, len)) return;
+    memcpy(buf->data + buf->len, text, len);
+    buf->len += len;
+}
+
+static void buffer_printf(BatchBuffer* buf, const char* format, ...) {
+    va_list args;
+    int len;
+
+    if (!buffer_reserve(buf, 64)) return;
+    va_start(args, format);
+    len = vsnprintf(buf->data + buf->len, buf->capacity - buf->len, format, args);
+    va_end(args);
+    if (len < 0) { buf->failed = 1; return; }
+    if ((size_t)len >= buf->capacity - buf->len) {
+        // Too long for the free space: grow and format again
+        if (!buffer_reserve(buf, (size_t)len + 1)) return;
+        va_start(args, format);
+        vsnprintf(buf->data + buf->len, buf->capacity - buf->len, format, args);
+        va_end(args);
+    }
+    buf->len += (size_t)len;
+}
+
+/**
+ * @brief Writes a result line with the precision of calc_output_decimals().
+ */
+static void buffer_result(BatchBuffer* buf, double value) {
+    if (!buffer_reserve(buf, CALC_FIXED_MAX_CHARS + 2)) return;
+    buf->len += format_result(value, buf->data + buf->len);
+    buf->data[buf->len++] = '\n';
+}
+
+static int write_to_buffer(void* context, const char* text, size_t len) {
+    BatchBuffer* buf = (BatchBuffer*)context;
+    buffer_append(buf, text, len);
+    return !buf->failed;
+}
+
+/**
+ * @brief Builds the error of an operand that does not parse: which one, what and where.
+ */
+static void operand_error(int index, CalcConvStatus status, size_t offset, const char** error, char* error_text,
+    size_t error_size) {
+    const char* problem = status == CALC_CONV_OVERFLOW ? "Number out of range" : calc_conv_status_message(status);
+    snprintf(error_text, error_size, "Operand %d: %s at position %zu", index, problem, offset + 1);
+    *error = error_text;
+}
+
+/**
+ * @brief Parses a floating-point operand, accepting 'R'/'P' like get_double_input().
+ * @return 1 on success, 0 if the token is not a number (see operand_error()), -1 if it is an R
+ * or P that is not known yet (NAN in ctx, which a real result never is).
+ */
+static int parse_double_operand(const CalcContext* ctx, BatchToken token, int index, double* value, const char** error,
+    char* error_text, size_t error_size) {
+    CalcOperandKind kind;
+    size_t offset = 0;
+    CalcConvStatus status = parse_operand(ctx, token.text, token.len, value, &kind, &offset);
+
+    if (status != CALC_CONV_OK) {
+        operand_error(index, status, offset, error, error_text, error_size);
+        return 0;
+    }
+    return kind != CALC_OPERAND_NUMBER && isnan(*value) ? -1 : 1;
+}
+
+/**
+ * @brief Parses an integer operand in [min, max] (R/P are not available, as in the interactive
+ * integer prompts).
+ * @return 1 on success, 0 if the token is not such an integer (see operand_error()).
+ */
+static int parse_integer_operand(BatchToken token, int index, long long min, long long max, long long* value,
+    const char** error, char* error_text, size_t error_size) {
+    size_t offset = 0;
+    CalcConvStatus status = parse_dec(token.text, token.len, value, &offset);
+
+    if (status == CALC_CONV_OK && (*value < min || *value > max)) {
+        status = CALC_CONV_OVERFLOW;
+        offset = 0;
+    }
+    if (status != CALC_CONV_OK) {
+        operand_error(index, status, offset, error, error_text, error_size);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Parses the unsigned 64-bit operands of the modular operations (R/P are not available).
+ */
+static int parse_unsigned_operands(const BatchToken* tokens, int count, unsigned long long* values,
+    const char** error, char* error_text, size_t error_size) {
+    for (int i = 1; i < count; i++) {
+        size_t offset = 0;
+        CalcConvStatus status = parse_udec(tokens[i].text, tokens[i].len, &values[i - 1], &offset);
+        if (status != CALC_CONV_OK) {
+            operand_error(i, status, offset, error, error_text, error_size);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Evaluates modmul (a * b mod m), modpow (a^e mod m), modinv (a^-1 mod m) and isprime (1 or 0)
+ * exactly on unsigned 64-bit operands.
+ * @param result Receives the result rounded to double.
+ * @param status Receives the status of the operation.
+ */
+static LineOutcome eval_modular(BatchOpCode code, const unsigned long long* u, BatchBuffer* out, double* result,
+    CalcStatus* status) {
+    CalcModulus mod;
+    uint64_t value = 0;
+    char text[CALC_DEC_MAX_CHARS + 1];
+
+    switch (code) {
+    case BATCH_MODMUL:
+    case BATCH_MODPOW:
+        *status = calc_modulus_init(&mod, u[2]);
+        if (*status != CALC_OK) return LINE_FAILED;
+        value = code == BATCH_MODMUL ? calc_mod_mul(&mod, u[0], u[1]) : calc_mod_pow(&mod, u[0], u[1]);
+        break;
+    case BATCH_MODINV:
+        *status = calc_mod_inverse(u[0], u[1], &value);
+        if (*status != CALC_OK) return LINE_FAILED;
+        break;
+    default:
+        value = (uint64_t)calc_is_prime(u[0]);
+        break;
+    }
+    buffer_append(out, text, format_udec(value, text));
+    buffer_append(out, "\n", 1);
+    *result = (double)value;
+    return LINE_RESULT;
+}
+
+/**
+ * @brief Evaluates bin2dec, hex2dec, hex2bin and bin2hex on operands of any length, and dec2bin
+ * and dec2hex on decimal integers beyond 64 bits.
+ * On failure *error points to a message (built in error_text) with the 1-based position of the
+ * offending character.
+ * @param result Receives the decimal value for bin2dec/hex2dec/dec2bin/dec2hex (rounded to double),
+ * NAN otherwise.
+ * @param status Receives the status of the conversion.
+ */
+static LineOutcome eval_base_conversion(BatchOpCode code, BatchToken token, BatchBuffer* out, double* result,
+    CalcStatus* status, const char** error, char* error_text, size_t error_size) {
+    int from_base = code == BATCH_HEX2DEC || code == BATCH_HEX2BIN ? 16
+        : code == BATCH_DEC2BIN || code == BATCH_DEC2HEX ? 10 : 2;
+    int to_base = code == BATCH_BIN2DEC || code == BATCH_HEX2DEC ? 10
+        : code == BATCH_DEC2BIN || code == BATCH_HEX2BIN ? 2 : 16;
+    const char* base_name = from_base == 16 ? "hexadecimal" : from_base == 10 ? "decimal" : "binary";
+    char* text;
+    double value;
+    size_t offset = 0;
+
+    *status = calc_convert_base(token.text, token.len, from_base, to_base, &text, &value, &offset);
+    switch (*status) {
+    case CALC_OK:
+        buffer_append(out, text, strlen(text));
+        buffer_append(out, "\n", 1);
+        free(text);
+        // Like the interactive menu, Hex to Bin and Bin to Hex do not update R/P
+        *result = to_base == 10 || from_base == 10 ? value : NAN;
+        return LINE_RESULT;
+    case CALC_ERR_MISSING_DIGITS: snprintf(error_text, error_size, "Missing %s digits", base_name); break;
+    case CALC_ERR_INVALID_DIGIT: snprintf(error_text, error_size, "Invalid %s digit at position %zu", base_name, offset + 1); break;
+    default: snprintf(error_text, error_size, "%s", calc_status_message(*status)); break;
+    }
+    *error = error_text;
+    return LINE_FAILED;
+}
+
+/**
+ * @brief The operation of calc_prec_apply() that computes a batch operation, if there is one
+ * (mod, fact, binom and the conversions are computed on integers).
+ */
+static int batch_prec_op(BatchOpCode code, CalcPrecOp* op) {
+    switch (code) {
+    case BATCH_ADD: *op = CALC_PREC_ADD; return 1;
+    case BATCH_SUB: *op = CALC_PREC_SUBTRACT; return 1;
+    case BATCH_MUL: *op = CALC_PREC_MULTIPLY; return 1;
+    case BATCH_DIV: *op = CALC_PREC_DIVIDE; return 1;
+    case BATCH_EXP: *op = CALC_PREC_EXP; return 1;
+    case BATCH_LOG: *op = CALC_PREC_LOG; return 1;
+    case BATCH_ABS: *op = CALC_PREC_ABS; return 1;
+    case BATCH_POW: *op = CALC_PREC_POWER; return 1;
+    case BATCH_SIN: *op = CALC_PREC_SIN; return 1;
+    case BATCH_COS: *op = CALC_PREC_COS; return 1;
+    case BATCH_TAN: *op = CALC_PREC_TAN; return 1;
+    case BATCH_COT: *op = CALC_PREC_COT; return 1;
+    case BATCH_HYP: *op = CALC_PREC_HYPOT; return 1;
+    default: return 0;
+    }
+}
+
+/**
+ * @brief Runs a parsed operation and appends its result line to out (see eval_batch_line()),
+ * except for a floating-point result, which the caller formats after timing the operation.
+ * @param precision The precision of the floating-point operations.
+ * @param written Receives 0 if the result line is still to be written (buffer_result() of *result).
+ * @param status Receives the status of the operation.
+ */
+static LineOutcome run_batch_op(const BatchOp* op, CalcPrecision precision, double a, double b, long long a_ll,
+    long long b_ll, const unsigned long long* u, const BatchToken* tokens, BatchBuffer* out, double* result, int* written,
+    CalcStatus* status, const char** error, char* error_text, size_t error_size) {
+    double result_d = NAN;
+    long long result_ll;
+    char text[CALC_BIN_MAX_DIGITS + 2];
+    CalcPrecOp prec_op;
+
+    *result = NAN;
+    *written = 1;
+    *status = CALC_OK;
+    if (precision != CALC_PRECISION_F64 && batch_prec_op(op->code, &prec_op)) {
+        *status = calc_prec_apply(precision, prec_op, a, b, &result_d);
+        if (*status != CALC_OK) {
+            *error = calc_status_message(*status);
+            return LINE_FAILED;
+        }
+        *result = result_d;
+        *written = 0;
+        return LINE_RESULT;
+    }
+    switch (op->code) {
+    case BATCH_ADD: result_d = calc_add(a, b); break;
+    case BATCH_SUB: result_d = calc_subtract(a, b); break;
+    case BATCH_MUL: result_d = calc_multiply(a, b); break;
+    case BATCH_DIV: *status = calc_divide(a, b, &result_d); break;
+    case BATCH_MOD:
+        *status = calc_remainder(a_ll, b_ll, &result_ll);
+        if (*status != CALC_OK) break;
+        buffer_append(out, text, format_dec(result_ll, text));
+        buffer_append(out, "\n", 1);
+        *result = (double)result_ll;
+        return LINE_RESULT;
+    case BATCH_EXP: result_d = calc_exp(a); break;
+    case BATCH_LOG: *status = calc_log(a, &result_d); break;
+    case BATCH_ABS: result_d = calc_abs(a); break;
+    case BATCH_POW: result_d = calc_power(a, b); break;
+    case BATCH_FACT:
+    case BATCH_BINOM:
+        // Exact digits; R/P get the value rounded to a double
+        *status = op->code == BATCH_FACT ? calc_write_factorial((int)a_ll, write_to_buffer, out, result)
+                                         : calc_write_binomial((int)a_ll, (int)b_ll, write_to_buffer, out, result);
+        if (*status != CALC_OK) break;
+        buffer_append(out, "\n", 1);
+        return LINE_RESULT;
+    case BATCH_SIN: result_d = calc_sin(a); break;
+    case BATCH_COS: result_d = calc_cos(a); break;
+    case BATCH_TAN: *status = calc_tan(a, &result_d); break;
+    case BATCH_COT: *status = calc_cot(a, &result_d); break;
+    case BATCH_HYP: result_d = calc_hypot(a, b); break;
+    case BATCH_DEC2BIN:
+    case BATCH_DEC2HEX:
+        // Truncated to integer like the interactive conversion menu; NAN, infinities and values
+        // beyond 64 bits fail without changing R/P
+        *status = calc_truncate_integer(a, &result_ll);
+        if (*status != CALC_OK) break;
+        buffer_append(out, text, op->code == BATCH_DEC2BIN ? calc_dec_to_bin(result_ll, text) : calc_dec_to_hex(result_ll, text));
+        buffer_append(out, "\n", 1);
+        *result = (double)result_ll;
+        return LINE_RESULT;
+    case BATCH_BIN2DEC:
+    case BATCH_HEX2DEC:
+    case BATCH_HEX2BIN:
+    case BATCH_BIN2HEX:
+        return eval_base_conversion(op->code, tokens[1], out, result, status, error, error_text, error_size);
+    case BATCH_MODMUL:
+    case BATCH_MODPOW:
+    case BATCH_MODINV:
+    case BATCH_ISPRIME:
+        if (eval_modular(op->code, u, out, result, status) == LINE_RESULT) return LINE_RESULT;
+        break;
+    case BATCH_CLEAR:
+        buffer_result(out, 0.0);
+        return LINE_CLEAR;
+    }
+
+    if (*status != CALC_OK) {
+        *error = calc_status_message(*status);
+        return LINE_FAILED;
+    }
+    *result = result_d;
+    *written = 0;
+    return LINE_RESULT;
+}
+
+/**
+ * @brief Evaluates a single operation line and appends its result line to out.
+ * The result lets the caller update R and P exactly like the interactive menus do.
+ * @param ctx The session; R and P are read from it (NAN for values not known yet).
+ * @param tokens The operation name followed by its operands.
+ * @param count Number of tokens.
+ * @param out Output buffer for the result.
+ * @param result Receives the result of the operation, NAN if it has no numerical result.
+ * @param error Receives a description of the failure, if any.
+ * @param error_text Buffer for error messages that include a position.
+ */
+static LineOutcome eval_batch_line(const CalcContext* ctx, const BatchToken* tokens, int count, BatchBuffer* out,
+    double* result, const char** error, char* error_text, size_t error_size) {
+    const BatchOp* op = find_batch_op(tokens[0]);
+    double a = NAN, b = NAN;
+    long long a_ll = 0, b_ll = 0;
+    unsigned long long u[BATCH_MAX_TOKENS - 1];
+    CalcStatus status;
+    LineOutcome outcome;
+    int parsed_a, parsed_b = 1, written;
+
+    if (op == NULL) { *error = "Unknown operation"; return LINE_FAILED; }
+    if (count - 1 != op->arity) { *error = "Wrong number of operands"; return LINE_FAILED; }
+
+    switch (op->code) {
+    case BATCH_MOD:
+        if (!parse_integer_operand(tokens[1], 1, LLONG_MIN, LLONG_MAX, &a_ll, error, error_text, error_size) ||
+            !parse_integer_operand(tokens[2], 2, LLONG_MIN, LLONG_MAX, &b_ll, error, error_text, error_size)) {
+            return LINE_FAILED;
+        }
+        break;
+    case BATCH_FACT:
+        if (!parse_integer_operand(tokens[1], 1, INT_MIN, INT_MAX, &a_ll, error, error_text, error_size)) return LINE_FAILED;
+        break;
+    case BATCH_BINOM:
+        if (!parse_integer_operand(tokens[1], 1, INT_MIN, INT_MAX, &a_ll, error, error_text, error_size) ||
+            !parse_integer_operand(tokens[2], 2, INT_MIN, INT_MAX, &b_ll, error, error_text, error_size)) {
+            return LINE_FAILED;
+        }
+        break;
+    case BATCH_MODMUL: case BATCH_MODPOW: case BATCH_MODINV: case BATCH_ISPRIME:
+        if (!parse_unsigned_operands(tokens, count, u, error, error_text, error_size)) return LINE_FAILED;
+        break;
+    case BATCH_BIN2DEC: case BATCH_HEX2DEC: case BATCH_HEX2BIN: case BATCH_BIN2HEX:
+    case BATCH_CLEAR:
+        break;
+    case BATCH_DEC2BIN: case BATCH_DEC2HEX:
+        // A decimal integer beyond 64 bits is converted exactly rather than through a double
+        if (parse_dec(tokens[1].text, tokens[1].len, &a_ll, NULL) == CALC_CONV_OVERFLOW) {
+            CALC_STATS_BEGIN(conversion_timer, op->stats_op);
+            outcome = eval_base_conversion(op->code, tokens[1], out, result, &status, error, error_text, error_size);
+            CALC_STATS_END(conversion_timer, status);
+            return outcome;
+        }
+        // Fall through
+    default:
+        parsed_a = parse_double_operand(ctx, tokens[1], 1, &a, error, error_text, error_size);
+        if (parsed_a != 0 && op->arity == 2) parsed_b = parse_double_operand(ctx, tokens[2], 2, &b, error, error_text, error_size);
+        if (parsed_a == 0 || parsed_b == 0) return LINE_FAILED;
+        if (parsed_a < 0 || parsed_b < 0) return LINE_DEFERRED;
+        break;
+    }
+
+    // Only the operation itself is timed, not parsing the operands or formatting the result
+    CALC_STATS_BEGIN(timer, op->stats_op);
+    outcome = run_batch_op(op, ctx->precision, a, b, a_ll, b_ll, u, tokens, out, result, &written, &status, error, error_text, error_size);
+    CALC_STATS_END(timer, status);
+    if (!written) buffer_result(out, *result);
+    return outcome;
+}
+
+typedef struct {
+    char* source; // '\0'-terminated copy of the expression text
+    size_t len;
+    CompiledExpr* expr;
+    unsigned hits; // Evaluations so far, up to BATCH_JIT_THRESHOLD
+} BatchExprCacheEntry;
+
+/**
+ * @brief State of one evaluating thread (the expression cache is not shared).
+ */
+typedef struct {
+    BatchExprCacheEntry expr_cache[BATCH_EXPR_CACHE_SIZE];
+} BatchWorker;
+
+static void free_worker_cache(BatchWorker* worker) {
+    for (int i = 0; i < BATCH_EXPR_CACHE_SIZE; i++) {
+        free(worker->expr_cache[i].source);
+        expr_free(worker->expr_cache[i].expr);
+    }
+}
+
+// Resolver for lines that must not touch the variables: notes that the expression names one
+static long note_variable(void* context, const char* name, size_t len) {
+    (void)name;
+    (void)len;
+    *(int*)context = 1;
+    return -1;
+}
+
+/**
+ * @brief Evaluates an "= <expression>" line. Expressions are compiled once and cached by their
+ * text, so a formula repeated with different R/P values is only run through the VM, and once it
+ * is hot, as native code.
+ * @param sheet The variables, NULL if the line is evaluated out of order and must not read them.
+ * @param source The expression text (len characters).
+ * @param out Output buffer for the result.
+ * @param result Receives the result of the expression.
+ * @param error Receives a description of the failure, if any.
+ * @param error_text Buffer for compilation error messages.
+ */
+static LineOutcome eval_batch_expression(const CalcContext* ctx, BatchWorker* worker, CalcSheet* sheet,
+    const char* source, size_t len, BatchBuffer* out, double* result, const char** error, char* error_text,
+    size_t error_size) {
+    unsigned long hash = 2166136261UL; // FNV-1a
+    BatchExprCacheEntry* entry;
+    int uses;
+    CALC_STATS_BEGIN(timer, CALC_OP_EXPRESSION); // Compiling counts when the text is not cached
+
+    for (size_t i = 0; i < len; i++) hash = (hash ^ (unsigned char)source[i]) * 16777619UL;
+    entry = &worker->expr_cache[hash & (BATCH_EXPR_CACHE_SIZE - 1)];
+
+    if (entry->source == NULL || entry->len != len || memcmp(entry->source, source, len) != 0) {
+        ExprError expr_error;
+        CompiledExpr* expr;
+        int names_variable = 0;
+        char* copy = (char*)malloc(len + 1);
+        // At another precision than double, constant subexpressions are not folded (in double)
+        CompiledExpr* (*compile)(const char*, ExprResolver, void*, ExprError*) =
+            ctx->precision == CALC_PRECISION_F64 ? expr_compile_vars : expr_compile_unfolded;
+        if (copy == NULL) {
+            *error = "Out of memory";
+            return LINE_FAILED;
+        }
+        memcpy(copy, source, len);
+        copy[len] = '\0';
+        if (sheet != NULL) expr = compile(copy, calc_sheet_resolve, sheet, &expr_error);
+        else expr = compile(copy, note_variable, &names_variable, &expr_error);
+        if (expr == NULL) {
+            free(copy);
+            if (names_variable) return LINE_DEFERRED;
+            CALC_STATS_END(timer, CALC_ERR_SYNTAX);
+            snprintf(error_text, error_size, "%s at column %zu", expr_error.message, expr_error.position + 1);
+            *error = error_text;
+            return LINE_FAILED;
+        }
+        free(entry->source);
+        expr_free(entry->expr);
+        entry->source = copy;
+        entry->len = len;
+        entry->expr = expr;
+        entry->hits = 0;
+    }
+    if (entry->hits < BATCH_JIT_THRESHOLD && ++entry->hits == BATCH_JIT_THRESHOLD &&
+        ctx->precision == CALC_PRECISION_F64) {
+        expr_jit(entry->expr);
+    }
+
+    uses = expr_uses(entry->expr);
+    if (((uses & EXPR_USES_R) && isnan(ctx->last_result)) || ((uses & EXPR_USES_P) && isnan(ctx->prev_result)) ||
+        ((uses & EXPR_USES_VARS) && sheet == NULL)) {
+        return LINE_DEFERRED;
+    }
+    if (uses & EXPR_USES_VARS) {
+        CalcStatus status = calc_sheet_eval(sheet, entry->expr, ctx->precision, ctx->last_result, ctx->prev_result, result);
+        CALC_STATS_END(timer, status);
+        if (status != CALC_OK) {
+            *error = status == CALC_ERR_EVALUATION ? "Expression evaluation failed" : calc_status_message(status);
+            return LINE_FAILED;
+        }
+    }
+    else {
+        *result = expr_eval_prec(entry->expr, ctx->precision, ctx->last_result, ctx->prev_result, NULL);
+        CALC_STATS_END(timer, isnan(*result) ? CALC_ERR_EVALUATION : CALC_OK);
+        if (isnan(*result)) {
+            *error = "Expression evaluation failed";
+            return LINE_FAILED;
+        }
+    }
+    buffer_result(out, *result);
+    return LINE_RESULT;
+}
+
+/**
+ * @brief Evaluates a "<name> = <formula>" line: (re)defines the variable and writes its value,
+ * which is pushed to R/P like the result of an expression line.
+ * @param sheet The variables, NULL if the line is evaluated out of order and must wait.
+ * @param name The name of the variable (name_len characters).
+ * @param formula The formula text (len characters).
+ */
+static LineOutcome eval_batch_definition(const CalcContext* ctx, CalcSheet* sheet, const char* name, size_t name_len,
+    const char* formula, size_t len, BatchBuffer* out, double* result, const char** error, char* error_text,
+    size_t error_size) {
+    ExprError expr_error;
+    CalcStatus status;
+    char* copy;
+
+    // The formula captures R and P, and the variables change in input order only
+    if (sheet == NULL || isnan(ctx->last_result) || isnan(ctx->prev_result)) return LINE_DEFERRED;
+
+    CALC_STATS_BEGIN(timer, CALC_OP_EXPRESSION);
+    copy = (char*)malloc(len + 1);
+    if (copy == NULL) {
+        *error = "Out of memory";
+        return LINE_FAILED;
+    }
+    memcpy(copy, formula, len);
+    copy[len] = '\0';
+    status = calc_sheet_define(sheet, name, name_len, copy, ctx->last_result, ctx->prev_result, &expr_error);
+    free(copy);
+    if (status == CALC_OK) status = calc_sheet_value(sheet, name, name_len, result);
+    CALC_STATS_END(timer, status);
+
+    switch (status) {
+    case CALC_OK:
+        buffer_result(out, *result);
+        return LINE_RESULT;
+    case CALC_ERR_SYNTAX:
+        snprintf(error_text, error_size, "%s at column %zu", expr_error.message, expr_error.position + 1);
+        *error = error_text;
+        break;
+    case CALC_ERR_EVALUATION: *error = "Expression evaluation failed"; break;
+    default: *error = calc_status_message(status); break;
+    }
+    return LINE_FAILED;
+}
+
+/**
+ * @brief Applies the effect of an evaluated line to R and P. After a deferred line, whose
+ * outcome is not known yet, R and P are unknown (NAN) as well.
+ */
+static void apply_line(CalcContext* ctx, LineOutcome outcome, double result) {
+    switch (outcome) {
+    case LINE_RESULT: calc_push_result(ctx, result); break;
+    case LINE_CLEAR: calc_clear(ctx); break;
+    case LINE_DEFERRED: ctx->last_result = ctx->prev_result = NAN; break;
+    default: break;
+    }
+}
+
+static int is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+size_t batch_line_limit(const char* line, size_t len) {
+    const char* end = line + len;
+    const BatchOp* op;
+    BatchToken name;
+
+    while (line < end && is_blank(*line)) line++;
+    name.text = line;
+    while (line < end && !is_blank(*line) && *line != '\n') line++;
+    name.len = (size_t)(line - name.text);
+    op = find_batch_op(name);
+    if (op == NULL) return BATCH_LINE_MAX;
+    switch (op->code) {
+    case BATCH_DEC2BIN: case BATCH_BIN2DEC: case BATCH_DEC2HEX: case BATCH_HEX2DEC:
+    case BATCH_HEX2BIN: case BATCH_BIN2HEX:
+        return BATCH_CONVERSION_LINE_MAX;
+    default:
+        return BATCH_LINE_MAX;
+    }
+}
+
+/**
+ * @brief Evaluates one line of text (len characters without the '\n') with the state ctx.
+ * The line is tokenized in place into views, without copying. Its result line goes to out
+ * ("nan" if it failed).
+ * @param sheet The variables, NULL if the line is evaluated out of order: lines that read or
+ * define variables are deferred then.
+ * @param result Receives the value that the line pushes to R/P.
+ * @param error Receives a description of the failure, if any (error_text holds 128 characters).
+ */
+static LineOutcome eval_source_line(BatchWorker* worker, CalcSheet* sheet, const CalcContext* ctx, const char* line,
+    size_t len, BatchBuffer* out, double* result, const char** error, char* error_text) {
+    BatchToken tokens[BATCH_MAX_TOKENS];
+    const char* p = line;
+    const char* end = line + len;
+    const char* name_end = p;
+    int count = 0;
+    LineOutcome outcome = LINE_FAILED;
+
+    *result = NAN;
+    *error = NULL;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p < end && (isalpha((unsigned char)*p) || *p == '_')) {
+        // A name followed by '=' starts a definition
+        const char* q;
+        name_end = p + 1;
+        while (name_end < end && (isalnum((unsigned char)*name_end) || *name_end == '_')) name_end++;
+        for (q = name_end; q < end && (*q == ' ' || *q == '\t'); q++) {}
+        if (q == end || *q != '=') name_end = p;
+    }
+
+    if (len >= BATCH_LINE_MAX - 1 && len >= batch_line_limit(line, len) - 1) {
+        *error = "Line too long";
+    }
+    else if (p < end && *p == '=') {
+        // Expression line: evaluate the rest without the line ending
+        while (end > p && end[-1] == '\r') end--;
+        outcome = eval_batch_expression(ctx, worker, sheet, p + 1, (size_t)(end - p - 1), out, result, error,
+            error_text, 128);
+    }
+    else if (name_end > p) {
+        const char* formula = (const char*)memchr(name_end, '=', (size_t)(end - name_end)) + 1;
+        while (end > formula && end[-1] == '\r') end--;
+        outcome = eval_batch_definition(ctx, sheet, p, (size_t)(name_end - p), formula, (size_t)(end - formula), out,
+            result, error, error_text, 128);
+    }
+    else {
+        // Split the line on whitespace
+        while (p < end) {
+            while (p < end && is_blank(*p)) p++;
+            if (p == end) break;
+            if (count == BATCH_MAX_TOKENS) { *error = "Too many operands"; break; }
+            tokens[count].text = p;
+            while (p < end && !is_blank(*p)) p++;
+            tokens[count].len = (size_t)(p - tokens[count].text);
+            count++;
+        }
+        if (*error == NULL && (count == 0 || tokens[0].text[0] == '#')) return LINE_SKIPPED;
+
+        if (*error == NULL) outcome = eval_batch_line(ctx, tokens, count, out, result, error, error_text, 128);
+    }
+
+    if (outcome == LINE_FAILED) {
+        buffer_append(out, "nan\n", 4);
+        *result = NAN;
+    }
+    return outcome;
+}
+
+/**
+ * @brief A line that a chunk evaluated before it knew R and P, or deferred.
+ */
+typedef struct {
+    const char* text;         // The line, to evaluate it again if it was deferred
+    size_t len;
+    size_t line;              // Index of the line in the chunk
+    size_t out_start;         // Start of its result in the output of the chunk
+    double result;            // The value passed to apply_line()
+    CalcContext before;       // R/P before the line, if they were known
+    unsigned char outcome;    // LineOutcome
+    unsigned char known;      // before holds R and P
+} BatchPending;
+
+/**
+ * @brief A failed line of a chunk.
+ */
+typedef struct {
+    size_t line;              // Index of the line in the chunk
+    size_t message_end;       // End of its message in the messages of the chunk
+} BatchFailure;
+
+/**
+ * @brief Evaluation of a chunk of complete lines (about BATCH_CHUNK_BYTES of input). A chunk
+ * evaluated in parallel with earlier ones starts with R and P unknown. Its lines are recorded as
+ * pending until it has produced both values itself; pending lines that read R or P are deferred
+ * and evaluated in order when the chunk is written. So are the lines that read or define
+ * variables, unless the chunk is evaluated in order (ordered). Line numbers of the error
+ * messages are only known when the chunk is written as well.
+ */
+typedef struct {
+    const char* begin;
+    const char* end;
+    CalcContext start, state;       // R/P at the start and at the end of the chunk (NAN if unknown)
+    size_t lines;
+    long failures;                  // Failed lines, deferred lines excluded
+    BatchBuffer out, messages;      // Result lines; error messages of the failed lines
+    BatchPending* pending;
+    size_t pending_count, pending_capacity;
+    BatchFailure* failed;
+    size_t failed_count, failed_capacity;
+    int ordered;                    // Evaluated after every earlier line: may use the variables
+    int no_memory;
+} BatchChunk;
+
+/**
+ * @brief Makes room for one more element in a growable array; returns 0 if memory ran out.
+ */
+static int grow_array(void** items, size_t* capacity, size_t count, size_t item_size) {
+    if (count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 16;
+        void* grown = realloc(*items, new_capacity * item_size);
+        if (grown == NULL) return 0;
+        *items = grown;
+        *capacity = new_capacity;
+    }
+    return 1;
+}
+
+typedef struct {
+    BatchChunk* chunks;
+    size_t chunk_count, chunk_capacity;
+    BatchWorker** workers;
+    CalcSheet* sheet;               // Variables of the session
+    int threads;
+    long line_no;                   // Lines written so far
+    long failures;
+    int no_memory;
+    int read_error;                 // The input stream failed (not at its end)
+    BatchBuffer late_out;           // Output of a deferred line
+    FILE* out;
+} BatchRun;
+
+static void eval_chunk(void* context, size_t index, int worker) {
+    BatchRun* run = (BatchRun*)context;
+    BatchChunk* chunk = &run->chunks[index];
+    CalcContext state = chunk->start;
+    CalcSheet* sheet = chunk->ordered ? run->sheet : NULL;
+    char error_text[128];
+
+    chunk->out.len = chunk->messages.len = 0;
+    chunk->lines = chunk->pending_count = chunk->failed_count = 0;
+    chunk->failures = 0;
+    chunk->no_memory = 0;
+    for (const char* line = chunk->begin; line < chunk->end; chunk->lines++) {
+        const char* newline = (const char*)memchr(line, '\n', (size_t)(chunk->end - line)); // Chunks end with '\n'
+        int known = !isnan(state.last_result) && !isnan(state.prev_result);
+        size_t out_start = chunk->out.len;
+        const char* error;
+        double result;
+        LineOutcome outcome = eval_source_line(run->workers[worker], sheet, &state, line, (size_t)(newline - line),
+            &chunk->out, &result, &error, error_text);
+
+        if (outcome == LINE_FAILED) {
+            if (grow_array((void**)&chunk->failed, &chunk->failed_capacity, chunk->failed_count, sizeof(BatchFailure))) {
+                buffer_append(&chunk->messages, error, strlen(error));
+                chunk->failed[chunk->failed_count].line = chunk->lines;
+                chunk->failed[chunk->failed_count++].message_end = chunk->messages.len;
+            }
+            else {
+                chunk->no_memory = 1;
+            }
+            chunk->failures++;
+        }
+        if (!known || outcome == LINE_DEFERRED) {
+            if (grow_array((void**)&chunk->pending, &chunk->pending_capacity, chunk->pending_count, sizeof(BatchPending))) {
+                BatchPending* pending = &chunk->pending[chunk->pending_count++];
+                pending->text = line;
+                pending->len = (size_t)(newline - line);
+                pending->line = chunk->lines;
+                pending->out_start = out_start;
+                pending->result = result;
+                pending->before = state;
+                pending->outcome = (unsigned char)outcome;
+                pending->known = (unsigned char)known;
+            }
+            else {
+                chunk->no_memory = 1;
+            }
+        }
+        apply_line(&state, outcome, result);
+        line = newline + 1;
+    }
+    chunk->state = state;
+    if (chunk->out.failed || chunk->messages.failed) chunk->no_memory = 1;
+}
+
+/**
+ * @brief Writes the error messages of the failed lines of a chunk before line until.
+ */
+static void write_failures(BatchRun* run, const BatchChunk* chunk, size_t* next, size_t until) {
+    for (; *next < chunk->failed_count && chunk->failed[*next].line < until; (*next)++) {
+        size_t start = *next > 0 ? chunk->failed[*next - 1].message_end : 0;
+        fprintf(stderr, "Line %ld: Error: %.*s.\n", run->line_no + 1 + (long)chunk->failed[*next].line,
+            (int)(chunk->failed[*next].message_end - start), chunk->messages.data + start);
+    }
+}
+
+/**
+ * @brief Writes the output of a chunk in line order, evaluating its deferred lines with the
+ * actual R/P of the session, and brings the session to its state after the chunk.
+ */
+static void write_chunk(BatchRun* run, BatchChunk* chunk, CalcContext* ctx) {
+    size_t out_done = 0, next_failure = 0;
+    char error_text[128];
+
+    for (size_t i = 0; i < chunk->pending_count; i++) {
+        BatchPending* pending = &chunk->pending[i];
+        LineOutcome outcome = (LineOutcome)pending->outcome;
+        double result = pending->result;
+
+        if (outcome == LINE_DEFERRED) {
+            const char* error;
+            // Everything before this line first
+            fwrite(chunk->out.data + out_done, 1, pending->out_start - out_done, run->out);
+            out_done = pending->out_start;
+            write_failures(run, chunk, &next_failure, pending->line);
+
+            // The lines since the previous pending one were not, so the chunk knew R and P for them
+            if (pending->known) *ctx = pending->before;
+            run->late_out.len = 0;
+            outcome = eval_source_line(run->workers[0], run->sheet, ctx, pending->text, pending->len, &run->late_out,
+                &result, &error, error_text);
+            fwrite(run->late_out.data, 1, run->late_out.len, run->out);
+            if (outcome == LINE_FAILED) {
+                fprintf(stderr, "Line %ld: Error: %s.\n", run->line_no + 1 + (long)pending->line, error);
+                run->failures++;
+            }
+        }
+        apply_line(ctx, outcome, result);
+    }
+    // Past the last pending line the chunk knew R and P itself
+    if (chunk->pending_count == 0 || chunk->pending[chunk->pending_count - 1].line + 1 < chunk->lines) {
+        *ctx = chunk->state;
+    }
+
+    fwrite(chunk->out.data + out_done, 1, chunk->out.len - out_done, run->out);
+    write_failures(run, chunk, &next_failure, chunk->lines);
+    run->failures += chunk->failures;
+    run->line_no += (long)chunk->lines;
+    if (run->late_out.failed) run->no_memory = 1;
+}
+
+/**
+ * @brief Evaluates a block of complete lines (the last one ends with '\n') and writes their
+ * results in order. The block is cut into chunks at line boundaries, which calc_thread_count()
+ * threads evaluate with work stealing.
+ */
+static void eval_block(BatchRun* run, const char* begin, const char* end, CalcContext* ctx) {
+    size_t count = 0;
+
+    for (const char* p = begin; p < end; count++) {
+        BatchChunk* chunk;
+        const char* cut = end - p > BATCH_CHUNK_BYTES ? p + BATCH_CHUNK_BYTES : end;
+        if (cut < end) cut = (const char*)memchr(cut - 1, '\n', (size_t)(end - cut + 1)) + 1;
+
+        if (!grow_array((void**)&run->chunks, &run->chunk_capacity, count, sizeof(BatchChunk))) {
+            run->no_memory = 1;
+            return;
+        }
+        if (count == run->chunk_count) {
+            memset(&run->chunks[count], 0, sizeof(BatchChunk));
+            run->chunk_count++;
+        }
+        chunk = &run->chunks[count];
+        chunk->begin = p;
+        chunk->end = cut;
+        chunk->start = *ctx; // The precision
+        chunk->start.last_result = chunk->start.prev_result = NAN;
+        chunk->ordered = run->threads == 1 || count == 0;
+        p = cut;
+    }
+
+    if (run->threads > 1) {
+        // Only the first chunk knows R and P in advance
+        run->chunks[0].start = *ctx;
+        calc_parallel_for(count, eval_chunk, run);
+        for (size_t c = 0; c < count && !run->no_memory; c++) {
+            if (run->chunks[c].no_memory) run->no_memory = 1;
+            else write_chunk(run, &run->chunks[c], ctx);
+        }
+    }
+    else {
+        for (size_t c = 0; c < count && !run->no_memory; c++) {
+            run->chunks[c].start = *ctx;
+            eval_chunk(run, c, 0);
+            if (run->chunks[c].no_memory) run->no_memory = 1;
+            else write_chunk(run, &run->chunks[c], ctx);
+        }
+    }
+}
+
+/**
+ * @brief Evaluates the rest of a file that does not end with a line ending: a copy of it with a
+ * '\n' appended (cut to an over-long line, which only needs to be recognized as such).
+ */
+static void eval_last_line(BatchRun* run, const char* text, size_t len, CalcContext* ctx) {
+    size_t limit = batch_line_limit(text, len);
+    char* line;
+
+    if (len > limit) len = limit;
+    line = (char*)malloc(len + 1);
+    if (line == NULL) { run->no_memory = 1; return; }
+    memcpy(line, text, len);
+    line[len] = '\n';
+    eval_block(run, line, line + len + 1, ctx);
+    free(line);
+}
+
+/**
+ * @brief Reads in from start to end in blocks of the parallel window size, cut at line endings.
+ * The buffer grows past the window for a conversion line that does not fit (see batch_line_limit()).
+ */
+static void eval_stream(BatchRun* run, FILE* in, size_t window, CalcContext* ctx) {
+    char* buffer = (char*)malloc(window + 1); // Room for a '\n' after an unterminated last line
+    size_t filled = 0, size = window, limit;
+    int at_end = 0, skipping = 0;
+
+    if (buffer == NULL) { run->no_memory = 1; return; }
+    setvbuf(in, NULL, _IONBF, 0); // The blocks are large enough by themselves
+
+    while (!run->no_memory) {
+        const char* end = NULL;
+        if (!at_end) {
+            size_t read = fread(buffer + filled, 1, size - filled, in);
+            filled += read;
+            at_end = filled < size;
+        }
+        if (skipping) {
+            // Rest of an over-long line
+            const char* newline = (const char*)memchr(buffer, '\n', filled);
+            size_t skip = newline != NULL ? (size_t)(newline - buffer + 1) : filled;
+            memmove(buffer, buffer + skip, filled - skip);
+            filled -= skip;
+            skipping = newline == NULL;
+            if (filled == 0 && at_end) break;
+            continue;
+        }
+        for (size_t i = filled; i > 0; i--) {
+            if (buffer[i - 1] == '\n') { end = buffer + i; break; }
+        }
+        if (end == NULL) {
+            if (filled == 0) break;
+            if (at_end) {
+                buffer[filled] = '\n';
+                eval_block(run, buffer, buffer + filled + 1, ctx);
+                break;
+            }
+            limit = batch_line_limit(buffer, filled);
+            if (size < limit) {
+                // A conversion with a long operand: read the rest of its line into a larger buffer
+                size_t grown = size < limit / 2 ? size * 2 : limit;
+                char* larger = (char*)realloc(buffer, grown + 1);
+                if (larger == NULL) { run->no_memory = 1; break; }
+                buffer = larger;
+                size = grown;
+                continue;
+            }
+            // A single line fills the whole buffer: evaluate its start, which is reported as too long
+            eval_last_line(run, buffer, filled, ctx);
+            filled = 0;
+            skipping = 1;
+            continue;
+        }
+        eval_block(run, buffer, end, ctx);
+        filled -= (size_t)(end - buffer);
+        memmove(buffer, end, filled);
+        if (filled == 0 && at_end) break;
+    }
+    if (ferror(in)) run->read_error = 1;
+    free(buffer);
+}
+
+/**
+ * @brief Evaluates a memory-mapped file in windows cut at line endings, prefetching the next
+ * window while the current one is evaluated.
+ */
+static void eval_mapped(BatchRun* run, const CalcMappedFile* file, size_t window, CalcContext* ctx) {
+    const char* data = file->data;
+    size_t body = file->size; // Up to the last line ending
+
+    while (body > 0 && data[body - 1] != '\n') body--;
+    for (size_t start = 0; start < body && !run->no_memory;) {
+        size_t end = body - start > window ? start + window : body;
+        if (end < body) end = (size_t)((const char*)memchr(data + end - 1, '\n', body - end + 1) - data) + 1;
+        calc_prefetch_mapped(file, end, window);
+        eval_block(run, data + start, data + end, ctx);
+        start = end;
+    }
+    if (body < file->size && !run->no_memory) eval_last_line(run, data + body, file->size - body, ctx);
+}
+
+/**
+ * @brief Evaluates a file (mapped when possible) or a stream with a new BatchRun, with the
+ * variables of sheet (NULL for a sheet of its own).
+ */
+static int run_batch(CalcContext* ctx, CalcSheet* sheet, const CalcMappedFile* file, FILE* in, FILE* out) {
+    BatchRun run;
+    size_t window;
+
+    memset(&run, 0, sizeof(run));
+    run.threads = calc_thread_count();
+    run.out = out;
+    window = (size_t)run.threads * BATCH_CHUNKS_PER_THREAD * BATCH_CHUNK_BYTES;
+    run.workers = (BatchWorker**)calloc(run.threads, sizeof(BatchWorker*));
+    if (run.workers == NULL) run.no_memory = 1;
+    for (int i = 0; i < run.threads && !run.no_memory; i++) {
+        run.workers[i] = (BatchWorker*)calloc(1, sizeof(BatchWorker));
+        if (run.workers[i] == NULL) run.no_memory = 1;
+    }
+    run.sheet = sheet != NULL ? sheet : calc_sheet_create();
+    if (run.sheet == NULL) run.no_memory = 1;
+
+    setvbuf(out, NULL, _IOFBF, BATCH_IO_BUFFER_SIZE);
+    if (!run.no_memory) {
+        if (file != NULL) eval_mapped(&run, file, window, ctx);
+        else eval_stream(&run, in, window, ctx);
+    }
+    fflush(out);
+
+    if (run.no_memory) fprintf(stderr, "Error: Out of memory.\n");
+    if (run.read_error) fprintf(stderr, "Error: Cannot read the input.\n");
+    if (expr_jit_mismatches() > 0) {
+        fprintf(stderr, "Warning: %lu expression evaluations differed between native code and interpreter.\n", expr_jit_mismatches());
+    }
+    for (int i = 0; run.workers != NULL && i < run.threads; i++) {
+        if (run.workers[i] == NULL) continue;
+        free_worker_cache(run.workers[i]);
+        free(run.workers[i]);
+    }
+    for (size_t c = 0; c < run.chunk_count; c++) {
+        free(run.chunks[c].out.data);
+        free(run.chunks[c].messages.data);
+        free(run.chunks[c].pending);
+        free(run.chunks[c].failed);
+    }
+    free(run.chunks);
+    free(run.workers);
+    if (sheet == NULL) calc_sheet_free(run.sheet);
+    free(run.late_out.data);
+    return run.failures > 0 || run.no_memory || run.read_error ? 1 : 0;
+}
+
+/**
+ * @brief Runs the calculator without prompts, reading one operation per line from in.
+ * Each line has the form "<op> [operand] [operand]", e.g. "mul 3.5 R", "sin 30" or "hex2dec FF",
+ * or "= <expression>" for an infix expression such as "= hypot(sin(30), R^2) / log(P)".
+ * "<name> = <formula>" defines a variable, which later formulas and expressions can read by name
+ * ("rate = 0.05", "total = base * (1 + rate)"); redefining one recomputes what depends on it
+ * (see Sheet.h). R and P in a formula take their values of that line.
+ * Blank lines and lines starting with '#' are ignored. One result line is written to out for
+ * every operation ("nan" if it failed); errors are reported on stderr with their line number.
+ * R and P of the context are updated after every successful operation with calc_push_result().
+ *
+ * The input is read in large blocks and tokenized in place. Each block is cut into chunks of
+ * complete lines that calc_thread_count() threads evaluate with work stealing (calc_parallel_for()).
+ * The output, the error messages and every R/P value are exactly those of a line-by-line
+ * evaluation: lines that read R or P before their chunk has determined them are evaluated when
+ * the chunk is written, in input order, like the lines of later chunks that use variables. Independent operations therefore scale with the number
+ * of threads, while a chain of operations on R/P stays as fast as sequential evaluation.
+ * @param sheet The variables, kept after the run (e.g. for a saved session), or NULL for new ones.
+ * @param in Stream with the operations.
+ * @param out Stream for the results.
+ * @return 0 if every operation succeeded, 1 otherwise or if in cannot be read.
+ */
+int run_batch_mode(CalcContext* ctx, CalcSheet* sheet, FILE* in, FILE* out) {
+    return run_batch(ctx, sheet, NULL, in, out);
+}
+
+/**
+ * @brief Like run_batch_mode(), for the file at path. Regular files are memory-mapped and parsed
+ * without being copied; anything else (e.g. a pipe) is read as a stream.
+ * @return 0 if every operation succeeded, 1 otherwise or if the file cannot be opened or read.
+ */
+int run_batch_file(CalcContext* ctx, CalcSheet* sheet, const char* path, FILE* out) {
+    CalcMappedFile file;
+    FILE* in;
+    int status;
+
+    if (calc_map_file(path, &file)) {
+        status = run_batch(ctx, sheet, &file, NULL, out);
+        calc_unmap_file(&file);
+        return status;
+    }
+    in = fopen(path, "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Error: Cannot open '%s'.\n", path);
+        return 1;
+    }
+    status = run_batch(ctx, sheet, NULL, in, out);
+    fclose(in);
+    return status;
+}
+
+
+// --- Single lines (server connections) ---
+
+struct BatchSession {
+    BatchWorker worker;
+    CalcSheet* sheet;
+    BatchBuffer out; // Response to the last line
+};
+
+BatchSession* batch_session_create(void) {
+    BatchSession* session = (BatchSession*)calloc(1, sizeof(BatchSession));
+    if (session == NULL) return NULL;
+    session->sheet = calc_sheet_create();
+    if (session->sheet == NULL) {
+        free(session);
+        return NULL;
+    }
+    return session;
+}
+
+const char* batch_session_eval(BatchSession* session, CalcContext* ctx, const char* line, size_t len, size_t* response_len) {
+    static const char out_of_memory[] = "error: Out of memory\n";
+    char error_text[128];
+    const char* error;
+    double result;
+    LineOutcome outcome;
+
+    session->out.len = 0;
+    session->out.failed = 0;
+    outcome = eval_source_line(&session->worker, session->sheet, ctx, line, len, &session->out, &result, &error,
+        error_text);
+    if (outcome == LINE_FAILED) {
+        // Replaces the "nan" of batch mode, whose messages go to stderr instead
+        session->out.len = 0;
+        buffer_printf(&session->out, "error: %s\n", error);
+    }
+    apply_line(ctx, outcome, result);
+    if (session->out.failed) {
+        *response_len = sizeof(out_of_memory) - 1;
+        return out_of_memory;
+    }
+    *response_len = session->out.len;
+    return session->out.len > 0 ? session->out.data : "";
+}
+
+void batch_session_free(BatchSession* session) {
+    if (session == NULL) return;
+    free_worker_cache(&session->worker);
+    calc_sheet_free(session->sheet);
+    free(session->out.data);
+    free(session);
+}
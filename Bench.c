@@ -0,0 +1,1143 @@
+#define _CRT_SECURE_NO_WARNINGS
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // sched_setaffinity(), sched_getcpu()
+#endif
+#include "Calculator.h"
+#include "BaseConv.h"
+#include "Columns.h"
+#include "VectorMath.h"
+#include "Simd.h"
+#include "Sheet.h"
+#include "Format.h"
+#include "Parse.h"
+#include "Reduction.h"
+#include "Matrix.h"
+#include "Solver.h"
+#include "Snapshot.h"
+#include "Modular.h"
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/*
+ * Microbenchmarks of the calculator operations ("--bench"). Every benchmark runs one operation
+ * over a fixed set of BENCH_OPERANDS operands drawn from a seeded distribution (uniform values,
+ * denormals, angles on the tan/cot asymptotes, long binary and hexadecimal strings, ...), so that
+ * two runs measure exactly the same work. After a warmup, the set is timed in several samples and
+ * the median is reported in ns/op and ops/s, together with hardware counters per operation when
+ * perf_event_open() is available. Results can be written as JSON and compared with such a file
+ * from an earlier run to flag regressions. The precision benchmarks also report the largest
+ * relative error of their results against the f128 evaluation of the same operands.
+ *
+ * Built with CALC_BENCH_MAIN defined, this file is also the standalone "bench" program, which
+ * takes the options of --bench.
+ */
+
+// Operands per benchmark (the arrays stay in the L2 cache)
+#define BENCH_OPERANDS 4096
+// Timed samples per benchmark; the median is reported
+#define BENCH_SAMPLES 9
+// Longest benchmark name
+#define BENCH_NAME_MAX 64
+
+typedef struct {
+    double a[BENCH_OPERANDS], b[BENCH_OPERANDS];
+    long long ia[BENCH_OPERANDS], ib[BENCH_OPERANDS];
+    char* strings[BENCH_OPERANDS]; // '\0'-terminated digits or decimal numbers
+    size_t lengths[BENCH_OPERANDS];
+    double out[BENCH_OPERANDS], cosine[BENCH_OPERANDS];
+    long long iout[BENCH_OPERANDS];
+    unsigned char errors[BENCH_OPERANDS / 8];
+    CompiledExpr* expr;
+    CalcPrecision precision;       // Of the precision benchmarks
+    CalcModulus modulus;           // Of the modular benchmarks
+    CalcSheet* sheet;
+    void* snapshot;                // Snapshot of the sheet, snapshot_size bytes
+    size_t snapshot_size;
+    CalcMatrix matrix_a, matrix_b; // Operands of the matrix benchmarks
+    CalcSolverResult roots[BENCH_OPERANDS];
+    CalcStatus root_statuses[BENCH_OPERANDS];
+    size_t count; // Operands in use (at most BENCH_OPERANDS)
+} BenchData;
+
+typedef void (*BenchFill)(BenchData* data, int param);
+// Runs the operation on every operand and returns a value that depends on the results
+typedef double (*BenchKernel)(BenchData* data);
+
+typedef struct {
+    const char* name; // "function/distribution"
+    BenchFill fill;
+    int param;        // Parameter of the distribution (e.g. string length)
+    BenchKernel kernel;
+    size_t operands;  // Operations per kernel call; 0 for BENCH_OPERANDS (fewer for slow operations)
+} BenchCase;
+
+typedef struct {
+    char name[BENCH_NAME_MAX];
+    double ns_per_op, ns_min, ns_max;
+    double ops;                      // Operations timed over all samples
+    int counters;                    // The hardware counters below are valid
+    double cycles, instructions, branch_misses, cache_misses; // Per operation
+    int accuracy;                    // max_rel_error is valid
+    double max_rel_error;            // Against the f128 evaluation
+} BenchResult;
+
+// Keeps the compiler from discarding the benchmarked calls
+static volatile double bench_sink;
+
+
+// --- Operand distributions ---
+
+static uint64_t bench_random(uint64_t* state) {
+    // xorshift64*
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+// Uniform in [low, high)
+static double bench_uniform(uint64_t* state, double low, double high) {
+    return low + (high - low) * (double)(bench_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint64_t bench_seed(int param) {
+    return 0x9E3779B97F4A7C15ULL ^ (uint64_t)(param + 1) * 0xBF58476D1CE4E5B9ULL;
+}
+
+// a and b uniform in [-param, param)
+static void fill_uniform(BenchData* data, int param) {
+    uint64_t state = bench_seed(param);
+    for (size_t i = 0; i < BENCH_OPERANDS; i++) {
+        data->a[i] = bench_uniform(&state, -param, param);
+        data->b[i] = bench_uniform(&state, -param, param);
+    }
+}
+
+// a log-uniform in [2^-param, 2^param), b uniform in [-8, 8) (logarithm and power bases)
+static void fill_positive(BenchData* data, int param) {
+    uint64_t state = bench_seed(param);
+    for (size_t i = 0; i < BENCH_OPERANDS; i++) {
+        data->a[i] = exp2(bench_uniform(&state, -param, param));
+        data->b[i] = bench_uniform(&state, -8, 8);
+    }
+}
+
+// a and b subnormal, with both signs
+static void fill_denormal(BenchData* data, int param) {
+    uint64_t state = bench_seed(param);
+    for (size_t i = 0; i < BENCH_OPERANDS; i++) {
+        data->a[i] = ldexp(bench_uniform(&state, -2, 2), -1024 - (int)(bench_random(&state) % 48));
+        data->b[i] = ldexp(bench_uniform(&state, 1, 2), -1024 - (int)(bench_random(&state) % 48));
+    }
+}
+
+// Angles exactly on the asymptotes param + 180k degrees (90 for tan, 0 for cot)
+static void fill_asymptotes(BenchData* data, int param) {
+    uint64_t state = bench_seed(param);
+    for (size_t i = 0; i < BENCH_OPERANDS; i++) {
+        data->a[i] = param + 180.0 * (double)((long long)(bench_random(&state) % 4001) - 2000);
+    }
+}
+
+// Random 64-bit integers in a, small non-zero moduli in b
+static void fill_int64(BenchData* data, int param) {
+    uint64_t state = bench_seed(param);
+    for (size_t i = 0; i < BENCH_OPERANDS; i++) {
+        data->ia[i] = (long long)bench_random(&state);
+        data->ib[i] = (long long)(bench_random(&state) % 1000) + 1;
+        data->a[i] = (double)(data->ia[i] >> 11); // Exact in a double, for the decimal conversions
+    }
+}
+
+// An odd modulus of param bits (at most 63); a and b (bases and exponents) uniform 64-bit
+static void fill_modular(BenchData* data, int param) {
+    uint64_t state = bench_seed(param);
+    calc_modulus_init(&data->modulus, (bench_random(&state) >> (64 - param)) | 1ULL << (param - 1) | 1);
+    for (size_t i = 0; i < BENCH_OPERANDS; i++) {
+        data->ia[i] = (long long)bench_random(&state);
+        data->ib[i] = (long long)bench_random(&state);
+    }
+}
+
+// n in [0, param], k in [0, n]
+static void fill_integers(BenchData* data, int param) {
+    uint64_t state = bench_seed(param);
+    for (size_t i = 0; i < BENCH_OPERANDS; i++) {
+        data->ia[i] = (long long)(bench_random(&state) % (uint64_t)(param + 1));
+        data->ib[i] = (long long)(bench_random(&state) % (uint64_t)(data->ia[i] + 1));
+    }
+}
+
+/**
+ * @brief Random digit strings: binary for a positive param, hexadecimal for a negative one,
+ * with |param| digits and a non-zero first digit.
+ */
+static void fill_digits(BenchData* data, int param) {
+    static const char digits[] = "0123456789ABCDEF";
+    uint64_t state = bench_seed(param);
+    int base = param > 0 ? 2 : 16;
+    size_t len = (size_t)(param > 0 ? param : -param);
+
+    for (size_t i = 0; i < data->count; i++) {
+        char* text = (char*)malloc(len + 1);
+        if (text == NULL) { data->count = i; return; }
+        for (size_t j = 0; j < len; j++) text[j] = digits[bench_random(&state) % (uint64_t)base];
+        if (text[0] == '0') text[0] = '1';
+        text[len] = '\0';
+        data->strings[i] = text;
+        data->lengths[i] = len;
+    }
+}
+
+// Decimal numbers with param significant digits ("%.*g") of values uniform in [-1000, 1000)
+static void fill_decimals(BenchData* data, int param) {
+    char text[32];
+    fill_uniform(data, 1000);
+    for (size_t i = 0; i < data->count; i++) {
+        int len = snprintf(text, sizeof(text), "%.*g", param, data->a[i]);
+        data->strings[i] = (char*)malloc((size_t)len + 1);
+        if (data->strings[i] == NULL) { data->count = i; return; }
+        memcpy(data->strings[i], text, (size_t)len + 1);
+        data->lengths[i] = (size_t)len;
+    }
+}
+
+// Formulas of the expression benchmarks: a short one and a longer chain of operations
+static const char* const bench_formulas[] = {
+    "hypot(sin(30), R^2) / log(P)",
+    "hypot(R * P, sin(R)^2) * pow(P, 0.5) - R / P + abs(cos(R - P))"
+};
+
+/**
+ * @brief The formula of index param & 1, interpreted, or compiled to native code if param & 2,
+ * evaluated with R from a (uniform in [-100, 100)) and P from b (in [1, 101)).
+ */
+static void fill_expression(BenchData* data, int param) {
+    fill_uniform(data, 100);
+    for (size_t i = 0; i < BENCH_OPERANDS; i++) data->b[i] = fabs(data->b[i]) + 1;
+    data->expr = expr_compile(bench_formulas[param & 1], NULL);
+    if ((param & 2) && data->expr != NULL) expr_jit(data->expr);
+}
+
+// Formulas of the precision benchmarks: a function, a power and the future value of an annuity
+// (monthly payments R at the rate P over 30 years), which cancels digits in (1 + P)^360 - 1
+static const char* const bench_precision_formulas[] = {
+    "sin(R)",
+    "R ^ P",
+    "R * ((1 + P) ^ 360 - 1) / P"
+};
+
+/**
+ * @brief The formula of index param & 3 at the precision param >> 2, with R uniform in
+ * [-720, 720) for sin(R), log-uniform in [2^-8, 2^8) with P uniform in [-8, 8) for R ^ P, and in
+ * [1, 1000) with P in [0.0001, 0.01) for the annuity. The operands do not depend on the precision.
+ * Like --sweep and --batch, f64 runs native code.
+ */
+static void fill_precision(BenchData* data, int param) {
+    int formula = param & 3;
+    if (formula == 0) fill_uniform(data, 720);
+    else if (formula == 1) fill_positive(data, 8);
+    else {
+        uint64_t state = bench_seed(formula);
+        for (size_t i = 0; i < BENCH_OPERANDS; i++) {
+            data->a[i] = bench_uniform(&state, 1, 1000);
+            data->b[i] = bench_uniform(&state, 0.0001, 0.01);
+        }
+    }
+    data->precision = (CalcPrecision)(param >> 2);
+    data->expr = expr_compile_unfolded(bench_precision_formulas[formula], NULL, NULL, NULL);
+    if (data->precision == CALC_PRECISION_F64 && data->expr != NULL) expr_jit(data->expr);
+}
+
+/**
+ * @brief A sheet whose cell "total" is at the end of a chain of param formulas fed by the input
+ * cell "x0", which takes the values of a (uniform in [-100, 100)).
+ */
+static void fill_sheet(BenchData* data, int param) {
+    char name[32], formula[64];
+    fill_uniform(data, 100);
+    data->sheet = calc_sheet_create();
+    if (data->sheet == NULL) return;
+    calc_sheet_set(data->sheet, "x0", 2, 0);
+    for (int i = 1; i <= param; i++) {
+        int len = snprintf(name, sizeof(name), "x%d", i);
+        snprintf(formula, sizeof(formula), "x%d * 0.5 + sin(x%d)", i - 1, i - 1);
+        calc_sheet_define(data->sheet, name, (size_t)len, formula, 0, 0, NULL);
+    }
+    snprintf(formula, sizeof(formula), "x%d", param);
+    calc_sheet_define(data->sheet, "total", 5, formula, 0, 0, NULL);
+}
+
+/**
+ * @brief The snapshot of the sheet of fill_sheet() with every cell up to date.
+ */
+static void fill_snapshot(BenchData* data, int param) {
+    CalcContext ctx;
+    double total;
+    fill_sheet(data, param);
+    if (data->sheet == NULL || calc_sheet_value(data->sheet, "total", 5, &total) != CALC_OK) return;
+    calc_init(&ctx);
+    data->snapshot_size = calc_snapshot_size(&ctx, data->sheet);
+    data->snapshot = malloc(data->snapshot_size);
+    if (data->snapshot != NULL) calc_snapshot_write(&ctx, data->sheet, data->snapshot);
+}
+
+
+/**
+ * @brief The root problems sin(R) = P in [0, 90] with P from b (in [0.001, 0.999)), through native
+ * code, for the solvers.
+ */
+static void fill_solver(BenchData* data, int param) {
+    fill_uniform(data, 1);
+    for (size_t i = 0; i < BENCH_OPERANDS; i++) {
+        data->a[i] = 0;
+        data->cosine[i] = 90;
+        data->b[i] = 0.001 + 0.998 * fabs(data->b[i]);
+    }
+    data->expr = expr_compile("sin(R) - P", NULL);
+    if (data->expr != NULL) expr_jit(data->expr);
+    (void)param;
+}
+
+/**
+ * @brief Square matrices of side param, uniform in [-1, 1) with a dominant diagonal (well
+ * conditioned for the solve).
+ */
+static void fill_matrix(BenchData* data, int param) {
+    uint64_t state = bench_seed(param);
+    size_t n = (size_t)param;
+    fill_uniform(data, 1000);
+    if (calc_matrix_create(&data->matrix_a, n, n) != CALC_OK || calc_matrix_create(&data->matrix_b, n, n) != CALC_OK) return;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            CALC_MATRIX_AT(&data->matrix_a, i, j) = bench_uniform(&state, -1, 1) + (i == j ? (double)n : 0);
+            CALC_MATRIX_AT(&data->matrix_b, i, j) = bench_uniform(&state, -1, 1);
+        }
+    }
+}
+
+
+// --- Operations ---
+
+#define BENCH_BINARY(function, call)                                      \
+    static double function(BenchData* data) {                             \
+        for (size_t i = 0; i < data->count; i++) {                        \
+            double a = data->a[i], b = data->b[i];                        \
+            (void)b;                                                      \
+            data->out[i] = call;                                          \
+        }                                                                 \
+        return data->out[0] + data->out[data->count - 1];                 \
+    }
+
+// Operations that report failures through a CalcStatus (the result is 0 then)
+#define BENCH_STATUS(function, call)                                      \
+    static double function(BenchData* data) {                             \
+        for (size_t i = 0; i < data->count; i++) {                        \
+            double a = data->a[i], b = data->b[i], result = 0;            \
+            (void)b;                                                      \
+            if (call != CALC_OK) result = 0;                              \
+            data->out[i] = result;                                        \
+        }                                                                 \
+        return data->out[0] + data->out[data->count - 1];                 \
+    }
+
+BENCH_BINARY(bench_add, calc_add(a, b))
+BENCH_BINARY(bench_subtract, calc_subtract(a, b))
+BENCH_BINARY(bench_multiply, calc_multiply(a, b))
+BENCH_STATUS(bench_divide, calc_divide(a, b, &result))
+BENCH_BINARY(bench_exp, calc_exp(a))
+BENCH_STATUS(bench_log, calc_log(a, &result))
+BENCH_BINARY(bench_abs, calc_abs(a))
+BENCH_BINARY(bench_power, calc_power(a, b))
+BENCH_BINARY(bench_sin, calc_sin(a))
+BENCH_BINARY(bench_cos, calc_cos(a))
+BENCH_STATUS(bench_tan, calc_tan(a, &result))
+BENCH_STATUS(bench_cot, calc_cot(a, &result))
+BENCH_BINARY(bench_hypot, calc_hypot(a, b))
+BENCH_BINARY(bench_expression, expr_eval(data->expr, a, b))
+
+static double bench_precision(BenchData* data) {
+    if (data->expr == NULL) return 0;
+    expr_eval_prec_many(data->expr, data->precision, data->a, data->b, data->out, data->count);
+    return data->out[0] + data->out[data->count - 1];
+}
+
+/**
+ * @brief The largest relative error of the results of bench_precision() (in out) against the
+ * f128 evaluation, over the operands whose exact result is finite and not 0.
+ */
+static double precision_error(BenchData* data) {
+    double max_error = 0;
+    expr_eval_prec_many(data->expr, CALC_PRECISION_F128, data->a, data->b, data->cosine, data->count);
+    for (size_t i = 0; i < data->count; i++) {
+        double exact = data->cosine[i];
+        if (isfinite(exact) && exact != 0) {
+            double error = fabs((data->out[i] - exact) / exact);
+            if (!(error <= max_error)) max_error = error; // NAN counts as an infinite error
+        }
+    }
+    return max_error;
+}
+
+// Changes the input of the sheet and reads the total, which recomputes the whole chain
+static double bench_sheet(BenchData* data) {
+    double sum = 0;
+    if (data->sheet == NULL) return 0;
+    for (size_t i = 0; i < data->count; i++) {
+        double total = 0;
+        calc_sheet_set(data->sheet, "x0", 2, data->a[i]);
+        calc_sheet_value(data->sheet, "total", 5, &total);
+        sum += total;
+    }
+    return sum;
+}
+
+// Restores the sheet from its snapshot and reads the total (up to date, so not recomputed)
+static double bench_snapshot_restore(BenchData* data) {
+    double sum = 0;
+    if (data->snapshot == NULL) return 0;
+    for (size_t i = 0; i < data->count; i++) {
+        CalcContext ctx;
+        CalcSheet* sheet = calc_sheet_create();
+        double total = 0;
+        if (sheet != NULL && calc_snapshot_read(data->snapshot, data->snapshot_size, &ctx, sheet) == CALC_OK) {
+            calc_sheet_value(sheet, "total", 5, &total);
+        }
+        calc_sheet_free(sheet);
+        sum += total;
+    }
+    return sum;
+}
+
+static double bench_remainder(BenchData* data) {
+    for (size_t i = 0; i < data->count; i++) {
+        if (calc_remainder(data->ia[i], data->ib[i], &data->iout[i]) != CALC_OK) data->iout[i] = 0;
+    }
+    return (double)(data->iout[0] + data->iout[data->count - 1]);
+}
+
+static double bench_remainder_fixed(BenchData* data) {
+    long long b = (long long)data->modulus.modulus;
+    for (size_t i = 0; i < data->count; i++) {
+        if (calc_remainder(data->ia[i], b, &data->iout[i]) != CALC_OK) data->iout[i] = 0;
+    }
+    return (double)(data->iout[0] + data->iout[data->count - 1]);
+}
+
+static double bench_remainder_invariant_n(BenchData* data) {
+    calc_mod_remainder_n(data->ia, (long long)data->modulus.modulus, data->iout, data->count);
+    return (double)(data->iout[0] + data->iout[data->count - 1]);
+}
+
+static double bench_mod_pow(BenchData* data) {
+    uint64_t* out = (uint64_t*)data->iout;
+    for (size_t i = 0; i < data->count; i++) {
+        out[i] = calc_mod_pow(&data->modulus, (uint64_t)data->ia[i], (uint64_t)data->ib[i]);
+    }
+    return (double)(out[0] ^ out[data->count - 1]);
+}
+
+static double bench_mod_pow_n(BenchData* data) {
+    uint64_t* out = (uint64_t*)data->iout;
+    calc_mod_pow_n(&data->modulus, (const uint64_t*)data->ia, (const uint64_t*)data->ib, out, data->count);
+    return (double)(out[0] ^ out[data->count - 1]);
+}
+
+static double bench_is_prime(BenchData* data) {
+    int primes = 0;
+    for (size_t i = 0; i < data->count; i++) primes += calc_is_prime(((uint64_t)data->ia[i] >> 1) | 1);
+    return primes;
+}
+
+static double bench_factorial(BenchData* data) {
+    for (size_t i = 0; i < data->count; i++) {
+        if (calc_factorial((int)data->ia[i], &data->out[i]) != CALC_OK) data->out[i] = 0;
+    }
+    return data->out[0] + data->out[data->count - 1];
+}
+
+static double bench_binomial(BenchData* data) {
+    for (size_t i = 0; i < data->count; i++) {
+        if (calc_binomial((int)data->ia[i], (int)data->ib[i], &data->out[i]) != CALC_OK) data->out[i] = 0;
+    }
+    return data->out[0] + data->out[data->count - 1];
+}
+
+static int count_digits(void* context, const char* text, size_t len) {
+    (void)text;
+    *(size_t*)context += len;
+    return 1;
+}
+
+// Exact digits of ia[i]!, streamed to a writer that only counts them
+static double bench_factorial_exact(BenchData* data) {
+    size_t digits = 0;
+    double value;
+    for (size_t i = 0; i < data->count; i++) {
+        if (calc_write_factorial((int)data->ia[i], count_digits, &digits, &value) != CALC_OK) return 0;
+    }
+    return (double)digits;
+}
+
+static double bench_dec_to_bin(BenchData* data) {
+    char text[CALC_BIN_MAX_DIGITS + 2];
+    size_t total = 0;
+    for (size_t i = 0; i < data->count; i++) total += calc_dec_to_bin(data->ia[i], text);
+    return (double)total;
+}
+
+static double bench_dec_to_hex(BenchData* data) {
+    char text[CALC_HEX_MAX_DIGITS + 1];
+    size_t total = 0;
+    for (size_t i = 0; i < data->count; i++) total += calc_dec_to_hex(data->ia[i], text);
+    return (double)total;
+}
+
+static double bench_format_fixed(BenchData* data) {
+    char text[CALC_FIXED_MAX_CHARS + 1];
+    size_t total = 0;
+    for (size_t i = 0; i < data->count; i++) total += format_fixed(data->a[i], 4, text);
+    return (double)total;
+}
+
+// What format_fixed() replaces in batch mode, for comparison
+static double bench_snprintf_fixed(BenchData* data) {
+    char text[CALC_FIXED_MAX_CHARS + 1];
+    size_t total = 0;
+    for (size_t i = 0; i < data->count; i++) total += (size_t)snprintf(text, sizeof(text), "%.4lf", data->a[i]);
+    return (double)total;
+}
+
+static double bench_format_shortest(BenchData* data) {
+    char text[CALC_SHORTEST_MAX_CHARS + 1];
+    size_t total = 0;
+    for (size_t i = 0; i < data->count; i++) total += format_shortest(data->a[i], text);
+    return (double)total;
+}
+
+static double bench_parse_double(BenchData* data) {
+    double sum = 0, value;
+    for (size_t i = 0; i < data->count; i++) {
+        if (parse_double(data->strings[i], data->lengths[i], &value, NULL) == CALC_CONV_OK) sum += value;
+    }
+    return sum;
+}
+
+// What parse_double() replaces in batch mode, for comparison
+static double bench_strtod(BenchData* data) {
+    double sum = 0;
+    for (size_t i = 0; i < data->count; i++) sum += strtod(data->strings[i], NULL);
+    return sum;
+}
+
+/**
+ * @brief Converts every string of the operand set like the conversion menu does (including the
+ * allocation of the result text).
+ */
+static double bench_convert(BenchData* data, int from_base, int to_base) {
+    double sum = 0;
+    for (size_t i = 0; i < data->count; i++) {
+        char* text;
+        double value = 0;
+        if (calc_convert_base(data->strings[i], data->lengths[i], from_base, to_base, &text, &value, NULL) == CALC_OK) {
+            sum += value + (double)(unsigned char)text[0];
+            free(text);
+        }
+    }
+    return sum;
+}
+
+static double bench_bin_to_dec(BenchData* data) { return bench_convert(data, 2, 10); }
+static double bench_hex_to_dec(BenchData* data) { return bench_convert(data, 16, 10); }
+static double bench_bin_to_hex(BenchData* data) { return bench_convert(data, 2, 16); }
+static double bench_hex_to_bin(BenchData* data) { return bench_convert(data, 16, 2); }
+
+// Bulk forms, one call for the whole operand set
+static double bench_exp_n(BenchData* data) {
+    exp_n(data->a, data->out, data->count, CALC_MATH_ACCURATE);
+    return data->out[0];
+}
+
+static double bench_log_n(BenchData* data) {
+    log_n(data->a, data->out, data->count, CALC_MATH_ACCURATE, data->errors);
+    return data->out[0];
+}
+
+static double bench_pow_n(BenchData* data) {
+    pow_n(data->a, data->b, data->out, data->count, CALC_MATH_ACCURATE);
+    return data->out[0];
+}
+
+static double bench_sincos_n(BenchData* data) {
+    sincos_deg_n(data->a, data->out, data->cosine, data->count);
+    return data->out[0];
+}
+
+// The same number of angles as a table from a[0] in steps of 0.001 degrees
+static double bench_sincos_step_n(BenchData* data) {
+    sincos_deg_step_n(data->a[0], 0.001, 0, data->out, data->cosine, data->count);
+    return data->out[0];
+}
+
+static double bench_divide_n(BenchData* data) {
+    divide_n(data->a, data->b, data->out, data->count, data->errors);
+    return data->out[0];
+}
+
+static double bench_reduction(BenchData* data) {
+    CalcReduction r;
+    calc_reduction_init(&r);
+    calc_reduction_add_n(&r, data->a, data->count);
+    return calc_reduction_sum(&r) + calc_reduction_variance(&r, 1) + calc_reduction_product(&r);
+}
+
+// An uncompensated sum alone, for comparison
+static double bench_plain_sum(BenchData* data) {
+    double sum = 0;
+    for (size_t i = 0; i < data->count; i++) sum += data->a[i];
+    return sum;
+}
+
+// One product (or solve) per call; the time per "operand" is that of the whole operation
+static double bench_matrix_multiply(BenchData* data) {
+    CalcMatrix product;
+    double result = 0;
+    if (calc_matrix_multiply(&data->matrix_a, &data->matrix_b, &product) == CALC_OK && product.rows > 0) result = product.data[0];
+    calc_matrix_free(&product);
+    return result;
+}
+
+static double bench_matrix_solve(BenchData* data) {
+    CalcMatrix x;
+    double result = 0;
+    if (calc_matrix_solve(&data->matrix_a, &data->matrix_b, &x) == CALC_OK && x.rows > 0) result = x.data[0];
+    calc_matrix_free(&x);
+    return result;
+}
+
+static void bench_solver_function(void* context, const double* x, const double* p, double* y, size_t n) {
+    expr_eval_many((const CompiledExpr*)context, x, p, y, n);
+}
+
+// One integral of sin(R) - P over [0, 3333] per call (8 subintervals)
+static double bench_integrate(BenchData* data) {
+    CalcSolverOptions options;
+    CalcSolverResult result;
+    calc_solver_defaults(&options);
+    if (data->expr == NULL) return 0;
+    calc_integrate(bench_solver_function, data->expr, data->b[0], 0, 3333, &options, &result);
+    return result.value;
+}
+
+static double bench_find_roots(BenchData* data, CalcRootMethod method) {
+    CalcSolverOptions options;
+    calc_solver_defaults(&options);
+    options.method = method;
+    if (data->expr == NULL) return 0;
+    calc_find_roots(bench_solver_function, data->expr, data->b, data->a, data->cosine, data->count, &options, data->roots, data->root_statuses);
+    return data->roots[0].value;
+}
+
+static double bench_roots_brent(BenchData* data) { return bench_find_roots(data, CALC_ROOT_BRENT); }
+static double bench_roots_newton(BenchData* data) { return bench_find_roots(data, CALC_ROOT_NEWTON); }
+
+static double bench_parse_hex_n(BenchData* data) {
+    parse_hex_n((const char* const*)data->strings, (unsigned long long*)data->iout, data->count, NULL);
+    return (double)data->iout[0];
+}
+
+
+static const BenchCase bench_cases[] = {
+    { "add/uniform", fill_uniform, 1000, bench_add, 0 },
+    { "subtract/uniform", fill_uniform, 1000, bench_subtract, 0 },
+    { "multiply/uniform", fill_uniform, 1000, bench_multiply, 0 },
+    { "multiply/denormal", fill_denormal, 0, bench_multiply, 0 },
+    { "divide/uniform", fill_uniform, 1000, bench_divide, 0 },
+    { "divide/denormal", fill_denormal, 0, bench_divide, 0 },
+    { "remainder_op/int64", fill_int64, 0, bench_remainder, 0 },
+    { "remainder_op/40-bit-divisor", fill_modular, 40, bench_remainder_fixed, 0 },
+    { "remainder_invariant_n/40-bit", fill_modular, 40, bench_remainder_invariant_n, 0 },
+    { "exponential/uniform", fill_uniform, 700, bench_exp, 0 },
+    { "logarithm/positive", fill_positive, 60, bench_log, 0 },
+    { "logarithm/denormal", fill_denormal, 0, bench_log, 0 },
+    { "abs_square_root/uniform", fill_uniform, 1000, bench_abs, 0 },
+    { "power/positive", fill_positive, 20, bench_power, 0 },
+    { "power/denormal", fill_denormal, 0, bench_power, 0 },
+    { "factorial/0-170", fill_integers, 170, bench_factorial, 0 },
+    { "binomial/0-1000", fill_integers, 1000, bench_binomial, 0 },
+    { "factorial_exact/0-3000", fill_integers, 3000, bench_factorial_exact, 64 },
+    { "sine_deg/uniform", fill_uniform, 720, bench_sin, 0 },
+    { "sine_deg/huge", fill_uniform, 1000000000, bench_sin, 0 },
+    { "cosine_deg/uniform", fill_uniform, 720, bench_cos, 0 },
+    { "tangent_deg/uniform", fill_uniform, 720, bench_tan, 0 },
+    { "tangent_deg/asymptote", fill_asymptotes, 90, bench_tan, 0 },
+    { "cotangent_deg/uniform", fill_uniform, 720, bench_cot, 0 },
+    { "cotangent_deg/asymptote", fill_asymptotes, 0, bench_cot, 0 },
+    { "hypotenuse/uniform", fill_uniform, 1000, bench_hypot, 0 },
+    { "hypotenuse/denormal", fill_denormal, 0, bench_hypot, 0 },
+    { "dec_to_bin/int64", fill_int64, 0, bench_dec_to_bin, 0 },
+    { "dec_to_hex/int64", fill_int64, 0, bench_dec_to_hex, 0 },
+    { "format_fixed/uniform", fill_uniform, 1000000, bench_format_fixed, 0 },
+    { "snprintf_fixed/uniform", fill_uniform, 1000000, bench_snprintf_fixed, 0 },
+    { "format_shortest/uniform", fill_uniform, 1000000, bench_format_shortest, 0 },
+    { "parse_double/6-digit", fill_decimals, 6, bench_parse_double, 0 },
+    { "parse_double/17-digit", fill_decimals, 17, bench_parse_double, 0 },
+    { "strtod/17-digit", fill_decimals, 17, bench_strtod, 0 },
+    { "bin_to_dec/64-digit", fill_digits, 64, bench_bin_to_dec, 0 },
+    { "bin_to_dec/4096-digit", fill_digits, 4096, bench_bin_to_dec, 256 },
+    { "hex_to_dec/16-digit", fill_digits, -16, bench_hex_to_dec, 0 },
+    { "hex_to_dec/1024-digit", fill_digits, -1024, bench_hex_to_dec, 256 },
+    { "hex_to_bin/16-digit", fill_digits, -16, bench_hex_to_bin, 0 },
+    { "bin_to_hex/64-digit", fill_digits, 64, bench_bin_to_hex, 0 },
+    { "expression/hypot-sin-log", fill_expression, 0, bench_expression, 0 },
+    { "expression_jit/hypot-sin-log", fill_expression, 2, bench_expression, 0 },
+    { "expression/chain", fill_expression, 1, bench_expression, 0 },
+    { "expression_jit/chain", fill_expression, 3, bench_expression, 0 },
+    { "sheet_recompute/chain-1000", fill_sheet, 1000, bench_sheet, 16 },
+    { "snapshot_restore/chain-1000", fill_snapshot, 1000, bench_snapshot_restore, 16 },
+    { "exp_n/uniform", fill_uniform, 700, bench_exp_n, 0 },
+    { "log_n/positive", fill_positive, 60, bench_log_n, 0 },
+    { "pow_n/positive", fill_positive, 20, bench_pow_n, 0 },
+    { "sincos_deg_n/uniform", fill_uniform, 720, bench_sincos_n, 0 },
+    { "sincos_deg_step_n/0.001-deg", fill_uniform, 720, bench_sincos_step_n, 0 },
+    { "divide_n/uniform", fill_uniform, 1000, bench_divide_n, 0 },
+    { "parse_hex_n/16-digit", fill_digits, -16, bench_parse_hex_n, 0 },
+    { "reduction_add_n/uniform", fill_uniform, 1000, bench_reduction, 0 },
+    { "plain_sum/uniform", fill_uniform, 1000, bench_plain_sum, 0 },
+    { "matrix_multiply/64x64", fill_matrix, 64, bench_matrix_multiply, 1 },
+    { "matrix_multiply/512x512", fill_matrix, 512, bench_matrix_multiply, 1 },
+    { "matrix_solve/256x256", fill_matrix, 256, bench_matrix_solve, 1 },
+    { "integrate/sin-3333-deg", fill_solver, 0, bench_integrate, 1 },
+    { "roots_brent/sin", fill_solver, 0, bench_roots_brent, 1024 },
+    { "roots_newton/sin", fill_solver, 0, bench_roots_newton, 1024 },
+    { "precision_f32/sin-uniform", fill_precision, CALC_PRECISION_F32 * 4 + 0, bench_precision, 0 },
+    { "precision_f64/sin-uniform", fill_precision, CALC_PRECISION_F64 * 4 + 0, bench_precision, 0 },
+    { "precision_f80/sin-uniform", fill_precision, CALC_PRECISION_F80 * 4 + 0, bench_precision, 0 },
+    { "precision_f128/sin-uniform", fill_precision, CALC_PRECISION_F128 * 4 + 0, bench_precision, 0 },
+    { "precision_f32/pow-positive", fill_precision, CALC_PRECISION_F32 * 4 + 1, bench_precision, 0 },
+    { "precision_f64/pow-positive", fill_precision, CALC_PRECISION_F64 * 4 + 1, bench_precision, 0 },
+    { "precision_f80/pow-positive", fill_precision, CALC_PRECISION_F80 * 4 + 1, bench_precision, 0 },
+    { "precision_f128/pow-positive", fill_precision, CALC_PRECISION_F128 * 4 + 1, bench_precision, 0 },
+    { "precision_f32/annuity", fill_precision, CALC_PRECISION_F32 * 4 + 2, bench_precision, 0 },
+    { "precision_f64/annuity", fill_precision, CALC_PRECISION_F64 * 4 + 2, bench_precision, 0 },
+    { "precision_f80/annuity", fill_precision, CALC_PRECISION_F80 * 4 + 2, bench_precision, 0 },
+    { "precision_f128/annuity", fill_precision, CALC_PRECISION_F128 * 4 + 2, bench_precision, 0 },
+    { "mod_pow/63-bit", fill_modular, 63, bench_mod_pow, 1024 },
+    { "mod_pow_n/63-bit", fill_modular, 63, bench_mod_pow_n, 1024 },
+    { "is_prime/odd-63-bit", fill_modular, 63, bench_is_prime, 1024 }
+};
+
+
+// --- Timing, CPU pinning and hardware counters ---
+
+static double bench_now_ns(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Pins the calling thread to a CPU, so that it neither migrates nor changes caches.
+ * @param cpu The CPU, or -1 for the one the thread is running on.
+ * @return The CPU it is pinned to, or -1 if pinning failed or is not supported.
+ */
+static int bench_pin_cpu(int cpu) {
+#if defined(_WIN32)
+    if (cpu < 0) cpu = (int)GetCurrentProcessorNumber();
+    if (cpu >= (int)(8 * sizeof(DWORD_PTR))) return -1;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0 ? cpu : -1;
+#elif defined(__linux__)
+    cpu_set_t set;
+    if (cpu < 0) cpu = sched_getcpu();
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return -1;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0 ? cpu : -1;
+#else
+    (void)cpu;
+    return -1;
+#endif
+}
+
+// Hardware events counted per benchmark: cycles, instructions, branch misses, cache misses
+#define BENCH_EVENTS 4
+
+typedef struct {
+    int available;
+#if defined(__linux__)
+    int fds[BENCH_EVENTS]; // fds[0] leads the group
+#endif
+} BenchCounters;
+
+#if defined(__linux__)
+
+static void counters_open(BenchCounters* counters) {
+    static const unsigned long long events[BENCH_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES
+    };
+    counters->available = 1;
+    for (int i = 0; i < BENCH_EVENTS; i++) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = events[i];
+        attr.disabled = i == 0; // The group is started through its leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        // Fails in most containers and virtual machines, or with kernel.perf_event_paranoid > 2
+        counters->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : counters->fds[0], 0);
+        if (counters->fds[i] < 0) {
+            while (--i >= 0) close(counters->fds[i]);
+            counters->available = 0;
+            return;
+        }
+    }
+}
+
+static void counters_start(BenchCounters* counters) {
+    if (!counters->available) return;
+    ioctl(counters->fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(counters->fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+/**
+ * @brief Stops the counters and stores their values; returns 0 if they could not be read.
+ */
+static int counters_stop(BenchCounters* counters, double* values) {
+    uint64_t data[1 + BENCH_EVENTS]; // Number of events, then their values
+    if (!counters->available) return 0;
+    ioctl(counters->fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    if (read(counters->fds[0], data, sizeof(data)) != (ssize_t)sizeof(data) || data[0] != BENCH_EVENTS) return 0;
+    for (int i = 0; i < BENCH_EVENTS; i++) values[i] = (double)data[1 + i];
+    return 1;
+}
+
+static void counters_close(BenchCounters* counters) {
+    if (!counters->available) return;
+    for (int i = BENCH_EVENTS - 1; i >= 0; i--) close(counters->fds[i]);
+}
+
+#else
+
+static void counters_open(BenchCounters* counters) { counters->available = 0; }
+static void counters_start(BenchCounters* counters) { (void)counters; }
+static int counters_stop(BenchCounters* counters, double* values) { (void)counters; (void)values; return 0; }
+static void counters_close(BenchCounters* counters) { (void)counters; }
+
+#endif
+
+
+// --- Running ---
+
+typedef struct {
+    const char* filter;       // Only benchmarks whose name contains this text
+    const char* json_path;    // Where to write the results ("-" for stdout)
+    const char* compare_path; // Baseline to compare with
+    double threshold;         // Slowdown in percent reported as a regression
+    int cpu;                  // CPU to pin to, -1 for the current one, -2 for no pinning
+    double time_ms;           // Measured time per benchmark
+    double warmup_ms;
+    int list;                 // Only list the benchmark names
+} BenchOptions;
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void bench_run_case(const BenchCase* bench, BenchData* data, const BenchOptions* options,
+    BenchCounters* counters, BenchResult* result) {
+    double samples[BENCH_SAMPLES], events[BENCH_EVENTS];
+    double start, elapsed, sum = 0;
+    size_t calls = 0, sample_calls;
+
+    memset(result, 0, sizeof(*result));
+    snprintf(result->name, sizeof(result->name), "%s", bench->name);
+    data->count = bench->operands != 0 ? bench->operands : BENCH_OPERANDS;
+    data->expr = NULL;
+    data->sheet = NULL;
+    data->snapshot = NULL;
+    memset(&data->matrix_a, 0, sizeof(data->matrix_a));
+    memset(&data->matrix_b, 0, sizeof(data->matrix_b));
+    bench->fill(data, bench->param);
+
+    // Warmup (caches, branch predictors, CPU frequency), which also measures the cost of a call
+    start = bench_now_ns();
+    do {
+        sum += bench->kernel(data);
+        calls++;
+        elapsed = bench_now_ns() - start;
+    } while (elapsed < options->warmup_ms * 1e6);
+    sample_calls = (size_t)(options->time_ms * 1e6 / BENCH_SAMPLES / (elapsed / (double)calls));
+    if (sample_calls == 0) sample_calls = 1;
+
+    counters_start(counters);
+    for (int s = 0; s < BENCH_SAMPLES; s++) {
+        start = bench_now_ns();
+        for (size_t c = 0; c < sample_calls; c++) sum += bench->kernel(data);
+        samples[s] = (bench_now_ns() - start) / ((double)sample_calls * (double)data->count);
+    }
+    result->ops = (double)BENCH_SAMPLES * (double)sample_calls * (double)data->count;
+    if (counters_stop(counters, events)) {
+        result->counters = 1;
+        result->cycles = events[0] / result->ops;
+        result->instructions = events[1] / result->ops;
+        result->branch_misses = events[2] / result->ops;
+        result->cache_misses = events[3] / result->ops;
+    }
+    bench_sink = sum;
+
+    qsort(samples, BENCH_SAMPLES, sizeof(double), compare_doubles);
+    result->ns_per_op = samples[BENCH_SAMPLES / 2];
+    result->ns_min = samples[0];
+    result->ns_max = samples[BENCH_SAMPLES - 1];
+    if (bench->fill == fill_precision && data->expr != NULL && data->precision != CALC_PRECISION_F128) {
+        result->accuracy = 1;
+        result->max_rel_error = precision_error(data);
+    }
+
+    if (bench->fill == fill_digits || bench->fill == fill_decimals) {
+        for (size_t i = 0; i < data->count; i++) free(data->strings[i]);
+    }
+    if (data->expr != NULL) expr_free(data->expr);
+    calc_sheet_free(data->sheet);
+    free(data->snapshot);
+    calc_matrix_free(&data->matrix_a);
+    calc_matrix_free(&data->matrix_b);
+}
+
+static void print_counter(FILE* out, int valid, double value) {
+    if (valid) fprintf(out, "%.4g", value);
+    else fprintf(out, "null");
+}
+
+/**
+ * @brief Writes the results as JSON; returns 0 if the file cannot be written.
+ */
+static int write_bench_json(const char* path, const BenchResult* results, size_t count, int cpu, int counters) {
+    FILE* out = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (out == NULL) return 0;
+
+    fprintf(out, "{\n  \"version\": 1,\n  \"simd\": \"%s\",\n  \"cpu\": %d,\n", calc_simd_level_name(calc_simd_level()), cpu);
+    fprintf(out, "  \"operands\": %d,\n  \"samples\": %d,\n  \"counters\": %s,\n  \"results\": [\n",
+        BENCH_OPERANDS, BENCH_SAMPLES, counters ? "true" : "false");
+    for (size_t i = 0; i < count; i++) {
+        const BenchResult* r = &results[i];
+        fprintf(out, "    { \"name\": \"%s\", \"ns_per_op\": %.6g, \"ns_min\": %.6g, \"ns_max\": %.6g, \"ops_per_s\": %.6g, ",
+            r->name, r->ns_per_op, r->ns_min, r->ns_max, 1e9 / r->ns_per_op);
+        fprintf(out, "\"cycles_per_op\": ");
+        print_counter(out, r->counters, r->cycles);
+        fprintf(out, ", \"instructions_per_op\": ");
+        print_counter(out, r->counters, r->instructions);
+        fprintf(out, ", \"branch_misses_per_op\": ");
+        print_counter(out, r->counters, r->branch_misses);
+        fprintf(out, ", \"cache_misses_per_op\": ");
+        print_counter(out, r->counters, r->cache_misses);
+        fprintf(out, ", \"max_rel_error\": ");
+        print_counter(out, r->accuracy && isfinite(r->max_rel_error), r->max_rel_error);
+        fprintf(out, " }%s\n", i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    if (out == stdout) {
+        fflush(out);
+        return !ferror(out);
+    }
+    return fclose(out) == 0;
+}
+
+/**
+ * @brief Finds the ns_per_op of a benchmark in a JSON file written by write_bench_json().
+ * @return The value, or a negative number if the benchmark is not in the file.
+ */
+static double find_baseline(const char* json, const char* name) {
+    char key[BENCH_NAME_MAX + 16];
+    const char* entry;
+    const char* field;
+
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+    entry = strstr(json, key);
+    if (entry == NULL) return -1;
+    field = strstr(entry, "\"ns_per_op\":");
+    if (field == NULL) return -1;
+    return strtod(field + strlen("\"ns_per_op\":"), NULL);
+}
+
+/**
+ * @brief Reads a whole file into a '\0'-terminated string (release with free()), or returns NULL.
+ */
+static char* read_text_file(const char* path) {
+    FILE* in = fopen(path, "rb");
+    char* text = NULL;
+    size_t len = 0, capacity = 0, read;
+
+    if (in == NULL) return NULL;
+    do {
+        if (len + 4096 + 1 > capacity) {
+            char* grown;
+            capacity = capacity ? capacity * 2 : 65536;
+            grown = (char*)realloc(text, capacity);
+            if (grown == NULL) { free(text); fclose(in); return NULL; }
+            text = grown;
+        }
+        read = fread(text + len, 1, capacity - len - 1, in);
+        len += read;
+    } while (read > 0);
+    fclose(in);
+    text[len] = '\0';
+    return text;
+}
+
+/**
+ * @brief Prints every benchmark next to its baseline; a slowdown above the threshold is a regression.
+ * @return The number of regressions, or -1 if the baseline cannot be read.
+ */
+static int compare_with_baseline(FILE* report, const char* path, const BenchResult* results, size_t count, double threshold) {
+    char* json = read_text_file(path);
+    int regressions = 0;
+
+    if (json == NULL) return -1;
+    fprintf(report, "\n%-28s %12s %12s %9s\n", "Compared with baseline", "base ns/op", "ns/op", "change");
+    for (size_t i = 0; i < count; i++) {
+        double base = find_baseline(json, results[i].name);
+        if (base <= 0) {
+            fprintf(report, "%-28s %12s %12.3f %9s\n", results[i].name, "-", results[i].ns_per_op, "new");
+        }
+        else {
+            double change = (results[i].ns_per_op / base - 1) * 100;
+            const char* verdict = change > threshold ? "  REGRESSION" : change < -threshold ? "  improved" : "";
+            if (change > threshold) regressions++;
+            fprintf(report, "%-28s %12.3f %12.3f %+8.1f%%%s\n", results[i].name, base, results[i].ns_per_op, change, verdict);
+        }
+    }
+    free(json);
+    fprintf(report, "%d regression(s) over %.1f%%.\n", regressions, threshold);
+    return regressions;
+}
+
+static void print_bench_usage(void) {
+    printf("Usage: --bench [--list] [--filter TEXT] [--json FILE|-] [--compare FILE] [--threshold PERCENT]\n");
+    printf("               [--cpu N|none] [--time MS] [--warmup MS]\n");
+}
+
+/**
+ * @brief Parses the options after "--bench"; returns 0 (after printing the usage) if one is invalid.
+ */
+static int parse_bench_options(int argc, char* argv[], BenchOptions* options) {
+    options->filter = NULL;
+    options->json_path = NULL;
+    options->compare_path = NULL;
+    options->threshold = 5.0;
+    options->cpu = -1;
+    options->time_ms = 200.0;
+    options->warmup_ms = 50.0;
+    options->list = 0;
+
+    for (int i = 0; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--list") == 0) { options->list = 1; continue; }
+        if (value == NULL) { print_bench_usage(); return 0; }
+        if (strcmp(argv[i], "--filter") == 0) options->filter = value;
+        else if (strcmp(argv[i], "--json") == 0) options->json_path = value;
+        else if (strcmp(argv[i], "--compare") == 0) options->compare_path = value;
+        else if (strcmp(argv[i], "--threshold") == 0) options->threshold = atof(value);
+        else if (strcmp(argv[i], "--cpu") == 0) options->cpu = strcmp(value, "none") == 0 ? -2 : atoi(value);
+        else if (strcmp(argv[i], "--time") == 0) options->time_ms = atof(value);
+        else if (strcmp(argv[i], "--warmup") == 0) options->warmup_ms = atof(value);
+        else { print_bench_usage(); return 0; }
+        i++;
+    }
+    if (options->time_ms <= 0) options->time_ms = 1;
+    if (options->warmup_ms <= 0) options->warmup_ms = 1;
+    return 1;
+}
+
+int run_bench(int argc, char* argv[]) {
+    const size_t case_count = sizeof(bench_cases) / sizeof(bench_cases[0]);
+    BenchOptions options;
+    BenchCounters counters;
+    BenchResult* results;
+    BenchData* data;
+    size_t count = 0;
+    int cpu = -1, status = 0;
+    FILE* report; // The table goes to stdout, unless the JSON does
+
+    if (!parse_bench_options(argc, argv, &options)) return 1;
+    if (options.list) {
+        for (size_t i = 0; i < case_count; i++) printf("%s\n", bench_cases[i].name);
+        return 0;
+    }
+    report = options.json_path != NULL && strcmp(options.json_path, "-") == 0 ? stderr : stdout;
+
+    results = (BenchResult*)malloc(case_count * sizeof(BenchResult));
+    data = (BenchData*)calloc(1, sizeof(BenchData));
+    if (results == NULL || data == NULL) {
+        free(results);
+        free(data);
+        fprintf(stderr, "Error: Out of memory.\n");
+        return 1;
+    }
+
+    if (options.cpu != -2) cpu = bench_pin_cpu(options.cpu);
+    counters_open(&counters);
+    fprintf(report, "SIMD level: %s, CPU: %d%s, hardware counters: %s\n", calc_simd_level_name(calc_simd_level()), cpu,
+        cpu < 0 ? " (not pinned)" : "", counters.available ? "yes" : "no");
+    fprintf(report, "%-28s %10s %10s %10s %14s %10s %10s %10s\n", "Benchmark", "ns/op", "min", "max", "ops/s", "cycles/op",
+        "instr/op", "rel error");
+
+    for (size_t i = 0; i < case_count; i++) {
+        BenchResult* r;
+        if (options.filter != NULL && strstr(bench_cases[i].name, options.filter) == NULL) continue;
+        r = &results[count++];
+        bench_run_case(&bench_cases[i], data, &options, &counters, r);
+        fprintf(report, "%-28s %10.3f %10.3f %10.3f %14.0f", r->name, r->ns_per_op, r->ns_min, r->ns_max, 1e9 / r->ns_per_op);
+        if (r->counters) fprintf(report, " %10.2f %10.2f", r->cycles, r->instructions);
+        else fprintf(report, " %10s %10s", "-", "-");
+        if (r->accuracy) fprintf(report, " %10.2e\n", r->max_rel_error);
+        else fprintf(report, " %10s\n", "-");
+        fflush(report);
+    }
+    counters_close(&counters);
+
+    if (options.json_path != NULL && !write_bench_json(options.json_path, results, count, cpu, counters.available)) {
+        fprintf(stderr, "Error: Cannot write '%s'.\n", options.json_path);
+        status = 1;
+    }
+    if (options.compare_path != NULL) {
+        int regressions = compare_with_baseline(report, options.compare_path, results, count, options.threshold);
+        if (regressions < 0) fprintf(stderr, "Error: Cannot read '%s'.\n", options.compare_path);
+        if (regressions != 0) status = 1;
+    }
+    free(results);
+    free(data);
+    return status;
+}
+
+#if defined(CALC_BENCH_MAIN)
+
+int main(int argc, char* argv[]) {
+    return run_bench(argc - 1, argv + 1);
+}
+
+#endif
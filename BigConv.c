@@ -0,0 +1,393 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "BaseConv.h"
+#include "BigInt.h"
+
+/*
+ * Arbitrary-length radix conversion. Binary and hexadecimal are both powers of two, so they map
+ * onto radix-2^32 limbs digit group by digit group in linear time. Decimal uses divide and conquer:
+ *
+ *   decimal -> limbs: split the k low digits off, value = from_dec(high) * 10^k + from_dec(low)
+ *   limbs -> decimal: split the 2^j low limbs off, value = to_dec(high) * 2^(32 * 2^j) + to_dec(low)
+ *
+ * where k = 9 * 2^j, so each level needs one power of the other radix, computed by squaring the
+ * previous one and cached for the whole conversion. With Karatsuba multiplication (BigInt.c) the
+ * conversion costs O(M(n)) per level instead of the O(n^2) of digit-by-digit conversion.
+ */
+
+#define DECIMAL_BASE 1000000000u
+#define DECIMAL_LIMB_DIGITS 9
+
+// Below these sizes the quadratic method is faster than splitting further
+#define FROM_DEC_LEAF_DIGITS (DECIMAL_LIMB_DIGITS * 64)
+#define TO_DEC_LEAF_LIMBS 64
+
+#define POWER_LEVELS 64
+
+// Size of the chunks handed to the writer of bigint_write_dec()
+#define WRITE_CHUNK_CHARS 65536
+
+typedef struct {
+    uint32_t* limbs[POWER_LEVELS];
+    size_t size[POWER_LEVELS];
+} PowerCache;
+
+static void free_power_cache(PowerCache* cache) {
+    for (int j = 0; j < POWER_LEVELS; j++) free(cache->limbs[j]);
+}
+
+/**
+ * @brief Returns level j of a cache of squares: level 0 is the given seed, level j + 1 is level j squared.
+ * @param radix_bin 1 to square in radix 2^32, 0 for radix 10^9.
+ */
+static const uint32_t* cached_power(PowerCache* cache, int j, const uint32_t* seed, size_t seed_size, int radix_bin, size_t* size) {
+    if (cache->limbs[j] == NULL) {
+        const uint32_t* previous;
+        size_t previous_size, n;
+        uint32_t* square;
+        int ok;
+
+        if (j == 0) {
+            square = (uint32_t*)malloc(seed_size * sizeof(uint32_t));
+            if (square == NULL) return NULL;
+            memcpy(square, seed, seed_size * sizeof(uint32_t));
+            cache->limbs[0] = square;
+            cache->size[0] = seed_size;
+        }
+        else {
+            previous = cached_power(cache, j - 1, seed, seed_size, radix_bin, &previous_size);
+            if (previous == NULL) return NULL;
+            n = 2 * previous_size;
+            square = (uint32_t*)malloc(n * sizeof(uint32_t));
+            if (square == NULL) return NULL;
+            ok = radix_bin ? bigint_mul_bin(square, previous, previous_size, previous, previous_size)
+                           : bigint_mul_dec(square, previous, previous_size, previous, previous_size);
+            if (!ok) { free(square); return NULL; }
+            cache->limbs[j] = square;
+            cache->size[j] = bigint_trim(square, n);
+        }
+    }
+    *size = cache->size[j];
+    return cache->limbs[j];
+}
+
+/**
+ * @brief Converts nd decimal digits to radix-2^32 limbs (allocated, *n receives the trimmed size).
+ */
+static uint32_t* from_dec(PowerCache* cache, const char* digits, size_t nd, size_t* n) {
+    static const uint32_t seed[1] = { DECIMAL_BASE }; // 10^9
+    uint32_t *high, *low, *result;
+    const uint32_t* power;
+    size_t hn, ln, pn, k;
+    int j = 0;
+
+    if (nd <= FROM_DEC_LEAF_DIGITS) {
+        size_t size = 0, i = 0, chunk = nd % DECIMAL_LIMB_DIGITS ? nd % DECIMAL_LIMB_DIGITS : DECIMAL_LIMB_DIGITS;
+        result = (uint32_t*)malloc((nd / DECIMAL_LIMB_DIGITS + 2) * sizeof(uint32_t));
+        if (result == NULL) return NULL;
+        while (i < nd) {
+            uint32_t group = 0, scale = 1;
+            for (size_t end = i + chunk; i < end; i++) {
+                group = group * 10 + (uint32_t)(digits[i] - '0');
+                scale *= 10;
+            }
+            bigint_mul_1_bin(result, result, size, scale, group);
+            size = bigint_trim(result, size + 1);
+            chunk = DECIMAL_LIMB_DIGITS;
+        }
+        *n = size;
+        return result;
+    }
+
+    while ((size_t)DECIMAL_LIMB_DIGITS << (j + 1) < nd) j++;
+    k = (size_t)DECIMAL_LIMB_DIGITS << j; // nd / 2 <= k < nd
+
+    power = cached_power(cache, j, seed, 1, 1, &pn);
+    if (power == NULL) return NULL;
+    high = from_dec(cache, digits, nd - k, &hn);
+    if (high == NULL) return NULL;
+    low = from_dec(cache, digits + nd - k, k, &ln);
+    result = low != NULL ? (uint32_t*)malloc((hn + pn) * sizeof(uint32_t)) : NULL;
+    if (result != NULL && bigint_mul_bin(result, high, hn, power, pn)) {
+        bigint_add_bin(result, result, hn + pn, low, ln); // low < 10^k, so there is no carry out
+        *n = bigint_trim(result, hn + pn);
+    }
+    else {
+        free(result);
+        result = NULL;
+    }
+    free(high);
+    free(low);
+    return result;
+}
+
+/**
+ * @brief Converts n radix-2^32 limbs to radix-10^9 limbs (allocated, *dn receives the trimmed size).
+ */
+static uint32_t* to_dec(PowerCache* cache, const uint32_t* limbs, size_t n, size_t* dn) {
+    static const uint32_t seed[2] = { 294967296u, 4u }; // 2^32 in radix 10^9
+    uint32_t *high, *low, *result;
+    const uint32_t* power;
+    size_t hn, ln, pn, split;
+    int j = 0;
+
+    n = bigint_trim(limbs, n);
+    if (n <= TO_DEC_LEAF_LIMBS) {
+        // Repeated division by 10^9; 32 * log10(2) / 9 < 1 + 1/8 decimal limbs per binary limb
+        uint32_t* quotient = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+        size_t size = 0;
+        result = (uint32_t*)malloc((n + n / 8 + 2) * sizeof(uint32_t));
+        if (quotient == NULL || result == NULL) { free(quotient); free(result); return NULL; }
+        memcpy(quotient, limbs, n * sizeof(uint32_t));
+        while (n > 0) {
+            result[size++] = bigint_divmod_1_bin(quotient, quotient, n, DECIMAL_BASE);
+            n = bigint_trim(quotient, n);
+        }
+        free(quotient);
+        *dn = size;
+        return result;
+    }
+
+    while ((size_t)1 << (j + 1) < n) j++;
+    split = (size_t)1 << j; // n / 2 <= split < n
+
+    power = cached_power(cache, j, seed, 2, 0, &pn);
+    if (power == NULL) return NULL;
+    high = to_dec(cache, limbs + split, n - split, &hn);
+    if (high == NULL) return NULL;
+    low = to_dec(cache, limbs, split, &ln);
+    result = low != NULL ? (uint32_t*)malloc((hn + pn) * sizeof(uint32_t)) : NULL;
+    if (result != NULL && bigint_mul_dec(result, high, hn, power, pn)) {
+        bigint_add_dec(result, result, hn + pn, low, ln); // low < 2^(32 * split), so there is no carry out
+        *dn = bigint_trim(result, hn + pn);
+    }
+    else {
+        free(result);
+        result = NULL;
+    }
+    free(high);
+    free(low);
+    return result;
+}
+
+
+// --- Digit strings ---
+
+static int digit_value(unsigned char c, int base) {
+    int value;
+    if ((unsigned)(c - '0') < 10) value = c - '0';
+    else if ((unsigned)((c | 0x20) - 'a') < 6) value = (c | 0x20) - 'a' + 10;
+    else return -1;
+    return value < base ? value : -1;
+}
+
+/**
+ * @brief Validates the digits of str (after an optional 0b/0x prefix for bases 2 and 16) and skips
+ * the leading zeros. *start receives the offset of the first significant digit (len for zero).
+ */
+static CalcConvStatus scan_digits(const char* str, size_t len, int base, size_t* start, size_t* error_offset) {
+    char prefix = base == 2 ? 'b' : base == 16 ? 'x' : '\0';
+    size_t i = 0;
+
+    if (prefix != '\0' && len >= 2 && str[0] == '0' && (str[1] | 0x20) == prefix) i = 2;
+    if (i == len) {
+        if (error_offset != NULL) *error_offset = i;
+        return CALC_CONV_EMPTY;
+    }
+    for (size_t j = i; j < len; j++) {
+        if (digit_value((unsigned char)str[j], base) < 0) {
+            if (error_offset != NULL) *error_offset = j;
+            return CALC_CONV_INVALID_DIGIT;
+        }
+    }
+    while (i < len && str[i] == '0') i++;
+    *start = i;
+    return CALC_CONV_OK;
+}
+
+/**
+ * @brief Packs nd binary (bits == 1) or hexadecimal (bits == 4) digits into radix-2^32 limbs.
+ */
+static uint32_t* pow2_digits_to_limbs(const char* digits, size_t nd, int bits, size_t* n) {
+    size_t size = (nd * bits + 31) / 32;
+    uint32_t* limbs = (uint32_t*)calloc(size + 1, sizeof(uint32_t));
+    if (limbs == NULL) return NULL;
+    for (size_t i = 0; i < nd; i++) {
+        size_t bit = (nd - 1 - i) * bits; // Position of the digit's lowest bit
+        limbs[bit / 32] |= (uint32_t)digit_value((unsigned char)digits[i], 1 << bits) << (bit % 32);
+    }
+    *n = bigint_trim(limbs, size);
+    return limbs;
+}
+
+/**
+ * @brief Writes n radix-2^32 limbs as binary (bits == 1) or hexadecimal (bits == 4) digits.
+ */
+static char* limbs_to_pow2_string(const uint32_t* limbs, size_t n, int bits, size_t* len) {
+    size_t nd = 1, total_bits;
+    char* text;
+
+    n = bigint_trim(limbs, n);
+    if (n > 0) {
+        uint32_t top = limbs[n - 1];
+        total_bits = (n - 1) * 32;
+        while (top) { total_bits++; top >>= 1; }
+        nd = (total_bits + bits - 1) / bits;
+    }
+    text = (char*)malloc(nd + 1);
+    if (text == NULL) return NULL;
+    for (size_t i = 0; i < nd; i++) {
+        size_t bit = (nd - 1 - i) * bits;
+        // A hexadecimal digit never straddles two limbs since 32 is a multiple of 4
+        unsigned value = n > 0 ? (limbs[bit / 32] >> (bit % 32)) & ((1u << bits) - 1) : 0;
+        text[i] = "0123456789ABCDEF"[value];
+    }
+    text[nd] = '\0';
+    *len = nd;
+    return text;
+}
+
+/**
+ * @brief Writes radix-10^9 limbs as decimal digits.
+ */
+static char* dec_limbs_to_string(const uint32_t* limbs, size_t n, size_t* len) {
+    char* text = (char*)malloc(n * DECIMAL_LIMB_DIGITS + 2);
+    char* p = text;
+    if (text == NULL) return NULL;
+    if (n == 0) {
+        *p++ = '0';
+    }
+    else {
+        char top[DECIMAL_LIMB_DIGITS + 1];
+        int count = 0;
+        for (uint32_t value = limbs[n - 1]; value > 0; value /= 10) top[count++] = (char)('0' + value % 10);
+        while (count > 0) *p++ = top[--count];
+        for (size_t i = n - 1; i-- > 0;) {
+            uint32_t value = limbs[i];
+            for (int d = DECIMAL_LIMB_DIGITS - 1; d >= 0; d--, value /= 10) p[d] = (char)('0' + value % 10);
+            p += DECIMAL_LIMB_DIGITS;
+        }
+    }
+    *p = '\0';
+    *len = (size_t)(p - text);
+    return text;
+}
+
+/**
+ * @brief Parses a digit string of any supported base into radix-2^32 limbs.
+ */
+static CalcConvStatus parse_big(const char* str, size_t len, int base, uint32_t** limbs, size_t* n, size_t* error_offset) {
+    size_t start;
+    CalcConvStatus status = scan_digits(str, len, base, &start, error_offset);
+    if (status != CALC_CONV_OK) return status;
+
+    if (base == 10) {
+        PowerCache cache;
+        memset(&cache, 0, sizeof(cache));
+        *limbs = len > start ? from_dec(&cache, str + start, len - start, n) : (uint32_t*)calloc(1, sizeof(uint32_t));
+        if (len == start) *n = 0;
+        free_power_cache(&cache);
+    }
+    else {
+        *limbs = pow2_digits_to_limbs(str + start, len - start, base == 2 ? 1 : 4, n);
+    }
+    return *limbs != NULL ? CALC_CONV_OK : CALC_CONV_NO_MEMORY;
+}
+
+/**
+ * @brief Writes radix-2^32 limbs as a digit string of any supported base.
+ */
+static char* format_big(const uint32_t* limbs, size_t n, int base, size_t* len) {
+    char* text;
+    if (base == 10) {
+        PowerCache cache;
+        size_t dn;
+        uint32_t* dec;
+        memset(&cache, 0, sizeof(cache));
+        dec = to_dec(&cache, limbs, n, &dn);
+        free_power_cache(&cache);
+        if (dec == NULL) return NULL;
+        text = dec_limbs_to_string(dec, dn, len);
+        free(dec);
+        return text;
+    }
+    return limbs_to_pow2_string(limbs, n, base == 2 ? 1 : 4, len);
+}
+
+/**
+ * @brief Shared implementation of the *_big conversions.
+ */
+static CalcConvStatus convert_big(const char* str, size_t len, int from_base, int to_base,
+    char** result, size_t* result_len, size_t* error_offset) {
+    uint32_t* limbs = NULL;
+    size_t n = 0, text_len = 0;
+    CalcConvStatus status;
+
+    *result = NULL;
+    status = parse_big(str, len, from_base, &limbs, &n, error_offset);
+    if (status != CALC_CONV_OK) return status;
+    *result = format_big(limbs, n, to_base, &text_len);
+    free(limbs);
+    if (*result == NULL) return CALC_CONV_NO_MEMORY;
+    if (result_len != NULL) *result_len = text_len;
+    return CALC_CONV_OK;
+}
+
+CalcConvStatus hex_to_bin_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset) {
+    return convert_big(str, len, 16, 2, result, result_len, error_offset);
+}
+
+CalcConvStatus bin_to_hex_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset) {
+    return convert_big(str, len, 2, 16, result, result_len, error_offset);
+}
+
+CalcConvStatus dec_to_bin_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset) {
+    return convert_big(str, len, 10, 2, result, result_len, error_offset);
+}
+
+CalcConvStatus bin_to_dec_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset) {
+    return convert_big(str, len, 2, 10, result, result_len, error_offset);
+}
+
+CalcConvStatus dec_to_hex_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset) {
+    return convert_big(str, len, 10, 16, result, result_len, error_offset);
+}
+
+CalcConvStatus hex_to_dec_big(const char* str, size_t len, char** result, size_t* result_len, size_t* error_offset) {
+    return convert_big(str, len, 16, 10, result, result_len, error_offset);
+}
+
+int bigint_write_dec(const uint32_t* a, size_t n, BigIntWriter write, void* context) {
+    PowerCache cache;
+    char chunk[WRITE_CHUNK_CHARS];
+    size_t dn, used = 0, i;
+    uint32_t* dec;
+    int ok = 1;
+
+    memset(&cache, 0, sizeof(cache));
+    dec = to_dec(&cache, a, n, &dn);
+    free_power_cache(&cache);
+    if (dec == NULL) return 0;
+    if (dn == 0) {
+        free(dec);
+        return write(context, "0", 1);
+    }
+
+    // The top limb without leading zeros, then every other limb as exactly nine digits
+    for (uint32_t value = dec[dn - 1]; value > 0; value /= 10) chunk[used++] = (char)('0' + value % 10);
+    for (size_t l = 0, r = used - 1; l < r; l++, r--) {
+        char t = chunk[l]; chunk[l] = chunk[r]; chunk[r] = t;
+    }
+    for (i = dn - 1; i-- > 0 && ok;) {
+        uint32_t value = dec[i];
+        if (used + DECIMAL_LIMB_DIGITS > sizeof(chunk)) {
+            ok = write(context, chunk, used);
+            used = 0;
+        }
+        for (int d = DECIMAL_LIMB_DIGITS - 1; d >= 0; d--, value /= 10) chunk[used + d] = (char)('0' + value % 10);
+        used += DECIMAL_LIMB_DIGITS;
+    }
+    if (ok && used > 0) ok = write(context, chunk, used);
+    free(dec);
+    return ok;
+}
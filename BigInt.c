@@ -0,0 +1,353 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "BigInt.h"
+#include "Thread.h"
+
+// Below this many limbs in the shorter operand, schoolbook multiplication is faster than Karatsuba
+#define BIGINT_KARATSUBA_THRESHOLD 32
+// From this many limbs in the shorter operand on, the NTT is faster than Karatsuba
+#define BIGINT_NTT_THRESHOLD 4096
+// From this transform length on, the three primes are transformed in parallel threads
+#define BIGINT_NTT_PARALLEL_SIZE (1 << 16)
+
+#define DECIMAL_BASE 1000000000u
+
+
+// --- Number-theoretic transform ---
+
+/*
+ * Large products are computed as convolutions modulo three NTT-friendly primes below 2^30 and
+ * recombined by the Chinese remainder theorem. Their product exceeds 2^86, which bounds every
+ * convolution coefficient as long as the transform has at most 2^23 points: radix-10^9 limbs are
+ * used as coefficients directly (2^23 * 10^18 < 2^86), radix-2^32 limbs are split into 16-bit halves.
+ * Residues are multiplied in Montgomery form, so the transforms need no division.
+ */
+
+typedef struct {
+    uint32_t p;       // c * 2^k + 1
+    uint32_t root;    // Primitive root modulo p
+    int max_log;      // k: the largest transform has 2^k points
+} NttPrime;
+
+static const NttPrime ntt_primes[3] = {
+    { 998244353u, 3, 23 }, // 119 * 2^23 + 1
+    { 167772161u, 3, 25 }, // 5 * 2^25 + 1
+    { 469762049u, 3, 26 }  // 7 * 2^26 + 1
+};
+
+#define NTT_MAX_LOG 23
+
+typedef struct {
+    uint32_t p;
+    uint32_t p_neg_inv; // -p^-1 mod 2^32
+    uint32_t r2;        // 2^64 mod p
+} Montgomery;
+
+static uint32_t pow_mod(uint32_t base, uint64_t e, uint32_t p) {
+    uint64_t result = 1, b = base % p;
+    for (; e > 0; e >>= 1) {
+        if (e & 1) result = result * b % p;
+        b = b * b % p;
+    }
+    return (uint32_t)result;
+}
+
+static void montgomery_init(Montgomery* m, uint32_t p) {
+    uint32_t inv = p; // Newton's iteration doubles the correct low bits: 3, 6, 12, 24, 48
+    for (int i = 0; i < 4; i++) inv *= 2 - p * inv;
+    m->p = p;
+    m->p_neg_inv = 0u - inv;
+    m->r2 = (uint32_t)(((uint64_t)-1 % p + 1) % p);
+}
+
+// a * b * 2^-32 mod p for a, b < p
+static uint32_t mont_mul(const Montgomery* m, uint32_t a, uint32_t b) {
+    uint64_t t = (uint64_t)a * b;
+    uint32_t q = (uint32_t)t * m->p_neg_inv;
+    uint32_t u = (uint32_t)((t + (uint64_t)q * m->p) >> 32);
+    return u >= m->p ? u - m->p : u;
+}
+
+static uint32_t add_mod(uint32_t a, uint32_t b, uint32_t p) {
+    uint32_t s = a + b; // < 2^31
+    return s >= p ? s - p : s;
+}
+
+static uint32_t sub_mod(uint32_t a, uint32_t b, uint32_t p) {
+    return a >= b ? a - b : a + p - b;
+}
+
+/**
+ * @brief Fills tw[len + j] = w^j (Montgomery form) for every len = 1, 2, ..., n / 2, where w is a
+ * primitive (2 * len)-th root of unity.
+ */
+static void ntt_twiddles(const Montgomery* m, uint32_t root, uint32_t* tw, size_t n) {
+    for (size_t len = 1; len < n; len <<= 1) {
+        uint32_t w = mont_mul(m, pow_mod(root, (m->p - 1) / (2 * len), m->p), m->r2);
+        tw[len] = mont_mul(m, 1, m->r2);
+        for (size_t j = 1; j < len; j++) tw[len + j] = mont_mul(m, tw[len + j - 1], w);
+    }
+}
+
+// Decimation in frequency: natural order in, bit-reversed order out
+static void ntt_forward(const Montgomery* m, uint32_t* a, size_t n, const uint32_t* tw) {
+    uint32_t p = m->p;
+    for (size_t len = n >> 1; len >= 1; len >>= 1) {
+        for (size_t i = 0; i < n; i += 2 * len) {
+            for (size_t j = 0; j < len; j++) {
+                uint32_t u = a[i + j], v = a[i + j + len];
+                a[i + j] = add_mod(u, v, p);
+                a[i + j + len] = mont_mul(m, sub_mod(u, v, p), tw[len + j]);
+            }
+        }
+    }
+}
+
+// Decimation in time with the inverse roots w^-j = -w^(len - j): bit-reversed order in, natural order out
+static void ntt_inverse(const Montgomery* m, uint32_t* a, size_t n, const uint32_t* tw) {
+    uint32_t p = m->p;
+    for (size_t len = 1; len < n; len <<= 1) {
+        for (size_t i = 0; i < n; i += 2 * len) {
+            for (size_t j = 0; j < len; j++) {
+                uint32_t w = j == 0 ? tw[len] : p - tw[2 * len - j];
+                uint32_t u = a[i + j], v = mont_mul(m, a[i + j + len], w);
+                a[i + j] = add_mod(u, v, p);
+                a[i + j + len] = sub_mod(u, v, p);
+            }
+        }
+    }
+}
+
+typedef struct {
+    const NttPrime* prime;
+    const uint32_t* a;
+    const uint32_t* b;
+    size_t an, bn;
+    int split;         // 1: radix-2^32 limbs are split into 16-bit coefficients
+    size_t n;          // Transform length
+    uint32_t* result;  // n residues of the convolution
+    int ok;
+} NttJob;
+
+static void ntt_load(uint32_t* f, const uint32_t* a, size_t an, int split, uint32_t p, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < an; i++) {
+        if (split) {
+            f[count++] = a[i] & 0xFFFF;
+            f[count++] = a[i] >> 16;
+        }
+        else {
+            f[count++] = a[i] % p;
+        }
+    }
+    memset(f + count, 0, (n - count) * sizeof(uint32_t));
+}
+
+/**
+ * @brief Computes the cyclic convolution of one job modulo its prime.
+ */
+static void ntt_run(void* arg) {
+    NttJob* job = (NttJob*)arg;
+    Montgomery m;
+    size_t n = job->n;
+    int square = job->a == job->b && job->an == job->bn;
+    uint32_t* tw = (uint32_t*)malloc(n * sizeof(uint32_t));
+    uint32_t* fb = square ? NULL : (uint32_t*)malloc(n * sizeof(uint32_t));
+    uint32_t* fa = job->result;
+    uint32_t scale;
+
+    job->ok = tw != NULL && (square || fb != NULL);
+    if (!job->ok) { free(tw); free(fb); return; }
+
+    montgomery_init(&m, job->prime->p);
+    ntt_twiddles(&m, job->prime->root, tw, n);
+    ntt_load(fa, job->a, job->an, job->split, m.p, n);
+    ntt_forward(&m, fa, n, tw);
+    if (square) {
+        for (size_t i = 0; i < n; i++) fa[i] = mont_mul(&m, fa[i], fa[i]);
+    }
+    else {
+        ntt_load(fb, job->b, job->bn, job->split, m.p, n);
+        ntt_forward(&m, fb, n, tw);
+        for (size_t i = 0; i < n; i++) fa[i] = mont_mul(&m, fa[i], fb[i]);
+    }
+    ntt_inverse(&m, fa, n, tw);
+
+    // The pointwise products carry a factor 2^-32 and the inverse transform a factor n:
+    // multiplying by n^-1 * 2^64 in Montgomery form leaves the plain convolution
+    scale = mont_mul(&m, mont_mul(&m, pow_mod((uint32_t)(n % m.p), m.p - 2, m.p), m.r2), m.r2);
+    for (size_t i = 0; i < n; i++) fa[i] = mont_mul(&m, fa[i], scale);
+
+    free(tw);
+    free(fb);
+}
+
+/**
+ * @brief Returns 1 if a product of limbs limbs fits in the largest transform.
+ */
+static int ntt_fits(size_t limbs, int split) {
+    return (split ? 2 * limbs : limbs) <= ((size_t)1 << NTT_MAX_LOG);
+}
+
+/**
+ * @brief r[0..an+bn) = a * b through three NTTs in radix 2^32 (split == 1) or 10^9 (split == 0).
+ * @return 1 on success, 0 if memory ran out.
+ */
+static int ntt_mul(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn, int split) {
+    size_t coefficients = split ? 2 * (an + bn) : an + bn;
+    size_t n = 1;
+    uint32_t* residues;
+    NttJob jobs[3];
+    CalcThread* threads[3] = { NULL, NULL, NULL };
+    int parallel, ok = 1;
+
+    while (n < coefficients) n <<= 1;
+    residues = (uint32_t*)malloc(3 * n * sizeof(uint32_t));
+    if (residues == NULL) return 0;
+
+    parallel = n >= BIGINT_NTT_PARALLEL_SIZE && calc_thread_count() > 1;
+    for (int k = 0; k < 3; k++) {
+        jobs[k].prime = &ntt_primes[k];
+        jobs[k].a = a;
+        jobs[k].an = an;
+        jobs[k].b = b;
+        jobs[k].bn = bn;
+        jobs[k].split = split;
+        jobs[k].n = n;
+        jobs[k].result = residues + k * n;
+        if (parallel && k > 0) threads[k] = calc_thread_start(ntt_run, &jobs[k]);
+        if (threads[k] == NULL && k > 0) ntt_run(&jobs[k]);
+    }
+    ntt_run(&jobs[0]);
+    for (int k = 0; k < 3; k++) {
+        calc_thread_join(threads[k]);
+        ok &= jobs[k].ok;
+    }
+
+    if (ok) {
+        // Garner's form of the CRT: x = x0 + p0 * (x1 + p1 * x2), then carry propagation in the limb radix
+        uint32_t p0 = ntt_primes[0].p, p1 = ntt_primes[1].p, p2 = ntt_primes[2].p;
+        uint64_t inv_p0 = pow_mod(p0, p1 - 2, p1);
+        uint64_t inv_p0p1 = pow_mod((uint32_t)((uint64_t)p0 * p1 % p2), p2 - 2, p2);
+        uint64_t carry_hi = 0; // The carry is carry_hi * 2^32 + carry_lo
+        uint32_t carry_lo = 0;
+
+        for (size_t i = 0; i < coefficients; i++) {
+            uint64_t x0 = residues[i], x1, x2, t, lo, hi, s;
+            uint32_t digit;
+            x1 = (residues[n + i] + p1 - x0 % p1) % p1 * inv_p0 % p1;
+            x2 = (residues[2 * n + i] + 2 * (uint64_t)p2 - x0 % p2 - p0 * x1 % p2) % p2 * inv_p0p1 % p2;
+            t = x1 + p1 * x2;
+            lo = (t & 0xFFFFFFFFu) * p0 + x0;
+            hi = (t >> 32) * p0 + (lo >> 32);
+
+            s = (uint64_t)carry_lo + (uint32_t)lo;
+            hi += carry_hi + (s >> 32);
+            lo = (uint32_t)s;
+            if (split) {
+                digit = (uint32_t)(lo & 0xFFFF);
+                carry_lo = (uint32_t)((lo >> 16) | (hi << 16));
+                carry_hi = hi >> 16;
+                if (i & 1) r[i / 2] |= digit << 16;
+                else r[i / 2] = digit;
+            }
+            else {
+                uint64_t rem = ((hi % DECIMAL_BASE) << 32) | lo;
+                carry_hi = hi / DECIMAL_BASE;
+                carry_lo = (uint32_t)(rem / DECIMAL_BASE);
+                r[i] = (uint32_t)(rem % DECIMAL_BASE);
+            }
+        }
+    }
+    free(residues);
+    return ok;
+}
+
+
+// --- Radix 2^32 ---
+
+#define L_FN(name) name##_bin
+#define L_BASE ((uint64_t)1 << 32)
+#define L_SPLIT(t, limb, carry) ((limb) = (uint32_t)(t), (carry) = (t) >> 32)
+#define L_NTT_FITS(limbs) ntt_fits(limbs, 1)
+#define L_NTT(r, a, an, b, bn) ntt_mul(r, a, an, b, bn, 1)
+
+#include "BigIntKernels.h"
+
+#undef L_FN
+#undef L_BASE
+#undef L_SPLIT
+#undef L_NTT_FITS
+#undef L_NTT
+
+
+// --- Radix 10^9 ---
+
+#define L_FN(name) name##_dec
+#define L_BASE ((uint64_t)DECIMAL_BASE)
+#define L_SPLIT(t, limb, carry) ((limb) = (uint32_t)((t) % DECIMAL_BASE), (carry) = (t) / DECIMAL_BASE)
+#define L_NTT_FITS(limbs) ntt_fits(limbs, 0)
+#define L_NTT(r, a, an, b, bn) ntt_mul(r, a, an, b, bn, 0)
+
+#include "BigIntKernels.h"
+
+#undef L_FN
+#undef L_BASE
+#undef L_SPLIT
+#undef L_NTT_FITS
+#undef L_NTT
+
+
+uint32_t bigint_add_bin(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) { return add_bin(r, a, an, b, bn); }
+uint32_t bigint_add_dec(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) { return add_dec(r, a, an, b, bn); }
+
+void bigint_mul_1_bin(uint32_t* r, const uint32_t* a, size_t n, uint32_t m, uint32_t c) { mul_1_bin(r, a, n, m, c); }
+void bigint_mul_1_dec(uint32_t* r, const uint32_t* a, size_t n, uint32_t m, uint32_t c) { mul_1_dec(r, a, n, m, c); }
+
+int bigint_mul_bin(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) { return mul_bin(r, a, an, b, bn); }
+int bigint_mul_dec(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) { return mul_dec(r, a, an, b, bn); }
+
+uint32_t bigint_divmod_1_bin(uint32_t* q, const uint32_t* a, size_t n, uint32_t d) {
+    uint64_t rem = 0;
+    for (size_t i = n; i-- > 0;) {
+        uint64_t t = (rem << 32) | a[i];
+        q[i] = (uint32_t)(t / d);
+        rem = t % d;
+    }
+    return (uint32_t)rem;
+}
+
+size_t bigint_trim(const uint32_t* a, size_t n) {
+    while (n > 0 && a[n - 1] == 0) n--;
+    return n;
+}
+
+double bigint_to_double_bin(const uint32_t* a, size_t n) {
+    size_t total_bits, shift;
+    uint64_t top = 0;
+    uint32_t limb;
+
+    n = bigint_trim(a, n);
+    if (n == 0) return 0.0;
+    total_bits = (n - 1) * 32;
+    for (limb = a[n - 1]; limb != 0; limb >>= 1) total_bits++;
+    if (total_bits <= 64) {
+        for (size_t i = n; i-- > 0;) top = (top << 32) | a[i];
+        return (double)top;
+    }
+
+    // The 64 leading bits, with the lowest one set if any bit below them is (round to odd), so that
+    // the single rounding to 53 bits in the conversion is correct
+    shift = total_bits - 64;
+    for (size_t bit = shift; bit < total_bits; bit += 32) {
+        size_t i = bit / 32, offset = bit % 32;
+        uint64_t word = a[i] >> offset;
+        if (offset != 0 && i + 1 < n) word |= (uint64_t)a[i + 1] << (32 - offset);
+        top |= (word & 0xFFFFFFFFu) << (bit - shift);
+    }
+    if (a[shift / 32] & ((1u << (shift % 32)) - 1)) top |= 1;
+    for (size_t i = 0; i < shift / 32 && !(top & 1); i++) {
+        if (a[i] != 0) top |= 1;
+    }
+    return ldexp((double)top, (int)(shift < 2048 ? shift : 2048));
+}
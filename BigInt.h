@@ -0,0 +1,74 @@
+#ifndef BIG_INT_H
+#define BIG_INT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Arbitrary-precision natural numbers as little-endian vectors of 32-bit limbs, in one of two
+ * radixes: 2^32 (the _bin functions, for binary/hexadecimal work) and 10^9 (the _dec functions,
+ * whose limbs are groups of nine decimal digits). Callers own all the buffers; the only
+ * allocations are the temporaries of the multiplication, whose failure is reported by a 0 return.
+ */
+
+/**
+ * @brief r = a + b for an >= bn (r has an limbs and may alias a or b).
+ * @return The carry out of the top limb (0 or 1).
+ */
+uint32_t bigint_add_bin(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn);
+uint32_t bigint_add_dec(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn);
+
+/**
+ * @brief r = a * m + c (r has n + 1 limbs and may alias a).
+ */
+void bigint_mul_1_bin(uint32_t* r, const uint32_t* a, size_t n, uint32_t m, uint32_t c);
+void bigint_mul_1_dec(uint32_t* r, const uint32_t* a, size_t n, uint32_t m, uint32_t c);
+
+/**
+ * @brief r = a * b (r has an + bn limbs and must not alias a or b).
+ * Large operands use Karatsuba multiplication, very large ones a number-theoretic transform.
+ * @return 1 on success, 0 if a temporary could not be allocated.
+ */
+int bigint_mul_bin(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn);
+int bigint_mul_dec(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn);
+
+/**
+ * @brief q = a / d in radix 2^32 (q may alias a).
+ * @return The remainder a % d.
+ */
+uint32_t bigint_divmod_1_bin(uint32_t* q, const uint32_t* a, size_t n, uint32_t d);
+
+/**
+ * @brief Returns n minus the number of zero limbs at the top of a.
+ */
+size_t bigint_trim(const uint32_t* a, size_t n);
+
+/**
+ * @brief Rounds a radix-2^32 number to the nearest double (+inf when it exceeds DBL_MAX).
+ */
+double bigint_to_double_bin(const uint32_t* a, size_t n);
+
+/*
+ * Decimal output (BigConv.c): the digits are produced chunk by chunk and handed to a writer, so
+ * that printing a number of millions of digits never needs the whole string in memory.
+ * The writer returns 0 to abort (e.g. on an I/O error).
+ */
+
+typedef int (*BigIntWriter)(void* context, const char* text, size_t len);
+
+/**
+ * @brief Writes the decimal digits of a radix-2^32 number ("0" for zero) without a terminator.
+ * @return 1 on success, 0 if memory ran out or the writer failed.
+ */
+int bigint_write_dec(const uint32_t* a, size_t n, BigIntWriter write, void* context);
+
+/*
+ * Exact factorials and binomial coefficients (Factorial.c), assembled from their prime
+ * factorizations, or for C(n, k) with min(k, n - k) small next to n from n - k + 1 ... n. The result is a newly allocated radix-2^32 number (trimmed, *len limbs)
+ * that the caller releases with free(). The return value is 0 if memory ran out.
+ */
+
+int bigint_factorial(uint32_t n, uint32_t** result, size_t* len);
+int bigint_binomial(uint32_t n, uint32_t k, uint32_t** result, size_t* len); // Requires k <= n
+
+#endif // BIG_INT_H
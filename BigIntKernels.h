@@ -0,0 +1,151 @@
+/*
+ * Limb arithmetic template for BigInt.c - deliberately has no include guard.
+ *
+ * BigInt.c includes this file once per radix after defining:
+ *
+ *   L_FN(name)              suffixes a function name with the radix (_bin or _dec)
+ *   L_SPLIT(t, limb, carry) splits a 64-bit intermediate below BASE^2 into its low limb and the carry
+ *   L_BASE                  the radix as a 64-bit value (2^32 or 10^9)
+ *   L_NTT_FITS(limbs)       whether a product of that many limbs fits in the number-theoretic transform
+ *   L_NTT(r, a, an, b, bn)  r = a * b by the number-theoretic transform (returns 0 if memory ran out)
+ *
+ * Limb vectors are little-endian arrays of uint32_t. Every intermediate t = a*b + c + d with limbs
+ * a, b, c, d fits in 64 bits for both radixes.
+ */
+
+// r[0..an) = a + b for an >= bn; returns the carry. r may alias a or b.
+static uint32_t L_FN(add)(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) {
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < bn; i++) {
+        uint64_t t = (uint64_t)a[i] + b[i] + carry;
+        uint32_t limb;
+        L_SPLIT(t, limb, carry);
+        r[i] = limb;
+    }
+    for (; i < an; i++) {
+        uint64_t t = (uint64_t)a[i] + carry;
+        uint32_t limb;
+        L_SPLIT(t, limb, carry);
+        r[i] = limb;
+    }
+    return (uint32_t)carry;
+}
+
+// r[0..an) = a - b for an >= bn and a >= b; returns the borrow (0 when a >= b). r may alias a.
+static uint32_t L_FN(sub)(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) {
+    uint32_t borrow = 0;
+    for (size_t i = 0; i < an; i++) {
+        uint64_t sub = (uint64_t)(i < bn ? b[i] : 0) + borrow;
+        if ((uint64_t)a[i] >= sub) {
+            r[i] = (uint32_t)(a[i] - sub);
+            borrow = 0;
+        }
+        else {
+            r[i] = (uint32_t)(a[i] + L_BASE - sub);
+            borrow = 1;
+        }
+    }
+    return borrow;
+}
+
+// r[0..n] = a * m + c; returns nothing, r must have n + 1 limbs. r may alias a.
+static void L_FN(mul_1)(uint32_t* r, const uint32_t* a, size_t n, uint32_t m, uint32_t c) {
+    uint64_t carry = c;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t t = (uint64_t)a[i] * m + carry;
+        uint32_t limb;
+        L_SPLIT(t, limb, carry);
+        r[i] = limb;
+    }
+    r[n] = (uint32_t)carry;
+}
+
+// r[0..an+bn) = a * b by the schoolbook method. r must not alias a or b.
+static void L_FN(mul_basecase)(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) {
+    memset(r, 0, (an + bn) * sizeof(uint32_t));
+    for (size_t j = 0; j < bn; j++) {
+        uint64_t carry = 0;
+        uint32_t m = b[j];
+        if (m == 0) continue;
+        for (size_t i = 0; i < an; i++) {
+            uint64_t t = (uint64_t)a[i] * m + r[i + j] + carry;
+            uint32_t limb;
+            L_SPLIT(t, limb, carry);
+            r[i + j] = limb;
+        }
+        r[an + j] = (uint32_t)carry;
+    }
+}
+
+static int L_FN(mul)(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn);
+
+/**
+ * r[0..2n) = a * b for two n-limb operands by Karatsuba:
+ * a*b = z2*B^2h + ((a0 + a1)(b0 + b1) - z0 - z2)*B^h + z0 with z0 = a0*b0 and z2 = a1*b1.
+ */
+static int L_FN(mul_karatsuba)(uint32_t* r, const uint32_t* a, const uint32_t* b, size_t n) {
+    size_t h = n / 2, k = n - h; // Low halves have h limbs, high halves k >= h limbs
+    size_t zn = 2 * (k + 1);
+    uint32_t* scratch = (uint32_t*)malloc((2 * (k + 1) + zn) * sizeof(uint32_t));
+    uint32_t *sa, *sb, *z1;
+    int ok;
+
+    if (scratch == NULL) return 0;
+    sa = scratch;
+    sb = sa + k + 1;
+    z1 = sb + k + 1;
+
+    sa[k] = L_FN(add)(sa, a + h, k, a, h);
+    sb[k] = L_FN(add)(sb, b + h, k, b, h);
+    ok = L_FN(mul)(r, a, h, b, h) &&                 // z0 in r[0..2h)
+         L_FN(mul)(r + 2 * h, a + h, k, b + h, k) && // z2 in r[2h..2n)
+         L_FN(mul)(z1, sa, k + 1, sb, k + 1);
+    if (ok) {
+        L_FN(sub)(z1, z1, zn, r, 2 * h);
+        L_FN(sub)(z1, z1, zn, r + 2 * h, 2 * k);
+        while (zn > 0 && z1[zn - 1] == 0) zn--; // z1 < B^(n + 1): the top limbs are zero
+        // The sum fits in 2n limbs, so the final carry is always 0
+        L_FN(add)(r + h, r + h, 2 * n - h, z1, zn);
+    }
+    free(scratch);
+    return ok;
+}
+
+/**
+ * r[0..an+bn) = a * b. Balanced products above the threshold use Karatsuba, large ones the NTT
+ * while it has enough points; other unbalanced ones are cut into blocks of the shorter length.
+ * r must not alias a or b. Returns 0 if memory ran out.
+ */
+static int L_FN(mul)(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn) {
+    if (an < bn) {
+        const uint32_t* t = a; size_t tn = an;
+        a = b; an = bn; b = t; bn = tn;
+    }
+    if (bn == 0) {
+        memset(r, 0, an * sizeof(uint32_t));
+        return 1;
+    }
+    if (bn < BIGINT_KARATSUBA_THRESHOLD) {
+        L_FN(mul_basecase)(r, a, an, b, bn);
+        return 1;
+    }
+    if (bn >= BIGINT_NTT_THRESHOLD && L_NTT_FITS(an + bn)) return L_NTT(r, a, an, b, bn);
+    if (an == bn) return L_FN(mul_karatsuba)(r, a, b, an);
+
+    {
+        // Blocks of bn limbs of a, each multiplied by b and accumulated into r
+        uint32_t* block = (uint32_t*)malloc(2 * bn * sizeof(uint32_t));
+        size_t done = 0;
+        if (block == NULL) return 0;
+        memset(r, 0, (an + bn) * sizeof(uint32_t));
+        while (done < an) {
+            size_t len = an - done < bn ? an - done : bn;
+            if (!L_FN(mul)(block, a + done, len, b, bn)) { free(block); return 0; }
+            L_FN(add)(r + done, r + done, an + bn - done, block, len + bn);
+            done += len;
+        }
+        free(block);
+        return 1;
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef BITS_H
+#define BITS_H
+
+#include <stdint.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Bit counting shared by the integer code of the library (BaseConv, Parse, Modular)
+
+/**
+ * @brief Number of leading zero bits of a non-zero value.
+ */
+static inline int leading_zeros(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_clzll(value);
+#else
+    int count = 0;
+    while ((value & (1ULL << 63)) == 0) { value <<= 1; count++; }
+    return count;
+#endif
+}
+
+#endif // BITS_H
@@ -0,0 +1,368 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "CalcCore.h"
+#include "VectorMath.h"
+#include "BaseConv.h"
+#include "Parse.h"
+#include "Bits.h"
+
+const char* calc_status_message(CalcStatus status) {
+    switch (status) {
+    case CALC_OK: return "OK";
+    case CALC_ERR_DIVISION_BY_ZERO: return "Division by zero";
+    case CALC_ERR_MODULO_BY_ZERO: return "Modulo by zero";
+    case CALC_ERR_LOG_DOMAIN: return "Logarithm input must be positive";
+    case CALC_ERR_FACTORIAL_DOMAIN: return "Factorial is undefined for negative numbers";
+    case CALC_ERR_BINOMIAL_DOMAIN: return "Binomial coefficient needs 0 <= k <= n";
+    case CALC_ERR_TAN_UNDEFINED: return "Tangent is undefined at 90 or 270 degrees";
+    case CALC_ERR_COT_UNDEFINED: return "Cotangent is undefined at 0 or 180 degrees";
+    case CALC_ERR_MISSING_DIGITS: return "Missing digits";
+    case CALC_ERR_INVALID_DIGIT: return "Invalid digit";
+    case CALC_ERR_SYNTAX: return "Invalid expression";
+    case CALC_ERR_EVALUATION: return "Expression could not be evaluated (division by zero, log domain or undefined tan/cot)";
+    case CALC_ERR_CIRCULAR: return "Circular reference";
+    case CALC_ERR_UNDEFINED: return "Depends on an undefined or failing variable";
+    case CALC_ERR_DIMENSION: return "Matrix dimensions do not match";
+    case CALC_ERR_SINGULAR: return "Matrix is singular";
+    case CALC_ERR_NO_SIGN_CHANGE: return "Function has the same sign at both ends of the interval";
+    case CALC_ERR_NOT_CONVERGED: return "Tolerance not reached within the evaluation limit";
+    case CALC_ERR_SNAPSHOT: return "Invalid or corrupt snapshot";
+    case CALC_ERR_NO_MEMORY: return "Out of memory";
+    case CALC_ERR_OUTPUT: return "Output error";
+    case CALC_ERR_NOT_INVERTIBLE: return "No modular inverse (not coprime with the modulus)";
+    case CALC_ERR_INTEGER_RANGE: return "Number is not finite or out of the 64-bit integer range";
+    case CALC_STATUS_COUNT: break;
+    }
+    return "Unknown error";
+}
+
+
+// --- Session ---
+
+void calc_init(CalcContext* ctx) {
+    calc_clear(ctx);
+    ctx->precision = calc_precision_default();
+}
+
+void calc_clear(CalcContext* ctx) {
+    ctx->last_result = 0.0;
+    ctx->prev_result = 0.0;
+}
+
+void calc_push_result(CalcContext* ctx, double result) {
+    // Only update if the new result is a valid number
+    if (!isnan(result)) {
+        ctx->prev_result = ctx->last_result;
+        ctx->last_result = result;
+    }
+}
+
+CalcStatus calc_eval(const CalcContext* ctx, const char* expression, double* result, ExprError* error) {
+    CompiledExpr* expr;
+    if (ctx->precision == CALC_PRECISION_F64) {
+        expr = expr_compile(expression, error);
+        if (expr == NULL) return CALC_ERR_SYNTAX;
+        *result = expr_eval(expr, ctx->last_result, ctx->prev_result);
+    }
+    else {
+        // Folding would compute the constant subexpressions in double
+        expr = expr_compile_unfolded(expression, NULL, NULL, error);
+        if (expr == NULL) return CALC_ERR_SYNTAX;
+        *result = expr_eval_prec(expr, ctx->precision, ctx->last_result, ctx->prev_result, NULL);
+    }
+    expr_free(expr);
+    return isnan(*result) ? CALC_ERR_EVALUATION : CALC_OK;
+}
+
+
+// --- Mathematical operations ---
+
+double calc_add(double a, double b) { return a + b; }
+double calc_subtract(double a, double b) { return a - b; }
+double calc_multiply(double a, double b) { return a * b; }
+
+CalcStatus calc_divide(double a, double b, double* result) {
+    if (b == 0) return CALC_ERR_DIVISION_BY_ZERO;
+    *result = a / b;
+    return CALC_OK;
+}
+
+CalcStatus calc_remainder(long long a, long long b, long long* result) {
+    if (b == 0) return CALC_ERR_MODULO_BY_ZERO;
+    *result = b == -1 ? 0 : a % b; // LLONG_MIN % -1 traps on x86
+    return CALC_OK;
+}
+
+double calc_exp(double x) { return exp(x); }
+
+CalcStatus calc_log(double x, double* result) {
+    if (x <= 0) return CALC_ERR_LOG_DOMAIN;
+    *result = log(x);
+    return CALC_OK;
+}
+
+double calc_abs(double x) {
+    // sqrt(x^2) is simply the absolute value of x
+    return fabs(x);
+}
+
+double calc_power(double base, double exp) { return pow(base, exp); }
+
+CalcStatus calc_factorial(int n, double* result) {
+    uint32_t* limbs;
+    size_t len;
+
+    if (n < 0) return CALC_ERR_FACTORIAL_DOMAIN;
+    if (n <= 20) {
+        // Fits in unsigned long long
+        unsigned long long product = 1;
+        for (int i = 2; i <= n; i++) product *= i;
+        *result = (double)product;
+        return CALC_OK;
+    }
+    if (n > 170) {
+        *result = INFINITY; // Beyond DBL_MAX
+        return CALC_OK;
+    }
+
+    if (!bigint_factorial((uint32_t)n, &limbs, &len)) return CALC_ERR_NO_MEMORY;
+    *result = bigint_to_double_bin(limbs, len);
+    free(limbs);
+    return CALC_OK;
+}
+
+CalcStatus calc_binomial(int n, int k, double* result) {
+    uint32_t* limbs;
+    size_t len;
+
+    if (n < 0 || k < 0 || k > n) return CALC_ERR_BINOMIAL_DOMAIN;
+    if (k > 0 && k < n) {
+        // C(n, k) >= 2^(n H(k/n)) / (n + 1) with the binary entropy H: far beyond DBL_MAX there is
+        // no need to build the exact value (log2 instead of lgamma, which is not reentrant)
+        double x = (double)k / n;
+        double bits = -n * (x * log2(x) + (1 - x) * log2(1 - x)) - log2(n + 1.0);
+        if (bits > 1030.0) {
+            *result = INFINITY;
+            return CALC_OK;
+        }
+    }
+
+    if (!bigint_binomial((uint32_t)n, (uint32_t)k, &limbs, &len)) return CALC_ERR_NO_MEMORY;
+    *result = bigint_to_double_bin(limbs, len);
+    free(limbs);
+    return CALC_OK;
+}
+
+/**
+ * @brief Streams an exact result through the writer and releases it.
+ */
+static CalcStatus write_big_result(uint32_t* limbs, size_t len, BigIntWriter write, void* context, double* result) {
+    CalcStatus status = bigint_write_dec(limbs, len, write, context) ? CALC_OK : CALC_ERR_OUTPUT;
+    *result = bigint_to_double_bin(limbs, len);
+    free(limbs);
+    return status;
+}
+
+CalcStatus calc_write_factorial(int n, BigIntWriter write, void* context, double* result) {
+    uint32_t* limbs;
+    size_t len;
+    if (n < 0) return CALC_ERR_FACTORIAL_DOMAIN;
+    if (!bigint_factorial((uint32_t)n, &limbs, &len)) return CALC_ERR_NO_MEMORY;
+    return write_big_result(limbs, len, write, context, result);
+}
+
+CalcStatus calc_write_binomial(int n, int k, BigIntWriter write, void* context, double* result) {
+    uint32_t* limbs;
+    size_t len;
+    if (n < 0 || k < 0 || k > n) return CALC_ERR_BINOMIAL_DOMAIN;
+    if (!bigint_binomial((uint32_t)n, (uint32_t)k, &limbs, &len)) return CALC_ERR_NO_MEMORY;
+    return write_big_result(limbs, len, write, context, result);
+}
+
+
+// --- Trigonometric operations (degrees) ---
+
+double calc_sin(double deg) {
+    double s, c;
+    sincos_deg(deg, &s, &c);
+    return s;
+}
+
+double calc_cos(double deg) {
+    double s, c;
+    sincos_deg(deg, &s, &c);
+    return c;
+}
+
+CalcStatus calc_tan(double deg, double* result) {
+    // The reduction is exact, so cos is exactly 0 at 90 + 180*k (vertical asymptote)
+    return tan_deg_n(&deg, result, 1, NULL) != 0 ? CALC_ERR_TAN_UNDEFINED : CALC_OK;
+}
+
+CalcStatus calc_cot(double deg, double* result) {
+    // sin is exactly 0 at 180*k; at 90 + 180*k cos is exactly 0, so cot is 0
+    return cot_deg_n(&deg, result, 1, NULL) != 0 ? CALC_ERR_COT_UNDEFINED : CALC_OK;
+}
+
+double calc_hypot(double a, double b) { return hypot(a, b); }
+
+
+// --- Number system conversions ---
+
+CalcStatus calc_truncate_integer(double value, long long* result) {
+    // The comparisons are false for NAN
+    if (!(value >= -0x1p63 && value < 0x1p63)) {
+        *result = 0;
+        return CALC_ERR_INTEGER_RANGE;
+    }
+    *result = (long long)value;
+    return CALC_OK;
+}
+
+size_t calc_dec_to_bin(long long value, char* buf) {
+    // Negative numbers are shown as a sign and the magnitude (0 - x also handles LLONG_MIN)
+    if (value < 0) {
+        buf[0] = '-';
+        return 1 + format_bin(0 - (unsigned long long)value, buf + 1);
+    }
+    return format_bin((unsigned long long)value, buf);
+}
+
+size_t calc_dec_to_hex(long long value, char* buf) {
+    return format_hex((unsigned long long)value, buf);
+}
+
+/**
+ * @brief calc_convert_base() of a signed decimal integer to binary or hexadecimal.
+ */
+static CalcStatus convert_decimal(const char* str, size_t len, int to_base, char** text, double* value, size_t* error_offset) {
+    long long parsed;
+    size_t offset = 0, sign = len > 0 && (str[0] == '-' || str[0] == '+');
+    char* digits = NULL;
+    double result;
+    CalcConvStatus status = parse_dec(str, len, &parsed, &offset);
+
+    if (status == CALC_CONV_OK) {
+        result = (double)parsed;
+        if (text != NULL) {
+            digits = (char*)malloc(CALC_BIN_MAX_DIGITS + 2);
+            if (digits == NULL) return CALC_ERR_NO_MEMORY;
+            if (to_base == 2) calc_dec_to_bin(parsed, digits);
+            else calc_dec_to_hex(parsed, digits);
+        }
+    }
+    else if (status == CALC_CONV_OVERFLOW) {
+        // Over 64 bits: the magnitude in the other base, with a '-' in binary like calc_dec_to_bin()
+        size_t digits_len;
+        status = (to_base == 2 ? dec_to_bin_big : dec_to_hex_big)(str + sign, len - sign, &digits, &digits_len, &offset);
+        if (status == CALC_CONV_NO_MEMORY) return CALC_ERR_NO_MEMORY;
+        if (status != CALC_CONV_OK) {
+            // Digits after the first one that did not fit in 64 bits
+            if (error_offset != NULL) *error_offset = offset + sign;
+            return status == CALC_CONV_EMPTY ? CALC_ERR_MISSING_DIGITS : CALC_ERR_INVALID_DIGIT;
+        }
+        if (str[0] == '-') {
+            char* negative;
+            // Hexadecimal shows negative numbers in 64-bit two's complement, which this one does not fit
+            if (to_base == 16) {
+                free(digits);
+                return CALC_ERR_INTEGER_RANGE;
+            }
+            negative = (char*)realloc(digits, digits_len + 2);
+            if (negative == NULL) {
+                free(digits);
+                return CALC_ERR_NO_MEMORY;
+            }
+            memmove(negative + 1, negative, digits_len + 1);
+            negative[0] = '-';
+            digits = negative;
+        }
+        // Over DBL_MAX the result is +-HUGE_VAL (CALC_CONV_OVERFLOW)
+        if (parse_double(str, len, &result, NULL) == CALC_CONV_NO_MEMORY) {
+            free(digits);
+            return CALC_ERR_NO_MEMORY;
+        }
+    }
+    else {
+        if (error_offset != NULL) *error_offset = offset;
+        return status == CALC_CONV_EMPTY ? CALC_ERR_MISSING_DIGITS : CALC_ERR_INVALID_DIGIT;
+    }
+
+    if (value != NULL) *value = result;
+    if (text != NULL) *text = digits;
+    else free(digits);
+    return CALC_OK;
+}
+
+/**
+ * @brief Rounds valid binary (bits 1) or hexadecimal (bits 4) digits of any length to a double
+ * (+HUGE_VAL over DBL_MAX): the leading 61 to 64 significant bits, a sticky bit for the rest and
+ * the bit length, rounded once to nearest even.
+ */
+static double digits_to_double(const char* str, size_t len, int bits) {
+    const char* end = str + len;
+    uint64_t top = 0, half, rest;
+    int sticky = 0, shift;
+    long extra = 0; // Bits after top
+
+    if (len >= 2 && str[0] == '0' && (str[1] | 0x20) == (bits == 4 ? 'x' : 'b')) str += 2;
+    while (str < end && *str == '0') str++;
+    for (; str < end; str++) {
+        unsigned digit = *str <= '9' ? (unsigned)(*str - '0') : (unsigned)((*str | 0x20) - 'a' + 10);
+        if ((top >> (64 - bits)) == 0) {
+            top = top << bits | digit;
+        }
+        else {
+            sticky |= digit != 0;
+            extra += bits;
+        }
+    }
+    if (top == 0) return 0.0;
+    shift = 64 - leading_zeros(top) - 53;
+    if (shift <= 0) return (double)top; // Exact (no digits were left over)
+    half = 1ULL << (shift - 1);
+    rest = top & ((half << 1) - 1);
+    top >>= shift;
+    if (rest > half || (rest == half && (sticky || (top & 1)))) top++;
+    return ldexp((double)top, shift + (int)(extra > 2048 ? 2048 : extra));
+}
+
+CalcStatus calc_convert_base(const char* str, size_t len, int from_base, int to_base, char** text, double* value, size_t* error_offset) {
+    typedef CalcConvStatus (*BigConversion)(const char*, size_t, char**, size_t*, size_t*);
+    int hex = from_base == 16;
+    unsigned long long parsed;
+    size_t offset = 0;
+    char* digits = NULL;
+    double result;
+    CalcConvStatus status;
+
+    if (from_base == 10) return convert_decimal(str, len, to_base, text, value, error_offset);
+    status = hex ? parse_hex(str, len, &parsed, &offset) : parse_bin(str, len, &parsed, &offset);
+    if (status == CALC_CONV_OK) {
+        result = (double)parsed;
+        if (text != NULL) {
+            digits = (char*)malloc(CALC_DEC_MAX_CHARS + CALC_BIN_MAX_DIGITS + 1);
+            if (digits == NULL) return CALC_ERR_NO_MEMORY;
+            if (to_base == 10) format_udec(parsed, digits);
+            else if (to_base == 2) format_bin(parsed, digits);
+            else format_hex(parsed, digits);
+        }
+    }
+    else if (status == CALC_CONV_OVERFLOW) {
+        // Over 64 bits: the value straight from the leading bits, the digits only when asked for
+        result = digits_to_double(str, len, hex ? 4 : 1);
+        if (text != NULL) {
+            BigConversion convert = to_base == 10 ? (hex ? hex_to_dec_big : bin_to_dec_big) : (hex ? hex_to_bin_big : bin_to_hex_big);
+            if (convert(str, len, &digits, NULL, NULL) != CALC_CONV_OK) return CALC_ERR_NO_MEMORY; // The digits were valid
+        }
+    }
+    else {
+        if (error_offset != NULL) *error_offset = offset;
+        return status == CALC_CONV_EMPTY ? CALC_ERR_MISSING_DIGITS : CALC_ERR_INVALID_DIGIT;
+    }
+
+    if (value != NULL) *value = result;
+    if (text != NULL) *text = digits;
+    else free(digits);
+    return CALC_OK;
+}
@@ -0,0 +1,164 @@
+#ifndef CALC_CORE_H
+#define CALC_CORE_H
+
+#include <stddef.h>
+#include "BigInt.h"
+#include "Expression.h"
+#include "Precision.h"
+
+/*
+ * libcalculator: the calculator operations without any I/O or global state, safe to call from
+ * several threads at once. Results and the R/P history live in a CalcContext owned by the caller
+ * (one per session); fallible operations return a CalcStatus and their result through a pointer,
+ * and never print. The library is this file together with Expression, ExprJit, Sheet, Columns,
+ * VectorMath, Reduction, Matrix, Solver, Snapshot, Precision, Modular, BaseConv, Format, Parse, BigConv, BigInt, Factorial,
+ * Simd and Thread; Main.c, Functions.c (interactive menus) Batch.c (with MappedFile.c), Server.c,
+ * Sweep.c, Reduce.c, Solve.c and Session.c are front ends that own a context and do all the printing.
+ */
+
+typedef enum {
+    CALC_OK,
+    CALC_ERR_DIVISION_BY_ZERO,
+    CALC_ERR_MODULO_BY_ZERO,
+    CALC_ERR_LOG_DOMAIN,       // Logarithm of a non-positive number
+    CALC_ERR_FACTORIAL_DOMAIN, // Factorial of a negative number
+    CALC_ERR_BINOMIAL_DOMAIN,  // n choose k outside 0 <= k <= n
+    CALC_ERR_TAN_UNDEFINED,    // Tangent at 90 + 180k degrees
+    CALC_ERR_COT_UNDEFINED,    // Cotangent at 180k degrees
+    CALC_ERR_MISSING_DIGITS,   // Binary/hexadecimal string without digits
+    CALC_ERR_INVALID_DIGIT,    // Character that is not a digit of the base (see the error offset)
+    CALC_ERR_SYNTAX,           // Expression that does not compile (see the ExprError)
+    CALC_ERR_EVALUATION,       // Expression whose evaluation failed
+    CALC_ERR_CIRCULAR,         // Variable whose formula would depend on itself
+    CALC_ERR_UNDEFINED,        // Variable that is undefined or depends on one that is undefined or failing
+    CALC_ERR_DIMENSION,        // Matrices or vectors whose shapes do not fit the operation
+    CALC_ERR_SINGULAR,         // Linear system without a unique solution
+    CALC_ERR_NO_SIGN_CHANGE,   // Root bracket whose ends have values of the same sign
+    CALC_ERR_NOT_CONVERGED,    // Integral or root not within the tolerance after the evaluations allowed
+    CALC_ERR_SNAPSHOT,         // Session snapshot that is malformed, corrupt or of another version
+    CALC_ERR_NO_MEMORY,
+    CALC_ERR_OUTPUT,           // The writer of a streamed result failed
+    CALC_ERR_NOT_INVERTIBLE,   // Modular inverse of a number with a common factor with the modulus
+    CALC_ERR_INTEGER_RANGE,    // NAN, infinity or a value outside the 64-bit integers where one is needed
+    CALC_STATUS_COUNT          // Number of statuses (new ones go before it; snapshots store the values)
+} CalcStatus;
+
+/**
+ * @brief Per-session state: the last two successful results and the precision of calc_eval().
+ */
+typedef struct calc_ctx {
+    double last_result;     // R (most recent)
+    double prev_result;     // P (previous result)
+    CalcPrecision precision;
+} CalcContext;
+
+/**
+ * @brief Returns a printable description of a status, without a final period (e.g. "Division by zero").
+ */
+const char* calc_status_message(CalcStatus status);
+
+// --- Session ---
+
+/**
+ * @brief Initializes a new context: R and P are 0, the precision is calc_precision_default().
+ */
+void calc_init(CalcContext* ctx);
+
+/**
+ * @brief Resets R and P to 0 (the precision is kept).
+ */
+void calc_clear(CalcContext* ctx);
+
+/**
+ * @brief Updates the result history: P gets R, R gets result. NAN results are ignored.
+ */
+void calc_push_result(CalcContext* ctx, double result);
+
+/**
+ * @brief Compiles and evaluates an expression with the R and P of the context (which is not updated),
+ * at the precision of the context.
+ * @param error Optional; receives the message and position when the status is CALC_ERR_SYNTAX.
+ */
+CalcStatus calc_eval(const CalcContext* ctx, const char* expression, double* result, ExprError* error);
+
+// --- Mathematical operations ---
+
+double calc_add(double a, double b);
+double calc_subtract(double a, double b);
+double calc_multiply(double a, double b);
+CalcStatus calc_divide(double a, double b, double* result);
+CalcStatus calc_remainder(long long a, long long b, long long* result);
+double calc_exp(double x);
+CalcStatus calc_log(double x, double* result); // Natural logarithm
+double calc_abs(double x);                     // sqrt(x^2), i.e. |x|
+double calc_power(double base, double exp);
+
+/**
+ * @brief n! rounded to a double (exact up to 22!, +inf above 170!).
+ */
+CalcStatus calc_factorial(int n, double* result);
+
+/**
+ * @brief n choose k rounded to a double (+inf when it exceeds DBL_MAX).
+ */
+CalcStatus calc_binomial(int n, int k, double* result);
+
+/**
+ * @brief Streams the exact decimal digits of n! (or n choose k) through a writer, so that even
+ * 1000000! never needs a string; *result receives the value rounded to a double.
+ */
+CalcStatus calc_write_factorial(int n, BigIntWriter write, void* context, double* result);
+CalcStatus calc_write_binomial(int n, int k, BigIntWriter write, void* context, double* result);
+
+// --- Trigonometric operations (degrees) ---
+
+double calc_sin(double deg);
+double calc_cos(double deg);
+CalcStatus calc_tan(double deg, double* result);
+CalcStatus calc_cot(double deg, double* result);
+double calc_hypot(double a, double b); // sqrt(a^2 + b^2)
+
+// --- Selectable precision (see Precision.h) ---
+
+/**
+ * @brief Computes a op b (unary operations ignore b) at a precision, rounded to double. Double
+ * calls the functions above; the others fail like them: CALC_ERR_DIVISION_BY_ZERO,
+ * CALC_ERR_LOG_DOMAIN, CALC_ERR_TAN_UNDEFINED or CALC_ERR_COT_UNDEFINED.
+ */
+CalcStatus calc_prec_apply(CalcPrecision precision, CalcPrecOp op, double a, double b, double* result);
+
+// --- Number system conversions ---
+
+/**
+ * @brief Truncates value toward zero to the integer that calc_dec_to_bin() and calc_dec_to_hex() take.
+ * @return CALC_OK, or CALC_ERR_INTEGER_RANGE if value is NAN, infinite or outside [-2^63, 2^63).
+ */
+CalcStatus calc_truncate_integer(double value, long long* result);
+
+/**
+ * @brief Writes value in binary with a '-' sign for negative numbers and a terminating '\0'.
+ * @param buf Buffer of at least CALC_BIN_MAX_DIGITS + 2 characters.
+ * @return The number of characters written.
+ */
+size_t calc_dec_to_bin(long long value, char* buf);
+
+/**
+ * @brief Writes value in hexadecimal (two's complement for negative numbers, like "%llX").
+ * @param buf Buffer of at least CALC_HEX_MAX_DIGITS + 1 characters.
+ */
+size_t calc_dec_to_hex(long long value, char* buf);
+
+/**
+ * @brief Converts len characters of binary (from_base 2) or hexadecimal (16) digits to decimal,
+ * binary or hexadecimal (to_base 10, 2 or 16), or a decimal integer with an optional sign
+ * (from_base 10) to binary or hexadecimal like calc_dec_to_bin() and calc_dec_to_hex(); str needs
+ * no terminating '\0'. 64-bit values take the fast path of BaseConv.c, longer ones the
+ * arbitrary-length conversions (a negative decimal beyond 64 bits has no hexadecimal form:
+ * CALC_ERR_INTEGER_RANGE).
+ * @param text Optional; receives the digits as a newly allocated string (release with free()).
+ * @param value Optional; receives the value rounded to a double.
+ * @param error_offset Optional; receives the offset of the offending character on failure.
+ */
+CalcStatus calc_convert_base(const char* str, size_t len, int from_base, int to_base, char** text, double* value, size_t* error_offset);
+
+#endif // CALC_CORE_H
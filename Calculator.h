@@ -7,36 +7,43 @@
 #include <string.h>
 #include <limits.h>
 
-// Global variables to store the last two numerical results
-extern double last_result;   // R (most recent)
-extern double prev_result;   // P (previous result)
+// The calculator operations (stdio-free, reentrant); this header adds the interactive and batch front ends
+#include "CalcCore.h"
+#include "Sheet.h"
 
 // --- Menu Functions ---
-void display_menu();
+// The R and P shown and offered as operands come from the session context owned by main()
+void display_menu(const CalcContext* ctx);
 int get_menu_choice(int max_choice);
 /**
  * @brief Handles Mathematical Operations. Returns the result as a double.
  * @return The result of the calculation, or NAN if cancelled/failed.
  */
-double handle_math_operations();
+double handle_math_operations(const CalcContext* ctx);
 /**
  * @brief Handles Trigonometric Operations. Returns the result as a double.
  * @return The result of the calculation, or NAN if cancelled/failed.
  */
-double handle_trig_operations();
+double handle_trig_operations(const CalcContext* ctx);
 /**
  * @brief Handles Number System Conversions. Returns the decimal equivalent as a double.
  * @return The result of the conversion, or NAN if cancelled/failed.
  */
-double handle_conversion_operations();
-
-// --- Helper Function ---
+double handle_conversion_operations(const CalcContext* ctx);
+/**
+ * @brief Handles Expression Evaluation (e.g. "hypot(sin(30), R^2) / log(P)"). Returns the result as a double.
+ * @return The result of the expression, or NAN if it is invalid or failed.
+ */
+double handle_expression_operations(const CalcContext* ctx);
 /**
- * @brief Updates the result history: prev_result gets last_result, last_result gets new_result.
- * Called only when a top-level calculation is successfully completed.
- * @param new_result The result of the latest calculation.
+ * @brief Handles Matrix and Vector Operations (sum, product, transpose, dot product, norm, linear systems).
+ * @return The dot product or norm, or NAN for matrix results or if the input is invalid or the operation failed.
  */
-void update_results(double new_result);
+double handle_matrix_operations(const CalcContext* ctx);
+/**
+ * @brief Handles the Operation Statistics menu (counters and latencies as Prometheus text or JSON, see Stats.h).
+ */
+void handle_statistics_operations(void);
 
 // --- Input Function (Refactored for Recursion) ---
 /**
@@ -45,35 +52,122 @@ void update_results(double new_result);
  * @param use_result_option Set to 1 to allow using 'R' and 'P'.
  * @return The double value entered, or NAN if input is invalid or a nested operation fails.
  */
-double get_double_input(const char* prompt, int use_result_option);
+double get_double_input(const CalcContext* ctx, const char* prompt, int use_result_option);
+
+// --- Batch Mode ---
+/**
+ * @brief Runs the calculator without prompts, reading one operation per line (e.g. "mul 3.5 R").
+ * Only results are written to out; R and P of the context are updated like calc_push_result() does.
+ * @param sheet The variables, kept after the run, or NULL for new ones dropped after it.
+ * @param in Stream with the operations.
+ * @param out Stream for the results.
+ * @return 0 if every operation succeeded, 1 otherwise or if in cannot be read.
+ */
+int run_batch_mode(CalcContext* ctx, CalcSheet* sheet, FILE* in, FILE* out);
+/**
+ * @brief Like run_batch_mode() for the file at path, which is memory-mapped when possible.
+ * @return 0 if every operation succeeded, 1 otherwise or if the file cannot be opened or read.
+ */
+int run_batch_file(CalcContext* ctx, CalcSheet* sheet, const char* path, FILE* out);
+
+/**
+ * @brief Returns the longest accepted length of the operation line that starts with the len
+ * characters of line (the newline included): a few kilobytes, or many megabytes for the base
+ * conversions, whose operands can have millions of digits.
+ */
+size_t batch_line_limit(const char* line, size_t len);
+
+// State for evaluating operation lines one at a time (compiled expressions), e.g. per server connection
+typedef struct BatchSession BatchSession;
+BatchSession* batch_session_create(void);
+/**
+ * @brief Evaluates one operation line in the batch syntax (len characters without the '\n', which
+ * must follow in memory or end the string) and updates R and P of ctx like batch mode.
+ * @param response_len Receives the length of the response: the result line, "error: <message>\n"
+ * if the operation failed, or nothing (0) for a blank or comment line.
+ * @return The response, valid until the next call with the same session.
+ */
+const char* batch_session_eval(BatchSession* session, CalcContext* ctx, const char* line, size_t len, size_t* response_len);
+void batch_session_free(BatchSession* session);
+
+// --- Saved sessions ---
+/**
+ * @brief Restores R, P and the variables of a session saved by session_save() into ctx and the
+ * empty sheet. A file that does not exist is a new session.
+ * @return 0 on success, 1 if the file cannot be read or is not a valid snapshot (see Snapshot.h).
+ */
+int session_load(const char* path, CalcContext* ctx, CalcSheet* sheet);
+/**
+ * @brief Saves R, P and the variables of a session to path, atomically replacing the file.
+ * @return 0 on success, 1 if the file cannot be written.
+ */
+int session_save(const char* path, const CalcContext* ctx, const CalcSheet* sheet);
 
-// --- Mathematical Operations ---
-double add(double a, double b);
-double subtract(double a, double b);
-double multiply(double a, double b);
-double divide(double a, double b);
-long long remainder_op(long long a, long long b);
-double exponential(double x); // exp(x)
-double logarithm(double x);   // log(x) (natural log)
-double abs_square_root(double x); // sqrt(x^2) which is |x|
-double power(double base, double exp); // x^y
-unsigned long long factorial(int n); // n!
+// --- Benchmarks ---
+/**
+ * @brief Runs the microbenchmarks of the operations (the options that follow "--bench").
+ * @return 0 on success, 1 on a usage error or if a regression against --compare was found.
+ */
+int run_bench(int argc, char* argv[]);
 
-// --- Trigonometric Operations (Inputs in Degrees for user-friendliness) ---
-double sine_deg(double deg);
-double cosine_deg(double deg);
-double tangent_deg(double deg);
-double cotangent_deg(double deg);
-double hypotenuse(double a, double b); // hypot(a,b)
+// --- Command-line helpers (CommandLine.c) ---
+/**
+ * @brief Parses the numeric argument text of a command-line mode; if it is not a number, prints
+ * the name of the argument and what is wrong with it, and returns 0.
+ */
+int parse_cli_number(const char* name, const char* text, double* value);
+/**
+ * @brief Writes "<name>\t<value>" with the value in format_result().
+ */
+void print_named_result(const char* name, double value);
 
-// --- Number System Conversions ---
-void dec_to_bin(long long dec);
-long long bin_to_dec(const char* bin_str);
+// --- Sweeps ---
+/**
+ * @brief Tabulates a function over a range (the arguments that follow "--sweep": FUNCTION START
+ * END STEP and options) as text lines "<x>\t<f(x)>" or raw doubles, see Sweep.c.
+ * @return 0 on success, 1 on a usage error or if the output cannot be written.
+ */
+int run_sweep(int argc, char* argv[]);
 
-void dec_to_hex(long long dec);
-long long hex_to_dec(const char* hex_str);
+// --- Reductions ---
+/**
+ * @brief Prints the count, sum, mean, variance, min, max, product, ... of the numbers of a file or
+ * standard input (the arguments that follow "--reduce": [FILE]), see Reduce.c.
+ * @return 0 on success, 1 on a usage error, if the input cannot be read or a number was invalid.
+ */
+int run_reduce(int argc, char* argv[]);
 
-void hex_to_bin(const char* hex_str);
-void bin_to_hex(const char* bin_str);
+// --- Integrals and roots ---
+/**
+ * @brief Integrates an expression of R = x from A to B (the arguments that follow "--integrate":
+ * EXPRESSION A B and options) and prints the value, error estimate and evaluations, see Solve.c.
+ * @return 0 on success, 1 on a usage error or if the tolerance was not reached.
+ */
+int run_integrate(int argc, char* argv[]);
+/**
+ * @brief Finds where an expression of R = x is 0 between LO and HI (the arguments that follow
+ * "--root": EXPRESSION LO HI and options), see Solve.c.
+ * @return 0 on success, 1 on a usage error or if no root was found within the tolerance.
+ */
+int run_root(int argc, char* argv[]);
+/**
+ * @brief Solves the root problems "LO HI [P]" of a file or standard input in parallel, one root
+ * per line (the arguments that follow "--roots": EXPRESSION [FILE] and options), see Solve.c.
+ * @return 0 on success, 1 on a usage error, if the input cannot be read or a problem failed.
+ */
+int run_roots(int argc, char* argv[]);
+
+// --- Server ---
+/**
+ * @brief Runs the calculation server (the options that follow "--server"), see Server.h.
+ * @return 0 after SIGINT/SIGTERM, 1 on a usage error or if the endpoint cannot be listened on.
+ */
+int run_server(int argc, char* argv[]);
+/**
+ * @brief Runs the load generator for the server (the options that follow "--loadgen") and
+ * prints the request rate and latency percentiles.
+ * @return 0 on success, 1 on a usage error or a connection failure.
+ */
+int run_loadgen(int argc, char* argv[]);
 
 #endif // CALCULATOR_H#pragma once
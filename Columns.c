@@ -0,0 +1,256 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Columns.h"
+#include "VectorMath.h"
+#include "Simd.h"
+
+typedef void (*ArithmeticKernel)(const double* a, const double* b, double* out, size_t n);
+typedef size_t (*DivideKernel)(const double* a, const double* b, double* out, size_t n, unsigned char* errors);
+typedef size_t (*RemainderKernel)(const long long* a, const long long* b, long long* out, size_t n, unsigned char* errors);
+
+/**
+ * @brief Records the error bit of element i (the byte is cleared when its first element is written).
+ */
+static void set_error_bit(unsigned char* errors, size_t i, int failed) {
+    if (errors == NULL) return;
+    if (i % 8 == 0) errors[i / 8] = 0;
+    if (failed) errors[i / 8] |= (unsigned char)(1u << (i % 8));
+}
+
+
+// --- Scalar kernels ---
+
+#define DEFINE_SCALAR_KERNEL(name, op)                                                   \
+    static void name##_scalar(const double* a, const double* b, double* out, size_t n) { \
+        for (size_t i = 0; i < n; i++) out[i] = a[i] op b[i];                             \
+    }
+
+DEFINE_SCALAR_KERNEL(add, +)
+DEFINE_SCALAR_KERNEL(subtract, -)
+DEFINE_SCALAR_KERNEL(multiply, *)
+
+static size_t divide_scalar(const double* a, const double* b, double* out, size_t n, unsigned char* errors) {
+    size_t failures = 0;
+    for (size_t i = 0; i < n; i++) {
+        int failed = b[i] == 0;
+        out[i] = failed ? NAN : a[i] / b[i];
+        failures += (size_t)failed;
+        set_error_bit(errors, i, failed);
+    }
+    return failures;
+}
+
+static size_t remainder_scalar(const long long* a, const long long* b, long long* out, size_t n, unsigned char* errors) {
+    size_t failures = 0;
+    for (size_t i = 0; i < n; i++) {
+        int failed = b[i] == 0;
+        // x % -1 is always 0; computing it would trap for LLONG_MIN
+        out[i] = (failed || b[i] == -1) ? 0 : a[i] % b[i];
+        failures += (size_t)failed;
+        set_error_bit(errors, i, failed);
+    }
+    return failures;
+}
+
+
+#ifdef CALC_X86_SIMD
+
+// Set bits of an error mask (only the SIMD kernels produce masks)
+static unsigned count_bits(unsigned x) {
+    unsigned count = 0;
+    for (; x; x &= x - 1) count++;
+    return count;
+}
+
+// --- AVX2 kernels (8 elements per iteration, so that each iteration fills one error byte) ---
+
+#define DEFINE_AVX2_KERNEL(name, op, intrinsic)                                                \
+    CALC_TARGET_AVX2 static void name##_avx2(const double* a, const double* b, double* out, size_t n) { \
+        size_t i = 0;                                                                           \
+        for (; i + 8 <= n; i += 8) {                                                            \
+            __m256d r0 = intrinsic(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i));             \
+            __m256d r1 = intrinsic(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4));     \
+            _mm256_storeu_pd(out + i, r0);                                                      \
+            _mm256_storeu_pd(out + i + 4, r1);                                                  \
+        }                                                                                       \
+        for (; i < n; i++) out[i] = a[i] op b[i];                                               \
+    }
+
+DEFINE_AVX2_KERNEL(add, +, _mm256_add_pd)
+DEFINE_AVX2_KERNEL(subtract, -, _mm256_sub_pd)
+DEFINE_AVX2_KERNEL(multiply, *, _mm256_mul_pd)
+
+CALC_TARGET_AVX2 static size_t divide_avx2(const double* a, const double* b, double* out, size_t n, unsigned char* errors) {
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d nan = _mm256_set1_pd(NAN);
+    size_t failures = 0;
+    size_t i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256d b0 = _mm256_loadu_pd(b + i);
+        __m256d b1 = _mm256_loadu_pd(b + i + 4);
+        __m256d z0 = _mm256_cmp_pd(b0, zero, _CMP_EQ_OQ);
+        __m256d z1 = _mm256_cmp_pd(b1, zero, _CMP_EQ_OQ);
+        __m256d q0 = _mm256_div_pd(_mm256_loadu_pd(a + i), b0);
+        __m256d q1 = _mm256_div_pd(_mm256_loadu_pd(a + i + 4), b1);
+        unsigned bits = (unsigned)_mm256_movemask_pd(z0) | ((unsigned)_mm256_movemask_pd(z1) << 4);
+
+        _mm256_storeu_pd(out + i, _mm256_blendv_pd(q0, nan, z0));
+        _mm256_storeu_pd(out + i + 4, _mm256_blendv_pd(q1, nan, z1));
+        if (errors != NULL) errors[i / 8] = (unsigned char)bits;
+        if (bits) failures += count_bits(bits);
+    }
+    for (; i < n; i++) {
+        int failed = b[i] == 0;
+        out[i] = failed ? NAN : a[i] / b[i];
+        failures += (size_t)failed;
+        set_error_bit(errors, i, failed);
+    }
+    return failures;
+}
+
+
+// --- AVX-512 kernels (masked tails, one error byte per vector) ---
+
+#define TAIL_MASK(n, i) ((n) - (i) >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << ((n) - (i))) - 1))
+
+#define DEFINE_AVX512_KERNEL(name, intrinsic)                                                    \
+    CALC_TARGET_AVX512 static void name##_avx512(const double* a, const double* b, double* out, size_t n) { \
+        for (size_t i = 0; i < n; i += 8) {                                                       \
+            __mmask8 m = TAIL_MASK(n, i);                                                         \
+            __m512d r = intrinsic(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i)); \
+            _mm512_mask_storeu_pd(out + i, m, r);                                                 \
+        }                                                                                         \
+    }
+
+DEFINE_AVX512_KERNEL(add, _mm512_add_pd)
+DEFINE_AVX512_KERNEL(subtract, _mm512_sub_pd)
+DEFINE_AVX512_KERNEL(multiply, _mm512_mul_pd)
+
+CALC_TARGET_AVX512 static size_t divide_avx512(const double* a, const double* b, double* out, size_t n, unsigned char* errors) {
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d nan = _mm512_set1_pd(NAN);
+    size_t failures = 0;
+
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = TAIL_MASK(n, i);
+        __m512d vb = _mm512_maskz_loadu_pd(m, b + i);
+        __mmask8 z = _mm512_mask_cmp_pd_mask(m, vb, zero, _CMP_EQ_OQ);
+        __m512d q = _mm512_maskz_div_pd(m & (__mmask8)~z, _mm512_maskz_loadu_pd(m, a + i), vb);
+
+        _mm512_mask_storeu_pd(out + i, m, _mm512_mask_mov_pd(q, z, nan));
+        if (errors != NULL) errors[i / 8] = (unsigned char)z;
+        if (z) failures += count_bits(z);
+    }
+    return failures;
+}
+
+/**
+ * @brief Integer remainder without integer division: the quotient of |a| and |b| is computed in
+ * double precision (exact to within one for operands below 2^52) and corrected once.
+ * Lanes with larger operands are finished with the scalar '%'.
+ */
+CALC_TARGET_AVX512 static size_t remainder_avx512(const long long* a, const long long* b, long long* out, size_t n, unsigned char* errors) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i limit = _mm512_set1_epi64(1LL << 52);
+    size_t failures = 0;
+
+    for (size_t i = 0; i < n; i += 8) {
+        __mmask8 m = TAIL_MASK(n, i);
+        __m512i va = _mm512_maskz_loadu_epi64(m, a + i);
+        __m512i vb = _mm512_maskz_loadu_epi64(m, b + i);
+        __m512i ua = _mm512_abs_epi64(va);
+        __m512i ub = _mm512_max_epi64(_mm512_abs_epi64(vb), one); // Avoid 0 in the division
+        __mmask8 z = _mm512_mask_cmpeq_epi64_mask(m, vb, zero);
+        __mmask8 big = _mm512_mask_cmpge_epu64_mask(m, ua, limit) | _mm512_mask_cmpge_epu64_mask(m, ub, limit);
+        __m512d q = _mm512_roundscale_pd(_mm512_div_pd(_mm512_cvtepi64_pd(ua), _mm512_cvtepi64_pd(ub)),
+            _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+        __m512i r = _mm512_sub_epi64(ua, _mm512_mullo_epi64(_mm512_cvttpd_epi64(q), ub));
+
+        r = _mm512_mask_add_epi64(r, _mm512_cmplt_epi64_mask(r, zero), r, ub);
+        r = _mm512_mask_sub_epi64(r, _mm512_cmpge_epi64_mask(r, ub), r, ub);
+        r = _mm512_mask_sub_epi64(r, _mm512_cmplt_epi64_mask(va, zero), zero, r); // Sign of the dividend
+        r = _mm512_mask_mov_epi64(r, z, zero);
+        _mm512_mask_storeu_epi64(out + i, m, r);
+
+        for (unsigned lanes = big & (__mmask8)~z; lanes; lanes &= lanes - 1) {
+            size_t j = i + (size_t)count_bits((lanes & (0u - lanes)) - 1);
+            out[j] = b[j] == -1 ? 0 : a[j] % b[j];
+        }
+        if (errors != NULL) errors[i / 8] = (unsigned char)z;
+        if (z) failures += count_bits(z);
+    }
+    return failures;
+}
+
+#endif // CALC_X86_SIMD
+
+
+// --- Dispatch ---
+
+static ArithmeticKernel add_kernel, subtract_kernel, multiply_kernel;
+static DivideKernel divide_kernel;
+static RemainderKernel remainder_kernel;
+static volatile int kernels_ready = 0;
+
+/**
+ * @brief Selects the kernels for the CPU once (repeating the selection in a race is harmless).
+ */
+static void select_kernels(void) {
+    CalcSimdLevel level = calc_simd_level();
+
+    add_kernel = add_scalar;
+    subtract_kernel = subtract_scalar;
+    multiply_kernel = multiply_scalar;
+    divide_kernel = divide_scalar;
+    remainder_kernel = remainder_scalar;
+#ifdef CALC_X86_SIMD
+    if (level == CALC_SIMD_AVX512) {
+        add_kernel = add_avx512;
+        subtract_kernel = subtract_avx512;
+        multiply_kernel = multiply_avx512;
+        divide_kernel = divide_avx512;
+        remainder_kernel = remainder_avx512;
+    }
+    else if (level == CALC_SIMD_AVX2) {
+        // AVX2 has no 64-bit multiply/convert, so remainder_n keeps the scalar kernel
+        add_kernel = add_avx2;
+        subtract_kernel = subtract_avx2;
+        multiply_kernel = multiply_avx2;
+        divide_kernel = divide_avx2;
+    }
+#else
+    (void)level;
+#endif
+    kernels_ready = 1;
+}
+
+void add_n(const double* a, const double* b, double* out, size_t n) {
+    if (!kernels_ready) select_kernels();
+    add_kernel(a, b, out, n);
+}
+
+void subtract_n(const double* a, const double* b, double* out, size_t n) {
+    if (!kernels_ready) select_kernels();
+    subtract_kernel(a, b, out, n);
+}
+
+void multiply_n(const double* a, const double* b, double* out, size_t n) {
+    if (!kernels_ready) select_kernels();
+    multiply_kernel(a, b, out, n);
+}
+
+size_t divide_n(const double* a, const double* b, double* out, size_t n, unsigned char* errors) {
+    if (!kernels_ready) select_kernels();
+    return divide_kernel(a, b, out, n, errors);
+}
+
+void power_n(const double* base, const double* exp, double* out, size_t n) {
+    pow_n(base, exp, out, n, CALC_MATH_ACCURATE);
+}
+
+size_t remainder_n(const long long* a, const long long* b, long long* out, size_t n, unsigned char* errors) {
+    if (!kernels_ready) select_kernels();
+    return remainder_kernel(a, b, out, n, errors);
+}
@@ -0,0 +1,38 @@
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+#include <stddef.h>
+
+/*
+ * Array-in/array-out (columnar) versions of the two-operand mathematical operations.
+ * out[i] = op(a[i], b[i]) for i in [0, n). The output may alias either input.
+ * AVX2 or AVX-512 kernels are selected at run time (see calc_simd_level()), with a scalar fallback.
+ * Nothing is printed: failing elements are reported through NAN (or 0 for remainder_n, like
+ * calc_remainder()) and an optional error bitmask, in which bit (i % 8) of errors[i / 8] is set when
+ * element i failed. The bitmask needs (n + 7) / 8 bytes and may be NULL.
+ */
+
+void add_n(const double* a, const double* b, double* out, size_t n);
+void subtract_n(const double* a, const double* b, double* out, size_t n);
+void multiply_n(const double* a, const double* b, double* out, size_t n);
+
+/**
+ * @brief out[i] = a[i] / b[i]; elements with b[i] == 0 get NAN, like calc_divide().
+ * @param errors Optional bitmask of the elements that divided by zero.
+ * @return The number of divisions by zero.
+ */
+size_t divide_n(const double* a, const double* b, double* out, size_t n, unsigned char* errors);
+
+/**
+ * @brief out[i] = pow(base[i], exp[i]), like calc_power(); computed by pow_n() with the accurate tier.
+ */
+void power_n(const double* base, const double* exp, double* out, size_t n);
+
+/**
+ * @brief out[i] = a[i] % b[i]; elements with b[i] == 0 get 0, like calc_remainder().
+ * @param errors Optional bitmask of the elements that used a zero modulus.
+ * @return The number of modulo-by-zero elements.
+ */
+size_t remainder_n(const long long* a, const long long* b, long long* out, size_t n, unsigned char* errors);
+
+#endif // COLUMNS_H
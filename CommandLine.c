@@ -0,0 +1,23 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Format.h"
+#include "Parse.h"
+
+/*
+ * Argument parsing and result printing shared by the command-line modes (Sweep.c, Reduce.c, Solve.c).
+ */
+
+int parse_cli_number(const char* name, const char* text, double* value) {
+    size_t offset = 0;
+    CalcConvStatus status = parse_number(text, strlen(text), value, &offset);
+    if (status == CALC_CONV_OK) return 1;
+    fprintf(stderr, "Error: %s \"%s\": %s at position %zu.\n", name, text,
+        status == CALC_CONV_OVERFLOW ? "Number out of range" : calc_conv_status_message(status), offset + 1);
+    return 0;
+}
+
+void print_named_result(const char* name, double value) {
+    char text[CALC_FIXED_MAX_CHARS + 1];
+    format_result(value, text);
+    printf("%s\t%s\n", name, text);
+}
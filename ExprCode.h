@@ -0,0 +1,79 @@
+#ifndef EXPR_CODE_H
+#define EXPR_CODE_H
+
+#include <stddef.h>
+#include "Expression.h"
+
+/*
+ * Internal to the expression engine: the bytecode shared by the compiler and interpreter
+ * (Expression.c) and the native code generator (ExprJit.c). A program is a sequence of stack
+ * machine instructions ending with OP_RET; constants live in a separate pool.
+ */
+
+// Bytecode instructions. The syntax tree uses the same codes as node kinds.
+enum {
+    OP_RET,
+    OP_CONST,   // Followed by a 2-byte constant pool index
+    OP_R, OP_P,
+    OP_VAR,     // Followed by a 4-byte variable index
+    OP_NEG,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD, OP_POW, OP_HYP, OP_BINOM,
+    OP_EXP, OP_LOG, OP_ABS, OP_FACT, OP_SIN, OP_COS, OP_TAN, OP_COT
+};
+
+// Deepest operand stack the VM supports
+#define EXPR_MAX_STACK 128
+
+/**
+ * @brief Returns the bytecode of a compiled expression, its constant pool (in *constants) and the
+ * low parts of the constants (in *lows): a decimal literal is constants[i] + lows[i] to about 100
+ * bits, for the precisions beyond double (see parse_double_low()); other constants have 0.
+ */
+const unsigned char* expr_bytecode(const CompiledExpr* expr, const double** constants, const double** lows);
+
+/**
+ * @brief Applies an operation to its operands without printing anything.
+ * @return The result, or NAN if the operation fails (same conditions as the interactive menus).
+ */
+double expr_apply_op(unsigned char op, double a, double b);
+
+// Native code of an expression, with the same results as the interpreter down to the last bit
+typedef double (*ExprNativeFn)(double r, double p, const double* vars);
+
+typedef struct {
+    ExprNativeFn entry; // NULL when there is no native code
+    void* memory;       // Executable pages holding the code
+    size_t size;
+} ExprNative;
+
+// How expr_jit() behaves, from the environment variable CALC_JIT (see expr_jit_mode())
+enum {
+    EXPR_JIT_OFF,  // "off" or "0", or no x86-64 code generator: the interpreter only
+    EXPR_JIT_ON,   // Default
+    EXPR_JIT_CHECK // "check": native code and interpreter both run and are compared
+};
+
+/**
+ * @brief Returns the JIT mode (cached).
+ */
+int expr_jit_mode(void);
+
+/**
+ * @brief Generates native code for a bytecode program.
+ * @param max_depth Deepest operand stack the program reaches.
+ * @return 1 on success, 0 if the program cannot be compiled (no x86-64, stack too deep for the
+ * registers, no executable memory); the interpreter is used then.
+ */
+int expr_native_compile(const unsigned char* code, const double* constants, int max_depth, ExprNative* native);
+
+/**
+ * @brief Releases native code (nothing for an ExprNative without code).
+ */
+void expr_native_free(ExprNative* native);
+
+/**
+ * @brief Counts an evaluation where native code and interpreter disagreed (see expr_jit_mismatches()).
+ */
+void expr_native_mismatch(void);
+
+#endif // EXPR_CODE_H
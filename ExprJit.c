@@ -0,0 +1,415 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "ExprCode.h"
+#include <stdint.h>
+
+// The code generator targets x86-64 (System V and Windows calling conventions)
+#if !defined(CALC_NO_JIT) && (defined(__x86_64__) || defined(_M_X64))
+#define EXPR_JIT_X64
+#endif
+
+#if !defined(EXPR_JIT_X64)
+// Nothing to include
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+static volatile long jit_mismatches = 0;
+void expr_native_mismatch(void) { InterlockedIncrement(&jit_mismatches); }
+unsigned long expr_jit_mismatches(void) { return (unsigned long)InterlockedCompareExchange(&jit_mismatches, 0, 0); }
+#else
+static unsigned long jit_mismatches = 0;
+void expr_native_mismatch(void) { __atomic_fetch_add(&jit_mismatches, 1, __ATOMIC_RELAXED); }
+unsigned long expr_jit_mismatches(void) { return __atomic_load_n(&jit_mismatches, __ATOMIC_RELAXED); }
+#endif
+
+int expr_jit_mode(void) {
+    // Like calc_thread_count(), a race between threads only repeats the work
+    static volatile int cached = -1;
+    if (cached < 0) {
+        const char* requested = getenv("CALC_JIT");
+        int mode = EXPR_JIT_ON;
+        if (requested != NULL && (strcmp(requested, "off") == 0 || strcmp(requested, "0") == 0)) mode = EXPR_JIT_OFF;
+        else if (requested != NULL && strcmp(requested, "check") == 0) mode = EXPR_JIT_CHECK;
+#if !defined(EXPR_JIT_X64)
+        mode = EXPR_JIT_OFF;
+#endif
+        cached = mode;
+    }
+    return cached;
+}
+
+#if !defined(EXPR_JIT_X64)
+
+int expr_native_compile(const unsigned char* code, const double* constants, int max_depth, ExprNative* native) {
+    (void)code;
+    (void)constants;
+    (void)max_depth;
+    native->entry = NULL;
+    native->memory = NULL;
+    native->size = 0;
+    return 0;
+}
+
+void expr_native_free(ExprNative* native) {
+    (void)native;
+}
+
+#else
+
+/*
+ * Register allocation: operand stack slot i lives in xmm(2 + i), so expressions up to 14 deep
+ * (nearly all of them) never touch memory; xmm0 and xmm1 are the argument/result and scratch
+ * registers. Around a call, the slots below the operands are spilled to the frame, since both
+ * calling conventions may clobber them (Windows preserves xmm6-xmm15, which the prologue saves).
+ *
+ * Frame (rsp 16-byte aligned after the prologue):
+ *   [rsp +   0]  32 bytes of shadow space for Windows callees
+ *   [rsp +  32]  R, [rsp + 40] P
+ *   [rsp +  48]  spill area, 8 bytes per slot
+ *   [rsp + 160]  saved xmm6-xmm15 (Windows)
+ *   [rsp + 320]  pointer to the variable values (third argument: rdi, or r8 on Windows)
+ *
+ * The code is followed by a 16-byte aligned pool addressed RIP-relative: the sign and
+ * absolute value masks, the failure result NAN and the constants of the expression.
+ */
+#define JIT_SLOTS 14
+#define JIT_SLOT_REG(slot) ((slot) + 2)
+#define JIT_R_OFFSET 32
+#define JIT_P_OFFSET 40
+#define JIT_SPILL_OFFSET 48
+#define JIT_SAVE_OFFSET (JIT_SPILL_OFFSET + 8 * JIT_SLOTS)
+#define JIT_VARS_OFFSET (JIT_SAVE_OFFSET + 16 * 10)
+#define JIT_FRAME_SIZE (JIT_VARS_OFFSET + 8)
+
+#define POOL_SIGN_MASK 0
+#define POOL_ABS_MASK 16
+#define POOL_NAN 32
+#define POOL_CONSTANTS 48
+
+// SSE2 instructions: mandatory prefix and second opcode byte after 0F
+#define SSE_MOVSD_LOAD 0xF2, 0x10
+#define SSE_MOVSD_STORE 0xF2, 0x11
+#define SSE_MOVUPS_LOAD 0x00, 0x10
+#define SSE_MOVUPS_STORE 0x00, 0x11
+#define SSE_MOVAPD 0x66, 0x28
+#define SSE_ANDPD 0x66, 0x54
+#define SSE_XORPD 0x66, 0x57
+#define SSE_UCOMISD 0x66, 0x2E
+#define SSE_ADDSD 0xF2, 0x58
+#define SSE_MULSD 0xF2, 0x59
+#define SSE_SUBSD 0xF2, 0x5C
+#define SSE_DIVSD 0xF2, 0x5E
+
+// Conditional jumps (second byte after 0F for rel32, minus 0x10 for rel8)
+#define JCC_E 0x84
+#define JCC_BE 0x86
+#define JCC_P 0x8A
+
+typedef struct {
+    size_t at;     // Offset of the 32-bit field to patch
+    size_t target; // Offset in the pool (pool references) or unused (failure jumps)
+} JitFixup;
+
+typedef struct {
+    unsigned char* code;
+    size_t size, capacity;
+    JitFixup* fixups;
+    size_t fixup_count, fixup_capacity;
+    int failed;
+} JitBuffer;
+
+static void jit_byte(JitBuffer* jb, unsigned char byte) {
+    if (jb->size == jb->capacity) {
+        size_t capacity = jb->capacity ? jb->capacity * 2 : 256;
+        unsigned char* code = (unsigned char*)realloc(jb->code, capacity);
+        if (code == NULL) { jb->failed = 1; return; }
+        jb->code = code;
+        jb->capacity = capacity;
+    }
+    jb->code[jb->size++] = byte;
+}
+
+static void jit_u32(JitBuffer* jb, uint32_t value) {
+    for (int i = 0; i < 4; i++) jit_byte(jb, (unsigned char)(value >> (8 * i)));
+}
+
+static void jit_u64(JitBuffer* jb, uint64_t value) {
+    for (int i = 0; i < 8; i++) jit_byte(jb, (unsigned char)(value >> (8 * i)));
+}
+
+static void jit_patch32(JitBuffer* jb, size_t at, uint32_t value) {
+    for (int i = 0; i < 4; i++) jb->code[at + i] = (unsigned char)(value >> (8 * i));
+}
+
+// Records a 32-bit field at the current position, emitted as 0 and patched at the end
+static void jit_fixup(JitBuffer* jb, JitFixup** list, size_t* count, size_t* capacity, size_t target) {
+    if (*count == *capacity) {
+        size_t grown = *capacity ? *capacity * 2 : 32;
+        JitFixup* fixups = (JitFixup*)realloc(*list, grown * sizeof(JitFixup));
+        if (fixups == NULL) { jb->failed = 1; return; }
+        *list = fixups;
+        *capacity = grown;
+    }
+    (*list)[*count].at = jb->size;
+    (*list)[*count].target = target;
+    (*count)++;
+    jit_u32(jb, 0);
+}
+
+static void sse_prefix(JitBuffer* jb, int prefix, int opcode, int reg, int rm) {
+    if (prefix != 0) jit_byte(jb, (unsigned char)prefix);
+    if (reg >= 8 || rm >= 8) jit_byte(jb, (unsigned char)(0x40 | (reg >= 8 ? 4 : 0) | (rm >= 8 ? 1 : 0)));
+    jit_byte(jb, 0x0F);
+    jit_byte(jb, (unsigned char)opcode);
+}
+
+// op xmm(reg), xmm(rm)
+static void sse_reg(JitBuffer* jb, int prefix, int opcode, int reg, int rm) {
+    sse_prefix(jb, prefix, opcode, reg, rm);
+    jit_byte(jb, (unsigned char)(0xC0 | (reg & 7) << 3 | (rm & 7)));
+}
+
+// op xmm(reg), [rsp + offset] (or the reverse for stores)
+static void sse_frame(JitBuffer* jb, int prefix, int opcode, int reg, int offset) {
+    sse_prefix(jb, prefix, opcode, reg, 0);
+    jit_byte(jb, (unsigned char)(0x84 | (reg & 7) << 3)); // [SIB + disp32]
+    jit_byte(jb, 0x24);                                   // base rsp, no index
+    jit_u32(jb, (uint32_t)offset);
+}
+
+// op xmm(reg), [rip + pool + offset]
+static void sse_pool(JitBuffer* jb, JitFixup** refs, size_t* count, size_t* capacity, int prefix, int opcode, int reg, size_t offset) {
+    sse_prefix(jb, prefix, opcode, reg, 0);
+    jit_byte(jb, (unsigned char)(0x05 | (reg & 7) << 3));
+    jit_fixup(jb, refs, count, capacity, offset);
+}
+
+// Wrappers for the operations with integer operands or a failure status
+static double jit_mod(double a, double b) { return expr_apply_op(OP_MOD, a, b); }
+static double jit_binom(double a, double b) { return expr_apply_op(OP_BINOM, a, b); }
+static double jit_fact(double a, double b) { return expr_apply_op(OP_FACT, a, b); }
+static double jit_tan(double a, double b) { return expr_apply_op(OP_TAN, a, b); }
+static double jit_cot(double a, double b) { return expr_apply_op(OP_COT, a, b); }
+static double jit_log(double a, double b) { (void)b; return log(a); } // Domain checked inline
+
+static uint64_t jit_target(unsigned char op) {
+    double (*unary)(double) = NULL;
+    double (*binary)(double, double) = NULL;
+    switch (op) {
+    case OP_MOD: binary = jit_mod; break;
+    case OP_POW: binary = calc_power; break;
+    case OP_HYP: binary = calc_hypot; break;
+    case OP_BINOM: binary = jit_binom; break;
+    case OP_EXP: unary = calc_exp; break;
+    case OP_LOG: binary = jit_log; break;
+    case OP_FACT: binary = jit_fact; break;
+    case OP_SIN: unary = calc_sin; break;
+    case OP_COS: unary = calc_cos; break;
+    case OP_TAN: binary = jit_tan; break;
+    case OP_COT: binary = jit_cot; break;
+    }
+    return unary != NULL ? (uint64_t)(uintptr_t)unary : (uint64_t)(uintptr_t)binary;
+}
+
+static void* jit_map(const unsigned char* code, size_t size, size_t* mapped) {
+#if defined(_WIN32)
+    DWORD old_protect;
+    void* memory = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (memory == NULL) return NULL;
+    memcpy(memory, code, size);
+    if (!VirtualProtect(memory, size, PAGE_EXECUTE_READ, &old_protect)) {
+        VirtualFree(memory, 0, MEM_RELEASE);
+        return NULL;
+    }
+    FlushInstructionCache(GetCurrentProcess(), memory, size);
+    *mapped = size;
+    return memory;
+#else
+    // Written first, then made executable: never writable and executable at once
+    long page = sysconf(_SC_PAGESIZE);
+    size_t length = (size + (size_t)page - 1) & ~((size_t)page - 1);
+    void* memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return NULL;
+    memcpy(memory, code, size);
+    if (mprotect(memory, length, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, length);
+        return NULL;
+    }
+    *mapped = length;
+    return memory;
+#endif
+}
+
+int expr_native_compile(const unsigned char* code, const double* constants, int max_depth, ExprNative* native) {
+    JitBuffer jb;
+    JitFixup* refs = NULL;
+    size_t ref_count = 0, ref_capacity = 0;
+    size_t done, fail, pool;
+    size_t constant_count = 0;
+    const unsigned char* pc = code;
+    int depth = 0;
+    int ok = 0;
+
+    native->entry = NULL;
+    native->memory = NULL;
+    native->size = 0;
+    if (max_depth < 1 || max_depth > JIT_SLOTS) return 0;
+    memset(&jb, 0, sizeof(jb));
+
+    // Prologue: sub rsp, frame; save the callee-saved registers in use; store R and P
+    jit_byte(&jb, 0x48); jit_byte(&jb, 0x81); jit_byte(&jb, 0xEC); jit_u32(&jb, JIT_FRAME_SIZE);
+#if defined(_WIN32)
+    for (int reg = 6; reg < JIT_SLOT_REG(max_depth); reg++) sse_frame(&jb, SSE_MOVUPS_STORE, reg, JIT_SAVE_OFFSET + 16 * (reg - 6));
+#endif
+    sse_frame(&jb, SSE_MOVSD_STORE, 0, JIT_R_OFFSET);
+    sse_frame(&jb, SSE_MOVSD_STORE, 1, JIT_P_OFFSET);
+#if defined(_WIN32)
+    jit_byte(&jb, 0x4C); jit_byte(&jb, 0x89); jit_byte(&jb, 0x84); // mov [rsp + disp32], r8
+#else
+    jit_byte(&jb, 0x48); jit_byte(&jb, 0x89); jit_byte(&jb, 0xBC); // mov [rsp + disp32], rdi
+#endif
+    jit_byte(&jb, 0x24); jit_u32(&jb, JIT_VARS_OFFSET);
+
+    for (;;) {
+        unsigned char op = *pc++;
+        int top = JIT_SLOT_REG(depth - 1);
+        if (op == OP_RET) {
+            sse_reg(&jb, SSE_MOVAPD, 0, top);
+            break;
+        }
+
+        switch (op) {
+        case OP_CONST: {
+            size_t index = (size_t)(pc[0] | (pc[1] << 8));
+            pc += 2;
+            if (index + 1 > constant_count) constant_count = index + 1;
+            sse_pool(&jb, &refs, &ref_count, &ref_capacity, SSE_MOVSD_LOAD, JIT_SLOT_REG(depth), POOL_CONSTANTS + 8 * index);
+            depth++;
+            continue;
+        }
+        case OP_VAR: {
+            uint32_t index = (uint32_t)pc[0] | (uint32_t)pc[1] << 8 | (uint32_t)pc[2] << 16 | (uint32_t)pc[3] << 24;
+            int reg = JIT_SLOT_REG(depth);
+            pc += 4;
+            // mov rax, [rsp + vars]; movsd xmm, [rax + 8 * index]
+            jit_byte(&jb, 0x48); jit_byte(&jb, 0x8B); jit_byte(&jb, 0x84); jit_byte(&jb, 0x24); jit_u32(&jb, JIT_VARS_OFFSET);
+            if (index > 0x0FFFFFFFu) jb.failed = 1; // Beyond a 32-bit displacement
+            sse_prefix(&jb, SSE_MOVSD_LOAD, reg, 0);
+            jit_byte(&jb, (unsigned char)(0x80 | (reg & 7) << 3)); // [rax + disp32]
+            jit_u32(&jb, index * 8);
+            depth++;
+            continue;
+        }
+        case OP_R: case OP_P:
+            sse_frame(&jb, SSE_MOVSD_LOAD, JIT_SLOT_REG(depth), op == OP_R ? JIT_R_OFFSET : JIT_P_OFFSET);
+            depth++;
+            continue;
+        case OP_NEG:
+            sse_pool(&jb, &refs, &ref_count, &ref_capacity, SSE_XORPD, top, POOL_SIGN_MASK);
+            continue;
+        case OP_ADD: sse_reg(&jb, SSE_ADDSD, top - 1, top); depth--; continue;
+        case OP_SUB: sse_reg(&jb, SSE_SUBSD, top - 1, top); depth--; continue;
+        case OP_MUL: sse_reg(&jb, SSE_MULSD, top - 1, top); depth--; continue;
+        case OP_DIV:
+            // A zero divisor fails; a NaN one (unordered, PF set) divides normally
+            sse_reg(&jb, SSE_XORPD, 0, 0);
+            sse_reg(&jb, SSE_UCOMISD, top, 0);
+            jit_byte(&jb, JCC_P - 0x10); jit_byte(&jb, 6);
+            jit_byte(&jb, 0x0F); jit_byte(&jb, JCC_E); jit_fixup(&jb, &jb.fixups, &jb.fixup_count, &jb.fixup_capacity, 0);
+            sse_reg(&jb, SSE_DIVSD, top - 1, top);
+            depth--;
+            continue;
+        case OP_ABS:
+            sse_pool(&jb, &refs, &ref_count, &ref_capacity, SSE_ANDPD, top, POOL_ABS_MASK);
+            break;
+        default: {
+            int binary = op == OP_MOD || op == OP_POW || op == OP_HYP || op == OP_BINOM;
+            int first = depth - 1 - binary;
+            if (op == OP_LOG) {
+                // calc_log() fails for x <= 0; NaN goes on to log(), which returns it
+                sse_reg(&jb, SSE_XORPD, 0, 0);
+                sse_reg(&jb, SSE_UCOMISD, top, 0);
+                jit_byte(&jb, JCC_P - 0x10); jit_byte(&jb, 6);
+                jit_byte(&jb, 0x0F); jit_byte(&jb, JCC_BE); jit_fixup(&jb, &jb.fixups, &jb.fixup_count, &jb.fixup_capacity, 0);
+            }
+            for (int slot = 0; slot < first; slot++) sse_frame(&jb, SSE_MOVSD_STORE, JIT_SLOT_REG(slot), JIT_SPILL_OFFSET + 8 * slot);
+            sse_reg(&jb, SSE_MOVAPD, 0, JIT_SLOT_REG(first));
+            if (binary) sse_reg(&jb, SSE_MOVAPD, 1, top);
+            // mov rax, target; call rax
+            jit_byte(&jb, 0x48); jit_byte(&jb, 0xB8); jit_u64(&jb, jit_target(op));
+            jit_byte(&jb, 0xFF); jit_byte(&jb, 0xD0);
+            sse_reg(&jb, SSE_MOVAPD, JIT_SLOT_REG(first), 0);
+            for (int slot = 0; slot < first; slot++) sse_frame(&jb, SSE_MOVSD_LOAD, JIT_SLOT_REG(slot), JIT_SPILL_OFFSET + 8 * slot);
+            depth = first + 1;
+            top = JIT_SLOT_REG(first);
+            break;
+        }
+        }
+
+        // Like the interpreter, a NaN result of these operations fails the whole expression
+        sse_reg(&jb, SSE_UCOMISD, top, top);
+        jit_byte(&jb, 0x0F); jit_byte(&jb, JCC_P); jit_fixup(&jb, &jb.fixups, &jb.fixup_count, &jb.fixup_capacity, 0);
+    }
+
+    // Epilogue, then the failure exit that returns NAN through it
+    done = jb.size;
+#if defined(_WIN32)
+    for (int reg = 6; reg < JIT_SLOT_REG(max_depth); reg++) sse_frame(&jb, SSE_MOVUPS_LOAD, reg, JIT_SAVE_OFFSET + 16 * (reg - 6));
+#endif
+    jit_byte(&jb, 0x48); jit_byte(&jb, 0x81); jit_byte(&jb, 0xC4); jit_u32(&jb, JIT_FRAME_SIZE);
+    jit_byte(&jb, 0xC3);
+    fail = jb.size;
+    sse_pool(&jb, &refs, &ref_count, &ref_capacity, SSE_MOVSD_LOAD, 0, POOL_NAN);
+    jit_byte(&jb, 0xE9); jit_u32(&jb, (uint32_t)(done - (jb.size + 4)));
+
+    // Constant pool
+    while (jb.size % 16 != 0) jit_byte(&jb, 0xCC);
+    pool = jb.size;
+    jit_u64(&jb, UINT64_C(0x8000000000000000)); jit_u64(&jb, 0);
+    jit_u64(&jb, UINT64_C(0x7FFFFFFFFFFFFFFF)); jit_u64(&jb, 0);
+    {
+        double nan_value = NAN;
+        uint64_t bits;
+        memcpy(&bits, &nan_value, sizeof(bits));
+        jit_u64(&jb, bits); jit_u64(&jb, 0);
+    }
+    for (size_t i = 0; i < constant_count; i++) {
+        uint64_t bits;
+        memcpy(&bits, &constants[i], sizeof(bits));
+        jit_u64(&jb, bits);
+    }
+
+    if (!jb.failed) {
+        for (size_t i = 0; i < jb.fixup_count; i++) jit_patch32(&jb, jb.fixups[i].at, (uint32_t)(fail - (jb.fixups[i].at + 4)));
+        for (size_t i = 0; i < ref_count; i++) jit_patch32(&jb, refs[i].at, (uint32_t)(pool + refs[i].target - (refs[i].at + 4)));
+        native->memory = jit_map(jb.code, jb.size, &native->size);
+        if (native->memory != NULL) {
+            // Object to function pointer: conditionally supported, fine on every x86-64 target
+            native->entry = (ExprNativeFn)(uintptr_t)native->memory;
+            ok = 1;
+        }
+    }
+    free(jb.code);
+    free(jb.fixups);
+    free(refs);
+    return ok;
+}
+
+void expr_native_free(ExprNative* native) {
+    if (native->memory == NULL) return;
+#if defined(_WIN32)
+    VirtualFree(native->memory, 0, MEM_RELEASE);
+#else
+    munmap(native->memory, native->size);
+#endif
+    native->entry = NULL;
+    native->memory = NULL;
+    native->size = 0;
+}
+
+#endif
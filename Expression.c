@@ -0,0 +1,683 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Expression.h"
+#include "ExprCode.h"
+#include "Parse.h"
+#include <ctype.h>
+
+// Deepest nesting accepted by the parser (protects the C stack)
+#define EXPR_MAX_DEPTH 200
+// Largest syntax tree accepted (code generation recurses over the tree)
+#define EXPR_MAX_NODES 4096
+// Size of one arena block for the syntax tree
+#define EXPR_ARENA_BLOCK 4096
+
+struct CompiledExpr {
+    unsigned char* code;
+    double* constants;
+    double* lows;      // Low parts of the constants (see ExprNode)
+    size_t code_size;
+    size_t constant_count;
+    long* vars;   // Variables read, in order of first use
+    size_t var_count;
+    int uses;     // EXPR_USES_R | EXPR_USES_P | EXPR_USES_VARS
+    int max_depth;
+    ExprNative native; // Set by expr_jit()
+    int check;         // Run the interpreter too and compare (CALC_JIT=check)
+};
+
+typedef struct {
+    const char* name;
+    unsigned char op;
+    int arity;
+} ExprFunction;
+
+static const ExprFunction expr_functions[] = {
+    { "add", OP_ADD, 2 },      { "sub", OP_SUB, 2 },      { "subtract", OP_SUB, 2 },
+    { "mul", OP_MUL, 2 },      { "multiply", OP_MUL, 2 }, { "div", OP_DIV, 2 },
+    { "divide", OP_DIV, 2 },   { "mod", OP_MOD, 2 },      { "remainder", OP_MOD, 2 },
+    { "exp", OP_EXP, 1 },      { "log", OP_LOG, 1 },      { "abs", OP_ABS, 1 },
+    { "pow", OP_POW, 2 },      { "power", OP_POW, 2 },    { "fact", OP_FACT, 1 },
+    { "factorial", OP_FACT, 1 }, { "sin", OP_SIN, 1 },    { "cos", OP_COS, 1 },
+    { "tan", OP_TAN, 1 },      { "cot", OP_COT, 1 },      { "hypot", OP_HYP, 2 },
+    { "hyp", OP_HYP, 2 },      { "binom", OP_BINOM, 2 },  { "choose", OP_BINOM, 2 }
+};
+
+
+// --- Syntax tree arena ---
+
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t used;
+    size_t size;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock* head;
+} Arena;
+
+#define ARENA_ALIGN 16
+#define ARENA_HEADER ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static void* arena_alloc(Arena* arena, size_t size) {
+    ArenaBlock* block = arena->head;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (block == NULL || block->size - block->used < size) {
+        size_t block_size = size > EXPR_ARENA_BLOCK ? size : EXPR_ARENA_BLOCK;
+        block = (ArenaBlock*)malloc(ARENA_HEADER + block_size);
+        if (block == NULL) return NULL;
+        block->next = arena->head;
+        block->used = 0;
+        block->size = block_size;
+        arena->head = block;
+    }
+    block->used += size;
+    return (unsigned char*)block + ARENA_HEADER + block->used - size;
+}
+
+static void arena_free(Arena* arena) {
+    while (arena->head != NULL) {
+        ArenaBlock* next = arena->head->next;
+        free(arena->head);
+        arena->head = next;
+    }
+}
+
+
+// --- Parser ---
+
+typedef struct ExprNode {
+    unsigned char op;
+    double value;             // For OP_CONST
+    double low;               // For OP_CONST: what a decimal literal has beyond value (parse_double_low())
+    long var;                 // For OP_VAR
+    struct ExprNode* left;
+    struct ExprNode* right;
+} ExprNode;
+
+typedef struct {
+    const char* source;
+    const char* pos;
+    ExprResolver resolve;     // NULL: no variables
+    void* resolve_context;
+    Arena arena;
+    ExprError error;
+    int depth;
+    int node_count;
+} Parser;
+
+static ExprNode* parse_expression(Parser* ps);
+
+static void parse_fail(Parser* ps, const char* at, const char* message) {
+    if (ps->error.message == NULL) {
+        ps->error.message = message;
+        ps->error.position = (size_t)(at - ps->source);
+    }
+}
+
+static void skip_spaces(Parser* ps) {
+    while (isspace((unsigned char)*ps->pos)) ps->pos++;
+}
+
+static ExprNode* new_node(Parser* ps, unsigned char op, ExprNode* left, ExprNode* right) {
+    ExprNode* node;
+    if (++ps->node_count > EXPR_MAX_NODES) {
+        parse_fail(ps, ps->pos, "Expression is too long");
+        return NULL;
+    }
+    node = (ExprNode*)arena_alloc(&ps->arena, sizeof(ExprNode));
+    if (node == NULL) {
+        parse_fail(ps, ps->pos, "Out of memory");
+        return NULL;
+    }
+    node->op = op;
+    node->value = 0.0;
+    node->low = 0.0;
+    node->var = 0;
+    node->left = left;
+    node->right = right;
+    return node;
+}
+
+static ExprNode* parse_literal(Parser* ps) {
+    const char* start = ps->pos;
+    double value = 0.0, low = 0.0;
+    ExprNode* node;
+
+    if (start[0] == '0' && (start[1] == 'x' || start[1] == 'X' || start[1] == 'b' || start[1] == 'B')) {
+        // Hexadecimal or binary literal, the expression form of calc_convert_base()
+        int radix = (start[1] == 'x' || start[1] == 'X') ? 16 : 2;
+        const char* p = start + 2;
+        for (;; p++) {
+            int digit;
+            if (isdigit((unsigned char)*p)) digit = *p - '0';
+            else if (isxdigit((unsigned char)*p)) digit = tolower((unsigned char)*p) - 'a' + 10;
+            else break;
+            if (digit >= radix) break;
+            value = value * radix + digit;
+        }
+        if (p == start + 2) {
+            parse_fail(ps, p, radix == 16 ? "Invalid hexadecimal format" : "Invalid binary digit");
+            return NULL;
+        }
+        ps->pos = p;
+    }
+    else {
+        // Only digits, '.', an exponent and its sign can be part of the number
+        size_t consumed, offset = 0;
+        CalcConvStatus status = parse_double_prefix(start, strspn(start, "0123456789.eE+-"), &value, &consumed, &offset);
+        if (status != CALC_CONV_OK) {
+            parse_fail(ps, start + offset, status == CALC_CONV_OVERFLOW ? "Number out of range" : "Invalid number");
+            return NULL;
+        }
+        low = parse_double_low(start, consumed, value);
+        ps->pos = start + consumed;
+    }
+
+    node = new_node(ps, OP_CONST, NULL, NULL);
+    if (node != NULL) {
+        node->value = value;
+        node->low = low;
+    }
+    return node;
+}
+
+static const ExprFunction* find_function(const char* name, size_t name_len) {
+    for (size_t i = 0; i < sizeof(expr_functions) / sizeof(expr_functions[0]); i++) {
+        if (strlen(expr_functions[i].name) == name_len && strncmp(expr_functions[i].name, name, name_len) == 0) {
+            return &expr_functions[i];
+        }
+    }
+    return NULL;
+}
+
+static ExprNode* parse_call(Parser* ps, const char* name, size_t name_len) {
+    const ExprFunction* fn = find_function(name, name_len);
+    ExprNode* args[2] = { NULL, NULL };
+    int count = 0;
+
+    if (fn == NULL) {
+        parse_fail(ps, name, "Unknown function");
+        return NULL;
+    }
+
+    ps->pos++; // '('
+    skip_spaces(ps);
+    if (*ps->pos != ')') {
+        for (;;) {
+            ExprNode* arg = parse_expression(ps);
+            if (arg == NULL) return NULL;
+            if (count < 2) args[count] = arg;
+            count++;
+            skip_spaces(ps);
+            if (*ps->pos != ',') break;
+            ps->pos++;
+        }
+    }
+    if (*ps->pos != ')') {
+        parse_fail(ps, ps->pos, "Expected ',' or ')'");
+        return NULL;
+    }
+    if (count != fn->arity) {
+        parse_fail(ps, name, fn->arity == 1 ? "Function takes one argument" : "Function takes two arguments");
+        return NULL;
+    }
+    ps->pos++;
+    return new_node(ps, fn->op, args[0], args[1]);
+}
+
+static ExprNode* parse_primary(Parser* ps) {
+    const char* start;
+    ExprNode* node = NULL;
+
+    skip_spaces(ps);
+    start = ps->pos;
+
+    if (isdigit((unsigned char)*start) || (*start == '.' && isdigit((unsigned char)start[1]))) {
+        node = parse_literal(ps);
+    }
+    else if (isalpha((unsigned char)*start) || *start == '_') {
+        size_t len;
+        while (isalnum((unsigned char)*ps->pos) || *ps->pos == '_') ps->pos++;
+        len = (size_t)(ps->pos - start);
+        skip_spaces(ps);
+        if (*ps->pos == '(') {
+            node = parse_call(ps, start, len);
+        }
+        else if (len == 1 && (*start == 'R' || *start == 'r')) {
+            node = new_node(ps, OP_R, NULL, NULL);
+        }
+        else if (len == 1 && (*start == 'P' || *start == 'p')) {
+            node = new_node(ps, OP_P, NULL, NULL);
+        }
+        else if (ps->resolve == NULL) {
+            parse_fail(ps, start, "Unknown symbol (use R, P or a function call)");
+        }
+        else {
+            long var = ps->resolve(ps->resolve_context, start, len);
+            if (var < 0 || var > 0x7FFFFFFFL) {
+                parse_fail(ps, start, "Unknown variable");
+            }
+            else {
+                node = new_node(ps, OP_VAR, NULL, NULL);
+                if (node != NULL) node->var = var;
+            }
+        }
+    }
+    else if (*start == '(') {
+        ps->pos++;
+        node = parse_expression(ps);
+        if (node == NULL) return NULL;
+        skip_spaces(ps);
+        if (*ps->pos != ')') {
+            parse_fail(ps, ps->pos, "Expected ')'");
+            return NULL;
+        }
+        ps->pos++;
+    }
+    else {
+        parse_fail(ps, start, *start == '\0' ? "Unexpected end of expression" : "Unexpected character");
+        return NULL;
+    }
+
+    // Postfix factorial
+    while (node != NULL) {
+        skip_spaces(ps);
+        if (*ps->pos != '!') break;
+        ps->pos++;
+        node = new_node(ps, OP_FACT, node, NULL);
+    }
+    return node;
+}
+
+static ExprNode* parse_unary(Parser* ps);
+
+static ExprNode* parse_power(Parser* ps) {
+    ExprNode* base = parse_primary(ps);
+    if (base == NULL) return NULL;
+    skip_spaces(ps);
+    if (*ps->pos == '^') {
+        ExprNode* exponent;
+        ps->pos++;
+        exponent = parse_unary(ps); // Right associative: 2^3^2 = 2^(3^2)
+        if (exponent == NULL) return NULL;
+        return new_node(ps, OP_POW, base, exponent);
+    }
+    return base;
+}
+
+static ExprNode* parse_unary(Parser* ps) {
+    ExprNode* node;
+    skip_spaces(ps);
+    if (++ps->depth > EXPR_MAX_DEPTH) {
+        parse_fail(ps, ps->pos, "Expression is nested too deeply");
+        return NULL;
+    }
+    if (*ps->pos == '-' || *ps->pos == '+') {
+        int negate = *ps->pos == '-';
+        ps->pos++;
+        node = parse_unary(ps);
+        if (node != NULL && negate) node = new_node(ps, OP_NEG, node, NULL);
+    }
+    else {
+        node = parse_power(ps);
+    }
+    ps->depth--;
+    return node;
+}
+
+static ExprNode* parse_term(Parser* ps) {
+    ExprNode* node = parse_unary(ps);
+    while (node != NULL) {
+        unsigned char op;
+        skip_spaces(ps);
+        if (*ps->pos == '*') op = OP_MUL;
+        else if (*ps->pos == '/') op = OP_DIV;
+        else if (*ps->pos == '%') op = OP_MOD;
+        else break;
+        ps->pos++;
+        ExprNode* right = parse_unary(ps);
+        if (right == NULL) return NULL;
+        node = new_node(ps, op, node, right);
+    }
+    return node;
+}
+
+static ExprNode* parse_expression(Parser* ps) {
+    ExprNode* node = parse_term(ps);
+    while (node != NULL) {
+        unsigned char op;
+        skip_spaces(ps);
+        if (*ps->pos == '+') op = OP_ADD;
+        else if (*ps->pos == '-') op = OP_SUB;
+        else break;
+        ps->pos++;
+        ExprNode* right = parse_term(ps);
+        if (right == NULL) return NULL;
+        node = new_node(ps, op, node, right);
+    }
+    return node;
+}
+
+
+// --- Operation semantics (shared by the constant folder, the VM and the JIT) ---
+
+double expr_apply_op(unsigned char op, double a, double b) {
+    double result = NAN;
+    long long remainder;
+
+    switch (op) {
+    case OP_NEG: return -a;
+    case OP_ADD: return calc_add(a, b);
+    case OP_SUB: return calc_subtract(a, b);
+    case OP_MUL: return calc_multiply(a, b);
+    case OP_DIV: calc_divide(a, b, &result); return result;
+    case OP_MOD:
+        // calc_remainder() works on integers; non-integer operands fail
+        if (a != floor(a) || b != floor(b) || fabs(a) >= 9.2e18 || fabs(b) >= 9.2e18) return NAN;
+        return calc_remainder((long long)a, (long long)b, &remainder) == CALC_OK ? (double)remainder : NAN;
+    case OP_POW: return calc_power(a, b);
+    case OP_HYP: return calc_hypot(a, b);
+    case OP_BINOM:
+        // calc_binomial() takes ints; the comparisons are false for NAN, and the infinities fail them
+        if (!(a >= INT_MIN && a <= INT_MAX && b >= INT_MIN && b <= INT_MAX) || a != floor(a) || b != floor(b)) return NAN;
+        calc_binomial((int)a, (int)b, &result);
+        return result;
+    case OP_EXP: return calc_exp(a);
+    case OP_LOG: calc_log(a, &result); return result;
+    case OP_ABS: return calc_abs(a);
+    case OP_FACT:
+        if (!(a >= INT_MIN && a <= INT_MAX) || a != floor(a)) return NAN;
+        calc_factorial((int)a, &result); // +inf above 170!
+        return result;
+    case OP_SIN: return calc_sin(a);
+    case OP_COS: return calc_cos(a);
+    case OP_TAN: calc_tan(a, &result); return result; // NAN marks the asymptote
+    case OP_COT: calc_cot(a, &result); return result;
+    }
+    return NAN;
+}
+
+
+// --- Code generation ---
+
+typedef struct {
+    unsigned char* code;
+    size_t code_size, code_capacity;
+    double* constants;
+    double* lows;
+    size_t constant_count, constant_capacity;
+    long* vars;
+    size_t var_count, var_capacity;
+    int depth, max_depth;
+    int uses;
+    int failed;
+} Emitter;
+
+/**
+ * @brief Folds operations whose operands are all constants into a single constant.
+ * Operations that fail are kept so that the failure happens at evaluation time.
+ */
+static void fold_constants(ExprNode* node) {
+    double value;
+    if (node->left == NULL) return;
+    fold_constants(node->left);
+    if (node->right != NULL) fold_constants(node->right);
+
+    if (node->left->op != OP_CONST || (node->right != NULL && node->right->op != OP_CONST)) return;
+    value = expr_apply_op(node->op, node->left->value, node->right != NULL ? node->right->value : 0.0);
+    if (isnan(value)) return;
+    node->op = OP_CONST;
+    node->value = value;
+    node->low = 0.0; // Folded in double
+    node->left = node->right = NULL;
+}
+
+static void emit_byte(Emitter* em, unsigned char byte) {
+    if (em->code_size == em->code_capacity) {
+        size_t capacity = em->code_capacity ? em->code_capacity * 2 : 64;
+        unsigned char* code = (unsigned char*)realloc(em->code, capacity);
+        if (code == NULL) { em->failed = 1; return; }
+        em->code = code;
+        em->code_capacity = capacity;
+    }
+    em->code[em->code_size++] = byte;
+}
+
+static void emit_constant(Emitter* em, double value, double low) {
+    size_t index;
+    for (index = 0; index < em->constant_count; index++) {
+        if (memcmp(&em->constants[index], &value, sizeof(double)) == 0 &&
+            memcmp(&em->lows[index], &low, sizeof(double)) == 0) break;
+    }
+    if (index == em->constant_count) {
+        if (index > 0xFFFF) { em->failed = 1; return; }
+        if (em->constant_count == em->constant_capacity) {
+            size_t capacity = em->constant_capacity ? em->constant_capacity * 2 : 16;
+            double* constants = (double*)realloc(em->constants, capacity * sizeof(double));
+            double* lows = constants != NULL ? (double*)realloc(em->lows, capacity * sizeof(double)) : NULL;
+            if (constants != NULL) em->constants = constants;
+            if (lows == NULL) { em->failed = 1; return; }
+            em->lows = lows;
+            em->constant_capacity = capacity;
+        }
+        em->lows[em->constant_count] = low;
+        em->constants[em->constant_count++] = value;
+    }
+    emit_byte(em, OP_CONST);
+    emit_byte(em, (unsigned char)(index & 0xFF));
+    emit_byte(em, (unsigned char)(index >> 8));
+}
+
+static void emit_variable(Emitter* em, long var) {
+    size_t index;
+    for (index = 0; index < em->var_count && em->vars[index] != var; index++) {}
+    if (index == em->var_count) {
+        if (em->var_count == em->var_capacity) {
+            size_t capacity = em->var_capacity ? em->var_capacity * 2 : 16;
+            long* vars = (long*)realloc(em->vars, capacity * sizeof(long));
+            if (vars == NULL) { em->failed = 1; return; }
+            em->vars = vars;
+            em->var_capacity = capacity;
+        }
+        em->vars[em->var_count++] = var;
+    }
+    emit_byte(em, OP_VAR);
+    for (int i = 0; i < 4; i++) emit_byte(em, (unsigned char)((unsigned long)var >> (8 * i)));
+    em->uses |= EXPR_USES_VARS;
+}
+
+static void emit_node(Emitter* em, const ExprNode* node) {
+    if (node->left != NULL) emit_node(em, node->left);
+    if (node->right != NULL) emit_node(em, node->right);
+
+    switch (node->op) {
+    case OP_CONST: emit_constant(em, node->value, node->low); em->depth++; break;
+    case OP_VAR: emit_variable(em, node->var); em->depth++; break;
+    case OP_R: case OP_P:
+        emit_byte(em, node->op);
+        em->uses |= node->op == OP_R ? EXPR_USES_R : EXPR_USES_P;
+        em->depth++;
+        break;
+    default:
+        emit_byte(em, node->op);
+        if (node->right != NULL) em->depth--; // Binary operations consume one extra operand
+        break;
+    }
+    if (em->depth > em->max_depth) em->max_depth = em->depth;
+}
+
+static CompiledExpr* compile(const char* source, ExprResolver resolve, void* context, int fold, ExprError* error) {
+    Parser ps;
+    Emitter em;
+    ExprNode* root;
+    CompiledExpr* expr = NULL;
+
+    memset(&ps, 0, sizeof(ps));
+    memset(&em, 0, sizeof(em));
+    ps.source = source;
+    ps.pos = source;
+    ps.resolve = resolve;
+    ps.resolve_context = context;
+
+    root = parse_expression(&ps);
+    if (root != NULL) {
+        skip_spaces(&ps);
+        if (*ps.pos != '\0') parse_fail(&ps, ps.pos, "Unexpected character");
+    }
+
+    if (ps.error.message == NULL) {
+        if (fold) fold_constants(root);
+        emit_node(&em, root);
+        emit_byte(&em, OP_RET);
+        if (em.failed) {
+            ps.error.message = "Out of memory";
+        }
+        else if (em.max_depth > EXPR_MAX_STACK) {
+            ps.error.message = "Expression is nested too deeply";
+        }
+        else {
+            // Code, constants with their low parts, and variables share one allocation, by decreasing alignment
+            expr = (CompiledExpr*)malloc(sizeof(CompiledExpr) + 2 * em.constant_count * sizeof(double) +
+                em.var_count * sizeof(long) + em.code_size);
+            if (expr == NULL) {
+                ps.error.message = "Out of memory";
+            }
+            else {
+                expr->constants = (double*)(expr + 1);
+                expr->lows = expr->constants + em.constant_count;
+                expr->vars = (long*)(expr->lows + em.constant_count);
+                expr->code = (unsigned char*)(expr->vars + em.var_count);
+                expr->constant_count = em.constant_count;
+                expr->var_count = em.var_count;
+                expr->code_size = em.code_size;
+                expr->uses = em.uses;
+                expr->max_depth = em.max_depth;
+                memset(&expr->native, 0, sizeof(expr->native));
+                expr->check = 0;
+                if (em.constant_count > 0) {
+                    memcpy(expr->constants, em.constants, em.constant_count * sizeof(double));
+                    memcpy(expr->lows, em.lows, em.constant_count * sizeof(double));
+                }
+                if (em.var_count > 0) memcpy(expr->vars, em.vars, em.var_count * sizeof(long));
+                memcpy(expr->code, em.code, em.code_size);
+            }
+        }
+    }
+
+    if (error != NULL) *error = ps.error;
+    free(em.code);
+    free(em.constants);
+    free(em.lows);
+    free(em.vars);
+    arena_free(&ps.arena);
+    return expr;
+}
+
+
+CompiledExpr* expr_compile(const char* source, ExprError* error) {
+    return compile(source, NULL, NULL, 1, error);
+}
+
+CompiledExpr* expr_compile_vars(const char* source, ExprResolver resolve, void* context, ExprError* error) {
+    return compile(source, resolve, context, 1, error);
+}
+
+CompiledExpr* expr_compile_unfolded(const char* source, ExprResolver resolve, void* context, ExprError* error) {
+    return compile(source, resolve, context, 0, error);
+}
+
+const unsigned char* expr_bytecode(const CompiledExpr* expr, const double** constants, const double** lows) {
+    *constants = expr->constants;
+    *lows = expr->lows;
+    return expr->code;
+}
+
+
+// --- Virtual machine ---
+
+static double interpret(const CompiledExpr* expr, double r, double p, const double* vars) {
+    double stack[EXPR_MAX_STACK];
+    double* sp = stack; // Points one past the top of the stack
+    const unsigned char* pc = expr->code;
+    const double* constants = expr->constants;
+
+    for (;;) {
+        unsigned char op = *pc++;
+        switch (op) {
+        case OP_RET: return sp[-1];
+        case OP_CONST: *sp++ = constants[pc[0] | (pc[1] << 8)]; pc += 2; break;
+        case OP_R: *sp++ = r; break;
+        case OP_P: *sp++ = p; break;
+        case OP_VAR:
+            *sp++ = vars[(unsigned long)pc[0] | (unsigned long)pc[1] << 8 | (unsigned long)pc[2] << 16 | (unsigned long)pc[3] << 24];
+            pc += 4;
+            break;
+        case OP_NEG: sp[-1] = -sp[-1]; break;
+        case OP_ADD: sp--; sp[-1] += sp[0]; break;
+        case OP_SUB: sp--; sp[-1] -= sp[0]; break;
+        case OP_MUL: sp--; sp[-1] *= sp[0]; break;
+        case OP_DIV:
+            sp--;
+            if (sp[0] == 0) return NAN;
+            sp[-1] /= sp[0];
+            break;
+        case OP_MOD: case OP_POW: case OP_HYP: case OP_BINOM:
+            sp--;
+            sp[-1] = expr_apply_op(op, sp[-1], sp[0]);
+            if (isnan(sp[-1])) return NAN;
+            break;
+        default:
+            sp[-1] = expr_apply_op(op, sp[-1], 0.0);
+            if (isnan(sp[-1])) return NAN;
+            break;
+        }
+    }
+}
+
+double expr_eval(const CompiledExpr* expr, double r, double p) {
+    return expr_eval_vars(expr, r, p, NULL);
+}
+
+double expr_eval_vars(const CompiledExpr* expr, double r, double p, const double* vars) {
+    double native, interpreted;
+    if (expr->native.entry == NULL) return interpret(expr, r, p, vars);
+    native = expr->native.entry(r, p, vars);
+    if (!expr->check) return native;
+    interpreted = interpret(expr, r, p, vars);
+    if (memcmp(&native, &interpreted, sizeof(double)) != 0) expr_native_mismatch();
+    return interpreted;
+}
+
+void expr_eval_many(const CompiledExpr* expr, const double* r, const double* p, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = expr_eval(expr, r[i], p[i]);
+    }
+}
+
+int expr_uses(const CompiledExpr* expr) {
+    return expr->uses;
+}
+
+size_t expr_variables(const CompiledExpr* expr, const long** vars) {
+    *vars = expr->vars;
+    return expr->var_count;
+}
+
+int expr_is_function(const char* name, size_t len) {
+    return find_function(name, len) != NULL;
+}
+
+int expr_jit(CompiledExpr* expr) {
+    int mode = expr_jit_mode();
+    if (expr->native.entry != NULL) return 1;
+    if (mode == EXPR_JIT_OFF) return 0;
+    if (!expr_native_compile(expr->code, expr->constants, expr->max_depth, &expr->native)) return 0;
+    expr->check = mode == EXPR_JIT_CHECK;
+    return 1;
+}
+
+void expr_free(CompiledExpr* expr) {
+    if (expr != NULL) expr_native_free(&expr->native);
+    free(expr);
+}
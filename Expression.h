@@ -0,0 +1,125 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <stddef.h>
+
+/*
+ * Infix expression language over the calculator operations, e.g. "hypot(sin(30), R^2) / log(P)".
+ *
+ *   Operators : + - * / % ^ (right associative), unary + and -, postfix ! (factorial)
+ *   Operands  : decimal numbers, 0x hexadecimal and 0b binary literals, R and P, and variables
+ *               when compiled with expr_compile_vars()
+ *   Functions : add sub mul div mod exp log abs pow fact binom sin cos tan cot hypot
+ *               (long names such as subtract, multiply, power, factorial, choose, hyp are accepted too)
+ *
+ * An expression is parsed into an arena-allocated syntax tree, constant-folded and compiled once
+ * into a compact stack bytecode. The compiled form can then be evaluated any number of times with
+ * different values of R and P. Failing operations (division by zero, log of a non-positive number,
+ * tan/cot asymptotes, ...) make the whole evaluation return NAN, like a failed nested operation.
+ * On x86-64, a formula evaluated many times can further be compiled to machine code (expr_jit()).
+ */
+
+typedef struct CompiledExpr CompiledExpr;
+
+typedef struct {
+    const char* message; // NULL when compilation succeeded
+    size_t position;     // Offset of the offending character in the source
+} ExprError;
+
+/**
+ * @brief Compiles an expression into bytecode.
+ * @param source The expression text.
+ * @param error Receives the error message and position on failure (may be NULL).
+ * @return The compiled expression (release it with expr_free()), or NULL on error.
+ */
+CompiledExpr* expr_compile(const char* source, ExprError* error);
+
+/**
+ * @brief Looks up a variable of an expression being compiled (see expr_compile_vars()).
+ * @param name The name (len characters, not '\0'-terminated).
+ * @return The index of the variable in the values passed to expr_eval_vars(), or -1 if there is
+ * no variable of that name.
+ */
+typedef long (*ExprResolver)(void* context, const char* name, size_t len);
+
+/**
+ * @brief Like expr_compile(), but names that are not R, P or a function call are variables,
+ * looked up with resolve(context, name, len) at compile time.
+ */
+CompiledExpr* expr_compile_vars(const char* source, ExprResolver resolve, void* context, ExprError* error);
+
+/**
+ * @brief Like expr_compile_vars() (resolve may be NULL), but constant subexpressions such as 1/3
+ * are kept as operations instead of being folded into a double, for an evaluation at another
+ * precision (see expr_eval_prec()) that computes them at that precision too.
+ */
+CompiledExpr* expr_compile_unfolded(const char* source, ExprResolver resolve, void* context, ExprError* error);
+
+/**
+ * @brief Evaluates a compiled expression that reads no variables.
+ * @param expr The compiled expression.
+ * @param r Value of the symbol R.
+ * @param p Value of the symbol P.
+ * @return The result, or NAN if an operation failed.
+ */
+double expr_eval(const CompiledExpr* expr, double r, double p);
+
+/**
+ * @brief Evaluates a compiled expression; vars holds the values of its variables by index.
+ */
+double expr_eval_vars(const CompiledExpr* expr, double r, double p, const double* vars);
+
+/**
+ * @brief Evaluates a compiled expression for n pairs of R/P values.
+ * @param r Values of R (n entries).
+ * @param p Values of P (n entries).
+ * @param out Receives the n results.
+ */
+void expr_eval_many(const CompiledExpr* expr, const double* r, const double* p, double* out, size_t n);
+
+// Symbols an expression reads, see expr_uses()
+#define EXPR_USES_R 1
+#define EXPR_USES_P 2
+#define EXPR_USES_VARS 4
+
+/**
+ * @brief Returns which of R, P and variables the expression reads (EXPR_USES_R | EXPR_USES_P |
+ * EXPR_USES_VARS, 0 for none). Subexpressions removed by constant folding do not count.
+ */
+int expr_uses(const CompiledExpr* expr);
+
+/**
+ * @brief Returns the number of distinct variables the expression reads and their indices (in
+ * *vars, in order of first use, valid as long as the expression).
+ */
+size_t expr_variables(const CompiledExpr* expr, const long** vars);
+
+/**
+ * @brief Returns 1 if name (len characters) is the name of an expression function.
+ */
+int expr_is_function(const char* name, size_t len);
+
+/**
+ * @brief Compiles the expression to native x86-64 code, which expr_eval() runs from then on:
+ * the operands stay in SSE registers, arithmetic is inlined and the transcendental operations
+ * are called directly, with results identical to the interpreter's down to the last bit.
+ * The environment variable CALC_JIT selects the mode: "off" keeps the interpreter, "check" runs
+ * both on every evaluation and returns the interpreter's result (see expr_jit_mismatches()).
+ * Not thread-safe with respect to concurrent evaluations of the same expression.
+ * @return 1 if native code is used, 0 if the interpreter stays (JIT off or unavailable on this
+ * platform, operand stack deeper than 14, no executable memory).
+ */
+int expr_jit(CompiledExpr* expr);
+
+/**
+ * @brief Returns how many evaluations in CALC_JIT=check mode found the native code and the
+ * interpreter disagreeing (all threads, since the start of the program).
+ */
+unsigned long expr_jit_mismatches(void);
+
+/**
+ * @brief Releases a compiled expression.
+ */
+void expr_free(CompiledExpr* expr);
+
+#endif // EXPRESSION_H
@@ -0,0 +1,282 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "BigInt.h"
+#include "Thread.h"
+
+/*
+ * n! = 2^e2 * prod p^e(p) over the odd primes p <= n, with Legendre's e(p) = sum floor(n / p^i).
+ * Writing every exponent in binary, the odd part is
+ *
+ *   prod_k Q_k^(2^k)    where Q_k is the product of the primes whose exponent has bit k set,
+ *
+ * evaluated from the top bit down as result = result^2 * Q_k. Each Q_k is a product of up to
+ * pi(n) primes computed by binary splitting, so that both operands of every multiplication have
+ * about the same size and the large ones reach the Karatsuba and NTT ranges of bigint_mul_bin().
+ * The two halves of the big product trees are computed in parallel threads; the power of two is
+ * applied at the end as a shift. Central binomial coefficients use the same machinery with the
+ * exponents e_n(p) - e_k(p) - e_(n-k)(p). With k' = min(k, n - k) small next to n, sieving up to n
+ * would cost far more than the result is worth: C(n, k) is then the product of n - k' + 1 ... n,
+ * each factor stripped of the primes of k'! (only primes up to k' are sieved), by binary splitting.
+ */
+
+// Products of up to this many primes are accumulated with single-limb multiplications
+#define PRODUCT_LEAF_FACTORS 32
+// Below this many primes, a product tree is not worth splitting across threads
+#define PRODUCT_PARALLEL_FACTORS 4096
+// C(n, k) with min(k, n - k) * BINOMIAL_RANGE_RATIO <= n is a product of the top factors of n!
+#define BINOMIAL_RANGE_RATIO 16
+
+/**
+ * @brief Lists the odd primes up to n with a sieve of the odd numbers (one byte each).
+ * @return The allocated list (*count entries), or NULL if memory ran out.
+ */
+static uint32_t* odd_primes(uint32_t n, size_t* count) {
+    size_t half = n / 2 + 1; // composite[i] describes 2i + 1
+    unsigned char* composite = (unsigned char*)calloc(half, 1);
+    uint32_t* primes;
+    size_t found = 0;
+
+    if (composite == NULL) return NULL;
+    for (size_t i = 1; i < half; i++) {
+        size_t p = 2 * i + 1;
+        if (composite[i]) continue;
+        if (p * p > n) break;
+        for (size_t j = p * p / 2; j < half; j += p) composite[j] = 1;
+    }
+    for (size_t i = 1; i < half; i++) {
+        if (2 * i + 1 <= n && !composite[i]) found++;
+    }
+    primes = (uint32_t*)malloc((found + 1) * sizeof(uint32_t));
+    if (primes != NULL) {
+        found = 0;
+        for (size_t i = 1; i < half; i++) {
+            if (2 * i + 1 <= n && !composite[i]) primes[found++] = (uint32_t)(2 * i + 1);
+        }
+        *count = found;
+    }
+    free(composite);
+    return primes;
+}
+
+// Exponent of the prime p in n!
+static uint32_t legendre(uint32_t n, uint32_t p) {
+    uint32_t e = 0;
+    for (uint64_t q = p; q <= n; q *= p) e += (uint32_t)(n / q);
+    return e;
+}
+
+// Exponent of 2 in n!
+static uint32_t two_exponent(uint32_t n) {
+    uint32_t e = n;
+    for (uint32_t m = n; m != 0; m &= m - 1) e--; // n minus its number of one bits
+    return e;
+}
+
+typedef struct {
+    const uint32_t* factors;
+    size_t count;
+    int depth;         // Levels of the tree that may still start a thread
+    uint32_t* result;  // Allocated product
+    size_t len;
+} ProductJob;
+
+/**
+ * @brief Multiplies job->count factors by binary splitting; job->result stays NULL if memory ran out.
+ */
+static void product_run(void* arg) {
+    ProductJob* job = (ProductJob*)arg;
+    ProductJob left, right;
+    CalcThread* thread = NULL;
+    size_t half = job->count / 2;
+
+    job->result = NULL;
+    if (job->count <= PRODUCT_LEAF_FACTORS) {
+        uint32_t* limbs = (uint32_t*)malloc((job->count + 1) * sizeof(uint32_t));
+        size_t len = 1;
+        if (limbs == NULL) return;
+        limbs[0] = 1;
+        for (size_t i = 0; i < job->count; i++) {
+            bigint_mul_1_bin(limbs, limbs, len, job->factors[i], 0);
+            len = bigint_trim(limbs, len + 1);
+        }
+        job->result = limbs;
+        job->len = len;
+        return;
+    }
+
+    left.factors = job->factors;
+    left.count = half;
+    right.factors = job->factors + half;
+    right.count = job->count - half;
+    left.depth = right.depth = job->depth - 1;
+    if (job->depth > 0 && job->count >= PRODUCT_PARALLEL_FACTORS) thread = calc_thread_start(product_run, &left);
+    if (thread == NULL) product_run(&left);
+    product_run(&right);
+    calc_thread_join(thread);
+
+    if (left.result != NULL && right.result != NULL) {
+        uint32_t* limbs = (uint32_t*)malloc((left.len + right.len) * sizeof(uint32_t));
+        if (limbs != NULL && bigint_mul_bin(limbs, left.result, left.len, right.result, right.len)) {
+            job->result = limbs;
+            job->len = bigint_trim(limbs, left.len + right.len);
+        }
+        else {
+            free(limbs);
+        }
+    }
+    free(left.result);
+    free(right.result);
+}
+
+// Levels of a product tree that start threads, enough to occupy every thread
+static int product_depth(void) {
+    int depth = 0;
+    while ((1 << depth) < calc_thread_count()) depth++;
+    return depth;
+}
+
+/**
+ * @brief Computes 2^shift * prod primes[i]^exponents[i].
+ */
+static int prime_power_product(const uint32_t* primes, const uint32_t* exponents, size_t count, uint32_t shift,
+    uint32_t** result, size_t* len) {
+    uint32_t max_exponent = 0, *selected, *value, *next = NULL;
+    size_t value_len = 1, next_len, words;
+    int top_bit = -1, depth = product_depth();
+
+    for (size_t i = 0; i < count; i++) {
+        if (exponents[i] > max_exponent) max_exponent = exponents[i];
+    }
+    while (top_bit < 31 && (max_exponent >> (top_bit + 1)) != 0) top_bit++;
+
+    selected = (uint32_t*)malloc((count + 1) * sizeof(uint32_t));
+    value = (uint32_t*)malloc(sizeof(uint32_t));
+    if (selected == NULL || value == NULL) { free(selected); free(value); return 0; }
+    value[0] = 1;
+
+    for (int k = top_bit; k >= 0; k--) {
+        ProductJob job;
+
+        if (value_len > 1 || value[0] != 1) {
+            next = (uint32_t*)malloc(2 * value_len * sizeof(uint32_t));
+            if (next == NULL || !bigint_mul_bin(next, value, value_len, value, value_len)) goto fail_next;
+            free(value);
+            value = next;
+            value_len = bigint_trim(value, 2 * value_len);
+        }
+
+        job.factors = selected;
+        job.count = 0;
+        job.depth = depth;
+        for (size_t i = 0; i < count; i++) {
+            if ((exponents[i] >> k) & 1) selected[job.count++] = primes[i];
+        }
+        product_run(&job);
+        if (job.result == NULL) goto fail;
+        next_len = value_len + job.len;
+        next = (uint32_t*)malloc(next_len * sizeof(uint32_t));
+        if (next == NULL || !bigint_mul_bin(next, value, value_len, job.result, job.len)) {
+            free(job.result);
+            goto fail_next;
+        }
+        free(job.result);
+        free(value);
+        value = next;
+        value_len = bigint_trim(value, next_len);
+    }
+    free(selected);
+
+    // Multiply by 2^shift: whole limbs first, then the remaining bits
+    words = shift / 32 + 1;
+    *result = (uint32_t*)calloc(value_len + words, sizeof(uint32_t));
+    if (*result == NULL) { free(value); return 0; }
+    for (size_t i = 0; i < value_len; i++) {
+        uint64_t shifted = (uint64_t)value[i] << (shift % 32);
+        (*result)[i + shift / 32] |= (uint32_t)shifted;
+        (*result)[i + shift / 32 + 1] = (uint32_t)(shifted >> 32);
+    }
+    *len = bigint_trim(*result, value_len + words);
+    free(value);
+    return 1;
+
+fail_next:
+    free(next);
+fail:
+    free(value);
+    free(selected);
+    return 0;
+}
+
+int bigint_factorial(uint32_t n, uint32_t** result, size_t* len) {
+    size_t count = 0;
+    uint32_t* primes = odd_primes(n, &count);
+    uint32_t* exponents = primes != NULL ? (uint32_t*)malloc((count + 1) * sizeof(uint32_t)) : NULL;
+    int ok = 0;
+
+    if (exponents != NULL) {
+        for (size_t i = 0; i < count; i++) exponents[i] = legendre(n, primes[i]);
+        ok = prime_power_product(primes, exponents, count, two_exponent(n), result, len);
+    }
+    free(primes);
+    free(exponents);
+    return ok;
+}
+
+/**
+ * @brief C(n, k) for k <= n - k as (n - k + 1) * ... * n / k!: every prime p <= k is divided out of
+ * the multiples of p among the factors as many times as it divides k! (the factors hold at least
+ * as many), and what remains is multiplied by binary splitting.
+ */
+static int binomial_range(uint32_t n, uint32_t k, uint32_t** result, size_t* len) {
+    size_t count = 0;
+    uint32_t* primes = odd_primes(k, &count);
+    uint32_t* factors = primes != NULL ? (uint32_t*)malloc(((size_t)k + 1) * sizeof(uint32_t)) : NULL;
+    uint32_t base = n - k + 1; // factors[i] = base + i
+    ProductJob job;
+
+    if (factors == NULL) { free(primes); return 0; }
+    for (uint32_t i = 0; i < k; i++) factors[i] = base + i;
+    for (size_t j = 0; j <= count; j++) {
+        uint32_t p = j == 0 ? 2 : primes[j - 1];
+        uint32_t e = j == 0 ? two_exponent(k) : legendre(k, p);
+        for (size_t i = (p - base % p) % p; i < k && e > 0; i += p) {
+            while (e > 0 && factors[i] % p == 0) {
+                factors[i] /= p;
+                e--;
+            }
+        }
+    }
+
+    job.factors = factors;
+    job.count = k;
+    job.depth = product_depth();
+    product_run(&job);
+    free(primes);
+    free(factors);
+    if (job.result == NULL) return 0;
+    *result = job.result;
+    *len = job.len;
+    return 1;
+}
+
+int bigint_binomial(uint32_t n, uint32_t k, uint32_t** result, size_t* len) {
+    size_t count = 0;
+    uint32_t* primes;
+    uint32_t* exponents;
+    int ok = 0;
+
+    if (k > n - k) k = n - k;
+    if ((uint64_t)k * BINOMIAL_RANGE_RATIO <= n) return binomial_range(n, k, result, len);
+    primes = odd_primes(n, &count);
+    exponents = primes != NULL ? (uint32_t*)malloc((count + 1) * sizeof(uint32_t)) : NULL;
+    if (exponents != NULL) {
+        for (size_t i = 0; i < count; i++) {
+            exponents[i] = legendre(n, primes[i]) - legendre(k, primes[i]) - legendre(n - k, primes[i]);
+        }
+        ok = prime_power_product(primes, exponents, count, two_exponent(n) - two_exponent(k) - two_exponent(n - k),
+            result, len);
+    }
+    free(primes);
+    free(exponents);
+    return ok;
+}
@@ -0,0 +1,369 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Format.h"
+#include "FormatPowers.h"
+#include <stdint.h>
+
+// Two decimal digits per entry
+static const char decimal_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint64_t powers_of_10[CALC_FIXED_MAX_DECIMALS + 1] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+    1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// Limbs of the largest double shifted into place (2^1024 needs 33)
+#define FORMAT_MAX_LIMBS 33
+
+typedef struct {
+    uint64_t hi, lo;
+} FormatU128;
+
+static FormatU128 mul_64x64(uint64_t a, uint64_t b) {
+    FormatU128 r;
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)a * b;
+    r.hi = (uint64_t)(product >> 64);
+    r.lo = (uint64_t)product;
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32, b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo;
+    uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    r.lo = (mid << 32) | (uint32_t)ll;
+    r.hi = a_hi * b_hi + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+    return r;
+}
+
+/**
+ * @brief n / 2^shift rounded half to even, from the exact remainder (n is below 2^117).
+ */
+static FormatU128 shift_round(FormatU128 n, int shift) {
+    FormatU128 q = { 0, 0 }, rem, half = { 0, 0 };
+    int up;
+
+    if (shift >= 128) return q; // Below half of 2^shift
+    if (shift >= 64) {
+        q.lo = n.hi >> (shift - 64);
+        rem.hi = n.hi & ((1ULL << (shift - 64)) - 1);
+        rem.lo = n.lo;
+    }
+    else {
+        q.hi = n.hi >> shift;
+        q.lo = (n.lo >> shift) | (n.hi << (64 - shift));
+        rem.hi = 0;
+        rem.lo = n.lo & ((1ULL << shift) - 1);
+    }
+    if (shift > 64) half.hi = 1ULL << (shift - 65);
+    else half.lo = 1ULL << (shift - 1);
+
+    if (rem.hi != half.hi) up = rem.hi > half.hi;
+    else if (rem.lo != half.lo) up = rem.lo > half.lo;
+    else up = (int)(q.lo & 1);
+    if (up && ++q.lo == 0) q.hi++;
+    return q;
+}
+
+/**
+ * @brief Writes the digits of value backwards, ending just before end; returns the first digit.
+ */
+static char* write_u64(uint64_t value, char* end) {
+    while (value >= 100) {
+        unsigned pair = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--end = decimal_pairs[pair + 1];
+        *--end = decimal_pairs[pair];
+    }
+    if (value >= 10) {
+        *--end = decimal_pairs[value * 2 + 1];
+        *--end = decimal_pairs[value * 2];
+    }
+    else {
+        *--end = (char)('0' + value);
+    }
+    return end;
+}
+
+/**
+ * @brief Like write_u64() for a radix-2^32 number of n limbs (destroyed), nine digits per division.
+ */
+static char* write_limbs(uint32_t* limbs, size_t n, char* end) {
+    n = bigint_trim(limbs, n);
+    while (n > 2) {
+        uint32_t group = bigint_divmod_1_bin(limbs, limbs, n, 1000000000);
+        char* group_end = end;
+        n = bigint_trim(limbs, n);
+        end = write_u64(group, end);
+        while (end > group_end - 9) *--end = '0';
+    }
+    return write_u64(n == 2 ? ((uint64_t)limbs[1] << 32) | limbs[0] : n == 1 ? limbs[0] : 0, end);
+}
+
+size_t format_fixed(double value, int decimals, char* buf) {
+    char digits[CALC_FIXED_MAX_CHARS];
+    char* end = digits + sizeof(digits);
+    char* first;
+    uint64_t bits, mantissa;
+    int biased, exponent, fraction_digits;
+    size_t count, len = 0;
+
+    if (decimals < 0) decimals = 0;
+    if (decimals > CALC_FIXED_MAX_DECIMALS) decimals = CALC_FIXED_MAX_DECIMALS;
+    memcpy(&bits, &value, sizeof(bits));
+    if (bits >> 63) buf[len++] = '-';
+    biased = (int)(bits >> 52) & 0x7FF;
+    mantissa = bits & ((1ULL << 52) - 1);
+    if (biased == 0x7FF) {
+        memcpy(buf + len, mantissa ? "nan" : "inf", 4);
+        return len + 3;
+    }
+    if (biased == 0) {
+        exponent = -1074;
+    }
+    else {
+        mantissa |= 1ULL << 52;
+        exponent = biased - 1075;
+    }
+
+    // |value| = mantissa * 2^exponent exactly
+    if (exponent < 0) {
+        // The digits of |value| * 10^decimals, rounded to an integer
+        FormatU128 q = shift_round(mul_64x64(mantissa, powers_of_10[decimals]), -exponent);
+        if (q.hi == 0) {
+            first = write_u64(q.lo, end);
+        }
+        else {
+            uint32_t limbs[4] = { (uint32_t)q.lo, (uint32_t)(q.lo >> 32), (uint32_t)q.hi, (uint32_t)(q.hi >> 32) };
+            first = write_limbs(limbs, 4, end);
+        }
+        fraction_digits = decimals;
+    }
+    else if (exponent <= 11) {
+        first = write_u64(mantissa << exponent, end);
+        fraction_digits = 0;
+    }
+    else {
+        uint32_t limbs[FORMAT_MAX_LIMBS] = { 0 };
+        int word = exponent / 32, bit = exponent % 32;
+        limbs[word] = (uint32_t)(mantissa << bit);
+        limbs[word + 1] = (uint32_t)(mantissa >> (32 - bit));
+        limbs[word + 2] = bit ? (uint32_t)(mantissa >> (64 - bit)) : 0;
+        first = write_limbs(limbs, FORMAT_MAX_LIMBS, end);
+        fraction_digits = 0;
+    }
+
+    count = (size_t)(end - first);
+    if (count <= (size_t)fraction_digits) {
+        // Below 1: "0." and the leading zeros of the fraction
+        buf[len++] = '0';
+        buf[len++] = '.';
+        memset(buf + len, '0', (size_t)fraction_digits - count);
+        len += (size_t)fraction_digits - count;
+        memcpy(buf + len, first, count);
+        len += count;
+    }
+    else {
+        size_t integer_digits = count - (size_t)fraction_digits;
+        memcpy(buf + len, first, integer_digits);
+        len += integer_digits;
+        if (decimals > 0) {
+            buf[len++] = '.';
+            memcpy(buf + len, first + integer_digits, (size_t)fraction_digits);
+            len += (size_t)fraction_digits;
+            memset(buf + len, '0', (size_t)(decimals - fraction_digits));
+            len += (size_t)(decimals - fraction_digits);
+        }
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+// --- Shortest round trip (Schubfach) ---
+
+#define SHORTEST_MIN_EXPONENT (-1074)    // Binary exponent of the subnormals
+#define SHORTEST_HIDDEN_BIT (1ULL << 52)
+#define SHORTEST_TINY_SIGNIFICAND 3      // Subnormals below it are handled apart
+#define SHORTEST_MASK_63 ((1ULL << 63) - 1)
+
+// floor(e * log10(2)), floor(e * log10(3/4 * 2)) and floor(e * log2(10)), exact in the range used
+static int floor_log10_pow2(int e) { return (int)(((int64_t)e * 661971961083LL) >> 41); }
+static int floor_log10_three_quarters_pow2(int e) { return (int)(((int64_t)e * 661971961083LL - 274743187321LL) >> 41); }
+static int floor_log2_pow10(int e) { return (int)(((int64_t)e * 913124641741LL) >> 38); }
+
+/**
+ * @brief cp * g / 2^127 rounded to odd, with g the 126-bit power of schubfach_powers (g1:g0).
+ */
+static uint64_t round_to_odd(uint64_t g1, uint64_t g0, uint64_t cp) {
+    uint64_t x1 = mul_64x64(g0, cp).hi;
+    FormatU128 y = mul_64x64(g1, cp);
+    uint64_t z = (y.lo >> 1) + x1;
+    uint64_t vbp = y.hi + (z >> 63);
+    return vbp | (((z & SHORTEST_MASK_63) + SHORTEST_MASK_63) >> 63);
+}
+
+/**
+ * @brief Finds the shortest decimal digits * 10^exponent that rounds to c * 2^q, the closest one to
+ * it if there are several (Giulietti, "The Schubfach way to render doubles"): the bounds of the
+ * rounding interval are scaled by a power of ten that leaves at most one multiple of 10 (or else
+ * two consecutive integers) inside, computed from 126-bit powers with rounding to odd.
+ */
+static void shortest_digits(int q, uint64_t c, uint64_t* digits, int* exponent) {
+    uint64_t out = c & 1, cb = c << 2, cbr = cb + 2, cbl, g1, g0, vb, vbl, vbr, s, t;
+    int k, h, upper_in, lower_in;
+    int64_t cmp;
+
+    if (c != SHORTEST_HIDDEN_BIT || q == SHORTEST_MIN_EXPONENT) {
+        cbl = cb - 2;
+        k = floor_log10_pow2(q);
+    }
+    else {
+        // A power of two: the interval below it is half as wide as the one above
+        cbl = cb - 1;
+        k = floor_log10_three_quarters_pow2(q);
+    }
+    h = q + floor_log2_pow10(-k) + 2;
+    g1 = schubfach_powers[2 * (-k - FORMAT_MIN_POW10)];
+    g0 = schubfach_powers[2 * (-k - FORMAT_MIN_POW10) + 1];
+    vb = round_to_odd(g1, g0, cb << h);
+    vbl = round_to_odd(g1, g0, cbl << h);
+    vbr = round_to_odd(g1, g0, cbr << h);
+
+    s = vb >> 2;
+    if (s >= 100) {
+        // One digit less, if a multiple of 10 is in the interval
+        uint64_t sp10 = s / 10 * 10, tp10 = sp10 + 10;
+        lower_in = vbl + out <= sp10 << 2;
+        upper_in = (tp10 << 2) + out <= vbr;
+        if (lower_in != upper_in) {
+            *digits = lower_in ? sp10 : tp10;
+            *exponent = k;
+            return;
+        }
+    }
+    t = s + 1;
+    lower_in = vbl + out <= s << 2;
+    upper_in = (t << 2) + out <= vbr;
+    *exponent = k;
+    if (lower_in != upper_in) {
+        *digits = lower_in ? s : t;
+        return;
+    }
+    // Both are in: the closer one, the even one on a tie
+    cmp = (int64_t)(vb - ((s + t) << 1));
+    *digits = cmp < 0 || (cmp == 0 && (s & 1) == 0) ? s : t;
+}
+
+size_t format_shortest(double value, char* buf) {
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* first;
+    uint64_t bits, fraction, c, decimal;
+    int biased, exponent, count, point;
+    size_t len = 0;
+
+    memcpy(&bits, &value, sizeof(bits));
+    biased = (int)(bits >> 52) & 0x7FF;
+    fraction = bits & (SHORTEST_HIDDEN_BIT - 1);
+    if (biased == 0x7FF) return format_fixed(value, 0, buf);
+    if (bits >> 63) buf[len++] = '-';
+    if (biased == 0 && fraction == 0) {
+        memcpy(buf + len, "0", 2);
+        return len + 1;
+    }
+
+    if (biased != 0) {
+        int shift = 1075 - biased;
+        c = SHORTEST_HIDDEN_BIT | fraction;
+        if (shift > 0 && shift < 53 && ((c >> shift) << shift) == c) {
+            // An integer below 2^53: its digits are the shortest
+            decimal = c >> shift;
+            exponent = 0;
+        }
+        else {
+            shortest_digits(-shift, c, &decimal, &exponent);
+        }
+    }
+    else if (fraction < SHORTEST_TINY_SIGNIFICAND) {
+        // The two smallest subnormals, whose intervals are too narrow for the scaling
+        decimal = fraction == 1 ? 5 : 1;
+        exponent = fraction == 1 ? -324 : -323;
+    }
+    else {
+        shortest_digits(SHORTEST_MIN_EXPONENT, fraction, &decimal, &exponent);
+    }
+    while (decimal % 10 == 0) {
+        decimal /= 10;
+        exponent++;
+    }
+    first = write_u64(decimal, end);
+    count = (int)(end - first);
+    point = exponent + count; // Digits before the decimal point
+
+    // Like printf("%.17g"): plain notation for decimal exponents -4 to 16, scientific otherwise
+    if (point > 17 || point < -3) {
+        int e = point - 1;
+        buf[len++] = *first;
+        if (count > 1) {
+            buf[len++] = '.';
+            memcpy(buf + len, first + 1, (size_t)count - 1);
+            len += (size_t)count - 1;
+        }
+        buf[len++] = 'e';
+        buf[len++] = e < 0 ? '-' : '+';
+        if (e < 0) e = -e;
+        // At least two exponent digits
+        end = buf + len + (e >= 100 ? 3 : 2);
+        if (write_u64((uint64_t)e, end) > buf + len) buf[len] = '0';
+        len = (size_t)(end - buf);
+    }
+    else if (point <= 0) {
+        buf[len++] = '0';
+        buf[len++] = '.';
+        memset(buf + len, '0', (size_t)-point);
+        len += (size_t)-point;
+        memcpy(buf + len, first, (size_t)count);
+        len += (size_t)count;
+    }
+    else if (point >= count) {
+        memcpy(buf + len, first, (size_t)count);
+        len += (size_t)count;
+        memset(buf + len, '0', (size_t)(point - count));
+        len += (size_t)(point - count);
+    }
+    else {
+        memcpy(buf + len, first, (size_t)point);
+        len += (size_t)point;
+        buf[len++] = '.';
+        memcpy(buf + len, first + point, (size_t)(count - point));
+        len += (size_t)(count - point);
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+int calc_output_decimals(void) {
+    // Holds the precision plus 2 once read (0: not yet); a race between threads only repeats the work
+    static volatile int cached = 0;
+    if (cached == 0) {
+        int decimals = 4;
+        const char* requested = getenv("CALC_DECIMALS");
+        if (requested != NULL && strcmp(requested, "shortest") == 0) {
+            decimals = CALC_DECIMALS_SHORTEST;
+        }
+        else if (requested != NULL && requested[0] >= '0' && requested[0] <= '9' && atoi(requested) <= CALC_FIXED_MAX_DECIMALS) {
+            decimals = atoi(requested);
+        }
+        cached = decimals + 2;
+    }
+    return cached - 2;
+}
+
+size_t format_result(double value, char* buf) {
+    int decimals = calc_output_decimals();
+    return decimals == CALC_DECIMALS_SHORTEST ? format_shortest(value, buf) : format_fixed(value, decimals, buf);
+}
@@ -0,0 +1,55 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stddef.h>
+
+/*
+ * Decimal text of doubles without any stdout involvement, for the front ends that print results
+ * by the million (batch, server, sweep). format_fixed() writes exactly what printf("%.*f") writes
+ * in the C locale, the exact binary value rounded half to even, but with 64-bit integer arithmetic
+ * (128-bit products for the fraction, limb division for numbers beyond 2^64) and two digits per
+ * table lookup instead of the general conversion of the C library. format_shortest() writes the
+ * fewest significant digits that read back as the same double (the closest such digits when there
+ * are several), found with the Schubfach algorithm from a table of 126-bit powers of ten.
+ *
+ * Not-a-number and infinities read "nan" and "inf", with a '-' when the sign bit is set.
+ */
+
+#define CALC_FIXED_MAX_DECIMALS 19
+#define CALC_FIXED_MAX_CHARS 330    // "-" + 309 integer digits + "." + 19 decimals
+#define CALC_SHORTEST_MAX_CHARS 24  // "-2.2250738585072014e-308"
+#define CALC_DECIMALS_SHORTEST (-1) // Precision of calc_output_decimals() that selects format_shortest()
+
+/**
+ * @brief Writes value with a fixed number of decimals, like printf("%.*f", decimals, value),
+ * and a terminating '\0'.
+ * @param decimals 0 to CALC_FIXED_MAX_DECIMALS (clamped).
+ * @param buf Buffer of at least CALC_FIXED_MAX_CHARS + 1 characters.
+ * @return The number of characters written.
+ */
+size_t format_fixed(double value, int decimals, char* buf);
+
+/**
+ * @brief Writes the shortest decimal form of value that reads back as the same double, in plain
+ * notation or in scientific notation where printf("%.17g") would use it (e.g. "0.1", "123456",
+ * "1e+21", "5e-324"), and a terminating '\0'.
+ * @param buf Buffer of at least CALC_SHORTEST_MAX_CHARS + 1 characters.
+ * @return The number of characters written.
+ */
+size_t format_shortest(double value, char* buf);
+
+/**
+ * @brief Returns the precision results are printed with: 4 decimals, or the value of the
+ * environment variable CALC_DECIMALS if set (0 to CALC_FIXED_MAX_DECIMALS, or "shortest" for
+ * CALC_DECIMALS_SHORTEST). Cached.
+ */
+int calc_output_decimals(void);
+
+/**
+ * @brief Writes a result with the precision of calc_output_decimals() and a terminating '\0'.
+ * @param buf Buffer of at least CALC_FIXED_MAX_CHARS + 1 characters.
+ * @return The number of characters written.
+ */
+size_t format_result(double value, char* buf);
+
+#endif // FORMAT_H
@@ -1,38 +1,87 @@
 #define _CRT_SECURE_NO_WARNINGS
-#include "calculator.h"
-
-// Helper constant for degree to radian conversion
-#define PI 3.14159265358979323846
-#define DEG_TO_RAD (PI / 180.0)
-
-/**
- * @brief Updates the result history: prev_result gets last_result, last_result gets new_result.
- * @param new_result The result of the latest calculation.
- */
-void update_results(double new_result) {
-    // Only update if the new result is a valid number
-    if (!isnan(new_result)) {
-        prev_result = last_result;
-        last_result = new_result;
-    }
-}
+#include "Calculator.h"
+#include "BaseConv.h"
+#include "Parse.h"
+#include "Matrix.h"
+#include "Stats.h"
+
+// Interactive front end: all the computing is done by CalcCore.c, this file only prompts and prints
+
+// Largest dimension of the matrices and vectors typed in the Matrix and Vector Operations menu
+#define MATRIX_INPUT_MAX 64
+// Longest row of numbers typed for a matrix or vector
+#define MATRIX_LINE_MAX 4096
+
+#if !defined(CALC_NO_STATS)
+// Operation of each Mathematical/Trigonometric Operations choice, for the statistics
+static const CalcOp math_stats_ops[12] = {
+    CALC_OP_COUNT, CALC_OP_ADD, CALC_OP_SUBTRACT, CALC_OP_MULTIPLY, CALC_OP_DIVIDE, CALC_OP_REMAINDER,
+    CALC_OP_EXP, CALC_OP_LOG, CALC_OP_ABS, CALC_OP_POWER, CALC_OP_FACTORIAL, CALC_OP_BINOMIAL
+};
+static const CalcOp trig_stats_ops[6] = {
+    CALC_OP_COUNT, CALC_OP_SIN, CALC_OP_COS, CALC_OP_TAN, CALC_OP_COT, CALC_OP_HYPOT
+};
+#endif
 
 /**
  * @brief Displays the main menu options to the user.
  */
-void display_menu() {
+void display_menu(const CalcContext* ctx) {
     printf("\n======================================================\n");
     printf("              Advanced Calculator Options\n");
     printf("======================================================\n");
     // Display both R and P (Previous Result)
-    printf("Last Result (R): %.4lf | Previous Result (P): %.4lf\n", last_result, prev_result);
+    printf("Last Result (R): %.4lf | Previous Result (P): %.4lf\n", ctx->last_result, ctx->prev_result);
     printf("1. Mathematical Operations (+, -, x, /, %%, exp, log, |x|, x^y, n!)\n");
     printf("2. Trigonometric Operations (sin, cos, tan, cot, hyp)\n");
     printf("3. Number System Conversions (Dec/Bin/Hex)\n");
-    printf("4. Clear/Restart Calculator\n");
-    printf("5. Exit Program\n");
+    printf("4. Expression Evaluation (e.g. hypot(sin(30), R^2) / log(P))\n");
+    printf("5. Matrix and Vector Operations (A+B, AxB, A^T, u.v, |v|, Ax=b)\n");
+    printf("6. Clear/Restart Calculator\n");
+    printf("7. Operation Statistics (Prometheus/JSON)\n");
+    printf("8. Exit Program\n");
     printf("------------------------------------------------------\n");
-    printf("Enter your choice (1-5): ");
+    printf("Enter your choice (1-8): ");
+}
+
+/**
+ * @brief Reads one whitespace-delimited word and parses it as a decimal integer (unlike
+ * scanf("%d"), "12abc" is an error). On failure the rest of the line is discarded.
+ * @param error_offset Receives the position of the offending character on failure.
+ */
+static CalcConvStatus read_integer(long long* value, size_t* error_offset) {
+    char input_buffer[64];
+    CalcConvStatus status;
+
+    *error_offset = 0;
+    if (scanf("%63s", input_buffer) != 1) {
+        while (getchar() != '\n');
+        return CALC_CONV_EMPTY;
+    }
+    status = parse_dec(input_buffer, strlen(input_buffer), value, error_offset);
+    if (status != CALC_CONV_OK) while (getchar() != '\n');
+    return status;
+}
+
+/**
+ * @brief Reads an integer operand in [min, max] (R/P/Nested Op are not available), printing why
+ * the input is invalid. The rest of the line is left to the caller on success.
+ * @return 1 on success, 0 if the input is invalid.
+ */
+static int get_integer_input(long long min, long long max, long long* value) {
+    size_t offset;
+    CalcConvStatus status = read_integer(value, &offset);
+
+    if (status != CALC_CONV_OK) {
+        printf("Invalid input (%s at position %zu).\n", calc_conv_status_message(status), offset + 1);
+        return 0;
+    }
+    if (*value < min || *value > max) {
+        while (getchar() != '\n');
+        printf("Invalid input (must be between %lld and %lld).\n", min, max);
+        return 0;
+    }
+    return 1;
 }
 
 /**
@@ -41,10 +90,9 @@ void display_menu() {
  * @return The valid choice selected by the user.
  */
 int get_menu_choice(int max_choice) {
-    int choice;
-    if (scanf("%d", &choice) != 1) {
-        // Clear input buffer on failure
-        while (getchar() != '\n');
+    long long choice;
+    size_t offset;
+    if (read_integer(&choice, &offset) != CALC_CONV_OK) {
         printf("Invalid input. Please enter a number.\n");
         return -1;
     }
@@ -55,7 +103,7 @@ int get_menu_choice(int max_choice) {
         printf("Invalid choice. Please enter a number between 1 and %d.\n", max_choice);
         return -1;
     }
-    return choice;
+    return (int)choice;
 }
 
 /**
@@ -66,36 +114,35 @@ int get_menu_choice(int max_choice) {
  * @param use_result_option Set to 1 to allow using 'R', 'P', or nested menus.
  * @return The double value entered, or NAN if input is invalid or a nested operation fails.
  */
-double get_double_input(const char* prompt, int use_result_option) {
-    char input_buffer[64];
-    double value = NAN;
-
+static void print_input_prompt(const CalcContext* ctx, const char* prompt, int use_result_option) {
     printf("%s", prompt);
     if (use_result_option) {
-        printf(" (or type 'R' for %.4lf / 'P' for %.4lf, or 1/2/3 for Nested Op): ", last_result, prev_result);
+        printf(" (or type 'R' for %.4lf / 'P' for %.4lf, or 1/2/3 for Nested Op): ", ctx->last_result, ctx->prev_result);
     }
     else {
         printf(": ");
     }
+}
 
-    // Read the line into a buffer
-    if (scanf("%63s", input_buffer) != 1) {
-        while (getchar() != '\n'); // Clear buffer
-        printf("Invalid input format.\n");
-        return NAN;
-    }
-    // Clear remaining input buffer
-    while (getchar() != '\n');
+/**
+ * @brief Interprets what was entered at the prompt of get_double_input(): R, P, a nested
+ * operation or a number.
+ */
+static double interpret_double_input(const CalcContext* ctx, const char* input_buffer, const char* prompt,
+    int use_result_option) {
+    double value = NAN;
+    size_t offset = 0;
+    CalcConvStatus status;
 
     if (use_result_option) {
         // 1. Check for R/P
         if (strcmp(input_buffer, "R") == 0 || strcmp(input_buffer, "r") == 0) {
-            printf("-> Using Last Result (R): %.4lf\n", last_result);
-            return last_result;
+            printf("-> Using Last Result (R): %.4lf\n", ctx->last_result);
+            return ctx->last_result;
         }
         if (strcmp(input_buffer, "P") == 0 || strcmp(input_buffer, "p") == 0) {
-            printf("-> Using Previous Result (P): %.4lf\n", prev_result);
-            return prev_result;
+            printf("-> Using Previous Result (P): %.4lf\n", ctx->prev_result);
+            return ctx->prev_result;
         }
 
         // 2. Check for Nested Menu Call
@@ -106,11 +153,11 @@ double get_double_input(const char* prompt, int use_result_option) {
 
             // Call the appropriate handler, which now returns a double
             switch (nested_choice) {
-            case 1: value = handle_math_operations(); break;
-            case 2: value = handle_trig_operations(); break;
+            case 1: value = handle_math_operations(ctx); break;
+            case 2: value = handle_trig_operations(ctx); break;
             case 3:
                 printf("Warning: Number conversions are integer-based and may lose precision when used as floating-point operands.\n");
-                value = handle_conversion_operations();
+                value = handle_conversion_operations(ctx);
                 break;
             }
 
@@ -121,249 +168,150 @@ double get_double_input(const char* prompt, int use_result_option) {
             else {
                 // Nested operation failed or user chose 'Back'. Retry main operand input.
                 printf("\nNested operation failed or cancelled. Please re-enter the required operand.\n");
-                return get_double_input(prompt, use_result_option);
+                return get_double_input(ctx, prompt, use_result_option);
             }
         }
     }
 
-    // 3. Attempt to convert the string to a double (Standard input)
-    if (sscanf(input_buffer, "%lf", &value) != 1) {
-        printf("Invalid input. Must be a number, 'R', 'P', or a nested menu choice (1, 2, or 3).\n");
+    // 3. Attempt to convert the string to a number (decimal, or 0x/0b integer)
+    status = parse_number(input_buffer, strlen(input_buffer), &value, &offset);
+    if (status != CALC_CONV_OK) {
+        printf("Invalid input (%s at position %zu). Must be a number, 'R', 'P', or a nested menu choice (1, 2, or 3).\n",
+            status == CALC_CONV_OVERFLOW ? "Number out of range" : calc_conv_status_message(status), offset + 1);
         return NAN;
     }
 
     return value;
 }
 
+double get_double_input(const CalcContext* ctx, const char* prompt, int use_result_option) {
+    char input_buffer[64];
 
-// --- Mathematical Operations Implementations ---
-
-double add(double a, double b) { return a + b; }
-double subtract(double a, double b) { return a - b; }
-double multiply(double a, double b) { return a * b; }
-double divide(double a, double b) {
-    if (b == 0) {
-        printf("Error: Division by zero!\n");
-        return NAN; // Not a Number
-    }
-    return a / b;
-}
-long long remainder_op(long long a, long long b) {
-    if (b == 0) {
-        printf("Error: Modulo by zero!\n");
-        return 0;
-    }
-    return a % b;
-}
-double exponential(double x) { return exp(x); }
-double logarithm(double x) {
-    if (x <= 0) {
-        printf("Error: Logarithm input must be positive.\n");
-        return NAN;
-    }
-    return log(x); // Natural logarithm
-}
-double abs_square_root(double x) {
-    // sqrt(x^2) is simply the absolute value of x
-    return fabs(x);
-}
-double power(double base, double exp) { return pow(base, exp); }
-
-/**
- * @brief Calculates the factorial of a non-negative integer n.
- * @param n The number to calculate the factorial of.
- * @return The factorial result (unsigned long long) or 0 for error.
- */
-unsigned long long factorial(int n) {
-    if (n < 0) {
-        printf("Error: Factorial is undefined for negative numbers.\n");
-        return 0;
-    }
-    if (n > 20) {
-        // Limit to prevent overflow for unsigned long long
-        printf("Error: Input too large for factorial (max 20).\n");
-        return 0;
-    }
-    if (n == 0) return 1;
-
-    unsigned long long result = 1;
-    for (int i = 1; i <= n; i++) {
-        result *= i;
-    }
-    return result;
-}
-
-
-// --- Trigonometric Operations Implementations (Using degrees) ---
-
-double sine_deg(double deg) {
-    return sin(deg * DEG_TO_RAD);
-}
-double cosine_deg(double deg) {
-    return cos(deg * DEG_TO_RAD);
-}
-double tangent_deg(double deg) {
-    double rad = deg * DEG_TO_RAD;
-    double tan_val = tan(rad);
-    // Check for values near 90 + 180*k (vertical asymptote)
-    if (fabs(cos(rad)) < 1e-9) {
-        printf("Warning: Tangent is undefined near 90 or 270 degrees.\n");
-        return NAN;
-    }
-    return tan_val;
-}
-double cotangent_deg(double deg) {
-    double tan_val = tangent_deg(deg);
-    if (isnan(tan_val)) {
-        // tan is undefined, check sin(rad)
-        if (fabs(sin(deg * DEG_TO_RAD)) < 1e-9) {
-            printf("Warning: Cotangent is undefined near 0 or 180 degrees.\n");
-            return NAN;
-        }
-        // If tan is undefined (cos is zero), cot is 0
-        return 0.0;
-    }
-    if (fabs(tan_val) < 1e-9) {
-        printf("Warning: Cotangent approaches infinity.\n");
+    print_input_prompt(ctx, prompt, use_result_option);
+    // Read the line into a buffer
+    if (scanf("%63s", input_buffer) != 1) {
+        while (getchar() != '\n'); // Clear buffer
+        printf("Invalid input format.\n");
         return NAN;
     }
-    return 1.0 / tan_val;
-}
-double hypotenuse(double a, double b) {
-    // Calculates sqrt(a^2 + b^2)
-    return hypot(a, b);
+    // Clear remaining input buffer
+    while (getchar() != '\n');
+    return interpret_double_input(ctx, input_buffer, prompt, use_result_option);
 }
 
 
-// --- Number System Conversion Implementations ---
+// --- Output Helpers ---
 
 /**
- * @brief Converts a decimal number to its binary string representation.
+ * @brief Prints the message of a failed operation.
+ * @return NAN, so that handlers can return the result of the call.
  */
-void dec_to_bin(long long dec) {
-    if (dec == 0) {
-        printf("Binary: 0\n");
-        return;
-    }
-
-    // Since a long long can be up to 64 bits, we need a buffer of about 65 chars
-    char binary_str[65];
-    int i = 0;
-    unsigned long long temp_dec = (unsigned long long)llabs(dec);
-
-    if (temp_dec == 0) {
-        printf("Binary: 0\n");
-        return;
-    }
-
-    while (temp_dec > 0 && i < 64) {
-        binary_str[i++] = (temp_dec % 2) + '0';
-        temp_dec /= 2;
-    }
-    binary_str[i] = '\0';
-
-    printf("Binary: %s", (dec < 0 ? "-" : ""));
-
-    // Print in reverse order
-    for (int j = i - 1; j >= 0; j--) {
-        printf("%c", binary_str[j]);
-    }
-    printf("\n");
+static double print_status_error(CalcStatus status) {
+    printf("Error: %s.\n", calc_status_message(status));
+    return NAN;
 }
 
-/**
- * @brief Converts a binary string to a decimal number.
- */
-long long bin_to_dec(const char* bin_str) {
-    long long dec = 0;
-    long long base = 1;
-    int len = (int)strlen(bin_str);
-
-    for (int i = len - 1; i >= 0; i--) {
-        if (bin_str[i] == '1') {
-            dec += base;
-        }
-        else if (bin_str[i] != '0') {
-            printf("Error: Invalid binary digit '%c'.\n", bin_str[i]);
-            return -1;
-        }
-        base *= 2;
-    }
-    return dec;
+static int write_to_stdout(void* context, const char* text, size_t len) {
+    (void)context;
+    return fwrite(text, 1, len, stdout) == len;
 }
 
 /**
- * @brief Converts a decimal number to its hexadecimal representation.
+ * @brief Prints a binary (from_base 2) or hexadecimal (16) string of any length converted to
+ * to_base (10, 2 or 16), or a decimal integer of any length (10) converted to binary or
+ * hexadecimal, or the error with the position (1-based) of the offending character.
+ * @return The value (rounded to double), or NAN after printing an error.
  */
-void dec_to_hex(long long dec) {
-    printf("Hexadecimal: %llX\n", dec);
+static double print_conversion(const char* str, int from_base, int to_base) {
+    const char* base_name = from_base == 16 ? "hexadecimal" : from_base == 10 ? "decimal" : "binary";
+    char* text;
+    double value;
+    size_t offset = 0;
+    CalcStatus status;
+    CALC_STATS_BEGIN(timer, from_base == 16 ? (to_base == 10 ? CALC_OP_HEX_TO_DEC : CALC_OP_HEX_TO_BIN)
+                            : from_base == 10 ? (to_base == 2 ? CALC_OP_DEC_TO_BIN : CALC_OP_DEC_TO_HEX)
+                                              : (to_base == 10 ? CALC_OP_BIN_TO_DEC : CALC_OP_BIN_TO_HEX));
+    status = calc_convert_base(str, strlen(str), from_base, to_base, &text, &value, &offset);
+    CALC_STATS_END(timer, status);
+
+    switch (status) {
+    case CALC_OK:
+        printf("%s: %s\n", to_base == 10 ? "Decimal" : to_base == 2 ? "Binary" : "Hexadecimal", text);
+        free(text);
+        return value;
+    case CALC_ERR_MISSING_DIGITS: printf("Error: Missing %s digits.\n", base_name); break;
+    case CALC_ERR_INVALID_DIGIT: printf("Error: Invalid %s digit '%c' at position %zu.\n", base_name, str[offset], offset + 1); break;
+    default: print_status_error(status); break;
+    }
+    return NAN;
 }
 
 /**
- * @brief Converts a hexadecimal string to a decimal number.
+ * @brief Reads a whitespace-delimited word of any length from stdin and discards the rest of the line.
+ * @return A newly allocated string (to be released with free()), or NULL if the line had no word.
  */
-long long hex_to_dec(const char* hex_str) {
-    long long dec;
-    // strtoll converts string to long long with base 16 (hex)
-    if (sscanf(hex_str, "%llx", &dec) != 1) {
-        printf("Error: Invalid hexadecimal format.\n");
-        return -1;
-    }
-    return dec;
-}
-
-/**
- * @brief Converts a hexadecimal string to a binary string representation.
- */
-void hex_to_bin(const char* hex_str) {
-    long long dec = hex_to_dec(hex_str);
-    if (dec != -1) {
-        printf("Decimal: %lld\n", dec); // Show intermediate decimal value
-        dec_to_bin(dec);
-    }
-}
-
-/**
- * @brief Converts a binary string to a hexadecimal representation.
- */
-void bin_to_hex(const char* bin_str) {
-    long long dec = bin_to_dec(bin_str);
-    if (dec != -1) {
-        printf("Decimal: %lld\n", dec); // Show intermediate decimal value
-        dec_to_hex(dec);
+static char* read_word_input(void) {
+    size_t len = 0, capacity = 64;
+    char* word = (char*)malloc(capacity);
+    int c;
+
+    if (word == NULL) return NULL;
+    while ((c = getchar()) == ' ' || c == '\t');
+    for (; c != EOF && c != '\n' && c != ' ' && c != '\t' && c != '\r'; c = getchar()) {
+        if (len + 1 == capacity) {
+            char* grown = (char*)realloc(word, capacity * 2);
+            if (grown == NULL) { free(word); word = NULL; break; }
+            word = grown;
+            capacity *= 2;
+        }
+        word[len++] = (char)c;
     }
+    while (c != EOF && c != '\n') c = getchar();
+    if (word != NULL && len == 0) { free(word); word = NULL; }
+    if (word != NULL) word[len] = '\0';
+    return word;
 }
 
 /**
  * @brief Handles the flow for Mathematical Operations sub-menu. Returns the result as a double.
  */
-double handle_math_operations() {
+double handle_math_operations(const CalcContext* ctx) {
     int math_choice;
     double a = NAN, b = NAN, result_d = NAN;
     long long a_ll, b_ll, result_ll;
-    int n;
+    int n, k;
+    CalcStatus status = CALC_OK;
 
     printf("\n--- Mathematical Operations ---\n");
     printf("1. Add (+)\n2. Subtract (-)\n3. Multiply (x)\n4. Divide ()\n");
     printf("5. Remainder (%%)\n6. Exponential (exp(x))\n7. Logarithmic (log(x))\n");
     printf("8. Absolute value of input (sqrt(x^2))\n9. Power (x^y)\n10. Factorial (n!)\n");
-    printf("11. Back to Previous Operation/Main Menu\n");
-    printf("Enter choice (1-11): ");
+    printf("11. Binomial coefficient (n choose k)\n12. Back to Previous Operation/Main Menu\n");
+    printf("Enter choice (1-12): ");
 
-    math_choice = get_menu_choice(11);
+    math_choice = get_menu_choice(12);
     // If choice is invalid or "Back", return NAN
-    if (math_choice == -1 || math_choice == 11) return NAN;
+    if (math_choice == -1 || math_choice == 12) return NAN;
 
     // Handle single-operand functions (exp, log, |x|)
     if (math_choice == 6 || math_choice == 7 || math_choice == 8) {
         // get_double_input allows R/P/Nested Ops
-        a = get_double_input("Enter a single number (x)", 1);
+        a = get_double_input(ctx, "Enter a single number (x)", 1);
         if (isnan(a)) return NAN;
 
+        CALC_STATS_BEGIN(timer, math_stats_ops[math_choice]);
         switch (math_choice) {
-        case 6: result_d = exponential(a); printf("exp(%.4lf) = %.4lf\n", a, result_d); break;
-        case 7: result_d = logarithm(a); printf("log(%.4lf) = %.4lf\n", a, result_d); break;
-        case 8: result_d = abs_square_root(a); printf("|%.4lf| (sqrt(x^2)) = %.4lf\n", a, result_d); break;
+        case 6: result_d = calc_exp(a); break;
+        case 7: status = calc_log(a, &result_d); break;
+        case 8: result_d = calc_abs(a); break;
+        }
+        CALC_STATS_END(timer, status);
+
+        if (status != CALC_OK) return print_status_error(status);
+        switch (math_choice) {
+        case 6: printf("exp(%.4lf) = %.4lf\n", a, result_d); break;
+        case 7: printf("log(%.4lf) = %.4lf\n", a, result_d); break;
+        case 8: printf("|%.4lf| (sqrt(x^2)) = %.4lf\n", a, result_d); break;
         }
         return result_d;
     }
@@ -371,61 +319,93 @@ double handle_math_operations() {
     // Handle Factorial (integer only) - Cannot use recursive get_double_input here
     if (math_choice == 10) {
         printf("Enter a non-negative integer (n): ");
-        if (scanf("%d", &n) != 1) { while (getchar() != '\n'); printf("Invalid input.\n"); return NAN; }
+        if (!get_integer_input(INT_MIN, INT_MAX, &a_ll)) return NAN;
         while (getchar() != '\n');
+        n = (int)a_ll;
+
+        // The exact digits are streamed (1000000! has 5.5 million of them); R/P get the rounded value.
+        // The time recorded for the statistics includes writing them.
+        CALC_STATS_BEGIN(timer, CALC_OP_FACTORIAL);
+        if (n < 0) status = CALC_ERR_FACTORIAL_DOMAIN;
+        else {
+            printf("%d! = ", n);
+            status = calc_write_factorial(n, write_to_stdout, NULL, &result_d);
+            printf("\n");
+        }
+        CALC_STATS_END(timer, status);
+        return status == CALC_OK ? result_d : print_status_error(status);
+    }
 
-        result_ll = factorial(n);
-        if (result_ll != 0) {
-            printf("%d! = %llu\n", n, result_ll);
-            return (double)result_ll;
+    // Handle Binomial coefficient (integer only) - Cannot use recursive get_double_input here
+    if (math_choice == 11) {
+        printf("Enter two non-negative integers (n choose k) - Note: R/P/Nested Op is NOT available for integer-only input.\n");
+        printf("Enter n: ");
+        if (!get_integer_input(INT_MIN, INT_MAX, &a_ll)) return NAN;
+        printf("Enter k: ");
+        if (!get_integer_input(INT_MIN, INT_MAX, &b_ll)) return NAN;
+        while (getchar() != '\n');
+        n = (int)a_ll;
+        k = (int)b_ll;
+
+        CALC_STATS_BEGIN(timer, CALC_OP_BINOMIAL);
+        if (n < 0 || k < 0 || k > n) status = CALC_ERR_BINOMIAL_DOMAIN;
+        else {
+            printf("C(%d, %d) = ", n, k);
+            status = calc_write_binomial(n, k, write_to_stdout, NULL, &result_d);
+            printf("\n");
         }
-        return NAN;
+        CALC_STATS_END(timer, status);
+        return status == CALC_OK ? result_d : print_status_error(status);
     }
 
     // Handle Remainder (integer only) - Cannot use recursive get_double_input here
     if (math_choice == 5) {
         printf("Enter two integers (a %% b) - Note: R/P/Nested Op is NOT available for integer-only input.\n");
         printf("Enter the first integer (a): ");
-        if (scanf("%lld", &a_ll) != 1) { while (getchar() != '\n'); printf("Invalid input.\n"); return NAN; }
+        if (!get_integer_input(LLONG_MIN, LLONG_MAX, &a_ll)) return NAN;
         printf("Enter the second integer (b): ");
-        if (scanf("%lld", &b_ll) != 1) { while (getchar() != '\n'); printf("Invalid input.\n"); return NAN; }
+        if (!get_integer_input(LLONG_MIN, LLONG_MAX, &b_ll)) return NAN;
         while (getchar() != '\n');
 
-        result_ll = remainder_op(a_ll, b_ll);
-        if (b_ll != 0) {
-            printf("%lld %% %lld = %lld\n", a_ll, b_ll, result_ll);
-            return (double)result_ll;
-        }
-        return NAN;
+        CALC_STATS_BEGIN(timer, CALC_OP_REMAINDER);
+        status = calc_remainder(a_ll, b_ll, &result_ll);
+        CALC_STATS_END(timer, status);
+        if (status != CALC_OK) return print_status_error(status);
+        printf("%lld %% %lld = %lld\n", a_ll, b_ll, result_ll);
+        return (double)result_ll;
     }
 
     // Handle two-operand floating-point functions (Add, Sub, Mul, Div, Pow)
     // get_double_input allows R/P/Nested Ops
-    a = get_double_input("Enter the first number (a)", 1);
+    a = get_double_input(ctx, "Enter the first number (a)", 1);
     if (isnan(a)) return NAN;
-    b = get_double_input("Enter the second number (b)", 1);
+    b = get_double_input(ctx, "Enter the second number (b)", 1);
     if (isnan(b)) return NAN;
 
+    CALC_STATS_BEGIN(timer, math_stats_ops[math_choice]);
     switch (math_choice) {
-    case 1: result_d = add(a, b); printf("%.4lf + %.4lf = %.4lf\n", a, b, result_d); break;
-    case 2: result_d = subtract(a, b); printf("%.4lf - %.4lf = %.4lf\n", a, b, result_d); break;
-    case 3: result_d = multiply(a, b); printf("%.4lf x %.4lf = %.4lf\n", a, b, result_d); break;
-    case 4: result_d = divide(a, b);
-        if (!isnan(result_d)) printf("%.4lf  %.4lf = %.4lf\n", a, b, result_d);
-        break;
-    case 9: result_d = power(a, b); printf("%.4lf ^ %.4lf = %.4lf\n", a, b, result_d); break;
-    default: result_d = NAN; // Should not happen
-    }
-
+    case 1: result_d = calc_add(a, b); break;
+    case 2: result_d = calc_subtract(a, b); break;
+    case 3: result_d = calc_multiply(a, b); break;
+    case 4: status = calc_divide(a, b, &result_d); break;
+    case 9: result_d = calc_power(a, b); break;
+    default: return NAN; // Should not happen
+    }
+    CALC_STATS_END(timer, status);
+
+    if (status != CALC_OK) return print_status_error(status);
+    // Operator symbol of each choice
+    printf("%.4lf %c %.4lf = %.4lf\n", a, " +-x    ^"[math_choice], b, result_d);
     return result_d;
 }
 
 /**
  * @brief Handles the flow for Trigonometric Operations sub-menu. Returns the result as a double.
  */
-double handle_trig_operations() {
+double handle_trig_operations(const CalcContext* ctx) {
     int trig_choice;
     double angle, a, b, result_d = NAN;
+    CalcStatus status = CALC_OK;
 
     printf("\n--- Trigonometric Operations ---\n");
     printf("NOTE: Angles are in degrees.\n");
@@ -441,44 +421,48 @@ double handle_trig_operations() {
     // Handle Hypotenuse (two-operand)
     if (trig_choice == 5) {
         // get_double_input allows R/P/Nested Ops
-        a = get_double_input("Enter side a", 1);
+        a = get_double_input(ctx, "Enter side a", 1);
         if (isnan(a)) return NAN;
-        b = get_double_input("Enter side b", 1);
+        b = get_double_input(ctx, "Enter side b", 1);
         if (isnan(b)) return NAN;
 
-        result_d = hypotenuse(a, b);
+        CALC_STATS_BEGIN(timer, CALC_OP_HYPOT);
+        result_d = calc_hypot(a, b);
+        CALC_STATS_END(timer, CALC_OK);
         printf("Hypotenuse of %.4lf and %.4lf is %.4lf\n", a, b, result_d);
         return result_d;
     }
 
     // Handle single-operand functions (angle in degrees)
     // get_double_input allows R/P/Nested Ops
-    angle = get_double_input("Enter the angle in degrees", 1);
+    angle = get_double_input(ctx, "Enter the angle in degrees", 1);
     if (isnan(angle)) return NAN;
 
+    CALC_STATS_BEGIN(timer, trig_stats_ops[trig_choice]);
     switch (trig_choice) {
-    case 1: result_d = sine_deg(angle); printf("sin(%.4lf) = %.4lf\n", angle, result_d); break;
-    case 2: result_d = cosine_deg(angle); printf("cos(%.4lf) = %.4lf\n", angle, result_d); break;
-    case 3: result_d = tangent_deg(angle);
-        if (!isnan(result_d)) printf("tan(%.4lf) = %.4lf\n", angle, result_d);
-        break;
-    case 4: result_d = cotangent_deg(angle);
-        if (!isnan(result_d)) printf("cot(%.4lf) = %.4lf\n", angle, result_d);
-        break;
-    default: result_d = NAN; // Should not happen
+    case 1: result_d = calc_sin(angle); break;
+    case 2: result_d = calc_cos(angle); break;
+    case 3: status = calc_tan(angle, &result_d); break;
+    case 4: status = calc_cot(angle, &result_d); break;
+    default: return NAN; // Should not happen
     }
+    CALC_STATS_END(timer, status);
 
+    if (status != CALC_OK) return print_status_error(status);
+    printf("%s(%.4lf) = %.4lf\n", trig_choice == 1 ? "sin" : trig_choice == 2 ? "cos" : trig_choice == 3 ? "tan" : "cot", angle, result_d);
     return result_d;
 }
 
 /**
  * @brief Handles the flow for Number System Conversion sub-menu. Returns the decimal equivalent as a double.
  */
-double handle_conversion_operations() {
+double handle_conversion_operations(const CalcContext* ctx) {
     int conv_choice;
-    char input_str[64];
-    long long dec_val = -1; // Use -1 as sentinel for failed conversion
+    char* input_str;
+    char digits[CALC_BIN_MAX_DIGITS + 2];
+    long long dec_val;
     double result_d = NAN;
+    CalcStatus status;
 
 
     printf("\n--- Number System Conversions ---\n");
@@ -492,51 +476,288 @@ double handle_conversion_operations() {
     // If choice is invalid or "Back", return NAN
     if (conv_choice == -1 || conv_choice == 7) return NAN;
 
-    // Conversions involving a decimal input (supports R/P/Nested Ops via get_double_input)
+    // Conversions involving a decimal input (supports R/P/Nested Ops like get_double_input)
     if (conv_choice == 1 || conv_choice == 3) {
-        // Use get_double_input but check that the value is an integer before conversion
-        double dec_d = get_double_input("Enter Decimal number (will be truncated to integer)", 1);
+        static const char prompt[] = "Enter Decimal number (will be truncated to integer)";
+        double dec_d;
+
+        // Read a word of any length: integers beyond 64 bits are converted digit by digit
+        print_input_prompt(ctx, prompt, 1);
+        input_str = read_word_input();
+        if (input_str == NULL) { printf("Invalid input format.\n"); return NAN; }
+        if (parse_dec(input_str, strlen(input_str), &dec_val, NULL) == CALC_CONV_OVERFLOW) {
+            result_d = print_conversion(input_str, 10, conv_choice == 1 ? 2 : 16);
+            free(input_str);
+            return result_d;
+        }
+        // Otherwise check that the value is an integer before conversion
+        dec_d = interpret_double_input(ctx, input_str, prompt, 1);
+        free(input_str);
         if (isnan(dec_d)) return NAN;
 
         // Truncate to long long for conversion
-        dec_val = (long long)dec_d;
-
-        switch (conv_choice) {
-        case 1: dec_to_bin(dec_val); break;
-        case 3: dec_to_hex(dec_val); break;
-        }
+        CALC_STATS_BEGIN(timer, conv_choice == 1 ? CALC_OP_DEC_TO_BIN : CALC_OP_DEC_TO_HEX);
+        status = calc_truncate_integer(dec_d, &dec_val);
+        if (status == CALC_OK && conv_choice == 1) calc_dec_to_bin(dec_val, digits);
+        else if (status == CALC_OK) calc_dec_to_hex(dec_val, digits);
+        CALC_STATS_END(timer, status);
+        if (status != CALC_OK) return print_status_error(status);
+        printf("%s: %s\n", conv_choice == 1 ? "Binary" : "Hexadecimal", digits);
         // Return the decimal value as a double
         result_d = (double)dec_val;
         return result_d;
     }
 
     // Conversions involving string inputs (Bin/Hex) - Cannot use recursive get_double_input here
+    // Strings of any length are accepted; more than 64 bits use the arbitrary-length conversions
     printf("Enter the number string: ");
-    if (scanf("%63s", input_str) != 1) { while (getchar() != '\n'); printf("Invalid input.\n"); return NAN; }
-    while (getchar() != '\n');
+    input_str = read_word_input();
+    if (input_str == NULL) { printf("Invalid input.\n"); return NAN; }
 
     switch (conv_choice) {
     case 2:
-        dec_val = bin_to_dec(input_str);
-        if (dec_val != -1) {
-            printf("Decimal: %lld\n", dec_val);
-            result_d = (double)dec_val;
-        }
-        break;
     case 4:
-        dec_val = hex_to_dec(input_str);
-        if (dec_val != -1) {
-            printf("Decimal: %lld\n", dec_val);
-            result_d = (double)dec_val;
-        }
+        result_d = print_conversion(input_str, conv_choice == 4 ? 16 : 2, 10);
         break;
     case 5:
-        hex_to_bin(input_str);
+        // Show the intermediate decimal value first; like before, R/P are not updated
+        if (!isnan(print_conversion(input_str, 16, 10))) print_conversion(input_str, 16, 2);
         break;
     case 6:
-        bin_to_hex(input_str);
+        if (!isnan(print_conversion(input_str, 2, 10))) print_conversion(input_str, 2, 16);
         break;
     }
 
+    free(input_str);
     return result_d;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Handles the flow for Expression Evaluation. Returns the result as a double.
+ * The expression is compiled to bytecode once and evaluated with the current R and P.
+ */
+double handle_expression_operations(const CalcContext* ctx) {
+    char input_str[1024];
+    ExprError error;
+    CalcStatus status;
+    double result_d;
+    size_t len;
+
+    printf("\n--- Expression Evaluation ---\n");
+    printf("Operators: + - * / %% ^ !  Functions: add sub mul div mod exp log abs pow fact binom sin cos tan cot hypot\n");
+    printf("Use R and P for the last and previous results. Angles are in degrees.\n");
+    printf("Enter expression: ");
+
+    if (fgets(input_str, sizeof(input_str), stdin) == NULL) return NAN;
+    len = strlen(input_str);
+    if (len > 0 && input_str[len - 1] == '\n') input_str[--len] = '\0';
+    else if (!feof(stdin)) { while (getchar() != '\n'); printf("Invalid input. Expression is too long.\n"); return NAN; }
+
+    CALC_STATS_BEGIN(timer, CALC_OP_EXPRESSION);
+    status = calc_eval(ctx, input_str, &result_d, &error);
+    CALC_STATS_END(timer, status);
+    if (status == CALC_ERR_SYNTAX) {
+        printf("  %s\n", input_str);
+        printf("  %*s^\n", (int)error.position, "");
+        printf("Error: %s.\n", error.message);
+        return NAN;
+    }
+    if (status != CALC_OK) return print_status_error(status);
+    printf("%s = %.4lf\n", input_str, result_d);
+    return result_d;
+}
+
+/**
+ * @brief Reads a dimension of a matrix or vector (1 to MATRIX_INPUT_MAX) and the rest of its line.
+ * @return 1 on success, 0 if the input was invalid (the reason has been printed).
+ */
+static int read_dimension(const char* prompt, size_t* value) {
+    long long n;
+    printf("%s (1-%d): ", prompt, MATRIX_INPUT_MAX);
+    if (!get_integer_input(1, MATRIX_INPUT_MAX, &n)) return 0;
+    while (getchar() != '\n');
+    *value = (size_t)n;
+    return 1;
+}
+
+/**
+ * @brief Reads the rows of a matrix, one line of cols numbers (or R/P) per row.
+ * @return 1 on success (m has been created), 0 if the input was invalid (the reason has been printed).
+ */
+static int read_matrix(const CalcContext* ctx, const char* name, size_t rows, size_t cols, CalcMatrix* m) {
+    char line[MATRIX_LINE_MAX];
+
+    if (calc_matrix_create(m, rows, cols) != CALC_OK) {
+        print_status_error(CALC_ERR_NO_MEMORY);
+        return 0;
+    }
+    if (cols == 1) printf("Enter %s, one number per row:\n", name);
+    else printf("Enter %s row by row (%zu numbers per line, separated by spaces):\n", name, cols);
+    for (size_t i = 0; i < rows; i++) {
+        size_t len, pos = 0, count = 0;
+        int valid = 1;
+        printf("  Row %zu: ", i + 1);
+        if (fgets(line, sizeof(line), stdin) == NULL) break;
+        len = strlen(line);
+        if (len > 0 && line[len - 1] == '\n') line[--len] = '\0';
+        else if (!feof(stdin)) { while (getchar() != '\n'); printf("Invalid input. Row is too long.\n"); break; }
+
+        while (pos < len) {
+            size_t start, offset = 0;
+            CalcConvStatus status;
+            double value;
+            if (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\r') { pos++; continue; }
+            start = pos;
+            while (pos < len && line[pos] != ' ' && line[pos] != '\t' && line[pos] != '\r') pos++;
+            if (count == cols) {
+                printf("Invalid input. Expected %zu numbers.\n", cols);
+                valid = 0;
+                break;
+            }
+            status = parse_operand(ctx, line + start, pos - start, &value, NULL, &offset);
+            if (status != CALC_CONV_OK) {
+                printf("Invalid input (%s at position %zu).\n",
+                    status == CALC_CONV_OVERFLOW ? "Number out of range" : calc_conv_status_message(status), start + offset + 1);
+                valid = 0;
+                break;
+            }
+            CALC_MATRIX_AT(m, i, count++) = value;
+        }
+        if (valid && count != cols) {
+            printf("Invalid input. Expected %zu numbers.\n", cols);
+            valid = 0;
+        }
+        if (!valid) break;
+        if (i + 1 == rows) return 1;
+    }
+    calc_matrix_free(m);
+    return 0;
+}
+
+static void print_matrix(const char* name, const CalcMatrix* m) {
+    printf("%s =\n", name);
+    for (size_t i = 0; i < m->rows; i++) {
+        printf("  [");
+        for (size_t j = 0; j < m->cols; j++) printf(" %12.4lf", CALC_MATRIX_AT(m, i, j));
+        printf(" ]\n");
+    }
+}
+
+/**
+ * @brief Handles the Matrix and Vector Operations sub-menu. The operands are typed row by row.
+ * @return The dot product or norm, or NAN for the operations whose result is a matrix or on failure.
+ */
+double handle_matrix_operations(const CalcContext* ctx) {
+    int matrix_choice;
+    size_t rows = 0, cols = 0, cols_b = 0;
+    CalcMatrix a, b, result;
+    CalcStatus status = CALC_OK;
+    double result_d = NAN;
+
+    printf("\n--- Matrix and Vector Operations ---\n");
+    printf("1. Add matrices (A + B)\n2. Multiply matrices (A x B)\n3. Transpose (A^T)\n");
+    printf("4. Dot product (u . v)\n5. Norm (|v|, the hypotenuse of n sides)\n6. Solve a linear system (A x = b)\n");
+    printf("7. Back to Main Menu\n");
+    printf("Enter choice (1-7): ");
+
+    matrix_choice = get_menu_choice(7);
+    if (matrix_choice == -1 || matrix_choice == 7) return NAN;
+
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    memset(&result, 0, sizeof(result));
+
+    // Operands: matrices A (and B) for 1-3 and 6, vectors u (and v) as single rows for 4-5
+    switch (matrix_choice) {
+    case 1:
+    case 2:
+    case 3:
+        if (!read_dimension("Rows of A", &rows) || !read_dimension("Columns of A", &cols)) return NAN;
+        if (matrix_choice == 2 && !read_dimension("Columns of B", &cols_b)) return NAN;
+        if (!read_matrix(ctx, "A", rows, cols, &a)) return NAN;
+        if (matrix_choice == 1 && !read_matrix(ctx, "B", rows, cols, &b)) { calc_matrix_free(&a); return NAN; }
+        if (matrix_choice == 2 && !read_matrix(ctx, "B", cols, cols_b, &b)) { calc_matrix_free(&a); return NAN; }
+        break;
+    case 4:
+    case 5:
+        if (!read_dimension("Length of the vectors", &cols)) return NAN;
+        if (!read_matrix(ctx, matrix_choice == 4 ? "u" : "v", 1, cols, &a)) return NAN;
+        if (matrix_choice == 4 && !read_matrix(ctx, "v", 1, cols, &b)) { calc_matrix_free(&a); return NAN; }
+        break;
+    case 6:
+        if (!read_dimension("Unknowns", &rows)) return NAN;
+        if (!read_matrix(ctx, "A", rows, rows, &a)) return NAN;
+        if (!read_matrix(ctx, "b", rows, 1, &b)) { calc_matrix_free(&a); return NAN; }
+        break;
+    }
+
+    switch (matrix_choice) {
+    case 1: {
+        CALC_STATS_BEGIN(timer, CALC_OP_MATRIX_ADD);
+        status = calc_matrix_add(&a, &b, &result);
+        CALC_STATS_END(timer, status);
+        if (status == CALC_OK) print_matrix("A + B", &result);
+        break;
+    }
+    case 2: {
+        CALC_STATS_BEGIN(timer, CALC_OP_MATRIX_MULTIPLY);
+        status = calc_matrix_multiply(&a, &b, &result);
+        CALC_STATS_END(timer, status);
+        if (status == CALC_OK) print_matrix("A x B", &result);
+        break;
+    }
+    case 3: {
+        CALC_STATS_BEGIN(timer, CALC_OP_MATRIX_TRANSPOSE);
+        status = calc_matrix_transpose(&a, &result);
+        CALC_STATS_END(timer, status);
+        if (status == CALC_OK) print_matrix("A^T", &result);
+        break;
+    }
+    case 4: {
+        CALC_STATS_BEGIN(timer, CALC_OP_DOT);
+        result_d = calc_dot(a.data, b.data, cols);
+        CALC_STATS_END(timer, status);
+        printf("u . v = %.4lf\n", result_d);
+        break;
+    }
+    case 5: {
+        CALC_STATS_BEGIN(timer, CALC_OP_NORM);
+        result_d = calc_norm(a.data, cols);
+        CALC_STATS_END(timer, status);
+        printf("|v| = %.4lf\n", result_d);
+        break;
+    }
+    case 6: {
+        CALC_STATS_BEGIN(timer, CALC_OP_SOLVE);
+        status = calc_matrix_solve(&a, &b, &result);
+        CALC_STATS_END(timer, status);
+        if (status == CALC_OK) print_matrix("x", &result);
+        break;
+    }
+    }
+
+    calc_matrix_free(&a);
+    calc_matrix_free(&b);
+    calc_matrix_free(&result);
+    return status == CALC_OK ? result_d : print_status_error(status);
+}
+
+/**
+ * @brief Handles the Statistics sub-menu: prints the per-operation counters and latency
+ * histograms of this session (and of any batch run) in the Prometheus text format or as JSON.
+ */
+void handle_statistics_operations(void) {
+    int stats_choice;
+
+    printf("\n--- Operation Statistics ---\n");
+    if (!calc_stats_enabled()) {
+        printf("Statistics are not available in this build (CALC_NO_STATS).\n");
+        return;
+    }
+    printf("1. Prometheus text format\n2. JSON\n3. Back to Main Menu\n");
+    printf("Enter choice (1-3): ");
+
+    stats_choice = get_menu_choice(3);
+    if (stats_choice == 1) calc_stats_write_prometheus(stdout);
+    else if (stats_choice == 2) calc_stats_write_json(stdout);
+}
@@ -0,0 +1,287 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Server.h"
+#include <stdint.h>
+
+#if !defined(CALC_HAVE_SERVER)
+
+int run_loadgen(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    fprintf(stderr, "Error: The load generator is not available in this build (it needs Linux).\n");
+    return 1;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+
+// Events handled per epoll_wait() call
+#define LOADGEN_EVENTS 256
+// Size of the response buffer of a connection (responses are parsed as they arrive)
+#define LOADGEN_READ_BYTES (64 * 1024)
+
+typedef struct {
+    int fd;
+    unsigned long remaining;  // Requests still to send
+    unsigned long in_flight;  // Requests sent and not answered
+    uint64_t* sent_at;        // Send times of the requests in flight (ring of pipeline entries)
+    size_t oldest;            // Ring index of the oldest request in flight
+    char* out;                // Requests not yet written to the socket
+    size_t out_pos, out_len;
+    char in[LOADGEN_READ_BYTES];
+    size_t in_len;
+    int writing;              // Registered for EPOLLOUT
+} LoadConnection;
+
+typedef struct {
+    const char* line;
+    size_t line_len;          // Including the '\n'
+    unsigned long pipeline;
+    uint64_t* latencies;      // In nanoseconds, one per answered request
+    unsigned long answered, errors;
+} LoadRun;
+
+static uint64_t loadgen_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static int loadgen_connect(const ServerEndpoint* endpoint) {
+    int fd = socket(endpoint->family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int flags;
+    if (fd < 0) return -1;
+    if (connect(fd, (const struct sockaddr*)&endpoint->address, endpoint->length) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (endpoint->family == AF_INET) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    // Non-blocking from here on: a full socket buffer must not stall the other connections
+    flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Queues requests until the pipeline is full and writes what the socket takes.
+ * @return 0 on a socket error.
+ */
+static int loadgen_send(const LoadRun* run, LoadConnection* conn, int epoll) {
+    uint64_t now = loadgen_now();
+    size_t oldest_free = conn->oldest + conn->in_flight;
+
+    for (; conn->remaining > 0 && conn->in_flight < run->pipeline; conn->remaining--, conn->in_flight++) {
+        memcpy(conn->out + conn->out_len, run->line, run->line_len);
+        conn->out_len += run->line_len;
+        conn->sent_at[oldest_free++ % run->pipeline] = now;
+    }
+    while (conn->out_pos < conn->out_len) {
+        ssize_t sent = send(conn->fd, conn->out + conn->out_pos, conn->out_len - conn->out_pos, MSG_NOSIGNAL);
+        if (sent > 0) { conn->out_pos += (size_t)sent; continue; }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return 0;
+    }
+    conn->out_len -= conn->out_pos;
+    memmove(conn->out, conn->out + conn->out_pos, conn->out_len);
+    conn->out_pos = 0;
+
+    if ((conn->out_len > 0) != conn->writing) {
+        struct epoll_event event;
+        conn->writing = conn->out_len > 0;
+        event.events = EPOLLIN | (conn->writing ? EPOLLOUT : 0);
+        event.data.ptr = conn;
+        if (epoll_ctl(epoll, EPOLL_CTL_MOD, conn->fd, &event) != 0) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Reads responses and records the latency of every complete one.
+ * @return -1 on a socket error or if the server hung up early, 0 when every request of the
+ * connection is answered, 1 otherwise.
+ */
+static int loadgen_receive(LoadRun* run, LoadConnection* conn) {
+    for (;;) {
+        ssize_t received = recv(conn->fd, conn->in + conn->in_len, sizeof(conn->in) - conn->in_len, 0);
+        size_t start = 0;
+        const char* newline;
+
+        if (received == 0) return -1;
+        if (received < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 1 : -1;
+        }
+        conn->in_len += (size_t)received;
+        while ((newline = (const char*)memchr(conn->in + start, '\n', conn->in_len - start)) != NULL) {
+            uint64_t now = loadgen_now();
+            if (conn->in_flight == 0) return -1; // More responses than requests
+            if (strncmp(conn->in + start, "error", 5) == 0) run->errors++;
+            run->latencies[run->answered++] = now - conn->sent_at[conn->oldest];
+            conn->oldest = (conn->oldest + 1) % run->pipeline;
+            conn->in_flight--;
+            start = (size_t)(newline - conn->in) + 1;
+        }
+        conn->in_len -= start;
+        memmove(conn->in, conn->in + start, conn->in_len);
+        if (conn->in_len == sizeof(conn->in)) return -1; // A response longer than the buffer
+        if (conn->remaining == 0 && conn->in_flight == 0) return 0;
+    }
+}
+
+static void print_loadgen_usage(void) {
+    printf("Usage: --loadgen [--connect unix:PATH|tcp:[HOST:]PORT] [--connections N] [--pipeline N]\n");
+    printf("                 [--requests N] [--line TEXT]\n");
+}
+
+/**
+ * @brief Load generator for the calculation server: sends --requests copies of the operation line
+ * --line (default "add R 1") over --connections connections, with up to --pipeline requests in
+ * flight on each, and reports the request rate and the p50/p90/p99/p99.9/max latency.
+ * @return 0 on success, 1 on a usage error or if the server could not be reached or hung up.
+ */
+int run_loadgen(int argc, char* argv[]) {
+    const char* spec = SERVER_DEFAULT_ENDPOINT;
+    unsigned long connection_count = 16, total = 100000;
+    ServerEndpoint endpoint;
+    LoadConnection* conns;
+    LoadRun run;
+    char* line_buffer;
+    const char* line = "add R 1";
+    int epoll = -1, status = 0;
+    unsigned long open_count = 0, done = 0;
+    uint64_t start, elapsed;
+
+    run.pipeline = 8;
+    for (int i = 0; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) { print_loadgen_usage(); return 1; }
+        if (strcmp(argv[i], "--connect") == 0) spec = value;
+        else if (strcmp(argv[i], "--connections") == 0) connection_count = strtoul(value, NULL, 10);
+        else if (strcmp(argv[i], "--pipeline") == 0) run.pipeline = strtoul(value, NULL, 10);
+        else if (strcmp(argv[i], "--requests") == 0) total = strtoul(value, NULL, 10);
+        else if (strcmp(argv[i], "--line") == 0) line = value;
+        else { print_loadgen_usage(); return 1; }
+        i++;
+    }
+    // Every request must get exactly one response: no blank or comment lines, no line breaks
+    if (line[strspn(line, " \t")] == '\0' || line[strspn(line, " \t")] == '#' || strchr(line, '\n') != NULL ||
+        connection_count == 0 || run.pipeline == 0 || total == 0) {
+        print_loadgen_usage();
+        return 1;
+    }
+    if (!server_parse_endpoint(spec, &endpoint)) {
+        fprintf(stderr, "Error: Invalid endpoint '%s'.\n", spec);
+        return 1;
+    }
+    if (connection_count > total) connection_count = total;
+
+    run.line_len = strlen(line) + 1;
+    run.answered = run.errors = 0;
+    line_buffer = (char*)malloc(run.line_len);
+    run.latencies = (uint64_t*)malloc(total * sizeof(uint64_t));
+    conns = (LoadConnection*)calloc(connection_count, sizeof(LoadConnection));
+    if (line_buffer == NULL || run.latencies == NULL || conns == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        free(line_buffer);
+        free(run.latencies);
+        free(conns);
+        return 1;
+    }
+    for (unsigned long i = 0; i < connection_count; i++) conns[i].fd = -1;
+    memcpy(line_buffer, line, run.line_len - 1);
+    line_buffer[run.line_len - 1] = '\n';
+    run.line = line_buffer;
+
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    for (unsigned long i = 0; i < connection_count && epoll >= 0; i++, open_count++) {
+        LoadConnection* conn = &conns[i];
+        struct epoll_event event;
+        conn->remaining = total / connection_count + (i < total % connection_count);
+        conn->sent_at = (uint64_t*)malloc(run.pipeline * sizeof(uint64_t));
+        conn->out = (char*)malloc(run.pipeline * run.line_len);
+        if (conn->sent_at == NULL || conn->out == NULL) { fprintf(stderr, "Error: Out of memory.\n"); break; }
+        conn->fd = loadgen_connect(&endpoint);
+        if (conn->fd < 0) { fprintf(stderr, "Error: Cannot connect to '%s'.\n", spec); break; }
+        event.events = EPOLLIN;
+        event.data.ptr = conn;
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, conn->fd, &event) != 0) break;
+    }
+    if (epoll < 0 || open_count < connection_count) status = 1;
+
+    start = loadgen_now();
+    for (unsigned long i = 0; i < connection_count && status == 0; i++) {
+        if (!loadgen_send(&run, &conns[i], epoll)) status = 1;
+    }
+    while (status == 0 && done < connection_count) {
+        struct epoll_event events[LOADGEN_EVENTS];
+        int count = epoll_wait(epoll, events, LOADGEN_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            status = 1;
+            break;
+        }
+        for (int i = 0; i < count && status == 0; i++) {
+            LoadConnection* conn = (LoadConnection*)events[i].data.ptr;
+            int state = 1;
+            if (conn->fd < 0) continue; // Finished
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) state = loadgen_receive(&run, conn);
+            if (state > 0 && !loadgen_send(&run, conn, epoll)) state = -1;
+            if (state < 0) {
+                fprintf(stderr, "Error: Connection to '%s' failed after %lu responses.\n", spec, run.answered);
+                status = 1;
+            }
+            else if (state == 0) {
+                epoll_ctl(epoll, EPOLL_CTL_DEL, conn->fd, NULL);
+                close(conn->fd);
+                conn->fd = -1;
+                done++;
+            }
+        }
+    }
+    elapsed = loadgen_now() - start;
+
+    if (status == 0) {
+        double seconds = (double)elapsed / 1e9;
+        qsort(run.latencies, run.answered, sizeof(uint64_t), compare_u64);
+#define LATENCY_US(q) ((double)run.latencies[(size_t)((double)(run.answered - 1) * (q))] / 1e3)
+        printf("Requests: %lu in %.3f s over %lu connection%s, pipeline depth %lu\n", run.answered, seconds,
+            connection_count, connection_count == 1 ? "" : "s", run.pipeline);
+        printf("Throughput: %.0f requests/s\n", (double)run.answered / seconds);
+        printf("Latency (us): p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", LATENCY_US(0.5), LATENCY_US(0.9),
+            LATENCY_US(0.99), LATENCY_US(0.999), LATENCY_US(1.0));
+        printf("Errors: %lu\n", run.errors);
+#undef LATENCY_US
+    }
+
+    for (unsigned long i = 0; i < connection_count; i++) {
+        if (conns[i].fd >= 0) close(conns[i].fd);
+        free(conns[i].sent_at);
+        free(conns[i].out);
+    }
+    if (epoll >= 0) close(epoll);
+    free(conns);
+    free(run.latencies);
+    free(line_buffer);
+    return status;
+}
+
+#endif
@@ -1,26 +1,87 @@
 #define _CRT_SECURE_NO_WARNINGS
-#include "calculator.h"
-
-// Definition and initialization of the global variables to store the last two results (R and P)
-double last_result = 0.0;
-double prev_result = 0.0; // New variable P for the result before R
+#include "Calculator.h"
+#include "Stats.h"
 
 /**
  * @brief Main function to run the advanced calculator program.
  * The program runs in a loop until the user chooses to exit.
+ * With "--batch [file]" it instead evaluates one operation per line from the file
+ * (or standard input) without any prompts, see run_batch_mode().
+ * With "--bench [options]" it runs the microbenchmarks of the operations, see run_bench().
+ * With "--sweep FUNCTION START END STEP [options]" it tabulates a function over a range, see run_sweep().
+ * With "--reduce [file]" it prints the sum, mean, variance, ... of the numbers of the file, see run_reduce().
+ * With "--integrate", "--root" and "--roots" it integrates an expression or finds its roots, see Solve.c.
+ * With "--server [options]" it serves the batch operations over a socket, one R/P history per
+ * connection (see Server.h), and "--loadgen [options]" measures such a server.
+ * "--session FILE" before "--batch" or none of these restores R, P and the variables from FILE at
+ * the start and saves them back at the end, see session_load().
+ * "--precision f32|f64|f80|f128" before "--batch" or none of these (and before or after
+ * "--session") computes the expressions and floating-point operations at that precision (see
+ * Precision.h); the environment variable CALC_PRECISION sets the default, also for the server.
+ * On POSIX systems, SIGUSR1 writes the operation statistics to stderr (see Stats.h).
  */
-int main() {
+int main(int argc, char* argv[]) {
     int choice = 0;
     double top_level_result = NAN; // Variable to capture the result of the top-level operation
+    CalcContext session;           // The last two results (R and P) and the precision
+    const char* session_path = NULL;
+    CalcSheet* variables = NULL;   // Kept only for a saved session
+
+    calc_init(&session);
+
+    while (argc > 2 && (strcmp(argv[1], "--session") == 0 || strcmp(argv[1], "--precision") == 0)) {
+        if (strcmp(argv[1], "--precision") == 0 && !calc_precision_parse(argv[2], &session.precision)) {
+            fprintf(stderr, "Error: Unknown precision '%s' (f32, f64, f80 or f128).\n", argv[2]);
+            return 1;
+        }
+        if (strcmp(argv[1], "--session") == 0) session_path = argv[2];
+        if (argc > 3 && strcmp(argv[3], "--session") != 0 && strcmp(argv[3], "--precision") != 0 &&
+            strcmp(argv[3], "--batch") != 0) {
+            fprintf(stderr, "Error: %s only applies to --batch and the interactive mode.\n", argv[1]);
+            return 1;
+        }
+        argc -= 2;
+        argv += 2;
+    }
+    if (session_path != NULL) {
+        variables = calc_sheet_create();
+        if (variables == NULL || session_load(session_path, &session, variables) != 0) {
+            calc_sheet_free(variables);
+            return 1;
+        }
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0) return run_bench(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "--loadgen") == 0) return run_loadgen(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "--sweep") == 0) return run_sweep(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "--reduce") == 0) return run_reduce(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "--integrate") == 0) return run_integrate(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "--root") == 0) return run_root(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "--roots") == 0) return run_roots(argc - 2, argv + 2);
+
+    // Before the batch workers or server loops start, so that they inherit the blocked signal
+    calc_stats_watch_signal();
+
+    if (argc > 1 && strcmp(argv[1], "--server") == 0) return run_server(argc - 2, argv + 2);
+
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0) {
+        // Files are memory-mapped and parsed in place; standard input is read in large blocks
+        int status;
+        if (argc > 2 && strcmp(argv[2], "-") != 0) status = run_batch_file(&session, variables, argv[2], stdout);
+        else status = run_batch_mode(&session, variables, stdin, stdout);
+        if (session_path != NULL && session_save(session_path, &session, variables) != 0) status = 1;
+        calc_sheet_free(variables);
+        return status;
+    }
 
     printf("--- Welcome to the Advanced Calculator ---\n");
     printf("Developed by Amir for University Course Project.\n");
     printf("Note: You can use 'R' (Last Result), 'P' (Previous Result), or enter a menu number (1, 2, 3) for a nested calculation when prompted for numerical input.\n"); // Updated Note
 
     // Main program loop
-    while (choice != 5) {
-        display_menu();
-        choice = get_menu_choice(5);
+    while (choice != 8) {
+        display_menu(&session);
+        choice = get_menu_choice(8);
 
         if (choice == -1) {
             // Invalid input, loop continues to redisplay menu
@@ -32,23 +93,34 @@ int main() {
         switch (choice) {
         case 1:
             // Mathematical Operations (Now returns the result)
-            top_level_result = handle_math_operations();
+            top_level_result = handle_math_operations(&session);
             break;
         case 2:
             // Trigonometric Operations (Now returns the result)
-            top_level_result = handle_trig_operations();
+            top_level_result = handle_trig_operations(&session);
             break;
         case 3:
             // Number System Conversions (Now returns the result)
-            top_level_result = handle_conversion_operations();
+            top_level_result = handle_conversion_operations(&session);
             break;
         case 4:
+            // Expression Evaluation (compiled once, evaluated with R and P)
+            top_level_result = handle_expression_operations(&session);
+            break;
+        case 5:
+            // Matrix and Vector Operations (only the dot product and norm return a number)
+            top_level_result = handle_matrix_operations(&session);
+            break;
+        case 6:
             // Clear/Restart option (resets R and P)
-            last_result = 0.0;
-            prev_result = 0.0; // Reset P as well
+            calc_clear(&session); // Resets P as well
             printf("\n--- Calculator Cleared. Result history (R and P) reset to 0.0000. Ready for a new calculation! ---\n");
             break;
-        case 5:
+        case 7:
+            // Operation Statistics (counters and latency histograms, Prometheus text or JSON)
+            handle_statistics_operations();
+            break;
+        case 8:
             // Exit option
             printf("\n--- Exiting Calculator. Goodbye! ---\n");
             break;
@@ -59,10 +131,13 @@ int main() {
         }
 
         // Only update R and P if the top-level operation successfully returned a number
-        if (!isnan(top_level_result)) {
-            update_results(top_level_result);
-        }
+        calc_push_result(&session, top_level_result);
     }
 
+    if (session_path != NULL && session_save(session_path, &session, variables) != 0) {
+        calc_sheet_free(variables);
+        return 1;
+    }
+    calc_sheet_free(variables);
     return 0;
 }
\ No newline at end of file
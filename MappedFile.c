@@ -0,0 +1,118 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdint.h>
+#include "MappedFile.h"
+
+#if defined(CALC_NO_MMAP)
+// Nothing to include
+#elif defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(CALC_NO_MMAP)
+
+int calc_map_file(const char* path, CalcMappedFile* file) {
+    (void)path;
+    file->data = NULL;
+    file->size = 0;
+    file->handle = NULL;
+    return 0;
+}
+
+void calc_prefetch_mapped(const CalcMappedFile* file, size_t offset, size_t len) {
+    (void)file;
+    (void)offset;
+    (void)len;
+}
+
+void calc_unmap_file(CalcMappedFile* file) {
+    (void)file;
+}
+
+#elif defined(_WIN32)
+
+int calc_map_file(const char* path, CalcMappedFile* file) {
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    LARGE_INTEGER size;
+    HANDLE mapping;
+    const void* data;
+
+    if (handle == INVALID_HANDLE_VALUE) return 0;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0 || (uint64_t)size.QuadPart > SIZE_MAX) {
+        CloseHandle(handle);
+        return 0;
+    }
+    mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(handle); // The mapping keeps the file open
+    if (mapping == NULL) return 0;
+    data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == NULL) {
+        CloseHandle(mapping);
+        return 0;
+    }
+    file->data = (const char*)data;
+    file->size = (size_t)size.QuadPart;
+    file->handle = mapping;
+    return 1;
+}
+
+void calc_prefetch_mapped(const CalcMappedFile* file, size_t offset, size_t len) {
+    // FILE_FLAG_SEQUENTIAL_SCAN already makes the cache manager read ahead
+    (void)file;
+    (void)offset;
+    (void)len;
+}
+
+void calc_unmap_file(CalcMappedFile* file) {
+    UnmapViewOfFile(file->data);
+    CloseHandle((HANDLE)file->handle);
+}
+
+#else
+
+int calc_map_file(const char* path, CalcMappedFile* file) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    void* data;
+
+    if (fd < 0) return 0;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0 || (uint64_t)info.st_size > SIZE_MAX) {
+        close(fd);
+        return 0;
+    }
+    data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (data == MAP_FAILED) return 0;
+#ifdef MADV_SEQUENTIAL
+    madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL); // Aggressive read-ahead, pages dropped behind
+#endif
+    file->data = (const char*)data;
+    file->size = (size_t)info.st_size;
+    file->handle = NULL;
+    return 1;
+}
+
+void calc_prefetch_mapped(const CalcMappedFile* file, size_t offset, size_t len) {
+#ifdef MADV_WILLNEED
+    // madvise() needs a page-aligned start
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset / page * page;
+    if (offset >= file->size) return;
+    if (len > file->size - offset) len = file->size - offset;
+    madvise((void*)(file->data + start), len + (offset - start), MADV_WILLNEED);
+#else
+    (void)file;
+    (void)offset;
+    (void)len;
+#endif
+}
+
+void calc_unmap_file(CalcMappedFile* file) {
+    munmap((void*)file->data, file->size);
+}
+
+#endif
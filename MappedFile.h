@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+
+/*
+ * Read-only memory mapping of a whole input file (mmap, or CreateFileMapping on Windows), so that
+ * large operation files are parsed in place instead of being copied through stdio. With
+ * CALC_NO_MMAP defined, or for inputs that cannot be mapped (pipes, empty files), calc_map_file()
+ * fails and the caller falls back to reading the stream.
+ */
+
+typedef struct {
+    const char* data; // The contents of the file (not '\0'-terminated)
+    size_t size;
+    void* handle;     // Mapping object on Windows
+} CalcMappedFile;
+
+/**
+ * @brief Maps the file at path. Reading is announced as sequential to the operating system.
+ * @return 1 on success, 0 if the file cannot be opened or mapped.
+ */
+int calc_map_file(const char* path, CalcMappedFile* file);
+
+/**
+ * @brief Asks the operating system to start reading len bytes at offset ahead of their use.
+ */
+void calc_prefetch_mapped(const CalcMappedFile* file, size_t offset, size_t len);
+
+/**
+ * @brief Releases a mapping made by calc_map_file().
+ */
+void calc_unmap_file(CalcMappedFile* file);
+
+#endif // MAPPED_FILE_H
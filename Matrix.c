@@ -0,0 +1,529 @@
+#define _CRT_SECURE_NO_WARNINGS
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE) && !defined(_GNU_SOURCE)
+#define _POSIX_C_SOURCE 200112L // posix_memalign()
+#endif
+#include "Calculator.h"
+#include "Matrix.h"
+#include "Columns.h"
+#include "Simd.h"
+#include "Thread.h"
+#include <stdint.h>
+
+// GEMM blocking: depth of the packed slivers, and the rows of A and columns of B packed at once
+// (multiples of every GEMM_MR and 2 * V_WIDTH below)
+#define GEMM_KC 192
+#define GEMM_MC 96
+#define GEMM_NC 512
+// Products with fewer multiply-adds run in the calling thread
+#define GEMM_PARALLEL_WORK (1 << 22)
+// Columns of the panels of the LU decomposition
+#define LU_BLOCK 64
+// Side of the tiles of the transpose
+#define TRANSPOSE_TILE 32
+
+// --- Micro-kernels ---
+
+// Scalar: 4 x 2 tile; the multiply-add is left to the compiler (a call to fma() would dominate)
+#define VD double
+#define V_WIDTH 1
+#define V_FN(name) name##_scalar
+#define V_TARGET
+#define V_LOADU(p) (*(p))
+#define V_STOREU(p, v) (*(p) = (v))
+#define V_SET1(x) ((double)(x))
+#define V_ADD(a, b) ((a) + (b))
+#define V_FMA(a, b, c) ((a) * (b) + (c))
+#define GEMM_MR 4
+#define GEMM_ROWS(X) X(0) X(1) X(2) X(3)
+
+#include "MatrixKernels.h"
+
+#undef VD
+#undef V_WIDTH
+#undef V_FN
+#undef V_TARGET
+#undef V_LOADU
+#undef V_STOREU
+#undef V_SET1
+#undef V_ADD
+#undef V_FMA
+#undef GEMM_MR
+#undef GEMM_ROWS
+
+#ifdef CALC_X86_SIMD
+
+// AVX2: 6 x 8 tile, 12 accumulators, 2 vectors of B and a broadcast of A in the 16 registers
+#define VD __m256d
+#define V_WIDTH 4
+#define V_FN(name) name##_avx2
+#define V_TARGET CALC_TARGET_AVX2
+#define V_LOADU(p) _mm256_loadu_pd(p)
+#define V_STOREU(p, v) _mm256_storeu_pd((p), (v))
+#define V_SET1(x) _mm256_set1_pd(x)
+#define V_ADD(a, b) _mm256_add_pd((a), (b))
+#define V_FMA(a, b, c) _mm256_fmadd_pd((a), (b), (c))
+#define GEMM_MR 6
+#define GEMM_ROWS(X) X(0) X(1) X(2) X(3) X(4) X(5)
+
+#include "MatrixKernels.h"
+
+#undef VD
+#undef V_WIDTH
+#undef V_FN
+#undef V_TARGET
+#undef V_LOADU
+#undef V_STOREU
+#undef V_SET1
+#undef V_ADD
+#undef V_FMA
+#undef GEMM_MR
+#undef GEMM_ROWS
+
+// AVX-512: 8 x 16 tile, 16 accumulators of the 32 registers
+#define VD __m512d
+#define V_WIDTH 8
+#define V_FN(name) name##_avx512
+#define V_TARGET CALC_TARGET_AVX512
+#define V_LOADU(p) _mm512_loadu_pd(p)
+#define V_STOREU(p, v) _mm512_storeu_pd((p), (v))
+#define V_SET1(x) _mm512_set1_pd(x)
+#define V_ADD(a, b) _mm512_add_pd((a), (b))
+#define V_FMA(a, b, c) _mm512_fmadd_pd((a), (b), (c))
+#define GEMM_MR 8
+#define GEMM_ROWS(X) X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7)
+
+#include "MatrixKernels.h"
+
+#undef VD
+#undef V_WIDTH
+#undef V_FN
+#undef V_TARGET
+#undef V_LOADU
+#undef V_STOREU
+#undef V_SET1
+#undef V_ADD
+#undef V_FMA
+#undef GEMM_MR
+#undef GEMM_ROWS
+
+#endif // CALC_X86_SIMD
+
+typedef void (*GemmMicroKernel)(size_t kc, const double* a, const double* b, double* c, size_t ldc);
+
+typedef struct {
+    GemmMicroKernel kernel;
+    size_t mr, nr; // Tile of C
+} GemmKernel;
+
+static GemmKernel select_gemm_kernel(void) {
+    GemmKernel k;
+    switch (calc_simd_level()) {
+#ifdef CALC_X86_SIMD
+    case CALC_SIMD_AVX512: k.kernel = gemm_micro_avx512; k.mr = 8; k.nr = 16; break;
+    case CALC_SIMD_AVX2: k.kernel = gemm_micro_avx2; k.mr = 6; k.nr = 8; break;
+#endif
+    default: k.kernel = gemm_micro_scalar; k.mr = 4; k.nr = 2; break;
+    }
+    return k;
+}
+
+
+// --- Storage ---
+
+static double* matrix_alloc(size_t count) {
+#if defined(_WIN32)
+    return (double*)_aligned_malloc(count * sizeof(double), CALC_MATRIX_ALIGN);
+#else
+    void* p;
+    return posix_memalign(&p, CALC_MATRIX_ALIGN, count * sizeof(double)) == 0 ? (double*)p : NULL;
+#endif
+}
+
+static void matrix_release(double* p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+CalcStatus calc_matrix_create(CalcMatrix* m, size_t rows, size_t cols) {
+    size_t per_line = CALC_MATRIX_ALIGN / sizeof(double);
+    size_t stride = (cols + per_line - 1) / per_line * per_line;
+
+    memset(m, 0, sizeof(*m));
+    if (stride != 0 && rows > SIZE_MAX / sizeof(double) / stride) return CALC_ERR_NO_MEMORY;
+    if (rows * stride > 0) {
+        m->data = matrix_alloc(rows * stride);
+        if (m->data == NULL) return CALC_ERR_NO_MEMORY;
+        memset(m->data, 0, rows * stride * sizeof(double));
+    }
+    m->rows = rows;
+    m->cols = cols;
+    m->stride = stride;
+    return CALC_OK;
+}
+
+void calc_matrix_free(CalcMatrix* m) {
+    matrix_release(m->data);
+    memset(m, 0, sizeof(*m));
+}
+
+CalcStatus calc_matrix_add(const CalcMatrix* a, const CalcMatrix* b, CalcMatrix* sum) {
+    CalcStatus status;
+
+    memset(sum, 0, sizeof(*sum));
+    if (a->rows != b->rows || a->cols != b->cols) return CALC_ERR_DIMENSION;
+    status = calc_matrix_create(sum, a->rows, a->cols);
+    if (status != CALC_OK) return status;
+    for (size_t i = 0; i < a->rows; i++) add_n(&CALC_MATRIX_AT(a, i, 0), &CALC_MATRIX_AT(b, i, 0), &CALC_MATRIX_AT(sum, i, 0), a->cols);
+    return CALC_OK;
+}
+
+CalcStatus calc_matrix_transpose(const CalcMatrix* a, CalcMatrix* transpose) {
+    CalcStatus status = calc_matrix_create(transpose, a->cols, a->rows);
+    if (status != CALC_OK) return status;
+    for (size_t i0 = 0; i0 < a->rows; i0 += TRANSPOSE_TILE) {
+        size_t i1 = a->rows - i0 < TRANSPOSE_TILE ? a->rows : i0 + TRANSPOSE_TILE;
+        for (size_t j0 = 0; j0 < a->cols; j0 += TRANSPOSE_TILE) {
+            size_t j1 = a->cols - j0 < TRANSPOSE_TILE ? a->cols : j0 + TRANSPOSE_TILE;
+            for (size_t i = i0; i < i1; i++) {
+                for (size_t j = j0; j < j1; j++) CALC_MATRIX_AT(transpose, j, i) = CALC_MATRIX_AT(a, i, j);
+            }
+        }
+    }
+    return CALC_OK;
+}
+
+
+// --- Product ---
+
+typedef struct {
+    const CalcMatrix* a;
+    const CalcMatrix* b;
+    CalcMatrix* c;
+    GemmKernel kernel;
+    int subtract;           // c -= a * b instead of c += a * b
+    size_t col_blocks;      // Blocks of GEMM_NC columns of C
+    size_t packed_a_size;   // Doubles of the packed A in a worker buffer, followed by the packed B
+    double** buffers;       // Per worker
+} GemmRun;
+
+// Packs rows [i0, i0 + mc) x columns [p0, p0 + kc) of a, negated if sign is -1, into slivers of
+// mr rows, column by column (rows past the end of a are zeros)
+static void pack_a(const CalcMatrix* a, size_t i0, size_t p0, size_t mc, size_t kc, size_t mr, double sign, double* packed) {
+    for (size_t ir = 0; ir < mc; ir += mr) {
+        size_t rows = mc - ir < mr ? mc - ir : mr;
+        for (size_t p = 0; p < kc; p++) {
+            for (size_t i = 0; i < rows; i++) *packed++ = sign * CALC_MATRIX_AT(a, i0 + ir + i, p0 + p);
+            for (size_t i = rows; i < mr; i++) *packed++ = 0.0;
+        }
+    }
+}
+
+// Packs rows [p0, p0 + kc) x columns [j0, j0 + nc) of b into slivers of nr columns, row by row
+// (columns past the end of b are zeros)
+static void pack_b(const CalcMatrix* b, size_t p0, size_t j0, size_t kc, size_t nc, size_t nr, double* packed) {
+    for (size_t jr = 0; jr < nc; jr += nr) {
+        size_t cols = nc - jr < nr ? nc - jr : nr;
+        for (size_t p = 0; p < kc; p++) {
+            memcpy(packed, &CALC_MATRIX_AT(b, p0 + p, j0 + jr), cols * sizeof(double));
+            if (cols < nr) memset(packed + cols, 0, (nr - cols) * sizeof(double));
+            packed += nr;
+        }
+    }
+}
+
+// Computes the block of GEMM_MC rows and GEMM_NC columns of C with index task
+static void gemm_block(void* context, size_t task, int worker) {
+    GemmRun* run = (GemmRun*)context;
+    const CalcMatrix* a = run->a;
+    CalcMatrix* c = run->c;
+    size_t mr = run->kernel.mr, nr = run->kernel.nr;
+    size_t i0 = task / run->col_blocks * GEMM_MC, j0 = task % run->col_blocks * GEMM_NC;
+    size_t mc = c->rows - i0 < GEMM_MC ? c->rows - i0 : GEMM_MC;
+    size_t nc = c->cols - j0 < GEMM_NC ? c->cols - j0 : GEMM_NC;
+    double* packed_a = run->buffers[worker];
+    double* packed_b = packed_a + run->packed_a_size;
+    double tile[8 * 16]; // The largest tile, for the edges of C
+
+    for (size_t p0 = 0; p0 < a->cols; p0 += GEMM_KC) {
+        size_t kc = a->cols - p0 < GEMM_KC ? a->cols - p0 : GEMM_KC;
+        pack_b(run->b, p0, j0, kc, nc, nr, packed_b);
+        pack_a(a, i0, p0, mc, kc, mr, run->subtract ? -1.0 : 1.0, packed_a);
+        // A sliver of B stays in L1 while the slivers of A stream from L2
+        for (size_t jr = 0; jr < nc; jr += nr) {
+            const double* b_sliver = packed_b + jr * kc;
+            for (size_t ir = 0; ir < mc; ir += mr) {
+                const double* a_sliver = packed_a + ir * kc;
+                size_t rows = mc - ir < mr ? mc - ir : mr, cols = nc - jr < nr ? nc - jr : nr;
+                if (rows == mr && cols == nr) {
+                    run->kernel.kernel(kc, a_sliver, b_sliver, &CALC_MATRIX_AT(c, i0 + ir, j0 + jr), c->stride);
+                    continue;
+                }
+                memset(tile, 0, sizeof(tile));
+                run->kernel.kernel(kc, a_sliver, b_sliver, tile, nr);
+                for (size_t i = 0; i < rows; i++) {
+                    for (size_t j = 0; j < cols; j++) CALC_MATRIX_AT(c, i0 + ir + i, j0 + jr + j) += tile[i * nr + j];
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief c += a * b, or c -= a * b if subtract (the shapes must fit).
+ * @return CALC_OK or CALC_ERR_NO_MEMORY (c is then unchanged).
+ */
+static CalcStatus gemm(const CalcMatrix* a, const CalcMatrix* b, CalcMatrix* c, int subtract) {
+    GemmRun run;
+    CalcStatus status = CALC_OK;
+    size_t row_blocks, tasks, kc, packed_b_size;
+    int workers = 1;
+
+    if (c->rows == 0 || c->cols == 0 || a->cols == 0) return CALC_OK;
+    run.a = a;
+    run.b = b;
+    run.c = c;
+    run.kernel = select_gemm_kernel();
+    run.subtract = subtract;
+    row_blocks = (c->rows + GEMM_MC - 1) / GEMM_MC;
+    run.col_blocks = (c->cols + GEMM_NC - 1) / GEMM_NC;
+    tasks = row_blocks * run.col_blocks;
+    // Buffers no larger than the matrices need
+    kc = a->cols < GEMM_KC ? a->cols : GEMM_KC;
+    run.packed_a_size = (c->rows < GEMM_MC ? (c->rows + run.kernel.mr - 1) / run.kernel.mr * run.kernel.mr : GEMM_MC) * kc;
+    packed_b_size = (c->cols < GEMM_NC ? (c->cols + run.kernel.nr - 1) / run.kernel.nr * run.kernel.nr : GEMM_NC) * kc;
+    if ((double)c->rows * (double)c->cols * (double)a->cols >= GEMM_PARALLEL_WORK) {
+        workers = calc_thread_count();
+        if ((size_t)workers > tasks) workers = (int)tasks;
+    }
+
+    run.buffers = (double**)calloc((size_t)workers, sizeof(double*));
+    for (int w = 0; run.buffers != NULL && w < workers && status == CALC_OK; w++) {
+        run.buffers[w] = matrix_alloc(run.packed_a_size + packed_b_size);
+        if (run.buffers[w] == NULL) status = CALC_ERR_NO_MEMORY;
+    }
+    if (run.buffers == NULL) status = CALC_ERR_NO_MEMORY;
+
+    if (status == CALC_OK) {
+        if (workers > 1) calc_parallel_for(tasks, gemm_block, &run);
+        else for (size_t task = 0; task < tasks; task++) gemm_block(&run, task, 0);
+    }
+
+    for (int w = 0; run.buffers != NULL && w < workers; w++) matrix_release(run.buffers[w]);
+    free(run.buffers);
+    return status;
+}
+
+CalcStatus calc_matrix_multiply(const CalcMatrix* a, const CalcMatrix* b, CalcMatrix* product) {
+    CalcStatus status;
+
+    memset(product, 0, sizeof(*product));
+    if (a->cols != b->rows) return CALC_ERR_DIMENSION;
+    status = calc_matrix_create(product, a->rows, b->cols);
+    if (status == CALC_OK) status = gemm(a, b, product, 0);
+    if (status != CALC_OK) calc_matrix_free(product);
+    return status;
+}
+
+
+// --- Linear systems ---
+
+/**
+ * @brief The rows x cols block of m at (i, j), sharing its elements.
+ */
+static CalcMatrix matrix_view(const CalcMatrix* m, size_t i, size_t j, size_t rows, size_t cols) {
+    CalcMatrix view;
+    view.rows = rows;
+    view.cols = cols;
+    view.stride = m->stride;
+    view.data = m->data + i * m->stride + j;
+    return view;
+}
+
+// y[0..n) -= factor * x[0..n)
+static void row_update(double* y, const double* x, double factor, size_t n) {
+    for (size_t j = 0; j < n; j++) y[j] -= factor * x[j];
+}
+
+static void swap_rows(CalcMatrix* m, size_t i, size_t k) {
+    double* row_i = &CALC_MATRIX_AT(m, i, 0);
+    double* row_k = &CALC_MATRIX_AT(m, k, 0);
+    for (size_t j = 0; j < m->cols; j++) {
+        double t = row_i[j];
+        row_i[j] = row_k[j];
+        row_k[j] = t;
+    }
+}
+
+/**
+ * @brief Replaces the square matrix lu by its LU decomposition with partial pivoting (L below the
+ * diagonal with an implicit unit diagonal, U on and above it); row k was swapped with pivots[k].
+ * Right-looking and blocked: each panel of LU_BLOCK columns is factored row by row, and the rest
+ * of the matrix is updated with one GEMM per panel, where nearly all the work is.
+ * @return CALC_OK, CALC_ERR_SINGULAR or CALC_ERR_NO_MEMORY.
+ */
+static CalcStatus lu_factor(CalcMatrix* lu, size_t* pivots) {
+    size_t n = lu->rows;
+
+    for (size_t k0 = 0; k0 < n; k0 += LU_BLOCK) {
+        size_t nb = n - k0 < LU_BLOCK ? n - k0 : LU_BLOCK, k1 = k0 + nb;
+
+        // Panel: columns [k0, k1) below the diagonal, with the largest remaining pivot of each column
+        for (size_t k = k0; k < k1; k++) {
+            size_t pivot = k;
+            const double* row_k;
+            for (size_t i = k + 1; i < n; i++) {
+                if (fabs(CALC_MATRIX_AT(lu, i, k)) > fabs(CALC_MATRIX_AT(lu, pivot, k))) pivot = i;
+            }
+            if (CALC_MATRIX_AT(lu, pivot, k) == 0) return CALC_ERR_SINGULAR;
+            pivots[k] = pivot;
+            if (pivot != k) swap_rows(lu, k, pivot);
+            row_k = &CALC_MATRIX_AT(lu, k, 0);
+            for (size_t i = k + 1; i < n; i++) {
+                double* row_i = &CALC_MATRIX_AT(lu, i, 0);
+                row_i[k] /= row_k[k];
+                row_update(row_i + k + 1, row_k + k + 1, row_i[k], k1 - k - 1);
+            }
+        }
+        if (k1 < n) {
+            CalcMatrix l21 = matrix_view(lu, k1, k0, n - k1, nb);
+            CalcMatrix u12 = matrix_view(lu, k0, k1, nb, n - k1);
+            CalcMatrix a22 = matrix_view(lu, k1, k1, n - k1, n - k1);
+            CalcStatus status;
+            // U12 = L11^-1 A12, then A22 -= L21 U12
+            for (size_t k = k0; k < k1; k++) {
+                for (size_t i = k + 1; i < k1; i++) {
+                    row_update(&CALC_MATRIX_AT(lu, i, k1), &CALC_MATRIX_AT(lu, k, k1), CALC_MATRIX_AT(lu, i, k), n - k1);
+                }
+            }
+            status = gemm(&l21, &u12, &a22, 1);
+            if (status != CALC_OK) return status;
+        }
+    }
+    return CALC_OK;
+}
+
+/**
+ * @brief Replaces x (P b, the right-hand sides in pivot order) by the solution of L U x = x: L y = x
+ * then U x = y, by blocks of LU_BLOCK rows of x, each solved row by row and then removed from the
+ * remaining rows with a GEMM.
+ * @return CALC_OK or CALC_ERR_NO_MEMORY.
+ */
+static CalcStatus lu_substitute(const CalcMatrix* lu, CalcMatrix* x) {
+    size_t n = lu->rows, rhs = x->cols;
+    CalcStatus status = CALC_OK;
+
+    for (size_t k0 = 0; k0 < n && status == CALC_OK; k0 += LU_BLOCK) {
+        size_t k1 = n - k0 < LU_BLOCK ? n : k0 + LU_BLOCK;
+        for (size_t k = k0; k < k1; k++) {
+            for (size_t i = k + 1; i < k1; i++) row_update(&CALC_MATRIX_AT(x, i, 0), &CALC_MATRIX_AT(x, k, 0), CALC_MATRIX_AT(lu, i, k), rhs);
+        }
+        if (k1 < n) {
+            CalcMatrix l21 = matrix_view(lu, k1, k0, n - k1, k1 - k0);
+            CalcMatrix y1 = matrix_view(x, k0, 0, k1 - k0, rhs);
+            CalcMatrix x2 = matrix_view(x, k1, 0, n - k1, rhs);
+            status = gemm(&l21, &y1, &x2, 1);
+        }
+    }
+    for (size_t k1 = n; k1 > 0 && status == CALC_OK;) {
+        size_t k0 = k1 > LU_BLOCK ? k1 - LU_BLOCK : 0;
+        for (size_t i = k1; i-- > k0;) {
+            double* x_i = &CALC_MATRIX_AT(x, i, 0);
+            for (size_t k = i + 1; k < k1; k++) row_update(x_i, &CALC_MATRIX_AT(x, k, 0), CALC_MATRIX_AT(lu, i, k), rhs);
+            for (size_t j = 0; j < rhs; j++) x_i[j] /= CALC_MATRIX_AT(lu, i, i);
+        }
+        if (k0 > 0) {
+            CalcMatrix u12 = matrix_view(lu, 0, k0, k0, k1 - k0);
+            CalcMatrix x1 = matrix_view(x, k0, 0, k1 - k0, rhs);
+            CalcMatrix x0 = matrix_view(x, 0, 0, k0, rhs);
+            status = gemm(&u12, &x1, &x0, 1);
+        }
+        k1 = k0;
+    }
+    return status;
+}
+
+CalcStatus calc_matrix_solve(const CalcMatrix* a, const CalcMatrix* b, CalcMatrix* x) {
+    CalcMatrix lu;
+    CalcStatus status;
+    size_t n = a->rows, rhs = b->cols;
+    size_t* pivots;
+
+    memset(x, 0, sizeof(*x));
+    if (a->cols != n || b->rows != n) return CALC_ERR_DIMENSION;
+    pivots = (size_t*)malloc((n > 0 ? n : 1) * sizeof(size_t));
+    status = pivots == NULL ? CALC_ERR_NO_MEMORY : calc_matrix_create(&lu, n, n);
+    if (status == CALC_OK) {
+        status = calc_matrix_create(x, n, rhs);
+        if (status != CALC_OK) calc_matrix_free(&lu);
+    }
+    if (status != CALC_OK) {
+        free(pivots);
+        return status;
+    }
+    for (size_t i = 0; i < n; i++) {
+        memcpy(&CALC_MATRIX_AT(&lu, i, 0), &CALC_MATRIX_AT(a, i, 0), n * sizeof(double));
+        memcpy(&CALC_MATRIX_AT(x, i, 0), &CALC_MATRIX_AT(b, i, 0), rhs * sizeof(double));
+    }
+
+    status = lu_factor(&lu, pivots);
+    if (status == CALC_OK) {
+        for (size_t k = 0; k < n; k++) {
+            if (pivots[k] != k) swap_rows(x, k, pivots[k]);
+        }
+        status = lu_substitute(&lu, x);
+    }
+
+    calc_matrix_free(&lu);
+    free(pivots);
+    if (status != CALC_OK) calc_matrix_free(x);
+    return status;
+}
+
+
+// --- Vectors ---
+
+double calc_dot(const double* a, const double* b, size_t n) {
+    // Independent partial sums, which the compiler keeps in vector registers
+    double sum[4] = { 0, 0, 0, 0 };
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        sum[0] += a[i] * b[i];
+        sum[1] += a[i + 1] * b[i + 1];
+        sum[2] += a[i + 2] * b[i + 2];
+        sum[3] += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) sum[0] += a[i] * b[i];
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+double calc_norm(const double* v, size_t n) {
+    double largest = 0, scale, sum[4] = { 0, 0, 0, 0 };
+    int exponent, nan = 0;
+    size_t i = 0;
+
+    for (size_t k = 0; k < n; k++) {
+        double x = fabs(v[k]);
+        if (isnan(x)) nan = 1;
+        else if (x > largest) largest = x;
+    }
+    // Like hypot(): an infinity wins over NAN
+    if (isinf(largest)) return largest;
+    if (nan) return NAN;
+    if (largest == 0) return 0;
+
+    // Scaled by 2^-exponent (exact), the largest element is in [0.5, 1): the squares cannot overflow
+    frexp(largest, &exponent);
+    if (exponent < -1000) exponent = -1000;
+    scale = ldexp(1.0, -exponent);
+    for (; i + 4 <= n; i += 4) {
+        for (int k = 0; k < 4; k++) {
+            double x = v[i + k] * scale;
+            sum[k] += x * x;
+        }
+    }
+    for (; i < n; i++) sum[0] += (v[i] * scale) * (v[i] * scale);
+    return ldexp(sqrt((sum[0] + sum[1]) + (sum[2] + sum[3])), exponent);
+}
@@ -0,0 +1,80 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <stddef.h>
+#include "CalcCore.h"
+
+/*
+ * Dense matrices and vectors of doubles: sum, product, transpose, dot product, Euclidean norm and
+ * the solution of linear systems. A matrix is stored row by row in one block aligned on
+ * CALC_MATRIX_ALIGN bytes, every row starting on such a boundary (stride doubles apart).
+ *
+ * The product is a cache-blocked GEMM: blocks of B (GEMM_KC x GEMM_NC, in the last-level cache)
+ * and A (GEMM_MC x GEMM_KC, in L2) are packed into contiguous slivers, and a register-tiled
+ * micro-kernel (AVX-512 8x16, AVX2 6x8 or scalar 4x2, see MatrixKernels.h) accumulates each tile
+ * of C from a sliver of B held in L1. Large products split C into blocks that calc_thread_count()
+ * threads compute; every element of C is computed by one thread in the same order, so results do
+ * not depend on the number of threads.
+ *
+ * Functions that produce a matrix create it (the caller frees it with calc_matrix_free()); on
+ * failure it is left empty. Operands of the wrong shape are CALC_ERR_DIMENSION.
+ */
+
+#define CALC_MATRIX_ALIGN 64
+
+typedef struct {
+    size_t rows, cols;
+    size_t stride; // Doubles from one row to the next (cols rounded up to CALC_MATRIX_ALIGN bytes)
+    double* data;
+} CalcMatrix;
+
+// Element (i, j) of a matrix
+#define CALC_MATRIX_AT(m, i, j) ((m)->data[(size_t)(i) * (m)->stride + (size_t)(j)])
+
+/**
+ * @brief Creates a rows x cols matrix of zeros.
+ * @return CALC_OK or CALC_ERR_NO_MEMORY (m is then empty).
+ */
+CalcStatus calc_matrix_create(CalcMatrix* m, size_t rows, size_t cols);
+
+/**
+ * @brief Releases the elements of a matrix and leaves it empty (also for an empty matrix).
+ */
+void calc_matrix_free(CalcMatrix* m);
+
+/**
+ * @brief sum = a + b, element by element with add_n().
+ */
+CalcStatus calc_matrix_add(const CalcMatrix* a, const CalcMatrix* b, CalcMatrix* sum);
+
+/**
+ * @brief product = a * b (a->cols == b->rows).
+ */
+CalcStatus calc_matrix_multiply(const CalcMatrix* a, const CalcMatrix* b, CalcMatrix* product);
+
+/**
+ * @brief transpose = a^T, copied in tiles that stay in L1.
+ */
+CalcStatus calc_matrix_transpose(const CalcMatrix* a, CalcMatrix* transpose);
+
+/**
+ * @brief Solves a * x = b for x by LU decomposition with partial pivoting; every column of b is
+ * a right-hand side (a square, b->rows == a->rows). The decomposition and the substitutions are
+ * blocked so that most of their work is done by the GEMM.
+ * @return CALC_OK, CALC_ERR_DIMENSION, CALC_ERR_SINGULAR (a pivot is 0) or CALC_ERR_NO_MEMORY.
+ */
+CalcStatus calc_matrix_solve(const CalcMatrix* a, const CalcMatrix* b, CalcMatrix* x);
+
+/**
+ * @brief Returns the dot product of two vectors of n elements.
+ */
+double calc_dot(const double* a, const double* b, size_t n);
+
+/**
+ * @brief Returns the Euclidean norm sqrt(v[0]^2 + ... + v[n-1]^2), the vector form of calc_hypot():
+ * the squares are summed after scaling by a power of two, so they neither overflow nor underflow.
+ * Infinite if an element is, otherwise NAN if an element is.
+ */
+double calc_norm(const double* v, size_t n);
+
+#endif // MATRIX_H
@@ -0,0 +1,44 @@
+/*
+ * GEMM micro-kernel template for Matrix.c - deliberately has no include guard.
+ *
+ * Matrix.c includes this file once per instruction set after defining:
+ *
+ *   VD, V_WIDTH, V_FN(name), V_TARGET, V_LOADU, V_STOREU, V_SET1, V_ADD, V_FMA  as in VectorMathKernels.h
+ *   GEMM_MR         rows of the tile of C
+ *   GEMM_ROWS(X)    X(0) X(1) ... X(GEMM_MR - 1)
+ *
+ * A tile is GEMM_MR rows of two vectors (2 * V_WIDTH columns). Its accumulators are separate
+ * variables, not an array, so that they stay in registers with the loads of B and the broadcast
+ * of A without relying on the compiler to unroll anything.
+ */
+
+#define GEMM_NR (2 * V_WIDTH)
+#define GEMM_ZERO(i) VD c##i##_0 = V_SET1(0.0), c##i##_1 = V_SET1(0.0);
+#define GEMM_FMA(i)                       \
+    av = V_SET1(a[i]);                    \
+    c##i##_0 = V_FMA(av, b0, c##i##_0);   \
+    c##i##_1 = V_FMA(av, b1, c##i##_1);
+#define GEMM_STORE(i)                                      \
+    row = c + (size_t)(i) * ldc;                           \
+    V_STOREU(row, V_ADD(V_LOADU(row), c##i##_0));          \
+    V_STOREU(row + V_WIDTH, V_ADD(V_LOADU(row + V_WIDTH), c##i##_1));
+
+// c[0..GEMM_MR)[0..GEMM_NR) (rows ldc apart) += the product of a sliver of A, GEMM_MR values per
+// step, and a sliver of B, GEMM_NR values per step, over kc steps
+V_TARGET static void V_FN(gemm_micro)(size_t kc, const double* a, const double* b, double* c, size_t ldc) {
+    VD av, b0, b1;
+    double* row;
+    GEMM_ROWS(GEMM_ZERO)
+
+    for (size_t p = 0; p < kc; p++, a += GEMM_MR, b += GEMM_NR) {
+        b0 = V_LOADU(b);
+        b1 = V_LOADU(b + V_WIDTH);
+        GEMM_ROWS(GEMM_FMA)
+    }
+    GEMM_ROWS(GEMM_STORE)
+}
+
+#undef GEMM_NR
+#undef GEMM_ZERO
+#undef GEMM_FMA
+#undef GEMM_STORE
@@ -0,0 +1,306 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Modular.h"
+#include "Bits.h"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Exponentiations interleaved by calc_mod_pow_n()
+#define MODPOW_LANES 4
+// Bits of an exponent window, and entries of the table of powers per lane
+#define MODPOW_WINDOW 4
+#define MODPOW_TABLE (1 << MODPOW_WINDOW)
+
+typedef struct {
+    uint64_t hi, lo;
+} ModU128;
+
+static ModU128 mul_64x64(uint64_t a, uint64_t b) {
+    ModU128 r;
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)a * b;
+    r.hi = (uint64_t)(product >> 64);
+    r.lo = (uint64_t)product;
+#elif defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+    r.lo = _umul128(a, b, &r.hi);
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32, b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo;
+    uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    r.lo = (mid << 32) | (uint32_t)ll;
+    r.hi = a_hi * b_hi + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+    return r;
+}
+
+/**
+ * @brief floor((hi * 2^64 + lo) / d) for hi < d, bit by bit; only used once per modulus.
+ */
+static uint64_t divide_128_64(uint64_t hi, uint64_t lo, uint64_t d) {
+#if defined(__SIZEOF_INT128__)
+    return (uint64_t)((((unsigned __int128)hi << 64) | lo) / d);
+#else
+    uint64_t q = 0;
+    for (int i = 0; i < 64; i++) {
+        uint64_t carry = hi >> 63;
+        hi = (hi << 1) | (lo >> 63);
+        lo <<= 1;
+        q <<= 1;
+        if (carry || hi >= d) {
+            hi -= d;
+            q |= 1;
+        }
+    }
+    return q;
+#endif
+}
+
+/**
+ * @brief Remainder of (u1 * 2^64 + u0) by the normalized divisor, for u1 < divisor (Moller and
+ * Granlund, "Improved division by invariant integers", algorithm 4).
+ */
+static inline uint64_t reduce_2by1(const CalcModulus* mod, uint64_t u1, uint64_t u0) {
+    ModU128 q = mul_64x64(mod->reciprocal, u1);
+    uint64_t q0 = q.lo + u0;
+    uint64_t q1 = q.hi + u1 + (q0 < u0) + 1;
+    uint64_t r = u0 - q1 * mod->divisor;
+
+    if (r > q0) r += mod->divisor;
+    if (r >= mod->divisor) r -= mod->divisor;
+    return r;
+}
+
+/**
+ * @brief (hi * 2^64 + lo) mod modulus, for any 128-bit value.
+ */
+static inline uint64_t reduce_128(const CalcModulus* mod, uint64_t hi, uint64_t lo) {
+    int s = mod->shift;
+    // The value shifted left by s, in three words n2:n1:n0 (n2 < 2^s <= divisor)
+    uint64_t n2 = s ? hi >> (64 - s) : 0;
+    uint64_t n1 = s ? (hi << s) | (lo >> (64 - s)) : hi;
+    uint64_t n0 = lo << s;
+
+    if (n2 != 0 || n1 >= mod->divisor) n1 = reduce_2by1(mod, n2, n1);
+    return reduce_2by1(mod, n1, n0) >> s;
+}
+
+/**
+ * @brief Montgomery reduction: (hi * 2^64 + lo) / 2^64 mod modulus, for a value below modulus * 2^64.
+ */
+static inline uint64_t redc(const CalcModulus* mod, uint64_t hi, uint64_t lo) {
+    uint64_t m = lo * mod->inverse;
+    // m * modulus has the low word lo, so only the high words are subtracted
+    uint64_t t = mul_64x64(m, mod->modulus).hi;
+    uint64_t r = hi - t;
+    return hi < t ? r + mod->modulus : r;
+}
+
+static inline uint64_t mont_mul(const CalcModulus* mod, uint64_t a, uint64_t b) {
+    ModU128 p = mul_64x64(a, b);
+    return redc(mod, p.hi, p.lo);
+}
+
+static inline uint64_t to_mont(const CalcModulus* mod, uint64_t a) {
+    return mont_mul(mod, calc_mod_reduce(mod, a), mod->r2);
+}
+
+static inline uint64_t from_mont(const CalcModulus* mod, uint64_t a) {
+    return redc(mod, 0, a);
+}
+
+/**
+ * @brief base^exp in Montgomery form, for a base in Montgomery form and exp > 0.
+ */
+static uint64_t mont_pow(const CalcModulus* mod, uint64_t base, uint64_t exp) {
+    uint64_t result = base;
+    for (int bit = 62 - leading_zeros(exp); bit >= 0; bit--) {
+        result = mont_mul(mod, result, result);
+        if ((exp >> bit) & 1) result = mont_mul(mod, result, base);
+    }
+    return result;
+}
+
+/**
+ * @brief Quotient of a 64-bit value through the multiplier, for modulus > 1.
+ */
+static inline uint64_t quotient_64(const CalcModulus* mod, uint64_t a) {
+    uint64_t q = mul_64x64(a, mod->magic).hi;
+    return (((a - q) >> 1) + q) >> mod->more;
+}
+
+CalcStatus calc_modulus_init(CalcModulus* mod, uint64_t modulus) {
+    int log2;
+
+    if (modulus == 0) return CALC_ERR_MODULO_BY_ZERO;
+    mod->modulus = modulus;
+    mod->shift = leading_zeros(modulus);
+    log2 = 63 - mod->shift;
+    if ((modulus & (modulus - 1)) == 0) {
+        // 2^k: the multiplier contributes nothing, and the halving is one of the k shifts
+        mod->magic = 0;
+        mod->more = log2 > 0 ? log2 - 1 : 0;
+    }
+    else {
+        // floor(2^(65 + log2) / modulus) + 1 without its 65th bit, which the halving in
+        // quotient_64() restores (the quotient is computed in halves from 2^(64 + log2))
+        uint64_t m = divide_128_64(1ULL << log2, 0, modulus);
+        uint64_t rem = 0 - m * modulus, twice_rem = rem + rem;
+        m += m;
+        if (twice_rem >= modulus || twice_rem < rem) m++;
+        mod->magic = m + 1;
+        mod->more = log2;
+    }
+    mod->divisor = modulus << mod->shift;
+    mod->reciprocal = divide_128_64(~mod->divisor, ~0ULL, mod->divisor);
+    mod->inverse = 0;
+    if (modulus & 1) {
+        // Newton's iteration doubles the correct low bits: 3 from x = m, then 6, 12, 24, 48, 96
+        uint64_t x = modulus;
+        for (int i = 0; i < 5; i++) x *= 2 - modulus * x;
+        mod->inverse = x;
+    }
+    mod->one = reduce_128(mod, 1, 0);
+    mod->r2 = calc_mod_mul(mod, mod->one, mod->one);
+    return CALC_OK;
+}
+
+uint64_t calc_mod_reduce(const CalcModulus* mod, uint64_t a) {
+    return mod->modulus == 1 ? 0 : a - quotient_64(mod, a) * mod->modulus;
+}
+
+uint64_t calc_mod_mul(const CalcModulus* mod, uint64_t a, uint64_t b) {
+    ModU128 p = mul_64x64(a, b);
+    return reduce_128(mod, p.hi, p.lo);
+}
+
+uint64_t calc_mod_pow(const CalcModulus* mod, uint64_t base, uint64_t exp) {
+    uint64_t result;
+
+    if (mod->modulus == 1) return 0;
+    if (exp == 0) return 1;
+    if (mod->modulus & 1) return from_mont(mod, mont_pow(mod, to_mont(mod, base), exp));
+    base = calc_mod_reduce(mod, base);
+    result = base;
+    for (int bit = 62 - leading_zeros(exp); bit >= 0; bit--) {
+        result = calc_mod_mul(mod, result, result);
+        if ((exp >> bit) & 1) result = calc_mod_mul(mod, result, base);
+    }
+    return result;
+}
+
+void calc_mod_pow_n(const CalcModulus* mod, const uint64_t* base, const uint64_t* exp, uint64_t* out, size_t n) {
+    size_t i = 0;
+
+    // Even moduli have no Montgomery form; their powers go one at a time
+    if ((mod->modulus & 1) && mod->modulus > 1) {
+        for (; i + MODPOW_LANES <= n; i += MODPOW_LANES) {
+            uint64_t table[MODPOW_LANES][MODPOW_TABLE];
+            uint64_t e[MODPOW_LANES], acc[MODPOW_LANES], any = 0;
+            int lane, k, bits;
+
+            for (lane = 0; lane < MODPOW_LANES; lane++) {
+                e[lane] = exp[i + lane];
+                any |= e[lane];
+                table[lane][0] = mod->one;
+                table[lane][1] = to_mont(mod, base[i + lane]);
+            }
+            for (k = 2; k < MODPOW_TABLE; k++) {
+                for (lane = 0; lane < MODPOW_LANES; lane++) {
+                    table[lane][k] = mont_mul(mod, table[lane][k - 1], table[lane][1]);
+                }
+            }
+            // Windows from the highest one that is not zero in any lane
+            bits = any ? (64 - leading_zeros(any) + MODPOW_WINDOW - 1) / MODPOW_WINDOW * MODPOW_WINDOW : 0;
+            for (lane = 0; lane < MODPOW_LANES; lane++) acc[lane] = mod->one;
+            while (bits > 0) {
+                bits -= MODPOW_WINDOW;
+                for (k = 0; k < MODPOW_WINDOW; k++) {
+                    for (lane = 0; lane < MODPOW_LANES; lane++) acc[lane] = mont_mul(mod, acc[lane], acc[lane]);
+                }
+                for (lane = 0; lane < MODPOW_LANES; lane++) {
+                    acc[lane] = mont_mul(mod, acc[lane], table[lane][(e[lane] >> bits) & (MODPOW_TABLE - 1)]);
+                }
+            }
+            for (lane = 0; lane < MODPOW_LANES; lane++) out[i + lane] = from_mont(mod, acc[lane]);
+        }
+    }
+    for (; i < n; i++) out[i] = calc_mod_pow(mod, base[i], exp[i]);
+}
+
+CalcStatus calc_mod_inverse(uint64_t a, uint64_t modulus, uint64_t* result) {
+    // Remainders r0, r1 and the magnitudes of their coefficients of a, whose signs alternate
+    uint64_t r0, r1, x0 = 1, x1 = 0;
+    int odd = 0;
+
+    *result = 0;
+    if (modulus == 0) return CALC_ERR_MODULO_BY_ZERO;
+    if (modulus == 1) return CALC_OK;
+    r0 = a % modulus;
+    r1 = modulus;
+    while (r1 != 0) {
+        uint64_t q = r0 / r1, t;
+        t = r0 - q * r1; r0 = r1; r1 = t;
+        t = x0 + q * x1; x0 = x1; x1 = t;
+        odd = !odd;
+    }
+    if (r0 != 1) return CALC_ERR_NOT_INVERTIBLE;
+    *result = odd && x0 != 0 ? modulus - x0 : x0;
+    return CALC_OK;
+}
+
+int calc_is_prime(uint64_t n) {
+    static const uint8_t small_primes[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+    // Jim Sinclair's bases: no 64-bit composite is a strong pseudoprime to all of them
+    static const uint64_t bases[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+    CalcModulus mod;
+    uint64_t d, one, minus_one;
+    int s;
+
+    if (n < 2) return 0;
+    for (size_t i = 0; i < sizeof(small_primes); i++) {
+        if (n % small_primes[i] == 0) return n == small_primes[i];
+    }
+    if (n < 41 * 41) return 1;
+
+    calc_modulus_init(&mod, n);
+    s = 0;
+    for (d = n - 1; (d & 1) == 0; d >>= 1) s++;
+    // 1 and n - 1 in Montgomery form
+    one = mod.one;
+    minus_one = mod.modulus - one;
+    for (size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++) {
+        uint64_t a = calc_mod_reduce(&mod, bases[i]), x;
+        int r;
+
+        if (a == 0) continue; // n divides the base, which says nothing
+        x = mont_pow(&mod, to_mont(&mod, a), d);
+        if (x == one || x == minus_one) continue;
+        for (r = 1; r < s; r++) {
+            x = mont_mul(&mod, x, x);
+            if (x == minus_one) break;
+        }
+        if (r == s) return 0;
+    }
+    return 1;
+}
+
+CalcStatus calc_mod_remainder_n(const long long* a, long long b, long long* out, size_t n) {
+    CalcModulus mod;
+    CalcStatus status = calc_modulus_init(&mod, b < 0 ? 0 - (unsigned long long)b : (unsigned long long)b);
+
+    if (status != CALC_OK) return status;
+    if (mod.modulus == 1) {
+        memset(out, 0, n * sizeof(*out));
+        return CALC_OK;
+    }
+    for (size_t i = 0; i < n; i++) {
+        // All ones for a negative a[i]; the sign is applied without branches, as it is often random
+        uint64_t sign = 0 - ((uint64_t)a[i] >> 63);
+        uint64_t magnitude = ((uint64_t)a[i] ^ sign) - sign;
+        uint64_t r = magnitude - quotient_64(&mod, magnitude) * mod.modulus;
+        out[i] = (long long)((r ^ sign) - sign);
+    }
+    return CALC_OK;
+}
@@ -0,0 +1,84 @@
+#ifndef MODULAR_H
+#define MODULAR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "CalcCore.h"
+
+/*
+ * Modular arithmetic on unsigned 64-bit integers with 128-bit intermediate products, exact over
+ * the whole range where calc_power() in doubles stops being exact at 2^53.
+ *
+ * A CalcModulus holds what calc_modulus_init() precomputes once per modulus so that the
+ * operations never divide: a rounded-up multiplier that gives the quotient of a 64-bit value by
+ * one high multiplication and two shifts, the reciprocal of the normalized modulus, with which a
+ * 128-bit value is reduced by two multiplications (the "invariant divisor" 2-by-1 division of
+ * Moller and Granlund), and for odd moduli the constants of Montgomery multiplication, which
+ * calc_mod_pow() and calc_is_prime() use for their chains of multiplications.
+ *
+ * There are no SIMD kernels: neither AVX2 nor AVX-512F has a 64x64 -> 128-bit multiply, and the
+ * scalar multiply is faster than emulating one with 32-bit halves. calc_mod_pow_n() instead
+ * interleaves several independent exponentiations so their multiplications overlap.
+ */
+
+typedef struct {
+    uint64_t modulus;
+    uint64_t magic;       // a / modulus = (hi(a * magic) + (a - hi(a * magic)) / 2) >> more, for modulus > 1
+    int more;
+    uint64_t divisor;     // modulus << shift, with the top bit set
+    uint64_t reciprocal;  // floor((2^128 - 1) / divisor) - 2^64
+    int shift;
+    uint64_t inverse;     // modulus^-1 mod 2^64 (odd moduli)
+    uint64_t one;         // 2^64 mod modulus: 1 in Montgomery form
+    uint64_t r2;          // 2^128 mod modulus, which converts to Montgomery form
+} CalcModulus;
+
+/**
+ * @brief Precomputes the constants of a modulus.
+ * @return CALC_OK, or CALC_ERR_MODULO_BY_ZERO if modulus is 0.
+ */
+CalcStatus calc_modulus_init(CalcModulus* mod, uint64_t modulus);
+
+/**
+ * @brief Returns a mod modulus without a division.
+ */
+uint64_t calc_mod_reduce(const CalcModulus* mod, uint64_t a);
+
+/**
+ * @brief Returns a * b mod modulus for any a and b (they need not be reduced).
+ */
+uint64_t calc_mod_mul(const CalcModulus* mod, uint64_t a, uint64_t b);
+
+/**
+ * @brief Returns base^exp mod modulus (0^0 is 1, and everything is 0 modulo 1).
+ */
+uint64_t calc_mod_pow(const CalcModulus* mod, uint64_t base, uint64_t exp);
+
+/**
+ * @brief out[i] = base[i]^exp[i] mod modulus for i < n, four exponentiations at a time with
+ * 4-bit windows. The output may alias either input.
+ */
+void calc_mod_pow_n(const CalcModulus* mod, const uint64_t* base, const uint64_t* exp, uint64_t* out, size_t n);
+
+/**
+ * @brief Computes the x in [0, modulus) with a * x mod modulus = 1 (extended Euclid).
+ * @return CALC_OK, CALC_ERR_MODULO_BY_ZERO, or CALC_ERR_NOT_INVERTIBLE when a and modulus have a
+ * common factor.
+ */
+CalcStatus calc_mod_inverse(uint64_t a, uint64_t modulus, uint64_t* result);
+
+/**
+ * @brief Returns 1 if n is prime, 0 otherwise: trial division by the primes up to 37, then the
+ * Miller-Rabin test with 7 bases known to be deterministic for every 64-bit n.
+ */
+int calc_is_prime(uint64_t n);
+
+/**
+ * @brief out[i] = a[i] % b with one divisor for the whole array, like calc_remainder() (the result
+ * has the sign of a[i]), through the precomputed multiplier of b instead of a division per element.
+ * The output may alias a.
+ * @return CALC_OK, or CALC_ERR_MODULO_BY_ZERO (then nothing is written).
+ */
+CalcStatus calc_mod_remainder_n(const long long* a, long long b, long long* out, size_t n);
+
+#endif // MODULAR_H
@@ -0,0 +1,375 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Parse.h"
+#include "Bits.h"
+#include "ParsePowers.h"
+#include <float.h>
+#include <stdint.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Significant digits that the 64-bit significand holds exactly (10^19 < 2^64)
+#define PARSE_MAX_DIGITS 19
+// Bound of the exponent while reading it (any number beyond is 0 or infinite anyway)
+#define PARSE_EXPONENT_LIMIT 100000
+// Powers of ten that are exact doubles, for Clinger's fast path
+#define PARSE_EXACT_POW10 22
+// Significant digits of parse_double_low() (two groups of 19), past the precision of double-double
+#define PARSE_LOW_DIGITS 38
+// Magnitudes of parse_double_low(), where double-double neither overflows nor loses its low part
+#define PARSE_LOW_MIN 1e-270
+#define PARSE_LOW_MAX 1e270
+
+static const double exact_powers_of_10[PARSE_EXACT_POW10 + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define DOUBLE_INFINITY_BITS (0x7FFULL << 52)
+
+typedef struct {
+    uint64_t hi, lo;
+} ParseU128;
+
+static ParseU128 mul_64x64(uint64_t a, uint64_t b) {
+    ParseU128 r;
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)a * b;
+    r.hi = (uint64_t)(product >> 64);
+    r.lo = (uint64_t)product;
+#elif defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64)
+    r.lo = _umul128(a, b, &r.hi);
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32, b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo;
+    uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    r.lo = (mid << 32) | (uint32_t)ll;
+    r.hi = a_hi * b_hi + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+    return r;
+}
+
+/**
+ * @brief Bits of the double nearest to w * 10^q (w non-zero, q within the table) by the
+ * Eisel-Lemire algorithm. For a w that is the exact significand, the 128-bit product of its
+ * normalized form and the truncated power of five always decides the rounding (Mushtak and
+ * Lemire, "Fast Number Parsing Without Fallback").
+ */
+static uint64_t eisel_lemire(uint64_t w, int q) {
+    const uint64_t* power = &powers_of_five_128[2 * (q - PARSE_MIN_POW10)];
+    int lz = leading_zeros(w), upper_bit, shift, power2;
+    ParseU128 product;
+    uint64_t mantissa;
+
+    w <<= lz;
+    product = mul_64x64(w, power[0]);
+    // The low word of the power only matters when the 9 bits below the 55 kept are all ones
+    if ((product.hi & 0x1FF) == 0x1FF) {
+        ParseU128 second = mul_64x64(w, power[1]);
+        product.lo += second.hi;
+        if (second.hi > product.lo) product.hi++;
+    }
+    upper_bit = (int)(product.hi >> 63);
+    shift = upper_bit + 64 - 52 - 3;
+    mantissa = product.hi >> shift;
+    // floor(q * log2(10)) + 63 is the binary exponent of the product; then the normalization and the bias
+    power2 = ((217706 * q) >> 16) + 63 + upper_bit - lz + 1023;
+
+    if (power2 <= 0) {
+        // Denormal: shift out the extra bits and round; a carry gives the smallest normal number
+        if (-power2 + 1 >= 64) return 0;
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        return mantissa >> 1;
+    }
+    // Ties (only possible for small q) round to even; everything else was already decided
+    if (product.lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == product.hi) {
+        mantissa &= ~1ULL;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if (mantissa >= (2ULL << 52)) {
+        mantissa = 1ULL << 52;
+        power2++;
+    }
+    if (power2 >= 0x7FF) return DOUBLE_INFINITY_BITS;
+    return ((uint64_t)power2 << 52) | (mantissa & ((1ULL << 52) - 1));
+}
+
+/**
+ * @brief Bits of the double nearest to w * 10^q for any q.
+ */
+static uint64_t decimal_to_bits(uint64_t w, long q) {
+    if (w == 0 || q < PARSE_MIN_POW10) return 0;
+    if (q > PARSE_MAX_POW10) return DOUBLE_INFINITY_BITS;
+    return eisel_lemire(w, (int)q);
+}
+
+/**
+ * @brief Length of the (case-insensitive) word at the start of str, 0 if it is not there.
+ */
+static size_t match_word(const char* str, size_t len, const char* word) {
+    size_t n = strlen(word);
+    if (len < n) return 0;
+    for (size_t i = 0; i < n; i++) {
+        if ((str[i] | 0x20) != word[i]) return 0;
+    }
+    return n;
+}
+
+/**
+ * @brief Correctly rounded value of a number with more than 19 significant digits on a rounding
+ * boundary: strtod() of the digits without the decimal point (no locale-dependent character left).
+ */
+static CalcConvStatus parse_exactly(const char* str, size_t len, long exponent, double* value) {
+    char* copy = (char*)malloc(len + 32);
+    size_t n = 0;
+
+    if (copy == NULL) return CALC_CONV_NO_MEMORY;
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] == '.') exponent -= (long)(len - i - 1);
+        else copy[n++] = str[i];
+    }
+    snprintf(copy + n, 32, "e%ld", exponent);
+    *value = strtod(copy, NULL);
+    free(copy);
+    return CALC_CONV_OK;
+}
+
+CalcConvStatus parse_double_prefix(const char* str, size_t len, double* value, size_t* consumed, size_t* error_offset) {
+    size_t i = 0, first, mantissa_end;
+    uint64_t w = 0, bits;
+    long exponent = 0, written_exponent = 0;
+    int negative = 0, digits = 0, any_digit = 0, truncated = 0;
+
+    *value = 0;
+    *consumed = 0;
+    if (i < len && (str[i] == '+' || str[i] == '-')) negative = str[i++] == '-';
+    first = i;
+
+    if (i < len && ((str[i] | 0x20) == 'i' || (str[i] | 0x20) == 'n')) {
+        size_t n = match_word(str + i, len - i, "infinity");
+        if (n == 0) n = match_word(str + i, len - i, "inf");
+        if (n > 0) {
+            *value = negative ? -HUGE_VAL : HUGE_VAL;
+        }
+        else if ((n = match_word(str + i, len - i, "nan")) > 0) {
+            *value = negative ? -NAN : NAN;
+        }
+        if (n > 0) {
+            *consumed = i + n;
+            return CALC_CONV_OK;
+        }
+    }
+
+    // Up to 19 significant digits go into w (leading zeros are not significant); the others
+    // only move the decimal exponent and mark the significand truncated
+    for (; i < len && (unsigned)(str[i] - '0') < 10; i++) {
+        unsigned digit = (unsigned)(str[i] - '0');
+        any_digit = 1;
+        if (digits < PARSE_MAX_DIGITS) {
+            if (w != 0 || digit != 0) { w = w * 10 + digit; digits++; }
+        }
+        else {
+            exponent++;
+            truncated |= digit != 0;
+        }
+    }
+    if (i < len && str[i] == '.') {
+        for (i++; i < len && (unsigned)(str[i] - '0') < 10; i++) {
+            unsigned digit = (unsigned)(str[i] - '0');
+            any_digit = 1;
+            if (digits < PARSE_MAX_DIGITS) {
+                if (w != 0 || digit != 0) { w = w * 10 + digit; digits++; }
+                exponent--;
+            }
+            else {
+                truncated |= digit != 0;
+            }
+        }
+    }
+    if (!any_digit) {
+        if (error_offset != NULL) *error_offset = first;
+        return CALC_CONV_EMPTY;
+    }
+    mantissa_end = i;
+
+    if (i < len && (str[i] | 0x20) == 'e') {
+        size_t j = i + 1;
+        int exponent_negative = 0;
+        if (j < len && (str[j] == '+' || str[j] == '-')) exponent_negative = str[j++] == '-';
+        if (j < len && (unsigned)(str[j] - '0') < 10) {
+            for (; j < len && (unsigned)(str[j] - '0') < 10; j++) {
+                if (written_exponent < PARSE_EXPONENT_LIMIT) written_exponent = written_exponent * 10 + (str[j] - '0');
+            }
+            if (exponent_negative) written_exponent = -written_exponent;
+            exponent += written_exponent;
+            i = j;
+        }
+    }
+    *consumed = i;
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    // Both w and 10^|exponent| are exact doubles, so one correctly rounded operation gives the result
+    if (!truncated && w <= (1ULL << 53) && exponent >= -PARSE_EXACT_POW10 && exponent <= PARSE_EXACT_POW10) {
+        double result = (double)w;
+        result = exponent < 0 ? result / exact_powers_of_10[-exponent] : result * exact_powers_of_10[exponent];
+        *value = negative ? -result : result;
+        return CALC_CONV_OK;
+    }
+#endif
+
+    bits = decimal_to_bits(w, exponent);
+    // Truncated digits put the value between w and w + 1 units; they rarely round differently
+    if (truncated && bits != decimal_to_bits(w + 1, exponent)) {
+        CalcConvStatus status = parse_exactly(str + first, mantissa_end - first, written_exponent, value);
+        if (status != CALC_CONV_OK) return status;
+        memcpy(&bits, value, sizeof(bits));
+    }
+    if (bits == DOUBLE_INFINITY_BITS) {
+        *value = negative ? -HUGE_VAL : HUGE_VAL;
+        if (error_offset != NULL) *error_offset = first;
+        return CALC_CONV_OVERFLOW;
+    }
+    if (negative) bits |= 1ULL << 63;
+    memcpy(value, &bits, sizeof(bits));
+    return CALC_CONV_OK;
+}
+
+CalcConvStatus parse_double(const char* str, size_t len, double* value, size_t* error_offset) {
+    size_t consumed, offset = 0;
+    CalcConvStatus status = parse_double_prefix(str, len, value, &consumed, &offset);
+
+    // A number followed by something else, or something that does not start a number
+    if (status == CALC_CONV_OK && consumed < len) {
+        status = CALC_CONV_INVALID_DIGIT;
+        offset = consumed;
+    }
+    else if (status == CALC_CONV_EMPTY && offset < len) {
+        status = CALC_CONV_INVALID_DIGIT;
+    }
+    if (status == CALC_CONV_INVALID_DIGIT) *value = 0;
+    if (status != CALC_CONV_OK && error_offset != NULL) *error_offset = offset;
+    return status;
+}
+
+// A double-double hi + lo (Dekker, Knuth), for the low parts of literals
+typedef struct {
+    double hi, lo;
+} ParseDD;
+
+static ParseDD dd_sum(double a, double b) {
+    double s = a + b, bb = s - a;
+    ParseDD r = { s, (a - (s - bb)) + (b - bb) };
+    return r;
+}
+
+static ParseDD dd_mul_double(ParseDD a, double b) {
+    double p = a.hi * b;
+    return dd_sum(p, fma(a.hi, b, -p) + a.lo * b);
+}
+
+static ParseDD dd_div(ParseDD a, ParseDD b) {
+    double q1 = a.hi / b.hi, p = q1 * b.hi;
+    double r = a.hi - p - fma(q1, b.hi, -p) + a.lo - q1 * b.lo; // a - q1 b, its leading bits cancelled
+    return dd_sum(q1, r / b.hi);
+}
+
+double parse_double_low(const char* str, size_t len, double value) {
+    uint64_t groups[2] = { 0, 0 };
+    int digits = 0, seen_point = 0, exponent_negative = 0;
+    long exponent = 0, written_exponent = 0;
+    size_t i = 0;
+    ParseDD number, power = { 1, 0 };
+
+    if (!(fabs(value) >= PARSE_LOW_MIN && fabs(value) <= PARSE_LOW_MAX)) return 0; // Also NAN
+    if (i < len && (str[i] == '+' || str[i] == '-')) i++;
+    for (; i < len && ((unsigned)(str[i] - '0') < 10 || (str[i] == '.' && !seen_point)); i++) {
+        unsigned digit = (unsigned)(str[i] - '0');
+        if (str[i] == '.') {
+            seen_point = 1;
+        }
+        else if (digits < PARSE_LOW_DIGITS) {
+            if (digits > 0 || digit != 0) {
+                groups[digits / PARSE_MAX_DIGITS] = groups[digits / PARSE_MAX_DIGITS] * 10 + digit;
+                digits++;
+            }
+            if (seen_point) exponent--;
+        }
+        else if (!seen_point) {
+            exponent++;
+        }
+    }
+    if (i < len && (str[i] | 0x20) == 'e') {
+        if (++i < len && (str[i] == '+' || str[i] == '-')) exponent_negative = str[i++] == '-';
+        for (; i < len && (unsigned)(str[i] - '0') < 10; i++) {
+            if (written_exponent < PARSE_EXPONENT_LIMIT) written_exponent = written_exponent * 10 + (str[i] - '0');
+        }
+        exponent += exponent_negative ? -written_exponent : written_exponent;
+    }
+    // Within the magnitudes, 38 digits leave the exponent within the range of double
+    if (exponent < -DBL_MAX_10_EXP || exponent > DBL_MAX_10_EXP) return 0;
+
+    // The digits as a double-double (a group of 19 digits and its rounding error are exact doubles)
+    number = dd_sum((double)groups[0], (double)(int64_t)(groups[0] - (uint64_t)(double)groups[0]));
+    if (digits > PARSE_MAX_DIGITS) {
+        ParseDD rest = dd_sum((double)groups[1], (double)(int64_t)(groups[1] - (uint64_t)(double)groups[1]));
+        number = dd_mul_double(number, exact_powers_of_10[digits - PARSE_MAX_DIGITS]);
+        number = dd_sum(number.hi, number.lo + rest.hi + rest.lo);
+    }
+    // Times or over 10^|exponent|, a product of exact powers of ten
+    for (long e = exponent < 0 ? -exponent : exponent; e > 0; e -= PARSE_EXACT_POW10) {
+        power = dd_mul_double(power, exact_powers_of_10[e < PARSE_EXACT_POW10 ? e : PARSE_EXACT_POW10]);
+    }
+    if (exponent < 0) {
+        number = dd_div(number, power);
+    }
+    else if (exponent > 0) {
+        ParseDD scaled = dd_mul_double(power, number.hi);
+        number = dd_sum(scaled.hi, scaled.lo + power.hi * number.lo);
+    }
+
+    // number.hi is value or a neighbour, so the difference is exact (Sterbenz)
+    number.lo += number.hi - fabs(value);
+    return value < 0 ? -number.lo : number.lo;
+}
+
+CalcConvStatus parse_number(const char* str, size_t len, double* value, size_t* error_offset) {
+    size_t start = len > 0 && (str[0] == '+' || str[0] == '-') ? 1 : 0;
+
+    if (len - start >= 2 && str[start] == '0' && ((str[start + 1] | 0x20) == 'x' || (str[start + 1] | 0x20) == 'b')) {
+        unsigned long long magnitude;
+        size_t offset = 0;
+        CalcConvStatus status = ((str[start + 1] | 0x20) == 'x' ? parse_hex : parse_bin)(str + start, len - start, &magnitude, &offset);
+        if (status != CALC_CONV_OK) {
+            *value = 0;
+            if (error_offset != NULL) *error_offset = start + offset;
+            return status;
+        }
+        *value = str[0] == '-' ? -(double)magnitude : (double)magnitude;
+        return CALC_CONV_OK;
+    }
+    return parse_double(str, len, value, error_offset);
+}
+
+CalcConvStatus parse_operand(const CalcContext* ctx, const char* str, size_t len, double* value, CalcOperandKind* kind,
+    size_t* error_offset) {
+    CalcOperandKind parsed = CALC_OPERAND_NUMBER;
+    CalcConvStatus status = CALC_CONV_OK;
+
+    if (len == 1 && (str[0] == 'R' || str[0] == 'r')) {
+        parsed = CALC_OPERAND_LAST_RESULT;
+        *value = ctx->last_result;
+    }
+    else if (len == 1 && (str[0] == 'P' || str[0] == 'p')) {
+        parsed = CALC_OPERAND_PREV_RESULT;
+        *value = ctx->prev_result;
+    }
+    else {
+        status = parse_number(str, len, value, error_offset);
+    }
+    if (kind != NULL) *kind = parsed;
+    return status;
+}
@@ -0,0 +1,69 @@
+#ifndef PARSE_H
+#define PARSE_H
+
+#include <stddef.h>
+#include "BaseConv.h"
+#include "CalcCore.h"
+
+/*
+ * Locale-independent parsing of the numbers users type, for the input paths that used scanf()
+ * and strtod(): the decimal point is always '.', whatever setlocale() says. Decimal numbers are
+ * correctly rounded (to nearest, ties to even) like strtod() in the C locale: exactly with double
+ * arithmetic when the significand and the power of ten are small enough (Clinger's fast path),
+ * otherwise with a 64x128-bit product against a table of powers of five (Eisel-Lemire), and
+ * only for more than 19 significant digits falling on a rounding boundary, through strtod() on
+ * a copy without decimal point. Integers use parse_dec(), parse_hex() and parse_bin().
+ *
+ * Like BaseConv, failures report a CalcConvStatus and the offset of the offending character.
+ * A decimal number beyond DBL_MAX is CALC_CONV_OVERFLOW (one below the smallest denormal is 0).
+ */
+
+/**
+ * @brief Parses the longest decimal number at the start of str (at most len characters): an
+ * optional sign, digits with an optional '.', and an optional exponent ("e-5"), or "inf",
+ * "infinity" or "nan" in any letter case. An "e" without exponent digits is not part of it.
+ * @param value Receives the value (+-HUGE_VAL on overflow, 0 if there is no number).
+ * @param consumed Receives the length of the number (0 if there is none).
+ * @param error_offset Optional; receives the offset of the first digit on overflow, or of where a
+ * digit was expected for CALC_CONV_EMPTY.
+ * @return CALC_CONV_OK, CALC_CONV_EMPTY, CALC_CONV_OVERFLOW or CALC_CONV_NO_MEMORY (the copy for
+ * strtod() of a very long number could not be allocated).
+ */
+CalcConvStatus parse_double_prefix(const char* str, size_t len, double* value, size_t* consumed, size_t* error_offset);
+
+/**
+ * @brief Like parse_double_prefix() for exactly len characters: a character after the number is
+ * CALC_CONV_INVALID_DIGIT at its offset.
+ */
+CalcConvStatus parse_double(const char* str, size_t len, double* value, size_t* error_offset);
+
+/**
+ * @brief Returns the rest of a decimal number beyond its double: the decimal value of the len
+ * characters at str, which parse_double_prefix() read as value, minus value, rounded to double.
+ * value + the result is the number to about 2^-100 of its magnitude (double-double arithmetic
+ * on its first 38 significant digits), the literals of the precisions beyond double.
+ * @return The low part, or 0 for an infinity, a NAN, 0, and magnitudes outside 10^+-270.
+ */
+double parse_double_low(const char* str, size_t len, double value);
+
+/**
+ * @brief Parses a number in any base: a decimal number (see parse_double()), or a hexadecimal
+ * ("0x") or binary ("0b") integer of up to 64 bits after an optional sign, rounded to a double.
+ */
+CalcConvStatus parse_number(const char* str, size_t len, double* value, size_t* error_offset);
+
+typedef enum {
+    CALC_OPERAND_NUMBER,
+    CALC_OPERAND_LAST_RESULT, // 'R' or 'r'
+    CALC_OPERAND_PREV_RESULT  // 'P' or 'p'
+} CalcOperandKind;
+
+/**
+ * @brief Parses an operand: R or P (the last or previous result in ctx, which may be NAN if
+ * there is none yet) or a number (see parse_number()).
+ * @param kind Optional; receives which of them the operand is.
+ */
+CalcConvStatus parse_operand(const CalcContext* ctx, const char* str, size_t len, double* value, CalcOperandKind* kind,
+    size_t* error_offset);
+
+#endif // PARSE_H
@@ -0,0 +1,834 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Precision.h"
+#include "ExprCode.h"
+#include "Simd.h"
+#include <float.h>
+#include <stdint.h>
+
+/*
+ * The precision engine: PrecisionKernels.h instantiated for float (scalar, AVX2 and AVX-512),
+ * long double and a 128-bit type, and the dispatch of expressions and single operations to them.
+ *
+ * The series are as long as each type needs (the first omitted term is below a third of an ULP):
+ *
+ *              exp terms, halvings    log terms    sin/cos terms
+ *     float          7, 0                 5              5
+ *     x87           9, 4                13              9
+ *     128-bit      10, 8                22             14
+ *
+ * The 128-bit type is __float128 where the compiler has it (GCC and Clang on x86-64), long double
+ * where that is an IEEE quad (e.g. AArch64 Linux), and otherwise a pair of doubles (double-double,
+ * 106 bits), which CALC_NO_FLOAT128 also selects.
+ */
+
+// ln(2): 32 bits, so that k * PREC_LN2_HI is exact for every exponent k of the types, and the rest
+#define PREC_LN2_HI 0x1.62e42feep-1
+#define PREC_LN2_LO_A 0x1.a39ef35793c76p-33
+#define PREC_LN2_LO_B 0x1.cc01f97b57a08p-87
+// Float splits ln(2) at 13 bits (k stays below 2^8)
+#define PREC_LN2_HI_F32 0x1.62ep-1
+#define PREC_LN2_LO_F32 0x1.0bfbe8e7bcd5ep-15
+
+#if defined(__SIZEOF_FLOAT128__) && !defined(CALC_NO_FLOAT128)
+#define PREC_F128_FLOAT128 1
+#elif LDBL_MANT_DIG >= 113 && !defined(CALC_NO_FLOAT128)
+#define PREC_F128_LONG_DOUBLE 1
+#else
+#define PREC_F128_DOUBLE_DOUBLE 1
+#endif
+
+
+// --- Float helpers (the scalar forms define the results of the vector ones) ---
+
+// x * 2^k in two steps of floor(k / 2) and the rest, so that a subnormal result is rounded once
+static inline float prec_scale_f32(float x, float k) {
+    int ki = k >= -300 && k <= 300 ? (int)k : 0;
+    int k1 = (ki - (ki & 1)) / 2;
+    uint32_t b1 = (uint32_t)(k1 + 127) << 23, b2 = (uint32_t)(ki - k1 + 127) << 23;
+    float s1, s2;
+    memcpy(&s1, &b1, sizeof(s1));
+    memcpy(&s2, &b2, sizeof(s2));
+    return x * s1 * s2;
+}
+
+static inline float prec_logb_f32(float x) {
+    int subnormal = x < 0x1p-126f;
+    float xs = subnormal ? x * 0x1p24f : x;
+    uint32_t bits;
+    memcpy(&bits, &xs, sizeof(bits));
+    return (float)((int)(bits >> 23) - 127) - (subnormal ? 24.0f : 0.0f);
+}
+
+static inline float prec_mod360_f32(float x) {
+    return (float)fmod((double)x, 360.0); // Exact, and so is the conversion back
+}
+
+
+// --- 128-bit helpers ---
+
+#if defined(PREC_F128_FLOAT128)
+
+typedef __float128 PrecQuad;
+
+// Nearest integral value: adding 2^112 leaves no fraction bits
+static inline PrecQuad quad_round(PrecQuad x) {
+    PrecQuad a = x < 0 ? -x : x;
+    if (!(a < 0x1p112)) return x; // Integral already, infinite or NaN
+    a = (a + 0x1p112) - 0x1p112;
+    return x < 0 ? -a : a;
+}
+
+// x * 2^k, by powers of two that doubles hold (k beyond +-1000 only occurs near over- and underflow)
+static PrecQuad quad_scale(PrecQuad x, PrecQuad k) {
+    int ki = k >= -40000 && k <= 40000 ? (int)k : 0;
+    for (; ki > 1000; ki -= 1000) x *= 0x1p1000;
+    for (; ki < -1000; ki += 1000) x *= 0x1p-1000;
+    return x * ldexp(1.0, ki);
+}
+
+// The exponent of a positive finite x, from that of its double (whose rounding may add one)
+static PrecQuad quad_logb(PrecQuad x) {
+    int e = 0;
+    if (!(x > 0) || x == (PrecQuad)INFINITY) return 0;
+    for (; x >= 0x1p1000; e += 1000) x *= 0x1p-1000;
+    for (; x < 0x1p-1000; e -= 1000) x *= 0x1p1000;
+    return e + ilogb((double)x);
+}
+
+// x modulo 360 by long division: every subtraction of 360 * 2^j is exact (Sterbenz)
+static PrecQuad quad_mod360(PrecQuad x) {
+    PrecQuad a = x < 0 ? -x : x;
+    if (!(a < (PrecQuad)INFINITY)) return x - x;
+    for (int j = (int)quad_logb(a) - 8; j >= 0 && a >= 360; j--) {
+        PrecQuad y = quad_scale(360, j);
+        if (a >= y) a -= y;
+    }
+    return x < 0 ? -a : a;
+}
+
+// Square root of x in [1, 2]: two Newton steps from the double square root
+static inline PrecQuad quad_sqrt(PrecQuad x) {
+    PrecQuad y = sqrt((double)x);
+    y = (y + x / y) * 0.5;
+    return (y + x / y) * 0.5;
+}
+
+#elif defined(PREC_F128_DOUBLE_DOUBLE)
+
+// An unevaluated sum hi + lo with |lo| <= ulp(hi) / 2 (Dekker, Knuth); infinities have lo = 0
+typedef struct {
+    double hi, lo;
+} PrecDD;
+
+static inline PrecDD dd_make(double hi, double lo) {
+    PrecDD r;
+    r.hi = hi + lo;
+    r.lo = isfinite(r.hi) ? lo - (r.hi - hi) : 0;
+    return r;
+}
+
+static inline PrecDD dd_set(double x) {
+    PrecDD r = { x, 0 };
+    return r;
+}
+
+static inline PrecDD dd_neg(PrecDD a) {
+    PrecDD r = { -a.hi, -a.lo };
+    return r;
+}
+
+static inline PrecDD dd_add(PrecDD a, PrecDD b) {
+    double s = a.hi + b.hi, t = a.lo + b.lo;
+    double bb = s - a.hi, e = (a.hi - (s - bb)) + (b.hi - bb);
+    double bt = t - a.lo, f = (a.lo - (t - bt)) + (b.lo - bt);
+    PrecDD r;
+    if (!isfinite(s)) return dd_set(s);
+    r = dd_make(s, e + t);
+    return dd_make(r.hi, r.lo + f);
+}
+
+static inline PrecDD dd_sub(PrecDD a, PrecDD b) {
+    return dd_add(a, dd_neg(b));
+}
+
+static inline PrecDD dd_mul(PrecDD a, PrecDD b) {
+    double p = a.hi * b.hi;
+    if (!isfinite(p) || p == 0) return dd_set(p);
+    return dd_make(p, fma(a.hi, b.hi, -p) + (a.hi * b.lo + a.lo * b.hi));
+}
+
+static inline PrecDD dd_div(PrecDD a, PrecDD b) {
+    double q1 = a.hi / b.hi, q2, q3;
+    PrecDD r;
+    if (!isfinite(q1) || q1 == 0 || isinf(b.hi)) return dd_set(q1);
+    r = dd_sub(a, dd_mul(b, dd_set(q1)));
+    q2 = r.hi / b.hi;
+    r = dd_sub(r, dd_mul(b, dd_set(q2)));
+    q3 = r.hi / b.hi;
+    r = dd_make(q1, q2);
+    return dd_add(r, dd_set(q3));
+}
+
+static inline int dd_lt(PrecDD a, PrecDD b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+static inline int dd_le(PrecDD a, PrecDD b) { return a.hi < b.hi || (a.hi == b.hi && a.lo <= b.lo); }
+static inline int dd_eq(PrecDD a, PrecDD b) { return a.hi == b.hi && a.lo == b.lo; }
+
+static inline PrecDD dd_abs(PrecDD a) {
+    return a.hi < 0 ? dd_neg(a) : dd_make(a.hi + 0.0, a.lo);
+}
+
+// Nearest integral value (ties rounded up)
+static inline PrecDD dd_round(PrecDD a) {
+    double h = floor(a.hi + 0.5);
+    if (!isfinite(a.hi)) return a;
+    if (h == a.hi + 0.5 && a.hi + 0.5 - a.hi == 0.5 && a.lo < 0) h -= 1; // Below the tie
+    if (fabs(a.hi) >= 0x1p52) return dd_make(a.hi, floor(a.lo + 0.5)); // hi is integral
+    return dd_set(h);
+}
+
+static inline PrecDD dd_scale(PrecDD a, PrecDD k) {
+    int ki = k.hi >= -4000 && k.hi <= 4000 ? (int)k.hi : 0;
+    double hi = ldexp(a.hi, ki);
+    return isfinite(hi) ? dd_make(hi, ldexp(a.lo, ki)) : dd_set(hi);
+}
+
+static inline PrecDD dd_logb(PrecDD a) {
+    return dd_set(a.hi > 0 && isfinite(a.hi) ? (double)ilogb(a.hi) : 0);
+}
+
+static inline PrecDD dd_mod360(PrecDD a) {
+    return dd_add(dd_set(fmod(a.hi, 360)), dd_set(fmod(a.lo, 360)));
+}
+
+// Square root of x in [1, 2]: one Newton step from the double square root
+static inline PrecDD dd_sqrt(PrecDD a) {
+    double y = sqrt(a.hi);
+    PrecDD r = dd_sub(a, dd_mul(dd_set(y), dd_set(y)));
+    return dd_add(dd_set(y), dd_set(r.hi / (2 * y)));
+}
+
+#endif
+
+
+// --- Float kernels ---
+
+// Scalar: C operators and fused multiply-adds, exactly the operations of the vector kernels
+#define PM int
+#define P_WIDTH 1
+#define P_TARGET
+#define P_ADD(a, b) ((a) + (b))
+#define P_SUB(a, b) ((a) - (b))
+#define P_MUL(a, b) ((a) * (b))
+#define P_DIV(a, b) ((a) / (b))
+#define P_NEG(a) (-(a))
+#define P_ABS(a) ((a) < 0 ? -(a) : (a) + 0)
+#define P_LT(a, b) ((a) < (b))
+#define P_LE(a, b) ((a) <= (b))
+#define P_GT(a, b) ((a) > (b))
+#define P_GE(a, b) ((a) >= (b))
+#define P_EQ(a, b) ((a) == (b))
+#define P_NE(a, b) ((a) != (b))
+#define P_ISNAN(a) ((a) != (a))
+#define P_AND(a, b) ((a) && (b))
+#define P_OR(a, b) ((a) || (b))
+#define P_NOT(a) (!(a))
+#define P_SELECT(m, a, b) ((m) ? (a) : (b))
+#define P_ANY(m) (m)
+
+#define PT float
+#define P_FN(name) name##_f32
+#define P_LOAD(p) ((float)*(p))
+#define P_STORE(p, v) (*(p) = (double)(v))
+#define P_SET1(x) ((float)(x))
+#define P_CONST(a, b, c) ((float)(a))
+#define P_FMA(a, b, c) fmaf((a), (b), (c))
+#define P_DIVN(x, n) ((x) * (float)(1.0 / (n)))
+#define P_SQRT(x) sqrtf(x)
+#define P_ROUND(x) nearbyintf(x)
+#define P_SCALE(x, k) prec_scale_f32((x), (k))
+#define P_LOGB(x) prec_logb_f32(x)
+#define P_MOD360(x) prec_mod360_f32(x)
+#define P_EXP_LIMIT 112.0
+#define P_REDUCE_MAX 0x1p23
+#define P_LN2_HI P_SET1(PREC_LN2_HI_F32)
+#define P_LN2_LO P_SET1(PREC_LN2_LO_F32)
+#define P_EXP_TERMS 7
+#define P_EXP_HALVINGS 0
+#define P_LOG_TERMS 5
+#define P_TRIG_TERMS 5
+
+#include "PrecisionKernels.h"
+
+#undef PT
+#undef P_FN
+#undef P_LOAD
+#undef P_STORE
+#undef P_SET1
+#undef P_CONST
+#undef P_FMA
+#undef P_DIVN
+#undef P_SQRT
+#undef P_ROUND
+#undef P_SCALE
+#undef P_LOGB
+#undef P_MOD360
+#undef P_EXP_LIMIT
+#undef P_REDUCE_MAX
+#undef P_LN2_HI
+#undef P_LN2_LO
+
+// --- Long double and 128-bit kernels (scalar, with the float series lengths replaced) ---
+
+#undef P_EXP_TERMS
+#undef P_EXP_HALVINGS
+#undef P_LOG_TERMS
+#undef P_TRIG_TERMS
+
+static inline long double prec_scale_f80(long double x, long double k) {
+    return ldexpl(x, k >= -40000 && k <= 40000 ? (int)k : 0);
+}
+
+#define PT long double
+#define P_LOAD(p) ((long double)*(p))
+#define P_STORE(p, v) (*(p) = (double)(v))
+#define P_SET1(x) ((long double)(x))
+#define P_CONST(a, b, c) ((long double)(a) + (long double)(b) + (long double)(c))
+#define P_FMA(a, b, c) ((a) * (b) + (c))
+#define P_DIVN(x, n) ((x) / (long double)(n))
+#define P_SQRT(x) sqrtl(x)
+#define P_ROUND(x) nearbyintl(x)
+#define P_SCALE(x, k) prec_scale_f80((x), (k))
+#define P_LOGB(x) logbl(x)
+#define P_MOD360(x) fmodl((x), 360.0L)
+#define P_EXP_LIMIT ((LDBL_MAX_EXP + LDBL_MANT_DIG + 10) * 0.6931471805599453)
+#define P_REDUCE_MAX (LDBL_MANT_DIG >= 113 ? 0x1p112 : LDBL_MANT_DIG >= 64 ? 0x1p63 : 0x1p52)
+#define P_LN2_HI P_SET1(PREC_LN2_HI)
+#define P_LN2_LO P_CONST(PREC_LN2_LO_A, PREC_LN2_LO_B, 0)
+
+#define P_FN(name) name##_f80
+#define P_EXP_TERMS 9
+#define P_EXP_HALVINGS 4
+#define P_LOG_TERMS 13
+#define P_TRIG_TERMS 9
+#include "PrecisionKernels.h"
+#undef P_FN
+#undef P_EXP_TERMS
+#undef P_EXP_HALVINGS
+#undef P_LOG_TERMS
+#undef P_TRIG_TERMS
+
+#define P_EXP_TERMS 10
+#define P_EXP_HALVINGS 8
+#define P_LOG_TERMS 22
+#define P_TRIG_TERMS 14
+
+#if defined(PREC_F128_LONG_DOUBLE)
+#define P_FN(name) name##_f128
+#include "PrecisionKernels.h"
+#undef P_FN
+#endif
+
+#undef PT
+#undef P_LOAD
+#undef P_STORE
+#undef P_SET1
+#undef P_CONST
+#undef P_FMA
+#undef P_DIVN
+#undef P_SQRT
+#undef P_ROUND
+#undef P_SCALE
+#undef P_LOGB
+#undef P_MOD360
+#undef P_EXP_LIMIT
+#undef P_REDUCE_MAX
+#undef P_LN2_HI
+#undef P_LN2_LO
+
+#if defined(PREC_F128_FLOAT128)
+#define PT PrecQuad
+#define P_FN(name) name##_f128
+#define P_LOAD(p) ((PrecQuad)*(p))
+#define P_STORE(p, v) (*(p) = (double)(v))
+#define P_SET1(x) ((PrecQuad)(x))
+#define P_CONST(a, b, c) ((PrecQuad)(a) + (PrecQuad)(b) + (PrecQuad)(c))
+#define P_FMA(a, b, c) ((a) * (b) + (c))
+#define P_DIVN(x, n) ((x) / (PrecQuad)(n))
+#define P_SQRT(x) quad_sqrt(x)
+#define P_ROUND(x) quad_round(x)
+#define P_SCALE(x, k) quad_scale((x), (k))
+#define P_LOGB(x) quad_logb(x)
+#define P_MOD360(x) quad_mod360(x)
+#define P_EXP_LIMIT 11442.0
+#define P_REDUCE_MAX 0x1p112
+#define P_LN2_HI P_SET1(PREC_LN2_HI)
+#define P_LN2_LO P_CONST(PREC_LN2_LO_A, PREC_LN2_LO_B, 0)
+
+#include "PrecisionKernels.h"
+
+#undef PT
+#undef P_FN
+#undef P_LOAD
+#undef P_STORE
+#undef P_SET1
+#undef P_CONST
+#undef P_FMA
+#undef P_DIVN
+#undef P_SQRT
+#undef P_ROUND
+#undef P_SCALE
+#undef P_LOGB
+#undef P_MOD360
+#undef P_EXP_LIMIT
+#undef P_REDUCE_MAX
+#undef P_LN2_HI
+#undef P_LN2_LO
+#endif
+
+#undef P_ADD
+#undef P_SUB
+#undef P_MUL
+#undef P_DIV
+#undef P_NEG
+#undef P_ABS
+#undef P_LT
+#undef P_LE
+#undef P_GT
+#undef P_GE
+#undef P_EQ
+#undef P_NE
+#undef P_ISNAN
+
+// Double-double: every operation is a function of PrecDD
+#if defined(PREC_F128_DOUBLE_DOUBLE)
+#define PT PrecDD
+#define P_FN(name) name##_f128
+#define P_LOAD(p) dd_set(*(p))
+#define P_STORE(p, v) (*(p) = (v).hi)
+#define P_SET1(x) dd_set(x)
+#define P_CONST(a, b, c) dd_make((a), (b))
+#define P_ADD(a, b) dd_add((a), (b))
+#define P_SUB(a, b) dd_sub((a), (b))
+#define P_MUL(a, b) dd_mul((a), (b))
+#define P_DIV(a, b) dd_div((a), (b))
+#define P_NEG(a) dd_neg(a)
+#define P_ABS(a) dd_abs(a)
+#define P_FMA(a, b, c) dd_add(dd_mul((a), (b)), (c))
+#define P_DIVN(x, n) dd_div((x), dd_set(n))
+#define P_SQRT(x) dd_sqrt(x)
+#define P_ROUND(x) dd_round(x)
+#define P_SCALE(x, k) dd_scale((x), (k))
+#define P_LOGB(x) dd_logb(x)
+#define P_MOD360(x) dd_mod360(x)
+#define P_LT(a, b) dd_lt((a), (b))
+#define P_LE(a, b) dd_le((a), (b))
+#define P_GT(a, b) dd_lt((b), (a))
+#define P_GE(a, b) dd_le((b), (a))
+#define P_EQ(a, b) dd_eq((a), (b))
+#define P_NE(a, b) (!dd_eq((a), (b)))
+#define P_ISNAN(a) isnan((a).hi)
+#define P_EXP_LIMIT 746.0
+#define P_REDUCE_MAX 0x1p105
+#define P_LN2_HI P_SET1(PREC_LN2_HI)
+#define P_LN2_LO P_CONST(PREC_LN2_LO_A, PREC_LN2_LO_B, 0)
+
+#include "PrecisionKernels.h"
+
+#undef PT
+#undef P_FN
+#undef P_LOAD
+#undef P_STORE
+#undef P_SET1
+#undef P_CONST
+#undef P_ADD
+#undef P_SUB
+#undef P_MUL
+#undef P_DIV
+#undef P_NEG
+#undef P_ABS
+#undef P_FMA
+#undef P_DIVN
+#undef P_SQRT
+#undef P_ROUND
+#undef P_SCALE
+#undef P_LOGB
+#undef P_MOD360
+#undef P_LT
+#undef P_LE
+#undef P_GT
+#undef P_GE
+#undef P_EQ
+#undef P_NE
+#undef P_ISNAN
+#undef P_EXP_LIMIT
+#undef P_REDUCE_MAX
+#undef P_LN2_HI
+#undef P_LN2_LO
+#endif
+
+#undef PM
+#undef P_WIDTH
+#undef P_TARGET
+#undef P_AND
+#undef P_OR
+#undef P_NOT
+#undef P_SELECT
+#undef P_ANY
+#undef P_EXP_TERMS
+#undef P_EXP_HALVINGS
+#undef P_LOG_TERMS
+#undef P_TRIG_TERMS
+
+
+// --- SIMD float kernels ---
+
+#ifdef CALC_X86_SIMD
+
+CALC_TARGET_AVX2 static inline __m256 prec_load_avx2(const double* p) {
+    return _mm256_set_m128(_mm256_cvtpd_ps(_mm256_loadu_pd(p + 4)), _mm256_cvtpd_ps(_mm256_loadu_pd(p)));
+}
+
+CALC_TARGET_AVX2 static inline void prec_store_avx2(double* p, __m256 v) {
+    _mm256_storeu_pd(p, _mm256_cvtps_pd(_mm256_castps256_ps128(v)));
+    _mm256_storeu_pd(p + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)));
+}
+
+CALC_TARGET_AVX2 static inline __m256 prec_scale_avx2(__m256 x, __m256 k) {
+    __m256i ki = _mm256_cvtps_epi32(k);
+    __m256i k1 = _mm256_srai_epi32(ki, 1);
+    __m256i k2 = _mm256_sub_epi32(ki, k1);
+    __m256 s1 = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(k1, _mm256_set1_epi32(127)), 23));
+    __m256 s2 = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(k2, _mm256_set1_epi32(127)), 23));
+    return _mm256_mul_ps(_mm256_mul_ps(x, s1), s2);
+}
+
+CALC_TARGET_AVX2 static inline __m256 prec_logb_avx2(__m256 x) {
+    __m256 subnormal = _mm256_cmp_ps(x, _mm256_set1_ps(0x1p-126f), _CMP_LT_OQ);
+    __m256 xs = _mm256_blendv_ps(x, _mm256_mul_ps(x, _mm256_set1_ps(0x1p24f)), subnormal);
+    __m256i e = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_castps_si256(xs), 23), _mm256_set1_epi32(127));
+    return _mm256_sub_ps(_mm256_cvtepi32_ps(e), _mm256_and_ps(subnormal, _mm256_set1_ps(24.0f)));
+}
+
+CALC_TARGET_AVX2 static __m256 prec_mod360_avx2(__m256 x) {
+    float lanes[8];
+    _mm256_storeu_ps(lanes, x);
+    for (int i = 0; i < 8; i++) lanes[i] = prec_mod360_f32(lanes[i]);
+    return _mm256_loadu_ps(lanes);
+}
+
+#define PT __m256
+#define PM __m256
+#define P_WIDTH 8
+#define P_FN(name) name##_f32_avx2
+#define P_TARGET CALC_TARGET_AVX2
+#define P_LOAD(p) prec_load_avx2(p)
+#define P_STORE(p, v) prec_store_avx2((p), (v))
+#define P_SET1(x) _mm256_set1_ps((float)(x))
+#define P_CONST(a, b, c) P_SET1(a)
+#define P_ADD(a, b) _mm256_add_ps((a), (b))
+#define P_SUB(a, b) _mm256_sub_ps((a), (b))
+#define P_MUL(a, b) _mm256_mul_ps((a), (b))
+#define P_DIV(a, b) _mm256_div_ps((a), (b))
+#define P_NEG(a) _mm256_xor_ps((a), _mm256_set1_ps(-0.0f))
+#define P_ABS(a) _mm256_andnot_ps(_mm256_set1_ps(-0.0f), (a))
+#define P_FMA(a, b, c) _mm256_fmadd_ps((a), (b), (c))
+#define P_DIVN(x, n) _mm256_mul_ps((x), P_SET1(1.0 / (n)))
+#define P_SQRT(x) _mm256_sqrt_ps(x)
+#define P_ROUND(x) _mm256_round_ps((x), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define P_SCALE(x, k) prec_scale_avx2((x), (k))
+#define P_LOGB(x) prec_logb_avx2(x)
+#define P_MOD360(x) prec_mod360_avx2(x)
+#define P_LT(a, b) _mm256_cmp_ps((a), (b), _CMP_LT_OQ)
+#define P_LE(a, b) _mm256_cmp_ps((a), (b), _CMP_LE_OQ)
+#define P_GT(a, b) _mm256_cmp_ps((a), (b), _CMP_GT_OQ)
+#define P_GE(a, b) _mm256_cmp_ps((a), (b), _CMP_GE_OQ)
+#define P_EQ(a, b) _mm256_cmp_ps((a), (b), _CMP_EQ_OQ)
+#define P_NE(a, b) _mm256_cmp_ps((a), (b), _CMP_NEQ_UQ)
+#define P_ISNAN(a) _mm256_cmp_ps((a), (a), _CMP_UNORD_Q)
+#define P_AND(a, b) _mm256_and_ps((a), (b))
+#define P_OR(a, b) _mm256_or_ps((a), (b))
+#define P_NOT(a) _mm256_xor_ps((a), _mm256_castsi256_ps(_mm256_set1_epi32(-1)))
+#define P_SELECT(m, a, b) _mm256_blendv_ps((b), (a), (m))
+#define P_ANY(m) (_mm256_movemask_ps(m) != 0)
+#define P_EXP_LIMIT 112.0
+#define P_REDUCE_MAX 0x1p23
+#define P_LN2_HI P_SET1(PREC_LN2_HI_F32)
+#define P_LN2_LO P_SET1(PREC_LN2_LO_F32)
+#define P_EXP_TERMS 7
+#define P_EXP_HALVINGS 0
+#define P_LOG_TERMS 5
+#define P_TRIG_TERMS 5
+
+#include "PrecisionKernels.h"
+
+#undef PT
+#undef PM
+#undef P_WIDTH
+#undef P_FN
+#undef P_TARGET
+#undef P_LOAD
+#undef P_STORE
+#undef P_SET1
+#undef P_ADD
+#undef P_SUB
+#undef P_MUL
+#undef P_DIV
+#undef P_NEG
+#undef P_ABS
+#undef P_SQRT
+#undef P_ROUND
+#undef P_SCALE
+#undef P_LOGB
+#undef P_MOD360
+#undef P_FMA
+#undef P_DIVN
+#undef P_LT
+#undef P_LE
+#undef P_GT
+#undef P_GE
+#undef P_EQ
+#undef P_NE
+#undef P_ISNAN
+#undef P_AND
+#undef P_OR
+#undef P_NOT
+#undef P_SELECT
+#undef P_ANY
+
+CALC_TARGET_AVX512 static inline __m512 prec_load_avx512(const double* p) {
+    __m512 lo = _mm512_castps256_ps512(_mm512_cvtpd_ps(_mm512_loadu_pd(p)));
+    return _mm512_insertf32x8(lo, _mm512_cvtpd_ps(_mm512_loadu_pd(p + 8)), 1);
+}
+
+CALC_TARGET_AVX512 static inline void prec_store_avx512(double* p, __m512 v) {
+    _mm512_storeu_pd(p, _mm512_cvtps_pd(_mm512_castps512_ps256(v)));
+    _mm512_storeu_pd(p + 8, _mm512_cvtps_pd(_mm512_extractf32x8_ps(v, 1)));
+}
+
+CALC_TARGET_AVX512 static inline __m512 prec_scale_avx512(__m512 x, __m512 k) {
+    __m512i ki = _mm512_cvtps_epi32(k);
+    __m512i k1 = _mm512_srai_epi32(ki, 1);
+    __m512i k2 = _mm512_sub_epi32(ki, k1);
+    __m512 s1 = _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(k1, _mm512_set1_epi32(127)), 23));
+    __m512 s2 = _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(k2, _mm512_set1_epi32(127)), 23));
+    return _mm512_mul_ps(_mm512_mul_ps(x, s1), s2);
+}
+
+CALC_TARGET_AVX512 static inline __m512 prec_logb_avx512(__m512 x) {
+    __mmask16 subnormal = _mm512_cmp_ps_mask(x, _mm512_set1_ps(0x1p-126f), _CMP_LT_OQ);
+    __m512 xs = _mm512_mask_mul_ps(x, subnormal, x, _mm512_set1_ps(0x1p24f));
+    __m512i e = _mm512_sub_epi32(_mm512_srli_epi32(_mm512_castps_si512(xs), 23), _mm512_set1_epi32(127));
+    return _mm512_mask_sub_ps(_mm512_cvtepi32_ps(e), subnormal, _mm512_cvtepi32_ps(e), _mm512_set1_ps(24.0f));
+}
+
+CALC_TARGET_AVX512 static __m512 prec_mod360_avx512(__m512 x) {
+    float lanes[16];
+    _mm512_storeu_ps(lanes, x);
+    for (int i = 0; i < 16; i++) lanes[i] = prec_mod360_f32(lanes[i]);
+    return _mm512_loadu_ps(lanes);
+}
+
+#define PT __m512
+#define PM __mmask16
+#define P_WIDTH 16
+#define P_FN(name) name##_f32_avx512
+#define P_TARGET CALC_TARGET_AVX512
+#define P_LOAD(p) prec_load_avx512(p)
+#define P_STORE(p, v) prec_store_avx512((p), (v))
+#define P_SET1(x) _mm512_set1_ps((float)(x))
+#define P_ADD(a, b) _mm512_add_ps((a), (b))
+#define P_SUB(a, b) _mm512_sub_ps((a), (b))
+#define P_MUL(a, b) _mm512_mul_ps((a), (b))
+#define P_DIV(a, b) _mm512_div_ps((a), (b))
+#define P_NEG(a) _mm512_xor_ps((a), _mm512_set1_ps(-0.0f))
+#define P_ABS(a) _mm512_abs_ps(a)
+#define P_FMA(a, b, c) _mm512_fmadd_ps((a), (b), (c))
+#define P_DIVN(x, n) _mm512_mul_ps((x), P_SET1(1.0 / (n)))
+#define P_SQRT(x) _mm512_sqrt_ps(x)
+#define P_ROUND(x) _mm512_roundscale_ps((x), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+#define P_SCALE(x, k) prec_scale_avx512((x), (k))
+#define P_LOGB(x) prec_logb_avx512(x)
+#define P_MOD360(x) prec_mod360_avx512(x)
+#define P_LT(a, b) _mm512_cmp_ps_mask((a), (b), _CMP_LT_OQ)
+#define P_LE(a, b) _mm512_cmp_ps_mask((a), (b), _CMP_LE_OQ)
+#define P_GT(a, b) _mm512_cmp_ps_mask((a), (b), _CMP_GT_OQ)
+#define P_GE(a, b) _mm512_cmp_ps_mask((a), (b), _CMP_GE_OQ)
+#define P_EQ(a, b) _mm512_cmp_ps_mask((a), (b), _CMP_EQ_OQ)
+#define P_NE(a, b) _mm512_cmp_ps_mask((a), (b), _CMP_NEQ_UQ)
+#define P_ISNAN(a) _mm512_cmp_ps_mask((a), (a), _CMP_UNORD_Q)
+#define P_AND(a, b) ((__mmask16)((a) & (b)))
+#define P_OR(a, b) ((__mmask16)((a) | (b)))
+#define P_NOT(a) _mm512_knot(a)
+#define P_SELECT(m, a, b) _mm512_mask_blend_ps((m), (b), (a))
+#define P_ANY(m) (!_mm512_kortestz((m), (m)))
+
+#include "PrecisionKernels.h"
+
+#undef PT
+#undef PM
+#undef P_WIDTH
+#undef P_FN
+#undef P_TARGET
+#undef P_LOAD
+#undef P_STORE
+#undef P_SET1
+#undef P_CONST
+#undef P_ADD
+#undef P_SUB
+#undef P_MUL
+#undef P_DIV
+#undef P_NEG
+#undef P_ABS
+#undef P_FMA
+#undef P_DIVN
+#undef P_SQRT
+#undef P_ROUND
+#undef P_SCALE
+#undef P_LOGB
+#undef P_MOD360
+#undef P_LT
+#undef P_LE
+#undef P_GT
+#undef P_GE
+#undef P_EQ
+#undef P_NE
+#undef P_ISNAN
+#undef P_AND
+#undef P_OR
+#undef P_NOT
+#undef P_SELECT
+#undef P_ANY
+#undef P_EXP_LIMIT
+#undef P_REDUCE_MAX
+#undef P_LN2_HI
+#undef P_LN2_LO
+#undef P_EXP_TERMS
+#undef P_EXP_HALVINGS
+#undef P_LOG_TERMS
+#undef P_TRIG_TERMS
+
+#endif // CALC_X86_SIMD
+
+
+// --- Dispatch ---
+
+typedef void (*PrecRun)(const unsigned char* code, const double* constants, const double* lows, const double* r,
+    const double* p, const double* vars, double* out, size_t n);
+
+static const char* const precision_names[CALC_PRECISION_COUNT] = { "f32", "f64", "f80", "f128" };
+
+// Operation codes of CalcPrecOp
+static const unsigned char prec_op_codes[] = {
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_POW, OP_HYP, OP_EXP, OP_LOG, OP_ABS, OP_SIN, OP_COS, OP_TAN, OP_COT
+};
+
+/**
+ * @brief The kernel of a precision other than double for n points: the widest SIMD kernel that
+ * n fills (they all give the same results).
+ */
+static PrecRun prec_kernel(CalcPrecision precision, size_t n) {
+    if (precision == CALC_PRECISION_F80) return prec_run_f80;
+    if (precision == CALC_PRECISION_F128) return prec_run_f128;
+#ifdef CALC_X86_SIMD
+    if (n >= 16 && calc_simd_level() >= CALC_SIMD_AVX512) return prec_run_f32_avx512;
+    if (n >= 8 && calc_simd_level() >= CALC_SIMD_AVX2) return prec_run_f32_avx2;
+#else
+    (void)n;
+#endif
+    return prec_run_f32;
+}
+
+const char* calc_precision_name(CalcPrecision precision) {
+    return (unsigned)precision < CALC_PRECISION_COUNT ? precision_names[precision] : "unknown";
+}
+
+int calc_precision_parse(const char* text, CalcPrecision* precision) {
+    for (int i = 0; i < CALC_PRECISION_COUNT; i++) {
+        if (strcmp(text, precision_names[i]) == 0) {
+            *precision = (CalcPrecision)i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+CalcPrecision calc_precision_default(void) {
+    static volatile int cached = -1;
+    int value = cached;
+    if (value < 0) {
+        const char* env = getenv("CALC_PRECISION");
+        CalcPrecision precision = CALC_PRECISION_F64;
+        if (env != NULL) calc_precision_parse(env, &precision);
+        value = (int)precision;
+        cached = value;
+    }
+    return (CalcPrecision)value;
+}
+
+int calc_precision_bits(CalcPrecision precision) {
+    switch (precision) {
+    case CALC_PRECISION_F32: return FLT_MANT_DIG;
+    case CALC_PRECISION_F80: return LDBL_MANT_DIG;
+#if defined(PREC_F128_DOUBLE_DOUBLE)
+    case CALC_PRECISION_F128: return 2 * DBL_MANT_DIG;
+#else
+    case CALC_PRECISION_F128: return 113;
+#endif
+    default: return DBL_MANT_DIG;
+    }
+}
+
+double expr_eval_prec(const CompiledExpr* expr, CalcPrecision precision, double r, double p, const double* vars) {
+    const double *constants, *lows;
+    const unsigned char* code;
+    double result;
+
+    if (precision == CALC_PRECISION_F64) return expr_eval_vars(expr, r, p, vars);
+    code = expr_bytecode(expr, &constants, &lows);
+    prec_kernel(precision, 1)(code, constants, lows, &r, &p, vars, &result, 1);
+    return result;
+}
+
+void expr_eval_prec_many(const CompiledExpr* expr, CalcPrecision precision, const double* r, const double* p,
+    double* out, size_t n) {
+    const double *constants, *lows;
+    const unsigned char* code;
+
+    if (precision == CALC_PRECISION_F64) {
+        expr_eval_many(expr, r, p, out, n);
+        return;
+    }
+    code = expr_bytecode(expr, &constants, &lows);
+    prec_kernel(precision, n)(code, constants, lows, r, p, NULL, out, n);
+}
+
+CalcStatus calc_prec_apply(CalcPrecision precision, CalcPrecOp op, double a, double b, double* result) {
+    unsigned char code[4];
+    int binary = op <= CALC_PREC_HYPOT;
+
+    if (precision == CALC_PRECISION_F64) {
+        // The calc_* functions themselves
+        switch (op) {
+        case CALC_PREC_DIVIDE: *result = NAN; return calc_divide(a, b, result);
+        case CALC_PREC_LOG: *result = NAN; return calc_log(a, result);
+        case CALC_PREC_TAN: return calc_tan(a, result);
+        case CALC_PREC_COT: return calc_cot(a, result);
+        default: *result = expr_apply_op(prec_op_codes[op], a, b); return CALC_OK;
+        }
+    }
+
+    code[0] = OP_R;
+    code[1] = binary ? OP_P : prec_op_codes[op];
+    code[2] = binary ? prec_op_codes[op] : OP_RET;
+    code[3] = OP_RET;
+    prec_kernel(precision, 1)(code, NULL, NULL, &a, &b, NULL, result, 1);
+    if (!isnan(*result)) return CALC_OK;
+    switch (op) {
+    case CALC_PREC_DIVIDE: return b == 0 ? CALC_ERR_DIVISION_BY_ZERO : CALC_OK;
+    case CALC_PREC_LOG: return a <= 0 ? CALC_ERR_LOG_DOMAIN : CALC_OK;
+    case CALC_PREC_TAN: return isfinite(a) ? CALC_ERR_TAN_UNDEFINED : CALC_OK;
+    case CALC_PREC_COT: return isfinite(a) ? CALC_ERR_COT_UNDEFINED : CALC_OK;
+    default: return CALC_OK;
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef PRECISION_H
+#define PRECISION_H
+
+#include <stddef.h>
+#include "Expression.h"
+
+/*
+ * Selectable precision of the floating-point operations: float for twice the SIMD lanes of
+ * double where about 7 digits are enough, double (the rest of the library), and x87 long double
+ * or 128-bit floats for long chains of operations that would lose digits in double.
+ *
+ * Every precision other than double runs the same type-generic implementation of the operations
+ * and of the expression VM (PrecisionKernels.h), instantiated once per type and, for float, once
+ * per instruction set with 8 (AVX2) or 16 (AVX-512) lanes. The float kernels return bit-identical
+ * results at every SIMD level (built with -ffp-contract=off, see tests/KernelTests.c). Double keeps the calc_* functions, the bulk kernels and the native
+ * code of expressions, so selecting it changes nothing.
+ *
+ * Operands enter as doubles (R, P and variables) and results are rounded to double, so a single
+ * operation gains little beyond double; what the precision changes is the rounding of every
+ * intermediate result of an expression. The decimal literals of an expression enter at the
+ * precision, to about 100 bits (their double and its low part, see parse_double_low()): at f128,
+ * 0.1 + 0.2 - 0.3 is of the order of 10^-33, not the 2.8e-17 of the doubles nearest the literals.
+ * Expressions meant for another precision should be compiled with expr_compile_unfolded(), or
+ * their constant subexpressions are folded in double.
+ *
+ * Maximum relative error of single operations in their own precision (before the rounding to
+ * double), measured against 70-digit decimal arithmetic on 10^4 float arguments per operation:
+ *
+ *                  f32        f80      f128 quad   double-double
+ *     exp       8.9e-8    1.3e-19      2.8e-34        3.0e-32     (|x| < 80)
+ *     log       1.6e-7    8.7e-20      1.5e-34        1.4e-32
+ *     pow       4.0e-6    4.4e-18      6.1e-33        6.7e-31     (grows with |y log x|, here < 46)
+ *     sin/cos   1.3e-7    1.2e-19      3.1e-34        3.9e-32     (|x| < 720 degrees, reduced exactly)
+ *     hypot     1.4e-7    1.3e-19      2.8e-34        4.1e-32
+ *
+ * mod, fact and binom work on integers and are always computed in double.
+ */
+
+typedef enum {
+    CALC_PRECISION_F32,  // float (24-bit significand)
+    CALC_PRECISION_F64,  // double (53 bits), the default
+    CALC_PRECISION_F80,  // long double: the x87 80-bit format (64 bits); double where long double is
+    CALC_PRECISION_F128  // __float128 or an IEEE quad long double (113 bits), double-double (106 bits) otherwise
+} CalcPrecision;
+
+#define CALC_PRECISION_COUNT 4
+
+// The operations of calc_prec_apply() (see CalcCore.h)
+typedef enum {
+    CALC_PREC_ADD, CALC_PREC_SUBTRACT, CALC_PREC_MULTIPLY, CALC_PREC_DIVIDE, CALC_PREC_POWER, CALC_PREC_HYPOT,
+    CALC_PREC_EXP, CALC_PREC_LOG, CALC_PREC_ABS, CALC_PREC_SIN, CALC_PREC_COS, CALC_PREC_TAN, CALC_PREC_COT
+} CalcPrecOp;
+
+/**
+ * @brief Returns the name of a precision: "f32", "f64", "f80" or "f128".
+ */
+const char* calc_precision_name(CalcPrecision precision);
+
+/**
+ * @brief Parses a precision name (as returned by calc_precision_name()).
+ * @return 1 on success, 0 if text is not the name of a precision.
+ */
+int calc_precision_parse(const char* text, CalcPrecision* precision);
+
+/**
+ * @brief Returns the precision of a new session: the environment variable CALC_PRECISION (a name
+ * of calc_precision_parse()) if it is set and valid, double otherwise. Read once and cached.
+ */
+CalcPrecision calc_precision_default(void);
+
+/**
+ * @brief Returns the bits of the significand of a precision (24, 53, 64, 113; 106 for
+ * double-double, and 53 for f80 where long double is double).
+ */
+int calc_precision_bits(CalcPrecision precision);
+
+/**
+ * @brief Evaluates an expression at a precision, like expr_eval_vars() (NAN if an operation failed).
+ */
+double expr_eval_prec(const CompiledExpr* expr, CalcPrecision precision, double r, double p, const double* vars);
+
+/**
+ * @brief Evaluates an expression at a precision for n pairs of R/P values, like expr_eval_many();
+ * float runs 8 or 16 points at a time through the SIMD kernels.
+ */
+void expr_eval_prec_many(const CompiledExpr* expr, CalcPrecision precision, const double* r, const double* p,
+    double* out, size_t n);
+
+#endif // PRECISION_H
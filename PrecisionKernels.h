@@ -0,0 +1,249 @@
+/*
+ * Kernel template for Precision.c - deliberately has no include guard.
+ *
+ * Precision.c includes this file once per precision (for float, once per instruction set) after
+ * defining the arithmetic it is written against:
+ *
+ *   PT, PM                 value (a vector of floats for the SIMD kernels) and lane mask
+ *   P_WIDTH                lanes per value
+ *   P_FN(name)             suffixes a function name with the precision and instruction set
+ *   P_TARGET               function attribute enabling the instruction set
+ *   P_LOAD(p), P_STORE(p, v)  P_WIDTH doubles to a value, and the value rounded back to doubles
+ *   P_SET1(x)              a constant given as a double
+ *   P_CONST(a, b, c)       a constant given to 159 bits as the sum of three doubles (also the literals
+ *                          of expressions, as a double and its low part)
+ *   P_ADD ... P_ABS        arithmetic; P_ABS(-0) is +0
+ *   P_FMA(a, b, c)         a * b + c, fused in the float kernels so that all of them agree
+ *   P_DIVN(x, n)           x / n for a small positive integer n (the float kernels multiply by 1 / n)
+ *   P_SQRT(x)              square root of x in [1, 2]
+ *   P_ROUND(x)             nearest integral value (of either one on a tie)
+ *   P_SCALE(x, k)          x * 2^k for an integral value k, up to twice the exponent range of the type
+ *   P_LOGB(x)              exponent of a finite x > 0, subnormals included: x * 2^-P_LOGB(x) in [1/2, 2)
+ *   P_MOD360(x)            x modulo 360 with the sign of x, exactly (for |x| >= P_REDUCE_MAX)
+ *   P_LT ... P_ISNAN       comparisons (false for NaN operands, except P_NE)
+ *   P_AND, P_OR, P_NOT, P_SELECT(m, a, b), P_ANY(m)  lane masks
+ *   P_EXP_LIMIT            |x| beyond which e^x is certainly infinite or 0, within the range of P_SCALE
+ *   P_REDUCE_MAX           2^(significand bits - 1): smaller angles are reduced by x - 90 round(x / 90) exactly
+ *   P_LN2_HI, P_LN2_LO     ln(2) in two parts, k * P_LN2_HI exact for every exponent k of the type
+ *   P_EXP_TERMS, P_EXP_HALVINGS, P_LOG_TERMS, P_TRIG_TERMS  lengths of the series (see Precision.c)
+ *
+ * The algorithms only add, multiply, divide and take one square root, so they carry over to any
+ * of the types; the series are long enough for each type's precision.
+ */
+
+// e^x: x = k ln(2) + r exactly, e^r - 1 from its Taylor series at r / 2^P_EXP_HALVINGS and as
+// many doublings (e^2r - 1 = (e^r - 1) (e^r + 1)), which keep the small terms exact
+P_TARGET static inline PT P_FN(prec_exp)(PT x) {
+    PT one = P_SET1(1.0), limit = P_SET1(P_EXP_LIMIT);
+    PT xc = P_SELECT(P_GT(x, limit), limit, P_SELECT(P_LT(x, P_NEG(limit)), P_NEG(limit), x));
+    PT k = P_ROUND(P_MUL(xc, P_SET1(0x1.71547652b82fep0)));
+    PT r = P_FMA(P_NEG(k), P_LN2_HI, xc); // Exact
+    PT t = one, e;
+
+    r = P_MUL(P_FMA(P_NEG(k), P_LN2_LO, r), P_SET1(1.0 / (1 << P_EXP_HALVINGS)));
+    for (int j = P_EXP_TERMS; j >= 2; j--) t = P_FMA(P_DIVN(r, j), t, one);
+    e = P_MUL(r, t);
+    for (int j = 0; j < P_EXP_HALVINGS; j++) e = P_MUL(e, P_ADD(e, P_SET1(2.0)));
+    return P_SELECT(P_ISNAN(x), x, P_SCALE(P_ADD(e, one), k));
+}
+
+// log(x) for x >= 0 (-inf at 0): x = 2^e m with m in [sqrt(1/2), sqrt(2)], and log(m) = 2 atanh(s)
+// = 2 (s + s^3 / 3 + s^5 / 5 + ...) with s = (m - 1) / (m + 1), |s| <= 0.172
+P_TARGET static inline PT P_FN(prec_log)(PT x) {
+    PT one = P_SET1(1.0), zero = P_SET1(0.0), inf = P_SET1(INFINITY);
+    PM special = P_OR(P_NOT(P_GT(x, zero)), P_EQ(x, inf));
+    PT xs = P_SELECT(special, one, x);
+    PT e = P_LOGB(xs);
+    PT m = P_SCALE(xs, P_NEG(e));
+    PM big = P_GT(m, P_SET1(1.4142135623730951)), small = P_LT(m, P_SET1(0.70710678118654757));
+    PT s, s2, t, y;
+
+    m = P_SELECT(big, P_MUL(m, P_SET1(0.5)), P_SELECT(small, P_ADD(m, m), m));
+    e = P_SELECT(big, P_ADD(e, one), P_SELECT(small, P_SUB(e, one), e));
+    s = P_DIV(P_SUB(m, one), P_ADD(m, one));
+    s2 = P_MUL(s, s);
+    t = P_DIVN(one, 2 * P_LOG_TERMS - 1);
+    for (int j = P_LOG_TERMS - 2; j >= 1; j--) t = P_FMA(t, s2, P_DIVN(one, 2 * j + 1));
+    t = P_FMA(P_MUL(s, s2), t, s);
+    y = P_FMA(e, P_LN2_HI, P_FMA(e, P_LN2_LO, P_ADD(t, t)));
+
+    y = P_SELECT(P_EQ(x, zero), P_NEG(inf), P_SELECT(P_EQ(x, inf), inf, y));
+    return P_SELECT(P_OR(P_LT(x, zero), P_ISNAN(x)), P_SET1(NAN), y);
+}
+
+// Sine and cosine of x degrees: r = x - 90 n exactly (after an exact reduction modulo 360 of huge
+// angles), the Taylor series of both at r in radians, and the quadrant n modulo 4. Multiples of 90
+// give exact zeros and ones, and zeros are +0.
+P_TARGET static inline void P_FN(prec_sincos)(PT x, PT* sine, PT* cosine) {
+    PT one = P_SET1(1.0), two = P_SET1(2.0), zero = P_SET1(0.0);
+    PM huge = P_GE(P_ABS(x), P_SET1(P_REDUCE_MAX));
+    PT n, r, q, t, t2, s = one, c = one;
+    PM odd, neg_s, neg_c;
+
+    if (P_ANY(huge)) x = P_SELECT(huge, P_MOD360(x), x);
+    n = P_ROUND(P_MUL(x, P_CONST(0x1.6c16c16c16c17p-7, -0x1.f49f49f49f49fp-62, -0x1.27d27d27d27d2p-116))); // 1 / 90
+    r = P_FMA(P_NEG(n), P_SET1(90.0), x); // Exact
+    q = P_SUB(n, P_MUL(P_SET1(4.0), P_ROUND(P_MUL(n, P_SET1(0.25))))); // n mod 4, in [-2, 2]
+    t = P_MUL(r, P_CONST(0x1.1df46a2529d39p-6, 0x1.5c1d8becdd291p-62, -0x1.1d937fa428858p-116)); // pi / 180
+    t2 = P_MUL(t, t);
+    for (int j = P_TRIG_TERMS; j >= 1; j--) {
+        s = P_FMA(P_NEG(P_DIVN(t2, 2 * j * (2 * j + 1))), s, one);
+        c = P_FMA(P_NEG(P_DIVN(t2, (2 * j - 1) * 2 * j)), c, one);
+    }
+    s = P_MUL(t, s);
+
+    // sin(90 n + r) is sin r, cos r, -sin r, -cos r for n = 0, 1, 2, 3 (mod 4), and cosine follows
+    odd = P_EQ(P_ABS(q), one);
+    neg_s = P_OR(P_EQ(P_ABS(q), two), P_EQ(q, P_NEG(one)));
+    neg_c = P_OR(P_EQ(P_ABS(q), two), P_EQ(q, one));
+    t = P_SELECT(odd, c, s);
+    c = P_SELECT(odd, s, c);
+    *sine = P_ADD(P_SELECT(neg_s, P_NEG(t), t), zero);
+    *cosine = P_ADD(P_SELECT(neg_c, P_NEG(c), c), zero);
+}
+
+// x^y with the special cases of C's pow(): integral |y| <= 64 by repeated squaring, other
+// exponents as e^(y log|x|), negative bases only with integral exponents
+P_TARGET static inline PT P_FN(prec_pow)(PT x, PT y) {
+    PT one = P_SET1(1.0), zero = P_SET1(0.0), inf = P_SET1(INFINITY);
+    PT a = P_ABS(x), ay = P_ABS(y), half = P_MUL(y, P_SET1(0.5)), result = zero;
+    PM integral = P_EQ(P_ROUND(y), y); // Infinite exponents count as even integers
+    PM odd = P_AND(integral, P_NE(P_ROUND(half), half));
+    PM small = P_AND(integral, P_LE(ay, P_SET1(64.0)));
+
+    if (P_ANY(P_NOT(small))) result = P_FN(prec_exp)(P_MUL(y, P_FN(prec_log)(a)));
+    if (P_ANY(small)) {
+        PT acc = one, b = a, e = P_SELECT(small, ay, zero);
+        while (P_ANY(P_GT(e, zero))) {
+            PT h = P_MUL(e, P_SET1(0.5));
+            PT floor_h = P_ROUND(P_SUB(h, P_SET1(0.25)));
+            acc = P_SELECT(P_NE(h, floor_h), P_MUL(acc, b), acc);
+            b = P_MUL(b, b);
+            e = floor_h;
+        }
+        acc = P_SELECT(P_LT(y, zero), P_DIV(one, acc), acc);
+        result = P_SELECT(small, acc, result);
+    }
+
+    result = P_SELECT(P_AND(P_LT(x, zero), odd), P_NEG(result), result);
+    result = P_SELECT(P_AND(P_LT(x, zero), P_NOT(integral)), P_SET1(NAN), result);
+    result = P_SELECT(P_AND(P_EQ(a, one), P_EQ(ay, inf)), one, result);
+    return P_SELECT(P_OR(P_EQ(x, one), P_EQ(y, zero)), one, result);
+}
+
+// sqrt(x^2 + y^2) = max * sqrt(1 + (min / max)^2), without overflow; infinite if either is
+P_TARGET static inline PT P_FN(prec_hypot)(PT x, PT y) {
+    PT one = P_SET1(1.0), inf = P_SET1(INFINITY);
+    PT a = P_ABS(x), b = P_ABS(y);
+    PM swap = P_GT(b, a);
+    PT hi = P_SELECT(swap, b, a), lo = P_SELECT(swap, a, b);
+    PT q = P_DIV(lo, P_SELECT(P_EQ(hi, P_SET1(0.0)), one, hi));
+    PT h = P_MUL(hi, P_SQRT(P_FMA(q, q, one)));
+    return P_SELECT(P_OR(P_EQ(a, inf), P_EQ(b, inf)), inf, h);
+}
+
+// An operation on integers (mod, fact, binom) in double, lane by lane
+P_TARGET static PT P_FN(prec_apply_double)(unsigned char op, PT a, PT b) {
+    double da[P_WIDTH], db[P_WIDTH];
+    P_STORE(da, a);
+    P_STORE(db, b);
+    for (int i = 0; i < P_WIDTH; i++) da[i] = expr_apply_op(op, da[i], db[i]);
+    return P_LOAD(da);
+}
+
+/**
+ * Runs a bytecode program for n points, P_WIDTH at a time, with the semantics of the interpreter
+ * of Expression.c: the operations the interpreter checks fail a lane when they give NAN (division
+ * when the divisor is 0), and a failed lane gives NAN whatever follows.
+ */
+P_TARGET static void P_FN(prec_run)(const unsigned char* code, const double* constants, const double* lows,
+    const double* r, const double* p, const double* vars, double* out, size_t n) {
+    PT stack[EXPR_MAX_STACK];
+    double r_tail[P_WIDTH], p_tail[P_WIDTH], out_tail[P_WIDTH];
+
+    (void)lows; // The P_CONST() of float has no use for the low parts
+    for (size_t i = 0; i < n; i += P_WIDTH) {
+        const unsigned char* pc = code;
+        const double *rs = r + i, *ps = p + i;
+        double* os = out + i;
+        PT* sp = stack; // Points one past the top of the stack
+        PT rv, pv, cosine;
+        PM failed;
+        int done = 0;
+
+        if (n - i < P_WIDTH) {
+            for (size_t k = 0; k < P_WIDTH; k++) {
+                r_tail[k] = k < n - i ? rs[k] : 0;
+                p_tail[k] = k < n - i ? ps[k] : 0;
+            }
+            rs = r_tail;
+            ps = p_tail;
+            os = out_tail;
+        }
+        rv = P_LOAD(rs);
+        pv = P_LOAD(ps);
+        failed = P_ISNAN(P_SET1(0.0));
+
+        while (!done) {
+            unsigned char op = *pc++;
+            switch (op) {
+            case OP_RET:
+                P_STORE(os, P_SELECT(failed, P_SET1(NAN), sp[-1]));
+                done = 1;
+                break;
+            case OP_CONST:
+                *sp++ = P_CONST(constants[pc[0] | (pc[1] << 8)], lows[pc[0] | (pc[1] << 8)], 0.0);
+                pc += 2;
+                break;
+            case OP_R: *sp++ = rv; break;
+            case OP_P: *sp++ = pv; break;
+            case OP_VAR:
+                *sp++ = P_SET1(vars[(unsigned long)pc[0] | (unsigned long)pc[1] << 8 | (unsigned long)pc[2] << 16 |
+                    (unsigned long)pc[3] << 24]);
+                pc += 4;
+                break;
+            case OP_NEG: sp[-1] = P_NEG(sp[-1]); break;
+            case OP_ADD: sp--; sp[-1] = P_ADD(sp[-1], sp[0]); break;
+            case OP_SUB: sp--; sp[-1] = P_SUB(sp[-1], sp[0]); break;
+            case OP_MUL: sp--; sp[-1] = P_MUL(sp[-1], sp[0]); break;
+            case OP_DIV:
+                sp--;
+                failed = P_OR(failed, P_EQ(sp[0], P_SET1(0.0)));
+                sp[-1] = P_DIV(sp[-1], sp[0]);
+                break;
+            case OP_POW: case OP_HYP: case OP_MOD: case OP_BINOM:
+                sp--;
+                if (op == OP_POW) sp[-1] = P_FN(prec_pow)(sp[-1], sp[0]);
+                else if (op == OP_HYP) sp[-1] = P_FN(prec_hypot)(sp[-1], sp[0]);
+                else sp[-1] = P_FN(prec_apply_double)(op, sp[-1], sp[0]);
+                failed = P_OR(failed, P_ISNAN(sp[-1]));
+                break;
+            case OP_EXP: sp[-1] = P_FN(prec_exp)(sp[-1]); failed = P_OR(failed, P_ISNAN(sp[-1])); break;
+            case OP_LOG:
+                // Zero is outside the domain, as in calc_log()
+                failed = P_OR(failed, P_NOT(P_GT(sp[-1], P_SET1(0.0))));
+                sp[-1] = P_FN(prec_log)(sp[-1]);
+                break;
+            case OP_ABS: sp[-1] = P_ABS(sp[-1]); failed = P_OR(failed, P_ISNAN(sp[-1])); break;
+            case OP_SIN: case OP_COS: case OP_TAN: case OP_COT:
+                P_FN(prec_sincos)(sp[-1], &sp[-1], &cosine);
+                if (op == OP_COS) sp[-1] = cosine;
+                else if (op == OP_TAN) {
+                    failed = P_OR(failed, P_EQ(cosine, P_SET1(0.0)));
+                    sp[-1] = P_ADD(P_DIV(sp[-1], cosine), P_SET1(0.0));
+                }
+                else if (op == OP_COT) {
+                    failed = P_OR(failed, P_EQ(sp[-1], P_SET1(0.0)));
+                    sp[-1] = P_ADD(P_DIV(cosine, sp[-1]), P_SET1(0.0));
+                }
+                failed = P_OR(failed, P_ISNAN(sp[-1]));
+                break;
+            default:
+                sp[-1] = P_FN(prec_apply_double)(op, sp[-1], sp[-1]);
+                failed = P_OR(failed, P_ISNAN(sp[-1]));
+                break;
+            }
+        }
+        if (os == out_tail) memcpy(out + i, out_tail, (n - i) * sizeof(double));
+    }
+}
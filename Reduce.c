@@ -0,0 +1,209 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Reduction.h"
+#include "Thread.h"
+#include "Format.h"
+#include "Parse.h"
+
+/*
+ * Reductions of a stream of numbers ("--reduce"): count, sum, mean, variance, standard deviation,
+ * min, max, product and geometric mean of the whitespace-separated numbers of a file or standard
+ * input, read once in windows of bounded size. A window is cut into chunks that calc_thread_count()
+ * threads parse and reduce into partial CalcReductions, merged in chunk order.
+ *
+ * A chunk ends at the first whitespace REDUCE_CHUNK_SIZE bytes or more after its start, so chunks
+ * depend only on the input, and the results are the same whatever the number of threads.
+ */
+
+// Bytes of the input per chunk (a chunk extends to the end of the number it ends in)
+#define REDUCE_CHUNK_SIZE (1 << 16)
+// Chunks per thread and window
+#define REDUCE_CHUNKS_PER_THREAD 4
+// Longest number accepted
+#define REDUCE_TOKEN_MAX 4096
+// Values a chunk can hold: a character and a separator per number
+#define REDUCE_CHUNK_VALUES ((REDUCE_CHUNK_SIZE + REDUCE_TOKEN_MAX) / 2 + 1)
+// Invalid numbers remembered per chunk; those beyond are only counted
+#define REDUCE_CHUNK_ERRORS 8
+// Invalid numbers reported in total
+#define REDUCE_MAX_ERRORS 100
+
+typedef struct {
+    size_t line;           // Newlines in the chunk before the number
+    size_t start, len;     // The number in the chunk text
+    CalcConvStatus status;
+    size_t position;       // Offset of the offending character in the number
+} ReduceError;
+
+typedef struct {
+    const char* text;
+    size_t len;
+    CalcReduction partial;
+    size_t lines;          // Newlines in the chunk
+    size_t error_count;
+    ReduceError errors[REDUCE_CHUNK_ERRORS];
+} ReduceChunk;
+
+typedef struct {
+    ReduceChunk* chunks;
+    double** values;       // Per worker
+} ReduceRun;
+
+static int is_separator(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+static void reduce_chunk(void* context, size_t task, int worker) {
+    ReduceRun* run = (ReduceRun*)context;
+    ReduceChunk* chunk = &run->chunks[task];
+    double* values = run->values[worker];
+    const char* text = chunk->text;
+    size_t count = 0, i = 0;
+
+    calc_reduction_init(&chunk->partial);
+    chunk->lines = 0;
+    chunk->error_count = 0;
+    while (i < chunk->len) {
+        size_t start, offset = 0;
+        CalcConvStatus status;
+        if (is_separator(text[i])) {
+            if (text[i++] == '\n') chunk->lines++;
+            continue;
+        }
+        start = i;
+        while (i < chunk->len && !is_separator(text[i])) i++;
+        status = parse_number(text + start, i - start, &values[count], &offset);
+        if (status == CALC_CONV_OK) {
+            count++;
+            continue;
+        }
+        if (chunk->error_count < REDUCE_CHUNK_ERRORS) {
+            ReduceError* error = &chunk->errors[chunk->error_count];
+            error->line = chunk->lines;
+            error->start = start;
+            error->len = i - start;
+            error->status = status;
+            error->position = offset;
+        }
+        chunk->error_count++;
+    }
+    calc_reduction_add_n(&chunk->partial, values, count);
+}
+
+static void print_reduce_usage(void) {
+    printf("Usage: --reduce [FILE]\n");
+    printf("       Whitespace-separated numbers from FILE (default: standard input, also \"-\")\n");
+}
+
+/**
+ * @brief Reduces the numbers of a file or standard input and prints "<name>\t<value>" lines:
+ * count, sum, mean, variance and stddev (of the sample), min, max, product, log10_product
+ * (log10 |product|, finite where the product overflows) and geomean. Invalid numbers are reported
+ * on stderr with their line number and left out.
+ * @return 0 on success, 1 on a usage error, if the input cannot be read or a number was invalid.
+ */
+int run_reduce(int argc, char* argv[]) {
+    ReduceRun run;
+    CalcReduction total;
+    FILE* in = stdin;
+    char* buffer = NULL;
+    size_t window = (size_t)calc_thread_count() * REDUCE_CHUNKS_PER_THREAD;
+    size_t capacity = window * (REDUCE_CHUNK_SIZE + REDUCE_TOKEN_MAX) + 1;
+    size_t filled = 0, line_no = 0, errors = 0;
+    int threads = calc_thread_count(), eof = 0, status = 0;
+    const char* error = NULL;
+
+    if (argc > 1 || (argc == 1 && argv[0][0] == '-' && argv[0][1] != '\0')) { print_reduce_usage(); return 1; }
+    if (argc == 1 && strcmp(argv[0], "-") != 0) {
+        in = fopen(argv[0], "rb");
+        if (in == NULL) {
+            fprintf(stderr, "Error: Cannot open '%s'.\n", argv[0]);
+            return 1;
+        }
+    }
+
+    memset(&run, 0, sizeof(run));
+    buffer = (char*)malloc(capacity);
+    run.chunks = (ReduceChunk*)calloc(window, sizeof(ReduceChunk));
+    run.values = (double**)calloc((size_t)threads, sizeof(double*));
+    if (buffer == NULL || run.chunks == NULL || run.values == NULL) error = "Out of memory";
+    for (int w = 0; w < threads && error == NULL; w++) {
+        run.values[w] = (double*)malloc(REDUCE_CHUNK_VALUES * sizeof(double));
+        if (run.values[w] == NULL) error = "Out of memory";
+    }
+
+    calc_reduction_init(&total);
+    while (error == NULL && !(eof && filled == 0)) {
+        size_t chunks = 0, pos = 0;
+
+        if (!eof) {
+            filled += fread(buffer + filled, 1, capacity - filled, in);
+            if (filled < capacity) {
+                if (ferror(in)) { error = "Cannot read the input"; break; }
+                eof = 1;
+            }
+        }
+
+        // Cut the window into chunks; an unfinished chunk waits for the next window
+        while (pos < filled && chunks < window) {
+            size_t end = pos + REDUCE_CHUNK_SIZE;
+            if (end >= filled) {
+                if (!eof) break;
+                end = filled;
+            }
+            while (end < filled && !is_separator(buffer[end])) end++;
+            if (end - pos > REDUCE_CHUNK_SIZE + REDUCE_TOKEN_MAX) { error = "Number longer than 4096 characters"; break; }
+            if (end == filled && !eof) break;
+            run.chunks[chunks].text = buffer + pos;
+            run.chunks[chunks].len = end - pos;
+            chunks++;
+            pos = end;
+        }
+        if (error != NULL) break;
+
+        calc_parallel_for(chunks, reduce_chunk, &run);
+        for (size_t c = 0; c < chunks; c++) {
+            const ReduceChunk* chunk = &run.chunks[c];
+            for (size_t e = 0; e < chunk->error_count && e < REDUCE_CHUNK_ERRORS && errors + e < REDUCE_MAX_ERRORS; e++) {
+                const ReduceError* invalid = &chunk->errors[e];
+                fprintf(stderr, "Line %zu: Error: \"%.*s\": %s at position %zu.\n", line_no + invalid->line + 1,
+                    (int)(invalid->len > 40 ? 40 : invalid->len), chunk->text + invalid->start,
+                    invalid->status == CALC_CONV_OVERFLOW ? "Number out of range" : calc_conv_status_message(invalid->status),
+                    invalid->position + 1);
+            }
+            errors += chunk->error_count;
+            line_no += chunk->lines;
+            calc_reduction_merge(&total, &chunk->partial);
+        }
+
+        memmove(buffer, buffer + pos, filled - pos);
+        filled -= pos;
+    }
+    if (in != stdin) fclose(in);
+
+    if (errors > REDUCE_MAX_ERRORS) fprintf(stderr, "Error: %zu more invalid numbers.\n", errors - REDUCE_MAX_ERRORS);
+    if (error != NULL) {
+        fprintf(stderr, "Error: %s.\n", error);
+        status = 1;
+    }
+    else {
+        double variance = calc_reduction_variance(&total, 1);
+        printf("count\t%llu\n", total.count);
+        print_named_result("sum", calc_reduction_sum(&total));
+        print_named_result("mean", calc_reduction_mean(&total));
+        print_named_result("variance", variance);
+        print_named_result("stddev", sqrt(variance));
+        print_named_result("min", calc_reduction_min(&total));
+        print_named_result("max", calc_reduction_max(&total));
+        print_named_result("product", calc_reduction_product(&total));
+        print_named_result("log10_product", calc_reduction_log10_product(&total));
+        print_named_result("geomean", calc_reduction_geomean(&total));
+        status = errors > 0;
+    }
+
+    for (int w = 0; run.values != NULL && w < threads; w++) free(run.values[w]);
+    free(run.values);
+    free(run.chunks);
+    free(buffer);
+    return status;
+}
@@ -0,0 +1,350 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Reduction.h"
+#include "Simd.h"
+#include <float.h>
+
+// Bits of a double for the product kernels
+#define REDUCE_SIGN_BIT LLONG_MIN
+#define REDUCE_EXPONENT_BITS 0x7FF0000000000000LL
+#define REDUCE_SIGNIFICAND_BITS (LLONG_MIN | 0x000FFFFFFFFFFFFFLL) // Sign and fraction
+#define REDUCE_ONE_BITS 0x3FF0000000000000LL                        // 1.0
+#define REDUCE_TWO_52_BITS 0x4330000000000000LL                     // 2^52: OR-ing an integer below 2^52 adds it
+
+// The accumulators of calc_reduction_add_n(), lane by lane (counts held as doubles)
+typedef struct {
+    double sum[REDUCE_LANES], error[REDUCE_LANES], mean[REDUCE_LANES], m2[REDUCE_LANES];
+    double min[REDUCE_LANES], max[REDUCE_LANES], mantissa[REDUCE_LANES], exponent[REDUCE_LANES];
+    double zeros[REDUCE_LANES], infinities[REDUCE_LANES], nans[REDUCE_LANES], negatives[REDUCE_LANES];
+} ReduceLanes;
+
+// --- Scalar instantiation (also the reference for the vector kernels and the tail of the rows) ---
+
+static inline long long reduce_bits(double x) { long long i; memcpy(&i, &x, sizeof(i)); return i; }
+static inline double reduce_from_bits(long long i) { double x; memcpy(&x, &i, sizeof(x)); return x; }
+
+#define VD double
+#define VI long long
+#define VM int
+#define V_WIDTH 1
+#define V_FN(name) name##_scalar
+#define V_TARGET
+#define V_LOADU(p) (*(p))
+#define V_STOREU(p, v) (*(p) = (v))
+#define V_SET1(x) ((double)(x))
+#define VI_SET1(x) ((long long)(x))
+#define V_ADD(a, b) ((a) + (b))
+#define V_SUB(a, b) ((a) - (b))
+#define V_MUL(a, b) ((a) * (b))
+#define V_FMA(a, b, c) fma((a), (b), (c))
+#define V_ABS(a) fabs(a)
+#define V_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define V_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define V_AS_VI(v) reduce_bits(v)
+#define VI_AS_V(v) reduce_from_bits(v)
+#define VI_AND(a, b) ((a) & (b))
+#define VI_OR(a, b) ((a) | (b))
+#define VI_SHR(a, n) ((long long)((unsigned long long)(a) >> (n)))
+#define V_CMP_LT(a, b) ((a) < (b))
+#define V_CMP_GT(a, b) ((a) > (b))
+#define V_CMP_GE(a, b) ((a) >= (b))
+#define V_CMP_EQ(a, b) ((a) == (b))
+#define V_CMP_UNORD(a, b) (isnan(a) || isnan(b))
+#define M_OR(a, b) ((a) | (b))
+#define M_ANDNOT(a, b) ((a) & !(b))
+#define V_SELECT(m, a, b) ((m) ? (a) : (b))
+
+#include "ReductionKernels.h"
+
+#undef VD
+#undef VI
+#undef VM
+#undef V_WIDTH
+#undef V_FN
+#undef V_TARGET
+#undef V_LOADU
+#undef V_STOREU
+#undef V_SET1
+#undef VI_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_FMA
+#undef V_ABS
+#undef V_MIN
+#undef V_MAX
+#undef V_AS_VI
+#undef VI_AS_V
+#undef VI_AND
+#undef VI_OR
+#undef VI_SHR
+#undef V_CMP_LT
+#undef V_CMP_GT
+#undef V_CMP_GE
+#undef V_CMP_EQ
+#undef V_CMP_UNORD
+#undef M_OR
+#undef M_ANDNOT
+#undef V_SELECT
+
+#ifdef CALC_X86_SIMD
+
+// --- AVX2 instantiation ---
+
+#define VD __m256d
+#define VI __m256i
+#define VM __m256d
+#define V_WIDTH 4
+#define V_FN(name) name##_avx2
+#define V_TARGET CALC_TARGET_AVX2
+#define V_LOADU(p) _mm256_loadu_pd(p)
+#define V_STOREU(p, v) _mm256_storeu_pd((p), (v))
+#define V_SET1(x) _mm256_set1_pd(x)
+#define VI_SET1(x) _mm256_set1_epi64x(x)
+#define V_ADD(a, b) _mm256_add_pd((a), (b))
+#define V_SUB(a, b) _mm256_sub_pd((a), (b))
+#define V_MUL(a, b) _mm256_mul_pd((a), (b))
+#define V_FMA(a, b, c) _mm256_fmadd_pd((a), (b), (c))
+#define V_ABS(a) _mm256_andnot_pd(_mm256_set1_pd(-0.0), (a))
+#define V_MIN(a, b) _mm256_min_pd((a), (b))
+#define V_MAX(a, b) _mm256_max_pd((a), (b))
+#define V_AS_VI(v) _mm256_castpd_si256(v)
+#define VI_AS_V(v) _mm256_castsi256_pd(v)
+#define VI_AND(a, b) _mm256_and_si256((a), (b))
+#define VI_OR(a, b) _mm256_or_si256((a), (b))
+#define VI_SHR(a, n) _mm256_srli_epi64((a), (n))
+#define V_CMP_LT(a, b) _mm256_cmp_pd((a), (b), _CMP_LT_OQ)
+#define V_CMP_GT(a, b) _mm256_cmp_pd((a), (b), _CMP_GT_OQ)
+#define V_CMP_GE(a, b) _mm256_cmp_pd((a), (b), _CMP_GE_OQ)
+#define V_CMP_EQ(a, b) _mm256_cmp_pd((a), (b), _CMP_EQ_OQ)
+#define V_CMP_UNORD(a, b) _mm256_cmp_pd((a), (b), _CMP_UNORD_Q)
+#define M_OR(a, b) _mm256_or_pd((a), (b))
+#define M_ANDNOT(a, b) _mm256_andnot_pd((b), (a))
+#define V_SELECT(m, a, b) _mm256_blendv_pd((b), (a), (m))
+
+#include "ReductionKernels.h"
+
+#undef VD
+#undef VI
+#undef VM
+#undef V_WIDTH
+#undef V_FN
+#undef V_TARGET
+#undef V_LOADU
+#undef V_STOREU
+#undef V_SET1
+#undef VI_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_FMA
+#undef V_ABS
+#undef V_MIN
+#undef V_MAX
+#undef V_AS_VI
+#undef VI_AS_V
+#undef VI_AND
+#undef VI_OR
+#undef VI_SHR
+#undef V_CMP_LT
+#undef V_CMP_GT
+#undef V_CMP_GE
+#undef V_CMP_EQ
+#undef V_CMP_UNORD
+#undef M_OR
+#undef M_ANDNOT
+#undef V_SELECT
+
+// --- AVX-512 instantiation (masks are k-registers) ---
+
+#define VD __m512d
+#define VI __m512i
+#define VM __mmask8
+#define V_WIDTH 8
+#define V_FN(name) name##_avx512
+#define V_TARGET CALC_TARGET_AVX512
+#define V_LOADU(p) _mm512_loadu_pd(p)
+#define V_STOREU(p, v) _mm512_storeu_pd((p), (v))
+#define V_SET1(x) _mm512_set1_pd(x)
+#define VI_SET1(x) _mm512_set1_epi64(x)
+#define V_ADD(a, b) _mm512_add_pd((a), (b))
+#define V_SUB(a, b) _mm512_sub_pd((a), (b))
+#define V_MUL(a, b) _mm512_mul_pd((a), (b))
+#define V_FMA(a, b, c) _mm512_fmadd_pd((a), (b), (c))
+#define V_ABS(a) _mm512_abs_pd(a)
+#define V_MIN(a, b) _mm512_min_pd((a), (b))
+#define V_MAX(a, b) _mm512_max_pd((a), (b))
+#define V_AS_VI(v) _mm512_castpd_si512(v)
+#define VI_AS_V(v) _mm512_castsi512_pd(v)
+#define VI_AND(a, b) _mm512_and_si512((a), (b))
+#define VI_OR(a, b) _mm512_or_si512((a), (b))
+#define VI_SHR(a, n) _mm512_srli_epi64((a), (n))
+#define V_CMP_LT(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_LT_OQ)
+#define V_CMP_GT(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_GT_OQ)
+#define V_CMP_GE(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_GE_OQ)
+#define V_CMP_EQ(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_EQ_OQ)
+#define V_CMP_UNORD(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_UNORD_Q)
+#define M_OR(a, b) ((__mmask8)((a) | (b)))
+#define M_ANDNOT(a, b) ((__mmask8)((a) & ~(b)))
+#define V_SELECT(m, a, b) _mm512_mask_blend_pd((m), (b), (a))
+
+#include "ReductionKernels.h"
+
+#endif // CALC_X86_SIMD
+
+// --- Merging ---
+
+void calc_reduction_init(CalcReduction* r) {
+    memset(r, 0, sizeof(*r));
+    r->min = INFINITY;
+    r->max = -INFINITY;
+    r->mantissa = 1.0;
+}
+
+void calc_reduction_merge(CalcReduction* r, const CalcReduction* other) {
+    double n, delta, sum, b_virtual, sum_error;
+
+    if (other->count == 0) return;
+    if (r->count == 0) {
+        *r = *other;
+        return;
+    }
+
+    // Chan et al.: the deviations of each side from the merged mean
+    n = (double)r->count + (double)other->count;
+    delta = other->mean - r->mean;
+    r->mean += delta * ((double)other->count / n);
+    r->m2 += other->m2 + delta * delta * ((double)r->count * (double)other->count / n);
+
+    // Two-sum: the rounding error of the sum of the sums joins their own errors
+    sum = r->sum + other->sum;
+    b_virtual = sum - r->sum;
+    sum_error = (r->sum - (sum - b_virtual)) + (other->sum - b_virtual);
+    r->sum_error += other->sum_error + sum_error;
+    r->sum = sum;
+
+    r->min = other->min < r->min ? other->min : r->min;
+    r->max = other->max > r->max ? other->max : r->max;
+
+    r->mantissa *= other->mantissa;
+    r->exponent += other->exponent;
+    if (fabs(r->mantissa) >= 2.0) {
+        r->mantissa *= 0.5;
+        r->exponent += 1.0;
+    }
+
+    r->count += other->count;
+    r->zeros += other->zeros;
+    r->infinities += other->infinities;
+    r->nans += other->nans;
+    r->negatives += other->negatives;
+}
+
+/**
+ * @brief Merges lanes [0, REDUCE_LANES) into r in lane order; lane i holds rows + (i < extra) values.
+ */
+static void merge_lanes(CalcReduction* r, const ReduceLanes* lanes, size_t rows, size_t extra) {
+    for (size_t i = 0; i < REDUCE_LANES; i++) {
+        CalcReduction lane;
+        lane.count = rows + (i < extra);
+        lane.sum = lanes->sum[i];
+        lane.sum_error = lanes->error[i];
+        lane.mean = lanes->mean[i];
+        lane.m2 = lanes->m2[i];
+        lane.min = lanes->min[i];
+        lane.max = lanes->max[i];
+        lane.mantissa = lanes->mantissa[i];
+        lane.exponent = lanes->exponent[i];
+        lane.zeros = (unsigned long long)lanes->zeros[i];
+        lane.infinities = (unsigned long long)lanes->infinities[i];
+        lane.nans = (unsigned long long)lanes->nans[i];
+        lane.negatives = (unsigned long long)lanes->negatives[i];
+        calc_reduction_merge(r, &lane);
+    }
+}
+
+void calc_reduction_add_n(CalcReduction* r, const double* values, size_t n) {
+    ReduceLanes lanes;
+    CalcReduction block;
+    size_t rows = n / REDUCE_LANES, extra = n % REDUCE_LANES;
+
+    if (n == 0) return;
+    memset(&lanes, 0, sizeof(lanes));
+    for (size_t i = 0; i < REDUCE_LANES; i++) {
+        lanes.min[i] = INFINITY;
+        lanes.max[i] = -INFINITY;
+        lanes.mantissa[i] = 1.0;
+    }
+
+    switch (calc_simd_level()) {
+#ifdef CALC_X86_SIMD
+    case CALC_SIMD_AVX512: reduce_rows_avx512(&lanes, values, rows); break;
+    case CALC_SIMD_AVX2: reduce_rows_avx2(&lanes, values, rows); break;
+#endif
+    default: reduce_rows_scalar(&lanes, values, rows); break;
+    }
+
+    // The last values go to the first lanes, as the next row would
+    for (size_t i = 0; i < extra; i++) {
+        ReduceState_scalar s;
+        reduce_load_scalar(&s, &lanes, i);
+        reduce_step_scalar(&s, values[rows * REDUCE_LANES + i], 1.0 / (double)(rows + 1));
+        reduce_store_scalar(&s, &lanes, i);
+    }
+
+    calc_reduction_init(&block);
+    merge_lanes(&block, &lanes, rows, extra);
+    calc_reduction_merge(r, &block);
+}
+
+// --- Results ---
+
+double calc_reduction_sum(const CalcReduction* r) {
+    // Once the sum overflowed or met an infinity or NAN, the error term is meaningless
+    return isfinite(r->sum) ? r->sum + r->sum_error : r->sum;
+}
+
+double calc_reduction_mean(const CalcReduction* r) {
+    // The compensated sum gives a closer mean than Welford's running one, as long as it is finite
+    double sum = calc_reduction_sum(r);
+    if (r->count == 0) return NAN;
+    return isfinite(sum) ? sum / (double)r->count : r->mean;
+}
+
+double calc_reduction_variance(const CalcReduction* r, int sample) {
+    unsigned long long divisor = sample ? r->count - 1 : r->count;
+    if (r->count == 0 || divisor == 0) return NAN;
+    return r->m2 / (double)divisor;
+}
+
+double calc_reduction_min(const CalcReduction* r) {
+    return r->min <= r->max ? r->min : NAN;
+}
+
+double calc_reduction_max(const CalcReduction* r) {
+    return r->min <= r->max ? r->max : NAN;
+}
+
+double calc_reduction_product(const CalcReduction* r) {
+    if (r->nans > 0 || (r->zeros > 0 && r->infinities > 0)) return NAN;
+    if (r->zeros > 0) return copysign(0.0, r->mantissa);
+    if (r->infinities > 0) return copysign(INFINITY, r->mantissa);
+    // ldexp() takes an int; beyond these the result is +-inf or +-0 anyway
+    if (r->exponent > 4096) return copysign(INFINITY, r->mantissa);
+    if (r->exponent < -4096) return copysign(0.0, r->mantissa);
+    return ldexp(r->mantissa, (int)r->exponent);
+}
+
+double calc_reduction_log10_product(const CalcReduction* r) {
+    if (r->nans > 0 || (r->zeros > 0 && r->infinities > 0)) return NAN;
+    if (r->zeros > 0) return -INFINITY;
+    if (r->infinities > 0) return INFINITY;
+    return log10(fabs(r->mantissa)) + r->exponent * 0.30102999566398119521;
+}
+
+double calc_reduction_geomean(const CalcReduction* r) {
+    if (r->count == 0 || r->nans > 0 || r->negatives > 0 || (r->zeros > 0 && r->infinities > 0)) return NAN;
+    if (r->zeros > 0) return 0.0;
+    if (r->infinities > 0) return INFINITY;
+    return exp2((log2(fabs(r->mantissa)) + r->exponent) / (double)r->count);
+}
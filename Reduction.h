@@ -0,0 +1,95 @@
+#ifndef REDUCTION_H
+#define REDUCTION_H
+
+#include <stddef.h>
+
+/*
+ * One-pass reductions of a stream of numbers in constant memory: count, sum, mean, variance,
+ * min/max, product and geometric mean. A CalcReduction summarizes the values added to it and
+ * merges with another one, so blocks of a stream can be reduced by different threads and the
+ * partial results combined.
+ *
+ * The sum is compensated (Neumaier), mean and variance are updated with Welford's recurrence and
+ * merged with Chan's formula, and the product is held as a mantissa and a power of two so that it
+ * neither overflows nor underflows. calc_reduction_add_n() deals the values round-robin to
+ * REDUCE_LANES accumulators, updated by AVX2 and AVX-512 kernels or by the scalar code with the
+ * same operations in the same order, and merges the lanes in lane order: the result depends on
+ * the values and on how they were cut into calls and merged, never on the SIMD level, the number
+ * of threads or which thread reduced which block.
+ *
+ * NAN values propagate to the sum, mean, variance, product and geometric mean, but min and max
+ * ignore them.
+ */
+
+// Accumulators calc_reduction_add_n() deals the values to (one AVX-512 vector, two AVX2 vectors)
+#define REDUCE_LANES 8
+
+typedef struct {
+    unsigned long long count;
+    double sum, sum_error;       // The sum is sum + sum_error
+    double mean, m2;             // m2: sum of the squared deviations from the mean
+    double min, max;             // +inf and -inf while no value other than NAN was added
+    double mantissa, exponent;   // Product of the finite non-zero values: mantissa * 2^exponent, 1 <= |mantissa| < 2
+    unsigned long long zeros, infinities, nans, negatives; // Zeros, infinities and NAN count as +-1 in the mantissa
+} CalcReduction;
+
+/**
+ * @brief Initializes an empty reduction.
+ */
+void calc_reduction_init(CalcReduction* r);
+
+/**
+ * @brief Adds n values to r.
+ */
+void calc_reduction_add_n(CalcReduction* r, const double* values, size_t n);
+
+/**
+ * @brief Adds the values summarized by other to r, as if they had been added after those of r.
+ */
+void calc_reduction_merge(CalcReduction* r, const CalcReduction* other);
+
+/**
+ * @brief Returns the compensated sum (0 for no values).
+ */
+double calc_reduction_sum(const CalcReduction* r);
+
+/**
+ * @brief Returns the mean (NAN for no values): the compensated sum divided by the count, or where
+ * the sum overflows, the running mean.
+ */
+double calc_reduction_mean(const CalcReduction* r);
+
+/**
+ * @brief Returns the variance: of the sample (divided by count - 1, NAN below 2 values) or of the
+ * population (divided by count, NAN for no values).
+ */
+double calc_reduction_variance(const CalcReduction* r, int sample);
+
+/**
+ * @brief Returns the smallest value other than NAN (NAN if there is none).
+ */
+double calc_reduction_min(const CalcReduction* r);
+
+/**
+ * @brief Returns the largest value other than NAN (NAN if there is none).
+ */
+double calc_reduction_max(const CalcReduction* r);
+
+/**
+ * @brief Returns the product (1 for no values), +-inf or +-0 beyond the range of a double.
+ */
+double calc_reduction_product(const CalcReduction* r);
+
+/**
+ * @brief Returns log10 of the magnitude of the product, finite also where the product itself
+ * overflows or underflows (-inf if a value is 0, NAN if one is NAN or there are both 0 and inf).
+ */
+double calc_reduction_log10_product(const CalcReduction* r);
+
+/**
+ * @brief Returns the geometric mean: the count-th root of the product (NAN for no values or if a
+ * value is negative or NAN).
+ */
+double calc_reduction_geomean(const CalcReduction* r);
+
+#endif // REDUCTION_H
@@ -0,0 +1,97 @@
+/*
+ * Reduction kernel template for Reduction.c - deliberately has no include guard.
+ *
+ * Reduction.c includes this file once per instruction set after defining the vector abstraction
+ * of VectorMathKernels.h (VD, VI, VM, V_WIDTH, V_FN, V_TARGET and the V_*, VI_* and M_* operations
+ * used below). V_WIDTH divides REDUCE_LANES, and value i of a row of REDUCE_LANES values always
+ * updates lane i. Every instantiation performs the same IEEE operations in the same order
+ * (fused multiply-adds included), so the lanes come out bit-identical from all of them.
+ */
+
+// Accumulators of V_WIDTH lanes
+typedef struct {
+    VD sum, error, mean, m2, min, max, mantissa, exponent, zeros, infinities, nans, negatives;
+} V_FN(ReduceState);
+
+V_TARGET static inline void V_FN(reduce_load)(V_FN(ReduceState)* s, const ReduceLanes* lanes, size_t lane) {
+    s->sum = V_LOADU(lanes->sum + lane);
+    s->error = V_LOADU(lanes->error + lane);
+    s->mean = V_LOADU(lanes->mean + lane);
+    s->m2 = V_LOADU(lanes->m2 + lane);
+    s->min = V_LOADU(lanes->min + lane);
+    s->max = V_LOADU(lanes->max + lane);
+    s->mantissa = V_LOADU(lanes->mantissa + lane);
+    s->exponent = V_LOADU(lanes->exponent + lane);
+    s->zeros = V_LOADU(lanes->zeros + lane);
+    s->infinities = V_LOADU(lanes->infinities + lane);
+    s->nans = V_LOADU(lanes->nans + lane);
+    s->negatives = V_LOADU(lanes->negatives + lane);
+}
+
+V_TARGET static inline void V_FN(reduce_store)(const V_FN(ReduceState)* s, ReduceLanes* lanes, size_t lane) {
+    V_STOREU(lanes->sum + lane, s->sum);
+    V_STOREU(lanes->error + lane, s->error);
+    V_STOREU(lanes->mean + lane, s->mean);
+    V_STOREU(lanes->m2 + lane, s->m2);
+    V_STOREU(lanes->min + lane, s->min);
+    V_STOREU(lanes->max + lane, s->max);
+    V_STOREU(lanes->mantissa + lane, s->mantissa);
+    V_STOREU(lanes->exponent + lane, s->exponent);
+    V_STOREU(lanes->zeros + lane, s->zeros);
+    V_STOREU(lanes->infinities + lane, s->infinities);
+    V_STOREU(lanes->nans + lane, s->nans);
+    V_STOREU(lanes->negatives + lane, s->negatives);
+}
+
+// Adds x to lanes that hold count - 1 values each (inv_count = 1 / count)
+V_TARGET static inline void V_FN(reduce_step)(V_FN(ReduceState)* s, VD x, VD inv_count) {
+    VD ax = V_ABS(x), one = V_SET1(1.0), none = V_SET1(0.0);
+    VM zero = V_CMP_EQ(x, none), infinite = V_CMP_GT(ax, V_SET1(DBL_MAX)), nan = V_CMP_UNORD(x, x);
+    VM special = M_OR(M_OR(zero, infinite), nan);
+    VM denormal = M_ANDNOT(V_CMP_LT(ax, V_SET1(DBL_MIN)), zero);
+    VM larger = V_CMP_GE(V_ABS(s->sum), ax), carry;
+    VD sum = V_ADD(s->sum, x), delta = V_SUB(x, s->mean), factor, exponent;
+    VI bits = V_AS_VI(x), factor_bits;
+
+    // Neumaier: the rounding error of the addition, recovered from the larger operand
+    s->error = V_ADD(s->error, V_ADD(V_SUB(V_SELECT(larger, s->sum, x), sum), V_SELECT(larger, x, s->sum)));
+    s->sum = sum;
+
+    // Welford
+    s->mean = V_FMA(delta, inv_count, s->mean);
+    s->m2 = V_FMA(delta, V_SUB(x, s->mean), s->m2);
+
+    // The NAN operand is the one minpd/maxpd (and the scalar ?:) pass over
+    s->min = V_MIN(x, s->min);
+    s->max = V_MAX(x, s->max);
+
+    // Product: zeros, infinities and NAN multiply by their sign only, denormals are scaled by 2^64
+    factor = V_SELECT(special, VI_AS_V(VI_OR(VI_AND(bits, VI_SET1(REDUCE_SIGN_BIT)), VI_SET1(REDUCE_ONE_BITS))),
+        V_SELECT(denormal, V_MUL(x, V_SET1(0x1p64)), x));
+    factor_bits = V_AS_VI(factor);
+    exponent = V_SUB(VI_AS_V(VI_OR(VI_SHR(VI_AND(factor_bits, VI_SET1(REDUCE_EXPONENT_BITS)), 52), VI_SET1(REDUCE_TWO_52_BITS))),
+        V_SET1(0x1p52 + 1023));
+    s->exponent = V_ADD(s->exponent, V_SELECT(denormal, V_SUB(exponent, V_SET1(64.0)), exponent));
+    s->mantissa = V_MUL(s->mantissa, VI_AS_V(VI_OR(VI_AND(factor_bits, VI_SET1(REDUCE_SIGNIFICAND_BITS)), VI_SET1(REDUCE_ONE_BITS))));
+    carry = V_CMP_GE(V_ABS(s->mantissa), V_SET1(2.0));
+    s->mantissa = V_SELECT(carry, V_MUL(s->mantissa, V_SET1(0.5)), s->mantissa);
+    s->exponent = V_SELECT(carry, V_ADD(s->exponent, one), s->exponent);
+
+    s->zeros = V_ADD(s->zeros, V_SELECT(zero, one, none));
+    s->infinities = V_ADD(s->infinities, V_SELECT(infinite, one, none));
+    s->nans = V_ADD(s->nans, V_SELECT(nan, one, none));
+    s->negatives = V_ADD(s->negatives, V_SELECT(V_CMP_LT(x, none), one, none));
+}
+
+// Adds rows of REDUCE_LANES values to lanes that hold no values yet
+V_TARGET static void V_FN(reduce_rows)(ReduceLanes* lanes, const double* values, size_t rows) {
+    V_FN(ReduceState) s[REDUCE_LANES / V_WIDTH];
+
+    for (size_t g = 0; g < REDUCE_LANES / V_WIDTH; g++) V_FN(reduce_load)(&s[g], lanes, g * V_WIDTH);
+    for (size_t row = 0; row < rows; row++) {
+        VD inv_count = V_SET1(1.0 / (double)(row + 1));
+        const double* x = values + row * REDUCE_LANES;
+        for (size_t g = 0; g < REDUCE_LANES / V_WIDTH; g++) V_FN(reduce_step)(&s[g], V_LOADU(x + g * V_WIDTH), inv_count);
+    }
+    for (size_t g = 0; g < REDUCE_LANES / V_WIDTH; g++) V_FN(reduce_store)(&s[g], lanes, g * V_WIDTH);
+}
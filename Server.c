@@ -0,0 +1,500 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Server.h"
+#include "Thread.h"
+
+#if !defined(CALC_HAVE_SERVER)
+
+int run_server(int argc, char* argv[]) {
+    (void)argc;
+    (void)argv;
+    fprintf(stderr, "Error: Server mode is not available in this build (it needs Linux).\n");
+    return 1;
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Events handled per epoll_wait() call
+#define SERVER_EVENTS 256
+// Bytes read from a connection per wake-up, so that one busy client cannot starve the others
+#define SERVER_READ_BYTES (64 * 1024)
+// Unsent responses above which a connection is not read until its client catches up
+#define SERVER_OUTPUT_LIMIT (1 << 20)
+// Most event loops (threads) of a server
+#define SERVER_MAX_LOOPS 256
+
+#if !defined(EPOLLEXCLUSIVE)
+#define EPOLLEXCLUSIVE 0 // Before Linux 4.5: every loop wakes up for a connection on a shared socket
+#endif
+
+int server_parse_endpoint(const char* spec, ServerEndpoint* endpoint) {
+    memset(endpoint, 0, sizeof(*endpoint));
+    if (strncmp(spec, "unix:", 5) == 0) {
+        struct sockaddr_un* address = (struct sockaddr_un*)&endpoint->address;
+        size_t len = strlen(spec + 5);
+        if (len == 0 || len >= sizeof(address->sun_path)) return 0;
+        address->sun_family = AF_UNIX;
+        memcpy(address->sun_path, spec + 5, len + 1);
+        endpoint->length = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + len + 1);
+        endpoint->family = AF_UNIX;
+        return 1;
+    }
+    if (strncmp(spec, "tcp:", 4) == 0) {
+        struct sockaddr_in* address = (struct sockaddr_in*)&endpoint->address;
+        const char* port = strrchr(spec + 4, ':');
+        char host[64] = "127.0.0.1";
+        char* end;
+        long number;
+
+        if (port != NULL) {
+            size_t len = (size_t)(port - (spec + 4));
+            if (len >= sizeof(host)) return 0;
+            memcpy(host, spec + 4, len);
+            host[len] = '\0';
+            port++;
+        }
+        else {
+            port = spec + 4;
+        }
+        number = strtol(port, &end, 10);
+        if (*port == '\0' || *end != '\0' || number <= 0 || number > 65535) return 0;
+        address->sin_family = AF_INET;
+        address->sin_port = htons((unsigned short)number);
+        if (inet_pton(AF_INET, host, &address->sin_addr) != 1) return 0;
+        endpoint->length = sizeof(struct sockaddr_in);
+        endpoint->family = AF_INET;
+        return 1;
+    }
+    return 0;
+}
+
+
+// --- Connections ---
+
+typedef struct ServerConnection {
+    struct ServerConnection* prev;
+    struct ServerConnection* next;
+    int fd;
+    uint32_t events;        // Events the connection is registered for
+    int eof;                // The client has shut down its side: answer what is left, then close
+    int skipping;           // Dropping the rest of a line that is too long
+    CalcContext ctx;        // R and P of this connection
+    BatchSession* session;  // Compiled expressions of this connection
+    char* in;               // Received bytes not yet evaluated (an incomplete line)
+    size_t in_len, in_capacity;
+    char* out;              // Responses not yet sent, from out_pos on
+    size_t out_pos, out_len, out_capacity;
+} ServerConnection;
+
+typedef struct {
+    int epoll;
+    int listener;
+    int owns_listener; // SO_REUSEPORT socket of this loop (closed with it)
+    int tcp;
+    int stopped;
+    ServerConnection* connections;
+    unsigned long accepted, requests;
+} ServerLoop;
+
+// Tags of the epoll registrations that are not connections
+static char listener_tag, stop_tag;
+
+// Written to by the SIGINT/SIGTERM handler and never read, so that every loop wakes up
+static int server_stop_pipe[2] = { -1, -1 };
+
+static void server_stop_handler(int signal_number) {
+    int saved_errno = errno;
+    char byte = 0;
+    (void)signal_number;
+    if (write(server_stop_pipe[1], &byte, 1) < 0) {
+        // Nothing to do: the pipe is already readable
+    }
+    errno = saved_errno;
+}
+
+static int grow_bytes(char** data, size_t* capacity, size_t needed) {
+    if (needed > *capacity) {
+        size_t grown = *capacity ? *capacity : 4096;
+        char* bigger;
+        while (grown < needed) grown *= 2;
+        bigger = (char*)realloc(*data, grown);
+        if (bigger == NULL) return 0;
+        *data = bigger;
+        *capacity = grown;
+    }
+    return 1;
+}
+
+static int connection_respond(ServerConnection* conn, const char* text, size_t len) {
+    if (!grow_bytes(&conn->out, &conn->out_capacity, conn->out_len + len)) return 0;
+    memcpy(conn->out + conn->out_len, text, len);
+    conn->out_len += len;
+    return 1;
+}
+
+static void connection_close(ServerLoop* loop, ServerConnection* conn) {
+    epoll_ctl(loop->epoll, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    if (conn->prev != NULL) conn->prev->next = conn->next;
+    else loop->connections = conn->next;
+    if (conn->next != NULL) conn->next->prev = conn->prev;
+    batch_session_free(conn->session);
+    free(conn->in);
+    free(conn->out);
+    free(conn);
+}
+
+/**
+ * @brief Evaluates the complete lines received so far, in order, and queues their responses.
+ * At the end of the input, a last line without a newline is evaluated as well.
+ * @return 0 if the connection has to be closed.
+ */
+static int connection_evaluate(ServerLoop* loop, ServerConnection* conn) {
+    static const char too_long[] = "error: Line too long\n";
+    size_t start = 0;
+    const char* newline;
+
+    while ((newline = (const char*)memchr(conn->in + start, '\n', conn->in_len - start)) != NULL) {
+        size_t len = (size_t)(newline - (conn->in + start)), response_len;
+        const char* response = too_long;
+        if (conn->skipping) {
+            // The end of a line that was too long, which fails like in batch mode
+            response_len = sizeof(too_long) - 1;
+            conn->skipping = 0;
+        }
+        else {
+            response = batch_session_eval(conn->session, &conn->ctx, conn->in + start, len, &response_len);
+        }
+        if (!connection_respond(conn, response, response_len)) return 0;
+        start += len + 1;
+        loop->requests++;
+    }
+    conn->in_len -= start;
+    memmove(conn->in, conn->in + start, conn->in_len);
+
+    // Lines are as long as in batch mode, so a conversion line may take many reads to arrive
+    if (conn->in_len >= batch_line_limit(conn->in, conn->in_len) || (conn->skipping && conn->in_len > 0)) {
+        // No line ending in sight: drop the line up to its end instead of buffering it
+        conn->in_len = 0;
+        conn->skipping = 1;
+    }
+    if (conn->eof && conn->skipping) {
+        conn->skipping = 0;
+        loop->requests++;
+        return connection_respond(conn, too_long, sizeof(too_long) - 1);
+    }
+    if (conn->eof && conn->in_len > 0) {
+        size_t response_len;
+        const char* response;
+        conn->in[conn->in_len] = '\0'; // The read buffer always has room for it
+        response = batch_session_eval(conn->session, &conn->ctx, conn->in, conn->in_len, &response_len);
+        conn->in_len = 0;
+        loop->requests++;
+        return connection_respond(conn, response, response_len);
+    }
+    return 1;
+}
+
+/**
+ * @brief Registers the connection for the events it is waiting for: input unless it has ended or
+ * too many responses are unsent, output while responses are unsent.
+ * @return 0 if the connection is finished and has to be closed.
+ */
+static int connection_update(ServerLoop* loop, ServerConnection* conn) {
+    size_t unsent = conn->out_len - conn->out_pos;
+    uint32_t events = 0;
+
+    if (conn->eof && unsent == 0) return 0;
+    if (!conn->eof && unsent < SERVER_OUTPUT_LIMIT) events |= EPOLLIN | EPOLLRDHUP;
+    if (unsent > 0) events |= EPOLLOUT;
+    if (events != conn->events) {
+        struct epoll_event event;
+        event.events = events;
+        event.data.ptr = conn;
+        if (epoll_ctl(loop->epoll, EPOLL_CTL_MOD, conn->fd, &event) != 0) return 0;
+        conn->events = events;
+    }
+    return 1;
+}
+
+// Sends as many queued responses as the socket takes; returns 0 on an error
+static int connection_send(ServerConnection* conn) {
+    while (conn->out_pos < conn->out_len) {
+        ssize_t sent = send(conn->fd, conn->out + conn->out_pos, conn->out_len - conn->out_pos, MSG_NOSIGNAL);
+        if (sent > 0) { conn->out_pos += (size_t)sent; continue; }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return 0;
+    }
+    // Drop the sent responses once they are half the buffer, so that a client that keeps
+    // pipelining while its responses drain does not make the buffer grow without bound
+    if (conn->out_pos > 0 && (conn->out_pos == conn->out_len || conn->out_pos > conn->out_capacity / 2)) {
+        conn->out_len -= conn->out_pos;
+        memmove(conn->out, conn->out + conn->out_pos, conn->out_len);
+        conn->out_pos = 0;
+    }
+    return 1;
+}
+
+// Reads what the client sent (up to SERVER_READ_BYTES), evaluates it and sends the responses
+static int connection_receive(ServerLoop* loop, ServerConnection* conn) {
+    size_t budget = SERVER_READ_BYTES;
+    while (budget > 0 && !conn->eof) {
+        ssize_t received;
+        size_t room;
+        // One byte more for the '\0' after a final line without a newline
+        if (!grow_bytes(&conn->in, &conn->in_capacity, conn->in_len + 4096 + 1)) return 0;
+        room = conn->in_capacity - conn->in_len - 1;
+        received = recv(conn->fd, conn->in + conn->in_len, room < budget ? room : budget, 0);
+        if (received > 0) {
+            conn->in_len += (size_t)received;
+            budget -= (size_t)received;
+        }
+        else if (received == 0) {
+            conn->eof = 1;
+        }
+        else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        }
+        else if (errno != EINTR) {
+            return 0;
+        }
+    }
+    return connection_evaluate(loop, conn) && connection_send(conn);
+}
+
+static void server_accept(ServerLoop* loop) {
+    for (;;) {
+        struct epoll_event event;
+        ServerConnection* conn;
+        int fd = accept4(loop->listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            return; // EAGAIN: no more; anything else (e.g. EMFILE) is retried on the next event
+        }
+        if (loop->tcp) {
+            // Responses are written in one send() per batch of requests; do not delay them
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        conn = (ServerConnection*)calloc(1, sizeof(ServerConnection));
+        if (conn != NULL) conn->session = batch_session_create();
+        if (conn == NULL || conn->session == NULL) {
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->fd = fd;
+        conn->events = EPOLLIN | EPOLLRDHUP;
+        calc_init(&conn->ctx);
+        event.events = conn->events;
+        event.data.ptr = conn;
+        if (epoll_ctl(loop->epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+            batch_session_free(conn->session);
+            free(conn);
+            close(fd);
+            continue;
+        }
+        conn->next = loop->connections;
+        if (loop->connections != NULL) loop->connections->prev = conn;
+        loop->connections = conn;
+        loop->accepted++;
+    }
+}
+
+// Thread function of an event loop
+static void server_loop_run(void* arg) {
+    ServerLoop* loop = (ServerLoop*)arg;
+    struct epoll_event events[SERVER_EVENTS];
+
+    while (!loop->stopped) {
+        int count = epoll_wait(loop->epoll, events, SERVER_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            ServerConnection* conn = (ServerConnection*)events[i].data.ptr;
+            if (events[i].data.ptr == &stop_tag) { loop->stopped = 1; continue; }
+            if (events[i].data.ptr == &listener_tag) { server_accept(loop); continue; }
+
+            if ((events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) && !connection_receive(loop, conn)) {
+                connection_close(loop, conn);
+                continue;
+            }
+            if (((events[i].events & EPOLLOUT) && !connection_send(conn)) || (events[i].events & EPOLLERR) ||
+                !connection_update(loop, conn)) {
+                connection_close(loop, conn);
+            }
+        }
+    }
+    while (loop->connections != NULL) connection_close(loop, loop->connections);
+}
+
+
+// --- Setup ---
+
+static int server_listen(const ServerEndpoint* endpoint, int reuse_port) {
+    int fd = socket(endpoint->family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int one = 1;
+
+    if (fd < 0) return -1;
+    if (endpoint->family == AF_INET) {
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (reuse_port && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+            close(fd);
+            return -1;
+        }
+    }
+    if (bind(fd, (const struct sockaddr*)&endpoint->address, endpoint->length) != 0 || listen(fd, SOMAXCONN) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int loop_register(ServerLoop* loop, int fd, void* tag, uint32_t events) {
+    struct epoll_event event;
+    event.events = events;
+    event.data.ptr = tag;
+    return epoll_ctl(loop->epoll, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+/**
+ * @brief Sets up an event loop on the listening socket listener (shared), or on a new
+ * SO_REUSEPORT socket of its own if listener is -1.
+ * @return 1 on success, 0 on failure (with nothing left open).
+ */
+static int loop_open(ServerLoop* loop, const ServerEndpoint* endpoint, int listener) {
+    memset(loop, 0, sizeof(*loop));
+    loop->owns_listener = listener < 0;
+    loop->tcp = endpoint->family == AF_INET;
+    loop->listener = listener >= 0 ? listener : server_listen(endpoint, 1);
+    if (loop->listener < 0) return 0;
+    loop->epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll >= 0 &&
+        loop_register(loop, loop->listener, &listener_tag, EPOLLIN | (loop->owns_listener ? 0 : EPOLLEXCLUSIVE)) &&
+        loop_register(loop, server_stop_pipe[0], &stop_tag, EPOLLIN)) {
+        return 1;
+    }
+    if (loop->epoll >= 0) close(loop->epoll);
+    if (loop->owns_listener) close(loop->listener);
+    return 0;
+}
+
+static void loop_close(ServerLoop* loop) {
+    close(loop->epoll);
+    if (loop->owns_listener) close(loop->listener);
+}
+
+static void print_server_usage(void) {
+    printf("Usage: --server [--listen unix:PATH|tcp:[HOST:]PORT] [--loops N]\n");
+}
+
+/**
+ * @brief Runs the calculation server until SIGINT or SIGTERM (see Server.h for the protocol).
+ * Options: --listen ENDPOINT (default SERVER_DEFAULT_ENDPOINT), --loops N event loops
+ * (default calc_thread_count()).
+ * @return 0 after a clean stop, 1 on a usage error or if the endpoint cannot be listened on.
+ */
+int run_server(int argc, char* argv[]) {
+    const char* spec = SERVER_DEFAULT_ENDPOINT;
+    int loop_count = calc_thread_count();
+    ServerEndpoint endpoint;
+    ServerLoop* loops;
+    CalcThread** threads;
+    struct sigaction action;
+    int shared = -1, opened = 0, started = 1;
+    unsigned long accepted = 0, requests = 0;
+
+    for (int i = 0; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) { print_server_usage(); return 1; }
+        if (strcmp(argv[i], "--listen") == 0) spec = value;
+        else if (strcmp(argv[i], "--loops") == 0) loop_count = atoi(value);
+        else { print_server_usage(); return 1; }
+        i++;
+    }
+    if (!server_parse_endpoint(spec, &endpoint)) {
+        fprintf(stderr, "Error: Invalid endpoint '%s'.\n", spec);
+        return 1;
+    }
+    if (loop_count < 1) loop_count = 1;
+    if (loop_count > SERVER_MAX_LOOPS) loop_count = SERVER_MAX_LOOPS;
+
+    if (pipe2(server_stop_pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+        fprintf(stderr, "Error: Cannot create a pipe.\n");
+        return 1;
+    }
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = server_stop_handler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (endpoint.family == AF_UNIX) {
+        // Replace the socket of a previous server, but never another kind of file
+        struct stat info;
+        const char* path = ((const struct sockaddr_un*)&endpoint.address)->sun_path;
+        if (stat(path, &info) == 0 && S_ISSOCK(info.st_mode)) unlink(path);
+    }
+
+    // Every TCP loop gets an SO_REUSEPORT socket; Unix domain sockets cannot spread connections
+    // that way, so their loops share one socket (as TCP loops do where SO_REUSEPORT fails)
+    loops = (ServerLoop*)calloc((size_t)loop_count, sizeof(ServerLoop));
+    threads = (CalcThread**)calloc((size_t)loop_count, sizeof(CalcThread*));
+    if (loops != NULL && threads != NULL) {
+        if (endpoint.family == AF_INET && loop_count > 1) opened = loop_open(&loops[0], &endpoint, -1);
+        if (!opened) shared = server_listen(&endpoint, 0);
+        if (shared >= 0) opened = loop_open(&loops[0], &endpoint, shared);
+    }
+    if (!opened) {
+        fprintf(stderr, "Error: Cannot listen on '%s'.\n", spec);
+        if (shared >= 0) close(shared);
+        free(loops);
+        free(threads);
+        close(server_stop_pipe[0]);
+        close(server_stop_pipe[1]);
+        return 1;
+    }
+    // Loop 0 runs in this thread; stop adding loops at the first that cannot be opened or started
+    while (started < loop_count && loop_open(&loops[started], &endpoint, shared)) {
+        threads[started] = calc_thread_start(server_loop_run, &loops[started]);
+        if (threads[started] == NULL) {
+            loop_close(&loops[started]);
+            break;
+        }
+        started++;
+    }
+    fprintf(stderr, "Listening on %s with %d event loop%s (Ctrl+C to stop).\n", spec, started, started > 1 ? "s" : "");
+
+    server_loop_run(&loops[0]);
+    for (int i = 0; i < started; i++) {
+        if (i > 0) calc_thread_join(threads[i]);
+        accepted += loops[i].accepted;
+        requests += loops[i].requests;
+        loop_close(&loops[i]);
+    }
+    if (shared >= 0) close(shared);
+    if (endpoint.family == AF_UNIX) unlink(((const struct sockaddr_un*)&endpoint.address)->sun_path);
+    close(server_stop_pipe[0]);
+    close(server_stop_pipe[1]);
+    fprintf(stderr, "Server stopped after %lu connection%s and %lu request%s.\n", accepted, accepted == 1 ? "" : "s",
+        requests, requests == 1 ? "" : "s");
+    free(loops);
+    free(threads);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+/*
+ * Calculation server (Server.c) and its load generator (LoadGen.c).
+ *
+ * The protocol is the batch syntax over a stream socket: the client sends operation lines
+ * ("mul 3.5 R", "= hypot(sin(30), R^2) / log(P)", ...) and receives one response line per
+ * operation, in order: the result, or "error: <message>". Blank and comment lines get no response.
+ * Requests can be pipelined: a client may send any number of lines before reading the responses.
+ * Every connection has its own R/P history, starting at 0 like a new interactive session, and its
+ * own variables ("<name> = <formula>" lines, see Sheet.h).
+ *
+ * The server is one epoll event loop per thread; with TCP every loop has its own listening socket
+ * (SO_REUSEPORT, the kernel spreads the connections), with a Unix domain socket they share one.
+ * Both need Linux; elsewhere, or with CALC_NO_SERVER defined, run_server() and run_loadgen() fail.
+ */
+
+#if defined(__linux__) && !defined(CALC_NO_SERVER)
+#define CALC_HAVE_SERVER
+#endif
+
+// Where the server listens by default: "unix:PATH" or "tcp:[HOST:]PORT" (HOST is a numeric IPv4 address)
+#define SERVER_DEFAULT_ENDPOINT "tcp:127.0.0.1:7411"
+
+#if defined(CALC_HAVE_SERVER)
+
+#include <sys/socket.h>
+
+typedef struct {
+    struct sockaddr_storage address;
+    socklen_t length;
+    int family; // AF_UNIX or AF_INET
+} ServerEndpoint;
+
+/**
+ * @brief Parses an endpoint ("unix:/tmp/calc.sock", "tcp:7411", "tcp:127.0.0.1:7411").
+ * @return 1 on success, 0 if spec is not a valid endpoint.
+ */
+int server_parse_endpoint(const char* spec, ServerEndpoint* endpoint);
+
+#endif
+
+#endif // SERVER_H
@@ -0,0 +1,183 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Snapshot.h"
+#include <errno.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <io.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifndef CALC_NO_MMAP
+#include <sys/mman.h>
+#endif
+#endif
+
+/*
+ * Sessions saved between runs ("--session FILE"): the snapshot of Snapshot.h written to a file.
+ *
+ * A save never leaves a partial file behind: the snapshot goes to a temporary file next to the
+ * session, is flushed to the disk and then renamed over the session, so a crash leaves either the
+ * old session or the new one. A load maps the file copy on write and hands the mapping to the
+ * sheet, which uses its strings, links and name index in place until it is freed (see
+ * calc_snapshot_adopt()); where the file cannot be mapped, it is read into a buffer the sheet
+ * adopts the same way.
+ */
+
+#if !defined(_WIN32) && !defined(CALC_NO_MMAP)
+// Maps a regular file privately, so that edits of the restored sheet write to copies of its pages
+static void* map_file(const char* path, size_t* size) {
+    struct stat info;
+    void* data = NULL;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) return NULL;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        data = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) data = NULL;
+        else *size = (size_t)info.st_size;
+    }
+    close(fd);
+    return data;
+}
+
+static void unmap_file(void* data, size_t size) {
+    munmap(data, size);
+}
+#endif
+
+static void free_file(void* data, size_t size) {
+    (void)size;
+    free(data);
+}
+
+// Reads the whole file into a new buffer (aligned by malloc()); NULL (with errno set) if it cannot be read
+static void* read_file(const char* path, size_t* size) {
+    FILE* in = fopen(path, "rb");
+    char* data = NULL;
+    size_t capacity = 0;
+
+    *size = 0;
+    if (in == NULL) return NULL;
+    for (;;) {
+        size_t got;
+        if (*size == capacity) {
+            char* grown;
+            capacity = capacity ? capacity * 2 : 1 << 16;
+            grown = (char*)realloc(data, capacity);
+            if (grown == NULL) {
+                free(data);
+                fclose(in);
+                errno = ENOMEM;
+                return NULL;
+            }
+            data = grown;
+        }
+        got = fread(data + *size, 1, capacity - *size, in);
+        *size += got;
+        if (got == 0) break;
+    }
+    if (ferror(in)) {
+        free(data);
+        data = NULL;
+        errno = EIO;
+    }
+    fclose(in);
+    return data;
+}
+
+int session_load(const char* path, CalcContext* ctx, CalcSheet* sheet) {
+    CalcStatus status;
+    size_t size = 0;
+    void* data = NULL;
+    CalcImageRelease release = free_file;
+
+#if !defined(_WIN32) && !defined(CALC_NO_MMAP)
+    data = map_file(path, &size);
+    if (data != NULL) release = unmap_file;
+#endif
+    if (data == NULL) data = read_file(path, &size);
+    if (data == NULL) {
+        if (errno == ENOENT) return 0; // A new session
+        fprintf(stderr, "Error: Cannot read session '%s'.\n", path);
+        return 1;
+    }
+    status = calc_snapshot_adopt(data, size, release, ctx, sheet);
+    if (status != CALC_OK) {
+        release(data, size);
+        fprintf(stderr, "Error: Session '%s': %s.\n", path, calc_status_message(status));
+        return 1;
+    }
+    return 0;
+}
+
+// Writes size bytes to the new file at path and flushes them to the disk
+static int write_durably(const char* path, const void* data, size_t size) {
+    FILE* out = fopen(path, "wb");
+    int ok;
+
+    if (out == NULL) return 0;
+    ok = fwrite(data, 1, size, out) == size && fflush(out) == 0;
+#if defined(_WIN32)
+    ok = ok && _commit(_fileno(out)) == 0;
+#else
+    ok = ok && fsync(fileno(out)) == 0;
+#endif
+    return fclose(out) == 0 && ok;
+}
+
+// Replaces target by source, and on POSIX makes the rename itself durable
+static int replace_file(const char* source, const char* target) {
+#if defined(_WIN32)
+    return MoveFileExA(source, target, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    const char* slash = strrchr(target, '/');
+    char* dir;
+    int fd;
+
+    if (rename(source, target) != 0) return 0;
+    if (slash == NULL) {
+        fd = open(".", O_RDONLY);
+    }
+    else {
+        size_t len = slash == target ? 1 : (size_t)(slash - target);
+        dir = (char*)malloc(len + 1);
+        if (dir == NULL) return 1; // Renamed; only its durability is not ensured
+        memcpy(dir, target, len);
+        dir[len] = '\0';
+        fd = open(dir, O_RDONLY);
+        free(dir);
+    }
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return 1;
+#endif
+}
+
+int session_save(const char* path, const CalcContext* ctx, const CalcSheet* sheet) {
+    size_t size = calc_snapshot_size(ctx, sheet);
+    size_t len = strlen(path);
+    void* data = malloc(size);
+    char* temp = (char*)malloc(len + 32);
+    int ok = 0;
+
+    if (data != NULL && temp != NULL) {
+        calc_snapshot_write(ctx, sheet, data);
+#if defined(_WIN32)
+        snprintf(temp, len + 32, "%s.tmp.%d", path, _getpid());
+#else
+        snprintf(temp, len + 32, "%s.tmp.%ld", path, (long)getpid());
+#endif
+        ok = write_durably(temp, data, size) && replace_file(temp, path);
+        if (!ok) remove(temp);
+    }
+    if (!ok) fprintf(stderr, "Error: Cannot save session '%s'.\n", path);
+    free(data);
+    free(temp);
+    return ok ? 0 : 1;
+}
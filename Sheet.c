@@ -0,0 +1,687 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Sheet.h"
+#include <ctype.h>
+#include <stdint.h>
+#include <limits.h>
+
+/*
+ * Formulas stay with the interpreter: a sheet has many small ones, each evaluated once per
+ * recomputation, and native code for each of them (a page apiece) costs more in instruction
+ * cache and TLB misses than it saves.
+ *
+ * A restored image (see calc_sheet_image_read()) keeps the names, formula texts and dependency
+ * lists of its cells in two pooled blocks, and compiles a formula only when its cell is recomputed.
+ * An adopted image (calc_sheet_image_adopt()) is those pools itself: the strings, and where long
+ * is 64 bits the links and the name index, are used where they lie in the image. Edits only ever
+ * detach the cell they change from the pools, which are released with the sheet.
+ */
+
+// Links and name index entries are int64_t in an image, and used in place where long is the same
+#if LONG_MAX == INT64_MAX
+#define SHEET_IMAGE_LONGS 1
+#endif
+
+// Offset of "no formula" in a SheetImageCell
+#define SHEET_IMAGE_NONE UINT64_MAX
+
+typedef enum {
+    CELL_UNDEFINED, // Read by a formula but never defined
+    CELL_DIRTY,     // Its value is out of date
+    CELL_CLEAN
+} CellState;
+
+// Storage of a cell that points into the pools of a restored image
+#define CELL_POOLED_NAME 1
+#define CELL_POOLED_SOURCE 2
+#define CELL_POOLED_USERS 4
+
+// Parts of a sheet that lie in an adopted image rather than in blocks of their own
+#define IMAGE_STRINGS 1
+#define IMAGE_LINKS 2
+#define IMAGE_TABLE 4
+
+typedef struct {
+    char* name;
+    char* source;            // Text of the formula, NULL for undefined and constant cells
+    CompiledExpr* formula;   // NULL until compiled (a restored formula is compiled on first use)
+    double r, p;             // R and P when the formula was defined
+    const long* deps;        // Cells the formula reads (owned by the formula, or pooled)
+    size_t dep_count;
+    long* users;             // Cells whose formula reads this one
+    size_t user_count, user_capacity;
+    CalcStatus status;       // Outcome of the last computation
+    unsigned char state;     // CellState
+    unsigned char pooled;    // CELL_POOLED_*
+    unsigned visit;          // Mark of the last graph search that reached the cell
+} SheetCell;
+
+// A cell on the stack of a depth-first walk, with the next of its dependencies to visit
+typedef struct {
+    long cell;
+    size_t next;
+} SheetFrame;
+
+struct CalcSheet {
+    SheetCell* cells;
+    size_t count, capacity;
+    double* values;          // Values by cell (NAN unless computed successfully), read by the formulas
+    long* table;             // Open-addressing name index: cell + 1, 0 for a free slot
+    size_t table_size;       // Power of two, at least twice the number of cells
+    SheetFrame* stack;
+    size_t stack_capacity;
+    unsigned visit;
+    unsigned long long recomputations;
+    char* pooled_strings;    // Names and formula texts of a restored image
+    long* pooled_links;      // Dependencies and users of a restored image
+    void* image;             // Block of an adopted image, released with the sheet
+    size_t image_size;
+    CalcImageRelease release_image;
+    unsigned char in_image;  // IMAGE_*
+};
+
+// Layout of an image: the header, the cells, the name index (table_size entries), the links
+// (the dependencies then the users of every cell) and the '\0'-terminated strings, padded to 8 bytes
+typedef struct {
+    uint64_t cell_count, table_size, link_count, string_bytes;
+} SheetImageHeader;
+
+typedef struct {
+    uint64_t name, source;         // Offsets in the strings (source SHEET_IMAGE_NONE for none)
+    uint64_t deps, users;          // Offsets in the links
+    uint64_t dep_count, user_count;
+    double r, p, value;
+    uint32_t status, state;
+} SheetImageCell;
+
+static unsigned long hash_name(const char* name, size_t len) {
+    unsigned long hash = 2166136261UL; // FNV-1a
+    for (size_t i = 0; i < len; i++) hash = (hash ^ (unsigned char)name[i]) * 16777619UL;
+    return hash;
+}
+
+static long find_cell(const CalcSheet* sheet, const char* name, size_t len) {
+    if (sheet->table_size == 0) return -1;
+    for (size_t slot = hash_name(name, len) & (sheet->table_size - 1);; slot = (slot + 1) & (sheet->table_size - 1)) {
+        long cell = sheet->table[slot] - 1;
+        if (cell < 0) return -1;
+        if (strncmp(sheet->cells[cell].name, name, len) == 0 && sheet->cells[cell].name[len] == '\0') return cell;
+    }
+}
+
+static void index_cell(CalcSheet* sheet, long cell) {
+    const char* name = sheet->cells[cell].name;
+    size_t slot = hash_name(name, strlen(name)) & (sheet->table_size - 1);
+    while (sheet->table[slot] != 0) slot = (slot + 1) & (sheet->table_size - 1);
+    sheet->table[slot] = cell + 1;
+}
+
+/**
+ * @brief Returns the cell of a valid name, adding an undefined cell if there is none; -1 if
+ * memory ran out.
+ */
+static long find_or_add_cell(CalcSheet* sheet, const char* name, size_t len) {
+    long cell = find_cell(sheet, name, len);
+    SheetCell* added;
+
+    if (cell >= 0) return cell;
+    if (sheet->count == sheet->capacity) {
+        size_t capacity = sheet->capacity ? sheet->capacity * 2 : 64;
+        SheetCell* cells = (SheetCell*)realloc(sheet->cells, capacity * sizeof(SheetCell));
+        double* values;
+        if (cells == NULL) return -1;
+        sheet->cells = cells;
+        values = (double*)realloc(sheet->values, capacity * sizeof(double));
+        if (values == NULL) return -1;
+        sheet->values = values;
+        sheet->capacity = capacity;
+    }
+    if (2 * (sheet->count + 1) > sheet->table_size) {
+        size_t size = sheet->table_size ? sheet->table_size * 2 : 128;
+        long* table = (long*)calloc(size, sizeof(long));
+        if (table == NULL) return -1;
+        if (!(sheet->in_image & IMAGE_TABLE)) free(sheet->table);
+        sheet->in_image &= (unsigned char)~IMAGE_TABLE;
+        sheet->table = table;
+        sheet->table_size = size;
+        for (size_t i = 0; i < sheet->count; i++) index_cell(sheet, (long)i);
+    }
+
+    added = &sheet->cells[sheet->count];
+    memset(added, 0, sizeof(*added));
+    added->name = (char*)malloc(len + 1);
+    if (added->name == NULL) return -1;
+    memcpy(added->name, name, len);
+    added->name[len] = '\0';
+    added->state = CELL_UNDEFINED;
+    added->status = CALC_ERR_UNDEFINED;
+    sheet->values[sheet->count] = NAN;
+    cell = (long)sheet->count++;
+    index_cell(sheet, cell);
+    return cell;
+}
+
+static int push_frame(CalcSheet* sheet, size_t* depth, long cell) {
+    if (*depth == sheet->stack_capacity) {
+        size_t capacity = sheet->stack_capacity ? sheet->stack_capacity * 2 : 64;
+        SheetFrame* stack = (SheetFrame*)realloc(sheet->stack, capacity * sizeof(SheetFrame));
+        if (stack == NULL) return 0;
+        sheet->stack = stack;
+        sheet->stack_capacity = capacity;
+    }
+    sheet->stack[*depth].cell = cell;
+    sheet->stack[(*depth)++].next = 0;
+    return 1;
+}
+
+/**
+ * @brief Marks every cell downstream of cell out of date. A cell that already is has all of its
+ * own downstream cells out of date too, so the walk stops there.
+ */
+static int invalidate_users(CalcSheet* sheet, long cell) {
+    size_t depth = 0;
+    if (!push_frame(sheet, &depth, cell)) return 0;
+    while (depth > 0) {
+        const SheetCell* current = &sheet->cells[sheet->stack[--depth].cell];
+        for (size_t i = 0; i < current->user_count; i++) {
+            SheetCell* user = &sheet->cells[current->users[i]];
+            if (user->state == CELL_DIRTY) continue;
+            user->state = CELL_DIRTY;
+            if (!push_frame(sheet, &depth, current->users[i])) return 0;
+        }
+    }
+    return 1;
+}
+
+static void compute_cell(CalcSheet* sheet, long index) {
+    SheetCell* cell = &sheet->cells[index];
+    double value = NAN;
+
+    if (cell->formula == NULL) {
+        // Restored: the names it reads are cells already, so the dependencies stay the same
+        CompiledExpr* formula = expr_compile_vars(cell->source, calc_sheet_resolve, sheet, NULL);
+        if (formula == NULL) {
+            cell->status = CALC_ERR_NO_MEMORY;
+            sheet->values[index] = NAN;
+            cell->state = CELL_CLEAN;
+            return;
+        }
+        cell = &sheet->cells[index];
+        cell->formula = formula;
+        cell->dep_count = expr_variables(formula, &cell->deps);
+    }
+    cell->status = CALC_OK;
+    for (size_t i = 0; i < cell->dep_count; i++) {
+        if (sheet->cells[cell->deps[i]].status != CALC_OK) cell->status = CALC_ERR_UNDEFINED;
+    }
+    if (cell->status == CALC_OK) {
+        value = expr_eval_vars(cell->formula, cell->r, cell->p, sheet->values);
+        if (isnan(value)) cell->status = CALC_ERR_EVALUATION;
+        sheet->recomputations++;
+    }
+    sheet->values[index] = value;
+    cell->state = CELL_CLEAN;
+}
+
+/**
+ * @brief Brings a cell up to date: a depth-first walk over its out-of-date dependencies that
+ * computes every cell after all the cells it reads (post-order, i.e. topological order).
+ */
+static int update_cell(CalcSheet* sheet, long cell) {
+    size_t depth = 0;
+    if (sheet->cells[cell].state != CELL_DIRTY) return 1;
+    if (!push_frame(sheet, &depth, cell)) return 0;
+    while (depth > 0) {
+        SheetFrame* frame = &sheet->stack[depth - 1];
+        const SheetCell* current = &sheet->cells[frame->cell];
+        if (frame->next < current->dep_count) {
+            long dep = current->deps[frame->next++];
+            if (sheet->cells[dep].state == CELL_DIRTY && !push_frame(sheet, &depth, dep)) return 0;
+            continue;
+        }
+        compute_cell(sheet, frame->cell);
+        depth--;
+    }
+    return 1;
+}
+
+/**
+ * @brief Returns 1 if a formula of cell reading deps would make cell depend on itself, i.e. if one
+ * of deps is cell or downstream of it. The walk follows the users of cell rather than the
+ * dependencies of deps: a new or leaf cell has no users, so extending a model costs nothing here.
+ */
+static int closes_cycle(CalcSheet* sheet, long cell, const long* deps, size_t count, int* no_memory) {
+    size_t depth = 0;
+    unsigned dep_mark, seen;
+
+    for (size_t i = 0; i < count; i++) {
+        if (deps[i] == cell) return 1;
+    }
+    if (count == 0 || sheet->cells[cell].user_count == 0) return 0;
+    dep_mark = ++sheet->visit;
+    seen = ++sheet->visit;
+    for (size_t i = 0; i < count; i++) sheet->cells[deps[i]].visit = dep_mark;
+    sheet->cells[cell].visit = seen;
+    if (!push_frame(sheet, &depth, cell)) { *no_memory = 1; return 0; }
+    while (depth > 0) {
+        const SheetCell* current = &sheet->cells[sheet->stack[--depth].cell];
+        for (size_t i = 0; i < current->user_count; i++) {
+            SheetCell* user = &sheet->cells[current->users[i]];
+            if (user->visit == dep_mark) return 1;
+            if (user->visit == seen) continue;
+            user->visit = seen;
+            if (!push_frame(sheet, &depth, current->users[i])) { *no_memory = 1; return 0; }
+        }
+    }
+    return 0;
+}
+
+static void unlink_deps(CalcSheet* sheet, long index) {
+    SheetCell* cell = &sheet->cells[index];
+    for (size_t i = 0; i < cell->dep_count; i++) {
+        SheetCell* dep = &sheet->cells[cell->deps[i]];
+        for (size_t j = 0; j < dep->user_count; j++) {
+            if (dep->users[j] == index) {
+                dep->users[j] = dep->users[--dep->user_count];
+                break;
+            }
+        }
+    }
+    expr_free(cell->formula);
+    if (!(cell->pooled & CELL_POOLED_SOURCE)) free(cell->source);
+    cell->pooled &= (unsigned char)~CELL_POOLED_SOURCE;
+    cell->formula = NULL;
+    cell->source = NULL;
+    cell->deps = NULL;
+    cell->dep_count = 0;
+}
+
+static int link_deps(CalcSheet* sheet, long index) {
+    const SheetCell* cell = &sheet->cells[index];
+    for (size_t i = 0; i < cell->dep_count; i++) {
+        SheetCell* dep = &sheet->cells[cell->deps[i]];
+        if (dep->pooled & CELL_POOLED_USERS) {
+            // Pooled users move to an array of their own before growing
+            size_t capacity = dep->user_count * 2 + 4;
+            long* users = (long*)malloc(capacity * sizeof(long));
+            if (users == NULL) return 0;
+            if (dep->user_count > 0) memcpy(users, dep->users, dep->user_count * sizeof(long));
+            dep->users = users;
+            dep->user_capacity = capacity;
+            dep->pooled &= (unsigned char)~CELL_POOLED_USERS;
+        }
+        if (dep->user_count == dep->user_capacity) {
+            size_t capacity = dep->user_capacity ? dep->user_capacity * 2 : 4;
+            long* users = (long*)realloc(dep->users, capacity * sizeof(long));
+            if (users == NULL) return 0;
+            dep->users = users;
+            dep->user_capacity = capacity;
+        }
+        dep->users[dep->user_count++] = index;
+    }
+    return 1;
+}
+
+CalcSheet* calc_sheet_create(void) {
+    return (CalcSheet*)calloc(1, sizeof(CalcSheet));
+}
+
+// Frees everything the sheet points to
+static void release_cells(CalcSheet* sheet) {
+    for (size_t i = 0; i < sheet->count; i++) {
+        const SheetCell* cell = &sheet->cells[i];
+        if (!(cell->pooled & CELL_POOLED_NAME)) free(cell->name);
+        if (!(cell->pooled & CELL_POOLED_SOURCE)) free(cell->source);
+        if (!(cell->pooled & CELL_POOLED_USERS)) free(cell->users);
+        expr_free(cell->formula);
+    }
+    if (!(sheet->in_image & IMAGE_STRINGS)) free(sheet->pooled_strings);
+    if (!(sheet->in_image & IMAGE_LINKS)) free(sheet->pooled_links);
+    if (!(sheet->in_image & IMAGE_TABLE)) free(sheet->table);
+    if (sheet->release_image != NULL) sheet->release_image(sheet->image, sheet->image_size);
+    free(sheet->cells);
+    free(sheet->values);
+    free(sheet->stack);
+}
+
+void calc_sheet_free(CalcSheet* sheet) {
+    if (sheet == NULL) return;
+    release_cells(sheet);
+    free(sheet);
+}
+
+int calc_sheet_valid_name(const char* name, size_t len) {
+    if (len == 0 || !(isalpha((unsigned char)name[0]) || name[0] == '_')) return 0;
+    for (size_t i = 1; i < len; i++) {
+        if (!(isalnum((unsigned char)name[i]) || name[i] == '_')) return 0;
+    }
+    if (len == 1 && strchr("RrPp", name[0]) != NULL) return 0;
+    return !expr_is_function(name, len);
+}
+
+long calc_sheet_resolve(void* context, const char* name, size_t len) {
+    CalcSheet* sheet = (CalcSheet*)context;
+    if (!calc_sheet_valid_name(name, len)) return -1;
+    return find_or_add_cell(sheet, name, len);
+}
+
+CalcStatus calc_sheet_define(CalcSheet* sheet, const char* name, size_t len, const char* formula, double r, double p,
+    ExprError* error) {
+    ExprError compile_error;
+    CompiledExpr* expr;
+    const long* deps;
+    size_t dep_count, source_len = strlen(formula);
+    long cell;
+    int no_memory = 0;
+    char* source;
+
+    if (error == NULL) error = &compile_error;
+    if (!calc_sheet_valid_name(name, len)) {
+        error->message = "Invalid variable name";
+        error->position = 0;
+        return CALC_ERR_SYNTAX;
+    }
+    cell = find_or_add_cell(sheet, name, len);
+    if (cell < 0) return CALC_ERR_NO_MEMORY;
+    expr = expr_compile_vars(formula, calc_sheet_resolve, sheet, error);
+    if (expr == NULL) return strcmp(error->message, "Out of memory") == 0 ? CALC_ERR_NO_MEMORY : CALC_ERR_SYNTAX;
+
+    dep_count = expr_variables(expr, &deps);
+    if (closes_cycle(sheet, cell, deps, dep_count, &no_memory) || no_memory) {
+        expr_free(expr);
+        return no_memory ? CALC_ERR_NO_MEMORY : CALC_ERR_CIRCULAR;
+    }
+    source = (char*)malloc(source_len + 1);
+    if (source == NULL) {
+        expr_free(expr);
+        return CALC_ERR_NO_MEMORY;
+    }
+    memcpy(source, formula, source_len + 1);
+
+    unlink_deps(sheet, cell);
+    sheet->cells[cell].source = source;
+    sheet->cells[cell].formula = expr;
+    sheet->cells[cell].deps = deps;
+    sheet->cells[cell].dep_count = dep_count;
+    sheet->cells[cell].r = r;
+    sheet->cells[cell].p = p;
+    sheet->cells[cell].state = CELL_DIRTY;
+    sheet->values[cell] = NAN;
+    if (!link_deps(sheet, cell)) {
+        unlink_deps(sheet, cell);
+        sheet->cells[cell].state = CELL_UNDEFINED;
+        sheet->cells[cell].status = CALC_ERR_UNDEFINED;
+        invalidate_users(sheet, cell);
+        return CALC_ERR_NO_MEMORY;
+    }
+    return invalidate_users(sheet, cell) ? CALC_OK : CALC_ERR_NO_MEMORY;
+}
+
+CalcStatus calc_sheet_set(CalcSheet* sheet, const char* name, size_t len, double value) {
+    SheetCell* cell;
+    long index;
+
+    if (!calc_sheet_valid_name(name, len)) return CALC_ERR_SYNTAX;
+    index = find_or_add_cell(sheet, name, len);
+    if (index < 0) return CALC_ERR_NO_MEMORY;
+    cell = &sheet->cells[index];
+    if (cell->source == NULL && cell->state == CELL_CLEAN && memcmp(&sheet->values[index], &value, sizeof(double)) == 0) {
+        return CALC_OK;
+    }
+    unlink_deps(sheet, index);
+    cell->state = CELL_CLEAN;
+    cell->status = isnan(value) ? CALC_ERR_EVALUATION : CALC_OK;
+    sheet->values[index] = value;
+    return invalidate_users(sheet, index) ? CALC_OK : CALC_ERR_NO_MEMORY;
+}
+
+CalcStatus calc_sheet_value(CalcSheet* sheet, const char* name, size_t len, double* value) {
+    long cell = find_cell(sheet, name, len);
+    *value = NAN;
+    if (cell < 0) return CALC_ERR_UNDEFINED;
+    if (!update_cell(sheet, cell)) return CALC_ERR_NO_MEMORY;
+    *value = sheet->values[cell];
+    return sheet->cells[cell].status;
+}
+
+CalcStatus calc_sheet_eval(CalcSheet* sheet, const CompiledExpr* expr, CalcPrecision precision, double r, double p,
+    double* result) {
+    const long* vars;
+    size_t count = expr_variables(expr, &vars);
+
+    *result = NAN;
+    for (size_t i = 0; i < count; i++) {
+        if (!update_cell(sheet, vars[i])) return CALC_ERR_NO_MEMORY;
+        if (sheet->cells[vars[i]].status != CALC_OK) return CALC_ERR_UNDEFINED;
+    }
+    *result = expr_eval_prec(expr, precision, r, p, sheet->values);
+    return isnan(*result) ? CALC_ERR_EVALUATION : CALC_OK;
+}
+
+size_t calc_sheet_cell_count(const CalcSheet* sheet) {
+    return sheet->count;
+}
+
+unsigned long long calc_sheet_recomputations(const CalcSheet* sheet) {
+    return sheet->recomputations;
+}
+
+// --- Images ---
+
+static size_t pad8(size_t n) {
+    return (n + 7) & ~(size_t)7;
+}
+
+size_t calc_sheet_image_size(const CalcSheet* sheet) {
+    size_t links = 0, strings = 0;
+    for (size_t i = 0; i < sheet->count; i++) {
+        const SheetCell* cell = &sheet->cells[i];
+        links += cell->dep_count + cell->user_count;
+        strings += strlen(cell->name) + 1 + (cell->source != NULL ? strlen(cell->source) + 1 : 0);
+    }
+    return sizeof(SheetImageHeader) + sheet->count * sizeof(SheetImageCell) + (sheet->table_size + links) * sizeof(int64_t)
+        + pad8(strings);
+}
+
+void calc_sheet_image_write(const CalcSheet* sheet, void* buffer) {
+    SheetImageHeader header;
+    unsigned char* out = (unsigned char*)buffer;
+    unsigned char* cells = out + sizeof(header);
+    unsigned char* table = cells + sheet->count * sizeof(SheetImageCell);
+    unsigned char* links = table + sheet->table_size * sizeof(int64_t);
+    unsigned char* strings;
+    uint64_t link = 0, string = 0;
+
+    header.cell_count = sheet->count;
+    header.table_size = sheet->table_size;
+    header.link_count = 0;
+    for (size_t i = 0; i < sheet->count; i++) header.link_count += sheet->cells[i].dep_count + sheet->cells[i].user_count;
+    strings = links + header.link_count * sizeof(int64_t);
+
+    for (size_t i = 0; i < sheet->table_size; i++) {
+        int64_t slot = sheet->table[i];
+        memcpy(table + i * sizeof(int64_t), &slot, sizeof(slot));
+    }
+    for (size_t i = 0; i < sheet->count; i++) {
+        const SheetCell* cell = &sheet->cells[i];
+        SheetImageCell image;
+        size_t len = strlen(cell->name) + 1;
+
+        memset(&image, 0, sizeof(image));
+        image.name = string;
+        memcpy(strings + string, cell->name, len);
+        string += len;
+        image.source = SHEET_IMAGE_NONE;
+        if (cell->source != NULL) {
+            len = strlen(cell->source) + 1;
+            image.source = string;
+            memcpy(strings + string, cell->source, len);
+            string += len;
+        }
+        image.deps = link;
+        image.dep_count = cell->dep_count;
+        for (size_t j = 0; j < cell->dep_count; j++, link++) {
+            int64_t dep = cell->deps[j];
+            memcpy(links + link * sizeof(int64_t), &dep, sizeof(dep));
+        }
+        image.users = link;
+        image.user_count = cell->user_count;
+        for (size_t j = 0; j < cell->user_count; j++, link++) {
+            int64_t user = cell->users[j];
+            memcpy(links + link * sizeof(int64_t), &user, sizeof(user));
+        }
+        image.r = cell->r;
+        image.p = cell->p;
+        image.value = sheet->values[i];
+        image.status = (uint32_t)cell->status;
+        image.state = cell->state;
+        memcpy(cells + i * sizeof(image), &image, sizeof(image));
+    }
+    memset(strings + string, 0, pad8((size_t)string) - (size_t)string);
+    header.string_bytes = pad8((size_t)string);
+    memcpy(out, &header, sizeof(header));
+}
+
+// Checks that count links from offset are within the image and name cells
+static int image_links_valid(const unsigned char* links, const SheetImageHeader* header, uint64_t offset, uint64_t count) {
+    if (offset > header->link_count || count > header->link_count - offset) return 0;
+    for (uint64_t i = offset; i < offset + count; i++) {
+        int64_t cell;
+        memcpy(&cell, links + i * sizeof(int64_t), sizeof(cell));
+        if (cell < 0 || (uint64_t)cell >= header->cell_count) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Fills the empty sheet from an image, copied into pools of its own or, in_place, used
+ * where it lies (the image is then writable). Every offset and index is checked against the image,
+ * so a malformed image cannot make the sheet read out of bounds; whether the names, formulas and
+ * links agree with each other is left to the checksum of the snapshot.
+ */
+static CalcStatus read_image(CalcSheet* sheet, const unsigned char* in, size_t size, int in_place) {
+    SheetImageHeader header;
+    const unsigned char *cells, *table, *links, *strings;
+    size_t count, indexed = 0;
+
+    if (size < sizeof(header)) return CALC_ERR_SNAPSHOT;
+    memcpy(&header, in, sizeof(header));
+    // Every part must fit in the image, and the name index needs empty slots
+    size -= sizeof(header);
+    if (header.cell_count > size / sizeof(SheetImageCell)) return CALC_ERR_SNAPSHOT;
+    size -= (size_t)header.cell_count * sizeof(SheetImageCell);
+    if (header.table_size > size / sizeof(int64_t)) return CALC_ERR_SNAPSHOT;
+    size -= (size_t)header.table_size * sizeof(int64_t);
+    if (header.link_count > size / sizeof(int64_t)) return CALC_ERR_SNAPSHOT;
+    size -= (size_t)header.link_count * sizeof(int64_t);
+    if (header.string_bytes != size || (header.table_size & (header.table_size - 1)) != 0
+        || header.cell_count * 2 > header.table_size) {
+        return CALC_ERR_SNAPSHOT;
+    }
+    count = (size_t)header.cell_count;
+    cells = in + sizeof(header);
+    table = cells + count * sizeof(SheetImageCell);
+    links = table + (size_t)header.table_size * sizeof(int64_t);
+    strings = links + (size_t)header.link_count * sizeof(int64_t);
+    if (count == 0) return CALC_OK;
+    if (size == 0 || strings[size - 1] != '\0') return CALC_ERR_SNAPSHOT;
+
+    // The parts used in place are not allocated (the image sections are 8-byte aligned)
+    if (in_place) {
+        sheet->pooled_strings = (char*)strings;
+        sheet->in_image = IMAGE_STRINGS;
+#ifdef SHEET_IMAGE_LONGS
+        sheet->pooled_links = (long*)links;
+        sheet->table = (long*)table;
+        sheet->in_image |= IMAGE_LINKS | IMAGE_TABLE;
+#endif
+    }
+    sheet->cells = (SheetCell*)calloc(count, sizeof(SheetCell));
+    sheet->values = (double*)malloc(count * sizeof(double));
+    if (!(sheet->in_image & IMAGE_TABLE)) sheet->table = (long*)calloc((size_t)header.table_size, sizeof(long));
+    if (!(sheet->in_image & IMAGE_STRINGS)) sheet->pooled_strings = (char*)malloc(size);
+    if (!(sheet->in_image & IMAGE_LINKS)) {
+        sheet->pooled_links = (long*)malloc((header.link_count > 0 ? (size_t)header.link_count : 1) * sizeof(long));
+    }
+    if (sheet->cells == NULL || sheet->values == NULL || sheet->table == NULL || sheet->pooled_strings == NULL
+        || sheet->pooled_links == NULL) {
+        return CALC_ERR_NO_MEMORY;
+    }
+    sheet->capacity = count;
+    sheet->table_size = (size_t)header.table_size;
+    if (!(sheet->in_image & IMAGE_STRINGS)) memcpy(sheet->pooled_strings, strings, size);
+    for (size_t i = 0; !(sheet->in_image & IMAGE_LINKS) && i < (size_t)header.link_count; i++) {
+        int64_t link;
+        memcpy(&link, links + i * sizeof(int64_t), sizeof(link));
+        sheet->pooled_links[i] = (long)link;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        SheetCell* cell = &sheet->cells[i];
+        SheetImageCell image;
+        int formula;
+
+        memcpy(&image, cells + i * sizeof(image), sizeof(image));
+        formula = image.source != SHEET_IMAGE_NONE;
+        // Undefined and constant cells have no formula, and only formulas can be out of date
+        if (image.name >= header.string_bytes || (formula && image.source >= header.string_bytes)
+            || image.state > CELL_CLEAN || image.status >= CALC_STATUS_COUNT
+            || (formula ? image.state == CELL_UNDEFINED : image.state == CELL_DIRTY || image.dep_count != 0)
+            || !image_links_valid(links, &header, image.deps, image.dep_count)
+            || !image_links_valid(links, &header, image.users, image.user_count)) {
+            return CALC_ERR_SNAPSHOT;
+        }
+        cell->name = sheet->pooled_strings + image.name;
+        cell->source = formula ? sheet->pooled_strings + image.source : NULL;
+        cell->pooled = CELL_POOLED_NAME | CELL_POOLED_SOURCE | CELL_POOLED_USERS;
+        cell->deps = sheet->pooled_links + image.deps;
+        cell->dep_count = (size_t)image.dep_count;
+        cell->users = sheet->pooled_links + image.users;
+        cell->user_count = cell->user_capacity = (size_t)image.user_count;
+        cell->r = image.r;
+        cell->p = image.p;
+        cell->status = (CalcStatus)image.status;
+        cell->state = (unsigned char)image.state;
+        sheet->values[i] = image.value;
+        sheet->count = i + 1;
+    }
+
+    // As many used slots as cells, so that the empty slots that end the searches remain
+    for (size_t i = 0; i < sheet->table_size; i++) {
+        int64_t slot;
+        memcpy(&slot, table + i * sizeof(int64_t), sizeof(slot));
+        if (slot < 0 || (uint64_t)slot > header.cell_count) return CALC_ERR_SNAPSHOT;
+        if (!(sheet->in_image & IMAGE_TABLE)) sheet->table[i] = (long)slot;
+        indexed += slot != 0;
+    }
+    return indexed == count ? CALC_OK : CALC_ERR_SNAPSHOT;
+}
+
+CalcStatus calc_sheet_image_read(CalcSheet* sheet, const void* data, size_t size) {
+    CalcStatus status;
+
+    if (sheet->count != 0) return CALC_ERR_SNAPSHOT;
+    status = read_image(sheet, (const unsigned char*)data, size, 0);
+    if (status != CALC_OK) {
+        release_cells(sheet);
+        memset(sheet, 0, sizeof(*sheet));
+    }
+    return status;
+}
+
+CalcStatus calc_sheet_image_adopt(CalcSheet* sheet, void* data, size_t size, void* block, size_t block_size,
+    CalcImageRelease release) {
+    CalcStatus status;
+
+    if (sheet->count != 0) return CALC_ERR_SNAPSHOT;
+    status = read_image(sheet, (const unsigned char*)data, size, 1);
+    if (status != CALC_OK) {
+        release_cells(sheet); // The block stays with the caller
+        memset(sheet, 0, sizeof(*sheet));
+        return status;
+    }
+    sheet->image = block;
+    sheet->image_size = block_size;
+    sheet->release_image = release;
+    return CALC_OK;
+}
@@ -0,0 +1,122 @@
+#ifndef SHEET_H
+#define SHEET_H
+
+#include <stddef.h>
+#include "CalcCore.h"
+
+/*
+ * Named variables: cells holding a formula, an expression that may read other cells such as
+ * "area = hypot(a, b) * sin(theta)", kept consistent through their dependency graph.
+ *
+ * Every cell knows the cells its formula reads and, in reverse, the cells that read it.
+ * Changing a cell only marks the cells downstream of it out of date, stopping at cells that
+ * already are (so an edit costs at most the cells it affects). Values are recomputed lazily
+ * when read: only the out-of-date cells the requested value depends on, in topological order.
+ * A definition that would make a cell depend on itself is rejected. A name read before it is
+ * defined creates an undefined cell; whatever depends on it fails with CALC_ERR_UNDEFINED until
+ * it is defined. R and P in a formula take their values at the time of the definition.
+ *
+ * A sheet never prints and belongs to one session (it is not thread-safe).
+ *
+ * A sheet can be saved as an image: its cells, values, dependency graph and name index laid out
+ * flat with fixed-size fields, so that restoring it is a few copies rather than a parse. The
+ * formulas are kept as text and compiled when their cells are next recomputed.
+ */
+
+typedef struct CalcSheet CalcSheet;
+
+/**
+ * @brief Creates an empty sheet (release it with calc_sheet_free()); NULL if memory ran out.
+ */
+CalcSheet* calc_sheet_create(void);
+void calc_sheet_free(CalcSheet* sheet);
+
+/**
+ * @brief Returns 1 if name (len characters) can name a cell: letters, digits and '_', not
+ * starting with a digit, and neither R, P nor the name of an expression function.
+ */
+int calc_sheet_valid_name(const char* name, size_t len);
+
+/**
+ * @brief Defines or redefines the cell name (len characters) with a formula.
+ * @param r Value of R in the formula.
+ * @param p Value of P in the formula.
+ * @param error Receives the message and position for CALC_ERR_SYNTAX (may be NULL).
+ * @return CALC_OK, CALC_ERR_SYNTAX (invalid name or formula), CALC_ERR_CIRCULAR (the cell would
+ * depend on itself; its previous definition stays) or CALC_ERR_NO_MEMORY.
+ */
+CalcStatus calc_sheet_define(CalcSheet* sheet, const char* name, size_t len, const char* formula, double r, double p,
+    ExprError* error);
+
+/**
+ * @brief Makes the cell name an input with a constant value. Setting the value it already has
+ * leaves the cells downstream up to date.
+ * @return CALC_OK, CALC_ERR_SYNTAX (invalid name) or CALC_ERR_NO_MEMORY.
+ */
+CalcStatus calc_sheet_set(CalcSheet* sheet, const char* name, size_t len, double value);
+
+/**
+ * @brief Gets the value of a cell, first recomputing the out-of-date cells it depends on.
+ * @return CALC_OK, CALC_ERR_UNDEFINED (no such cell, or it reads an undefined or failing cell)
+ * or CALC_ERR_EVALUATION (its formula fails).
+ */
+CalcStatus calc_sheet_value(CalcSheet* sheet, const char* name, size_t len, double* value);
+
+/**
+ * @brief Resolver for expr_compile_vars() over the cells of the sheet passed as context.
+ * A valid name that is not a cell yet creates an undefined cell.
+ */
+long calc_sheet_resolve(void* sheet, const char* name, size_t len);
+
+/**
+ * @brief Evaluates an expression compiled with calc_sheet_resolve() for this sheet at a precision
+ * (see expr_eval_prec()), first bringing the cells it reads up to date. The cells themselves are
+ * computed in double.
+ * @return CALC_OK, CALC_ERR_UNDEFINED or CALC_ERR_EVALUATION.
+ */
+CalcStatus calc_sheet_eval(CalcSheet* sheet, const CompiledExpr* expr, CalcPrecision precision, double r, double p,
+    double* result);
+
+/**
+ * @brief Returns the number of cells, undefined ones included.
+ */
+size_t calc_sheet_cell_count(const CalcSheet* sheet);
+
+/**
+ * @brief Returns how many formulas the sheet has evaluated so far (shows that edits are incremental).
+ */
+unsigned long long calc_sheet_recomputations(const CalcSheet* sheet);
+
+/**
+ * @brief Returns the size in bytes of the image of the sheet (a multiple of 8).
+ */
+size_t calc_sheet_image_size(const CalcSheet* sheet);
+
+/**
+ * @brief Writes the image of the sheet to buffer (calc_sheet_image_size() bytes). The image is
+ * in the byte order of this machine.
+ */
+void calc_sheet_image_write(const CalcSheet* sheet, void* buffer);
+
+/**
+ * @brief Restores an image into an empty sheet; the image is not needed afterwards. Out-of-date
+ * cells stay out of date, and up-to-date ones are not recomputed.
+ * @return CALC_OK, CALC_ERR_SNAPSHOT (the sheet is not empty, or the image is malformed) or
+ * CALC_ERR_NO_MEMORY. A sheet that was empty is left empty on failure.
+ */
+CalcStatus calc_sheet_image_read(CalcSheet* sheet, const void* data, size_t size);
+
+// Releases the block of an adopted image (e.g. free() or munmap())
+typedef void (*CalcImageRelease)(void* block, size_t size);
+
+/**
+ * @brief Like calc_sheet_image_read(), but the sheet uses the image where it lies instead of
+ * copying it: the strings, and on 64-bit-long systems the links and name index. The image (data,
+ * size bytes, 8-byte aligned) lies in a block that must stay writable, which a private mapping of
+ * a file is, since edits write to the links and the index. On success the sheet owns the block
+ * and calls release(block, block_size) when it is freed; on failure the caller keeps it.
+ */
+CalcStatus calc_sheet_image_adopt(CalcSheet* sheet, void* data, size_t size, void* block, size_t block_size,
+    CalcImageRelease release);
+
+#endif // SHEET_H
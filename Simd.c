@@ -0,0 +1,69 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdlib.h>
+#include <string.h>
+#include "Simd.h"
+
+#if defined(CALC_X86_SIMD) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/**
+ * @brief Queries the CPU (and the OS register state support) for AVX2 and AVX-512.
+ */
+static CalcSimdLevel detect_simd_level(void) {
+#if defined(CALC_X86_SIMD) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+        __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512vl")) {
+        return CALC_SIMD_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return CALC_SIMD_AVX2;
+    }
+    return CALC_SIMD_SCALAR;
+#elif defined(CALC_X86_SIMD) && defined(_MSC_VER)
+    int regs[4];
+    unsigned long long xcr0;
+
+    __cpuid(regs, 1);
+    // OSXSAVE (bit 27), AVX (bit 28) and FMA (bit 12) are required for any of the kernels
+    if ((regs[2] & (1 << 27)) == 0 || (regs[2] & (1 << 28)) == 0 || (regs[2] & (1 << 12)) == 0) {
+        return CALC_SIMD_SCALAR;
+    }
+    xcr0 = _xgetbv(0);
+    if ((xcr0 & 0x6) != 0x6) return CALC_SIMD_SCALAR; // YMM state not enabled by the OS
+
+    __cpuidex(regs, 7, 0);
+    if ((xcr0 & 0xE6) == 0xE6 &&
+        (regs[1] & (1 << 16)) && (regs[1] & (1 << 17)) && (regs[1] & (1 << 30)) && (regs[1] & (1u << 31))) {
+        return CALC_SIMD_AVX512; // F, DQ, BW, VL with ZMM/opmask state enabled
+    }
+    if (regs[1] & (1 << 5)) return CALC_SIMD_AVX2;
+    return CALC_SIMD_SCALAR;
+#else
+    return CALC_SIMD_SCALAR;
+#endif
+}
+
+CalcSimdLevel calc_simd_level(void) {
+    // Detection is idempotent, so a race between threads only repeats the work
+    static volatile int cached = -1;
+    if (cached < 0) {
+        CalcSimdLevel level = detect_simd_level();
+        const char* requested = getenv("CALC_SIMD");
+        if (requested != NULL) {
+            if (strcmp(requested, "scalar") == 0) level = CALC_SIMD_SCALAR;
+            else if (strcmp(requested, "avx2") == 0 && level > CALC_SIMD_AVX2) level = CALC_SIMD_AVX2;
+        }
+        cached = (int)level;
+    }
+    return (CalcSimdLevel)cached;
+}
+
+const char* calc_simd_level_name(CalcSimdLevel level) {
+    switch (level) {
+    case CALC_SIMD_AVX2: return "avx2";
+    case CALC_SIMD_AVX512: return "avx512";
+    default: return "scalar";
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+// x86-64 SIMD kernels are compiled in unless CALC_NO_SIMD is defined; other targets use the scalar code
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(CALC_NO_SIMD)
+#define CALC_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// Per-function target attributes: the kernels are built for AVX2/AVX-512 even when the rest of the
+// program is not, and are only called after calc_simd_level() confirmed the CPU supports them.
+#if defined(__GNUC__) || defined(__clang__)
+#define CALC_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define CALC_TARGET_AVX512 __attribute__((target("avx512f,avx512dq,avx512bw,avx512vl,avx2,fma")))
+#else
+#define CALC_TARGET_AVX2
+#define CALC_TARGET_AVX512
+#endif
+
+typedef enum {
+    CALC_SIMD_SCALAR,
+    CALC_SIMD_AVX2,   // AVX2 + FMA
+    CALC_SIMD_AVX512  // AVX-512 F/DQ/BW/VL
+} CalcSimdLevel;
+
+/**
+ * @brief Returns the best SIMD level supported by the CPU and the operating system.
+ * The environment variable CALC_SIMD=scalar|avx2|avx512 can lower (never raise) the level,
+ * which is useful to compare kernels. The result is detected once and cached.
+ */
+CalcSimdLevel calc_simd_level(void);
+
+/**
+ * @brief Returns a printable name for a SIMD level ("scalar", "avx2" or "avx512").
+ */
+const char* calc_simd_level_name(CalcSimdLevel level);
+
+#endif // SIMD_H
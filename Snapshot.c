@@ -0,0 +1,217 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Snapshot.h"
+#include <stdint.h>
+
+#define SNAPSHOT_MAGIC "CALCSNAP"
+// Reads back as another value on a machine of the other byte order
+#define SNAPSHOT_BYTE_ORDER 0x01020304u
+
+enum {
+    SECTION_CONTEXT = 1, // SnapshotContext
+    SECTION_SHEET = 2    // Image of the sheet
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t size;          // Of the whole snapshot
+    uint64_t checksum;      // XXH64 (seed 0) of the bytes after the header
+    uint32_t section_count;
+    uint32_t reserved;
+} SnapshotHeader;
+
+typedef struct {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t offset, size;  // From the start of the snapshot
+} SnapshotSection;
+
+typedef struct {
+    double last_result, prev_result;
+} SnapshotContext;
+
+
+// --- XXH64 ---
+
+#define XXH_PRIME1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME3 0x165667B19E3779F9ULL
+#define XXH_PRIME4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME5 0x27D4EB2F165667C5ULL
+
+static uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t read64(const unsigned char* p) {
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+    return x; // Native byte order, as the snapshot itself
+}
+
+static uint32_t read32(const unsigned char* p) {
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+static uint64_t xxh_round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME2;
+    return rotl64(acc, 31) * XXH_PRIME1;
+}
+
+static uint64_t xxh_merge(uint64_t acc, uint64_t lane) {
+    acc ^= xxh_round(0, lane);
+    return acc * XXH_PRIME1 + XXH_PRIME4;
+}
+
+unsigned long long calc_xxh64(const void* data, size_t len, unsigned long long seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        // Four independent lanes of 8 bytes per 32-byte stripe
+        uint64_t v1 = seed + XXH_PRIME1 + XXH_PRIME2, v2 = seed + XXH_PRIME2, v3 = seed, v4 = seed - XXH_PRIME1;
+        const unsigned char* limit = end - 32;
+        do {
+            v1 = xxh_round(v1, read64(p));
+            v2 = xxh_round(v2, read64(p + 8));
+            v3 = xxh_round(v3, read64(p + 16));
+            v4 = xxh_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh_merge(h, v1);
+        h = xxh_merge(h, v2);
+        h = xxh_merge(h, v3);
+        h = xxh_merge(h, v4);
+    }
+    else {
+        h = seed + XXH_PRIME5;
+    }
+    h += (uint64_t)len;
+
+    for (; p + 8 <= end; p += 8) h = rotl64(h ^ xxh_round(0, read64(p)), 27) * XXH_PRIME1 + XXH_PRIME4;
+    if (p + 4 <= end) {
+        h = rotl64(h ^ (uint64_t)read32(p) * XXH_PRIME1, 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) h = rotl64(h ^ *p * XXH_PRIME5, 11) * XXH_PRIME1;
+
+    h ^= h >> 33;
+    h *= XXH_PRIME2;
+    h ^= h >> 29;
+    h *= XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+
+// --- Snapshots ---
+
+static size_t section_count(const CalcSheet* sheet) {
+    return sheet != NULL ? 2 : 1;
+}
+
+size_t calc_snapshot_size(const CalcContext* ctx, const CalcSheet* sheet) {
+    (void)ctx;
+    return sizeof(SnapshotHeader) + section_count(sheet) * sizeof(SnapshotSection) + sizeof(SnapshotContext)
+        + (sheet != NULL ? calc_sheet_image_size(sheet) : 0);
+}
+
+void calc_snapshot_write(const CalcContext* ctx, const CalcSheet* sheet, void* buffer) {
+    unsigned char* out = (unsigned char*)buffer;
+    SnapshotHeader header;
+    SnapshotSection sections[2];
+    SnapshotContext context;
+    size_t count = section_count(sheet);
+
+    memset(&header, 0, sizeof(header));
+    memset(sections, 0, sizeof(sections));
+    sections[0].type = SECTION_CONTEXT;
+    sections[0].offset = sizeof(header) + count * sizeof(SnapshotSection);
+    sections[0].size = sizeof(context);
+    context.last_result = ctx->last_result;
+    context.prev_result = ctx->prev_result;
+    memcpy(out + sections[0].offset, &context, sizeof(context));
+    if (sheet != NULL) {
+        sections[1].type = SECTION_SHEET;
+        sections[1].offset = sections[0].offset + sections[0].size;
+        sections[1].size = calc_sheet_image_size(sheet);
+        calc_sheet_image_write(sheet, out + sections[1].offset);
+    }
+    memcpy(out + sizeof(header), sections, count * sizeof(SnapshotSection));
+
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = CALC_SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.size = sections[count - 1].offset + sections[count - 1].size;
+    header.section_count = (uint32_t)count;
+    header.checksum = calc_xxh64(out + sizeof(header), (size_t)header.size - sizeof(header), 0);
+    memcpy(out, &header, sizeof(header));
+}
+
+/**
+ * @brief calc_snapshot_read(), or calc_snapshot_adopt() when release is not NULL (block is then
+ * the writable snapshot).
+ */
+static CalcStatus read_snapshot(const void* data, size_t size, CalcContext* ctx, CalcSheet* sheet, void* block,
+    CalcImageRelease release) {
+    const unsigned char* in = (const unsigned char*)data;
+    SnapshotHeader header;
+    SnapshotSection context_section, sheet_section;
+    SnapshotContext context;
+
+    if (size < sizeof(header)) return CALC_ERR_SNAPSHOT;
+    memcpy(&header, in, sizeof(header));
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != CALC_SNAPSHOT_VERSION
+        || header.byte_order != SNAPSHOT_BYTE_ORDER || header.size != size
+        || header.section_count > (size - sizeof(header)) / sizeof(SnapshotSection)
+        || calc_xxh64(in + sizeof(header), size - sizeof(header), 0) != header.checksum) {
+        return CALC_ERR_SNAPSHOT;
+    }
+
+    // One context section and at most one sheet section, within the snapshot
+    memset(&context_section, 0, sizeof(context_section));
+    memset(&sheet_section, 0, sizeof(sheet_section));
+    for (uint32_t i = 0; i < header.section_count; i++) {
+        SnapshotSection section;
+        memcpy(&section, in + sizeof(header) + i * sizeof(section), sizeof(section));
+        if (section.offset > size || section.size > size - section.offset || section.offset % 8 != 0) return CALC_ERR_SNAPSHOT;
+        if (section.type == SECTION_CONTEXT) {
+            if (context_section.type != 0 || section.size != sizeof(context)) return CALC_ERR_SNAPSHOT;
+            context_section = section;
+        }
+        else if (section.type == SECTION_SHEET) {
+            if (sheet_section.type != 0) return CALC_ERR_SNAPSHOT;
+            sheet_section = section;
+        }
+    }
+    if (context_section.type == 0) return CALC_ERR_SNAPSHOT;
+
+    memcpy(&context, in + context_section.offset, sizeof(context));
+    if (sheet != NULL && sheet_section.type != 0) {
+        CalcStatus status = release == NULL
+            ? calc_sheet_image_read(sheet, in + sheet_section.offset, (size_t)sheet_section.size)
+            : calc_sheet_image_adopt(sheet, (unsigned char*)block + sheet_section.offset, (size_t)sheet_section.size,
+                block, size, release);
+        if (status != CALC_OK) return status;
+    }
+    else if (release != NULL) {
+        release(block, size); // Nothing uses it
+    }
+    ctx->last_result = context.last_result;
+    ctx->prev_result = context.prev_result;
+    return CALC_OK;
+}
+
+CalcStatus calc_snapshot_read(const void* data, size_t size, CalcContext* ctx, CalcSheet* sheet) {
+    return read_snapshot(data, size, ctx, sheet, NULL, NULL);
+}
+
+CalcStatus calc_snapshot_adopt(void* data, size_t size, CalcImageRelease release, CalcContext* ctx, CalcSheet* sheet) {
+    return read_snapshot(data, size, ctx, sheet, data, release);
+}
@@ -0,0 +1,57 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include "CalcCore.h"
+#include "Sheet.h"
+
+/*
+ * Binary snapshot of a session: R and P of the context and the image of its sheet (see
+ * calc_sheet_image_write()), so that a session restarts where it stopped without replaying it.
+ *
+ * A snapshot is a header (magic "CALCSNAP", format version, byte-order mark, total size and the
+ * XXH64 checksum of everything after the header), a table of typed sections and the sections,
+ * all 8-byte aligned. Readers skip the sections they do not know, so new kinds of state can be
+ * added without a new version. A snapshot is only read back on a machine with the byte order and
+ * version that wrote it.
+ *
+ * Nothing here does I/O: the front end writes the buffer to a file and maps the file (copy on
+ * write) to read it back; calc_snapshot_adopt() hands the mapping to the sheet, which uses its
+ * image in place instead of copying it (see calc_sheet_image_adopt()).
+ */
+
+// Version of the snapshot format, changed when a section changes its layout
+#define CALC_SNAPSHOT_VERSION 1
+
+/**
+ * @brief Returns the size in bytes of the snapshot of a context and sheet (sheet may be NULL).
+ */
+size_t calc_snapshot_size(const CalcContext* ctx, const CalcSheet* sheet);
+
+/**
+ * @brief Writes the snapshot to buffer (calc_snapshot_size() bytes, aligned to 8 bytes).
+ */
+void calc_snapshot_write(const CalcContext* ctx, const CalcSheet* sheet, void* buffer);
+
+/**
+ * @brief Restores a snapshot into a context and an empty sheet (NULL to ignore the sheet), after
+ * checking its header and checksum. data should be aligned to 8 bytes.
+ * @return CALC_OK, CALC_ERR_SNAPSHOT (not a snapshot, another version or byte order, truncated or
+ * corrupt; ctx and sheet are then unchanged) or CALC_ERR_NO_MEMORY.
+ */
+CalcStatus calc_snapshot_read(const void* data, size_t size, CalcContext* ctx, CalcSheet* sheet);
+
+/**
+ * @brief Like calc_snapshot_read(), but the sheet uses its image in place in data, which must
+ * stay writable (e.g. a MAP_PRIVATE mapping). On success data belongs to the sheet, which calls
+ * release(data, size) when it is freed (at once if there is no sheet to restore); on failure the
+ * caller keeps it.
+ */
+CalcStatus calc_snapshot_adopt(void* data, size_t size, CalcImageRelease release, CalcContext* ctx, CalcSheet* sheet);
+
+/**
+ * @brief XXH64 hash of len bytes, the checksum of snapshots.
+ */
+unsigned long long calc_xxh64(const void* data, size_t len, unsigned long long seed);
+
+#endif // SNAPSHOT_H
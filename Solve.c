@@ -0,0 +1,305 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Solver.h"
+#include "Format.h"
+#include "Parse.h"
+#include <ctype.h>
+
+/*
+ * Numerical integration and root finding ("--integrate", "--root", "--roots") over a function given
+ * as an expression of R = x, with P as a parameter (see Solver.h). The expression is compiled to
+ * native code once and evaluated over whole vectors of points by expr_eval_many().
+ */
+
+// Longest line of a --roots problem file
+#define ROOTS_LINE_MAX 4096
+// Invalid problem lines reported in total
+#define ROOTS_MAX_ERRORS 100
+
+typedef struct {
+    CompiledExpr* f;
+    CompiledExpr* derivative;
+    CalcSolverOptions options;
+    double arg;              // P, unless a problem line gives its own
+    const char* input;       // --roots: the problem file (NULL for standard input)
+} SolveArgs;
+
+static void solve_expression(void* context, const double* x, const double* p, double* y, size_t n) {
+    expr_eval_many((const CompiledExpr*)context, x, p, y, n);
+}
+
+/**
+ * @brief Compiles an expression of R and P (a leading '=' as in --sweep is allowed) to native code;
+ * prints the error and returns NULL if it does not compile.
+ */
+static CompiledExpr* compile_solve_expression(const char* source) {
+    ExprError error;
+    CompiledExpr* expr = expr_compile(source[0] == '=' ? source + 1 : source, &error);
+    if (expr == NULL) {
+        fprintf(stderr, "Error: %s at column %zu.\n", error.message, error.position + 1 + (source[0] == '='));
+        return NULL;
+    }
+    expr_jit(expr);
+    return expr;
+}
+
+static void print_solve_usage(void) {
+    printf("Usage: --integrate EXPRESSION A B [OPTIONS]     integral of EXPRESSION of R = x from A to B (may be inf)\n");
+    printf("       --root EXPRESSION LO HI [OPTIONS]        x in [LO, HI] where EXPRESSION is 0\n");
+    printf("       --roots EXPRESSION [FILE] [OPTIONS]      one root per line \"LO HI [P]\" of FILE (default: standard input)\n");
+    printf("Options: --arg Y (P in EXPRESSION, default 0), --tol T (absolute, default 1e-10),\n");
+    printf("         --rel-tol T (default 1e-10), --max-evals N (default 1000000 per integral, 200 per root),\n");
+    printf("         --method brent|newton (roots, default brent), --derivative EXPRESSION (newton)\n");
+}
+
+/**
+ * @brief Parses the arguments after the positional ones (first is the index of the first option).
+ * @return 1 on success; 0 after printing the usage or an error.
+ */
+static int parse_solve_args(int argc, char* argv[], int first, int roots, SolveArgs* args) {
+    const char* derivative = NULL;
+
+    calc_solver_defaults(&args->options);
+    args->arg = 0;
+    for (int i = first; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        double number;
+        if (roots && i == first && (argv[i][0] != '-' || argv[i][1] == '\0')) {
+            args->input = argv[i];
+            continue;
+        }
+        if (value == NULL) { print_solve_usage(); return 0; }
+        if (strcmp(argv[i], "--arg") == 0) {
+            if (!parse_cli_number("--arg", value, &args->arg)) return 0;
+        }
+        else if (strcmp(argv[i], "--tol") == 0 || strcmp(argv[i], "--rel-tol") == 0) {
+            if (!parse_cli_number(argv[i], value, &number)) return 0;
+            if (!(number >= 0)) { fprintf(stderr, "Error: %s must not be negative.\n", argv[i]); return 0; }
+            if (strcmp(argv[i], "--tol") == 0) args->options.abs_tol = number;
+            else args->options.rel_tol = number;
+        }
+        else if (strcmp(argv[i], "--max-evals") == 0) {
+            if (!parse_cli_number("--max-evals", value, &number)) return 0;
+            if (!(number >= 1 && number <= 1e15)) { fprintf(stderr, "Error: --max-evals must be at least 1.\n"); return 0; }
+            args->options.max_evals = (size_t)number;
+        }
+        else if (strcmp(argv[i], "--method") == 0 && strcmp(value, "brent") == 0) args->options.method = CALC_ROOT_BRENT;
+        else if (strcmp(argv[i], "--method") == 0 && strcmp(value, "newton") == 0) args->options.method = CALC_ROOT_NEWTON;
+        else if (strcmp(argv[i], "--derivative") == 0) derivative = value;
+        else { print_solve_usage(); return 0; }
+        i++;
+    }
+    if (derivative != NULL) {
+        args->derivative = compile_solve_expression(derivative);
+        if (args->derivative == NULL) return 0;
+        args->options.derivative = solve_expression;
+        args->options.derivative_context = args->derivative;
+    }
+    return 1;
+}
+
+/**
+ * @brief Prints the lines of a single integral or root ("<name>\t<value>", then error, evals and
+ * steps_name) or the error, and returns the exit status (1 unless CALC_OK).
+ */
+static int report_solve(CalcStatus status, const char* name, const char* steps_name, const CalcSolverResult* result) {
+    if (status == CALC_OK || status == CALC_ERR_NOT_CONVERGED) {
+        print_named_result(name, result->value);
+        print_named_result("error", result->error);
+        printf("evals\t%zu\n%s\t%zu\n", result->evals, steps_name, result->steps);
+    }
+    if (status != CALC_OK) fprintf(stderr, "Error: %s.\n", calc_status_message(status));
+    return status != CALC_OK;
+}
+
+/**
+ * @brief Integrates an expression of R from A to B (the arguments that follow "--integrate") and
+ * prints value, error (estimated), evals and intervals, one "<name>\t<value>" line each.
+ * @return 0 on success, 1 on a usage error or if the integral failed or did not converge (its
+ * lines are printed all the same).
+ */
+int run_integrate(int argc, char* argv[]) {
+    SolveArgs args;
+    CalcSolverResult result;
+    CalcStatus status;
+    double a, b;
+
+    memset(&args, 0, sizeof(args));
+    if (argc < 3) { print_solve_usage(); return 1; }
+    if (!parse_cli_number("A", argv[1], &a) || !parse_cli_number("B", argv[2], &b)) return 1;
+    args.f = compile_solve_expression(argv[0]);
+    if (args.f == NULL || !parse_solve_args(argc, argv, 3, 0, &args)) {
+        expr_free(args.f);
+        expr_free(args.derivative);
+        return 1;
+    }
+
+    status = calc_integrate(solve_expression, args.f, args.arg, a, b, &args.options, &result);
+    expr_free(args.f);
+    expr_free(args.derivative);
+    return report_solve(status, "value", "intervals", &result);
+}
+
+/**
+ * @brief Finds where an expression of R is 0 in [LO, HI] (the arguments that follow "--root") and
+ * prints root, error (half the final bracket), evals and iterations.
+ * @return 0 on success, 1 on a usage error or if no root was found within the tolerance.
+ */
+int run_root(int argc, char* argv[]) {
+    SolveArgs args;
+    CalcSolverResult result;
+    CalcStatus status;
+    double lo, hi;
+
+    memset(&args, 0, sizeof(args));
+    if (argc < 3) { print_solve_usage(); return 1; }
+    if (!parse_cli_number("LO", argv[1], &lo) || !parse_cli_number("HI", argv[2], &hi)) return 1;
+    args.f = compile_solve_expression(argv[0]);
+    if (args.f == NULL || !parse_solve_args(argc, argv, 3, 0, &args)) {
+        expr_free(args.f);
+        expr_free(args.derivative);
+        return 1;
+    }
+
+    status = calc_find_root(solve_expression, args.f, args.arg, lo, hi, &args.options, &result);
+    expr_free(args.f);
+    expr_free(args.derivative);
+    return report_solve(status, "root", "iterations", &result);
+}
+
+/**
+ * @brief Solves one root problem per line "LO HI [P]" of a file or standard input (the arguments
+ * that follow "--roots": EXPRESSION [FILE] and options) and prints the roots, one per line in the
+ * order of the lines ("nan" for invalid lines and failed problems, reported on stderr with their line
+ * number).
+ * Blank lines are skipped.
+ * @return 0 on success, 1 on a usage error, if the input cannot be read, or if a line was invalid
+ * or its problem failed.
+ */
+int run_roots(int argc, char* argv[]) {
+    SolveArgs args;
+    FILE* in = stdin;
+    char line[ROOTS_LINE_MAX];
+    double *p = NULL, *lo = NULL, *hi = NULL;
+    size_t* line_numbers = NULL; // 0 for a rejected line, which is already reported
+    CalcSolverResult* results = NULL;
+    CalcStatus* statuses = NULL;
+    size_t count = 0, capacity = 0, line_no = 0, errors = 0;
+    const char* error = NULL;
+    int status = 0;
+
+    memset(&args, 0, sizeof(args));
+    if (argc < 1) { print_solve_usage(); return 1; }
+    args.f = compile_solve_expression(argv[0]);
+    if (args.f == NULL || !parse_solve_args(argc, argv, 1, 1, &args)) {
+        expr_free(args.f);
+        expr_free(args.derivative);
+        return 1;
+    }
+    if (args.input != NULL && strcmp(args.input, "-") != 0) {
+        in = fopen(args.input, "r");
+        if (in == NULL) {
+            fprintf(stderr, "Error: Cannot open '%s'.\n", args.input);
+            expr_free(args.f);
+            expr_free(args.derivative);
+            return 1;
+        }
+    }
+
+    while (error == NULL && fgets(line, sizeof(line), in) != NULL) {
+        const char* tokens[4];
+        size_t lens[4], n = 0, i = 0, len = strlen(line);
+        double values[3] = { NAN, NAN, NAN };
+        int rejected = 0;
+        line_no++;
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n' && !feof(in)) { error = "Line longer than 4095 characters"; break; }
+        while (i < len && n < 4) {
+            while (i < len && isspace((unsigned char)line[i])) i++;
+            if (i == len) break;
+            tokens[n] = line + i;
+            while (i < len && !isspace((unsigned char)line[i])) i++;
+            lens[n] = (size_t)(line + i - tokens[n]);
+            n++;
+        }
+        if (n == 0) continue;
+        if (n < 2 || n > 3) {
+            if (++errors <= ROOTS_MAX_ERRORS) fprintf(stderr, "Line %zu: Error: Expected \"LO HI [P]\".\n", line_no);
+            rejected = 1;
+        }
+        else {
+            values[2] = args.arg;
+            for (i = 0; i < n && !rejected; i++) {
+                size_t offset = 0;
+                CalcConvStatus conv = parse_number(tokens[i], lens[i], &values[i], &offset);
+                if (conv != CALC_CONV_OK) {
+                    if (++errors <= ROOTS_MAX_ERRORS) {
+                        fprintf(stderr, "Line %zu: Error: \"%.*s\": %s at position %zu.\n", line_no, (int)(lens[i] > 40 ? 40 : lens[i]), tokens[i],
+                            conv == CALC_CONV_OVERFLOW ? "Number out of range" : calc_conv_status_message(conv), offset + 1);
+                    }
+                    rejected = 1;
+                }
+            }
+        }
+        // A rejected line stays in the output as "nan", like in batch mode; its NAN interval fails at once
+        if (rejected) values[0] = values[1] = values[2] = NAN;
+
+        if (count == capacity) {
+            size_t grown = capacity ? capacity * 2 : 1024;
+            double* more_p = (double*)realloc(p, grown * sizeof(double));
+            double* more_lo = more_p != NULL ? (double*)realloc(lo, grown * sizeof(double)) : NULL;
+            double* more_hi = more_lo != NULL ? (double*)realloc(hi, grown * sizeof(double)) : NULL;
+            size_t* more_lines = more_hi != NULL ? (size_t*)realloc(line_numbers, grown * sizeof(size_t)) : NULL;
+            if (more_p != NULL) p = more_p;
+            if (more_lo != NULL) lo = more_lo;
+            if (more_hi != NULL) hi = more_hi;
+            if (more_lines == NULL) { error = "Out of memory"; break; }
+            line_numbers = more_lines;
+            capacity = grown;
+        }
+        lo[count] = values[0];
+        hi[count] = values[1];
+        p[count] = values[2];
+        line_numbers[count++] = rejected ? 0 : line_no;
+    }
+    if (error == NULL && ferror(in)) error = "Cannot read the input";
+    if (in != stdin) fclose(in);
+
+    if (error == NULL && count > 0) {
+        results = (CalcSolverResult*)malloc(count * sizeof(CalcSolverResult));
+        statuses = (CalcStatus*)malloc(count * sizeof(CalcStatus));
+        if (results == NULL || statuses == NULL ||
+            calc_find_roots(solve_expression, args.f, p, lo, hi, count, &args.options, results, statuses) != CALC_OK) {
+            error = "Out of memory";
+        }
+    }
+
+    if (error == NULL) {
+        for (size_t k = 0; k < count; k++) {
+            char text[CALC_FIXED_MAX_CHARS + 1];
+            if (statuses[k] != CALC_OK) {
+                if (line_numbers[k] != 0 && ++errors <= ROOTS_MAX_ERRORS) fprintf(stderr, "Line %zu: Error: %s.\n", line_numbers[k], calc_status_message(statuses[k]));
+                strcpy(text, "nan");
+            }
+            else {
+                format_result(results[k].value, text);
+            }
+            printf("%s\n", text);
+        }
+        if (errors > ROOTS_MAX_ERRORS) fprintf(stderr, "Error: %zu more invalid lines or failed problems.\n", errors - ROOTS_MAX_ERRORS);
+        status = errors > 0;
+    }
+    else {
+        fprintf(stderr, "Error: %s.\n", error);
+        status = 1;
+    }
+
+    free(results);
+    free(statuses);
+    free(p);
+    free(lo);
+    free(hi);
+    free(line_numbers);
+    expr_free(args.f);
+    expr_free(args.derivative);
+    return status;
+}
@@ -0,0 +1,647 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Solver.h"
+#include "Thread.h"
+#include <float.h>
+
+// Default evaluation limits (CalcSolverOptions.max_evals == 0)
+#define INTEGRATE_DEFAULT_EVALS 1000000
+#define ROOT_DEFAULT_EVALS 200
+// Gauss-Kronrod points per subinterval
+#define GK_POINTS 21
+// Most subintervals bisected in a round
+#define INTEGRATE_ROUND_MAX 256
+// Rounds with fewer new subintervals are evaluated in the calling thread
+#define INTEGRATE_PARALLEL_INTERVALS 64
+// Root problems advanced in lockstep by a thread
+#define ROOT_BLOCK 256
+
+void calc_solver_defaults(CalcSolverOptions* options) {
+    options->abs_tol = 1e-10;
+    options->rel_tol = 1e-10;
+    options->max_evals = 0;
+    options->method = CALC_ROOT_BRENT;
+    options->derivative = NULL;
+    options->derivative_context = NULL;
+}
+
+// max(abs_tol, rel_tol * |value|)
+static double solver_tolerance(const CalcSolverOptions* options, double value) {
+    double rel = options->rel_tol * fabs(value);
+    return rel > options->abs_tol ? rel : options->abs_tol;
+}
+
+
+// --- Integration ---
+
+// Gauss-Kronrod 21-point rule (QUADPACK qk21): Kronrod nodes in (0, 1], 1 first, and their
+// weights, the last one for the center; the Gauss 10-point rule uses nodes 1, 3, 5, 7 and 9
+static const double gk_nodes[10] = {
+    0.995657163025808080735527280689003, 0.973906528517171720077964012084452,
+    0.930157491355708226001207180059508, 0.865063366688984510732096688423493,
+    0.780817726586416897063717578345042, 0.679409568299024406234327365114874,
+    0.562757134668604683339000099272694, 0.433395394129247190799265943165784,
+    0.294392862701460198131126603103866, 0.148874338981631210884826001129720
+};
+static const double gk_weights[11] = {
+    0.011694638867371874278064396062192, 0.032558162307964727478818972459390,
+    0.054755896574351996031381300244580, 0.075039674810919952767043140916190,
+    0.093125454583697605535065465083366, 0.109387158802297641899210590325805,
+    0.123491976262065851077208980296163, 0.134709217311473325928054001771707,
+    0.142775938577060080797094273138717, 0.147739104901338491374841515972068,
+    0.149445554002916905664936468389821
+};
+static const double gauss_weights[5] = {
+    0.066671344308688137593568809893332, 0.149451349150580593145776339657697,
+    0.219086362515982043995534934228163, 0.269266719309996355091226921569469,
+    0.295524224714752870173892994651338
+};
+
+// How the integration variable t maps to x
+typedef enum {
+    MAP_NONE,       // x = t
+    MAP_UPPER,      // [a, +inf): x = a + t / (1 - t), t in [0, 1)
+    MAP_LOWER,      // (-inf, b]: x = b - t / (1 - t), t in [0, 1)
+    MAP_BOTH        // (-inf, +inf): x = t / (1 - t^2), t in (-1, 1)
+} IntegrateMap;
+
+typedef struct {
+    double a, b;     // In t
+    double value, error;
+    int failed;      // f was NAN or infinite at a point
+} Subinterval;
+
+typedef struct {
+    CalcFunctionN f;
+    void* context;
+    double p;
+    IntegrateMap map;
+    double origin;   // a of MAP_UPPER, b of MAP_LOWER
+    Subinterval* pending;
+} IntegrateRun;
+
+/**
+ * @brief Applies the 21-point rule to a subinterval: its value, and QUADPACK's error estimate from
+ * the difference with the embedded Gauss rule.
+ */
+static void gauss_kronrod(const IntegrateRun* run, Subinterval* s) {
+    double t[GK_POINTS], x[GK_POINTS], p[GK_POINTS], y[GK_POINTS];
+    double center = 0.5 * (s->a + s->b), half = 0.5 * (s->b - s->a);
+    double kronrod, gauss = 0, abs_sum, asc, mean;
+
+    t[0] = center;
+    for (int j = 0; j < 10; j++) {
+        t[1 + j] = center - half * gk_nodes[j];
+        t[11 + j] = center + half * gk_nodes[j];
+    }
+    for (int i = 0; i < GK_POINTS; i++) {
+        double u = t[i];
+        switch (run->map) {
+        case MAP_UPPER: x[i] = run->origin + u / (1 - u); break;
+        case MAP_LOWER: x[i] = run->origin - u / (1 - u); break;
+        case MAP_BOTH: x[i] = u / (1 - u * u); break;
+        default: x[i] = u; break;
+        }
+        p[i] = run->p;
+    }
+    run->f(run->context, x, p, y, GK_POINTS);
+    for (int i = 0; i < GK_POINTS; i++) {
+        double u = t[i];
+        // dx/dt
+        if (run->map == MAP_UPPER || run->map == MAP_LOWER) y[i] /= (1 - u) * (1 - u);
+        else if (run->map == MAP_BOTH) y[i] *= (1 + u * u) / ((1 - u * u) * (1 - u * u));
+        if (!isfinite(y[i])) {
+            s->failed = 1;
+            return;
+        }
+    }
+
+    kronrod = gk_weights[10] * y[0];
+    abs_sum = fabs(kronrod);
+    for (int j = 0; j < 10; j++) {
+        kronrod += gk_weights[j] * (y[1 + j] + y[11 + j]);
+        abs_sum += gk_weights[j] * (fabs(y[1 + j]) + fabs(y[11 + j]));
+        if (j & 1) gauss += gauss_weights[j / 2] * (y[1 + j] + y[11 + j]);
+    }
+    mean = 0.5 * kronrod;
+    asc = gk_weights[10] * fabs(y[0] - mean);
+    for (int j = 0; j < 10; j++) asc += gk_weights[j] * (fabs(y[1 + j] - mean) + fabs(y[11 + j] - mean));
+
+    s->value = kronrod * half;
+    s->error = fabs((kronrod - gauss) * half);
+    abs_sum *= fabs(half);
+    asc *= fabs(half);
+    if (asc != 0 && s->error != 0) s->error = asc * fmin(1, pow(200 * s->error / asc, 1.5));
+    if (abs_sum > DBL_MIN / (50 * DBL_EPSILON)) s->error = fmax(50 * DBL_EPSILON * abs_sum, s->error);
+    s->failed = 0;
+}
+
+static void integrate_task(void* context, size_t task, int worker) {
+    IntegrateRun* run = (IntegrateRun*)context;
+    (void)worker;
+    gauss_kronrod(run, &run->pending[task]);
+}
+
+// Max-heap of subinterval indices by error
+static void heap_push(size_t* heap, size_t* count, const Subinterval* items, size_t item) {
+    size_t i = (*count)++;
+    while (i > 0 && items[heap[(i - 1) / 2]].error < items[item].error) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = item;
+}
+
+static size_t heap_pop(size_t* heap, size_t* count, const Subinterval* items) {
+    size_t top = heap[0], last = heap[--(*count)], i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= *count) break;
+        if (child + 1 < *count && items[heap[child + 1]].error > items[heap[child]].error) child++;
+        if (items[heap[child]].error <= items[last].error) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*count > 0) heap[i] = last;
+    return top;
+}
+
+CalcStatus calc_integrate(CalcFunctionN f, void* context, double p, double a, double b,
+    const CalcSolverOptions* options, CalcSolverResult* result) {
+    IntegrateRun run;
+    Subinterval* items = NULL;
+    size_t* heap = NULL;
+    size_t* parents = NULL;
+    size_t count = 1, heap_count = 0, capacity = 64;
+    size_t max_evals = options->max_evals != 0 ? options->max_evals : INTEGRATE_DEFAULT_EVALS;
+    double sign = 1, total, total_error;
+    CalcStatus status = CALC_OK;
+
+    memset(result, 0, sizeof(*result));
+    if (isnan(a) || isnan(b)) return CALC_ERR_EVALUATION;
+    if (a == b) return CALC_OK;
+    if (a > b) {
+        double t = a;
+        a = b;
+        b = t;
+        sign = -1;
+    }
+
+    run.f = f;
+    run.context = context;
+    run.p = p;
+    run.origin = 0;
+    items = (Subinterval*)malloc(capacity * sizeof(Subinterval));
+    heap = (size_t*)malloc(capacity * sizeof(size_t));
+    parents = (size_t*)malloc(INTEGRATE_ROUND_MAX * sizeof(size_t));
+    run.pending = (Subinterval*)malloc(2 * INTEGRATE_ROUND_MAX * sizeof(Subinterval));
+    if (items == NULL || heap == NULL || parents == NULL || run.pending == NULL) {
+        status = CALC_ERR_NO_MEMORY;
+        goto done;
+    }
+    if (isinf(a) && isinf(b)) {
+        run.map = MAP_BOTH;
+        items[0].a = -1;
+        items[0].b = 1;
+    }
+    else if (isinf(b)) {
+        run.map = MAP_UPPER;
+        run.origin = a;
+        items[0].a = 0;
+        items[0].b = 1;
+    }
+    else if (isinf(a)) {
+        // (-inf, b] runs backwards from b: t = 0 is x = b
+        run.map = MAP_LOWER;
+        run.origin = b;
+        items[0].a = 0;
+        items[0].b = 1;
+    }
+    else {
+        run.map = MAP_NONE;
+        items[0].a = a;
+        items[0].b = b;
+    }
+
+    gauss_kronrod(&run, &items[0]);
+    result->evals = GK_POINTS;
+    if (items[0].failed) {
+        status = CALC_ERR_EVALUATION;
+        goto done;
+    }
+    total = items[0].value;
+    total_error = items[0].error;
+    heap_push(heap, &heap_count, items, 0);
+
+    for (;;) {
+        double tolerance = solver_tolerance(options, total), taken = 0;
+        size_t bisected = 0;
+
+        if (total_error <= tolerance) {
+            // The running sums drift as subintervals are replaced: confirm with exact ones
+            total = total_error = 0;
+            for (size_t i = 0; i < count; i++) {
+                total += items[i].value;
+                total_error += items[i].error;
+            }
+            tolerance = solver_tolerance(options, total);
+            if (total_error <= tolerance) break;
+        }
+
+        // The worst subintervals, until those left fit in the tolerance
+        while (heap_count > 0 && bisected < INTEGRATE_ROUND_MAX && (bisected == 0 || total_error - taken > tolerance) &&
+            result->evals + 2 * GK_POINTS * (bisected + 1) <= max_evals) {
+            size_t item = heap_pop(heap, &heap_count, items);
+            double mid = 0.5 * (items[item].a + items[item].b);
+            parents[bisected] = item;
+            taken += items[item].error;
+            run.pending[2 * bisected].a = items[item].a;
+            run.pending[2 * bisected].b = mid;
+            run.pending[2 * bisected + 1].a = mid;
+            run.pending[2 * bisected + 1].b = items[item].b;
+            bisected++;
+        }
+        if (bisected == 0) {
+            status = CALC_ERR_NOT_CONVERGED;
+            break;
+        }
+        if (count + bisected > capacity) {
+            size_t grown = capacity * 2 > count + bisected ? capacity * 2 : count + bisected;
+            Subinterval* more_items = (Subinterval*)realloc(items, grown * sizeof(Subinterval));
+            size_t* more_heap;
+            if (more_items != NULL) items = more_items;
+            more_heap = more_items != NULL ? (size_t*)realloc(heap, grown * sizeof(size_t)) : NULL;
+            if (more_heap == NULL) {
+                status = CALC_ERR_NO_MEMORY;
+                break;
+            }
+            heap = more_heap;
+            capacity = grown;
+        }
+
+        if (2 * bisected >= INTEGRATE_PARALLEL_INTERVALS) calc_parallel_for(2 * bisected, integrate_task, &run);
+        else for (size_t i = 0; i < 2 * bisected; i++) gauss_kronrod(&run, &run.pending[i]);
+        result->evals += 2 * GK_POINTS * bisected;
+
+        // The first half replaces its parent, the second one is appended
+        for (size_t i = 0; i < bisected && status == CALC_OK; i++) {
+            size_t parent = parents[i];
+            const Subinterval* half = &run.pending[2 * i];
+            if (half[0].failed || half[1].failed) {
+                status = CALC_ERR_EVALUATION;
+                break;
+            }
+            total += half[0].value + half[1].value - items[parent].value;
+            total_error += half[0].error + half[1].error - items[parent].error;
+            items[parent] = half[0];
+            items[count] = half[1];
+            for (size_t k = 0; k < 2; k++) {
+                size_t item = k == 0 ? parent : count;
+                double mid = 0.5 * (items[item].a + items[item].b);
+                // Subintervals too narrow to be bisected stay as they are
+                if (items[item].a < mid && mid < items[item].b) heap_push(heap, &heap_count, items, item);
+            }
+            count++;
+        }
+        if (status != CALC_OK) break;
+    }
+
+    if (status == CALC_OK || status == CALC_ERR_NOT_CONVERGED) {
+        total = total_error = 0;
+        for (size_t i = 0; i < count; i++) {
+            total += items[i].value;
+            total_error += items[i].error;
+        }
+        result->value = sign * total;
+        result->error = total_error;
+        result->steps = count;
+    }
+
+done:
+    if (status != CALC_OK && status != CALC_ERR_NOT_CONVERGED) result->value = NAN;
+    free(items);
+    free(heap);
+    free(parents);
+    free(run.pending);
+    return status;
+}
+
+
+// --- Roots ---
+
+typedef enum { ROOT_START, ROOT_STEP, ROOT_DONE } RootPhase;
+
+typedef struct {
+    RootPhase phase;
+    double p, lo, hi;
+    double a, b, c, fa, fb, fc, d, e;   // Brent: b is the estimate, the root lies between b and c
+    double x, step, previous_step;      // Newton: the point, and the last two steps
+    double flo;                         // Newton: f(lo) (f(hi) has the other sign)
+    double h;                           // Newton: finite difference step at x
+    size_t evals, steps;
+    CalcStatus status;
+    double value, error;
+} RootProblem;
+
+typedef struct {
+    RootProblem problems[ROOT_BLOCK];
+    double x[2 * ROOT_BLOCK], p[2 * ROOT_BLOCK], y[2 * ROOT_BLOCK];
+    double dx[ROOT_BLOCK], dp[ROOT_BLOCK], dy[ROOT_BLOCK];
+} RootWorkspace;
+
+typedef struct {
+    CalcFunctionN f;
+    void* context;
+    const CalcSolverOptions* options;
+    size_t max_evals;
+    const double *p, *lo, *hi;
+    size_t n;
+    CalcSolverResult* results;
+    CalcStatus* statuses;
+    RootWorkspace** workspaces; // Per worker
+} RootRun;
+
+static void root_finish(RootProblem* r, CalcStatus status, double value, double error) {
+    r->phase = ROOT_DONE;
+    r->status = status;
+    r->value = value;
+    r->error = error;
+}
+
+/**
+ * @brief Points where f is needed next (0 when the problem is done; Newton with a derivative
+ * function also needs f' at the first one).
+ */
+static size_t root_points(const RootRun* run, const RootProblem* r, double* x) {
+    switch (r->phase) {
+    case ROOT_START:
+        x[0] = r->lo;
+        x[1] = r->hi;
+        return 2;
+    case ROOT_STEP:
+        if (run->options->method == CALC_ROOT_BRENT) {
+            x[0] = r->b;
+            return 1;
+        }
+        x[0] = r->x;
+        if (run->options->derivative != NULL) return 1;
+        x[1] = r->x + r->h;
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief A step of Brent's method (zeroin) from the new estimate b: either the root is found, or
+ * b moves to the next point to evaluate.
+ */
+static void brent_next(const RootRun* run, RootProblem* r) {
+    double tol, xm;
+
+    if ((r->fb > 0) == (r->fc > 0)) {
+        r->c = r->a;
+        r->fc = r->fa;
+        r->d = r->e = r->b - r->a;
+    }
+    if (fabs(r->fc) < fabs(r->fb)) {
+        r->a = r->b;
+        r->b = r->c;
+        r->c = r->a;
+        r->fa = r->fb;
+        r->fb = r->fc;
+        r->fc = r->fa;
+    }
+    tol = 2 * DBL_EPSILON * fabs(r->b) + 0.5 * solver_tolerance(run->options, r->b);
+    xm = 0.5 * (r->c - r->b);
+    if (fabs(xm) <= tol || r->fb == 0) {
+        root_finish(r, CALC_OK, r->b, r->fb == 0 ? 0 : fabs(xm));
+        return;
+    }
+    if (r->evals + 1 > run->max_evals) {
+        root_finish(r, CALC_ERR_NOT_CONVERGED, r->b, fabs(xm));
+        return;
+    }
+
+    if (fabs(r->e) >= tol && fabs(r->fa) > fabs(r->fb)) {
+        // Inverse quadratic interpolation, or the secant when only two points are distinct
+        double s = r->fb / r->fa, p, q, q_min;
+        if (r->a == r->c) {
+            p = 2 * xm * s;
+            q = 1 - s;
+        }
+        else {
+            double t = r->fa / r->fc, u = r->fb / r->fc;
+            p = s * (2 * xm * t * (t - u) - (r->b - r->a) * (u - 1));
+            q = (t - 1) * (u - 1) * (s - 1);
+        }
+        if (p > 0) q = -q;
+        p = fabs(p);
+        q_min = fmin(3 * xm * q - fabs(tol * q), fabs(r->e * q));
+        if (2 * p < q_min) {
+            r->e = r->d;
+            r->d = p / q;
+        }
+        else {
+            r->d = r->e = xm;
+        }
+    }
+    else {
+        r->d = r->e = xm;
+    }
+    r->a = r->b;
+    r->fa = r->fb;
+    r->b += fabs(r->d) > tol ? r->d : (xm > 0 ? tol : -tol);
+    r->steps++;
+}
+
+/**
+ * @brief Sets the finite difference step of Newton's method at x, towards the inside of the bracket.
+ */
+static void newton_step_size(RootProblem* r) {
+    double h = sqrt(DBL_EPSILON) * fmax(fabs(r->x), 1);
+    double far_end = fabs(r->hi - r->x) > fabs(r->lo - r->x) ? r->hi : r->lo;
+    r->h = far_end >= r->x ? h : -h;
+}
+
+/**
+ * @brief A safeguarded Newton step (rtsafe) from f(x) and f'(x): the bracket [lo, hi] (f(lo) < 0)
+ * shrinks to the side of x, and the step bisects it when Newton's would leave it or would not
+ * halve the previous step.
+ */
+static void newton_next(const RootRun* run, RootProblem* r, double fx, double dfx) {
+    double tol;
+
+    r->steps++;
+    if (fx == 0) {
+        root_finish(r, CALC_OK, r->x, 0);
+        return;
+    }
+    if ((fx < 0) == (r->flo < 0)) r->lo = r->x;
+    else r->hi = r->x;
+
+    if (!isfinite(dfx) || dfx == 0 || ((r->x - r->hi) * dfx - fx) * ((r->x - r->lo) * dfx - fx) > 0 ||
+        fabs(2 * fx) > fabs(r->previous_step * dfx)) {
+        r->previous_step = r->step;
+        r->step = 0.5 * (r->hi - r->lo);
+        r->x = r->lo + r->step;
+    }
+    else {
+        r->previous_step = r->step;
+        r->step = fx / dfx;
+        r->x -= r->step;
+    }
+    tol = 2 * DBL_EPSILON * fabs(r->x) + 0.5 * solver_tolerance(run->options, r->x);
+    if (fabs(r->step) <= tol || fabs(r->hi - r->lo) <= 2 * tol) {
+        root_finish(r, CALC_OK, r->x, fmin(fabs(r->step), 0.5 * fabs(r->hi - r->lo)));
+        return;
+    }
+    if (r->evals + 2 > run->max_evals) {
+        root_finish(r, CALC_ERR_NOT_CONVERGED, r->x, 0.5 * fabs(r->hi - r->lo));
+        return;
+    }
+    newton_step_size(r);
+}
+
+/**
+ * @brief Takes the values of f at the points of root_points() (and f' at the first one).
+ */
+static void root_update(const RootRun* run, RootProblem* r, const double* y, double dy) {
+    if (r->phase == ROOT_START) {
+        double flo = y[0], fhi = y[1];
+        r->evals += 2;
+        if (isnan(flo) || isnan(fhi)) { root_finish(r, CALC_ERR_EVALUATION, NAN, NAN); return; }
+        if (flo == 0) { root_finish(r, CALC_OK, r->lo, 0); return; }
+        if (fhi == 0) { root_finish(r, CALC_OK, r->hi, 0); return; }
+        if ((flo > 0) == (fhi > 0)) { root_finish(r, CALC_ERR_NO_SIGN_CHANGE, NAN, NAN); return; }
+        r->phase = ROOT_STEP;
+        if (run->options->method == CALC_ROOT_BRENT) {
+            r->a = r->lo;
+            r->fa = flo;
+            r->b = r->c = r->hi;
+            r->fb = r->fc = fhi;
+            brent_next(run, r);
+        }
+        else {
+            r->flo = flo;
+            r->x = 0.5 * (r->lo + r->hi);
+            r->step = r->previous_step = fabs(r->hi - r->lo);
+            newton_step_size(r);
+        }
+        return;
+    }
+
+    if (run->options->method == CALC_ROOT_BRENT) {
+        r->evals++;
+        if (isnan(y[0])) { root_finish(r, CALC_ERR_EVALUATION, NAN, NAN); return; }
+        r->fb = y[0];
+        brent_next(run, r);
+        return;
+    }
+    r->evals += 2;
+    if (isnan(y[0])) { root_finish(r, CALC_ERR_EVALUATION, NAN, NAN); return; }
+    // A NAN or infinite derivative only makes the step a bisection
+    newton_next(run, r, y[0], run->options->derivative != NULL ? dy : (y[1] - y[0]) / r->h);
+}
+
+// Solves the block of ROOT_BLOCK problems with index task, in lockstep
+static void root_block(void* context, size_t task, int worker) {
+    RootRun* run = (RootRun*)context;
+    RootWorkspace* w = run->workspaces[worker];
+    size_t first = task * ROOT_BLOCK;
+    size_t count = run->n - first < ROOT_BLOCK ? run->n - first : ROOT_BLOCK;
+
+    for (size_t i = 0; i < count; i++) {
+        RootProblem* r = &w->problems[i];
+        size_t k = first + i;
+        memset(r, 0, sizeof(*r));
+        r->p = run->p[k];
+        r->lo = run->lo[k];
+        r->hi = run->hi[k];
+        r->phase = ROOT_START;
+        if (!isfinite(r->lo) || !isfinite(r->hi)) root_finish(r, CALC_ERR_EVALUATION, NAN, NAN);
+    }
+
+    for (;;) {
+        size_t points = 0, derivatives = 0;
+        for (size_t i = 0; i < count; i++) {
+            size_t m = root_points(run, &w->problems[i], w->x + points);
+            for (size_t j = 0; j < m; j++) w->p[points + j] = w->problems[i].p;
+            if (m > 0 && w->problems[i].phase == ROOT_STEP && run->options->derivative != NULL &&
+                run->options->method == CALC_ROOT_NEWTON) {
+                w->dx[derivatives] = w->x[points];
+                w->dp[derivatives++] = w->problems[i].p;
+            }
+            points += m;
+        }
+        if (points == 0) break;
+        run->f(run->context, w->x, w->p, w->y, points);
+        if (derivatives > 0) run->options->derivative(run->options->derivative_context, w->dx, w->dp, w->dy, derivatives);
+
+        points = derivatives = 0;
+        for (size_t i = 0; i < count; i++) {
+            RootProblem* r = &w->problems[i];
+            double x[2], dy = 0;
+            size_t m = root_points(run, r, x);
+            if (m == 0) continue;
+            if (r->phase == ROOT_STEP && run->options->derivative != NULL && run->options->method == CALC_ROOT_NEWTON) {
+                dy = w->dy[derivatives++];
+            }
+            root_update(run, r, w->y + points, dy);
+            points += m;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const RootProblem* r = &w->problems[i];
+        CalcSolverResult* result = &run->results[first + i];
+        result->value = r->value;
+        result->error = r->error;
+        result->evals = r->evals;
+        result->steps = r->steps;
+        run->statuses[first + i] = r->status;
+    }
+}
+
+CalcStatus calc_find_roots(CalcFunctionN f, void* context, const double* p, const double* lo, const double* hi,
+    size_t n, const CalcSolverOptions* options, CalcSolverResult* results, CalcStatus* statuses) {
+    RootRun run;
+    CalcStatus status = CALC_OK;
+    size_t blocks = (n + ROOT_BLOCK - 1) / ROOT_BLOCK;
+    int workers = blocks > 1 ? calc_thread_count() : 1;
+
+    if (n == 0) return CALC_OK;
+    if ((size_t)workers > blocks) workers = (int)blocks;
+    run.f = f;
+    run.context = context;
+    run.options = options;
+    run.max_evals = options->max_evals != 0 ? options->max_evals : ROOT_DEFAULT_EVALS;
+    run.p = p;
+    run.lo = lo;
+    run.hi = hi;
+    run.n = n;
+    run.results = results;
+    run.statuses = statuses;
+    run.workspaces = (RootWorkspace**)calloc((size_t)workers, sizeof(RootWorkspace*));
+    for (int w = 0; run.workspaces != NULL && w < workers && status == CALC_OK; w++) {
+        run.workspaces[w] = (RootWorkspace*)malloc(sizeof(RootWorkspace));
+        if (run.workspaces[w] == NULL) status = CALC_ERR_NO_MEMORY;
+    }
+    if (run.workspaces == NULL) status = CALC_ERR_NO_MEMORY;
+
+    if (status == CALC_OK) {
+        if (workers > 1) calc_parallel_for(blocks, root_block, &run);
+        else for (size_t block = 0; block < blocks; block++) root_block(&run, block, 0);
+    }
+
+    for (int w = 0; run.workspaces != NULL && w < workers; w++) free(run.workspaces[w]);
+    free(run.workspaces);
+    return status;
+}
+
+CalcStatus calc_find_root(CalcFunctionN f, void* context, double p, double lo, double hi,
+    const CalcSolverOptions* options, CalcSolverResult* result) {
+    CalcStatus status, problem_status = CALC_OK;
+    status = calc_find_roots(f, context, &p, &lo, &hi, 1, options, result, &problem_status);
+    return status != CALC_OK ? status : problem_status;
+}
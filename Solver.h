@@ -0,0 +1,86 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <stddef.h>
+#include "CalcCore.h"
+
+/*
+ * Numerical integration and root finding over functions of one variable such as compiled
+ * expressions. A function is evaluated at many points per call (see CalcFunctionN), so that
+ * expr_eval_many() and the bulk kernels see whole vectors of points.
+ *
+ * calc_integrate() is globally adaptive Gauss-Kronrod quadrature (21 points): every round bisects
+ * the subintervals with the largest error estimates, as many as it takes for the others to fit in
+ * the tolerance, and evaluates the halves in parallel once a round is large enough. The rounds do
+ * not depend on the number of threads, and neither does the result.
+ *
+ * calc_find_roots() solves independent bracketed problems f(x; p[i]) = 0 with Brent's method
+ * (inverse quadratic interpolation, secant and bisection) or a safeguarded Newton iteration.
+ * Blocks of problems advance in lockstep, one call of the function per step for all the unsolved
+ * problems of a block, and the blocks are spread over calc_thread_count() threads.
+ *
+ * Both stop once the error estimate is within max(abs_tol, rel_tol * |result|) or after max_evals
+ * evaluations (CALC_ERR_NOT_CONVERGED, with the best result found so far).
+ */
+
+/**
+ * @brief Evaluates y[i] = f(x[i]; p[i]) for i < n; a failed evaluation is NAN. expr_eval_many()
+ * with R = x and P = p has this form. Called from several threads at once.
+ */
+typedef void (*CalcFunctionN)(void* context, const double* x, const double* p, double* y, size_t n);
+
+typedef enum {
+    CALC_ROOT_BRENT,
+    CALC_ROOT_NEWTON  // Newton steps within the bracket, bisection where they do not shrink it fast enough
+} CalcRootMethod;
+
+typedef struct {
+    double abs_tol, rel_tol;   // Tolerances of the result, see calc_solver_defaults()
+    size_t max_evals;          // Evaluations allowed per integral or root problem, 0 for the default
+    CalcRootMethod method;
+    CalcFunctionN derivative;  // Newton: f'(x; p), or NULL for a finite difference (one more evaluation per step)
+    void* derivative_context;
+} CalcSolverOptions;
+
+typedef struct {
+    double value;              // The integral or the root
+    double error;              // Estimated absolute error (for a root, half the final bracket)
+    size_t evals;              // Evaluations of f (and of the derivative)
+    size_t steps;              // Subintervals of the integral, or iterations of the root finder
+} CalcSolverResult;
+
+/**
+ * @brief Sets the default options: abs_tol 1e-10, rel_tol 1e-10, max_evals 0 (1000000 evaluations
+ * per integral, 200 per root problem), Brent's method and no derivative.
+ */
+void calc_solver_defaults(CalcSolverOptions* options);
+
+/**
+ * @brief Integrates f(x; p) over [a, b] (b < a gives the negated integral). Infinite bounds are
+ * mapped to a finite interval by x = t / (1 - t^2) and its one-sided forms.
+ * @return CALC_OK, CALC_ERR_NOT_CONVERGED (the tolerance was not reached within max_evals, or the
+ * subintervals became too narrow to bisect), CALC_ERR_EVALUATION (f is NAN or infinite at a
+ * point, or a bound is NAN) or CALC_ERR_NO_MEMORY.
+ */
+CalcStatus calc_integrate(CalcFunctionN f, void* context, double p, double a, double b,
+    const CalcSolverOptions* options, CalcSolverResult* result);
+
+/**
+ * @brief Finds a root of f(x; p) in [lo, hi], where f changes sign, see calc_find_roots().
+ */
+CalcStatus calc_find_root(CalcFunctionN f, void* context, double p, double lo, double hi,
+    const CalcSolverOptions* options, CalcSolverResult* result);
+
+/**
+ * @brief Solves n problems f(x; p[i]) = 0 for x in [lo[i], hi[i]] (in either order).
+ * @param results Receive the roots and their error estimates (NAN for the problems that failed
+ * other than by CALC_ERR_NOT_CONVERGED, which get the best estimate found).
+ * @param statuses Receive per problem CALC_OK, CALC_ERR_NO_SIGN_CHANGE (f(lo) and f(hi) have the
+ * same sign), CALC_ERR_NOT_CONVERGED or CALC_ERR_EVALUATION (f is NAN at a point, or a bound is
+ * not finite).
+ * @return CALC_OK, or CALC_ERR_NO_MEMORY (then no problem was solved).
+ */
+CalcStatus calc_find_roots(CalcFunctionN f, void* context, const double* p, const double* lo, const double* hi,
+    size_t n, const CalcSolverOptions* options, CalcSolverResult* results, CalcStatus* statuses);
+
+#endif // SOLVER_H
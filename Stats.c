@@ -0,0 +1,492 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdlib.h>
+#include <string.h>
+#include "Stats.h"
+
+#if defined(CALC_NO_STATS)
+
+int calc_stats_enabled(void) { return 0; }
+
+void calc_stats_write_prometheus(FILE* out) { (void)out; }
+
+void calc_stats_write_json(FILE* out) { fprintf(out, "{ \"operations\": [] }\n"); }
+
+int calc_stats_watch_signal(void) { return 0; }
+
+#else
+
+#include "Thread.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#if !defined(CALC_NO_THREADS)
+#include <pthread.h>
+#include <signal.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h> // __rdtsc(), _BitScanReverse64()
+#define STATS_THREAD_LOCAL __declspec(thread)
+#else
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+#define STATS_THREAD_LOCAL __thread
+#endif
+
+// Statuses counted per operation
+#define STATS_STATUSES CALC_STATUS_COUNT
+// Histogram: durations below 32 ticks have a bucket each, then 16 buckets per power of two
+#define STATS_SUB_BITS 4
+#define STATS_LINEAR (2 << STATS_SUB_BITS)
+// Powers of two up to 2^38 ticks (over a minute at 4 GHz); longer durations share the last bucket
+#define STATS_MAX_BIT 38
+#define STATS_BUCKETS ((STATS_MAX_BIT - STATS_SUB_BITS + 1) << STATS_SUB_BITS)
+// Calls of an operation in a thread that are all timed, and the sampling period of the later ones
+#define STATS_TIME_FIRST 256
+#define STATS_SAMPLE_PERIOD 16
+
+/*
+ * A counter is only written by the thread owning its shard, but read by dumps from any thread:
+ * relaxed atomic accesses (plain loads and stores on x86-64 and AArch64) keep both well defined.
+ */
+#if defined(_MSC_VER)
+#define COUNTER_ADD(counter, value) (*(volatile uint64_t*)&(counter) += (value))
+#define COUNTER_SET(counter, value) (*(volatile uint64_t*)&(counter) = (value))
+#define COUNTER_READ(counter) (*(volatile const uint64_t*)&(counter))
+#else
+#define COUNTER_ADD(counter, value) __atomic_store_n(&(counter), (counter) + (value), __ATOMIC_RELAXED)
+#define COUNTER_SET(counter, value) __atomic_store_n(&(counter), (value), __ATOMIC_RELAXED)
+#define COUNTER_READ(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+#endif
+
+typedef struct {
+    uint64_t counts[CALC_OP_COUNT][STATS_STATUSES]; // Operations by final status
+    uint64_t ticks[CALC_OP_COUNT];                  // Total duration of the sampled calls
+    uint64_t max_ticks[CALC_OP_COUNT];
+    uint64_t buckets[CALC_OP_COUNT][STATS_BUCKETS]; // Duration histogram of the sampled calls
+} StatsTable;
+
+/*
+ * The statistics of one thread. Shards are never freed: a thread that ends releases its shard
+ * (the counts stay), and the next thread that needs one claims it, so short-lived workers do not
+ * make the registry grow.
+ */
+typedef struct StatsShard {
+    StatsTable table;
+    uint64_t calls[CALC_OP_COUNT]; // Calls started, for the sampling (only read by the owner)
+    struct StatsShard* next;       // Registry of every shard
+    volatile long in_use;    // Claimed by a running thread
+} StatsShard;
+
+static StatsShard* volatile stats_registry = NULL;
+static STATS_THREAD_LOCAL StatsShard* stats_shard = NULL;
+
+static const char* const op_names[] = {
+    "add", "subtract", "multiply", "divide", "remainder",
+    "exp", "log", "abs", "power", "factorial", "binomial",
+    "sin", "cos", "tan", "cot", "hypot",
+    "dec_to_bin", "dec_to_hex", "bin_to_dec", "hex_to_dec",
+    "hex_to_bin", "bin_to_hex", "expression",
+    "matrix_add", "matrix_multiply", "matrix_transpose", "dot", "norm", "solve",
+    "mod_multiply", "mod_power", "mod_inverse", "is_prime"
+};
+
+static const char* const status_names[] = {
+    "ok", "division_by_zero", "modulo_by_zero", "log_domain", "factorial_domain", "binomial_domain",
+    "tan_undefined", "cot_undefined", "missing_digits", "invalid_digit", "syntax", "evaluation",
+    "circular", "undefined", "dimension", "singular", "no_sign_change",
+    "not_converged", "snapshot", "no_memory", "output", "not_invertible", "integer_range"
+};
+
+// Every operation and status has a name
+_Static_assert(sizeof(op_names) / sizeof(op_names[0]) == CALC_OP_COUNT, "op_names does not match CalcOp");
+_Static_assert(sizeof(status_names) / sizeof(status_names[0]) == STATS_STATUSES, "status_names does not match CalcStatus");
+
+
+// --- Shard registry ---
+
+#if defined(_WIN32)
+static int shard_claim(StatsShard* shard) { return InterlockedCompareExchange(&shard->in_use, 1, 0) == 0; }
+#if !defined(CALC_NO_THREADS)
+static void shard_release(StatsShard* shard) { InterlockedExchange(&shard->in_use, 0); }
+#endif
+static int registry_push(StatsShard* shard, StatsShard* head) {
+    return InterlockedCompareExchangePointer((PVOID volatile*)&stats_registry, shard, head) == head;
+}
+static StatsShard* registry_head(void) { return (StatsShard*)InterlockedCompareExchangePointer((PVOID volatile*)&stats_registry, NULL, NULL); }
+#else
+static int shard_claim(StatsShard* shard) {
+    long expected = 0;
+    return __atomic_compare_exchange_n(&shard->in_use, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+#if !defined(CALC_NO_THREADS)
+static void shard_release(StatsShard* shard) { __atomic_store_n(&shard->in_use, 0, __ATOMIC_RELEASE); }
+#endif
+static int registry_push(StatsShard* shard, StatsShard* head) {
+    return __atomic_compare_exchange_n(&stats_registry, &head, shard, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+}
+static StatsShard* registry_head(void) { return __atomic_load_n(&stats_registry, __ATOMIC_ACQUIRE); }
+#endif
+
+/*
+ * Releasing the shard when its thread ends: a fiber-local slot with a callback on Windows, a key
+ * with a destructor with POSIX threads (neither runs for the main thread, whose shard lives as
+ * long as the process anyway).
+ */
+#if defined(CALC_NO_THREADS)
+
+static void shard_watch_exit(StatsShard* shard) { (void)shard; }
+
+#elif defined(_WIN32)
+
+static DWORD stats_fls = FLS_OUT_OF_INDEXES;
+static INIT_ONCE stats_fls_once = INIT_ONCE_STATIC_INIT;
+
+static void WINAPI shard_thread_exit(void* shard) {
+    if (shard != NULL) shard_release((StatsShard*)shard);
+}
+
+static BOOL CALLBACK create_fls(PINIT_ONCE once, void* parameter, void** context) {
+    (void)once; (void)parameter; (void)context;
+    stats_fls = FlsAlloc(shard_thread_exit);
+    return TRUE;
+}
+
+static void shard_watch_exit(StatsShard* shard) {
+    InitOnceExecuteOnce(&stats_fls_once, create_fls, NULL, NULL);
+    if (stats_fls != FLS_OUT_OF_INDEXES) FlsSetValue(stats_fls, shard);
+}
+
+#else
+
+static pthread_key_t stats_key;
+static pthread_once_t stats_key_once = PTHREAD_ONCE_INIT;
+static int stats_key_valid = 0;
+
+static void shard_thread_exit(void* shard) {
+    shard_release((StatsShard*)shard);
+}
+
+static void create_key(void) {
+    stats_key_valid = pthread_key_create(&stats_key, shard_thread_exit) == 0;
+}
+
+static void shard_watch_exit(StatsShard* shard) {
+    pthread_once(&stats_key_once, create_key);
+    if (stats_key_valid) pthread_setspecific(stats_key, shard);
+}
+
+#endif
+
+/**
+ * @brief Gives the calling thread a shard: a released one if any, otherwise a new one.
+ * @return The shard, or NULL if out of memory.
+ */
+static StatsShard* attach_shard(void) {
+    StatsShard* shard;
+    for (shard = registry_head(); shard != NULL; shard = shard->next) {
+        if (shard->in_use == 0 && shard_claim(shard)) break;
+    }
+    if (shard == NULL) {
+        StatsShard* head;
+        shard = (StatsShard*)calloc(1, sizeof(StatsShard));
+        if (shard == NULL) return NULL;
+        shard->in_use = 1;
+        do {
+            head = registry_head();
+            shard->next = head;
+        } while (!registry_push(shard, head));
+    }
+    shard_watch_exit(shard);
+    stats_shard = shard;
+    return shard;
+}
+
+
+// --- Recording ---
+
+static double monotonic_ns(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e9 / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Returns the clock of the durations: the time stamp counter on x86-64 (constant rate on
+ * current CPUs, cheaper to read than the system clock), nanoseconds elsewhere.
+ */
+static uint64_t stats_clock(void) {
+#if defined(__x86_64__) || defined(_M_X64)
+    return __rdtsc();
+#else
+    return (uint64_t)monotonic_ns();
+#endif
+}
+
+/**
+ * @brief Returns the histogram bucket of a duration.
+ */
+static size_t bucket_of(uint64_t ticks) {
+    size_t index;
+#if defined(_MSC_VER)
+    unsigned long bit;
+    if (ticks < STATS_LINEAR) return (size_t)ticks;
+    _BitScanReverse64(&bit, ticks);
+#else
+    int bit;
+    if (ticks < STATS_LINEAR) return (size_t)ticks;
+    bit = 63 - __builtin_clzll(ticks); // At least STATS_SUB_BITS + 1
+#endif
+    index = (size_t)(bit - STATS_SUB_BITS + 1) << STATS_SUB_BITS
+          | ((size_t)(ticks >> (bit - STATS_SUB_BITS)) & ((1u << STATS_SUB_BITS) - 1));
+    return index < STATS_BUCKETS ? index : STATS_BUCKETS - 1;
+}
+
+/**
+ * @brief Returns the middle of the durations that fall into a bucket.
+ */
+static double bucket_middle(size_t index) {
+    size_t bit;
+    if (index < STATS_LINEAR) return (double)index;
+    bit = (index >> STATS_SUB_BITS) + STATS_SUB_BITS - 1;
+    return ((double)((1u << STATS_SUB_BITS) + (index & ((1u << STATS_SUB_BITS) - 1))) + 0.5)
+         * (double)((uint64_t)1 << (bit - STATS_SUB_BITS));
+}
+
+CalcStatsTimer calc_stats_begin(CalcOp op) {
+    StatsShard* shard = stats_shard;
+    CalcStatsTimer timer;
+    uint64_t calls;
+
+    timer.start = 0;
+    timer.op = op;
+    if ((unsigned)op >= CALC_OP_COUNT) return timer;
+    if (shard == NULL && (shard = attach_shard()) == NULL) return timer;
+    calls = shard->calls[op]++;
+    if (calls < STATS_TIME_FIRST || calls % STATS_SAMPLE_PERIOD == 0) timer.start = stats_clock();
+    return timer;
+}
+
+void calc_stats_end(const CalcStatsTimer* timer, CalcStatus status) {
+    uint64_t ticks = timer->start != 0 ? stats_clock() - timer->start : 0; // Before any bookkeeping
+    StatsShard* shard = stats_shard;
+    StatsTable* table;
+    CalcOp op = timer->op;
+
+    // No shard if calc_stats_begin() ran out of memory
+    if ((unsigned)op >= CALC_OP_COUNT || (unsigned)status >= STATS_STATUSES || shard == NULL) return;
+    table = &shard->table;
+    COUNTER_ADD(table->counts[op][status], 1);
+    if (timer->start == 0) return;
+    COUNTER_ADD(table->ticks[op], ticks);
+    if (ticks > table->max_ticks[op]) COUNTER_SET(table->max_ticks[op], ticks);
+    COUNTER_ADD(table->buckets[op][bucket_of(ticks)], 1);
+}
+
+
+// --- Dumps ---
+
+/**
+ * @brief Returns the stats_clock() ticks per nanosecond, measured over 10 ms (only dumps need
+ * it, so recording never converts).
+ */
+static double ticks_per_ns(void) {
+#if defined(__x86_64__) || defined(_M_X64)
+    double start_ns = monotonic_ns(), end_ns;
+    uint64_t start = stats_clock();
+    do {
+        end_ns = monotonic_ns();
+    } while (end_ns - start_ns < 1e7);
+    return (double)(stats_clock() - start) / (end_ns - start_ns);
+#else
+    return 1.0;
+#endif
+}
+
+/**
+ * @brief Sums the tables of all shards into merged (a snapshot: threads may still be recording).
+ */
+static void merge_shards(StatsTable* merged) {
+    memset(merged, 0, sizeof(StatsTable));
+    for (StatsShard* shard = registry_head(); shard != NULL; shard = shard->next) {
+        const StatsTable* table = &shard->table;
+        for (int op = 0; op < CALC_OP_COUNT; op++) {
+            uint64_t max = COUNTER_READ(table->max_ticks[op]);
+            for (int s = 0; s < STATS_STATUSES; s++) merged->counts[op][s] += COUNTER_READ(table->counts[op][s]);
+            merged->ticks[op] += COUNTER_READ(table->ticks[op]);
+            if (max > merged->max_ticks[op]) merged->max_ticks[op] = max;
+            for (size_t b = 0; b < STATS_BUCKETS; b++) merged->buckets[op][b] += COUNTER_READ(table->buckets[op][b]);
+        }
+    }
+}
+
+/**
+ * @brief Merges the shards into a new table and measures the clock rate.
+ * @return The table (release with free()), or NULL if out of memory.
+ */
+static StatsTable* snapshot(double* ticks_ns) {
+    StatsTable* merged = (StatsTable*)malloc(sizeof(StatsTable));
+    if (merged == NULL) return NULL;
+    merge_shards(merged);
+    *ticks_ns = ticks_per_ns();
+    return merged;
+}
+
+static uint64_t operation_count(const StatsTable* table, int op) {
+    uint64_t count = 0;
+    for (int s = 0; s < STATS_STATUSES; s++) count += table->counts[op][s];
+    return count;
+}
+
+/**
+ * @brief Returns the duration in ticks below which a fraction q of the operations completed,
+ * from the histogram (the count is taken from it too, as a snapshot may be mid-record), at most
+ * the maximum.
+ */
+static double quantile(const StatsTable* table, int op, double q) {
+    double max = (double)table->max_ticks[op];
+    uint64_t total = 0, seen = 0, rank;
+    for (size_t b = 0; b < STATS_BUCKETS; b++) total += table->buckets[op][b];
+    if (total == 0) return 0.0;
+    rank = (uint64_t)(q * (double)total + 0.5);
+    if (rank == 0) rank = 1;
+    for (size_t b = 0; b < STATS_BUCKETS; b++) {
+        seen += table->buckets[op][b];
+        if (seen >= rank) return bucket_middle(b) < max ? bucket_middle(b) : max;
+    }
+    return max;
+}
+
+// Upper bounds of the Prometheus histogram buckets, in seconds (the fine buckets are summed)
+static const double prometheus_bounds[] = {
+    1e-8, 2.5e-8, 5e-8, 1e-7, 2.5e-7, 5e-7, 1e-6, 2.5e-6, 5e-6, 1e-5, 1e-4, 1e-3, 1e-2, 0.1, 1.0, 10.0
+};
+
+void calc_stats_write_prometheus(FILE* out) {
+    double ticks_ns;
+    StatsTable* table = snapshot(&ticks_ns);
+    if (table == NULL) return;
+
+    fprintf(out, "# HELP calc_operations_total Operations run, by final status.\n");
+    fprintf(out, "# TYPE calc_operations_total counter\n");
+    for (int op = 0; op < CALC_OP_COUNT; op++) {
+        if (operation_count(table, op) == 0) continue;
+        for (int s = 0; s < STATS_STATUSES; s++) {
+            if (s != CALC_OK && table->counts[op][s] == 0) continue;
+            fprintf(out, "calc_operations_total{op=\"%s\",status=\"%s\"} %llu\n",
+                op_names[op], status_names[s], (unsigned long long)table->counts[op][s]);
+        }
+    }
+
+    fprintf(out, "# HELP calc_operation_duration_seconds Duration of the operations.\n");
+    fprintf(out, "# TYPE calc_operation_duration_seconds histogram\n");
+    for (int op = 0; op < CALC_OP_COUNT; op++) {
+        uint64_t cumulative = 0;
+        size_t b = 0;
+        if (operation_count(table, op) == 0) continue;
+        for (size_t i = 0; i < sizeof(prometheus_bounds) / sizeof(prometheus_bounds[0]); i++) {
+            double bound = prometheus_bounds[i] * 1e9 * ticks_ns;
+            for (; b < STATS_BUCKETS && bucket_middle(b) <= bound; b++) cumulative += table->buckets[op][b];
+            fprintf(out, "calc_operation_duration_seconds_bucket{op=\"%s\",le=\"%g\"} %llu\n",
+                op_names[op], prometheus_bounds[i], (unsigned long long)cumulative);
+        }
+        for (; b < STATS_BUCKETS; b++) cumulative += table->buckets[op][b];
+        fprintf(out, "calc_operation_duration_seconds_bucket{op=\"%s\",le=\"+Inf\"} %llu\n",
+            op_names[op], (unsigned long long)cumulative);
+        fprintf(out, "calc_operation_duration_seconds_sum{op=\"%s\"} %.9g\n",
+            op_names[op], (double)table->ticks[op] / ticks_ns * 1e-9);
+        fprintf(out, "calc_operation_duration_seconds_count{op=\"%s\"} %llu\n",
+            op_names[op], (unsigned long long)cumulative);
+    }
+    free(table);
+}
+
+void calc_stats_write_json(FILE* out) {
+    double ticks_ns;
+    int first = 1;
+    StatsTable* table = snapshot(&ticks_ns);
+    if (table == NULL) return;
+
+    fprintf(out, "{\n  \"operations\": [");
+    for (int op = 0; op < CALC_OP_COUNT; op++) {
+        uint64_t count = operation_count(table, op), sampled = 0;
+        int first_failure = 1;
+        if (count == 0) continue;
+        for (size_t b = 0; b < STATS_BUCKETS; b++) sampled += table->buckets[op][b];
+
+        fprintf(out, "%s\n    { \"op\": \"%s\", \"count\": %llu, \"failures\": {", first ? "" : ",",
+            op_names[op], (unsigned long long)count);
+        for (int s = CALC_OK + 1; s < STATS_STATUSES; s++) {
+            if (table->counts[op][s] == 0) continue;
+            fprintf(out, "%s \"%s\": %llu", first_failure ? "" : ",", status_names[s], (unsigned long long)table->counts[op][s]);
+            first_failure = 0;
+        }
+        fprintf(out, "%s}, \"sampled\": %llu, \"latency_ns\": { \"mean\": %.4g, \"p50\": %.4g, \"p90\": %.4g, \"p99\": %.4g, \"p999\": %.4g, \"max\": %.4g } }",
+            first_failure ? "" : " ", (unsigned long long)sampled,
+            sampled != 0 ? (double)table->ticks[op] / (double)sampled / ticks_ns : 0.0,
+            quantile(table, op, 0.5) / ticks_ns, quantile(table, op, 0.9) / ticks_ns,
+            quantile(table, op, 0.99) / ticks_ns, quantile(table, op, 0.999) / ticks_ns,
+            (double)table->max_ticks[op] / ticks_ns);
+        first = 0;
+    }
+    fprintf(out, "%s]\n}\n", first ? "" : "\n  ");
+    free(table);
+}
+
+int calc_stats_enabled(void) { return 1; }
+
+
+// --- SIGUSR1 ---
+
+#if defined(_WIN32) || defined(CALC_NO_THREADS)
+
+int calc_stats_watch_signal(void) { return 0; } // No SIGUSR1, or no thread to wait for it
+
+#else
+
+static sigset_t stats_signals;
+
+/*
+ * Formatting a dump is not async-signal-safe, so there is no signal handler: the signal stays
+ * blocked and this thread takes it with sigwait(), then dumps like any other thread would.
+ */
+static void signal_thread(void* arg) {
+    (void)arg;
+    for (;;) {
+        int signal;
+        if (sigwait(&stats_signals, &signal) != 0) continue;
+        flockfile(stderr); // Keep the dump in one piece between batch error messages
+        calc_stats_write_prometheus(stderr);
+        calc_stats_write_json(stderr);
+        fflush(stderr);
+        funlockfile(stderr);
+    }
+}
+
+int calc_stats_watch_signal(void) {
+    sigemptyset(&stats_signals);
+    sigaddset(&stats_signals, SIGUSR1);
+    // Blocked before the thread starts, so that it and every later thread inherit the mask
+    if (pthread_sigmask(SIG_BLOCK, &stats_signals, NULL) != 0) return 0;
+    if (calc_thread_start(signal_thread, NULL) == NULL) {
+        pthread_sigmask(SIG_UNBLOCK, &stats_signals, NULL);
+        return 0;
+    }
+    return 1; // The thread is never joined; it ends with the process
+}
+
+#endif
+
+#endif // CALC_NO_STATS
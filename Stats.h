@@ -0,0 +1,92 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "CalcCore.h"
+
+/*
+ * Operation statistics of the front ends: how often every operation ran, how it ended (by
+ * CalcStatus) and an HDR-style latency histogram (16 linear sub-buckets per power of two, so
+ * quantiles are within 6.25%) of a sample of the calls, timed with the CPU time stamp counter
+ * where there is one. Every thread records into its own shard without atomics or locks;
+ * the shards are linked into a list that a dump walks and merges, also while they are updated.
+ * A dump is written in the Prometheus text format or as JSON, from the Statistics menu or on
+ * SIGUSR1 (see calc_stats_watch_signal()).
+ *
+ * With CALC_NO_STATS defined, CALC_STATS_BEGIN/CALC_STATS_END expand to nothing, so the
+ * instrumented code is exactly the uninstrumented one, and the dumps are empty.
+ */
+
+// Operations counted by the statistics
+typedef enum {
+    CALC_OP_ADD, CALC_OP_SUBTRACT, CALC_OP_MULTIPLY, CALC_OP_DIVIDE, CALC_OP_REMAINDER,
+    CALC_OP_EXP, CALC_OP_LOG, CALC_OP_ABS, CALC_OP_POWER, CALC_OP_FACTORIAL, CALC_OP_BINOMIAL,
+    CALC_OP_SIN, CALC_OP_COS, CALC_OP_TAN, CALC_OP_COT, CALC_OP_HYPOT,
+    CALC_OP_DEC_TO_BIN, CALC_OP_DEC_TO_HEX, CALC_OP_BIN_TO_DEC, CALC_OP_HEX_TO_DEC,
+    CALC_OP_HEX_TO_BIN, CALC_OP_BIN_TO_HEX, CALC_OP_EXPRESSION,
+    CALC_OP_MATRIX_ADD, CALC_OP_MATRIX_MULTIPLY, CALC_OP_MATRIX_TRANSPOSE, CALC_OP_DOT, CALC_OP_NORM, CALC_OP_SOLVE,
+    CALC_OP_MOD_MULTIPLY, CALC_OP_MOD_POWER, CALC_OP_MOD_INVERSE, CALC_OP_IS_PRIME,
+    CALC_OP_COUNT // Number of operations; also "no operation" for calc_stats_begin()
+} CalcOp;
+
+#if defined(CALC_NO_STATS)
+
+#define CALC_STATS_BEGIN(timer, op)
+#define CALC_STATS_END(timer, status)
+
+#else
+
+// An operation being recorded
+typedef struct {
+    uint64_t start; // Clock at the start, 0 if the duration of this call is not sampled
+    CalcOp op;
+} CalcStatsTimer;
+
+/**
+ * @brief Starts recording an operation of kind op: declares the variable timer.
+ */
+#define CALC_STATS_BEGIN(timer, op) CalcStatsTimer timer = calc_stats_begin(op)
+
+/**
+ * @brief Records the operation started by CALC_STATS_BEGIN(timer, op), which ended with status.
+ */
+#define CALC_STATS_END(timer, status) calc_stats_end(&(timer), (status))
+
+/**
+ * @brief Counts a call of op and decides whether its duration is sampled: the first calls of
+ * every operation in a thread are all timed, later ones one in 16, which keeps the overhead to
+ * a few nanoseconds per call on top of the histograms. CALC_OP_COUNT records nothing.
+ */
+CalcStatsTimer calc_stats_begin(CalcOp op);
+void calc_stats_end(const CalcStatsTimer* timer, CalcStatus status);
+
+#endif
+
+/**
+ * @brief Returns 1 if the statistics are compiled in (CALC_NO_STATS is not defined).
+ */
+int calc_stats_enabled(void);
+
+/**
+ * @brief Writes the merged statistics in the Prometheus text exposition format: the counter
+ * calc_operations_total{op,status} and the histogram calc_operation_duration_seconds{op} (whose
+ * count is that of the sampled calls).
+ */
+void calc_stats_write_prometheus(FILE* out);
+
+/**
+ * @brief Writes the merged statistics as JSON: per operation the count, the failures by status,
+ * the number of sampled calls and their mean, p50, p90, p99, p99.9 and maximum latency in
+ * nanoseconds.
+ */
+void calc_stats_write_json(FILE* out);
+
+/**
+ * @brief Makes SIGUSR1 write both dumps to stderr (POSIX with threads: a thread waits for the
+ * signal, which every other thread blocks). Call it before any other thread is started.
+ * @return 1 if the signal is watched, 0 where this is not supported.
+ */
+int calc_stats_watch_signal(void);
+
+#endif // STATS_H
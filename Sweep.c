@@ -0,0 +1,420 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "BaseConv.h"
+#include "VectorMath.h"
+#include "Thread.h"
+#include "Format.h"
+#include "Parse.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+/*
+ * Range sweeps ("--sweep"): one function tabulated at start, start + step, ... up to end, written
+ * as text lines "<x>\t<f(x)>" or as raw doubles. The points are cut into blocks that
+ * calc_thread_count() threads generate and format in parallel; the blocks are written in order.
+ *
+ * Trigonometric functions come from sincos_deg_step_n() (angle addition from exact anchors),
+ * exp/log/pow and expressions from the bulk kernels, and dec2bin/dec2hex over a non-negative,
+ * increasing range from digit counters that add the step to the previous text instead of
+ * converting every value. At another precision than double (--precision) the functions other
+ * than dec2bin/dec2hex are evaluated as expressions by expr_eval_prec_many().
+ */
+
+// Points generated and formatted as one unit by a thread (a multiple of the 256 angles between
+// the anchors of sincos_deg_step_n(), so that blocks give the results of a single call)
+#define SWEEP_BLOCK_POINTS 16384
+// Blocks per thread and window (calc_parallel_for() evens out the formatting of slow blocks)
+#define SWEEP_BLOCKS_PER_THREAD 4
+// Size of the output stream buffer
+#define SWEEP_IO_BUFFER_SIZE (1 << 20)
+// Longest text line: two format_fixed() values, a tab and a newline
+#define SWEEP_LINE_MAX (2 * (CALC_FIXED_MAX_CHARS + 1))
+// Digits of a counter: a 64-bit value in binary
+#define SWEEP_COUNTER_DIGITS CALC_BIN_MAX_DIGITS
+// Most decimals printed for x, for steps such as 0.001 that need more than the results' 4
+#define SWEEP_X_DECIMALS_MAX 10
+
+typedef enum {
+    SWEEP_SIN, SWEEP_COS, SWEEP_TAN, SWEEP_COT, // Angle addition (sincos_deg_step_n())
+    SWEEP_EXP, SWEEP_LOG, SWEEP_POW,            // Bulk kernels of VectorMath.c
+    SWEEP_EXPRESSION,                           // "= <expression>" with R = x (and P = --arg)
+    SWEEP_DEC2BIN, SWEEP_DEC2HEX                // Integers, through digit counters
+} SweepFunction;
+
+static const struct {
+    const char* name;
+    SweepFunction function;
+    const char* expression; // The function as an expression of R = x and P = Y, for --precision
+} sweep_functions[] = {
+    { "sin", SWEEP_SIN, "sin(R)" }, { "cos", SWEEP_COS, "cos(R)" }, { "tan", SWEEP_TAN, "tan(R)" },
+    { "cot", SWEEP_COT, "cot(R)" }, { "exp", SWEEP_EXP, "exp(R)" }, { "log", SWEEP_LOG, "log(R)" },
+    { "pow", SWEEP_POW, "R ^ P" }, { "dec2bin", SWEEP_DEC2BIN, NULL }, { "dec2hex", SWEEP_DEC2HEX, NULL }
+};
+
+static const char sweep_digits[] = "0123456789ABCDEF";
+
+/**
+ * @brief Text of a non-negative integer in base 2, 10 or 16, right-aligned in digits.
+ */
+typedef struct {
+    char digits[SWEEP_COUNTER_DIGITS];
+    int first; // Index of the most significant digit
+} SweepCounter;
+
+/**
+ * @brief Base digits of a step, least significant first, for counter_add().
+ */
+typedef struct {
+    unsigned char digits[SWEEP_COUNTER_DIGITS];
+    int count;
+    unsigned base;
+} SweepIncrement;
+
+static void counter_set(SweepCounter* counter, unsigned long long value, unsigned base) {
+    int i = SWEEP_COUNTER_DIGITS;
+    do {
+        counter->digits[--i] = sweep_digits[value % base];
+        value /= base;
+    } while (value > 0);
+    counter->first = i;
+}
+
+static void increment_set(SweepIncrement* increment, unsigned long long step, unsigned base) {
+    increment->count = 0;
+    increment->base = base;
+    do {
+        increment->digits[increment->count++] = (unsigned char)(step % base);
+        step /= base;
+    } while (step > 0);
+}
+
+/**
+ * @brief Adds the step to the text of the counter, from the last digit until the carry stops
+ * (once per base^k additions of a step of 1 it goes past the first digit).
+ */
+static void counter_add(SweepCounter* counter, const SweepIncrement* increment) {
+    unsigned carry = 0;
+    for (int k = 0, i = SWEEP_COUNTER_DIGITS - 1; k < increment->count || carry; k++, i--) {
+        char c = i >= counter->first ? counter->digits[i] : '0';
+        unsigned digit = (unsigned)(c <= '9' ? c - '0' : c - 'A' + 10) + (k < increment->count ? increment->digits[k] : 0) + carry;
+        carry = digit >= increment->base;
+        counter->digits[i] = sweep_digits[carry ? digit - increment->base : digit];
+        if (i < counter->first) counter->first = i;
+    }
+}
+
+/**
+ * @brief A block of points and its output.
+ */
+typedef struct {
+    size_t first, count;     // Indices of the points
+    double* values;          // f(x)
+    double* scratch;         // x (or the cosines)
+    char* text;
+    size_t text_len, text_capacity;
+    int no_memory;
+} SweepBlock;
+
+typedef struct {
+    SweepFunction function;
+    double start, step, arg;
+    CompiledExpr* expr;
+    CalcPrecision precision; // Of the expression
+    const double* args;      // SWEEP_BLOCK_POINTS copies of arg (exponents for pow, P for expressions)
+    int binary;
+    int x_decimals;
+    int counters;            // dec2bin/dec2hex over a non-negative, increasing range
+    SweepIncrement value_step, id_step;
+    SweepBlock* blocks;
+} SweepRun;
+
+static char* block_reserve(SweepBlock* block, size_t extra) {
+    if (block->text_len + extra > block->text_capacity) {
+        size_t capacity = block->text_capacity ? block->text_capacity : 1 << 16;
+        char* text;
+        while (capacity < block->text_len + extra) capacity *= 2;
+        text = (char*)realloc(block->text, capacity);
+        if (text == NULL) { block->no_memory = 1; return NULL; }
+        block->text = text;
+        block->text_capacity = capacity;
+    }
+    return block->text + block->text_len;
+}
+
+static void format_integers(SweepRun* run, SweepBlock* block) {
+    long long start = (long long)run->start, step = (long long)run->step;
+    unsigned base = run->function == SWEEP_DEC2BIN ? 2 : 16;
+    SweepCounter id, value;
+
+    if (run->counters) {
+        unsigned long long first = (unsigned long long)start + block->first * (unsigned long long)step;
+        counter_set(&id, first, 10);
+        counter_set(&value, first, base);
+    }
+    for (size_t i = 0; i < block->count; i++) {
+        char* line = block_reserve(block, SWEEP_LINE_MAX);
+        size_t len;
+        if (line == NULL) return;
+        if (run->counters) {
+            if (i > 0) {
+                counter_add(&id, &run->id_step);
+                counter_add(&value, &run->value_step);
+            }
+            len = (size_t)(SWEEP_COUNTER_DIGITS - id.first);
+            memcpy(line, id.digits + id.first, len);
+            line[len++] = '\t';
+            memcpy(line + len, value.digits + value.first, (size_t)(SWEEP_COUNTER_DIGITS - value.first));
+            len += (size_t)(SWEEP_COUNTER_DIGITS - value.first);
+        }
+        else {
+            long long x = start + (long long)(block->first + i) * step;
+            len = format_dec(x, line);
+            line[len++] = '\t';
+            len += run->function == SWEEP_DEC2BIN ? calc_dec_to_bin(x, line + len) : calc_dec_to_hex(x, line + len);
+        }
+        line[len++] = '\n';
+        block->text_len += len;
+    }
+}
+
+static void format_values(const SweepRun* run, SweepBlock* block) {
+    for (size_t i = 0; i < block->count; i++) {
+        double x = run->start + (double)(block->first + i) * run->step, y = block->values[i];
+        char* line = block_reserve(block, SWEEP_LINE_MAX);
+        size_t len;
+        if (line == NULL) return;
+        len = format_fixed(x, run->x_decimals, line);
+        line[len++] = '\t';
+        // Failed points read "nan" like in batch mode (whatever the sign of the NAN)
+        if (isnan(y)) {
+            memcpy(line + len, "nan", 3);
+            len += 3;
+        }
+        else {
+            len += format_result(y, line + len);
+        }
+        line[len++] = '\n';
+        block->text_len += len;
+    }
+}
+
+static void sweep_block(void* context, size_t task, int worker) {
+    SweepRun* run = (SweepRun*)context;
+    SweepBlock* block = &run->blocks[task];
+    double* y = block->values;
+    double* x = block->scratch;
+    size_t n = block->count;
+    (void)worker;
+
+    block->text_len = 0;
+    switch (run->function) {
+    case SWEEP_DEC2BIN:
+    case SWEEP_DEC2HEX:
+        format_integers(run, block);
+        return;
+    case SWEEP_SIN:
+    case SWEEP_COS:
+    case SWEEP_TAN:
+    case SWEEP_COT: {
+        double* sine = y;
+        double* cosine = x;
+        sincos_deg_step_n(run->start, run->step, block->first, sine, cosine, n);
+        if (run->function == SWEEP_COS) {
+            memcpy(y, cosine, n * sizeof(double));
+        }
+        else if (run->function != SWEEP_SIN) {
+            // Like tan_deg_n()/cot_deg_n(): NAN where the denominator is 0, exact zeros as +0
+            for (size_t i = 0; i < n; i++) {
+                double num = run->function == SWEEP_TAN ? sine[i] : cosine[i];
+                double den = run->function == SWEEP_TAN ? cosine[i] : sine[i];
+                y[i] = den == 0 ? NAN : num == 0 ? 0.0 : num / den;
+            }
+        }
+        break;
+    }
+    default:
+        for (size_t i = 0; i < n; i++) x[i] = run->start + (double)(block->first + i) * run->step;
+        if (run->function == SWEEP_EXP) exp_n(x, y, n, CALC_MATH_ACCURATE);
+        else if (run->function == SWEEP_LOG) log_n(x, y, n, CALC_MATH_ACCURATE, NULL);
+        else if (run->function == SWEEP_POW) pow_n(x, run->args, y, n, CALC_MATH_ACCURATE);
+        else expr_eval_prec_many(run->expr, run->precision, x, run->args, y, n);
+        break;
+    }
+    if (!run->binary) format_values(run, block);
+}
+
+/**
+ * @brief Decimals needed to show x exactly for a start and step such as 0.25 or 0.001 (at least
+ * the 4 of the results when neither is a short decimal).
+ */
+static int x_decimals(double start, double step) {
+    double scale = 1;
+    for (int decimals = 0; decimals <= SWEEP_X_DECIMALS_MAX; decimals++, scale *= 10) {
+        double a = start * scale, b = step * scale;
+        if (fabs(a - nearbyint(a)) <= 1e-9 * fmax(1, fabs(a)) && fabs(b - nearbyint(b)) <= 1e-9 * fmax(1, fabs(b))) {
+            return decimals;
+        }
+    }
+    return 4;
+}
+
+static void print_sweep_usage(void) {
+    printf("Usage: --sweep FUNCTION START END STEP [--arg Y] [--output FILE] [--binary] [--precision MODE]\n");
+    printf("       FUNCTION: sin cos tan cot (degrees), exp log pow (x^Y), dec2bin dec2hex,\n");
+    printf("                 or \"= EXPRESSION\" of R = x and P = Y\n");
+    printf("       MODE: f32 f64 f80 f128 (default f64, or CALC_PRECISION)\n");
+}
+
+/**
+ * @brief Tabulates a function from START to END (included) in steps of STEP: text lines
+ * "<x>\t<f(x)>" with the results in format_result() ("nan" where the function is undefined), or with
+ * --binary the raw native-endian doubles f(x), 8 bytes per point and nothing else.
+ * --arg Y is the exponent of pow and the P of an expression (default 2 for pow, 0 otherwise).
+ * --precision computes the function at another precision than double (see Precision.h).
+ * @return 0 on success, 1 on a usage error or if the output cannot be written.
+ */
+int run_sweep(int argc, char* argv[]) {
+    SweepRun run;
+    const char* output = NULL;
+    double end, span, points;
+    size_t count, window, blocks = 0;
+    int arg_given = 0, status = 0, threads = calc_thread_count();
+    const char* error = NULL;
+    const char* source = NULL;
+    double* args = NULL;
+    FILE* out = stdout;
+
+    memset(&run, 0, sizeof(run));
+    run.precision = calc_precision_default();
+    if (argc < 4) { print_sweep_usage(); return 1; }
+    for (int i = 4; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--binary") == 0) { run.binary = 1; continue; }
+        if (value == NULL) { print_sweep_usage(); return 1; }
+        if (strcmp(argv[i], "--arg") == 0) {
+            if (!parse_cli_number("--arg", value, &run.arg)) return 1;
+            arg_given = 1;
+        }
+        else if (strcmp(argv[i], "--output") == 0) output = value;
+        else if (strcmp(argv[i], "--precision") == 0) {
+            if (!calc_precision_parse(value, &run.precision)) { print_sweep_usage(); return 1; }
+        }
+        else { print_sweep_usage(); return 1; }
+        i++;
+    }
+
+    if (!parse_cli_number("START", argv[1], &run.start) || !parse_cli_number("END", argv[2], &end) ||
+        !parse_cli_number("STEP", argv[3], &run.step)) {
+        return 1;
+    }
+
+    if (argv[0][0] == '=') source = argv[0] + 1;
+    else {
+        size_t f = 0;
+        while (f < sizeof(sweep_functions) / sizeof(sweep_functions[0]) && strcmp(sweep_functions[f].name, argv[0]) != 0) f++;
+        if (f == sizeof(sweep_functions) / sizeof(sweep_functions[0])) { print_sweep_usage(); return 1; }
+        run.function = sweep_functions[f].function;
+        if (run.precision != CALC_PRECISION_F64) source = sweep_functions[f].expression;
+    }
+    if (run.function == SWEEP_POW && !arg_given) run.arg = 2;
+    if (source != NULL) {
+        ExprError error;
+        run.function = SWEEP_EXPRESSION;
+        if (run.precision == CALC_PRECISION_F64) run.expr = expr_compile(source, &error);
+        else run.expr = expr_compile_unfolded(source, NULL, NULL, &error); // Not folded in double
+        if (run.expr == NULL) {
+            fprintf(stderr, "Error: %s at column %zu.\n", error.message, error.position + 1);
+            return 1;
+        }
+        if (run.precision == CALC_PRECISION_F64) expr_jit(run.expr);
+    }
+
+    span = (end - run.start) / run.step;
+    // The end is included when it is a whole number of steps away, up to rounding
+    points = floor(span + 1e-9 * fmax(1, fabs(span))) + 1;
+    if (!isfinite(span) || span < 0 || run.step == 0 || points > 0x1p53) {
+        fprintf(stderr, "Error: Invalid range (STEP must lead from START to END).\n");
+        expr_free(run.expr);
+        return 1;
+    }
+    count = (size_t)points;
+
+    if (run.function == SWEEP_DEC2BIN || run.function == SWEEP_DEC2HEX) {
+        double last = run.start + (points - 1) * run.step;
+        if (run.binary || run.start != trunc(run.start) || run.step != trunc(run.step) || fabs(run.start) > 0x1p53 ||
+            fabs(last) > 0x1p53) {
+            fprintf(stderr, "Error: %s needs integer START and STEP up to 2^53, and text output.\n", argv[0]);
+            return 1;
+        }
+        run.counters = run.start >= 0 && run.step > 0;
+        if (run.counters) {
+            increment_set(&run.id_step, (unsigned long long)run.step, 10);
+            increment_set(&run.value_step, (unsigned long long)run.step, run.function == SWEEP_DEC2BIN ? 2 : 16);
+        }
+    }
+    run.x_decimals = x_decimals(run.start, run.step);
+
+    window = (size_t)threads * SWEEP_BLOCKS_PER_THREAD;
+    run.blocks = (SweepBlock*)calloc(window, sizeof(SweepBlock));
+    args = (double*)malloc(SWEEP_BLOCK_POINTS * sizeof(double));
+    status = run.blocks == NULL || args == NULL;
+    for (size_t b = 0; b < window && !status; b++) {
+        run.blocks[b].values = (double*)malloc(SWEEP_BLOCK_POINTS * sizeof(double));
+        run.blocks[b].scratch = (double*)malloc(SWEEP_BLOCK_POINTS * sizeof(double));
+        status = run.blocks[b].values == NULL || run.blocks[b].scratch == NULL;
+    }
+    if (status) fprintf(stderr, "Error: Out of memory.\n");
+    else {
+        for (size_t i = 0; i < SWEEP_BLOCK_POINTS; i++) args[i] = run.arg;
+        run.args = args;
+    }
+
+    if (!status && output != NULL) {
+        out = fopen(output, run.binary ? "wb" : "w");
+        if (out == NULL) {
+            fprintf(stderr, "Error: Cannot create '%s'.\n", output);
+            status = 1;
+        }
+    }
+#if defined(_WIN32)
+    if (!status && output == NULL && run.binary) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+    if (!status) {
+        setvbuf(out, NULL, _IOFBF, SWEEP_IO_BUFFER_SIZE);
+        for (size_t first = 0; first < count && !status; first += blocks * SWEEP_BLOCK_POINTS) {
+            blocks = 0;
+            for (size_t p = first; p < count && blocks < window; p += SWEEP_BLOCK_POINTS, blocks++) {
+                run.blocks[blocks].first = p;
+                run.blocks[blocks].count = count - p < SWEEP_BLOCK_POINTS ? count - p : SWEEP_BLOCK_POINTS;
+            }
+            calc_parallel_for(blocks, sweep_block, &run);
+            for (size_t b = 0; b < blocks && error == NULL; b++) {
+                const SweepBlock* block = &run.blocks[b];
+                if (block->no_memory) error = "Out of memory";
+                else if (run.binary && fwrite(block->values, sizeof(double), block->count, out) != block->count) error = "Cannot write the output";
+                else if (!run.binary && fwrite(block->text, 1, block->text_len, out) != block->text_len) error = "Cannot write the output";
+            }
+            status = error != NULL;
+        }
+        if (error == NULL && (fflush(out) != 0 || ferror(out))) error = "Cannot write the output";
+        if (error != NULL) {
+            fprintf(stderr, "Error: %s.\n", error);
+            status = 1;
+        }
+        if (output != NULL) fclose(out);
+    }
+
+    for (size_t b = 0; run.blocks != NULL && b < window; b++) {
+        free(run.blocks[b].values);
+        free(run.blocks[b].scratch);
+        free(run.blocks[b].text);
+    }
+    free(run.blocks);
+    free(args);
+    expr_free(run.expr);
+    return status;
+}
@@ -0,0 +1,259 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdlib.h>
+#include <stdint.h>
+#include "Thread.h"
+
+#if defined(CALC_NO_THREADS)
+// Nothing to include
+#elif defined(_WIN32)
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+// Upper bound for CALC_THREADS, to keep a typo from creating thousands of threads
+#define CALC_MAX_THREADS 256
+
+struct CalcThread {
+#if defined(CALC_NO_THREADS)
+    int unused;
+#elif defined(_WIN32)
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    CalcThreadFn fn;
+    void* arg;
+};
+
+#if defined(CALC_NO_THREADS)
+
+CalcThread* calc_thread_start(CalcThreadFn fn, void* arg) {
+    (void)fn;
+    (void)arg;
+    return NULL; // The caller runs fn itself
+}
+
+void calc_thread_join(CalcThread* thread) {
+    (void)thread;
+}
+
+#elif defined(_WIN32)
+
+static unsigned __stdcall thread_entry(void* param) {
+    CalcThread* thread = (CalcThread*)param;
+    thread->fn(thread->arg);
+    return 0;
+}
+
+CalcThread* calc_thread_start(CalcThreadFn fn, void* arg) {
+    CalcThread* thread = (CalcThread*)malloc(sizeof(CalcThread));
+    if (thread == NULL) return NULL;
+    thread->fn = fn;
+    thread->arg = arg;
+    thread->handle = (HANDLE)_beginthreadex(NULL, 0, thread_entry, thread, 0, NULL);
+    if (thread->handle == NULL) { free(thread); return NULL; }
+    return thread;
+}
+
+void calc_thread_join(CalcThread* thread) {
+    if (thread == NULL) return;
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+
+#else
+
+static void* thread_entry(void* param) {
+    CalcThread* thread = (CalcThread*)param;
+    thread->fn(thread->arg);
+    return NULL;
+}
+
+CalcThread* calc_thread_start(CalcThreadFn fn, void* arg) {
+    CalcThread* thread = (CalcThread*)malloc(sizeof(CalcThread));
+    if (thread == NULL) return NULL;
+    thread->fn = fn;
+    thread->arg = arg;
+    if (pthread_create(&thread->handle, NULL, thread_entry, thread) != 0) { free(thread); return NULL; }
+    return thread;
+}
+
+void calc_thread_join(CalcThread* thread) {
+    if (thread == NULL) return;
+    pthread_join(thread->handle, NULL);
+    free(thread);
+}
+
+#endif
+
+/**
+ * @brief Number of CPUs available to the process.
+ */
+static int online_cpus(void) {
+#if defined(CALC_NO_THREADS)
+    return 1;
+#elif defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+int calc_thread_count(void) {
+    // Like calc_simd_level(), a race between threads only repeats the work
+    static volatile int cached = 0;
+    if (cached == 0) {
+        int count = online_cpus();
+        const char* requested = getenv("CALC_THREADS");
+        if (requested != NULL && atoi(requested) > 0) count = atoi(requested);
+        if (count > CALC_MAX_THREADS) count = CALC_MAX_THREADS;
+#if defined(CALC_NO_THREADS)
+        count = 1;
+#endif
+        cached = count;
+    }
+    return cached;
+}
+
+
+// --- Work-stealing parallel loop ---
+
+#if defined(CALC_NO_THREADS)
+
+void calc_parallel_for(size_t count, CalcTaskFn fn, void* context) {
+    for (size_t task = 0; task < count; task++) fn(context, task, 0);
+}
+
+#else
+
+/*
+ * Every worker owns a share [head, tail) of the task indices, packed into one 64-bit word (head in
+ * the low half) so that the owner taking tasks from the head and thieves cutting off the tail can
+ * both update it with a single compare-and-swap. Shares only shrink, except that an idle worker
+ * installs the range it stole into its own (empty) word, so no range is ever handed out twice.
+ */
+
+#if defined(_WIN32)
+typedef volatile LONG64 TaskRange;
+static uint64_t range_load(TaskRange* range) { return (uint64_t)InterlockedCompareExchange64(range, 0, 0); }
+static void range_store(TaskRange* range, uint64_t value) { InterlockedExchange64(range, (LONG64)value); }
+static int range_cas(TaskRange* range, uint64_t expected, uint64_t desired) {
+    return InterlockedCompareExchange64(range, (LONG64)desired, (LONG64)expected) == (LONG64)expected;
+}
+#else
+typedef uint64_t TaskRange;
+static uint64_t range_load(TaskRange* range) { return __atomic_load_n(range, __ATOMIC_ACQUIRE); }
+static void range_store(TaskRange* range, uint64_t value) { __atomic_store_n(range, value, __ATOMIC_RELEASE); }
+static int range_cas(TaskRange* range, uint64_t expected, uint64_t desired) {
+    return __atomic_compare_exchange_n(range, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+#endif
+
+#define RANGE(head, tail) ((uint64_t)(head) | (uint64_t)(tail) << 32)
+#define RANGE_HEAD(range) ((uint32_t)(range))
+#define RANGE_TAIL(range) ((uint32_t)((range) >> 32))
+
+typedef struct {
+    TaskRange range;
+    char padding[64 - sizeof(TaskRange)]; // One cache line per worker
+} TaskShare;
+
+typedef struct {
+    TaskShare* shares;
+    int workers;
+    CalcTaskFn fn;
+    void* context;
+} TaskPool;
+
+typedef struct {
+    TaskPool* pool;
+    int index;
+    CalcThread* thread;
+} TaskWorker;
+
+/**
+ * @brief Takes the next task of a share; returns 0 if it is empty.
+ */
+static int take_task(TaskRange* range, size_t* task) {
+    for (;;) {
+        uint64_t current = range_load(range);
+        uint32_t head = RANGE_HEAD(current), tail = RANGE_TAIL(current);
+        if (head >= tail) return 0;
+        if (range_cas(range, current, RANGE(head + 1, tail))) {
+            *task = head;
+            return 1;
+        }
+    }
+}
+
+/**
+ * @brief Moves the upper half of another worker's share into the (empty) share of worker index.
+ * @return 0 if every other share was empty.
+ */
+static int steal_tasks(TaskPool* pool, int index) {
+    for (int k = 1; k < pool->workers; k++) {
+        TaskRange* victim = &pool->shares[(index + k) % pool->workers].range;
+        for (;;) {
+            uint64_t current = range_load(victim);
+            uint32_t head = RANGE_HEAD(current), tail = RANGE_TAIL(current);
+            uint32_t split = tail - (tail - head + 1) / 2;
+            if (head >= tail) break;
+            if (range_cas(victim, current, RANGE(head, split))) {
+                range_store(&pool->shares[index].range, RANGE(split, tail));
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void task_worker_run(void* arg) {
+    TaskWorker* worker = (TaskWorker*)arg;
+    TaskPool* pool = worker->pool;
+    size_t task;
+
+    // A worker whose thread could not start simply never runs: its share gets stolen
+    do {
+        while (take_task(&pool->shares[worker->index].range, &task)) pool->fn(pool->context, task, worker->index);
+    } while (steal_tasks(pool, worker->index));
+}
+
+void calc_parallel_for(size_t count, CalcTaskFn fn, void* context) {
+    int workers = calc_thread_count();
+    TaskPool pool;
+    TaskWorker* team;
+
+    if ((size_t)workers > count) workers = (int)count;
+    pool.shares = workers > 1 ? (TaskShare*)malloc(workers * sizeof(TaskShare)) : NULL;
+    team = workers > 1 ? (TaskWorker*)malloc(workers * sizeof(TaskWorker)) : NULL;
+    if (pool.shares == NULL || team == NULL) {
+        free(pool.shares);
+        free(team);
+        for (size_t task = 0; task < count; task++) fn(context, task, 0);
+        return;
+    }
+
+    pool.workers = workers;
+    pool.fn = fn;
+    pool.context = context;
+    for (int i = 0; i < workers; i++) {
+        pool.shares[i].range = RANGE(count * i / workers, count * (i + 1) / workers);
+        team[i].pool = &pool;
+        team[i].index = i;
+    }
+    for (int i = 1; i < workers; i++) team[i].thread = calc_thread_start(task_worker_run, &team[i]);
+    task_worker_run(&team[0]);
+    for (int i = 1; i < workers; i++) calc_thread_join(team[i].thread);
+
+    free(pool.shares);
+    free(team);
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <stddef.h>
+
+/*
+ * Minimal portable threads (Win32 or POSIX threads) for the parallel kernels, and a work-stealing
+ * parallel loop on top of them. With CALC_NO_THREADS defined, calc_thread_start() runs nothing
+ * (the caller runs the function itself) and calc_parallel_for() runs every task in the calling thread.
+ */
+
+typedef struct CalcThread CalcThread;
+
+typedef void (*CalcThreadFn)(void* arg);
+
+/**
+ * @brief Starts fn(arg) in a new thread.
+ * @return The thread handle to pass to calc_thread_join(), or NULL if no thread could be created
+ * (in which case fn has not run and the caller is expected to call it directly).
+ */
+CalcThread* calc_thread_start(CalcThreadFn fn, void* arg);
+
+/**
+ * @brief Waits for a thread started by calc_thread_start() and releases its handle.
+ */
+void calc_thread_join(CalcThread* thread);
+
+/**
+ * @brief Returns the number of threads the parallel kernels may use: the number of online CPUs,
+ * or the value of the environment variable CALC_THREADS if set (1 disables threading). Cached.
+ */
+int calc_thread_count(void);
+
+typedef void (*CalcTaskFn)(void* context, size_t task, int worker);
+
+/**
+ * @brief Runs fn(context, task, worker) for every task in [0, count) and returns when all of them
+ * are done. Up to calc_thread_count() workers take part, the calling thread being worker 0, so
+ * worker indices can select per-worker state. Each worker starts with a contiguous share of the
+ * tasks and runs it in increasing order; a worker that runs out steals the upper half of what
+ * remains of another worker's share, which balances tasks of very different cost.
+ * @param count Number of tasks (below 2^32).
+ */
+void calc_parallel_for(size_t count, CalcTaskFn fn, void* context);
+
+#endif // THREAD_H
@@ -0,0 +1,550 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "VectorMath.h"
+#include "Simd.h"
+
+// --- Constants shared by all kernel instantiations ---
+
+#define VM_SHIFT 0x1.8p52                // Adding this rounds to an integer held in the low mantissa bits
+#define VM_INV_LN2 0x1.71547652b82fep0
+#define VM_LN2 0x1.62e42fefa39efp-1
+#define VM_LN2_HI 0x1.62e42feep-1        // 32 significant bits: k * VM_LN2_HI is exact
+#define VM_LN2_LO 0x1.a39ef35793c76p-33
+
+// fdlibm exp: R(r^2) coefficients of the rational approximation, error below 2^-59
+#define EXP_P1 1.66666666666666019037e-01
+#define EXP_P2 -2.77777777770155933842e-03
+#define EXP_P3 6.61375632143793436117e-05
+#define EXP_P4 -1.65339022054652515390e-06
+#define EXP_P5 4.13813679705723846039e-08
+
+// Degree-11 Chebyshev approximation of e^r on [-ln2/2, ln2/2]
+#define EXP_C0 0x1p+0
+#define EXP_C1 0x1p+0
+#define EXP_C2 0x1.0000000000011p-1
+#define EXP_C3 0x1.555555555555ap-3
+#define EXP_C4 0x1.555555554f0bap-5
+#define EXP_C5 0x1.111111110f21ep-7
+#define EXP_C6 0x1.6c16c1880029fp-10
+#define EXP_C7 0x1.a01a01b1461c5p-13
+#define EXP_C8 0x1.a01991a10d9aep-16
+#define EXP_C9 0x1.71ddf56d8deb5p-19
+#define EXP_C10 0x1.28b4101c77212p-22
+#define EXP_C11 0x1.af632a0f7e2cep-26
+
+// log1p(r) Taylor coefficients, |r| < 1/128
+#define LOG_C2 (-0.5)
+#define LOG_C3 (1.0 / 3)
+#define LOG_C4 (-0.25)
+#define LOG_C5 0.2
+#define LOG_C6 (-1.0 / 6)
+#define LOG_C7 (1.0 / 7)
+#define LOG_C8 (-0.125)
+#define LOG_C9 (1.0 / 9)
+#define LOG_C10 (-0.1)
+
+// Largest integral exponent handled by exponentiation by squaring
+#define POW_INT_MAX 64.0
+
+// pi/180 as head + tail, and fdlibm's sin/cos kernel coefficients for |x| <= pi/4
+#define TRIG_DEG_HI 0x1.1df46a2529d39p-6
+#define TRIG_DEG_LO 0x1.5c1d8becdd291p-62
+#define TRIG_S1 (-1.66666666666666324348e-01)
+#define TRIG_S2 8.33333333332248946124e-03
+#define TRIG_S3 (-1.98412698298579493134e-04)
+#define TRIG_S4 2.75573137070700676789e-06
+#define TRIG_S5 (-2.50507602534068634195e-08)
+#define TRIG_S6 1.58969099521155010221e-10
+#define TRIG_C1 4.16666666666666019037e-02
+#define TRIG_C2 (-1.38888888888741095749e-03)
+#define TRIG_C3 2.48015872894767294178e-05
+#define TRIG_C4 (-2.75573143513906633035e-07)
+#define TRIG_C5 2.08757232129817482790e-09
+#define TRIG_C6 (-1.13596475577881948265e-11)
+#define TRIG_COS30 0x1.bb67ae8584caap-1 // sqrt(3)/2, correctly rounded
+#define TRIG_COS45 0x1.6a09e667f3bcdp-1 // sqrt(1/2), correctly rounded
+#define TRIG_TAN30 0x1.279a74590331cp-1 // 1/sqrt(3), correctly rounded
+#define TRIG_TAN60 0x1.bb67ae8584caap+0 // sqrt(3), correctly rounded
+// Angles from one exactly computed anchor to the next in sincos_deg_step_n()
+#define TRIG_STEP_ANCHOR 256
+
+// Mantissas in [1, LOG_SPLIT) are used as is, those in [LOG_SPLIT, 2) are halved
+#define LOG_TABLE_BITS 7
+#define LOG_TABLE_SIZE (1 << LOG_TABLE_BITS)
+#define LOG_SPLIT (1.0 + 53.0 / LOG_TABLE_SIZE)
+
+/*
+ * Entry j covers the mantissas whose top 7 bits are j. invc is 1/c for the centre c of the
+ * (possibly halved) interval, and 1 exactly for the intervals next to 1.0, so that log(x) near 1
+ * has no cancellation. logc + logctail = -log(invc) to 2^-106 (generated with 80-digit arithmetic).
+ */
+static const double log_table_invc[LOG_TABLE_SIZE] = {
+    0x1.0000000000000p+0, 0x1.fa11caa01fa12p-1, 0x1.f6310aca0dbb5p-1, 0x1.f25f644230ab5p-1,
+    0x1.ee9c7f8458e02p-1, 0x1.eae807aba01ebp-1, 0x1.e741aa59750e4p-1, 0x1.e3a9179dc1a73p-1,
+    0x1.e01e01e01e01ep-1, 0x1.dca01dca01dcap-1, 0x1.d92f2231e7f8ap-1, 0x1.d5cac807572b2p-1,
+    0x1.d272ca3fc5b1ap-1, 0x1.cf26e5c44bfc6p-1, 0x1.cbe6d9601cbe7p-1, 0x1.c8b265afb8a42p-1,
+    0x1.c5894d10d4986p-1, 0x1.c26b5392ea01cp-1, 0x1.bf583ee868d8bp-1, 0x1.bc4fd65883e7bp-1,
+    0x1.b951e2b18ff23p-1, 0x1.b65e2e3beee05p-1, 0x1.b37484ad806cep-1, 0x1.b094b31d922a4p-1,
+    0x1.adbe87f94905ep-1, 0x1.aaf1d2f87ebfdp-1, 0x1.a82e65130e159p-1, 0x1.a574107688a4ap-1,
+    0x1.a2c2a87c51ca0p-1, 0x1.a01a01a01a01ap-1, 0x1.9d79f176b682dp-1, 0x1.9ae24ea5510dap-1,
+    0x1.9852f0d8ec0ffp-1, 0x1.95cbb0be377aep-1, 0x1.934c67f9b2ce6p-1, 0x1.90d4f120190d5p-1,
+    0x1.8e6527af1373fp-1, 0x1.8bfce8062ff3ap-1, 0x1.899c0f601899cp-1, 0x1.87427bcc092b9p-1,
+    0x1.84f00c2780614p-1, 0x1.82a4a0182a4a0p-1, 0x1.8060180601806p-1, 0x1.7e225515a4f1dp-1,
+    0x1.7beb3922e017cp-1, 0x1.79baa6bb6398bp-1, 0x1.77908119ac60dp-1, 0x1.756cac201756dp-1,
+    0x1.734f0c541fe8dp-1, 0x1.713786d9c7c09p-1, 0x1.6f26016f26017p-1, 0x1.6d1a62681c861p-1,
+    0x1.6b1490aa31a3dp-1, 0x1.691473a88d0c0p+0, 0x1.6719f3601671ap+0, 0x1.6524f853b4aa3p+0,
+    0x1.63356b88ac0dep+0, 0x1.614b36831ae94p+0, 0x1.5f66434292dfcp+0, 0x1.5d867c3ece2a5p+0,
+    0x1.5babcc647fa91p+0, 0x1.59d61f123ccaap+0, 0x1.5805601580560p+0, 0x1.56397ba7c52e2p+0,
+    0x1.54725e6bb82fep+0, 0x1.52aff56a8054bp+0, 0x1.50f22e111c4c5p+0, 0x1.4f38f62dd4c9bp+0,
+    0x1.4d843bedc2c4cp+0, 0x1.4bd3edda68fe1p+0, 0x1.4a27fad76014ap+0, 0x1.4880522014880p+0,
+    0x1.46dce34596066p+0, 0x1.453d9e2c776cap+0, 0x1.43a2730abee4dp+0, 0x1.420b5265e5951p+0,
+    0x1.40782d10e6566p+0, 0x1.3ee8f42a5af07p+0, 0x1.3d5d991aa75c6p+0, 0x1.3bd60d9232955p+0,
+    0x1.3a524387ac822p+0, 0x1.38d22d366088ep+0, 0x1.3755bd1c945eep+0, 0x1.35dce5f9f2af8p+0,
+    0x1.34679ace01346p+0, 0x1.32f5ced6a1dfap+0, 0x1.3187758e9ebb6p+0, 0x1.301c82ac40260p+0,
+    0x1.2eb4ea1fed14bp+0, 0x1.2d50a012d50a0p+0, 0x1.2bef98e5a3711p+0, 0x1.2a91c92f3c105p+0,
+    0x1.293725bb804a5p+0, 0x1.27dfa38a1ce4dp+0, 0x1.268b37cd60127p+0, 0x1.2539d7e9177b2p+0,
+    0x1.23eb79717605bp+0, 0x1.22a0122a0122ap+0, 0x1.21579804855e6p+0, 0x1.2012012012012p+0,
+    0x1.1ecf43c7fb84cp+0, 0x1.1d8f5672e4abdp+0, 0x1.1c522fc1ce059p+0, 0x1.1b17c67f2bae3p+0,
+    0x1.19e0119e0119ep+0, 0x1.18ab083902bdbp+0, 0x1.1778a191bd684p+0, 0x1.1648d50fc3201p+0,
+    0x1.151b9a3fdd5c9p+0, 0x1.13f0e8d344724p+0, 0x1.12c8b89edc0acp+0, 0x1.11a3019a74826p+0,
+    0x1.107fbbe011080p+0, 0x1.0f5edfab325a2p+0, 0x1.0e40655826011p+0, 0x1.0d24456359e3ap+0,
+    0x1.0c0a7868b4171p+0, 0x1.0af2f722eecb5p+0, 0x1.09ddba6af8360p+0, 0x1.08cabb37565e2p+0,
+    0x1.07b9f29b8eae2p+0, 0x1.06ab59c7912fbp+0, 0x1.059eea0727586p+0, 0x1.04949cc1664c5p+0,
+    0x1.038c6b78247fcp+0, 0x1.02864fc7729e9p+0, 0x1.0182436517a37p+0, 0x1.0000000000000p+0,
+};
+
+static const double log_table_logc[LOG_TABLE_SIZE] = {
+    0.0, 0x1.7dc475f810a69p-7, 0x1.3cea44346a584p-6, 0x1.b9fc027af919ap-6,
+    0x1.1b0d98923d97fp-5, 0x1.58a5bafc8e4d3p-5, 0x1.95c830ec8e3f2p-5, 0x1.d276b8adb0b56p-5,
+    0x1.075983598e471p-4, 0x1.253f62f0a1417p-4, 0x1.42edcbea646eep-4, 0x1.60658a93750c4p-4,
+    0x1.7da766d7b12d0p-4, 0x1.9ab42462033aep-4, 0x1.b78c82bb0eda0p-4, 0x1.d4313d66cb35dp-4,
+    0x1.f0a30c01162a4p-4, 0x1.0671512ca596fp-3, 0x1.14785846742acp-3, 0x1.2266f190a5acdp-3,
+    0x1.303d718e47fd5p-3, 0x1.3dfc2b0ecc62ap-3, 0x1.4ba36f39a55e5p-3, 0x1.59338d9982085p-3,
+    0x1.66acd4272ad51p-3, 0x1.740f8f54037a3p-3, 0x1.815c0a14357e9p-3, 0x1.8e928de886d41p-3,
+    0x1.9bb362e7dfb85p-3, 0x1.a8becfc882f19p-3, 0x1.b5b519e8fb5a6p-3, 0x1.c2968558c18c2p-3,
+    0x1.cf6354e09c5ddp-3, 0x1.dc1bca0abec7bp-3, 0x1.e8c0252aa5a60p-3, 0x1.f550a564b7b37p-3,
+    0x1.00e6c45ad501dp-2, 0x1.071b85fcd590dp-2, 0x1.0d46b579ab74bp-2, 0x1.136870293a8b0p-2,
+    0x1.1980d2dd4236fp-2, 0x1.1f8ff9e48a2f3p-2, 0x1.2596010df763ap-2, 0x1.2b9303ab89d25p-2,
+    0x1.31871c9544185p-2, 0x1.3772662bfd85cp-2, 0x1.3d54fa5c1f710p-2, 0x1.432ef2a04e813p-2,
+    0x1.49006804009d0p-2, 0x1.4ec9732600269p-2, 0x1.548a2c3add263p-2, 0x1.5a42ab0f4cfe2p-2,
+    0x1.5ff3070a793d4p-2, -0x1.602d08af091ecp-2, -0x1.5a8cadbbedfa1p-2, -0x1.54f431b7be1a8p-2,
+    -0x1.4f637ebba9810p-2, -0x1.49da7f3bcc420p-2, -0x1.44591e0539f49p-2, -0x1.3edf463c1683ep-2,
+    -0x1.396ce359bbf53p-2, -0x1.3401e12aecba0p-2, -0x1.2e9e2bce12286p-2, -0x1.2941afb186b7cp-2,
+    -0x1.23ec5991eba49p-2, -0x1.1e9e1678899f5p-2, -0x1.1956d3b9bc2f9p-2, -0x1.14167ef367784p-2,
+    -0x1.0edd060b78082p-2, -0x1.09aa572e6c6d4p-2, -0x1.047e60cde83b7p-2, -0x1.feb2233ea07cbp-3,
+    -0x1.f474b134df228p-3, -0x1.ea4449f04aaf5p-3, -0x1.e020cc6235ab5p-3, -0x1.d60a17f903514p-3,
+    -0x1.cc000c9db3c52p-3, -0x1.c2028ab17f9b5p-3, -0x1.b811730b823d4p-3, -0x1.ae2ca6f672bd8p-3,
+    -0x1.a454082e6ab03p-3, -0x1.9a8778debaa3ap-3, -0x1.90c6db9fcbcdbp-3, -0x1.871213750e994p-3,
+    -0x1.7d6903caf5acdp-3, -0x1.73cb9074fd14dp-3, -0x1.6a399dabbd383p-3, -0x1.60b3100b09474p-3,
+    -0x1.5737cc9018cddp-3, -0x1.4dc7b897bc1c7p-3, -0x1.4462b9dc9b3dcp-3, -0x1.3b08b6757f2a7p-3,
+    -0x1.31b994d3a4f86p-3, -0x1.28753bc11aba2p-3, -0x1.1f3b925f25d44p-3, -0x1.160c8024b27b0p-3,
+    -0x1.0ce7ecdccc28bp-3, -0x1.03cdc0a51ec0dp-3, -0x1.f57bc7d9005dbp-4, -0x1.e3707ee30487bp-4,
+    -0x1.d179788219362p-4, -0x1.bf968769fca18p-4, -0x1.adc77ee5aea8ep-4, -0x1.9c0c32d4d254dp-4,
+    -0x1.8a6477a91dc29p-4, -0x1.78d02263d82d7p-4, -0x1.674f089365a78p-4, -0x1.55e10050e0382p-4,
+    -0x1.4485e03dbdfb0p-4, -0x1.333d7f8183f4ap-4, -0x1.2207b5c7854a1p-4, -0x1.10e45b3cae829p-4,
+    -0x1.ffa6911ab9309p-5, -0x1.dda8adc67ee59p-5, -0x1.bbcebfc68f424p-5, -0x1.9a187b573de81p-5,
+    -0x1.788595a3577c8p-5, -0x1.5715c4c03cee1p-5, -0x1.35c8bfaa13069p-5, -0x1.149e3e4005a8dp-5,
+    -0x1.e72bf2813ce6ap-6, -0x1.a55f548c5c427p-6, -0x1.63d6178690bbep-6, -0x1.228fb1fea2e0ap-6,
+    -0x1.c317384c75f0dp-7, -0x1.41929f968330cp-7, -0x1.8121214586b02p-8, 0.0,
+};
+
+static const double log_table_logctail[LOG_TABLE_SIZE] = {
+    0.0, 0x1.74944bc161072p-61, -0x1.865ad48159d00p-61, -0x1.90ae69229dc86p-60,
+    -0x1.74d7444dd6241p-59, -0x1.cab8569c56e40p-64, 0x1.eb41d00a417e9p-60, 0x1.078f14c95ff53p-59,
+    0x1.006d2999e22dcp-58, 0x1.1f6d34e01d981p-61, -0x1.511583653349bp-58, -0x1.f108b1d8436d3p-59,
+    0x1.a2240644d7da2p-59, -0x1.a099e1c184e8ep-59, -0x1.3ef0e61f9b03cp-58, 0x1.b90dd951d90fap-58,
+    0x1.8be64b8b7759bp-59, -0x1.2f39b81479b67p-58, 0x1.94409f1d3f83ap-60, -0x1.dab840e7f6177p-57,
+    -0x1.b5ae71f658247p-57, 0x1.ba62b8c13f7f4p-57, -0x1.f767e433c98aap-57, 0x1.8d16eaaba9419p-57,
+    -0x1.9201c9c3d5165p-59, 0x1.6d9bf9d57b326p-58, 0x1.141b7f8c5fa9ep-58, 0x1.2589eb96a6240p-59,
+    -0x1.51439c1ff83e7p-58, -0x1.a8c37918c39ebp-58, -0x1.d5d8023e61e5fp-57, 0x1.6108e3ae024acp-60,
+    0x1.339a07d55b696p-57, 0x1.c698a33316dfbp-58, -0x1.dc074737f9135p-60, -0x1.13a09202fe73dp-57,
+    -0x1.3b9568ff6feadp-57, 0x1.08b83fcbdef40p-57, 0x1.21f640e1e5ec9p-56, 0x1.86cc531dba494p-57,
+    -0x1.02c2e4f1b2eb9p-56, -0x1.93fbf3418960dp-57, -0x1.9eed8ae0ebd3cp-59, -0x1.85ad7f614ab51p-58,
+    -0x1.ea3598981366fp-57, 0x1.02a7589fba088p-57, 0x1.53668e578d9cdp-58, -0x1.83262e2b59206p-57,
+    -0x1.bff0d07c5df6dp-59, -0x1.1aa87d977dc5ep-56, -0x1.58ce7bf1846eep-56, -0x1.c6bcb7dee9a3dp-56,
+    -0x1.063077d7e37b7p-56, -0x1.a45db7cfd9230p-56, -0x1.64f5081307f22p-60, 0x1.0b3f6ef6ae452p-58,
+    0x1.68cb3124b9245p-56, 0x1.d964a168ccacbp-57, -0x1.a76d6dc2782dap-59, 0x1.c852fe587def8p-57,
+    0x1.5c5663663d163p-59, -0x1.f95523adc5c9fp-57, 0x1.f3ed72e23e134p-57, -0x1.6a4678ebaa300p-59,
+    -0x1.76eba35bbf0dfp-61, -0x1.64b0dd2687939p-58, -0x1.0e75a3542856fp-58, -0x1.ef824daaf53e9p-56,
+    -0x1.2d4b610d7d4f5p-57, -0x1.f9e17343426a9p-56, -0x1.08869cbf9e344p-56, -0x1.8de00938b4c30p-61,
+    0x1.9f1df7b5daab7p-60, 0x1.f33919ab94074p-57, 0x1.f0adb91423f18p-57, 0x1.50df841a71b7ap-57,
+    -0x1.67a2a8500729ep-58, -0x1.c11aa3853a5f0p-57, 0x1.d7c46328983c6p-58, 0x1.a4a356155f779p-57,
+    0x1.e0df823a3cb3dp-58, -0x1.28fbfb0e3f0fcp-58, 0x1.357718d7ca4cfp-58, 0x1.a97a0ca115d60p-57,
+    0x1.0b17c301d6e14p-57, 0x1.721a000b4cf01p-57, -0x1.76332bd4b341fp-57, -0x1.526cee0fd7f4ap-57,
+    0x1.00b28ef013c72p-57, -0x1.b60ae1ff0e82ep-59, 0x1.85388d830c709p-59, -0x1.5e1ad9be0a4cdp-57,
+    0x1.1238b5efe0665p-57, 0x1.7394d9fa33313p-57, -0x1.08b27be4e6b15p-57, 0x1.355bfd870afebp-59,
+    -0x1.1b57fea88da98p-59, -0x1.19e2d3f8b7d10p-57, 0x1.d361574fb24e2p-58, -0x1.9399d9aaf3b33p-59,
+    0x1.b12841044a96cp-58, 0x1.06e4fb7af9c69p-58, -0x1.d7d8f39bee658p-58, 0x1.627a0e199f569p-58,
+    0x1.3d4190a482421p-58, -0x1.cbca5b4fdb87ep-58, -0x1.ca64e9980e048p-59, -0x1.9a0629e3973e4p-58,
+    -0x1.3ba349aadbc6dp-58, 0x1.adaa06e211e9ep-59, -0x1.b3f0431efb154p-58, -0x1.9b5ed72e6d974p-58,
+    0x1.cd9f1f95c2ef1p-59, 0x1.31936790bb3b2p-59, 0x1.cd1862f854848p-59, -0x1.b13b26f298a6ap-64,
+    -0x1.2f7c4c5b3c8bdp-62, -0x1.5101dc4ebf91fp-59, 0x1.50830a65543a8p-63, 0x1.a9a4168fcebebp-60,
+    0x1.8a4bba6a354fap-60, -0x1.f60d2fc36a0d9p-61, 0x1.18ed4d357c9dcp-60, -0x1.3284991fe3d5cp-61,
+    -0x1.806208c04c21fp-61, -0x1.3aae809b43dd0p-61, 0x1.c7d68c0d910f2p-62, 0.0,
+};
+
+// --- Scalar instantiation (also the reference for the vector kernels) ---
+
+static inline long long vm_bits(double x) { long long i; memcpy(&i, &x, sizeof(i)); return i; }
+static inline double vm_from_bits(long long i) { double x; memcpy(&x, &i, sizeof(x)); return x; }
+
+#define VD double
+#define VI long long
+#define VM int
+#define V_WIDTH 1
+#define M_FULL 1u
+#define V_FN(name) name##_scalar
+#define V_TARGET
+#define V_LOADU(p) (*(p))
+#define V_STOREU(p, v) (*(p) = (v))
+#define V_SET1(x) ((double)(x))
+#define VI_SET1(x) ((long long)(x))
+#define V_ADD(a, b) ((a) + (b))
+#define V_SUB(a, b) ((a) - (b))
+#define V_MUL(a, b) ((a) * (b))
+#define V_DIV(a, b) ((a) / (b))
+#define V_FMA(a, b, c) fma((a), (b), (c))
+#define V_NEG(a) (-(a))
+#define V_ABS(a) fabs(a)
+#define V_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define V_MAX(a, b) ((a) > (b) ? (a) : (b))
+#define V_TRUNC(a) trunc(a)
+#define V_AS_VI(v) vm_bits(v)
+#define VI_AS_V(v) vm_from_bits(v)
+#define VI_ADD(a, b) ((long long)((unsigned long long)(a) + (unsigned long long)(b)))
+#define VI_SUB(a, b) ((long long)((unsigned long long)(a) - (unsigned long long)(b)))
+#define VI_AND(a, b) ((a) & (b))
+#define VI_OR(a, b) ((a) | (b))
+#define VI_SHL(a, n) ((long long)((unsigned long long)(a) << (n)))
+#define VI_SHR(a, n) ((long long)((unsigned long long)(a) >> (n)))
+#define V_GATHER(table, i) ((table)[i])
+#define V_CMP_LT(a, b) ((a) < (b))
+#define V_CMP_LE(a, b) ((a) <= (b))
+#define V_CMP_GT(a, b) ((a) > (b))
+#define V_CMP_GE(a, b) ((a) >= (b))
+#define V_CMP_EQ(a, b) ((a) == (b))
+#define V_CMP_NEQ(a, b) ((a) != (b))
+#define V_CMP_UNORD(a, b) (isnan(a) || isnan(b))
+#define VI_CMP_EQ(a, b) ((a) == (b))
+#define M_AND(a, b) ((a) & (b))
+#define M_OR(a, b) ((a) | (b))
+#define M_ANDNOT(a, b) ((a) & !(b))
+#define M_BITS(m) ((unsigned)(m))
+#define V_SELECT(m, a, b) ((m) ? (a) : (b))
+
+#include "VectorMathKernels.h"
+
+#undef VD
+#undef VI
+#undef VM
+#undef V_WIDTH
+#undef M_FULL
+#undef V_FN
+#undef V_TARGET
+#undef V_LOADU
+#undef V_STOREU
+#undef V_SET1
+#undef VI_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_DIV
+#undef V_FMA
+#undef V_NEG
+#undef V_ABS
+#undef V_MIN
+#undef V_MAX
+#undef V_TRUNC
+#undef V_AS_VI
+#undef VI_AS_V
+#undef VI_ADD
+#undef VI_SUB
+#undef VI_AND
+#undef VI_OR
+#undef VI_SHL
+#undef VI_SHR
+#undef V_GATHER
+#undef V_CMP_LT
+#undef V_CMP_LE
+#undef V_CMP_GT
+#undef V_CMP_GE
+#undef V_CMP_EQ
+#undef V_CMP_NEQ
+#undef V_CMP_UNORD
+#undef VI_CMP_EQ
+#undef M_AND
+#undef M_OR
+#undef M_ANDNOT
+#undef M_BITS
+#undef V_SELECT
+
+
+#ifdef CALC_X86_SIMD
+
+// --- AVX2 instantiation (masks are all-ones/all-zeros lanes) ---
+
+#define VD __m256d
+#define VI __m256i
+#define VM __m256d
+#define V_WIDTH 4
+#define M_FULL 0xFu
+#define V_FN(name) name##_avx2
+#define V_TARGET CALC_TARGET_AVX2
+#define V_LOADU(p) _mm256_loadu_pd(p)
+#define V_STOREU(p, v) _mm256_storeu_pd((p), (v))
+#define V_SET1(x) _mm256_set1_pd(x)
+#define VI_SET1(x) _mm256_set1_epi64x(x)
+#define V_ADD(a, b) _mm256_add_pd((a), (b))
+#define V_SUB(a, b) _mm256_sub_pd((a), (b))
+#define V_MUL(a, b) _mm256_mul_pd((a), (b))
+#define V_DIV(a, b) _mm256_div_pd((a), (b))
+#define V_FMA(a, b, c) _mm256_fmadd_pd((a), (b), (c))
+#define V_NEG(a) _mm256_xor_pd((a), _mm256_set1_pd(-0.0))
+#define V_ABS(a) _mm256_andnot_pd(_mm256_set1_pd(-0.0), (a))
+#define V_MIN(a, b) _mm256_min_pd((a), (b))
+#define V_MAX(a, b) _mm256_max_pd((a), (b))
+#define V_TRUNC(a) _mm256_round_pd((a), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)
+#define V_AS_VI(v) _mm256_castpd_si256(v)
+#define VI_AS_V(v) _mm256_castsi256_pd(v)
+#define VI_ADD(a, b) _mm256_add_epi64((a), (b))
+#define VI_SUB(a, b) _mm256_sub_epi64((a), (b))
+#define VI_AND(a, b) _mm256_and_si256((a), (b))
+#define VI_OR(a, b) _mm256_or_si256((a), (b))
+#define VI_SHL(a, n) _mm256_slli_epi64((a), (n))
+#define VI_SHR(a, n) _mm256_srli_epi64((a), (n))
+#define V_GATHER(table, i) _mm256_i64gather_pd((table), (i), 8)
+#define V_CMP_LT(a, b) _mm256_cmp_pd((a), (b), _CMP_LT_OQ)
+#define V_CMP_LE(a, b) _mm256_cmp_pd((a), (b), _CMP_LE_OQ)
+#define V_CMP_GT(a, b) _mm256_cmp_pd((a), (b), _CMP_GT_OQ)
+#define V_CMP_GE(a, b) _mm256_cmp_pd((a), (b), _CMP_GE_OQ)
+#define V_CMP_EQ(a, b) _mm256_cmp_pd((a), (b), _CMP_EQ_OQ)
+#define V_CMP_NEQ(a, b) _mm256_cmp_pd((a), (b), _CMP_NEQ_UQ)
+#define V_CMP_UNORD(a, b) _mm256_cmp_pd((a), (b), _CMP_UNORD_Q)
+#define VI_CMP_EQ(a, b) _mm256_castsi256_pd(_mm256_cmpeq_epi64((a), (b)))
+#define M_AND(a, b) _mm256_and_pd((a), (b))
+#define M_OR(a, b) _mm256_or_pd((a), (b))
+#define M_ANDNOT(a, b) _mm256_andnot_pd((b), (a))
+#define M_BITS(m) ((unsigned)_mm256_movemask_pd(m))
+#define V_SELECT(m, a, b) _mm256_blendv_pd((b), (a), (m))
+
+#include "VectorMathKernels.h"
+
+#undef VD
+#undef VI
+#undef VM
+#undef V_WIDTH
+#undef M_FULL
+#undef V_FN
+#undef V_TARGET
+#undef V_LOADU
+#undef V_STOREU
+#undef V_SET1
+#undef VI_SET1
+#undef V_ADD
+#undef V_SUB
+#undef V_MUL
+#undef V_DIV
+#undef V_FMA
+#undef V_NEG
+#undef V_ABS
+#undef V_MIN
+#undef V_MAX
+#undef V_TRUNC
+#undef V_AS_VI
+#undef VI_AS_V
+#undef VI_ADD
+#undef VI_SUB
+#undef VI_AND
+#undef VI_OR
+#undef VI_SHL
+#undef VI_SHR
+#undef V_GATHER
+#undef V_CMP_LT
+#undef V_CMP_LE
+#undef V_CMP_GT
+#undef V_CMP_GE
+#undef V_CMP_EQ
+#undef V_CMP_NEQ
+#undef V_CMP_UNORD
+#undef VI_CMP_EQ
+#undef M_AND
+#undef M_OR
+#undef M_ANDNOT
+#undef M_BITS
+#undef V_SELECT
+
+
+// --- AVX-512 instantiation (masks are k-registers) ---
+
+#define VD __m512d
+#define VI __m512i
+#define VM __mmask8
+#define V_WIDTH 8
+#define M_FULL 0xFFu
+#define V_FN(name) name##_avx512
+#define V_TARGET CALC_TARGET_AVX512
+#define V_LOADU(p) _mm512_loadu_pd(p)
+#define V_STOREU(p, v) _mm512_storeu_pd((p), (v))
+#define V_SET1(x) _mm512_set1_pd(x)
+#define VI_SET1(x) _mm512_set1_epi64(x)
+#define V_ADD(a, b) _mm512_add_pd((a), (b))
+#define V_SUB(a, b) _mm512_sub_pd((a), (b))
+#define V_MUL(a, b) _mm512_mul_pd((a), (b))
+#define V_DIV(a, b) _mm512_div_pd((a), (b))
+#define V_FMA(a, b, c) _mm512_fmadd_pd((a), (b), (c))
+#define V_NEG(a) _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(LLONG_MIN)))
+#define V_ABS(a) _mm512_abs_pd(a)
+#define V_MIN(a, b) _mm512_min_pd((a), (b))
+#define V_MAX(a, b) _mm512_max_pd((a), (b))
+#define V_TRUNC(a) _mm512_roundscale_pd((a), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC)
+#define V_AS_VI(v) _mm512_castpd_si512(v)
+#define VI_AS_V(v) _mm512_castsi512_pd(v)
+#define VI_ADD(a, b) _mm512_add_epi64((a), (b))
+#define VI_SUB(a, b) _mm512_sub_epi64((a), (b))
+#define VI_AND(a, b) _mm512_and_si512((a), (b))
+#define VI_OR(a, b) _mm512_or_si512((a), (b))
+#define VI_SHL(a, n) _mm512_slli_epi64((a), (n))
+#define VI_SHR(a, n) _mm512_srli_epi64((a), (n))
+#define V_GATHER(table, i) _mm512_i64gather_pd((i), (table), 8)
+#define V_CMP_LT(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_LT_OQ)
+#define V_CMP_LE(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_LE_OQ)
+#define V_CMP_GT(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_GT_OQ)
+#define V_CMP_GE(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_GE_OQ)
+#define V_CMP_EQ(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_EQ_OQ)
+#define V_CMP_NEQ(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_NEQ_UQ)
+#define V_CMP_UNORD(a, b) _mm512_cmp_pd_mask((a), (b), _CMP_UNORD_Q)
+#define VI_CMP_EQ(a, b) _mm512_cmpeq_epi64_mask((a), (b))
+#define M_AND(a, b) ((__mmask8)((a) & (b)))
+#define M_OR(a, b) ((__mmask8)((a) | (b)))
+#define M_ANDNOT(a, b) ((__mmask8)((a) & ~(b)))
+#define M_BITS(m) ((unsigned)(m))
+#define V_SELECT(m, a, b) _mm512_mask_blend_pd((m), (b), (a))
+
+#include "VectorMathKernels.h"
+
+#endif // CALC_X86_SIMD
+
+
+// --- Dispatch ---
+
+void exp_n(const double* x, double* out, size_t n, CalcMathTier tier) {
+    int accurate = tier == CALC_MATH_ACCURATE;
+    switch (calc_simd_level()) {
+#ifdef CALC_X86_SIMD
+    case CALC_SIMD_AVX512: exp_array_avx512(x, out, n, accurate); return;
+    case CALC_SIMD_AVX2: exp_array_avx2(x, out, n, accurate); return;
+#endif
+    default: exp_array_scalar(x, out, n, accurate); return;
+    }
+}
+
+size_t log_n(const double* x, double* out, size_t n, CalcMathTier tier, unsigned char* errors) {
+    int accurate = tier == CALC_MATH_ACCURATE;
+    switch (calc_simd_level()) {
+#ifdef CALC_X86_SIMD
+    case CALC_SIMD_AVX512: return log_array_avx512(x, out, n, accurate, errors);
+    case CALC_SIMD_AVX2: return log_array_avx2(x, out, n, accurate, errors);
+#endif
+    default: return log_array_scalar(x, out, n, accurate, errors);
+    }
+}
+
+void pow_n(const double* base, const double* exp, double* out, size_t n, CalcMathTier tier) {
+    int accurate = tier == CALC_MATH_ACCURATE;
+    switch (calc_simd_level()) {
+#ifdef CALC_X86_SIMD
+    case CALC_SIMD_AVX512: pow_array_avx512(base, exp, out, n, accurate); return;
+    case CALC_SIMD_AVX2: pow_array_avx2(base, exp, out, n, accurate); return;
+#endif
+    default: pow_array_scalar(base, exp, out, n, accurate); return;
+    }
+}
+
+void sincos_deg(double deg, double* sine, double* cosine) {
+    // A single angle always takes the scalar kernel; the vector kernels return the same bits
+    sincos_block_scalar(&deg, sine, cosine);
+}
+
+void sincos_deg_n(const double* deg, double* sine, double* cosine, size_t n) {
+    switch (calc_simd_level()) {
+#ifdef CALC_X86_SIMD
+    case CALC_SIMD_AVX512: sincos_array_avx512(deg, sine, cosine, n); return;
+    case CALC_SIMD_AVX2: sincos_array_avx2(deg, sine, cosine, n); return;
+#endif
+    default: sincos_array_scalar(deg, sine, cosine, n); return;
+    }
+}
+
+static void rotate_n(double s, double c, const double* ts, const double* tc, double* sine, double* cosine, size_t n) {
+    switch (calc_simd_level()) {
+#ifdef CALC_X86_SIMD
+    case CALC_SIMD_AVX512: rotate_array_avx512(s, c, ts, tc, sine, cosine, n); return;
+    case CALC_SIMD_AVX2: rotate_array_avx2(s, c, ts, tc, sine, cosine, n); return;
+#endif
+    default: rotate_array_scalar(s, c, ts, tc, sine, cosine, n); return;
+    }
+}
+
+/**
+ * @brief Gives the angles start + (first + i) * step that are multiples of 90 the exact values of
+ * sincos_deg().
+ */
+static void exact_quadrants(double start, double step, size_t first, double* sine, double* cosine, size_t n) {
+    double from = start + (double)first * step, to = start + (double)(first + n - 1) * step;
+    double first_k = ceil(fmin(from, to) / 90), last_k = floor(fmax(from, to) / 90);
+
+    if (last_k - first_k + 1 <= (double)n) {
+        // Few multiples: find the index of each
+        for (double k = first_k; k <= last_k; k++) {
+            double m = 90 * k, j = nearbyint((m - start) / step);
+            for (double i = j - 1; i <= j + 1; i++) {
+                if (i >= (double)first && i < (double)(first + n) && start + i * step == m) {
+                    size_t index = (size_t)i - first;
+                    sincos_deg(m, &sine[index], &cosine[index]);
+                }
+            }
+        }
+    }
+    else {
+        for (size_t i = 0; i < n; i++) {
+            double x = start + (double)(first + i) * step;
+            if (x == 90 * nearbyint(x / 90)) sincos_deg(x, &sine[i], &cosine[i]);
+        }
+    }
+}
+
+void sincos_deg_step_n(double start, double step, size_t first, double* sine, double* cosine, size_t n) {
+    double offsets[TRIG_STEP_ANCHOR], table_s[TRIG_STEP_ANCHOR], table_c[TRIG_STEP_ANCHOR];
+    size_t span = n < TRIG_STEP_ANCHOR ? n : TRIG_STEP_ANCHOR;
+
+    if (n == 0) return;
+    for (size_t j = 0; j < span; j++) offsets[j] = (double)j * step;
+    sincos_deg_n(offsets, table_s, table_c, span);
+    for (size_t i = 0; i < n; i += span) {
+        double s, c;
+        sincos_deg(start + (double)(first + i) * step, &s, &c);
+        rotate_n(s, c, table_s, table_c, sine + i, cosine + i, n - i < span ? n - i : span);
+    }
+    exact_quadrants(start, step, first, sine, cosine, n);
+}
+
+/**
+ * @brief Shared driver of tan_deg_n() and cot_deg_n().
+ */
+static size_t tan_cot_n(const double* deg, double* out, size_t n, int cotangent, unsigned char* errors) {
+    switch (calc_simd_level()) {
+#ifdef CALC_X86_SIMD
+    case CALC_SIMD_AVX512: return tan_array_avx512(deg, out, n, cotangent, errors);
+    case CALC_SIMD_AVX2: return tan_array_avx2(deg, out, n, cotangent, errors);
+#endif
+    default: return tan_array_scalar(deg, out, n, cotangent, errors);
+    }
+}
+
+size_t tan_deg_n(const double* deg, double* out, size_t n, unsigned char* errors) {
+    return tan_cot_n(deg, out, n, 0, errors);
+}
+
+size_t cot_deg_n(const double* deg, double* out, size_t n, unsigned char* errors) {
+    return tan_cot_n(deg, out, n, 1, errors);
+}
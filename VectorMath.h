@@ -0,0 +1,92 @@
+#ifndef VECTOR_MATH_H
+#define VECTOR_MATH_H
+
+#include <stddef.h>
+
+/*
+ * Batched exp/log/pow (the array forms of calc_exp(), calc_log() and calc_power()).
+ * AVX2 or AVX-512 kernels are selected at run time (see calc_simd_level()); the scalar
+ * fallback runs the same algorithm and returns bit-identical results. Nothing is printed.
+ *
+ * Maximum error in ULP, measured against long double expl/logl/powl on 4 * 10^6 random
+ * arguments per function and range (normal, subnormal and overflow/underflow boundaries):
+ *
+ *               CALC_MATH_FAST   CALC_MATH_ACCURATE
+ *     exp_n         2.17             0.89
+ *     log_n         1.70             0.50
+ *     pow_n         2.33             0.91   (integral |y| <= 64: 0.501 in both tiers)
+ *
+ * Outside the documented domains the C library rules apply (NaN and infinite operands,
+ * overflow to inf, underflow to subnormals and zero), except that log_n follows calc_log():
+ * zero and negative inputs give NAN and are reported as errors.
+ */
+
+typedef enum {
+    CALC_MATH_FAST,    // Polynomial evaluation without compensated arithmetic (under 2.5 ULP)
+    CALC_MATH_ACCURATE // Under 1 ULP
+} CalcMathTier;
+
+/**
+ * @brief out[i] = e^x[i].
+ */
+void exp_n(const double* x, double* out, size_t n, CalcMathTier tier);
+
+/**
+ * @brief out[i] = log(x[i]) (natural logarithm); non-positive inputs give NAN, like calc_log().
+ * @param errors Optional bitmask of the non-positive inputs ((n + 7) / 8 bytes, see divide_n()).
+ * @return The number of non-positive inputs.
+ */
+size_t log_n(const double* x, double* out, size_t n, CalcMathTier tier, unsigned char* errors);
+
+/**
+ * @brief out[i] = base[i]^exp[i]. Integral exponents up to 64 in magnitude use exponentiation
+ * by squaring in double-double arithmetic instead of exp(y * log(x)).
+ */
+void pow_n(const double* base, const double* exp, double* out, size_t n, CalcMathTier tier);
+
+/*
+ * Trigonometry in degrees (the engine behind calc_sin() ... calc_cot()).
+ * Angles are reduced modulo 360 and then to [-45, 45] exactly, in degrees, so multiples of 90
+ * give exact 0 and +-1, and multiples of 30 and 45 give correctly rounded results. Elsewhere sine
+ * and cosine are within 0.77 ULP (same measurement as above), computed in one fused evaluation.
+ * tan and cot are their quotient (within 2.3 ULP) and are undefined exactly where the denominator
+ * is 0: tan at 90 + 180k, cot at 180k.
+ * As above, the scalar and vector kernels return bit-identical results.
+ */
+
+/**
+ * @brief Computes the sine and cosine of one angle in degrees.
+ */
+void sincos_deg(double deg, double* sine, double* cosine);
+
+/**
+ * @brief sine[i] = sin(deg[i]) and cosine[i] = cos(deg[i]), angles in degrees.
+ */
+void sincos_deg_n(const double* deg, double* sine, double* cosine, size_t n);
+
+/**
+ * @brief sine[i] = sin(start + (first + i) * step) and cosine[i] = cos(start + (first + i) * step),
+ * angles in degrees, for tabulating. Every 256th angle (an anchor) is computed like sincos_deg(),
+ * the ones in between by angle addition from their anchor and a table of sin/cos(j * step): two
+ * fused multiply-adds per value, and no error carried from one angle to the next. A long table can
+ * be computed in blocks (first); blocks starting at multiples of 256 give the results of a single call.
+ * Multiples of 90 get the exact values of sincos_deg(). Elsewhere the results differ from
+ * sincos_deg_n() on the same angles by at most a few 1e-16 in absolute terms (more in relative
+ * terms near the zeros of sine and cosine), plus the rounding of the angles themselves once they
+ * are large (1.2e-13 at 36000 degrees).
+ */
+void sincos_deg_step_n(double start, double step, size_t first, double* sine, double* cosine, size_t n);
+
+/**
+ * @brief out[i] = tan(deg[i]); angles of 90 + 180k give NAN and exact zeros are +0.
+ * @param errors Optional bitmask of the undefined elements ((n + 7) / 8 bytes, see divide_n()).
+ * @return The number of undefined elements.
+ */
+size_t tan_deg_n(const double* deg, double* out, size_t n, unsigned char* errors);
+
+/**
+ * @brief out[i] = cot(deg[i]); angles of 180k give NAN (see tan_deg_n()).
+ */
+size_t cot_deg_n(const double* deg, double* out, size_t n, unsigned char* errors);
+
+#endif // VECTOR_MATH_H
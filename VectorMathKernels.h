@@ -0,0 +1,456 @@
+/*
+ * Kernel template for VectorMath.c - deliberately has no include guard.
+ *
+ * VectorMath.c includes this file once per instruction set after defining the vector
+ * abstraction it is written against:
+ *
+ *   VD, VI, VM        vector of doubles, vector of 64-bit integers, lane mask
+ *   V_WIDTH           lanes per vector
+ *   V_FN(name)        suffixes a function name with the instruction set
+ *   V_TARGET          function attribute enabling the instruction set
+ *   V_* / VI_* / M_*  arithmetic, bit casts, comparisons, gathers and mask operations
+ *
+ * Every instantiation performs exactly the same floating-point operations (fused multiply-adds
+ * included), so the scalar, AVX2 and AVX-512 kernels return bit-identical results. This needs the
+ * compiler not to fuse the separate V_MUL/V_ADD pairs where FMA is available (-ffp-contract=off
+ * in CMakeLists.txt); tests/KernelTests.c compares the levels.
+ */
+
+// p * 2^k for k in [-1076, 1024], in two steps so that subnormal results are rounded only once
+V_TARGET static inline VD V_FN(vm_scale)(VD p, VI k) {
+    VI k1 = VI_SUB(VI_SHR(VI_ADD(k, VI_SET1(2048)), 1), VI_SET1(1024)); // floor(k / 2)
+    VI k2 = VI_SUB(k, k1);
+    VD s1 = VI_AS_V(VI_SHL(VI_ADD(k1, VI_SET1(1023)), 52));
+    VD s2 = VI_AS_V(VI_SHL(VI_ADD(k2, VI_SET1(1023)), 52));
+    return V_MUL(V_MUL(p, s1), s2);
+}
+
+// Error-free sum: returns s = fl(a + b) and stores the rounding error in *err
+V_TARGET static inline VD V_FN(vm_two_sum)(VD a, VD b, VD* err) {
+    VD s = V_ADD(a, b);
+    VD bb = V_SUB(s, a);
+    *err = V_ADD(V_SUB(a, V_SUB(s, bb)), V_SUB(b, bb));
+    return s;
+}
+
+// Converts small integral doubles (|x| < 2^51) to integers and back without conversion instructions
+V_TARGET static inline VI V_FN(vm_to_int)(VD x) {
+    return VI_SUB(V_AS_VI(V_ADD(x, V_SET1(VM_SHIFT))), V_AS_VI(V_SET1(VM_SHIFT)));
+}
+
+V_TARGET static inline VD V_FN(vm_to_double)(VI k) {
+    return V_SUB(VI_AS_V(VI_ADD(k, V_AS_VI(V_SET1(VM_SHIFT)))), V_SET1(VM_SHIFT));
+}
+
+/**
+ * e^(x + xtail) for non-NaN x; xtail is a small correction (the low part of y*log(x) in pow).
+ * Accurate tier: the rational approximation of fdlibm's exp. Fast tier: a degree-11 polynomial.
+ */
+V_TARGET static inline VD V_FN(vm_exp_core)(VD x, VD xtail, int accurate) {
+    VD xc = V_MIN(V_MAX(x, V_SET1(-746.0)), V_SET1(710.0)); // Beyond this range the result is 0 or inf
+    xtail = V_SELECT(V_CMP_EQ(xc, x), xtail, V_SET1(0.0)); // A clamped argument has no meaningful tail
+    VD z = V_FMA(xc, V_SET1(VM_INV_LN2), V_SET1(VM_SHIFT));
+    VD kd = V_SUB(z, V_SET1(VM_SHIFT));
+    VI k = VI_SUB(V_AS_VI(z), V_AS_VI(V_SET1(VM_SHIFT)));
+    VD hi = V_FMA(kd, V_SET1(-VM_LN2_HI), xc); // Exact
+    VD y;
+
+    if (accurate) {
+        VD lo = V_SUB(V_MUL(kd, V_SET1(VM_LN2_LO)), xtail);
+        VD r = V_SUB(hi, lo);
+        VD t = V_MUL(r, r);
+        VD c = V_FMA(t, V_SET1(EXP_P5), V_SET1(EXP_P4));
+        c = V_FMA(t, c, V_SET1(EXP_P3));
+        c = V_FMA(t, c, V_SET1(EXP_P2));
+        c = V_FMA(t, c, V_SET1(EXP_P1));
+        c = V_SUB(r, V_MUL(t, c));
+        // y = 1 - ((lo - (r * c) / (2 - c)) - hi)
+        y = V_SUB(V_SET1(1.0), V_SUB(V_SUB(lo, V_DIV(V_MUL(r, c), V_SUB(V_SET1(2.0), c))), hi));
+    }
+    else {
+        VD r = V_ADD(V_FMA(kd, V_SET1(-VM_LN2_LO), hi), xtail);
+        VD r2 = V_MUL(r, r);
+        VD r4 = V_MUL(r2, r2);
+        VD q0 = V_FMA(V_FMA(r, V_SET1(EXP_C3), V_SET1(EXP_C2)), r2, V_FMA(r, V_SET1(EXP_C1), V_SET1(EXP_C0)));
+        VD q1 = V_FMA(V_FMA(r, V_SET1(EXP_C7), V_SET1(EXP_C6)), r2, V_FMA(r, V_SET1(EXP_C5), V_SET1(EXP_C4)));
+        VD q2 = V_FMA(V_FMA(r, V_SET1(EXP_C11), V_SET1(EXP_C10)), r2, V_FMA(r, V_SET1(EXP_C9), V_SET1(EXP_C8)));
+        y = V_FMA(q2, V_MUL(r4, r4), V_FMA(q1, r4, q0));
+    }
+    return V_FN(vm_scale)(y, k);
+}
+
+/**
+ * log(x) for positive finite x (subnormals included).
+ * x = 2^k * z with z near 1, z is scaled by an 8-bit table entry 1/c so that r = z/c - 1 is tiny,
+ * and log(x) = k*ln2 + log(c) + log1p(r). With extended set the result is returned as
+ * y + *tail with about 2^-68 relative error (used by pow); otherwise *tail is not written.
+ */
+V_TARGET static inline VD V_FN(vm_log_core)(VD x, VD* tail, int extended) {
+    VM sub = V_CMP_LT(x, V_SET1(0x1p-1022));
+    VD xs = V_SELECT(sub, V_MUL(x, V_SET1(0x1p52)), x);
+    VI ix = V_AS_VI(xs);
+    VI j = VI_AND(VI_SHR(ix, 52 - LOG_TABLE_BITS), VI_SET1(LOG_TABLE_SIZE - 1));
+    VD m = VI_AS_V(VI_OR(VI_AND(ix, VI_SET1(0x000fffffffffffffLL)), VI_SET1(0x3ff0000000000000LL)));
+    VM upper = V_CMP_GE(m, V_SET1(LOG_SPLIT)); // Upper mantissas are halved so that z is centred on 1
+    VD z = V_SELECT(upper, V_MUL(m, V_SET1(0.5)), m);
+    VD kd = V_FN(vm_to_double)(VI_SUB(VI_SHR(ix, 52), VI_SET1(1023)));
+    VD invc = V_GATHER(log_table_invc, j);
+    VD logc = V_GATHER(log_table_logc, j);
+
+    kd = V_ADD(kd, V_ADD(V_SELECT(sub, V_SET1(-52.0), V_SET1(0.0)), V_SELECT(upper, V_SET1(1.0), V_SET1(0.0))));
+
+    if (!extended) {
+        VD r = V_FMA(z, invc, V_SET1(-1.0));
+        VD p = V_FMA(r, V_SET1(LOG_C8), V_SET1(LOG_C7));
+        p = V_FMA(r, p, V_SET1(LOG_C6));
+        p = V_FMA(r, p, V_SET1(LOG_C5));
+        p = V_FMA(r, p, V_SET1(LOG_C4));
+        p = V_FMA(r, p, V_SET1(LOG_C3));
+        p = V_FMA(r, p, V_SET1(LOG_C2));
+        return V_ADD(V_FMA(kd, V_SET1(VM_LN2), logc), V_FMA(V_MUL(r, r), p, r));
+    }
+    else {
+        VD logctail = V_GATHER(log_table_logctail, j);
+        VD ph = V_MUL(z, invc);
+        VD pl = V_FMA(z, invc, V_NEG(ph)); // z*invc = ph + pl exactly
+        VD rh = V_SUB(ph, V_SET1(1.0));    // Exact
+        VD e1, e2, e3, hi, lo, y, p;
+        VD t1 = V_FN(vm_two_sum)(V_MUL(kd, V_SET1(VM_LN2_HI)), logc, &e1);
+        VD t2 = V_FN(vm_two_sum)(t1, rh, &e2);
+        VD hr = V_MUL(V_SET1(-0.5), rh);
+        VD sq = V_MUL(hr, rh);
+        VD sq_err = V_FMA(hr, rh, V_NEG(sq));
+        hi = V_FN(vm_two_sum)(t2, sq, &e3);
+
+        // log1p(r) - r + r^2/2 = r^3 * (1/3 - r/4 + ... - r^7/10)
+        p = V_FMA(rh, V_SET1(LOG_C10), V_SET1(LOG_C9));
+        p = V_FMA(rh, p, V_SET1(LOG_C8));
+        p = V_FMA(rh, p, V_SET1(LOG_C7));
+        p = V_FMA(rh, p, V_SET1(LOG_C6));
+        p = V_FMA(rh, p, V_SET1(LOG_C5));
+        p = V_FMA(rh, p, V_SET1(LOG_C4));
+        p = V_FMA(rh, p, V_SET1(LOG_C3));
+        p = V_MUL(V_MUL(V_MUL(rh, rh), rh), p);
+
+        lo = V_ADD(V_ADD(e1, e2), V_ADD(e3, sq_err));
+        lo = V_ADD(lo, V_FMA(kd, V_SET1(VM_LN2_LO), logctail));
+        lo = V_ADD(lo, V_FMA(V_NEG(pl), rh, pl)); // log1p(rh + pl) = log1p(rh) + pl * (1 - rh + ...)
+        lo = V_ADD(lo, p);
+        y = V_ADD(hi, lo);
+        *tail = V_ADD(V_SUB(hi, y), lo);
+        return y;
+    }
+}
+
+/**
+ * x^n for integral |n| <= POW_INT_MAX by exponentiation by squaring in double-double arithmetic,
+ * so the only significant error is the final rounding.
+ */
+V_TARGET static inline VD V_FN(vm_pow_int)(VD x, VD y) {
+    VI n = V_FN(vm_to_int)(V_ABS(y));
+    VI zero = VI_SET1(0), one = VI_SET1(1);
+    VD bh = x, bl = V_SET1(0.0), ah = V_SET1(1.0), al = V_SET1(0.0);
+    VD result, q, e;
+
+    for (;;) {
+        VM odd = VI_CMP_EQ(VI_AND(n, one), one);
+        if (M_BITS(odd)) {
+            VD p = V_MUL(ah, bh);
+            VD pe = V_FMA(al, bh, V_FMA(ah, bl, V_FMA(ah, bh, V_NEG(p))));
+            VD h = V_ADD(p, pe);
+            ah = V_SELECT(odd, h, ah);
+            al = V_SELECT(odd, V_SUB(pe, V_SUB(h, p)), al);
+        }
+        n = VI_SHR(n, 1);
+        if (M_BITS(VI_CMP_EQ(n, zero)) == M_FULL) break;
+        {
+            VD p = V_MUL(bh, bh);
+            VD pe = V_FMA(V_ADD(bh, bh), bl, V_FMA(bh, bh, V_NEG(p)));
+            bh = V_ADD(p, pe);
+            bl = V_SUB(pe, V_SUB(bh, p));
+        }
+    }
+
+    // Negative exponents: reciprocal of the double-double power
+    q = V_DIV(V_SET1(1.0), ah);
+    e = V_SUB(V_FMA(V_NEG(q), ah, V_SET1(1.0)), V_MUL(q, al));
+    result = V_SELECT(V_CMP_LT(y, V_SET1(0.0)), V_FMA(q, e, q), V_ADD(ah, al));
+    return result;
+}
+
+V_TARGET static void V_FN(exp_block)(const double* x, double* out, int accurate) {
+    VD vx = V_LOADU(x);
+    VD y = V_FN(vm_exp_core)(vx, V_SET1(0.0), accurate);
+    V_STOREU(out, V_SELECT(V_CMP_UNORD(vx, vx), vx, y));
+}
+
+// Returns the mask of the lanes with a non-positive input
+V_TARGET static unsigned V_FN(log_block)(const double* x, double* out, int accurate) {
+    VD vx = V_LOADU(x);
+    VM bad = V_CMP_LE(vx, V_SET1(0.0));
+    VM regular = M_AND(V_CMP_GT(vx, V_SET1(0.0)), V_CMP_LT(vx, V_SET1(INFINITY)));
+    VD tail;
+    VD y = V_FN(vm_log_core)(V_SELECT(regular, vx, V_SET1(1.0)), &tail, accurate);
+
+    y = V_SELECT(regular, y, vx); // +inf and NaN are returned unchanged
+    V_STOREU(out, V_SELECT(bad, V_SET1(NAN), y));
+    return M_BITS(bad);
+}
+
+V_TARGET static void V_FN(pow_block)(const double* x, const double* y, double* out, int accurate) {
+    VD vx = V_LOADU(x);
+    VD vy = V_LOADU(y);
+    VD ax = V_ABS(vx);
+    VD zero = V_SET1(0.0);
+    VM regular = M_AND(M_AND(V_CMP_LT(ax, V_SET1(INFINITY)), V_CMP_LT(V_ABS(vy), V_SET1(INFINITY))), V_CMP_NEQ(vx, zero));
+    VM integral = M_AND(regular, V_CMP_EQ(V_TRUNC(vy), vy));
+    VM small = M_AND(integral, V_CMP_LE(V_ABS(vy), V_SET1(POW_INT_MAX)));
+    VM general = M_ANDNOT(regular, small);
+    VM negative = V_CMP_LT(vx, zero);
+    VD result = V_SET1(NAN); // Negative base with a non-integral exponent
+    unsigned special;
+
+    if (M_BITS(small)) {
+        VD r = V_FN(vm_pow_int)(V_SELECT(small, vx, V_SET1(1.0)), V_SELECT(small, vy, zero));
+        VD ar = V_ABS(r);
+        // Overflow, underflow and subnormal results go through the exp/log path instead
+        VM fine = M_AND(small, M_AND(V_CMP_GE(ar, V_SET1(0x1p-1022)), V_CMP_LT(ar, V_SET1(INFINITY))));
+        general = M_OR(general, M_ANDNOT(small, fine));
+        result = V_SELECT(fine, r, result);
+    }
+
+    // Lanes with a negative base need an integral exponent
+    general = M_ANDNOT(general, M_ANDNOT(negative, integral));
+    if (M_BITS(general)) {
+        VD ey = V_SELECT(general, vy, zero);
+        VD ltail, lh = V_FN(vm_log_core)(V_SELECT(general, ax, V_SET1(1.0)), &ltail, 1);
+        VD eh = V_MUL(ey, lh);
+        VD el = V_FMA(ey, ltail, V_FMA(ey, lh, V_NEG(eh)));
+        VD r = V_FN(vm_exp_core)(eh, el, accurate);
+        VD half = V_MUL(ey, V_SET1(0.5));
+        // A negative base with an odd integral exponent gives a negative result
+        VM odd = M_AND(negative, V_CMP_NEQ(V_TRUNC(half), half));
+        r = V_SELECT(odd, V_NEG(r), r);
+        result = V_SELECT(general, r, result);
+    }
+
+    V_STOREU(out, result);
+
+    // Zero, infinite and NaN operands follow the C library's pow() rules
+    for (special = M_BITS(regular) ^ M_FULL; special; special &= special - 1) {
+        int lane = 0;
+        while (((special >> lane) & 1) == 0) lane++;
+        out[lane] = pow(x[lane], y[lane]);
+    }
+}
+
+/**
+ * sin and cos of an angle in degrees, computed together.
+ * The angle is reduced exactly: deg - 360*q, then r - 90*n leaves x in [-45, 45] and the quadrant
+ * n mod 4. Multiples of 90 give exact zeros and ones, and x = +-30 and +-45 use correctly rounded
+ * constants; other angles go through fdlibm's sin/cos kernels with x*pi/180 split into head and tail.
+ */
+V_TARGET static inline void V_FN(vm_sincos_deg)(VD deg, VD* sine, VD* cosine) {
+    VD q = V_SUB(V_ADD(V_DIV(deg, V_SET1(360.0)), V_SET1(VM_SHIFT)), V_SET1(VM_SHIFT));
+    VD r = V_FMA(V_NEG(q), V_SET1(360.0), deg); // Exact for |deg| < 2^50
+    VD nd = V_ADD(V_DIV(r, V_SET1(90.0)), V_SET1(VM_SHIFT));
+    VI n = VI_SUB(V_AS_VI(nd), V_AS_VI(V_SET1(VM_SHIFT)));
+    VD x = V_FMA(V_NEG(V_SUB(nd, V_SET1(VM_SHIFT))), V_SET1(90.0), r); // Exact
+    VD ax = V_ABS(x);
+    VD hi = V_MUL(x, V_SET1(TRIG_DEG_HI));
+    VD lo = V_FMA(x, V_SET1(TRIG_DEG_LO), V_FMA(x, V_SET1(TRIG_DEG_HI), V_NEG(hi)));
+    VD z = V_MUL(hi, hi);
+    VD v = V_MUL(z, hi);
+    VD zero = V_SET1(0.0);
+    VD ps, pc, s, c, hz, w;
+    VM at30, at45, swap;
+
+    ps = V_FMA(z, V_SET1(TRIG_S6), V_SET1(TRIG_S5));
+    ps = V_FMA(z, ps, V_SET1(TRIG_S4));
+    ps = V_FMA(z, ps, V_SET1(TRIG_S3));
+    ps = V_FMA(z, ps, V_SET1(TRIG_S2));
+    // sin(hi + lo) = hi - ((z*(lo/2 - v*ps) - lo) - v*S1)
+    s = V_SUB(hi, V_SUB(V_SUB(V_MUL(z, V_SUB(V_MUL(V_SET1(0.5), lo), V_MUL(v, ps))), lo), V_MUL(v, V_SET1(TRIG_S1))));
+
+    pc = V_FMA(z, V_SET1(TRIG_C6), V_SET1(TRIG_C5));
+    pc = V_FMA(z, pc, V_SET1(TRIG_C4));
+    pc = V_FMA(z, pc, V_SET1(TRIG_C3));
+    pc = V_FMA(z, pc, V_SET1(TRIG_C2));
+    pc = V_FMA(z, pc, V_SET1(TRIG_C1));
+    pc = V_MUL(z, pc);
+    // cos(hi + lo) = w + (((1 - w) - z/2) + (z*pc - hi*lo)) with w = 1 - z/2
+    hz = V_MUL(V_SET1(0.5), z);
+    w = V_SUB(V_SET1(1.0), hz);
+    c = V_ADD(w, V_ADD(V_SUB(V_SUB(V_SET1(1.0), w), hz), V_SUB(V_MUL(z, pc), V_MUL(hi, lo))));
+
+    at30 = V_CMP_EQ(ax, V_SET1(30.0));
+    at45 = V_CMP_EQ(ax, V_SET1(45.0));
+    s = V_SELECT(at30, V_SELECT(V_CMP_LT(x, zero), V_SET1(-0.5), V_SET1(0.5)), s);
+    c = V_SELECT(at30, V_SET1(TRIG_COS30), c);
+    s = V_SELECT(at45, V_SELECT(V_CMP_LT(x, zero), V_SET1(-TRIG_COS45), V_SET1(TRIG_COS45)), s);
+    c = V_SELECT(at45, V_SET1(TRIG_COS45), c);
+
+    // Quadrants: (s, c), (c, -s), (-s, -c), (-c, s); 0 - v keeps exact zeros positive
+    swap = VI_CMP_EQ(VI_AND(n, VI_SET1(1)), VI_SET1(1));
+    *sine = V_SELECT(swap, c, s);
+    *cosine = V_SELECT(swap, V_SUB(zero, s), c);
+    *sine = V_SELECT(VI_CMP_EQ(VI_AND(n, VI_SET1(2)), VI_SET1(2)), V_SUB(zero, *sine), *sine);
+    *cosine = V_SELECT(VI_CMP_EQ(VI_AND(n, VI_SET1(2)), VI_SET1(2)), V_SUB(zero, *cosine), *cosine);
+}
+
+// Loads a block of angles; lanes too large for the exact reduction are reduced with fmod() first
+V_TARGET static inline VD V_FN(vm_load_angles)(const double* deg) {
+    VD d = V_LOADU(deg);
+    unsigned huge = M_BITS(V_CMP_GE(V_ABS(d), V_SET1(0x1p50)));
+    if (huge) {
+        double reduced[V_WIDTH];
+        memcpy(reduced, deg, sizeof(reduced));
+        for (int lane = 0; lane < V_WIDTH; lane++) {
+            if ((huge >> lane) & 1) reduced[lane] = fmod(reduced[lane], 360.0);
+        }
+        d = V_LOADU(reduced);
+    }
+    return d;
+}
+
+V_TARGET static void V_FN(sincos_block)(const double* deg, double* sine, double* cosine) {
+    VD s, c;
+    V_FN(vm_sincos_deg)(V_FN(vm_load_angles)(deg), &s, &c);
+    V_STOREU(sine, s);
+    V_STOREU(cosine, c);
+}
+
+// tan (cotangent: cos/sin) of a block; returns the mask of the asymptote lanes, which get NAN
+V_TARGET static unsigned V_FN(tan_block)(const double* deg, double* out, int cotangent) {
+    VD s, c, num, den, q, an, ad, exact;
+    VM bad, at30, at60;
+    V_FN(vm_sincos_deg)(V_FN(vm_load_angles)(deg), &s, &c);
+    num = cotangent ? c : s;
+    den = cotangent ? s : c;
+    bad = V_CMP_EQ(den, V_SET1(0.0));
+    q = V_DIV(num, den);
+    // At the other multiples of 30 (the exact sin and cos of vm_sincos_deg()), the quotient of the
+    // rounded sin and cos can be off by an ulp: the correctly rounded 1/sqrt(3) and sqrt(3) instead
+    an = V_ABS(num);
+    ad = V_ABS(den);
+    at30 = M_AND(V_CMP_EQ(an, V_SET1(0.5)), V_CMP_EQ(ad, V_SET1(TRIG_COS30)));
+    at60 = M_AND(V_CMP_EQ(an, V_SET1(TRIG_COS30)), V_CMP_EQ(ad, V_SET1(0.5)));
+    exact = V_SELECT(at30, V_SET1(TRIG_TAN30), V_SET1(TRIG_TAN60));
+    q = V_SELECT(M_OR(at30, at60), V_SELECT(V_CMP_LT(q, V_SET1(0.0)), V_NEG(exact), exact), q);
+    // Exact zeros (180k for tan, 90 + 180k for cot) are returned as +0 whatever the quadrant signs
+    V_STOREU(out, V_SELECT(bad, V_SET1(NAN), V_SELECT(V_CMP_EQ(num, V_SET1(0.0)), V_SET1(0.0), q)));
+    return M_BITS(bad);
+}
+
+// Angle addition: sin/cos(a + t) from s = sin a, c = cos a and a block of sin t (ts) and cos t (tc)
+V_TARGET static void V_FN(rotate_block)(VD s, VD c, const double* ts, const double* tc, double* sine, double* cosine) {
+    VD st = V_LOADU(ts), ct = V_LOADU(tc);
+    V_STOREU(sine, V_FMA(s, ct, V_MUL(c, st)));
+    V_STOREU(cosine, V_FMA(c, ct, V_NEG(V_MUL(s, st))));
+}
+
+// --- Array drivers: whole vectors, then the tail through a padded block ---
+
+V_TARGET static void V_FN(exp_array)(const double* x, double* out, size_t n, int accurate) {
+    size_t i = 0;
+    for (; i + V_WIDTH <= n; i += V_WIDTH) V_FN(exp_block)(x + i, out + i, accurate);
+    if (i < n) {
+        double tx[V_WIDTH], to[V_WIDTH];
+        size_t rest = n - i;
+        for (size_t t = 0; t < V_WIDTH; t++) tx[t] = t < rest ? x[i + t] : 0.0;
+        V_FN(exp_block)(tx, to, accurate);
+        memcpy(out + i, to, rest * sizeof(double));
+    }
+}
+
+V_TARGET static size_t V_FN(log_array)(const double* x, double* out, size_t n, int accurate, unsigned char* errors) {
+    size_t failures = 0;
+    for (size_t i = 0; i < n; i += V_WIDTH) {
+        double tx[V_WIDTH], to[V_WIDTH];
+        size_t rest = n - i < V_WIDTH ? n - i : V_WIDTH;
+        unsigned bad;
+        if (rest == V_WIDTH) {
+            bad = V_FN(log_block)(x + i, out + i, accurate);
+        }
+        else {
+            for (size_t t = 0; t < V_WIDTH; t++) tx[t] = t < rest ? x[i + t] : 1.0;
+            bad = V_FN(log_block)(tx, to, accurate) & ((1u << rest) - 1);
+            memcpy(out + i, to, rest * sizeof(double));
+        }
+        if (errors != NULL) {
+            if (i % 8 == 0) errors[i / 8] = 0;
+            errors[i / 8] |= (unsigned char)(bad << (i % 8));
+        }
+        for (; bad; bad &= bad - 1) failures++;
+    }
+    return failures;
+}
+
+V_TARGET static void V_FN(pow_array)(const double* x, const double* y, double* out, size_t n, int accurate) {
+    size_t i = 0;
+    for (; i + V_WIDTH <= n; i += V_WIDTH) V_FN(pow_block)(x + i, y + i, out + i, accurate);
+    if (i < n) {
+        double tx[V_WIDTH], ty[V_WIDTH], to[V_WIDTH];
+        size_t rest = n - i;
+        for (size_t t = 0; t < V_WIDTH; t++) {
+            tx[t] = t < rest ? x[i + t] : 1.0;
+            ty[t] = t < rest ? y[i + t] : 1.0;
+        }
+        V_FN(pow_block)(tx, ty, to, accurate);
+        memcpy(out + i, to, rest * sizeof(double));
+    }
+}
+
+V_TARGET static void V_FN(sincos_array)(const double* deg, double* sine, double* cosine, size_t n) {
+    size_t i = 0;
+    for (; i + V_WIDTH <= n; i += V_WIDTH) V_FN(sincos_block)(deg + i, sine + i, cosine + i);
+    if (i < n) {
+        double td[V_WIDTH], ts[V_WIDTH], tc[V_WIDTH];
+        size_t rest = n - i;
+        for (size_t t = 0; t < V_WIDTH; t++) td[t] = t < rest ? deg[i + t] : 0.0;
+        V_FN(sincos_block)(td, ts, tc);
+        memcpy(sine + i, ts, rest * sizeof(double));
+        memcpy(cosine + i, tc, rest * sizeof(double));
+    }
+}
+
+V_TARGET static void V_FN(rotate_array)(double s, double c, const double* ts, const double* tc, double* sine,
+    double* cosine, size_t n) {
+    VD vs = V_SET1(s), vc = V_SET1(c);
+    size_t i = 0;
+    for (; i + V_WIDTH <= n; i += V_WIDTH) V_FN(rotate_block)(vs, vc, ts + i, tc + i, sine + i, cosine + i);
+    if (i < n) {
+        double tts[V_WIDTH], ttc[V_WIDTH], to_s[V_WIDTH], to_c[V_WIDTH];
+        size_t rest = n - i;
+        for (size_t t = 0; t < V_WIDTH; t++) {
+            tts[t] = t < rest ? ts[i + t] : 0.0;
+            ttc[t] = t < rest ? tc[i + t] : 1.0;
+        }
+        V_FN(rotate_block)(vs, vc, tts, ttc, to_s, to_c);
+        memcpy(sine + i, to_s, rest * sizeof(double));
+        memcpy(cosine + i, to_c, rest * sizeof(double));
+    }
+}
+
+V_TARGET static size_t V_FN(tan_array)(const double* deg, double* out, size_t n, int cotangent, unsigned char* errors) {
+    size_t failures = 0;
+    for (size_t i = 0; i < n; i += V_WIDTH) {
+        double td[V_WIDTH], to[V_WIDTH];
+        size_t rest = n - i < V_WIDTH ? n - i : V_WIDTH;
+        unsigned bad;
+        if (rest == V_WIDTH) {
+            bad = V_FN(tan_block)(deg + i, out + i, cotangent);
+        }
+        else {
+            for (size_t t = 0; t < V_WIDTH; t++) td[t] = t < rest ? deg[i + t] : 45.0;
+            bad = V_FN(tan_block)(td, to, cotangent) & ((1u << rest) - 1);
+            memcpy(out + i, to, rest * sizeof(double));
+        }
+        if (errors != NULL) {
+            if (i % 8 == 0) errors[i / 8] = 0;
+            errors[i / 8] |= (unsigned char)(bad << (i % 8));
+        }
+        for (; bad; bad &= bad - 1) failures++;
+    }
+    return failures;
+}
@@ -0,0 +1,185 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "BigInt.h"
+#include "Check.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Known answers of the arbitrary-precision kernels (BigInt.c, BigConv.c, Factorial.c), and the
+ * Karatsuba and number-theoretic transform multiplications against schoolbook products.
+ */
+
+typedef struct {
+    char* text;
+    size_t len, capacity;
+} TextBuffer;
+
+static int write_text(void* context, const char* text, size_t len) {
+    TextBuffer* buf = (TextBuffer*)context;
+    if (buf->len + len + 1 > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 256;
+        char* grown;
+        while (capacity < buf->len + len + 1) capacity *= 2;
+        grown = (char*)realloc(buf->text, capacity);
+        if (grown == NULL) return 0;
+        buf->text = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->text + buf->len, text, len);
+    buf->len += len;
+    buf->text[buf->len] = '\0';
+    return 1;
+}
+
+// The decimal digits of a radix-2^32 number, in a buffer the caller frees
+static char* decimal_text(const uint32_t* a, size_t n) {
+    TextBuffer buf = { NULL, 0, 0 };
+    if (!bigint_write_dec(a, n, write_text, &buf)) {
+        free(buf.text);
+        return NULL;
+    }
+    return buf.text;
+}
+
+static void check_decimal(const uint32_t* a, size_t n, const char* expected) {
+    char* text = decimal_text(a, n);
+    CHECK(text != NULL);
+    if (text != NULL) CHECK_STR(text, expected);
+    free(text);
+}
+
+static void test_small(void) {
+    uint32_t a[3] = { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF }; // 2^96 - 1
+    uint32_t b[3] = { 12345, 0, 1 };                        // 2^64 + 12345
+    uint32_t r[6], q[5];
+    static const uint32_t product[6] = { 0xFFFFCFC7, 0xFFFFFFFF, 0xFFFFFFFE, 0x3038, 0, 1 };
+    uint32_t ten_40[6] = { 0 };
+
+    CHECK(bigint_mul_bin(r, a, 3, b, 3) == 1);
+    CHECK(memcmp(r, product, sizeof(product)) == 0);
+    CHECK(bigint_add_bin(r, a, 3, b, 3) == 1);
+    CHECK(r[0] == 12344 && r[1] == 0 && r[2] == 1);
+    CHECK(bigint_trim(product, 6) == 6 && bigint_trim(r, 2) == 1 && bigint_trim(product + 4, 1) == 0);
+    check_decimal(a, 3, "79228162514264337593543950335");
+    check_decimal(product, 0, "0");
+
+    // 10^40 + 7 = 9999999930000000489999996570000 * 1000000007 + 24010007
+    ten_40[0] = 1;
+    for (int i = 0; i < 40; i++) bigint_mul_1_bin(ten_40, ten_40, 5, 10, 0);
+    ten_40[0] += 7;
+    check_decimal(ten_40, 5, "10000000000000000000000000000000000000007");
+    memcpy(q, ten_40, sizeof(q));
+    CHECK(bigint_divmod_1_bin(q, q, 5, 1000000007) == 24010007);
+    check_decimal(q, 5, "9999999930000000489999996570000");
+
+    CHECK(bigint_to_double_bin(a, 3) == 0x1p96);
+    CHECK(bigint_to_double_bin(b, 3) == 0x1p64 + 12288); // To the nearest multiple of 2^12
+}
+
+static void check_factorial(uint32_t n, const char* expected) {
+    uint32_t* result = NULL;
+    size_t len = 0;
+    CHECK(bigint_factorial(n, &result, &len) == 1);
+    check_decimal(result, len, expected);
+    free(result);
+}
+
+static void check_binomial(uint32_t n, uint32_t k, const char* expected) {
+    uint32_t* result = NULL;
+    size_t len = 0;
+    CHECK(bigint_binomial(n, k, &result, &len) == 1);
+    check_decimal(result, len, expected);
+    free(result);
+}
+
+static void test_factorials(void) {
+    uint32_t* result = NULL;
+    size_t len = 0, zeros = 0;
+    char* text;
+    long digit_sum = 0;
+
+    check_factorial(0, "1");
+    check_factorial(1, "1");
+    check_factorial(20, "2432902008176640000");
+    check_factorial(30, "265252859812191058636308480000000");
+    check_binomial(10, 0, "1");
+    check_binomial(64, 32, "1832624140942590534");
+    check_binomial(100, 50, "100891344545564193334812497256");
+    // Small min(k, n - k): products of the top factors, without sieving up to n
+    check_binomial(1000, 30, "2429608192173745103270389838576750719302222606198631438800");
+    check_binomial(1000, 970, "2429608192173745103270389838576750719302222606198631438800");
+    check_binomial(2000000000, 1, "2000000000");
+    check_binomial(4294967295, 4294967293, "9223372030412324865");
+
+    // 1000! has 2568 digits, 249 trailing zeros and a digit sum of 10539
+    CHECK(bigint_factorial(1000, &result, &len) == 1);
+    text = decimal_text(result, len);
+    CHECK(text != NULL);
+    if (text != NULL) {
+        size_t digits = strlen(text);
+        for (size_t i = 0; i < digits; i++) digit_sum += text[i] - '0';
+        while (zeros < digits && text[digits - 1 - zeros] == '0') zeros++;
+        CHECK(digits == 2568 && zeros == 249 && digit_sum == 10539);
+    }
+    free(text);
+    free(result);
+}
+
+// r = a * b one limb of b at a time, the reference for the fast multiplications
+static void schoolbook_mul(uint32_t* r, const uint32_t* a, size_t an, const uint32_t* b, size_t bn, uint32_t radix) {
+    memset(r, 0, (an + bn) * sizeof(uint32_t));
+    for (size_t j = 0; j < bn; j++) {
+        uint64_t carry = 0;
+        for (size_t i = 0; i < an; i++) {
+            uint64_t t = (uint64_t)a[i] * b[j] + r[i + j] + carry;
+            r[i + j] = radix ? (uint32_t)(t % radix) : (uint32_t)t;
+            carry = radix ? t / radix : t >> 32;
+        }
+        r[an + j] = (uint32_t)carry;
+    }
+}
+
+static void check_mul(size_t an, size_t bn, int decimal) {
+    uint32_t* a = (uint32_t*)malloc(an * sizeof(uint32_t));
+    uint32_t* b = (uint32_t*)malloc(bn * sizeof(uint32_t));
+    uint32_t* r = (uint32_t*)malloc((an + bn) * sizeof(uint32_t));
+    uint32_t* expected = (uint32_t*)malloc((an + bn) * sizeof(uint32_t));
+    uint32_t radix = decimal ? 1000000000 : 0;
+    uint64_t state = 88172645463325252ULL + an;
+    int ok;
+
+    CHECK(a != NULL && b != NULL && r != NULL && expected != NULL);
+    if (a != NULL && b != NULL && r != NULL && expected != NULL) {
+        for (size_t i = 0; i < an + bn; i++) {
+            uint32_t limb;
+            state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+            limb = i % 97 == 0 ? (decimal ? 999999999 : 0xFFFFFFFF) : (uint32_t)(state >> 32); // Some maximal limbs
+            if (decimal) limb %= 1000000000;
+            if (i < an) a[i] = limb;
+            else b[i - an] = limb;
+        }
+        ok = decimal ? bigint_mul_dec(r, a, an, b, bn) : bigint_mul_bin(r, a, an, b, bn);
+        schoolbook_mul(expected, a, an, b, bn, radix);
+        if (!ok || memcmp(r, expected, (an + bn) * sizeof(uint32_t)) != 0) {
+            printf("bigint_mul_%s of %zu by %zu limbs differs from the schoolbook product\n", decimal ? "dec" : "bin", an, bn);
+            check_failures++;
+        }
+    }
+    free(a);
+    free(b);
+    free(r);
+    free(expected);
+}
+
+int main(void) {
+    test_small();
+    test_factorials();
+    for (int decimal = 0; decimal <= 1; decimal++) {
+        check_mul(31, 17, decimal);     // Schoolbook
+        check_mul(200, 150, decimal);   // Karatsuba
+        check_mul(1000, 37, decimal);   // Unbalanced
+        check_mul(5000, 4500, decimal); // Number-theoretic transform
+    }
+    return CHECK_RESULT();
+}
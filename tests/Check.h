@@ -0,0 +1,44 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * The few macros of the known-answer tests: each failed check prints where and what, and the
+ * test program returns CHECK_RESULT() (non-zero if anything failed) to ctest.
+ */
+
+static int check_failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            check_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_STR(actual, expected) \
+    do { \
+        const char* check_actual_ = (actual); \
+        const char* check_expected_ = (expected); \
+        if (strcmp(check_actual_, check_expected_) != 0) { \
+            printf("%s:%d: \"%s\", expected \"%s\"\n", __FILE__, __LINE__, check_actual_, check_expected_); \
+            check_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_U64(actual, expected) \
+    do { \
+        unsigned long long check_actual_ = (actual); \
+        unsigned long long check_expected_ = (expected); \
+        if (check_actual_ != check_expected_) { \
+            printf("%s:%d: %llu, expected %llu\n", __FILE__, __LINE__, check_actual_, check_expected_); \
+            check_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_RESULT() (check_failures == 0 ? 0 : 1)
+
+#endif // CHECK_H
@@ -0,0 +1,251 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Columns.h"
+#include "VectorMath.h"
+#include "BaseConv.h"
+#include "Precision.h"
+#include "Simd.h"
+#include "Check.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+/*
+ * The SIMD kernels of Columns.c, VectorMath.c, BaseConv.c and the float expression VM of
+ * Precision.c on pseudo-random inputs: one line
+ * "<kernel> <hash of the result bits>" per kernel on stdout. RunKernelTests.cmake runs the program
+ * at every CALC_SIMD level and compares the lines, since the scalar, AVX2 and AVX-512 kernels
+ * must return bit-identical results.
+ */
+
+#define KERNEL_COUNT 1000000
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+// splitmix64
+static uint64_t next_random(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [lo, hi)
+static double random_in(double lo, double hi) {
+    return lo + (hi - lo) * ((double)(next_random() >> 11) * 0x1p-53);
+}
+
+// FNV-1a over the bytes of n results
+static uint64_t hash_bytes(const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+    return hash;
+}
+
+static void report(const char* kernel, const void* data, size_t size) {
+    printf("%s %016llx\n", kernel, (unsigned long long)hash_bytes(data, size));
+}
+
+static void test_columns(double* a, double* b, double* out) {
+    long long *ia = (long long*)malloc(KERNEL_COUNT * sizeof(long long));
+    long long *ib = (long long*)malloc(KERNEL_COUNT * sizeof(long long));
+    long long* iout = (long long*)malloc(KERNEL_COUNT * sizeof(long long));
+    unsigned char errors[(KERNEL_COUNT + 7) / 8];
+
+    CHECK(ia != NULL && ib != NULL && iout != NULL);
+    if (ia == NULL || ib == NULL || iout == NULL) { free(ia); free(ib); free(iout); return; }
+    for (size_t i = 0; i < KERNEL_COUNT; i++) {
+        a[i] = random_in(-1e6, 1e6);
+        b[i] = i % 97 == 0 ? 0.0 : random_in(-1e3, 1e3);
+        ia[i] = (long long)(next_random() >> 1) * (i % 2 ? 1 : -1);
+        ib[i] = i % 89 == 0 ? 0 : (long long)((next_random() >> (i % 63 + 1)) | 1) * (i % 3 ? 1 : -1);
+    }
+    add_n(a, b, out, KERNEL_COUNT);
+    report("add_n", out, KERNEL_COUNT * sizeof(double));
+    subtract_n(a, b, out, KERNEL_COUNT);
+    report("subtract_n", out, KERNEL_COUNT * sizeof(double));
+    multiply_n(a, b, out, KERNEL_COUNT);
+    report("multiply_n", out, KERNEL_COUNT * sizeof(double));
+    CHECK_U64(divide_n(a, b, out, KERNEL_COUNT, errors), (KERNEL_COUNT + 96) / 97);
+    report("divide_n", out, KERNEL_COUNT * sizeof(double));
+    report("divide_n/errors", errors, sizeof(errors));
+    for (size_t i = 0; i < KERNEL_COUNT; i++) a[i] = random_in(0, 100);
+    power_n(a, b, out, KERNEL_COUNT);
+    report("power_n", out, KERNEL_COUNT * sizeof(double));
+    CHECK_U64(remainder_n(ia, ib, iout, KERNEL_COUNT, errors), (KERNEL_COUNT + 88) / 89);
+    report("remainder_n", iout, KERNEL_COUNT * sizeof(long long));
+    report("remainder_n/errors", errors, sizeof(errors));
+    free(ia);
+    free(ib);
+    free(iout);
+}
+
+static void test_exp_log_pow(double* x, double* y, double* out) {
+    static const char* const tiers[] = { "fast", "accurate" };
+    unsigned char errors[(KERNEL_COUNT + 7) / 8];
+    char name[32];
+
+    for (int tier = CALC_MATH_FAST; tier <= CALC_MATH_ACCURATE; tier++) {
+        rng_state = 1;
+        for (size_t i = 0; i < KERNEL_COUNT; i++) x[i] = random_in(-746, 710);
+        exp_n(x, out, KERNEL_COUNT, (CalcMathTier)tier);
+        snprintf(name, sizeof(name), "exp_n/%s", tiers[tier]);
+        report(name, out, KERNEL_COUNT * sizeof(double));
+
+        // Normal and subnormal magnitudes, and a few non-positive inputs
+        for (size_t i = 0; i < KERNEL_COUNT; i++) x[i] = i % 1000 == 0 ? -random_in(0, 1) : ldexp(random_in(1, 2), (int)(next_random() % 2100) - 1074);
+        CHECK_U64(log_n(x, out, KERNEL_COUNT, (CalcMathTier)tier, errors), KERNEL_COUNT / 1000);
+        snprintf(name, sizeof(name), "log_n/%s", tiers[tier]);
+        report(name, out, KERNEL_COUNT * sizeof(double));
+
+        // Fractional and small integral exponents (the exponentiation by squaring path)
+        for (size_t i = 0; i < KERNEL_COUNT; i++) {
+            x[i] = random_in(0, 1000);
+            y[i] = i % 4 == 0 ? (double)((int)(next_random() % 129) - 64) : random_in(-100, 100);
+        }
+        pow_n(x, y, out, KERNEL_COUNT, (CalcMathTier)tier);
+        snprintf(name, sizeof(name), "pow_n/%s", tiers[tier]);
+        report(name, out, KERNEL_COUNT * sizeof(double));
+    }
+}
+
+static void test_trig(double* deg, double* sine, double* cosine) {
+    unsigned char errors[(KERNEL_COUNT + 7) / 8];
+
+    // Arbitrary angles, with every multiple of 15 in [-720, 720] among them
+    for (size_t i = 0; i < KERNEL_COUNT; i++) deg[i] = i % 8 == 0 ? (double)((long)(next_random() % 97) * 15 - 720) : random_in(-1e5, 1e5);
+    sincos_deg_n(deg, sine, cosine, KERNEL_COUNT);
+    report("sincos_deg_n/sin", sine, KERNEL_COUNT * sizeof(double));
+    report("sincos_deg_n/cos", cosine, KERNEL_COUNT * sizeof(double));
+
+    // calc_sin() and calc_cos() (sincos_deg()) must give the digits of the vector paths
+    for (size_t i = 0, mismatches = 0; i < KERNEL_COUNT && mismatches < 10; i++) {
+        double s, c;
+        sincos_deg(deg[i], &s, &c);
+        if (memcmp(&s, &sine[i], sizeof(s)) != 0 || memcmp(&c, &cosine[i], sizeof(c)) != 0) {
+            printf("sincos_deg(%.17g) = (%a, %a), sincos_deg_n() = (%a, %a)\n", deg[i], s, c, sine[i], cosine[i]);
+            mismatches++;
+            check_failures++;
+        }
+    }
+    sincos_deg(663.4621255891517, &sine[0], &cosine[0]);
+    CHECK(cosine[0] == 0x1.1a4f37ea519cbp-1); // Correctly rounded
+    tan_deg_n(deg, sine, KERNEL_COUNT, errors);
+    report("tan_deg_n", sine, KERNEL_COUNT * sizeof(double));
+    report("tan_deg_n/errors", errors, sizeof(errors));
+    cot_deg_n(deg, sine, KERNEL_COUNT, errors);
+    report("cot_deg_n", sine, KERNEL_COUNT * sizeof(double));
+    report("cot_deg_n/errors", errors, sizeof(errors));
+    sincos_deg_step_n(-3600.0, 0.0137, 0, sine, cosine, KERNEL_COUNT);
+    report("sincos_deg_step_n/sin", sine, KERNEL_COUNT * sizeof(double));
+    report("sincos_deg_step_n/cos", cosine, KERNEL_COUNT * sizeof(double));
+}
+
+static void check_parse(CalcConvStatus (*parse)(const char*, size_t, unsigned long long*, size_t*), const char* text,
+    CalcConvStatus expected, size_t expected_offset) {
+    unsigned long long value = 1;
+    size_t offset = 0;
+    CalcConvStatus status = parse(text, strlen(text), &value, &offset);
+    if (status != expected || (status != CALC_CONV_OK && offset != expected_offset)) {
+        printf("\"%s\": status %d at %zu, expected %d at %zu\n", text, (int)status, offset, (int)expected, expected_offset);
+        check_failures++;
+    }
+}
+
+// Numbers too long for 64 bits are only out of range if every character is a digit
+static void test_parse_errors(void) {
+    check_parse(parse_hex, "0x2496ed1359aaE7E429", CALC_CONV_OVERFLOW, 2);
+    check_parse(parse_hex, "2x2496ed1359aaE7E429", CALC_CONV_INVALID_DIGIT, 1);
+    check_parse(parse_hex, "2496ed1359aaE7E429g", CALC_CONV_INVALID_DIGIT, 18);
+    check_parse(parse_hex, "0x0000000000000000000FFFFFFFFFFFFFFFF", CALC_CONV_OK, 0);
+    check_parse(parse_bin, "1000000000000000000000000000000000000000000000000000000000000000", CALC_CONV_OK, 0);
+    check_parse(parse_bin, "10000000000000000000000000000000000000000000000000000000000000000", CALC_CONV_OVERFLOW, 0);
+    check_parse(parse_bin, "1000000000000000000000000000000000000000000000000000000000000000 ", CALC_CONV_INVALID_DIGIT, 64);
+    check_parse(parse_bin, "0b1000000000000000000000000000000000000000000000000000000000000000000002", CALC_CONV_INVALID_DIGIT, 71);
+}
+
+static void test_base_conversions(void) {
+    enum { STRINGS = 100000 };
+    unsigned long long* values = (unsigned long long*)malloc(STRINGS * sizeof(unsigned long long));
+    char* text = (char*)malloc(STRINGS * (CALC_BIN_MAX_DIGITS + 1) + 1);
+    const char** strings = (const char**)malloc(STRINGS * sizeof(const char*));
+    size_t* offsets = (size_t*)malloc(STRINGS * sizeof(size_t));
+    size_t len;
+
+    CHECK(values != NULL && text != NULL && strings != NULL && offsets != NULL);
+    if (values != NULL && text != NULL && strings != NULL && offsets != NULL) {
+        for (size_t i = 0; i < STRINGS; i++) values[i] = next_random() >> (i % 64);
+        len = format_bin_n(values, STRINGS, text, '\0');
+        report("format_bin_n", text, len);
+        for (size_t i = 0, at = 0; i < STRINGS; i++) {
+            strings[i] = text + at;
+            at += strlen(text + at) + 1;
+            if (i % 101 == 0) text[at - 2] = '2'; // An invalid last digit
+        }
+        CHECK_U64(parse_bin_n(strings, values, STRINGS, offsets), (STRINGS + 100) / 101);
+        report("parse_bin_n", values, STRINGS * sizeof(unsigned long long));
+        report("parse_bin_n/offsets", offsets, STRINGS * sizeof(size_t));
+
+        for (size_t i = 0; i < STRINGS; i++) values[i] = next_random() >> (i % 64);
+        len = format_hex_n(values, STRINGS, text, '\0');
+        report("format_hex_n", text, len);
+        for (size_t i = 0, at = 0; i < STRINGS; i++) {
+            strings[i] = text + at;
+            at += strlen(text + at) + 1;
+            if (i % 103 == 0) text[at - 2] = 'g';
+        }
+        CHECK_U64(parse_hex_n(strings, values, STRINGS, offsets), (STRINGS + 102) / 103);
+        report("parse_hex_n", values, STRINGS * sizeof(unsigned long long));
+        report("parse_hex_n/offsets", offsets, STRINGS * sizeof(size_t));
+    }
+    free(values);
+    free(text);
+    free(strings);
+    free(offsets);
+}
+
+static void test_precision(double* r, double* p, double* out) {
+    static const char* const sources[] = {
+        "sin(R)*exp(R/100)+log(R+1)^1.5 + R^2.5", "hypot(R, P) / (1 + cos(P)) - tan(R/7)", "abs(R - P)^0.5 * R / 3"
+    };
+    char name[48];
+
+    for (size_t i = 0; i < KERNEL_COUNT; i++) {
+        r[i] = random_in(0, 1000);
+        p[i] = random_in(-360, 360);
+    }
+    for (size_t e = 0; e < sizeof(sources) / sizeof(sources[0]); e++) {
+        ExprError error;
+        CompiledExpr* expr = expr_compile_unfolded(sources[e], NULL, NULL, &error);
+        CHECK(expr != NULL);
+        if (expr == NULL) continue;
+        // f80 and f128 have no SIMD kernels
+        for (int precision = CALC_PRECISION_F32; precision <= CALC_PRECISION_F64; precision++) {
+            expr_eval_prec_many(expr, (CalcPrecision)precision, r, p, out, KERNEL_COUNT);
+            snprintf(name, sizeof(name), "expr%zu/%s", e + 1, calc_precision_name((CalcPrecision)precision));
+            report(name, out, KERNEL_COUNT * sizeof(double));
+        }
+        expr_free(expr);
+    }
+}
+
+int main(void) {
+    double* a = (double*)malloc(KERNEL_COUNT * sizeof(double));
+    double* b = (double*)malloc(KERNEL_COUNT * sizeof(double));
+    double* out = (double*)malloc(KERNEL_COUNT * sizeof(double));
+
+    CHECK(a != NULL && b != NULL && out != NULL);
+    if (a != NULL && b != NULL && out != NULL) {
+        fprintf(stderr, "SIMD level: %s\n", calc_simd_level_name(calc_simd_level()));
+        test_columns(a, b, out);
+        test_exp_log_pow(a, b, out);
+        test_trig(a, b, out);
+        test_base_conversions();
+        test_parse_errors();
+        test_precision(a, b, out);
+    }
+    free(a);
+    free(b);
+    free(out);
+    return CHECK_RESULT();
+}
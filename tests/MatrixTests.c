@@ -0,0 +1,158 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Matrix.h"
+#include "Check.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+/*
+ * The matrix engine (Matrix.c): products of odd shapes against a naive triple loop, so that every
+ * edge of the packed blocks and micro-kernel tiles is exercised, and the residual of solved
+ * systems. RunKernelTests.cmake runs the program at every CALC_SIMD level, which covers each of
+ * the micro-kernels.
+ */
+
+static uint64_t rng_state = 0x2545f4914f6cdd1dULL;
+
+// Uniform in [-1, 1) (splitmix64)
+static double next_random(void) {
+    uint64_t z = (rng_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+    return (double)(z >> 11) * 0x1p-52 - 1.0;
+}
+
+static void fill_random(CalcMatrix* m) {
+    for (size_t i = 0; i < m->rows; i++) {
+        for (size_t j = 0; j < m->cols; j++) CALC_MATRIX_AT(m, i, j) = next_random();
+    }
+}
+
+// Checks a * b against the triple loop, within the rounding error bound of a sum of k products
+static void check_multiply(size_t m, size_t k, size_t n) {
+    CalcMatrix a, b, c;
+    size_t wrong = 0;
+
+    CHECK(calc_matrix_create(&a, m, k) == CALC_OK && calc_matrix_create(&b, k, n) == CALC_OK);
+    fill_random(&a);
+    fill_random(&b);
+    CHECK(calc_matrix_multiply(&a, &b, &c) == CALC_OK);
+    if (c.data != NULL) {
+        CHECK(c.rows == m && c.cols == n);
+        for (size_t i = 0; i < m; i++) {
+            for (size_t j = 0; j < n; j++) {
+                double sum = 0, magnitude = 0;
+                for (size_t l = 0; l < k; l++) {
+                    sum += CALC_MATRIX_AT(&a, i, l) * CALC_MATRIX_AT(&b, l, j);
+                    magnitude += fabs(CALC_MATRIX_AT(&a, i, l) * CALC_MATRIX_AT(&b, l, j));
+                }
+                if (!(fabs(CALC_MATRIX_AT(&c, i, j) - sum) <= 2.0 * (double)k * 0x1p-53 * magnitude)) wrong++;
+            }
+        }
+    }
+    if (wrong != 0) printf("%zu x %zu x %zu: %zu wrong elements\n", m, k, n, wrong);
+    CHECK(wrong == 0);
+    calc_matrix_free(&a);
+    calc_matrix_free(&b);
+    calc_matrix_free(&c);
+}
+
+static void test_multiply(void) {
+    CalcMatrix a, b, c;
+
+    check_multiply(1, 1, 1);
+    check_multiply(17, 33, 9);
+    check_multiply(64, 1, 7);
+    check_multiply(301, 211, 517);
+
+    CHECK(calc_matrix_create(&a, 3, 4) == CALC_OK && calc_matrix_create(&b, 3, 4) == CALC_OK);
+    CHECK(calc_matrix_multiply(&a, &b, &c) == CALC_ERR_DIMENSION && c.data == NULL);
+    calc_matrix_free(&a);
+    calc_matrix_free(&b);
+}
+
+// Solves a random system with several right-hand sides and checks ||a x - b|| / (||a|| ||x||)
+static void check_solve(size_t n, size_t rhs) {
+    CalcMatrix a, b, x, ax;
+    double worst = 0;
+
+    CHECK(calc_matrix_create(&a, n, n) == CALC_OK && calc_matrix_create(&b, n, rhs) == CALC_OK);
+    fill_random(&a);
+    fill_random(&b);
+    CHECK(calc_matrix_solve(&a, &b, &x) == CALC_OK);
+    CHECK(calc_matrix_multiply(&a, &x, &ax) == CALC_OK);
+    if (ax.data != NULL) {
+        double norm_a = 0;
+        for (size_t i = 0; i < n; i++) {
+            double row = 0;
+            for (size_t j = 0; j < n; j++) row += fabs(CALC_MATRIX_AT(&a, i, j));
+            if (row > norm_a) norm_a = row;
+        }
+        for (size_t j = 0; j < rhs; j++) {
+            double residual = 0, norm_x = 0;
+            for (size_t i = 0; i < n; i++) {
+                residual = fmax(residual, fabs(CALC_MATRIX_AT(&ax, i, j) - CALC_MATRIX_AT(&b, i, j)));
+                norm_x = fmax(norm_x, fabs(CALC_MATRIX_AT(&x, i, j)));
+            }
+            worst = fmax(worst, residual / (norm_a * norm_x));
+        }
+    }
+    if (!(worst < 1e-13)) printf("Solve %zu x %zu: relative residual %g\n", n, n, worst);
+    CHECK(worst < 1e-13);
+    calc_matrix_free(&a);
+    calc_matrix_free(&b);
+    calc_matrix_free(&x);
+    calc_matrix_free(&ax);
+}
+
+static void test_solve(void) {
+    CalcMatrix a, b, x;
+
+    check_solve(1, 1);
+    check_solve(7, 3);
+    check_solve(300, 5);
+
+    // A zero column, and a right-hand side of the wrong height
+    CHECK(calc_matrix_create(&a, 3, 3) == CALC_OK && calc_matrix_create(&b, 3, 1) == CALC_OK);
+    fill_random(&a);
+    for (size_t i = 0; i < 3; i++) CALC_MATRIX_AT(&a, i, 1) = 0;
+    CHECK(calc_matrix_solve(&a, &b, &x) == CALC_ERR_SINGULAR && x.data == NULL);
+    calc_matrix_free(&b);
+    CHECK(calc_matrix_create(&b, 2, 1) == CALC_OK);
+    CHECK(calc_matrix_solve(&a, &b, &x) == CALC_ERR_DIMENSION && x.data == NULL);
+    calc_matrix_free(&a);
+    calc_matrix_free(&b);
+}
+
+static void test_vectors(void) {
+    CalcMatrix a, b, sum, t;
+    double v[3] = { 3e300, 4e300, 0 }, w[2] = { 3e-310, 4e-310 }, inf[2] = { NAN, INFINITY };
+    double x[7] = { 1, 2, 3, 4, 5, 6, 7 }, y[7] = { 7, 6, 5, 4, 3, 2, 1 };
+
+    CHECK(calc_matrix_create(&a, 5, 9) == CALC_OK && calc_matrix_create(&b, 5, 9) == CALC_OK);
+    fill_random(&a);
+    fill_random(&b);
+    CHECK(calc_matrix_add(&a, &b, &sum) == CALC_OK);
+    CHECK(calc_matrix_transpose(&a, &t) == CALC_OK && t.rows == 9 && t.cols == 5);
+    if (sum.data != NULL && t.data != NULL) {
+        CHECK(CALC_MATRIX_AT(&sum, 4, 8) == CALC_MATRIX_AT(&a, 4, 8) + CALC_MATRIX_AT(&b, 4, 8));
+        CHECK(CALC_MATRIX_AT(&t, 8, 4) == CALC_MATRIX_AT(&a, 4, 8) && CALC_MATRIX_AT(&t, 3, 1) == CALC_MATRIX_AT(&a, 1, 3));
+    }
+    calc_matrix_free(&a);
+    calc_matrix_free(&b);
+    calc_matrix_free(&sum);
+    calc_matrix_free(&t);
+
+    CHECK(calc_dot(x, y, 7) == 84 && calc_dot(x, y, 0) == 0);
+    CHECK(calc_norm(v, 3) == 5e300);
+    CHECK(fabs(calc_norm(w, 2) - 5e-310) <= 0x1p-1074);
+    CHECK(calc_norm(inf, 2) == INFINITY);
+}
+
+int main(void) {
+    test_multiply();
+    test_solve();
+    test_vectors();
+    return CHECK_RESULT();
+}
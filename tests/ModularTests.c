@@ -0,0 +1,103 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Modular.h"
+#include "Check.h"
+#include <limits.h>
+#include <stdint.h>
+
+/*
+ * Known answers of the modular arithmetic (Modular.c) near the top of the 64-bit range, where
+ * the 128-bit reductions and the Montgomery constants are easiest to get wrong.
+ */
+
+#define LARGEST_PRIME 18446744073709551557ULL // 2^64 - 59
+
+static void test_reduction(void) {
+    CalcModulus mod;
+
+    CHECK(calc_modulus_init(&mod, 0) == CALC_ERR_MODULO_BY_ZERO);
+
+    CHECK(calc_modulus_init(&mod, LARGEST_PRIME) == CALC_OK);
+    CHECK_U64(calc_mod_reduce(&mod, UINT64_MAX), 58);
+    CHECK_U64(calc_mod_mul(&mod, UINT64_MAX, UINT64_MAX), 3364);
+    CHECK_U64(calc_mod_pow(&mod, 3, LARGEST_PRIME - 1), 1); // Fermat
+    CHECK_U64(calc_mod_pow(&mod, 3, UINT64_MAX), 17268082312041408519ULL);
+
+    CHECK(calc_modulus_init(&mod, 1000) == CALC_OK);
+    CHECK_U64(calc_mod_pow(&mod, 2, 10), 24);
+    CHECK_U64(calc_mod_pow(&mod, 0, 0), 1);
+    CHECK(calc_modulus_init(&mod, 1) == CALC_OK);
+    CHECK_U64(calc_mod_pow(&mod, 0, 0), 0);
+
+    CHECK(calc_modulus_init(&mod, 1000000007) == CALC_OK);
+    CHECK_U64(calc_mod_pow(&mod, 7, 1ULL << 63), 874450969);
+    CHECK(calc_modulus_init(&mod, (1ULL << 63) + 1) == CALC_OK);
+    CHECK_U64(calc_mod_pow(&mod, 0xDEADBEEF, 12345), 7751426497411373009ULL);
+    CHECK(calc_modulus_init(&mod, UINT64_MAX - 1) == CALC_OK); // Even: no Montgomery form
+    CHECK_U64(calc_mod_pow(&mod, 5, UINT64_MAX), 16537834742020277461ULL);
+    CHECK(calc_modulus_init(&mod, UINT64_MAX) == CALC_OK);
+    CHECK_U64(calc_mod_pow(&mod, 0xDEADBEEFCAFEBABEULL, UINT64_MAX), 2805159162493435506ULL);
+}
+
+static void test_pow_n(void) {
+    CalcModulus mod;
+    uint64_t base[11], exp[11], out[11];
+
+    CHECK(calc_modulus_init(&mod, LARGEST_PRIME) == CALC_OK);
+    for (int i = 0; i < 11; i++) {
+        base[i] = UINT64_MAX - 1000003 * (uint64_t)i;
+        exp[i] = i == 0 ? 0 : UINT64_MAX / (uint64_t)i;
+    }
+    calc_mod_pow_n(&mod, base, exp, out, 11); // Two groups of four and a remainder of three
+    for (int i = 0; i < 11; i++) CHECK_U64(out[i], calc_mod_pow(&mod, base[i], exp[i]));
+    calc_mod_pow_n(&mod, base, exp, base, 11); // In place
+    CHECK(memcmp(base, out, sizeof(out)) == 0);
+}
+
+static void test_inverse(void) {
+    uint64_t inverse = 0;
+
+    CHECK(calc_mod_inverse(3, 11, &inverse) == CALC_OK && inverse == 4);
+    CHECK(calc_mod_inverse(123456789, LARGEST_PRIME, &inverse) == CALC_OK);
+    CHECK_U64(inverse, 2326704147043708191ULL);
+    CHECK(calc_mod_inverse(3, 1ULL << 63, &inverse) == CALC_OK);
+    CHECK_U64(inverse, 3074457345618258603ULL);
+    CHECK(calc_mod_inverse(6, 9, &inverse) == CALC_ERR_NOT_INVERTIBLE);
+    CHECK(calc_mod_inverse(5, 0, &inverse) == CALC_ERR_MODULO_BY_ZERO);
+}
+
+static void test_primes(void) {
+    int count = 0;
+
+    CHECK(!calc_is_prime(0) && !calc_is_prime(1) && calc_is_prime(2) && calc_is_prime(37) && !calc_is_prime(41 * 43));
+    CHECK(calc_is_prime(4294967291ULL));            // Largest 32-bit prime
+    CHECK(calc_is_prime((1ULL << 61) - 1));         // Mersenne
+    CHECK(calc_is_prime(LARGEST_PRIME));
+    CHECK(!calc_is_prime(UINT64_MAX));
+    CHECK(!calc_is_prime(3215031751ULL));           // Strong pseudoprime to the bases 2, 3, 5 and 7
+    CHECK(!calc_is_prime(3825123056546413051ULL));  // Strong pseudoprime to the prime bases up to 23
+    CHECK(!calc_is_prime(1000000007ULL * 998244353ULL));
+    for (uint64_t n = 0; n < 100000; n++) count += calc_is_prime(n);
+    CHECK(count == 9592);
+}
+
+static void test_remainder(void) {
+    long long a[4] = { -7, 7, LLONG_MAX, LLONG_MIN }, out[4];
+
+    CHECK(calc_mod_remainder_n(a, 3, out, 4) == CALC_OK);
+    CHECK(out[0] == -1 && out[1] == 1 && out[2] == 1 && out[3] == -2);
+    CHECK(calc_mod_remainder_n(a, -1000000007, out, 4) == CALC_OK);
+    CHECK(out[0] == -7 && out[1] == 7 && out[2] == 291172003 && out[3] == -291172004);
+    CHECK(calc_mod_remainder_n(a, 0, out, 4) == CALC_ERR_MODULO_BY_ZERO);
+    CHECK(calc_mod_remainder_n(a, 1, a, 4) == CALC_OK); // In place
+    CHECK(a[0] == 0 && a[1] == 0 && a[2] == 0 && a[3] == 0);
+}
+
+int main(void) {
+    test_reduction();
+    test_pow_n();
+    test_inverse();
+    test_primes();
+    test_remainder();
+    return CHECK_RESULT();
+}
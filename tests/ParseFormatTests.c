@@ -0,0 +1,218 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Format.h"
+#include "Parse.h"
+#include "Check.h"
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Known answers of the number parser (Parse.c) and formatter (Format.c), then round trips of
+ * pseudo-random doubles against the C library: strtod() for parsing, printf("%.*f") and "%.17g"
+ * for formatting (the tests run in the C locale).
+ */
+
+static uint64_t bits_of(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static double double_of(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static CalcConvStatus parse(const char* text, double* value, size_t* offset) {
+    *offset = CALC_CONV_NO_ERROR;
+    return parse_double(text, strlen(text), value, offset);
+}
+
+static void check_parse_value(const char* text, uint64_t expected_bits) {
+    double value = 0;
+    size_t offset;
+    CalcConvStatus status = parse(text, &value, &offset);
+    if (status != CALC_CONV_OK || bits_of(value) != expected_bits) {
+        printf("parse_double(\"%s\"): status %d, bits %016llx, expected %016llx\n", text, (int)status,
+            (unsigned long long)bits_of(value), (unsigned long long)expected_bits);
+        check_failures++;
+    }
+}
+
+static void check_parse_error(const char* text, CalcConvStatus expected, size_t expected_offset) {
+    double value = 0;
+    size_t offset;
+    CalcConvStatus status = parse(text, &value, &offset);
+    if (status != expected || offset != expected_offset) {
+        printf("parse_double(\"%s\"): status %d at %zu, expected %d at %zu\n", text, (int)status, offset,
+            (int)expected, expected_offset);
+        check_failures++;
+    }
+}
+
+static void test_parse(void) {
+    double value = 0;
+    size_t offset;
+
+    check_parse_value("0", 0x0000000000000000ULL);
+    check_parse_value("-0", 0x8000000000000000ULL);
+    check_parse_value("0.1", 0x3FB999999999999AULL);
+    check_parse_value("1e23", 0x44B52D02C7E14AF6ULL);
+    check_parse_value("123456789012345678901234567890", 0x45F8EE90FF6C373EULL);
+    check_parse_value("9007199254740993", 0x4340000000000000ULL); // Halfway, to even
+    check_parse_value("9007199254740993.000000000000000000001", 0x4340000000000001ULL);
+    check_parse_value("2.2250738585072014e-308", 0x0010000000000000ULL); // DBL_MIN
+    check_parse_value("4.9406564584124654e-324", 0x0000000000000001ULL); // Smallest denormal
+    check_parse_value("2e-324", 0x0000000000000000ULL);
+    check_parse_value("1.7976931348623157e308", 0x7FEFFFFFFFFFFFFFULL); // DBL_MAX
+    check_parse_value("-.5E+1", 0xC014000000000000ULL);
+    check_parse_value("Infinity", 0x7FF0000000000000ULL);
+    check_parse_value("-inf", 0xFFF0000000000000ULL);
+
+    CHECK(parse("NaN", &value, &offset) == CALC_CONV_OK && isnan(value));
+    check_parse_error("", CALC_CONV_EMPTY, 0);
+    check_parse_error("-", CALC_CONV_EMPTY, 1);
+    check_parse_error("1.5x", CALC_CONV_INVALID_DIGIT, 3);
+    check_parse_error("1e", CALC_CONV_INVALID_DIGIT, 1);
+    check_parse_error("1,5", CALC_CONV_INVALID_DIGIT, 1);
+    check_parse_error("1.8e308", CALC_CONV_OVERFLOW, 0);
+    check_parse_error("-1e400", CALC_CONV_OVERFLOW, 1);
+
+    CHECK(parse_number("0x1F", 4, &value, NULL) == CALC_CONV_OK && value == 31);
+    CHECK(parse_number("-0b101", 6, &value, NULL) == CALC_CONV_OK && value == -5);
+    CHECK(parse_number("0xFFFFFFFFFFFFFFFF", 18, &value, NULL) == CALC_CONV_OK && value == 0x1p64);
+    CHECK(parse_number("0x10000000000000000", 19, &value, &offset) == CALC_CONV_OVERFLOW);
+}
+
+// The low part of a literal (what parse_double_low() adds for the precisions beyond double)
+static double literal_low(const char* text) {
+    double value = 0;
+    size_t consumed = 0;
+    parse_double_prefix(text, strlen(text), &value, &consumed, NULL);
+    return parse_double_low(text, consumed, value);
+}
+
+static void test_literal_low(void) {
+    // The exact differences, rounded to double
+    CHECK(literal_low("0.1") == -0x1.999999999999ap-58);
+    CHECK(literal_low("-0.3") == -0x1.999999999999ap-57);
+    CHECK(literal_low("1e23") == 0x1p23);
+    CHECK(literal_low("3.14159265358979323846264338327950288") == 0x1.1a62633145c07p-53);
+    CHECK(literal_low("2.5") == 0 && literal_low("9007199254740993") == 1);
+    CHECK(literal_low("7e-271") == 0 && literal_low("inf") == 0 && literal_low("nan") == 0);
+}
+
+static void test_format(void) {
+    char buf[CALC_FIXED_MAX_CHARS + 1];
+
+    format_fixed(0, 4, buf); CHECK_STR(buf, "0.0000");
+    format_fixed(-0.0, 2, buf); CHECK_STR(buf, "-0.00");
+    format_fixed(0.125, 2, buf); CHECK_STR(buf, "0.12"); // Exact tie, to even
+    format_fixed(0.375, 2, buf); CHECK_STR(buf, "0.38");
+    format_fixed(2.5, 0, buf); CHECK_STR(buf, "2");
+    format_fixed(-1.5, 0, buf); CHECK_STR(buf, "-2");
+    format_fixed(0.1, 19, buf); CHECK_STR(buf, "0.1000000000000000056");
+    format_fixed(1e22, 1, buf); CHECK_STR(buf, "10000000000000000000000.0");
+    format_fixed(18446744073709551616.0, 0, buf); CHECK_STR(buf, "18446744073709551616");
+    format_fixed(123.456, 40, buf); CHECK_STR(buf, "123.4560000000000030695"); // Clamped to 19
+    format_fixed(NAN, 4, buf); CHECK_STR(buf, "nan");
+    format_fixed(-INFINITY, 4, buf); CHECK_STR(buf, "-inf");
+    CHECK(format_fixed(DBL_MAX, 19, buf) == CALC_FIXED_MAX_CHARS - 1);
+
+    format_shortest(0.1, buf); CHECK_STR(buf, "0.1");
+    format_shortest(1.0 / 3, buf); CHECK_STR(buf, "0.3333333333333333");
+    format_shortest(123456, buf); CHECK_STR(buf, "123456");
+    format_shortest(1e21, buf); CHECK_STR(buf, "1e+21");
+    format_shortest(-DBL_MIN, buf); CHECK_STR(buf, "-2.2250738585072014e-308");
+    format_shortest(double_of(1), buf); CHECK_STR(buf, "5e-324");
+    format_shortest(double_of(2), buf); CHECK_STR(buf, "1e-323");
+    format_shortest(double_of(3), buf); CHECK_STR(buf, "1.5e-323");
+    format_shortest(DBL_MAX, buf); CHECK_STR(buf, "1.7976931348623157e+308");
+    format_shortest(1e23, buf); CHECK_STR(buf, "1e+23");
+    format_shortest(9007199254740993.0, buf); CHECK_STR(buf, "9007199254740992");
+    format_shortest(1e16, buf); CHECK_STR(buf, "10000000000000000");
+    format_shortest(1e17, buf); CHECK_STR(buf, "1e+17");
+    format_shortest(0.0001, buf); CHECK_STR(buf, "0.0001");
+    format_shortest(-1e-5, buf); CHECK_STR(buf, "-1e-05");
+    format_shortest(0x1p-1022 * 3, buf); CHECK_STR(buf, "6.675221575521604e-308");
+    format_shortest(-0.0, buf); CHECK_STR(buf, "-0");
+    format_shortest(INFINITY, buf); CHECK_STR(buf, "inf");
+}
+
+// Digits of a decimal form without its leading and trailing zeros
+static int significant_digits(const char* text) {
+    const char* first = text + strcspn(text, "123456789");
+    const char* end = text + strcspn(text, "e");
+    int count = 0;
+
+    while (end > first && (end[-1] == '0' || end[-1] == '.')) end--;
+    for (const char* p = first; p < end; p++) count += *p != '.';
+    return count;
+}
+
+// xorshift64*, so that every run checks the same values
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+static void test_round_trips(void) {
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    char text[64], expected[CALC_FIXED_MAX_CHARS + 1], actual[CALC_FIXED_MAX_CHARS + 1];
+    int mismatches = 0;
+
+    for (int i = 0; i < 200000 && mismatches < 10; i++) {
+        uint64_t bits = next_random(&state);
+        double value = double_of(bits), parsed = 0;
+        int decimals = (int)(bits % (CALC_FIXED_MAX_DECIMALS + 1)), exponent;
+        if (!isfinite(value)) continue;
+
+        // Every third value gets a magnitude where the fixed notation stays short
+        if (i % 3 == 0) value = ldexp(frexp(value, &exponent), (int)(bits >> 58) - 20);
+
+        snprintf(text, sizeof(text), "%.17g", value);
+        if (parse_double(text, strlen(text), &parsed, NULL) != CALC_CONV_OK || bits_of(parsed) != bits_of(strtod(text, NULL))) {
+            printf("parse_double(\"%s\") differs from strtod()\n", text);
+            mismatches++;
+        }
+
+        format_shortest(value, actual);
+        if (strtod(actual, NULL) != value) {
+            printf("format_shortest(%s) = \"%s\" does not read back\n", text, actual);
+            mismatches++;
+        }
+        else {
+            // As many digits as the shortest "%.*e" that reads back
+            int precision = 0;
+            do snprintf(expected, sizeof(expected), "%.*e", precision++, value);
+            while (strtod(expected, NULL) != value);
+            if (significant_digits(actual) != precision) {
+                printf("format_shortest(%s) = \"%s\", but %d digits suffice\n", text, actual, precision);
+                mismatches++;
+            }
+        }
+
+        if (fabs(value) < 1e30) {
+            snprintf(expected, sizeof(expected), "%.*f", decimals, value);
+            format_fixed(value, decimals, actual);
+            if (strcmp(actual, expected) != 0) {
+                printf("format_fixed(%s, %d) = \"%s\", printf() writes \"%s\"\n", text, decimals, actual, expected);
+                mismatches++;
+            }
+        }
+    }
+    check_failures += mismatches;
+}
+
+int main(void) {
+    test_parse();
+    test_literal_low();
+    test_format();
+    test_round_trips();
+    return CHECK_RESULT();
+}
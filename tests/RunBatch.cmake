@@ -0,0 +1,25 @@
+# Runs the calculator on a batch file and compares what it writes with the expected text:
+#   cmake -DCALCULATOR=<program> -DINPUT=<name>.txt -P RunBatch.cmake
+# <name>.out holds the expected standard output and <name>.err the expected standard error.
+# Carriage returns are ignored, so that the files may have either line ending.
+
+get_filename_component(directory ${INPUT} DIRECTORY)
+get_filename_component(name ${INPUT} NAME_WE)
+
+execute_process(COMMAND ${CALCULATOR} --batch ${INPUT}
+    RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE errors)
+if(NOT result MATCHES "^[01]$") # 1 when a line failed
+    message(FATAL_ERROR "${CALCULATOR} --batch ${INPUT} failed: ${result}\n${errors}")
+endif()
+
+function(compare_text what actual expected_file)
+    file(READ ${expected_file} expected)
+    string(REPLACE "\r" "" expected "${expected}")
+    string(REPLACE "\r" "" actual "${actual}")
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "The ${what} of ${name} differs.\nExpected:\n${expected}\nActual:\n${actual}")
+    endif()
+endfunction()
+
+compare_text("standard output" "${output}" ${directory}/${name}.out)
+compare_text("standard error" "${errors}" ${directory}/${name}.err)
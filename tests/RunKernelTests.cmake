@@ -0,0 +1,27 @@
+# Runs a kernel test program at every CALC_SIMD level and compares what it writes with the output
+# of the scalar kernels, which the AVX2 and AVX-512 kernels must match bit for bit:
+#   cmake -DPROGRAM=<test program> -P RunKernelTests.cmake
+# Levels the CPU does not support run the best supported one (see calc_simd_level()).
+
+foreach(level scalar avx2 avx512)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E env CALC_SIMD=${level} ${PROGRAM}
+        RESULT_VARIABLE result OUTPUT_VARIABLE output_${level} ERROR_VARIABLE errors)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${PROGRAM} failed at CALC_SIMD=${level}: ${result}\n${output_${level}}${errors}")
+    endif()
+endforeach()
+
+string(REPLACE "\n" ";" expected "${output_scalar}")
+foreach(level avx2 avx512)
+    string(REPLACE "\n" ";" actual "${output_${level}}")
+    foreach(line IN LISTS actual)
+        if(line STREQUAL "")
+            continue()
+        endif()
+        list(FIND expected "${line}" found)
+        if(found EQUAL -1)
+            string(REGEX REPLACE " .*" "" kernel "${line}")
+            message(SEND_ERROR "At CALC_SIMD=${level}, the results of ${kernel} differ from the scalar kernels")
+        endif()
+    endforeach()
+endforeach()
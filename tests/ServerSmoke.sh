@@ -0,0 +1,30 @@
+#!/bin/sh
+# Starts the calculation server on a Unix domain socket, runs the load generator against it and
+# stops the server with SIGTERM. Passes if every request got a result and both exited cleanly.
+#   ServerSmoke.sh <calculator program> <scratch directory>
+
+calculator=$1
+socket=$2/ServerSmoke.sock
+log=$2/ServerSmoke.log
+
+"$calculator" --server --listen "unix:$socket" --loops 2 > "$log" 2>&1 &
+server=$!
+
+# Wait up to 5 s for the socket
+tries=0
+while [ ! -S "$socket" ] && [ $tries -lt 50 ]; do
+    sleep 0.1
+    tries=$((tries + 1))
+done
+
+status=0
+"$calculator" --loadgen --connect "unix:$socket" --connections 4 --requests 20000 --line "mul R 2" > "$log.loadgen" 2>&1 || status=1
+cat "$log.loadgen"
+grep -q "^Errors: 0$" "$log.loadgen" || status=1
+
+kill -TERM $server
+wait $server || status=1
+cat "$log"
+grep -q "after 4 connections and 20000 requests" "$log" || status=1
+[ ! -e "$socket" ] || status=1
+exit $status
@@ -0,0 +1,110 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Sheet.h"
+#include "Check.h"
+#include <stdlib.h>
+
+/*
+ * The dependency graph of the sheet (Sheet.c): definitions that would close a cycle, and what an
+ * edit costs in a long chain of cells. The chain is long enough that a cycle check or an
+ * invalidation quadratic in its length would exceed the timeout of the test.
+ */
+
+#define CHAIN_LENGTH 200000
+
+static void cell_name(char* name, size_t size, long i) {
+    snprintf(name, size, "a%ld", i);
+}
+
+static void test_circular(void) {
+    CalcSheet* sheet = calc_sheet_create();
+    double value = 0;
+
+    CHECK(sheet != NULL);
+    if (sheet == NULL) return;
+    CHECK(calc_sheet_define(sheet, "x", 1, "x + 1", 0, 0, NULL) == CALC_ERR_CIRCULAR);
+    CHECK(calc_sheet_define(sheet, "a", 1, "b + 1", 0, 0, NULL) == CALC_OK);
+    CHECK(calc_sheet_define(sheet, "b", 1, "c * 2", 0, 0, NULL) == CALC_OK);
+    CHECK(calc_sheet_define(sheet, "c", 1, "a - 1", 0, 0, NULL) == CALC_ERR_CIRCULAR);
+    CHECK(calc_sheet_define(sheet, "c", 1, "d + a", 0, 0, NULL) == CALC_ERR_CIRCULAR);
+    CHECK(calc_sheet_define(sheet, "b", 1, "a", 0, 0, NULL) == CALC_ERR_CIRCULAR);
+
+    // The rejected definitions left the previous ones, and c is still undefined
+    CHECK(calc_sheet_value(sheet, "a", 1, &value) == CALC_ERR_UNDEFINED);
+    CHECK(calc_sheet_set(sheet, "c", 1, 4) == CALC_OK);
+    CHECK(calc_sheet_value(sheet, "a", 1, &value) == CALC_OK && value == 9);
+
+    // Diamonds are not cycles
+    CHECK(calc_sheet_define(sheet, "d", 1, "a + b + c", 0, 0, NULL) == CALC_OK);
+    CHECK(calc_sheet_define(sheet, "e", 1, "d * a", 0, 0, NULL) == CALC_OK);
+    CHECK(calc_sheet_value(sheet, "e", 1, &value) == CALC_OK && value == 21 * 9);
+    CHECK(calc_sheet_define(sheet, "c", 1, "e", 0, 0, NULL) == CALC_ERR_CIRCULAR);
+    calc_sheet_free(sheet);
+}
+
+static void test_precision(void) {
+    CalcSheet* sheet = calc_sheet_create();
+    CompiledExpr* expr = NULL;
+    ExprError error;
+    double value = 1;
+
+    CHECK(sheet != NULL);
+    if (sheet == NULL) return;
+    CHECK(calc_sheet_define(sheet, "x", 1, "0.1", 0, 0, NULL) == CALC_OK);
+    expr = expr_compile_unfolded("x*3 - 0.3", calc_sheet_resolve, sheet, &error);
+    CHECK(expr != NULL);
+    if (expr != NULL) {
+        // In float, 0.1f * 3 rounds to 0.3f; in double, 0.1 * 3 does not round to 0.3
+        CHECK(calc_sheet_eval(sheet, expr, CALC_PRECISION_F32, 0, 0, &value) == CALC_OK && value == 0);
+        CHECK(calc_sheet_eval(sheet, expr, CALC_PRECISION_F64, 0, 0, &value) == CALC_OK && value == 0x1p-54);
+    }
+    expr_free(expr);
+    calc_sheet_free(sheet);
+}
+
+static void test_chain(void) {
+    CalcSheet* sheet = calc_sheet_create();
+    char name[32], formula[48];
+    unsigned long long before;
+    double value = 0;
+    int defined = 1;
+
+    CHECK(sheet != NULL);
+    if (sheet == NULL) return;
+    CHECK(calc_sheet_set(sheet, "a0", 2, 0) == CALC_OK);
+    for (long i = 1; i < CHAIN_LENGTH && defined; i++) {
+        cell_name(name, sizeof(name), i);
+        snprintf(formula, sizeof(formula), "a%ld + 1", i - 1);
+        defined = calc_sheet_define(sheet, name, strlen(name), formula, 0, 0, NULL) == CALC_OK;
+    }
+    CHECK(defined);
+    cell_name(name, sizeof(name), CHAIN_LENGTH - 1);
+    CHECK(calc_sheet_value(sheet, name, strlen(name), &value) == CALC_OK && value == CHAIN_LENGTH - 1);
+    CHECK_U64(calc_sheet_recomputations(sheet), CHAIN_LENGTH - 1);
+
+    // Closing the chain into a loop is caught at its far end
+    CHECK(calc_sheet_define(sheet, "a0", 2, formula, 0, 0, NULL) == CALC_ERR_CIRCULAR);
+
+    // An edit near the end recomputes only the cells after it, and only when read
+    before = calc_sheet_recomputations(sheet);
+    cell_name(name, sizeof(name), CHAIN_LENGTH - 10);
+    CHECK(calc_sheet_define(sheet, name, strlen(name), "1000", 0, 0, NULL) == CALC_OK);
+    CHECK_U64(calc_sheet_recomputations(sheet), before);
+    cell_name(name, sizeof(name), CHAIN_LENGTH - 1);
+    CHECK(calc_sheet_value(sheet, name, strlen(name), &value) == CALC_OK && value == 1009);
+    CHECK_U64(calc_sheet_recomputations(sheet) - before, 10);
+
+    // Setting an input to the value it has recomputes nothing
+    before = calc_sheet_recomputations(sheet);
+    CHECK(calc_sheet_set(sheet, "a0", 2, 0) == CALC_OK);
+    CHECK(calc_sheet_value(sheet, name, strlen(name), &value) == CALC_OK && value == 1009);
+    CHECK_U64(calc_sheet_recomputations(sheet), before);
+    calc_sheet_free(sheet);
+}
+
+int main(void) {
+    test_circular();
+    test_precision();
+    test_chain();
+    return CHECK_RESULT();
+}
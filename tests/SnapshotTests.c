@@ -0,0 +1,171 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Calculator.h"
+#include "Snapshot.h"
+#include "Check.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Known answers of the snapshot checksum (calc_xxh64() in Snapshot.c): the sanity checks of the
+ * reference xxhsum, whose buffer is the top bytes of a multiplicative sequence, and a few more
+ * lengths that cover every tail of the stripe loop. Then a context and sheet written to a snapshot
+ * and read back, the snapshots a reader must reject, and a snapshot adopted and edited in place.
+ */
+
+#define SANITY_BUFFER_SIZE 2367
+#define SANITY_SEED 2654435761ULL
+
+static unsigned char sanity_buffer[SANITY_BUFFER_SIZE];
+
+static void fill_sanity_buffer(void) {
+    uint64_t byte_gen = SANITY_SEED;
+    for (size_t i = 0; i < SANITY_BUFFER_SIZE; i++) {
+        sanity_buffer[i] = (unsigned char)(byte_gen >> 56);
+        byte_gen *= 11400714785074694797ULL;
+    }
+}
+
+static void test_xxh64(void) {
+    static const char fox[] = "The quick brown fox jumps over the lazy dog";
+
+    fill_sanity_buffer();
+    CHECK_U64(calc_xxh64(sanity_buffer, 0, 0), 0xEF46DB3751D8E999ULL);
+    CHECK_U64(calc_xxh64(sanity_buffer, 0, SANITY_SEED), 0xAC75FDA2929B17EFULL);
+    CHECK_U64(calc_xxh64(sanity_buffer, 1, 0), 0xE934A84ADB052768ULL);
+    CHECK_U64(calc_xxh64(sanity_buffer, 1, SANITY_SEED), 0x5014607643A9B4C3ULL);
+    CHECK_U64(calc_xxh64(sanity_buffer, 14, 0), 0x8282DCC4994E35C8ULL);
+    CHECK_U64(calc_xxh64(sanity_buffer, 14, SANITY_SEED), 0xC3BD6BF63DEB6DF0ULL);
+    CHECK_U64(calc_xxh64(sanity_buffer, 222, 0), 0xB641AE8CB691C174ULL);
+    CHECK_U64(calc_xxh64(sanity_buffer, 222, SANITY_SEED), 0x20CB8AB7AE10C14AULL);
+    CHECK_U64(calc_xxh64(sanity_buffer, SANITY_BUFFER_SIZE, 0), 0xA82418DDEC0EA581ULL);
+    CHECK_U64(calc_xxh64(sanity_buffer + 1, 100, 0), 0xCFCA226B37D74D08ULL); // Unaligned
+
+    CHECK_U64(calc_xxh64("a", 1, 0), 0xD24EC4F1A98C6E5BULL);
+    CHECK_U64(calc_xxh64("abc", 3, 0), 0x44BC2CF5AD770999ULL);
+    CHECK_U64(calc_xxh64(fox, sizeof(fox) - 1, 0), 0x0B242D361FDA71BCULL);
+}
+
+static void test_round_trip(void) {
+    CalcContext ctx, restored;
+    CalcSheet* sheet = calc_sheet_create();
+    CalcSheet* copy = calc_sheet_create();
+    CalcSheet* other = calc_sheet_create();
+    unsigned char* buffer = NULL;
+    size_t size = 0;
+    double value = 0;
+
+    CHECK(sheet != NULL && copy != NULL && other != NULL);
+    if (sheet == NULL || copy == NULL || other == NULL) goto done;
+    calc_init(&ctx);
+    ctx.last_result = 42.5;
+    ctx.prev_result = -0.125;
+    CHECK(calc_sheet_set(sheet, "a", 1, 3) == CALC_OK);
+    CHECK(calc_sheet_define(sheet, "b", 1, "a * R + P", ctx.last_result, ctx.prev_result, NULL) == CALC_OK);
+    CHECK(calc_sheet_value(sheet, "b", 1, &value) == CALC_OK && value == 127.375);
+    CHECK(calc_sheet_set(sheet, "a", 1, 2) == CALC_OK); // b is now out of date
+
+    size = calc_snapshot_size(&ctx, sheet);
+    buffer = (unsigned char*)malloc(size);
+    CHECK(buffer != NULL && size % 8 == 0);
+    if (buffer == NULL) goto done;
+    calc_snapshot_write(&ctx, sheet, buffer);
+
+    calc_init(&restored);
+    CHECK(calc_snapshot_read(buffer, size, &restored, copy) == CALC_OK);
+    CHECK(restored.last_result == 42.5 && restored.prev_result == -0.125);
+    CHECK(calc_sheet_cell_count(copy) == calc_sheet_cell_count(sheet));
+    CHECK(calc_sheet_value(copy, "b", 1, &value) == CALC_OK && value == 84.875);
+    CHECK(calc_snapshot_read(buffer, size, &restored, copy) == CALC_ERR_SNAPSHOT); // Not empty
+
+    // Truncated, one flipped bit past the header, and another magic
+    CHECK(calc_snapshot_read(buffer, size - 8, &restored, other) == CALC_ERR_SNAPSHOT);
+    buffer[size - 1] ^= 0x10;
+    CHECK(calc_snapshot_read(buffer, size, &restored, other) == CALC_ERR_SNAPSHOT);
+    buffer[size - 1] ^= 0x10;
+    buffer[0] ^= 0x01;
+    CHECK(calc_snapshot_read(buffer, size, &restored, other) == CALC_ERR_SNAPSHOT);
+    buffer[0] ^= 0x01;
+    CHECK(calc_sheet_cell_count(other) == 0 && restored.last_result == 42.5);
+    CHECK(calc_snapshot_read(buffer, size, &restored, NULL) == CALC_OK); // Context only
+
+done:
+    free(buffer);
+    calc_sheet_free(sheet);
+    calc_sheet_free(copy);
+    calc_sheet_free(other);
+}
+
+static int releases = 0;
+
+static void count_release(void* block, size_t size) {
+    (void)size;
+    releases++;
+    free(block);
+}
+
+// A snapshot adopted by the sheet is used in place, edited and released with the sheet
+static void test_adopt(void) {
+    CalcContext ctx;
+    CalcSheet* sheet = calc_sheet_create();
+    CalcSheet* adopted = calc_sheet_create();
+    unsigned char* buffer = NULL;
+    size_t size = 0;
+    double value = 0;
+    char name[16];
+
+    CHECK(sheet != NULL && adopted != NULL);
+    if (sheet == NULL || adopted == NULL) goto done;
+    calc_init(&ctx);
+    CHECK(calc_sheet_set(sheet, "a", 1, 3) == CALC_OK);
+    CHECK(calc_sheet_define(sheet, "b", 1, "a * 2", 0, 0, NULL) == CALC_OK);
+    CHECK(calc_sheet_define(sheet, "c", 1, "a + b", 0, 0, NULL) == CALC_OK);
+    size = calc_snapshot_size(&ctx, sheet);
+    buffer = (unsigned char*)malloc(size);
+    CHECK(buffer != NULL);
+    if (buffer == NULL) goto done;
+    calc_snapshot_write(&ctx, sheet, buffer);
+
+    // A rejected snapshot stays with the caller
+    buffer[size - 1] ^= 0x10;
+    CHECK(calc_snapshot_adopt(buffer, size, count_release, &ctx, adopted) == CALC_ERR_SNAPSHOT && releases == 0);
+    buffer[size - 1] ^= 0x10;
+    CHECK(calc_snapshot_adopt(buffer, size, count_release, &ctx, adopted) == CALC_OK && releases == 0);
+    buffer = NULL;
+
+    CHECK(calc_sheet_value(adopted, "c", 1, &value) == CALC_OK && value == 9);
+    // Edits detach cells from the image: a redefinition, a new user of a pooled cell, and enough
+    // new cells to move the name index out of the image
+    CHECK(calc_sheet_define(adopted, "b", 1, "a * 10", 0, 0, NULL) == CALC_OK);
+    CHECK(calc_sheet_define(adopted, "d", 1, "c - a", 0, 0, NULL) == CALC_OK);
+    for (int i = 0; i < 200; i++) {
+        snprintf(name, sizeof(name), "x%d", i);
+        CHECK(calc_sheet_set(adopted, name, strlen(name), i) == CALC_OK);
+    }
+    CHECK(calc_sheet_set(adopted, "a", 1, 4) == CALC_OK);
+    CHECK(calc_sheet_value(adopted, "d", 1, &value) == CALC_OK && value == 40);
+    CHECK(calc_sheet_value(adopted, "x199", 4, &value) == CALC_OK && value == 199);
+    CHECK(calc_sheet_define(adopted, "a", 1, "d", 0, 0, NULL) == CALC_ERR_CIRCULAR);
+    calc_sheet_free(adopted);
+    adopted = NULL;
+    CHECK(releases == 1);
+
+    // Without a sheet to restore, the snapshot is released at once
+    buffer = (unsigned char*)malloc(size);
+    CHECK(buffer != NULL);
+    if (buffer == NULL) goto done;
+    calc_snapshot_write(&ctx, sheet, buffer);
+    CHECK(calc_snapshot_adopt(buffer, size, count_release, &ctx, NULL) == CALC_OK && releases == 2);
+    buffer = NULL;
+
+done:
+    free(buffer);
+    calc_sheet_free(sheet);
+    calc_sheet_free(adopted);
+}
+
+int main(void) {
+    test_xxh64();
+    test_round_trip();
+    test_adopt();
+    return CHECK_RESULT();
+}
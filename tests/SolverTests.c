@@ -0,0 +1,181 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "Solver.h"
+#include "Expression.h"
+#include "Check.h"
+#include <stdlib.h>
+#include <math.h>
+
+/*
+ * Integration and root finding (Solver.c): known integrals and roots within the tolerance, and the
+ * error paths: the evaluation limit, evaluation failures and brackets without a sign change.
+ */
+
+#define PI 3.14159265358979323846
+
+static void exp_px(void* context, const double* x, const double* p, double* y, size_t n) {
+    (void)context;
+    for (size_t i = 0; i < n; i++) y[i] = exp(p[i] * x[i]);
+}
+
+static void sqrt_x(void* context, const double* x, const double* p, double* y, size_t n) {
+    (void)context;
+    (void)p;
+    for (size_t i = 0; i < n; i++) y[i] = sqrt(x[i]);
+}
+
+static void lorentzian(void* context, const double* x, const double* p, double* y, size_t n) {
+    (void)context;
+    (void)p;
+    for (size_t i = 0; i < n; i++) y[i] = 1 / (1 + x[i] * x[i]);
+}
+
+static void sine(void* context, const double* x, const double* p, double* y, size_t n) {
+    (void)context;
+    (void)p;
+    for (size_t i = 0; i < n; i++) y[i] = sin(x[i]);
+}
+
+// sin(1 / x) oscillates ever faster towards 0, which no number of subintervals resolves
+static void sine_inverse(void* context, const double* x, const double* p, double* y, size_t n) {
+    (void)context;
+    (void)p;
+    for (size_t i = 0; i < n; i++) y[i] = sin(1 / x[i]);
+}
+
+// x^2 - p, and its derivative
+static void square_minus_p(void* context, const double* x, const double* p, double* y, size_t n) {
+    (void)context;
+    for (size_t i = 0; i < n; i++) y[i] = x[i] * x[i] - p[i];
+}
+
+static void twice_x(void* context, const double* x, const double* p, double* y, size_t n) {
+    (void)context;
+    (void)p;
+    for (size_t i = 0; i < n; i++) y[i] = 2 * x[i];
+}
+
+static void expression(void* context, const double* x, const double* p, double* y, size_t n) {
+    expr_eval_many((const CompiledExpr*)context, x, p, y, n);
+}
+
+// The result is within tol of the expected value, and the error estimate within the tolerance
+static int close_to(const CalcSolverResult* result, double expected, double tol) {
+    return fabs(result->value - expected) <= tol && result->error <= tol;
+}
+
+static void test_integrate(void) {
+    CalcSolverOptions options;
+    CalcSolverResult result;
+
+    calc_solver_defaults(&options);
+    CHECK(calc_integrate(exp_px, NULL, 1, 0, 1, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, exp(1) - 1, 1e-10));
+    CHECK(result.evals == 21 && result.steps == 1);
+    CHECK(calc_integrate(exp_px, NULL, -2, 0, 10, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, (1 - exp(-20)) / 2, 1e-10));
+    CHECK(calc_integrate(sine, NULL, 0, PI, 0, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, -2, 1e-10));
+    CHECK(calc_integrate(sine, NULL, 0, 1, 1, &options, &result) == CALC_OK && result.value == 0);
+
+    // An infinite derivative at 0, and infinite bounds
+    CHECK(calc_integrate(sqrt_x, NULL, 0, 0, 1, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, 2.0 / 3, 1e-10) && result.steps > 1);
+    CHECK(calc_integrate(lorentzian, NULL, 0, -INFINITY, INFINITY, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, PI, 1e-9));
+    CHECK(calc_integrate(lorentzian, NULL, 0, 0, INFINITY, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, PI / 2, 1e-9));
+    CHECK(calc_integrate(exp_px, NULL, 1, -INFINITY, 0, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, 1, 1e-9));
+
+    // The evaluation limit: the best estimate so far, within the limit
+    options.max_evals = 200;
+    CHECK(calc_integrate(sqrt_x, NULL, 0, 0, 1, &options, &result) == CALC_ERR_NOT_CONVERGED);
+    CHECK(result.evals <= 200 && fabs(result.value - 2.0 / 3) < 1e-4 && result.error > 1e-10);
+    options.max_evals = 20;
+    CHECK(calc_integrate(sqrt_x, NULL, 0, 0, 1, &options, &result) == CALC_ERR_NOT_CONVERGED);
+    CHECK(result.evals == 21 && isfinite(result.value));
+    options.max_evals = 0;
+    CHECK(calc_integrate(sine_inverse, NULL, 0, 0, 1, &options, &result) == CALC_ERR_NOT_CONVERGED);
+    CHECK(result.evals <= 1000000 && fabs(result.value - 0.504067061906928) < 1e-3);
+
+    // Failed evaluations and bounds
+    CHECK(calc_integrate(sqrt_x, NULL, 0, -1, 1, &options, &result) == CALC_ERR_EVALUATION && isnan(result.value));
+    CHECK(calc_integrate(exp_px, NULL, 1, 0, INFINITY, &options, &result) == CALC_ERR_EVALUATION);
+    CHECK(calc_integrate(exp_px, NULL, 1, 0, NAN, &options, &result) == CALC_ERR_EVALUATION);
+}
+
+static void test_roots(void) {
+    CalcSolverOptions options;
+    CalcSolverResult result;
+    CalcSolverResult results[1000];
+    CalcStatus statuses[1000];
+    double p[1000], lo[1000], hi[1000];
+    size_t wrong = 0;
+
+    calc_solver_defaults(&options);
+    CHECK(calc_find_root(square_minus_p, NULL, 2, 0, 2, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, sqrt(2), 1e-10));
+    CHECK(calc_find_root(square_minus_p, NULL, 2, 0, -2, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, -sqrt(2), 1e-10));
+    CHECK(calc_find_root(square_minus_p, NULL, 4, 2, 5, &options, &result) == CALC_OK && result.value == 2);
+    CHECK(calc_find_root(sine, NULL, 0, 3, 4, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, PI, 1e-10));
+
+    // Many problems in lockstep, over several blocks: the square roots of 1..1000
+    for (size_t i = 0; i < 1000; i++) {
+        p[i] = (double)(i + 1);
+        lo[i] = 0;
+        hi[i] = (double)(i + 1) + 1;
+    }
+    for (int method = 0; method < 3; method++) {
+        options.method = method == 0 ? CALC_ROOT_BRENT : CALC_ROOT_NEWTON;
+        options.derivative = method == 2 ? twice_x : NULL;
+        CHECK(calc_find_roots(square_minus_p, NULL, p, lo, hi, 1000, &options, results, statuses) == CALC_OK);
+        for (size_t i = 0; i < 1000; i++) {
+            if (statuses[i] != CALC_OK || !close_to(&results[i], sqrt(p[i]), 1e-10 * (1 + sqrt(p[i])))) wrong++;
+        }
+    }
+    CHECK(wrong == 0);
+
+    // The evaluation limit, with the best estimate within the bracket
+    calc_solver_defaults(&options);
+    options.max_evals = 4;
+    CHECK(calc_find_root(square_minus_p, NULL, 2, 0, 1000, &options, &result) == CALC_ERR_NOT_CONVERGED);
+    CHECK(result.evals <= 4 && result.value >= 0 && result.value <= 1000 && result.error > 1e-10);
+    options.method = CALC_ROOT_NEWTON;
+    CHECK(calc_find_root(square_minus_p, NULL, 2, 0, 1000, &options, &result) == CALC_ERR_NOT_CONVERGED);
+    CHECK(result.evals <= 4 && result.value >= 0 && result.value <= 1000);
+
+    // No sign change, failed evaluations and bounds
+    calc_solver_defaults(&options);
+    CHECK(calc_find_root(square_minus_p, NULL, -1, -1, 1, &options, &result) == CALC_ERR_NO_SIGN_CHANGE);
+    CHECK(isnan(result.value));
+    CHECK(calc_find_root(sqrt_x, NULL, 0, -1, 1, &options, &result) == CALC_ERR_EVALUATION);
+    CHECK(calc_find_root(square_minus_p, NULL, 2, 0, INFINITY, &options, &result) == CALC_ERR_EVALUATION);
+    CHECK(calc_find_root(square_minus_p, NULL, 2, NAN, 2, &options, &result) == CALC_ERR_EVALUATION);
+}
+
+// Compiled expressions, as --integrate and --root evaluate them
+static void test_expressions(void) {
+    CalcSolverOptions options;
+    CalcSolverResult result;
+    ExprError error;
+    CompiledExpr* expr = expr_compile("R * R - P", &error);
+
+    CHECK(expr != NULL);
+    if (expr == NULL) return;
+    expr_jit(expr);
+    calc_solver_defaults(&options);
+    CHECK(calc_integrate(expression, expr, 1, 0, 3, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, 6, 1e-10));
+    CHECK(calc_find_root(expression, expr, 3, 1, 2, &options, &result) == CALC_OK);
+    CHECK(close_to(&result, sqrt(3), 1e-10));
+    expr_free(expr);
+}
+
+int main(void) {
+    test_integrate();
+    test_roots();
+    test_expressions();
+    return CHECK_RESULT();
+}